@@ -0,0 +1,136 @@
+// Front-end throughput benchmark: tokenizes and parses a corpus repeatedly and
+// reports tokens/s and MB/s for each phase.
+//
+//   pulse_parse_bench [--iterations N] [--size KB] [file.pul ...]
+//
+// Without files a synthetic corpus of roughly --size KB is generated so the
+// numbers are comparable between machines and revisions.
+
+#include "synthetic.hpp"
+#include "lexer/source_buffer.hpp"
+#include "lexer/tokenizer.hpp"
+#include "parser/parser.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace pulse;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    double tokenize_seconds = 0.0;
+    double parse_seconds = 0.0;
+    size_t tokens = 0;
+    size_t bytes = 0;
+};
+
+double seconds(Clock::time_point begin, Clock::time_point end) {
+    return std::chrono::duration<double>(end - begin).count();
+}
+
+// Best-of-N timing keeps scheduler noise out of the reported rate
+Result measure(const lexer::SourceBufferPtr& source, int iterations) {
+    Result best;
+    best.bytes = source->size();
+    best.tokenize_seconds = best.parse_seconds = 1e30;
+
+    for (int i = 0; i < iterations; i++) {
+        auto t0 = Clock::now();
+        lexer::Tokenizer tokenizer(source);
+        lexer::TokenStream tokens = tokenizer.tokenize();
+        auto t1 = Clock::now();
+
+        parser::Parser parser(tokens);
+        auto program = parser.parse();
+        auto t2 = Clock::now();
+
+        if (!program) {
+            throw std::runtime_error("Failed to parse " + source->getName());
+        }
+
+        best.tokens = tokens.size();
+        best.tokenize_seconds = std::min(best.tokenize_seconds, seconds(t0, t1));
+        best.parse_seconds = std::min(best.parse_seconds, seconds(t1, t2));
+    }
+
+    return best;
+}
+
+void report(const std::string& phase, size_t tokens, size_t bytes, double elapsed) {
+    double mtok = static_cast<double>(tokens) / elapsed / 1e6;
+    double mb = static_cast<double>(bytes) / elapsed / (1024.0 * 1024.0);
+    std::cout << "  " << std::left << std::setw(10) << phase << std::right
+              << std::fixed << std::setprecision(3) << std::setw(10) << elapsed * 1000.0 << " ms"
+              << std::setprecision(2) << std::setw(10) << mtok << " Mtok/s"
+              << std::setw(10) << mb << " MB/s\n";
+}
+
+void printUsage() {
+    std::cout << "Usage: pulse_parse_bench [--iterations N] [--size KB] [file.pul ...]\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int iterations = 10;
+    size_t size_kb = 4096;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "--iterations" || arg == "-n") && i + 1 < argc) {
+            iterations = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--size" && i + 1 < argc) {
+            size_kb = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return 0;
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    std::vector<lexer::SourceBufferPtr> sources;
+    try {
+        if (files.empty()) {
+            sources.push_back(lexer::SourceBuffer::fromString(bench::generateCorpus(size_kb * 1024), "<synthetic>"));
+        }
+        for (const auto& file : files) {
+            sources.push_back(lexer::SourceBuffer::fromFile(file));
+        }
+
+        Result total;
+        for (const auto& source : sources) {
+            Result result = measure(source, iterations);
+            total.tokens += result.tokens;
+            total.bytes += result.bytes;
+            total.tokenize_seconds += result.tokenize_seconds;
+            total.parse_seconds += result.parse_seconds;
+
+            std::cout << source->getName() << ": " << result.bytes << " bytes, "
+                      << result.tokens << " tokens (best of " << iterations << ")\n";
+            report("tokenize", result.tokens, result.bytes, result.tokenize_seconds);
+            report("parse", result.tokens, result.bytes, result.parse_seconds);
+            report("total", result.tokens, result.bytes, result.tokenize_seconds + result.parse_seconds);
+        }
+
+        if (sources.size() > 1) {
+            std::cout << "all inputs: " << total.bytes << " bytes, " << total.tokens << " tokens\n";
+            report("tokenize", total.tokens, total.bytes, total.tokenize_seconds);
+            report("parse", total.tokens, total.bytes, total.parse_seconds);
+            report("total", total.tokens, total.bytes, total.tokenize_seconds + total.parse_seconds);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
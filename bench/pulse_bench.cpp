@@ -0,0 +1,689 @@
+// Benchmark suite of the whole tool chain. For each program of the corpus
+// (bench/corpus, and a synthetic source) it measures:
+//
+//   lex/F        tokens/s              parse/F     AST nodes/s
+//   codegen/F    IR instructions/s     jit/F       AST to callable code, -O2
+//   interp/F     ops/s on the VM       install/*   pulpm against a mock registry
+//
+// codegen and jit need a build with LLVM and skip programs native code
+// generation does not support. interp counts the operations a program
+// declares in a "# bench-ops: N" comment, else runs. The front end reads
+// each program --scale times over, so that its rates are not dominated by
+// setup. Every figure is the best of --iterations runs.
+//
+//   pulse_bench [--iterations N] [--scale N] [--filter TEXT] [--corpus DIR]
+//               [--pulpm PATH] [--save FILE] [--baseline FILE] [--threshold PCT]
+//               [file.pul ...]
+//
+// --save writes the results as JSON; --baseline compares them with such a
+// file and exits with status 1 when a benchmark got slower by more than
+// --threshold percent (default 10).
+
+#include "synthetic.hpp"
+#include "build/build_graph.hpp"
+#include "lexer/source_buffer.hpp"
+#include "lexer/tokenizer.hpp"
+#include "parser/parser.hpp"
+#include "runtime/runtime.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef PULSE_HAVE_LLVM
+#include "compiler/compiler.hpp"
+#include "compiler/jit.hpp"
+#include <llvm/IR/Module.h>
+#endif
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace pulse;
+namespace fs = std::filesystem;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds(Clock::time_point begin, Clock::time_point end) {
+    return std::chrono::duration<double>(end - begin).count();
+}
+
+struct Options {
+    int iterations = 5;
+    size_t scale = 64;
+    std::string filter;
+    std::string corpus = PULSE_BENCH_CORPUS;
+    std::string pulpm;
+    std::string save;
+    std::string baseline;
+    double threshold = 10.0;
+    std::vector<std::string> files;
+};
+
+struct Result {
+    std::string name;
+    double seconds = 0.0; // best run
+    double work = 0.0;    // units of unit per run; 0 for a plain latency
+    std::string unit;
+};
+
+struct Program {
+    std::string name;
+    std::string text;
+    double ops = 0.0; // from "# bench-ops: N"
+};
+
+// "12.3 Mtokens/s"
+std::string formatRate(double perSecond, const std::string& unit) {
+    char text[64];
+    if (perSecond >= 1e6) {
+        std::snprintf(text, sizeof(text), "%.2f M%s/s", perSecond / 1e6, unit.c_str());
+    } else if (perSecond >= 1e3) {
+        std::snprintf(text, sizeof(text), "%.2f k%s/s", perSecond / 1e3, unit.c_str());
+    } else {
+        std::snprintf(text, sizeof(text), "%.2f %s/s", perSecond, unit.c_str());
+    }
+    return text;
+}
+
+class Suite {
+public:
+    explicit Suite(const Options& options) : options(options) {}
+
+    bool selected(const std::string& name) const {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    }
+
+    // Best of the iterations; run returns the seconds of the part it timed
+    double best(const std::function<double()>& run) const {
+        double fastest = 1e30;
+        for (int i = 0; i < options.iterations; i++) {
+            fastest = std::min(fastest, run());
+        }
+        return fastest;
+    }
+
+    void add(Result result) {
+        char line[256];
+        std::snprintf(line, sizeof(line), "  %-36s %12.3f ms", result.name.c_str(), result.seconds * 1000.0);
+        std::cout << line;
+        if (result.work > 0) std::cout << "   " << formatRate(result.work / result.seconds, result.unit);
+        std::cout << std::endl;
+        results.push_back(std::move(result));
+    }
+
+    void skip(const std::string& name, const std::string& reason) {
+        char line[256];
+        std::snprintf(line, sizeof(line), "  %-36s skipped: %s", name.c_str(), reason.c_str());
+        std::cout << line << std::endl;
+    }
+
+    const std::vector<Result>& getResults() const { return results; }
+
+private:
+    const Options& options;
+    std::vector<Result> results;
+};
+
+// Every node of the tree, the program root included
+class NodeCounter : public parser::StaticASTVisitor<NodeCounter> {
+public:
+    size_t nodes = 0;
+
+    void count(parser::ASTNode* node) {
+        if (!node) return;
+        nodes++;
+        visit(node);
+    }
+    template <typename List>
+    void countAll(const List& list) {
+        for (const auto& node : list) count(node.get());
+    }
+
+    void visitBinaryExpression(parser::BinaryExpression* expr) {
+        count(expr->left.get());
+        count(expr->right.get());
+    }
+    void visitUnaryExpression(parser::UnaryExpression* expr) { count(expr->operand.get()); }
+    void visitCallExpression(parser::CallExpression* expr) {
+        count(expr->callee.get());
+        countAll(expr->arguments);
+    }
+    void visitAttributeExpression(parser::AttributeExpression* expr) { count(expr->object.get()); }
+    void visitSubscriptExpression(parser::SubscriptExpression* expr) {
+        count(expr->object.get());
+        count(expr->index.get());
+    }
+    void visitListExpression(parser::ListExpression* expr) { countAll(expr->elements); }
+    void visitDictExpression(parser::DictExpression* expr) {
+        for (const auto& pair : expr->pairs) {
+            count(pair.key.get());
+            count(pair.value.get());
+        }
+    }
+    void visitTupleExpression(parser::TupleExpression* expr) { countAll(expr->elements); }
+    void visitAssignmentStatement(parser::AssignmentStatement* stmt) { count(stmt->value.get()); }
+    void visitExpressionStatement(parser::ExpressionStatement* stmt) { count(stmt->expression.get()); }
+    void visitReturnStatement(parser::ReturnStatement* stmt) { count(stmt->value.get()); }
+    void visitIfStatement(parser::IfStatement* stmt) {
+        for (const auto& branch : stmt->branches) {
+            count(branch.condition.get());
+            countAll(branch.body);
+        }
+        countAll(stmt->else_body);
+    }
+    void visitWhileStatement(parser::WhileStatement* stmt) {
+        count(stmt->condition.get());
+        countAll(stmt->body);
+    }
+    void visitForStatement(parser::ForStatement* stmt) {
+        count(stmt->iterable.get());
+        countAll(stmt->body);
+    }
+    void visitMatchStatement(parser::MatchStatement* stmt) {
+        count(stmt->value.get());
+        for (const auto& [pattern, body] : stmt->cases) {
+            count(pattern.get());
+            countAll(body);
+        }
+    }
+    void visitFunctionDeclaration(parser::FunctionDeclaration* decl) { countAll(decl->body); }
+    void visitClassDeclaration(parser::ClassDeclaration* decl) { countAll(decl->members); }
+    void visitProgram(parser::Program* program) {
+        countAll(program->declarations);
+        countAll(program->statements);
+    }
+};
+
+std::unique_ptr<parser::Program> parseProgram(const Program& program) {
+    auto source = lexer::SourceBuffer::fromString(program.text, program.name);
+    lexer::Tokenizer tokenizer(source);
+    parser::Parser parser(tokenizer.tokenize());
+    auto ast = parser.parse();
+    if (!ast) throw std::runtime_error(program.name + " does not parse");
+    return ast;
+}
+
+void benchFrontEnd(Suite& suite, const Program& program, size_t scale) {
+    std::string lexName = "lex/" + program.name;
+    std::string parseName = "parse/" + program.name;
+    if (!suite.selected(lexName) && !suite.selected(parseName)) return;
+
+    std::string text;
+    text.reserve(program.text.size() * scale);
+    for (size_t i = 0; i < scale; i++) text += program.text + "\n";
+    auto source = lexer::SourceBuffer::fromString(std::move(text), program.name);
+
+    lexer::TokenStream tokens;
+    double lexSeconds = suite.best([&] {
+        auto start = Clock::now();
+        lexer::Tokenizer tokenizer(source);
+        tokens = tokenizer.tokenize();
+        return seconds(start, Clock::now());
+    });
+    if (suite.selected(lexName)) suite.add({lexName, lexSeconds, static_cast<double>(tokens.size()), "tokens"});
+
+    size_t nodes = 0;
+    double parseSeconds = suite.best([&] {
+        auto start = Clock::now();
+        parser::Parser parser(tokens);
+        auto ast = parser.parse();
+        double elapsed = seconds(start, Clock::now());
+        if (!ast) throw std::runtime_error(program.name + " does not parse");
+        NodeCounter counter;
+        counter.count(ast.get());
+        nodes = counter.nodes;
+        return elapsed;
+    });
+    if (suite.selected(parseName)) suite.add({parseName, parseSeconds, static_cast<double>(nodes), "nodes"});
+}
+
+#ifdef PULSE_HAVE_LLVM
+void benchCodegen(Suite& suite, const Program& program) {
+    std::string codegenName = "codegen/" + program.name;
+    std::string jitName = "jit/" + program.name;
+
+    if (suite.selected(codegenName)) {
+        // -O0: the IR as generated, without the optimizer's share
+        compiler::CompileOptions options;
+        options.optLevel = 0;
+        size_t instructions = 0;
+        std::string error;
+        double elapsed = suite.best([&] {
+            auto ast = parseProgram(program);
+            compiler::Compiler compiler(options);
+            auto start = Clock::now();
+            bool ok = compiler.compile(ast.get());
+            double elapsed = seconds(start, Clock::now());
+            if (!ok) error = compiler.getError();
+            else instructions = compiler.getModule()->getInstructionCount();
+            return elapsed;
+        });
+        if (error.empty()) {
+            suite.add({codegenName, elapsed, static_cast<double>(instructions), "instructions"});
+        } else {
+            suite.skip(codegenName, error);
+        }
+    }
+
+    if (suite.selected(jitName)) {
+        // What pulse run spends before the program starts, with a JIT up
+        compiler::CompileOptions options;
+        options.targetCPU = "native";
+        std::string error;
+        double elapsed = suite.best([&] {
+            auto ast = parseProgram(program);
+            compiler::JIT jit(options.optLevel);
+            auto start = Clock::now();
+            compiler::Compiler compiler(options);
+            if (!compiler.compile(ast.get())) {
+                error = compiler.getError();
+                return 0.0;
+            }
+            jit.addModuleNow(compiler, options.entryPoint);
+            return seconds(start, Clock::now());
+        });
+        if (error.empty()) {
+            suite.add({jitName, elapsed, 0, ""});
+        } else {
+            suite.skip(jitName, error);
+        }
+    }
+}
+#endif
+
+void benchInterpreter(Suite& suite, const Program& program) {
+    std::string name = "interp/" + program.name;
+    if (!suite.selected(name)) return;
+
+    double elapsed = suite.best([&] {
+        // The bytecode VM alone: no native tier, and out() prints nothing
+        runtime::Runtime runtime;
+        runtime.initialize();
+        runtime.defineNative("out", [](runtime::Runtime&, std::span<const runtime::Value>) {
+            return runtime::Value();
+        });
+        auto chunk = runtime.compile(program.text);
+        auto start = Clock::now();
+        runtime.run(chunk);
+        return seconds(start, Clock::now());
+    });
+    if (program.ops > 0) {
+        suite.add({name, elapsed, program.ops, "ops"});
+    } else {
+        suite.add({name, elapsed, 1, "runs"});
+    }
+}
+
+#ifndef _WIN32
+
+// HTTP/1.1 server on 127.0.0.1 for pulpm: GET of the published paths, with
+// keep-alive connections, one thread each
+class MockRegistry {
+public:
+    MockRegistry() {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+        if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(listener, 64) != 0 || getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+            if (listener >= 0) close(listener);
+            throw std::runtime_error("mock registry: cannot listen on 127.0.0.1");
+        }
+        port = ntohs(address.sin_port);
+        acceptor = std::thread([this] { acceptLoop(); });
+    }
+
+    ~MockRegistry() {
+        stopping = true;
+        acceptor.join();
+        for (auto& connection : connections) connection.join();
+        close(listener);
+    }
+
+    MockRegistry(const MockRegistry&) = delete;
+    MockRegistry& operator=(const MockRegistry&) = delete;
+
+    // path is relative to the root, as in url()
+    void publish(const std::string& path, std::string content) {
+        std::lock_guard<std::mutex> lock(mutex);
+        files[path] = std::move(content);
+    }
+
+    std::string url(const std::string& path) const {
+        return "http://127.0.0.1:" + std::to_string(port) + "/" + path;
+    }
+
+private:
+    std::mutex mutex;
+    std::map<std::string, std::string> files;
+    int listener = -1;
+    int port = 0;
+    std::atomic<bool> stopping{false};
+    std::thread acceptor;
+    std::vector<std::thread> connections; // the acceptor's
+
+    // Polls, so that both loops notice stopping within a tenth of a second
+    static bool readable(int fd) {
+        pollfd entry{fd, POLLIN, 0};
+        return poll(&entry, 1, 100) > 0;
+    }
+
+    void acceptLoop() {
+        while (!stopping) {
+            if (!readable(listener)) continue;
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd >= 0) connections.emplace_back([this, fd] { serve(fd); });
+        }
+    }
+
+    void serve(int fd) {
+        std::string buffer;
+        char chunk[4096];
+        while (!stopping) {
+            size_t end = buffer.find("\r\n\r\n");
+            if (end == std::string::npos) {
+                if (!readable(fd)) continue;
+                ssize_t count = recv(fd, chunk, sizeof(chunk), 0);
+                if (count <= 0) break;
+                buffer.append(chunk, static_cast<size_t>(count));
+                continue;
+            }
+            std::istringstream request(buffer.substr(0, end));
+            buffer.erase(0, end + 4);
+            std::string method, target;
+            request >> method >> target;
+
+            std::string status = "200 OK";
+            std::string body;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto file = files.find(target.empty() ? target : target.substr(1));
+                if (file != files.end()) {
+                    body = file->second;
+                } else {
+                    status = "404 Not Found";
+                }
+            }
+            std::string response =
+                "HTTP/1.1 " + status + "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+            if (method != "HEAD") response += body;
+            if (!sendAll(fd, response)) break;
+        }
+        close(fd);
+    }
+
+    static bool sendAll(int fd, const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t count = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (count <= 0) return false;
+            sent += static_cast<size_t>(count);
+        }
+        return true;
+    }
+};
+
+std::string quote(const std::string& text) {
+    std::string quoted = "'";
+    for (char c : text) {
+        if (c == '\'') quoted += "'\\''";
+        else quoted += c;
+    }
+    return quoted + "'";
+}
+
+// A tree of PACKAGES libraries, lib<i> depending on lib<2i+1> and lib<2i+2>,
+// each of FILES sources, installed into a project that depends on lib0:
+//   install/cold    nothing installed, nothing in the package store
+//   install/store   pulse.lock and the store, but no .pulse/libs
+//   install/locked  everything in place already
+void benchInstall(Suite& suite, const std::string& pulpm) {
+    static const size_t PACKAGES = 15;
+    static const size_t FILES = 4;
+    if (!suite.selected("install/")) return;
+    if (pulpm.empty() || !fs::exists(pulpm)) {
+        suite.skip("install/*", "no pulpm found (use --pulpm PATH)");
+        return;
+    }
+
+    MockRegistry registry;
+    for (size_t i = 0; i < PACKAGES; i++) {
+        std::string name = "lib" + std::to_string(i);
+        std::string manifest = "[package]\nname = \"" + name + "\"\nversion = \"1.0.0\"\nfiles = [";
+        for (size_t f = 0; f < FILES; f++) {
+            std::string file = "src/module" + std::to_string(f) + ".pul";
+            manifest += (f > 0 ? ", \"" : "\"") + file + "\"";
+            registry.publish(name + "/" + file, bench::generateCorpus(8 * 1024 + i * 64 + f));
+        }
+        manifest += "]\n\n[dependencies]\n";
+        for (size_t child : {2 * i + 1, 2 * i + 2}) {
+            if (child < PACKAGES) {
+                std::string dependency = "lib" + std::to_string(child);
+                manifest += dependency + " = \"" + registry.url(dependency) + "\"\n";
+            }
+        }
+        registry.publish(name + "/pulse.toml", manifest);
+    }
+
+    fs::path root = fs::temp_directory_path() / ("pulse_bench_" + std::to_string(getpid()));
+    fs::path home = root / "home";
+    fs::path project = root / "project";
+    fs::create_directories(project);
+    std::ofstream(project / "pulse.toml") << "[project]\nname = \"bench\"\nversion = \"0.1.0\"\n\n[dependencies]\n"
+                                          << "lib0 = \"" << registry.url("lib0") << "\"\n";
+
+    std::string command = "cd " + quote(project.string()) + " && HOME=" + quote(home.string()) +
+                          " PULSE_STORE_DIR=" + quote((home / ".pulse" / "store").string()) + " " + quote(pulpm) +
+                          " install";
+    auto install = [&] {
+        std::string output;
+        auto start = Clock::now();
+        int status = build::runCommand(command, output);
+        double elapsed = seconds(start, Clock::now());
+        if (status != 0) throw std::runtime_error("pulpm install failed:\n" + output);
+        return elapsed;
+    };
+
+    try {
+        double cold = suite.best([&] {
+            fs::remove_all(home);
+            fs::remove_all(project / ".pulse");
+            fs::remove(project / "pulse.lock");
+            return install();
+        });
+        if (suite.selected("install/cold")) suite.add({"install/cold", cold, PACKAGES * FILES, "files"});
+
+        if (suite.selected("install/store")) {
+            double fromStore = suite.best([&] {
+                fs::remove_all(project / ".pulse");
+                return install();
+            });
+            suite.add({"install/store", fromStore, PACKAGES * FILES, "files"});
+        }
+        if (suite.selected("install/locked")) {
+            suite.add({"install/locked", suite.best(install), 0, ""});
+        }
+    } catch (...) {
+        fs::remove_all(root);
+        throw;
+    }
+    fs::remove_all(root);
+}
+
+#endif
+
+// Corpus programs: the given files, else bench/corpus/*.pul, and the
+// synthetic source (front end only, as it calls undefined functions)
+std::vector<Program> loadPrograms(const Options& options, Program& synthetic) {
+    std::vector<std::string> paths = options.files;
+    if (paths.empty() && fs::is_directory(options.corpus)) {
+        for (const auto& entry : fs::directory_iterator(options.corpus)) {
+            if (entry.path().extension() == ".pul") paths.push_back(entry.path().string());
+        }
+        std::sort(paths.begin(), paths.end());
+    }
+
+    std::vector<Program> programs;
+    static const std::regex OPS("#\\s*bench-ops:\\s*([0-9]+)");
+    for (const auto& path : paths) {
+        auto source = lexer::SourceBuffer::fromFile(path);
+        Program program{fs::path(path).filename().string(), std::string(source->text())};
+        std::smatch match;
+        if (std::regex_search(program.text, match, OPS)) program.ops = std::stod(match[1]);
+        programs.push_back(std::move(program));
+    }
+
+    // About as large as one scaled-up corpus program
+    synthetic.name = "synthetic";
+    synthetic.text = bench::generateCorpus(16 * 1024);
+    return programs;
+}
+
+// --save: one benchmark per line
+void saveResults(const std::string& path, const std::vector<Result>& results) {
+    std::ofstream out(path);
+    out << "{\"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        char seconds[32];
+        std::snprintf(seconds, sizeof(seconds), "%.9g", results[i].seconds);
+        out << (i > 0 ? ",\n  " : "\n  ") << "{\"name\": \"" << results[i].name << "\", \"seconds\": " << seconds
+            << ", \"work\": " << results[i].work << ", \"unit\": \"" << results[i].unit << "\"}";
+    }
+    out << "\n]}\n";
+    if (!out) throw std::runtime_error("cannot write " + path);
+}
+
+// The seconds of each benchmark in a file written by --save
+std::map<std::string, double> loadBaseline(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("cannot read " + path);
+    static const std::regex ENTRY("\"name\":\\s*\"([^\"]*)\",\\s*\"seconds\":\\s*([-+0-9.eE]+)");
+    std::map<std::string, double> baseline;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::smatch match;
+        if (std::regex_search(line, match, ENTRY)) baseline[match[1]] = std::stod(match[2]);
+    }
+    return baseline;
+}
+
+// True when nothing got slower than the threshold allows
+bool compareBaseline(const Options& options, const std::vector<Result>& results) {
+    auto baseline = loadBaseline(options.baseline);
+    std::cout << "\ncompared with " << options.baseline << " (threshold " << options.threshold << "%):" << std::endl;
+    bool ok = true;
+    for (const auto& result : results) {
+        char line[256];
+        auto before = baseline.find(result.name);
+        if (before == baseline.end()) {
+            std::snprintf(line, sizeof(line), "  %-36s %12s    %10.3f ms   new", result.name.c_str(), "",
+                          result.seconds * 1000.0);
+        } else {
+            double change = (result.seconds / before->second - 1.0) * 100.0;
+            const char* verdict = change > options.threshold ? "   slower" : change < -options.threshold ? "   faster" : "";
+            if (change > options.threshold) ok = false;
+            std::snprintf(line, sizeof(line), "  %-36s %12.3f ms -> %10.3f ms %+7.1f%%%s", result.name.c_str(),
+                          before->second * 1000.0, result.seconds * 1000.0, change, verdict);
+        }
+        std::cout << line << std::endl;
+    }
+    return ok;
+}
+
+void printUsage() {
+    std::cout << "Usage: pulse_bench [--iterations N] [--scale N] [--filter TEXT] [--corpus DIR]\n"
+              << "                   [--pulpm PATH] [--save FILE] [--baseline FILE] [--threshold PCT]\n"
+              << "                   [file.pul ...]\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    fs::path self = fs::absolute(argv[0]).parent_path() / "pulpm";
+    options.pulpm = self.string();
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if ((arg == "--iterations" || arg == "-n") && hasValue) {
+            options.iterations = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--scale" && hasValue) {
+            options.scale = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--filter" && hasValue) {
+            options.filter = argv[++i];
+        } else if (arg == "--corpus" && hasValue) {
+            options.corpus = argv[++i];
+        } else if (arg == "--pulpm" && hasValue) {
+            options.pulpm = argv[++i];
+        } else if (arg == "--save" && hasValue) {
+            options.save = argv[++i];
+        } else if (arg == "--baseline" && hasValue) {
+            options.baseline = argv[++i];
+        } else if (arg == "--threshold" && hasValue) {
+            options.threshold = std::atof(argv[++i]);
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return 0;
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "Error: unknown option " << arg << std::endl;
+            printUsage();
+            return 1;
+        } else {
+            options.files.push_back(arg);
+        }
+    }
+
+    Suite suite(options);
+    try {
+        Program synthetic;
+        std::vector<Program> programs = loadPrograms(options, synthetic);
+        std::cout << "pulse_bench: " << programs.size() << " programs, best of " << options.iterations
+                  << ", front end x" << options.scale << std::endl;
+
+        for (const auto& program : programs) benchFrontEnd(suite, program, options.scale);
+        benchFrontEnd(suite, synthetic, options.scale);
+#ifdef PULSE_HAVE_LLVM
+        for (const auto& program : programs) benchCodegen(suite, program);
+#endif
+        for (const auto& program : programs) benchInterpreter(suite, program);
+#ifndef _WIN32
+        benchInstall(suite, options.pulpm);
+#endif
+
+        if (!options.save.empty()) {
+            saveResults(options.save, suite.getResults());
+            std::cout << "wrote " << options.save << std::endl;
+        }
+        if (!options.baseline.empty() && !compareBaseline(options, suite.getResults())) {
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
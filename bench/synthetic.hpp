@@ -0,0 +1,47 @@
+#pragma once
+
+// Synthetic Pulse source for the front-end benchmarks: a repeated mix of
+// functions, classes, loops and literals that exercises every token kind
+// the lexer fast paths handle. Deterministic, so that numbers compare
+// between machines and revisions.
+
+#include <cstddef>
+#include <sstream>
+#include <string>
+
+namespace pulse::bench {
+
+inline std::string generateCorpus(size_t target_bytes) {
+    std::ostringstream out;
+    size_t index = 0;
+
+    while (static_cast<size_t>(out.tellp()) < target_bytes) {
+        out << "# generated function " << index << "\n"
+            << "def compute_" << index << "(a, b, c):\n"
+            << "    total = a * 2 + b // 3 - c % 7\n"
+            << "    values = [a, b, c, " << index << ", 3.25]\n"
+            << "    table = {\"key\": total, \"name\": \"entry_" << index << "\"}\n"
+            << "    for i in range(10):\n"
+            << "        if i < a and not b == c:\n"
+            << "            total = total + values[i % 5] ** 2\n"
+            << "        elif i >= b or c != 0:\n"
+            << "            total = total - table.get(\"key\")\n"
+            << "        else:\n"
+            << "            total = -total\n"
+            << "    while total > 1000:\n"
+            << "        total = total / 2\n"
+            << "    return total\n"
+            << "\n"
+            << "class Shape_" << index << "(Base):\n"
+            << "    def area(self, scale):\n"
+            << "        return self.width * self.height * scale\n"
+            << "\n"
+            << "result_" << index << " = compute_" << index << "(1, 2, (3, 4))\n"
+            << "\n";
+        index++;
+    }
+
+    return out.str();
+}
+
+} // namespace pulse::bench
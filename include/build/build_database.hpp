@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace pulse::build {
+
+// 64-bit FNV-1a over everything an output is built from
+class Hasher {
+public:
+    Hasher& add(std::string_view data);
+    Hasher& add(uint64_t value);
+    // Contents of a file; throws std::runtime_error if it cannot be read
+    Hasher& addFile(const std::filesystem::path& path);
+
+    uint64_t digest() const { return state; }
+
+private:
+    uint64_t state = 14695981039346656037ull;
+};
+
+std::string toHex(uint64_t value);
+
+// Identity of the program a command line starts with: its resolved path,
+// size and modification time. Replacing the compiler changes it, so every
+// output the old one built is rebuilt.
+uint64_t toolIdentity(const std::string& program);
+
+// Persistent record of the signature each output was last built from, kept
+// in one text file per build directory. Thread-safe; save() rewrites the file
+// atomically, so an interrupted build never leaves it half written.
+class BuildDatabase {
+public:
+    // Loads the file if it exists; a damaged file only costs a full rebuild
+    explicit BuildDatabase(std::filesystem::path file);
+
+    // True if output exists and was last built from signature
+    bool upToDate(const std::string& output, uint64_t signature) const;
+    void record(const std::string& output, uint64_t signature);
+    void forget(const std::string& output);
+
+    void save() const;
+
+private:
+    std::filesystem::path file;
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, uint64_t> entries;
+};
+
+} // namespace pulse::build
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "build/build_database.hpp"
+#include "build/compile_cache.hpp"
+
+namespace pulse::build {
+
+// One command of a build: a compile or a link
+struct BuildStep {
+    std::string label;   // "Compiling src/main.pul", shown with the step's time
+    std::string command; // run through the shell
+    std::string output;  // the file it produces
+    uint64_t signature = 0; // of the command's inputs, tool and flags
+    std::vector<size_t> dependencies; // steps whose outputs it reads
+    uint64_t cacheKey = 0; // CompileCache key of the output; 0 if not cached
+};
+
+// Result counts of BuildGraph::run
+struct BuildSummary {
+    size_t built = 0;
+    size_t upToDate = 0;
+    size_t cached = 0;  // of built: copied from the compile cache
+    size_t failed = 0;
+    size_t skipped = 0; // not run because a dependency failed
+    double seconds = 0;
+
+    bool ok() const { return failed == 0 && skipped == 0; }
+};
+
+// Dependency graph of build steps, run by a pool of jobs. A step whose
+// output exists with the signature the database recorded for it is up to
+// date and is not run. Signatures chain: a step's signature covers its
+// dependencies', so a changed source relinks exactly the programs it is
+// part of. Steps run as soon as their dependencies are done, across all the
+// targets in the graph; each prints its label, time and output once it ends.
+class BuildGraph {
+public:
+    // Adds a step after the steps it depends on; returns its index
+    size_t add(BuildStep step);
+
+    const BuildStep& step(size_t index) const { return steps[index]; }
+    size_t size() const { return steps.size(); }
+
+    // jobs == 0 runs one job per hardware thread. Records every step that
+    // succeeded in the database and saves it. With a cache, a stale step
+    // with a cacheKey takes its output from the cache if it can, and stores
+    // it there once it ran.
+    BuildSummary run(BuildDatabase& database, unsigned jobs = 0, CompileCache* cache = nullptr);
+
+    static unsigned defaultJobs();
+
+private:
+    std::vector<BuildStep> steps;
+};
+
+// Runs a shell command with stdout and stderr captured together; returns
+// its exit status (-1 if it could not be started)
+int runCommand(const std::string& command, std::string& output);
+
+} // namespace pulse::build
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace pulse::build {
+
+// Content-addressed store of build outputs, shared by every project and
+// target on the machine and optionally by an HTTP server shared between
+// machines. A key hashes everything that decides an output's bytes (the
+// source, the tool's version and flags, the dependencies) and never a path,
+// so the same commit built anywhere hits the same entries. Entries are
+// immutable and written atomically; concurrent builds share the cache
+// safely. Cache errors are never build errors: they cost a compile.
+class CompileCache {
+public:
+    // remote is "http://host[:port]/prefix" (GET and PUT <prefix>/<key>),
+    // or empty for a local cache only
+    explicit CompileCache(std::filesystem::path directory, std::string remote = "");
+
+    // $PULSE_CACHE_DIR, or ~/.pulse/cache/objects
+    static std::filesystem::path defaultDirectory();
+
+    // Copies the entry for key to output; an entry found on the remote is
+    // kept in the local cache too
+    bool fetch(uint64_t key, const std::string& output);
+
+    // Adds output under key, locally and on the remote
+    void store(uint64_t key, const std::string& output);
+
+    // What the tool prints for --version, or its toolIdentity() in hex if it
+    // has no such option; part of every key of the outputs it produces. The
+    // answer is kept per toolIdentity(), so the tool only runs once per version.
+    std::string toolVersion(const std::string& program);
+
+    const std::string& remoteURL() const { return remote; }
+
+private:
+    std::filesystem::path directory;
+    std::string remote;
+    std::atomic<bool> remoteFailed{false}; // unreachable: not asked again this build
+
+    std::filesystem::path entryPath(uint64_t key) const;
+    bool storeLocal(uint64_t key, const std::string& contents);
+    void remoteError(const std::string& message);
+};
+
+// Hash of the [dependencies] and [libs] of a pulse.toml as resolved on this
+// machine: each entry's name and spec, and the files of the installed copy
+// in the project's .pulse/libs, or else under pulse_home/packages or
+// pulse_home/libs
+uint64_t hashDependencies(const std::filesystem::path& config_file, const std::filesystem::path& pulse_home);
+
+} // namespace pulse::build
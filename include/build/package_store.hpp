@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace pulse::build {
+
+// Content-addressed store of package files, shared by every project on the
+// machine: each file is kept once, read-only, under the SHA-256 of its bytes.
+// Projects get their dependencies from it by reflink where the file system
+// can clone (copy-on-write, so an edit in a project never reaches the
+// store), else by hardlink, and only across file systems by copy. Entries
+// are immutable and added atomically; concurrent installs share it safely.
+class PackageStore {
+public:
+    explicit PackageStore(std::filesystem::path directory);
+
+    // $PULSE_STORE_DIR, or ~/.pulse/store
+    static std::filesystem::path defaultDirectory();
+
+    bool contains(const std::string& digest) const;
+
+    // A fresh name inside the store for a download on its way in, so that
+    // add() is a rename
+    std::filesystem::path temporaryPath() const;
+
+    // Moves file into the store; returns its digest. If the store already
+    // holds those bytes, file is removed instead.
+    std::string add(const std::filesystem::path& file);
+
+    // Copies file into the store unless it is there already; returns its digest
+    std::string import(const std::filesystem::path& file);
+
+    // Puts the stored file with digest at target, replacing what is there.
+    // Throws std::runtime_error if the store does not hold it, or if digest
+    // is not one.
+    void link(const std::string& digest, const std::filesystem::path& target);
+
+    const std::filesystem::path& location() const { return directory; }
+
+    // How link() placed files so far
+    size_t reflinked() const { return reflinks; }
+    size_t hardlinked() const { return hardlinks; }
+    size_t copied() const { return copies; }
+
+private:
+    std::filesystem::path directory;
+    std::atomic<size_t> reflinks{0};
+    std::atomic<size_t> hardlinks{0};
+    std::atomic<size_t> copies{0};
+
+    std::filesystem::path entryPath(const std::string& digest) const;
+};
+
+} // namespace pulse::build
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace pulse::build {
+
+// SHA-256, for digests that vouch for bytes from elsewhere: pulse.lock and
+// the package store. Hasher stays the key of what is only built locally.
+class Sha256 {
+public:
+    Sha256& add(std::string_view data);
+    // Contents of a file; throws std::runtime_error if it cannot be read
+    Sha256& addFile(const std::filesystem::path& path);
+
+    // 64 lowercase hex digits; the hash cannot be added to afterwards
+    std::string hexDigest();
+
+    // True for what hexDigest() returns, so that a digest read from a file
+    // is safe to use as a file name
+    static bool isDigest(std::string_view text);
+
+private:
+    uint32_t state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                         0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    unsigned char block[64];
+    size_t used = 0;
+    uint64_t length = 0; // bytes added
+
+    void compress(const unsigned char* chunk);
+};
+
+} // namespace pulse::build
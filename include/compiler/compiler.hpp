@@ -1,64 +1,165 @@
 #pragma once
 
+#include <functional>
+#include <map>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
+#include "compiler/type_inference.hpp"
+#include "driver/module_interface.hpp"
 #include "parser/ast.hpp"
 
 // Forward declarations
 namespace llvm {
     class LLVMContext;
     class Module;
-    class IRBuilder;
+    class ConstantFolder;
+    class IRBuilderDefaultInserter;
+    template <typename FolderTy, typename InserterTy> class IRBuilder;
     class Function;
     class BasicBlock;
+    class AllocaInst;
+    class BranchInst;
+    class TargetMachine;
     class Value;
     class Type;
 }
 
 namespace pulse::compiler {
 
-class Compiler {
+// Code generation settings (driver: -O/--opt-level, -march, --thin-lto, --entry)
+struct CompileOptions {
+    // 0-3, mapped onto LLVM's O0..O3 pipelines and codegen levels
+    unsigned optLevel = 2;
+
+    // CPU to tune and select instructions for; "native" is the host CPU and
+    // empty means the generic CPU of the target triple
+    std::string targetCPU;
+
+    // Target triple; empty is the host
+    std::string targetTriple;
+
+    // Run the ThinLTO pre-link pipeline and emit bitcode with a module summary
+    // instead of a fully optimized object, for multi-file builds linked with LTO
+    bool thinLTOPreLink = false;
+
+    // Function that receives the top-level statements. Only the program's
+    // entry file should use "main"; other modules get an init function.
+    std::string entryPoint = "main";
+};
+
+class Compiler : private pulse::parser::StaticASTVisitor<Compiler, llvm::Value*> {
 public:
-    Compiler();
+    explicit Compiler(CompileOptions options = CompileOptions());
     ~Compiler();
-    
-    // Compile AST to LLVM IR
+
+    // Compile AST to LLVM IR and run the optimization pipeline. When outputFile
+    // is given the result is written there: .ll as text, .bc as bitcode, any
+    // other name as a native object (ThinLTO pre-link always writes bitcode).
+    // On failure returns false and getError() describes the problem.
     bool compile(pulse::parser::Program* program, const std::string& outputFile = "");
-    
+
+    // Tiered execution: compile only decl, specialized for the given argument
+    // types, with what it calls, behind an adapter named symbol of type
+    // uint64(const uint64*) that passes the raw bits of the values (see
+    // runtime/tiering.hpp). Fails unless the specialization matches the
+    // interpreter exactly (TypeInference::matchesInterpreter); returnType
+    // receives the type of the adapter's result.
+    bool compileSpecialization(const pulse::parser::Program* program, pulse::parser::FunctionDeclaration* decl,
+                               const Signature& params, const std::string& symbol, ValueType& returnType);
+
+    // A module the program imports: calls of its functions are checked
+    // against their parameter counts, and its constants are inlined. Call
+    // before compile().
+    void addImport(std::shared_ptr<const pulse::driver::InterfaceFile> interface);
+
+    const std::string& getError() const { return error; }
+
+    // "LLVM 14.0.0" and the host's triple, CPU and CPU features: what decides
+    // the code generated for a given source and options
+    static std::string backendVersion();
+
     // Get generated LLVM IR as string
     std::string getIRString() const;
-    
+
     // Get generated LLVM module
     llvm::Module* getModule() const;
-    
+
     // Get LLVM context
     llvm::LLVMContext* getContext() const;
 
+    // Give up the module and the context it lives in (e.g. to the JIT); the
+    // compiler cannot be used afterwards
+    std::pair<std::unique_ptr<llvm::LLVMContext>, std::unique_ptr<llvm::Module>> releaseModule();
+
 private:
+    // The visitor base dispatches back into the visitXxx hooks below
+    friend class pulse::parser::StaticASTVisitor<Compiler, llvm::Value*>;
+    using Builder = llvm::IRBuilder<llvm::ConstantFolder, llvm::IRBuilderDefaultInserter>;
+
     std::unique_ptr<llvm::LLVMContext> context;
     std::unique_ptr<llvm::Module> module;
-    std::unique_ptr<llvm::IRBuilder<>> builder;
-    
+    std::unique_ptr<Builder> builder;
+    std::unique_ptr<llvm::TargetMachine> targetMachine;
+    CompileOptions options;
+    std::string error;
+
     // Compilation state
     llvm::Function* currentFunction;
-    llvm::BasicBlock* currentBlock;
-    
-    // Symbol table for variables
-    std::map<std::string, llvm::Value*> variables;
-    
+
+    // Symbol tables: local slots of the current function, and the exported
+    // and external functions by source name (LLVM may rename e.g. a user "main")
+    std::map<std::string, llvm::AllocaInst*, std::less<>> variables;
+    std::map<std::string, llvm::Function*, std::less<>> functions;
+
+    // Interfaces of the imported modules, and their constants by name
+    std::vector<std::shared_ptr<const pulse::driver::InterfaceFile>> imports;
+    std::map<std::string, pulse::driver::ModuleInterface::Constant, std::less<>> importedConstants;
+
+    // Monomorphized functions: one LLVM function per inferred signature, and
+    // the instances declared at a call site whose bodies are still to be emitted
+    std::unique_ptr<TypeInference> inference;
+    std::map<const FunctionInstance*, llvm::Function*> instanceFunctions;
+    std::vector<const FunctionInstance*> pendingInstances;
+
     // Helper methods
     llvm::Value* compileExpression(pulse::parser::Expression* expr);
-    llvm::Value* compileStatement(pulse::parser::Statement* stmt);
-    llvm::Value* compileDeclaration(pulse::parser::Declaration* decl);
-    
+    void compileStatement(pulse::parser::Statement* stmt);
+    void compileDeclaration(pulse::parser::Declaration* decl);
+    void compileBlock(const pulse::parser::ArenaVector<pulse::parser::StatementPtr>& body);
+
+    // Visitor hooks (one switch per node, no RTTI)
+    llvm::Value* visitLiteralExpression(pulse::parser::LiteralExpression* expr) { return compileLiteralExpression(expr); }
+    llvm::Value* visitIdentifierExpression(pulse::parser::IdentifierExpression* expr) { return compileIdentifierExpression(expr); }
+    llvm::Value* visitBinaryExpression(pulse::parser::BinaryExpression* expr) { return compileBinaryExpression(expr); }
+    llvm::Value* visitUnaryExpression(pulse::parser::UnaryExpression* expr) { return compileUnaryExpression(expr); }
+    llvm::Value* visitCallExpression(pulse::parser::CallExpression* expr) { return compileCallExpression(expr); }
+    llvm::Value* visitAssignmentStatement(pulse::parser::AssignmentStatement* stmt) { compileAssignmentStatement(stmt); return nullptr; }
+    llvm::Value* visitExpressionStatement(pulse::parser::ExpressionStatement* stmt) { compileExpressionStatement(stmt); return nullptr; }
+    llvm::Value* visitReturnStatement(pulse::parser::ReturnStatement* stmt) { compileReturnStatement(stmt); return nullptr; }
+    llvm::Value* visitIfStatement(pulse::parser::IfStatement* stmt) { compileIfStatement(stmt); return nullptr; }
+    llvm::Value* visitWhileStatement(pulse::parser::WhileStatement* stmt) { compileWhileStatement(stmt); return nullptr; }
+    llvm::Value* visitForStatement(pulse::parser::ForStatement* stmt) { compileForStatement(stmt); return nullptr; }
+    llvm::Value* visitFunctionDeclaration(pulse::parser::FunctionDeclaration* decl) { compileFunctionDeclaration(decl); return nullptr; }
+    llvm::Value* visitClassDeclaration(pulse::parser::ClassDeclaration* decl) { compileClassDeclaration(decl); return nullptr; }
+
     // Expression compilation
     llvm::Value* compileLiteralExpression(pulse::parser::LiteralExpression* expr);
     llvm::Value* compileIdentifierExpression(pulse::parser::IdentifierExpression* expr);
     llvm::Value* compileBinaryExpression(pulse::parser::BinaryExpression* expr);
     llvm::Value* compileUnaryExpression(pulse::parser::UnaryExpression* expr);
     llvm::Value* compileCallExpression(pulse::parser::CallExpression* expr);
-    
+    llvm::Value* compileLogicalExpression(pulse::parser::BinaryExpression* expr);
+    llvm::Value* compilePrintCall(pulse::parser::CallExpression* expr);
+    llvm::Function* getFloatFormatter();
+    llvm::Function* getIntPower();
+    llvm::Function* getRaise();
+    void raiseIf(llvm::Value* failed, const char* message);
+    llvm::Value* compileConversionCall(std::string_view name, pulse::parser::CallExpression* expr);
+    llvm::Value* compileNumericCall(std::string_view name, pulse::parser::CallExpression* expr);
+
     // Statement compilation
     void compileAssignmentStatement(pulse::parser::AssignmentStatement* stmt);
     void compileExpressionStatement(pulse::parser::ExpressionStatement* stmt);
@@ -66,20 +167,45 @@ private:
     void compileIfStatement(pulse::parser::IfStatement* stmt);
     void compileWhileStatement(pulse::parser::WhileStatement* stmt);
     void compileForStatement(pulse::parser::ForStatement* stmt);
-    
+    bool compileRangeLoop(pulse::parser::ForStatement* stmt);
+
     // Declaration compilation
     void compileFunctionDeclaration(pulse::parser::FunctionDeclaration* decl);
     void compileClassDeclaration(pulse::parser::ClassDeclaration* decl);
-    
+    llvm::Function* getOrCreateInstance(const FunctionInstance& instance);
+    void compileInstance(const FunctionInstance& instance);
+    void declareLocals(const FunctionInstance& instance);
+
     // Type helpers
     llvm::Type* getLLVMType(const std::string& typeName);
-    llvm::Type* getLLVMType(pulse::parser::Expression* expr);
-    
+    llvm::Type* getLLVMType(ValueType type);
+    ValueType getValueType(llvm::Type* type);
+
+    // Value helpers
+    llvm::Value* toBool(llvm::Value* value);
+    llvm::Value* coerce(llvm::Value* value, llvm::Type* type);
+
+    // Control-flow helpers. Every local lives in an entry-block alloca so that
+    // mem2reg/SROA turn it into SSA registers and loop phis.
+    llvm::AllocaInst* createEntryBlockAlloca(llvm::Type* type, std::string_view name);
+    llvm::AllocaInst* getOrCreateVariable(std::string_view name, llvm::Type* type);
+    bool blockTerminated() const;
+    void markMustProgress(llvm::BranchInst* latch);
+
+    // Backend: target selection, the new-pass-manager pipeline, and output
+    void configureTarget();
+    void optimize();
+    void writeOutput(const std::string& outputFile);
+
     // Utility methods
+    std::map<std::string, ValueType, std::less<>> importedConstantTypes() const;
     void createMainFunction();
+    void createAdapter(llvm::Function* implementation, const FunctionInstance& instance, const std::string& symbol);
+    void compilePendingInstances();
+    void finishModule();
     void setupStandardLibrary();
-    llvm::Function* getOrCreateFunction(const std::string& name, llvm::Type* returnType, 
+    llvm::Function* getOrCreateFunction(const std::string& name, llvm::Type* returnType,
                                        const std::vector<llvm::Type*>& paramTypes);
 };
 
-} // namespace pulse::compiler 
\ No newline at end of file
+} // namespace pulse::compiler
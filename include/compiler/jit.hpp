@@ -0,0 +1,52 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+// Forward declarations
+namespace llvm::orc {
+    class LLLazyJIT;
+}
+
+namespace pulse::compiler {
+
+class Compiler;
+
+// Symbols for perf(1), which sees generated code as anonymous memory
+enum PerfSupport : unsigned {
+    PERF_NONE = 0,
+    PERF_MAP = 1,     // append each function to /tmp/perf-PID.map (perf report, perf top)
+    PERF_JITDUMP = 2, // LLVM's jitdump, for perf record -k 1 and perf inject --jit
+};
+
+// In-process execution through ORC's lazy JIT (pulse run). Modules are handed
+// over already optimized; each function is only lowered to machine code the
+// first time it is called, and stays compiled for the rest of the process.
+// Symbols the modules do not define (printf, libm) come from the host process.
+class JIT {
+public:
+    // optLevel 0-3 selects the code generator level, like -O for objects;
+    // perf is a set of PerfSupport flags
+    explicit JIT(unsigned optLevel = 2, unsigned perf = PERF_NONE);
+    ~JIT();
+
+    JIT(const JIT&) = delete;
+    JIT& operator=(const JIT&) = delete;
+
+    // Take over the compiler's module; several modules may be added and call
+    // each other's exported functions. The compiler cannot be used afterwards.
+    void addModule(Compiler& compiler);
+
+    // Take over the compiler's module and generate its code now, on this
+    // thread, instead of on first call; returns the address of symbol.
+    // Tiered execution does this on its compile thread.
+    uint64_t addModuleNow(Compiler& compiler, const std::string& symbol);
+
+    // Call the int32() entry function and return its result
+    int run(const std::string& entryPoint = "main");
+
+private:
+    std::unique_ptr<llvm::orc::LLLazyJIT> jit;
+};
+
+} // namespace pulse::compiler
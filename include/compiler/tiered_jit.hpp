@@ -0,0 +1,60 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "runtime/tiering.hpp"
+
+namespace pulse::compiler {
+
+class JIT;
+
+// The native tier of `pulse run --interpret` and the REPL: hot functions the
+// bytecode VM reports are specialized by Compiler and generated by the JIT on
+// one background thread, so neither compilation nor code generation ever
+// stalls the interpreter. Requests are handled in order; one that fails
+// (the function does not match the interpreter in native code) is dropped.
+class TieredJIT : public pulse::runtime::NativeTier {
+public:
+    // optLevel 0-3 as for -O; trace reports every specialization on stderr;
+    // perf is a set of PerfSupport flags for the JIT (compiler/jit.hpp)
+    explicit TieredJIT(unsigned optLevel = 2, bool trace = false, unsigned perf = 0);
+    // Finishes the specialization in progress and drops the queued ones
+    ~TieredJIT() override;
+
+    TieredJIT(const TieredJIT&) = delete;
+    TieredJIT& operator=(const TieredJIT&) = delete;
+
+    void request(std::shared_ptr<pulse::runtime::TierProfile> profile, pulse::runtime::Shape shape,
+                 uint64_t generation) override;
+
+private:
+    struct Job {
+        std::shared_ptr<pulse::runtime::TierProfile> profile;
+        pulse::runtime::Shape shape;
+        uint64_t generation;
+    };
+
+    unsigned optLevel;
+    bool trace;
+    unsigned perf;
+
+    // Owned by the compile thread, which creates the JIT with the first job
+    std::unique_ptr<JIT> jit;
+    std::deque<pulse::runtime::NativeCode> code; // stable addresses, published to the profiles
+    uint64_t compiled = 0;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Job> queue;
+    bool stopping = false;
+    std::thread thread;
+
+    void compileLoop();
+    void compile(const Job& job);
+};
+
+} // namespace pulse::compiler
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "parser/ast.hpp"
+
+namespace pulse::compiler {
+
+// Static type of a value in native code. The numeric types form a chain
+// (BOOL < INT < FLOAT) so mixing them widens instead of failing; anything that
+// mixes strings with numbers, or that the pass cannot see through, is DYNAMIC
+// and falls back to the untyped int64 representation.
+enum class ValueType : uint8_t {
+    UNKNOWN, // no assignment seen yet (bottom of the lattice)
+    BOOL,
+    INT,
+    FLOAT,
+    STR,
+    DYNAMIC
+};
+
+const char* typeName(ValueType type);
+
+// Least upper bound of two types
+ValueType join(ValueType a, ValueType b);
+
+using Signature = std::vector<ValueType>;
+
+// One specialization of a function for a tuple of argument types, or the
+// top-level statements of a module (decl == nullptr)
+struct FunctionInstance {
+    pulse::parser::FunctionDeclaration* decl = nullptr;
+    Signature params;
+    ValueType returnType = ValueType::UNKNOWN;
+
+    // Every local of the body (parameters included) with the join of all the
+    // values assigned to it; flow-insensitive, so one slot type per variable
+    std::map<std::string_view, ValueType, std::less<>> locals;
+
+    // LLVM symbol: "name.<one letter per parameter>", e.g. "scale.fi"
+    std::string symbol;
+
+    const pulse::parser::ArenaVector<pulse::parser::StatementPtr>* body = nullptr;
+};
+
+// Local type inference and monomorphization. Types flow from literals through
+// operators, assignments and returns; every call of a user function with a new
+// combination of argument types creates a new instance of it. Instances are
+// solved to a fixed point (types only ever widen), so recursive and mutually
+// recursive functions see their final return types.
+//
+// Instances are created on demand: the compiler asks for the signature it
+// actually has at a call site and gets back a solved instance.
+class TypeInference : private pulse::parser::StaticASTVisitor<TypeInference, ValueType> {
+public:
+    // constants: names other modules export, with their types; a local of
+    // the same name hides one
+    explicit TypeInference(pulse::parser::Program* program,
+                           std::map<std::string, ValueType, std::less<>> constants = {});
+
+    // The top-level statements as a function without parameters
+    const FunctionInstance& entry() const { return *entryInstance; }
+
+    // The function declared under `name` in this module, or null
+    pulse::parser::FunctionDeclaration* findFunction(std::string_view name) const;
+
+    // Specialize decl for the given argument types; the arity must match
+    const FunctionInstance& instantiate(pulse::parser::FunctionDeclaration* decl, const Signature& params);
+
+    // Built-ins that lower to native code without a call (print, int(), ...)
+    static bool isBuiltin(std::string_view name);
+
+    // min(), max() and abs() on numbers, which native code computes without
+    // a call; the type of their result, DYNAMIC where native code has none
+    static bool isNumericBuiltin(std::string_view name);
+    static ValueType numericBuiltinType(std::string_view name, const Signature& arguments);
+
+    // Whether the native code of instance, and of everything it calls, gives
+    // exactly the results the bytecode VM would, so tiered execution may swap
+    // one for the other: numbers only, every local keeping one type, every
+    // path returning a value, no output and no operation that raises in the
+    // VM. Otherwise reason names the first obstacle.
+    bool matchesInterpreter(const FunctionInstance& instance, std::string& reason);
+
+private:
+    friend class pulse::parser::StaticASTVisitor<TypeInference, ValueType>;
+
+    using InstanceKey = std::pair<pulse::parser::FunctionDeclaration*, Signature>;
+
+    std::map<std::string_view, pulse::parser::FunctionDeclaration*, std::less<>> declarations;
+    std::map<std::string, ValueType, std::less<>> importedConstants;
+    std::map<InstanceKey, std::unique_ptr<FunctionInstance>> instances;
+    std::unique_ptr<FunctionInstance> entryInstance;
+
+    // Solver state: instances in creation order, the one being analyzed, and
+    // whether the current sweep widened anything
+    std::vector<FunctionInstance*> worklist;
+    FunctionInstance* current = nullptr;
+    bool changed = false;
+    bool solving = false;
+
+    FunctionInstance& getOrCreate(pulse::parser::FunctionDeclaration* decl, const Signature& params);
+    void solve();
+    void analyze(FunctionInstance& instance);
+    void analyzeBlock(const pulse::parser::ArenaVector<pulse::parser::StatementPtr>& body);
+    ValueType infer(pulse::parser::Expression* expr);
+    void assign(std::string_view name, ValueType type);
+    bool isRangeCall(pulse::parser::Expression* expr) const;
+
+    // matchesInterpreter, with the instances already checked or in progress
+    struct ParityCheck {
+        std::set<const FunctionInstance*> visited;
+        std::string reason;
+    };
+    bool checkInstance(const FunctionInstance& instance, ParityCheck& check);
+    bool checkBlock(const pulse::parser::ArenaVector<pulse::parser::StatementPtr>& body, ParityCheck& check);
+    bool checkStatement(pulse::parser::Statement* stmt, ParityCheck& check);
+    // condition: only the truth value is used, so `and`/`or` may yield bools
+    bool checkExpression(pulse::parser::Expression* expr, ParityCheck& check, bool condition = false);
+
+    // Expressions
+    ValueType visitLiteralExpression(pulse::parser::LiteralExpression* expr);
+    ValueType visitIdentifierExpression(pulse::parser::IdentifierExpression* expr);
+    ValueType visitBinaryExpression(pulse::parser::BinaryExpression* expr);
+    ValueType visitUnaryExpression(pulse::parser::UnaryExpression* expr);
+    ValueType visitCallExpression(pulse::parser::CallExpression* expr);
+
+    // Statements
+    ValueType visitAssignmentStatement(pulse::parser::AssignmentStatement* stmt);
+    ValueType visitExpressionStatement(pulse::parser::ExpressionStatement* stmt);
+    ValueType visitReturnStatement(pulse::parser::ReturnStatement* stmt);
+    ValueType visitIfStatement(pulse::parser::IfStatement* stmt);
+    ValueType visitWhileStatement(pulse::parser::WhileStatement* stmt);
+    ValueType visitForStatement(pulse::parser::ForStatement* stmt);
+    ValueType visitMatchStatement(pulse::parser::MatchStatement* stmt);
+};
+
+} // namespace pulse::compiler
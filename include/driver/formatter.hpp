@@ -0,0 +1,56 @@
+#pragma once
+
+#include "lexer/source_buffer.hpp"
+#include "lexer/token.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace pulse::driver {
+
+// Lines of a file to format, 1-based and inclusive, in order
+using LineRanges = std::vector<std::pair<uint32_t, uint32_t>>;
+
+// Formats from the tokens of lexer::Tokenizer in one pass over them, so it
+// cannot mistake a ':' or '#' in a string for syntax. Each logical line is
+// indented four spaces per block, as the language requires, and its tokens
+// are spaced canonically; comments, line breaks inside brackets and string
+// literals are kept. At most two blank lines are kept in a row.
+//
+// With line ranges only the logical lines touching them are rewritten, and
+// they keep their indentation (which is syntax); everything else is copied.
+// The result is lexed again and must give the same tokens, else format()
+// throws rather than change what the program means.
+class TokenFormatter {
+public:
+    static constexpr size_t INDENT = 4;
+
+    // Throws lexer::LexError if the source does not lex
+    std::string format(const lexer::SourceBufferPtr& source, const LineRanges* ranges = nullptr);
+
+private:
+    // Tokens first .. last (no synthetic ones) and the block depth they sit at
+    struct LogicalLine {
+        size_t first;
+        size_t last;
+        size_t depth;
+    };
+
+    std::string_view text;
+    const lexer::TokenStream* tokens = nullptr;
+    const char* newline = "\n";
+    std::vector<uint32_t> lineStarts;
+    std::vector<lexer::TokenType> brackets;
+
+    // 1-based physical line of a byte offset
+    uint32_t lineOf(size_t offset) const;
+    std::vector<LogicalLine> logicalLines(const lexer::TokenStream& stream) const;
+    bool spaced(const lexer::Token& previous, bool previousUnary, const lexer::Token& next) const;
+    void emit(std::string& out, const LogicalLine& line, size_t indent, bool keepBreaks);
+    void verify(const lexer::TokenStream& before, const std::string& formatted) const;
+};
+
+} // namespace pulse::driver
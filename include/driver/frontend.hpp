@@ -0,0 +1,52 @@
+#pragma once
+
+#include "lexer/token.hpp"
+#include "parser/ast.hpp"
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace pulse::driver {
+
+struct Diagnostic {
+    std::string file;
+    size_t line = 0;
+    size_t column = 0;
+    std::string message;
+};
+
+std::ostream& operator<<(std::ostream& out, const Diagnostic& diagnostic);
+
+// The diagnostic for an error lexing or parsing file, positioned when it is a
+// LexError or ParseError. Every command reports these through it, the
+// bytecode VM's included.
+Diagnostic diagnose(const std::string& file, const std::exception& error);
+
+// One source file after lexing and parsing. program is null when the file had
+// errors; the token stream is kept for tools that need lexemes or positions.
+struct CompilationUnit {
+    std::string path;
+    lexer::TokenStream tokens;
+    std::unique_ptr<parser::Program> program;
+    std::vector<Diagnostic> diagnostics;
+
+    bool ok() const { return program != nullptr && diagnostics.empty(); }
+};
+
+// Expand the command-line inputs into a sorted, de-duplicated list of .pul
+// files. Directories are searched recursively; for a project directory (one
+// with pulse.toml and src/) only src/ is searched. build/ and dot-directories
+// are skipped.
+std::vector<std::string> collectSources(const std::vector<std::string>& inputs);
+
+// Lex and parse every file on a work-stealing pool of `jobs` threads (0: one
+// per core). Units come back in the order of `paths`, independent of which
+// thread finished first.
+std::vector<CompilationUnit> parseFiles(const std::vector<std::string>& paths, size_t jobs = 0);
+
+// All diagnostics in a deterministic order: by input order, then position
+std::vector<Diagnostic> collectDiagnostics(const std::vector<CompilationUnit>& units);
+
+} // namespace pulse::driver
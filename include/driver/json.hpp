@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace pulse::driver {
+
+// JSON value for the messages of pulsed and its clients. Objects keep their
+// keys in insertion order and are searched linearly: messages are small.
+class Json {
+public:
+    enum class Type { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT };
+
+    using Array = std::vector<Json>;
+    using Object = std::vector<std::pair<std::string, Json>>;
+
+    Json() = default;
+    Json(std::nullptr_t) {}
+    Json(bool value) : type(Type::BOOL), boolean(value) {}
+    Json(double value) : type(Type::NUMBER), number(value) {}
+    template <typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+    Json(T value) : type(Type::NUMBER), number(static_cast<double>(value)) {}
+    Json(const char* value) : type(Type::STRING), string(value) {}
+    Json(std::string_view value) : type(Type::STRING), string(value) {}
+    Json(std::string value) : type(Type::STRING), string(std::move(value)) {}
+    Json(Array value) : type(Type::ARRAY), array(std::move(value)) {}
+    Json(Object value) : type(Type::OBJECT), object(std::move(value)) {}
+
+    // Throws std::runtime_error on malformed input
+    static Json parse(std::string_view text);
+    std::string dump() const;
+
+    Type getType() const { return type; }
+    bool isNull() const { return type == Type::NUL; }
+    bool isNumber() const { return type == Type::NUMBER; }
+    bool isString() const { return type == Type::STRING; }
+    bool isArray() const { return type == Type::ARRAY; }
+    bool isObject() const { return type == Type::OBJECT; }
+
+    // The value, or the fallback when it is of another type
+    bool asBool(bool fallback = false) const { return type == Type::BOOL ? boolean : fallback; }
+    double asNumber(double fallback = 0) const { return type == Type::NUMBER ? number : fallback; }
+    int64_t asInt(int64_t fallback = 0) const {
+        return type == Type::NUMBER ? static_cast<int64_t>(number) : fallback;
+    }
+    const std::string& asString() const;
+
+    // Members of an object (null when missing) and elements of an array
+    // (null when out of range); the non-const forms add object members
+    const Json& operator[](std::string_view key) const;
+    Json& operator[](std::string_view key);
+    const Json& operator[](size_t index) const;
+    bool contains(std::string_view key) const;
+    size_t size() const { return type == Type::ARRAY ? array.size() : type == Type::OBJECT ? object.size() : 0; }
+
+    const Array& items() const { return array; }
+    const Object& members() const { return object; }
+    void push(Json value);
+
+private:
+    Type type = Type::NUL;
+    bool boolean = false;
+    double number = 0;
+    std::string string;
+    Array array;
+    Object object;
+
+    void dump(std::string& out) const;
+};
+
+} // namespace pulse::driver
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "lexer/source_buffer.hpp"
+#include "parser/ast.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pulse::driver {
+
+// What a module exports to the modules that import it: its functions (native
+// code calls them through an int64 ABI, so the parameters are their whole
+// signature), its classes, and its constants, the top-level names bound
+// exactly once and to a literal.
+struct ModuleInterface {
+    struct Function {
+        std::string name;
+        std::vector<std::string> parameters;
+    };
+
+    struct Class {
+        std::string name;
+        std::string base;
+        std::vector<Function> methods;
+    };
+
+    enum class ConstantType : uint32_t { INT, FLOAT, BOOL, STR };
+
+    struct Constant {
+        std::string name;
+        ConstantType type = ConstantType::INT;
+        int64_t intValue = 0;  // INT and BOOL
+        double floatValue = 0;
+        std::string text;      // STR
+    };
+
+    std::string module;      // dotted name, as imported
+    uint64_t sourceHash = 0; // of the source it was extracted from
+    std::vector<Function> functions; // each list sorted by name
+    std::vector<Class> classes;
+    std::vector<Constant> constants;
+
+    static ModuleInterface extract(const parser::Program& program, std::string module, uint64_t source_hash);
+};
+
+// Hash of a module's source that its .pulc is valid for; covers the .pulc
+// format version too
+uint64_t hashInterfaceSource(std::string_view source);
+
+// A .pulc file, memory-mapped and read in place: a header, fixed-size
+// records sorted by name (looked up by binary search) and a string table.
+class InterfaceFile {
+public:
+    // Null if the file is missing, damaged, of another format version or
+    // not made from the source with source_hash
+    static std::unique_ptr<InterfaceFile> open(const std::filesystem::path& path, uint64_t source_hash);
+
+    // The .pulc of interface, held in memory
+    static std::unique_ptr<InterfaceFile> fromInterface(const ModuleInterface& interface);
+
+    // Writes interface to path through a temporary renamed over it; throws
+    // std::runtime_error if it cannot
+    static void write(const ModuleInterface& interface, const std::filesystem::path& path);
+
+    std::string_view module() const;
+
+    // Parameter count of an exported function, or -1 if there is none
+    int functionArity(std::string_view name) const;
+    bool hasClass(std::string_view name) const;
+    bool findConstant(std::string_view name, ModuleInterface::Constant& constant) const;
+
+    // Everything, copied out of the mapping
+    ModuleInterface load() const;
+
+private:
+    struct Table {
+        size_t offset = 0; // of the first record
+        uint32_t count = 0;
+    };
+
+    lexer::SourceBufferPtr bytes;
+    Table functions, classes, constants, methods, parameters;
+    size_t strings = 0;
+    uint32_t stringBytes = 0;
+    uint32_t moduleName = 0;
+
+    explicit InterfaceFile(lexer::SourceBufferPtr bytes) : bytes(std::move(bytes)) {}
+
+    static std::string serialize(const ModuleInterface& interface);
+    bool validate();
+    const char* data() const { return bytes->text().data(); }
+    bool validString(uint32_t offset) const;
+    std::string_view string(uint32_t offset) const;
+    // Record of table named name, by binary search; null if there is none
+    const char* find(const Table& table, size_t record_size, std::string_view name) const;
+    ModuleInterface::Function function(const char* record) const;
+};
+
+// The file `import a.b` names: a/b.pul next to the importing file, else in
+// the .pulse/libs of the project around it, else in ~/.pulse/libs. Empty if
+// there is none: a module the runtime provides (std.io, time), which stays
+// unchecked.
+std::filesystem::path findModule(std::string_view module, const std::filesystem::path& importer);
+
+// The sources findModule() gives for the imports of source, read off its
+// `import` lines without lexing it; for build tools, whose outputs depend
+// on the interfaces of these files
+std::vector<std::filesystem::path> importedSources(const std::filesystem::path& source);
+
+// Interfaces of imported modules. Each .pulc is kept under the hash of the
+// source it describes, in $PULSE_INTERFACE_DIR or ~/.pulse/cache/interfaces,
+// so a module is only lexed and parsed again once its source changed, and
+// checkouts of the same commit share them. Within a process each module is
+// loaded once. Thread-safe.
+class InterfaceCache {
+public:
+    explicit InterfaceCache(std::filesystem::path directory = defaultDirectory());
+
+    static std::filesystem::path defaultDirectory();
+
+    // Throws std::runtime_error if the source cannot be read or does not
+    // parse. parsed, if given, is the source's program, used instead of
+    // parsing it when there is no .pulc yet.
+    std::shared_ptr<const InterfaceFile> load(std::string_view module, const std::filesystem::path& source,
+                                              const parser::Program* parsed = nullptr);
+
+    // Loads so far that found a valid .pulc, and that had to extract one
+    size_t hits() const { return hitCount; }
+    size_t misses() const { return missCount; }
+
+private:
+    std::filesystem::path directory;
+    std::mutex mutex;
+    std::map<std::string, std::shared_ptr<const InterfaceFile>> loaded; // by source path
+    std::atomic<size_t> hitCount{0};
+    std::atomic<size_t> missCount{0};
+};
+
+} // namespace pulse::driver
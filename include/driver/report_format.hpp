@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+
+namespace pulse::driver {
+
+// Byte counts as the reports print them (--time-report, the heap
+// statistics, pulpm's progress): "512 B", "13.9 KiB", "2.0 MiB", up to GiB
+std::string formatBytes(double bytes);
+
+} // namespace pulse::driver
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "driver/json.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace pulse::driver {
+
+// JSON-RPC messages framed as the Language Server Protocol frames them
+// ("Content-Length: N" headers, a blank line, N bytes of JSON), over a pair
+// of file descriptors: the standard streams of pulsed, or a connection to
+// its socket.
+class RpcChannel {
+public:
+    // owned: close the descriptors with the channel
+    RpcChannel(int input, int output, bool owned = false);
+    ~RpcChannel();
+
+    RpcChannel(const RpcChannel&) = delete;
+    RpcChannel& operator=(const RpcChannel&) = delete;
+
+    // Connect to the socket of a running pulsed; throws std::runtime_error
+    // if nothing listens there
+    static std::unique_ptr<RpcChannel> connect(const std::string& path);
+
+    // The next message, false at the end of the input; throws
+    // std::runtime_error on a malformed frame or message
+    bool read(Json& message);
+    // Safe to call from several threads
+    void write(const Json& message);
+
+    // Send a request and wait for its response: the result, or a
+    // std::runtime_error with the error's message
+    Json call(const std::string& method, Json params);
+
+private:
+    int input;
+    int output;
+    bool owned;
+    std::string buffer; // read but not yet consumed
+    std::mutex writing;
+    int64_t nextId = 1;
+
+    // More input into buffer; false at its end
+    bool fill();
+};
+
+// Where pulsed listens for a project: $PULSE_DAEMON_SOCKET, else
+// build/pulsed.sock in the project directory
+std::string daemonSocketPath(const std::filesystem::path& project);
+
+} // namespace pulse::driver
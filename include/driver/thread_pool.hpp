@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pulse::driver {
+
+// Fixed-size work-stealing pool. Every worker owns a deque: it pushes and pops
+// its own work at the back (LIFO, cache-warm) and idle workers steal from the
+// front of the others. Tasks submitted from outside the pool are dealt out
+// round-robin. Exceptions thrown by a task are captured and rethrown by wait().
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    // threads == 0 uses one worker per hardware thread
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(Task task);
+
+    // Block until every submitted task has finished; rethrows the first failure.
+    // A task of this pool may call it too (fork-join): its worker then runs
+    // queued tasks until all but the tasks blocked in wait() have finished,
+    // so the pool cannot deadlock on workers that wait for each other.
+    void wait();
+
+    size_t size() const { return workers.size(); }
+
+    static size_t defaultThreadCount();
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::atomic<size_t> queued{0};
+    std::atomic<size_t> pending{0};
+    std::atomic<size_t> next_queue{0};
+    size_t waiting = 0; // tasks blocked in wait(); pending counts them too
+    bool stopping = false;
+    std::exception_ptr failure;
+
+    void run(size_t index);
+    void execute(Task& task);
+    void help(size_t index, std::unique_lock<std::mutex>& lock);
+    bool popLocal(size_t index, Task& task);
+    bool steal(size_t index, Task& task);
+};
+
+} // namespace pulse::driver
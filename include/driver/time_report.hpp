@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace pulse::driver {
+
+// Memory the calling thread allocated through operator new since
+// TimeReport::enable. The pulse driver replaces operator new to count it
+// (src/driver/allocation_hooks.cpp); in other programs every counter stays
+// at zero. live and peak are in usable bytes and stay at zero where the C
+// library cannot tell a block's size.
+struct AllocationCounters {
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0; // as requested
+    // May go negative: blocks freed by another thread, or allocated before
+    // counting started; phases measure their peak above their own start
+    int64_t live = 0;
+    int64_t peak = 0;
+};
+
+const AllocationCounters& threadAllocations();
+
+// For the replaced operator new and delete: a relaxed load and nothing else
+// until TimeReport::enable
+void countAllocation(void* block, size_t size);
+void countRelease(void* block);
+
+// --time-report: wall and CPU time, allocations and peak memory of each
+// compiler phase (tokenize, parse, type inference, IR generation, each LLVM
+// pass and analysis, emission). Phases are measured on the thread that runs
+// them and summed over all runs, so the phases of files compiled in
+// parallel add up to more than the elapsed time. A phase named "a/b" is
+// part of phase a and included in its figures.
+//
+// One report per process; Scope does nothing until it is enabled.
+class TimeReport {
+public:
+    struct Phase {
+        std::string name;
+        uint64_t count = 0; // runs
+        std::chrono::nanoseconds wall{0};
+        std::chrono::nanoseconds cpu{0};
+        uint64_t allocations = 0;
+        uint64_t allocatedBytes = 0;
+        uint64_t peakBytes = 0; // highest live memory above the phase's start, over its runs
+    };
+
+    // Measures the enclosing block as one run of a phase
+    class Scope {
+    public:
+        explicit Scope(std::string name);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        bool active;
+        std::string name;
+        std::chrono::steady_clock::time_point wall;
+        std::chrono::nanoseconds cpu;
+        AllocationCounters allocations;
+        int64_t outerPeak;
+    };
+
+    static TimeReport& get();
+
+    void enable();
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    // The phases so far: by first run, each followed by its parts, slowest first
+    std::vector<Phase> getPhases() const;
+    // Table with one "time-report:" line per phase, for stderr
+    std::string text() const;
+    // {"wall_ns": ..., "phases": [{"name": ..., "count": ..., ...}]}
+    std::string json() const;
+
+private:
+    std::atomic<bool> enabled{false};
+    std::chrono::steady_clock::time_point started;
+    mutable std::mutex mutex;
+    std::vector<Phase> phases;
+    std::map<std::string, size_t> index;
+
+    TimeReport() = default;
+    void add(const Phase& run);
+};
+
+} // namespace pulse::driver
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "driver/frontend.hpp"
+#include "lexer/source_buffer.hpp"
+#include "lexer/token.hpp"
+#include "parser/ast.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace pulse::driver {
+
+// A place in a document as editors count: 0-based line, byte column
+struct Position {
+    uint32_t line = 0;
+    uint32_t column = 0;
+};
+
+// A name a document binds, read off its tokens
+struct Symbol {
+    enum class Kind { FUNCTION, METHOD, CLASS, VARIABLE, PARAMETER, MODULE };
+
+    std::string name;
+    Kind kind = Kind::VARIABLE;
+    Position position;     // of the name
+    std::string container; // class of a method or attribute, function of a local
+    // Parameters and the names a function binds are seen on its lines only
+    bool local = false;
+    uint32_t scopeStart = 0;
+    uint32_t scopeEnd = 0;
+    std::string module; // MODULE: the dotted name imported
+};
+
+// A source file kept lexed and parsed in memory, for pulsed. It is held as
+// chunks, one per top-level statement (a function, a class, a line of
+// module code) with the comments and blank lines after it, each with its
+// own tokens, AST, diagnostics and symbols. An edit lexes and parses only
+// the chunks it touches, and merges one with those after it while it ends
+// inside a string or brackets; the other chunks just move down or up.
+class Document {
+public:
+    Document(std::string path, std::string_view text);
+
+    const std::string& getPath() const { return path; }
+    std::string text() const;
+    // Lines as an editor shows them: a final line break starts an empty line
+    uint32_t lineCount() const;
+    // Without its line break
+    std::string_view line(uint32_t index) const;
+    // Byte offset of a position (clamped into the text) and the reverse
+    size_t offsetOf(Position position) const;
+    Position positionOf(size_t offset) const;
+
+    // Replace the text between start and end
+    void edit(Position start, Position end, std::string_view replacement);
+    // Replace all of it; only what lies between the first and the last changed byte is parsed again
+    void setText(std::string_view text);
+
+    // Lines 1-based, as the compiler reports them
+    std::vector<Diagnostic> diagnostics() const;
+    std::vector<Symbol> symbols() const;
+    // Dotted names of the modules imported
+    std::vector<std::string> imports() const;
+
+    // The identifier at position (or just before it); attribute if it follows a '.'
+    bool identifierAt(Position position, std::string& name, bool& attribute) const;
+    // Symbols named name seen at position: the locals, innermost first, then the globals
+    std::vector<Symbol> lookup(std::string_view name, Position position) const;
+
+    size_t chunkCount() const { return chunks.size(); }
+    // Chunks lexed and parsed by the last change
+    size_t lastReparsed() const { return reparsed; }
+
+private:
+    struct Chunk {
+        lexer::SourceBufferPtr source;   // its lines, each with its line break
+        lexer::TokenStream tokens;
+        std::unique_ptr<parser::Program> program; // null when it has errors
+        uint32_t line = 0;                // first line in the document
+        std::vector<uint32_t> lineStarts; // offsets in source
+        std::vector<Diagnostic> diagnostics; // lines relative to the chunk
+        std::vector<Symbol> symbols;         // lines relative to the chunk
+
+        std::string_view text() const { return source->text(); }
+        uint32_t lines() const { return static_cast<uint32_t>(lineStarts.size()); }
+    };
+
+    std::string path;
+    std::vector<Chunk> chunks;
+    size_t reparsed = 0;
+
+    Chunk analyze(std::string text) const;
+    // Chunks of text, which starts on line; takes in chunks[next...] while the last one is open
+    std::vector<Chunk> split(std::string_view text, uint32_t line, size_t& next);
+    // Chunk holding a position and the offset in it
+    std::pair<size_t, size_t> locate(Position position) const;
+    size_t chunkAtLine(uint32_t line) const;
+};
+
+// A position in a file
+struct Location {
+    std::string path;
+    Position position;
+};
+
+// The documents pulsed holds: those open in an editor, with the editor's
+// text, and files as they are on disk, for builds and for imports, read
+// again when their size or modification time changed. Paths are made
+// absolute. Not thread-safe.
+class Workspace {
+public:
+    Document& open(const std::string& path, std::string_view text);
+    void close(const std::string& path);
+    // An open document, else null
+    Document* find(const std::string& path);
+    // The file as on disk; throws std::runtime_error if it cannot be read
+    const Document& load(const std::string& path);
+
+    // Where the identifier at position is bound: in the document, else
+    // among the top-level names of the modules it imports
+    std::optional<Location> definition(const std::string& path, Position position);
+
+    // Diagnostics of the files as on disk, parsed again where they changed
+    // (on `jobs` threads, 0: one per core), in the order of paths
+    std::vector<Diagnostic> check(const std::vector<std::string>& paths, size_t jobs, size_t& reparsed);
+
+    static std::string normalize(const std::string& path);
+
+private:
+    struct DiskFile {
+        std::unique_ptr<Document> document;
+        std::filesystem::file_time_type modified;
+        uintmax_t size = 0;
+    };
+
+    std::map<std::string, std::unique_ptr<Document>> opened;
+    std::map<std::string, DiskFile> files;
+
+    // Throws std::runtime_error if the file cannot be read
+    static size_t refresh(const std::string& path, DiskFile& file);
+    // The open document, else the file as on disk
+    const Document* source(const std::string& path);
+};
+
+} // namespace pulse::driver
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if !defined(PULSE_LEXER_NO_SIMD)
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define PULSE_LEXER_SSE2 1
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PULSE_LEXER_AVX2 1
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PULSE_LEXER_NEON 1
+#endif
+#endif
+
+namespace pulse::lexer {
+
+// Character classes used by the lexer hot loops. Unlike <cctype> this does not
+// depend on the current locale, and bytes >= 0x80 are never letters or digits.
+enum CharClass : uint8_t {
+    CHAR_SPACE = 1 << 0,       // ' ', \t, \r, \v, \f (newline is significant)
+    CHAR_DIGIT = 1 << 1,       // 0-9
+    CHAR_IDENT_START = 1 << 2, // A-Z a-z _
+    CHAR_IDENT = 1 << 3,       // identifier start or digit
+};
+
+constexpr std::array<uint8_t, 256> makeCharClassTable() {
+    std::array<uint8_t, 256> table{};
+    for (int c : {' ', '\t', '\r', '\v', '\f'}) {
+        table[c] |= CHAR_SPACE;
+    }
+    for (int c = '0'; c <= '9'; c++) {
+        table[c] |= CHAR_DIGIT | CHAR_IDENT;
+    }
+    for (int c = 'a'; c <= 'z'; c++) {
+        table[c] |= CHAR_IDENT_START | CHAR_IDENT;
+        table[c - 'a' + 'A'] |= CHAR_IDENT_START | CHAR_IDENT;
+    }
+    table['_'] |= CHAR_IDENT_START | CHAR_IDENT;
+    return table;
+}
+
+inline constexpr std::array<uint8_t, 256> CHAR_CLASS = makeCharClassTable();
+
+constexpr bool hasClass(char c, uint8_t mask) {
+    return (CHAR_CLASS[static_cast<unsigned char>(c)] & mask) != 0;
+}
+
+constexpr bool isSpace(char c) { return hasClass(c, CHAR_SPACE); }
+constexpr bool isDigit(char c) { return hasClass(c, CHAR_DIGIT); }
+constexpr bool isIdentStart(char c) { return hasClass(c, CHAR_IDENT_START); }
+constexpr bool isIdent(char c) { return hasClass(c, CHAR_IDENT); }
+
+// Bulk scanners. Each returns a pointer to the first byte in [p, end) that stops
+// the run, or end. None of them ever reads past end: vector loops only run while
+// a full block is available and the tail is finished with the table.
+namespace scan {
+
+#if defined(PULSE_LEXER_SSE2)
+// Bit i of the result is set when byte i of the block is an identifier character
+inline uint32_t identMask16(__m128i block) {
+    const __m128i lower = _mm_or_si128(block, _mm_set1_epi8(0x20));
+    // Signed compares: bytes >= 0x80 are negative and fall outside every range
+    const __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                        _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+    const __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('0' - 1)),
+                                        _mm_cmplt_epi8(block, _mm_set1_epi8('9' + 1)));
+    const __m128i under = _mm_cmpeq_epi8(block, _mm_set1_epi8('_'));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), under)));
+}
+#endif
+
+#if defined(PULSE_LEXER_NEON)
+// Collapse a 0x00/0xFF byte mask to a 64-bit value with four bits per byte
+inline uint64_t neonMask(uint8x16_t mask) {
+    const uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(mask), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+#endif
+
+// Identifier continuation characters [A-Za-z0-9_]
+inline const char* identifierEnd(const char* p, const char* end) {
+#if defined(PULSE_LEXER_SSE2)
+    while (end - p >= 16) {
+        uint32_t stop = ~identMask16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) & 0xFFFF;
+        if (stop) return p + __builtin_ctz(stop);
+        p += 16;
+    }
+#elif defined(PULSE_LEXER_NEON)
+    while (end - p >= 16) {
+        const uint8x16_t block = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+        const uint8x16_t lower = vorrq_u8(block, vdupq_n_u8(0x20));
+        const uint8x16_t alpha = vcleq_u8(vsubq_u8(lower, vdupq_n_u8('a')), vdupq_n_u8('z' - 'a'));
+        const uint8x16_t digit = vcleq_u8(vsubq_u8(block, vdupq_n_u8('0')), vdupq_n_u8(9));
+        const uint8x16_t under = vceqq_u8(block, vdupq_n_u8('_'));
+        uint64_t stop = ~neonMask(vorrq_u8(vorrq_u8(alpha, digit), under));
+        if (stop) return p + (__builtin_ctzll(stop) >> 2);
+        p += 16;
+    }
+#endif
+    while (p < end && isIdent(*p)) p++;
+    return p;
+}
+
+// Horizontal whitespace (spaces and tabs; the rare \r\v\f go through the table)
+inline const char* whitespaceEnd(const char* p, const char* end) {
+    // Most runs are a single space between tokens; don't pay for a vector load
+    if (p < end && *p == ' ' && (p + 1 >= end || !isSpace(p[1]))) return p + 1;
+#if defined(PULSE_LEXER_SSE2)
+    while (end - p >= 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i blank = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')),
+                                           _mm_cmpeq_epi8(block, _mm_set1_epi8('\t')));
+        uint32_t stop = ~static_cast<uint32_t>(_mm_movemask_epi8(blank)) & 0xFFFF;
+        if (stop) {
+            p += __builtin_ctz(stop);
+            break;
+        }
+        p += 16;
+    }
+#elif defined(PULSE_LEXER_NEON)
+    while (end - p >= 16) {
+        const uint8x16_t block = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+        const uint8x16_t blank = vorrq_u8(vceqq_u8(block, vdupq_n_u8(' ')), vceqq_u8(block, vdupq_n_u8('\t')));
+        uint64_t stop = ~neonMask(blank);
+        if (stop) {
+            p += __builtin_ctzll(stop) >> 2;
+            break;
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && isSpace(*p)) p++;
+    return p;
+}
+
+// First occurrence of any of a, b, c (comment bodies: '\n'; strings: quote, '\\', '\n')
+inline const char* findAny(const char* p, const char* end, char a, char b, char c) {
+#if defined(PULSE_LEXER_AVX2)
+    const __m256i va = _mm256_set1_epi8(a), vb = _mm256_set1_epi8(b), vc = _mm256_set1_epi8(c);
+    while (end - p >= 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, va), _mm256_cmpeq_epi8(block, vb)),
+                                            _mm256_cmpeq_epi8(block, vc));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+#endif
+#if defined(PULSE_LEXER_SSE2)
+    const __m128i sa = _mm_set1_epi8(a), sb = _mm_set1_epi8(b), sc = _mm_set1_epi8(c);
+    while (end - p >= 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, sa), _mm_cmpeq_epi8(block, sb)),
+                                         _mm_cmpeq_epi8(block, sc));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hit));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+#elif defined(PULSE_LEXER_NEON)
+    const uint8x16_t na = vdupq_n_u8(static_cast<uint8_t>(a));
+    const uint8x16_t nb = vdupq_n_u8(static_cast<uint8_t>(b));
+    const uint8x16_t nc = vdupq_n_u8(static_cast<uint8_t>(c));
+    while (end - p >= 16) {
+        const uint8x16_t block = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+        const uint8x16_t hit = vorrq_u8(vorrq_u8(vceqq_u8(block, na), vceqq_u8(block, nb)), vceqq_u8(block, nc));
+        uint64_t mask = neonMask(hit);
+        if (mask) return p + (__builtin_ctzll(mask) >> 2);
+        p += 16;
+    }
+#endif
+    while (p < end && *p != a && *p != b && *p != c) p++;
+    return p;
+}
+
+inline const char* lineEnd(const char* p, const char* end) {
+    return findAny(p, end, '\n', '\n', '\n');
+}
+
+} // namespace scan
+
+} // namespace pulse::lexer
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "lexer/token.hpp"
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace pulse::lexer {
+
+// Reserved words, including the literal names True/False/None
+struct Keyword {
+    std::string_view text;
+    TokenType type;
+};
+
+inline constexpr Keyword KEYWORDS[] = {
+    {"if", TokenType::IF},         {"elif", TokenType::ELIF},     {"else", TokenType::ELSE},
+    {"while", TokenType::WHILE},   {"for", TokenType::FOR},       {"in", TokenType::IN},
+    {"def", TokenType::DEF},       {"class", TokenType::CLASS},   {"return", TokenType::RETURN},
+    {"import", TokenType::IMPORT}, {"as", TokenType::AS},         {"match", TokenType::MATCH},
+    {"async", TokenType::ASYNC},   {"await", TokenType::AWAIT},   {"and", TokenType::AND},
+    {"or", TokenType::OR},         {"not", TokenType::NOT},       {"True", TokenType::BOOLEAN},
+    {"False", TokenType::BOOLEAN}, {"None", TokenType::NONE},
+};
+
+// Perfect hash over (length, first, second, last character). The multiplier is
+// searched for at compile time; adding a keyword that breaks perfection fails
+// the build instead of silently slowing lookups down.
+namespace keyword_hash {
+
+inline constexpr size_t TABLE_SIZE = 64;
+inline constexpr size_t MIN_LENGTH = 2;
+inline constexpr size_t MAX_LENGTH = 6;
+
+constexpr uint32_t hash(std::string_view text, uint32_t seed) {
+    uint32_t h = static_cast<uint32_t>(text.size());
+    h = h * seed + static_cast<unsigned char>(text[0]);
+    h = h * seed + static_cast<unsigned char>(text[1]);
+    h = h * seed + static_cast<unsigned char>(text[text.size() - 1]);
+    return (h ^ (h >> 7)) & (TABLE_SIZE - 1);
+}
+
+constexpr bool lengthsInRange() {
+    for (const Keyword& keyword : KEYWORDS) {
+        if (keyword.text.size() < MIN_LENGTH || keyword.text.size() > MAX_LENGTH) return false;
+    }
+    return true;
+}
+static_assert(lengthsInRange(), "keyword outside [MIN_LENGTH, MAX_LENGTH]");
+
+constexpr bool isPerfect(uint32_t seed) {
+    std::array<bool, TABLE_SIZE> used{};
+    for (const Keyword& keyword : KEYWORDS) {
+        uint32_t slot = hash(keyword.text, seed);
+        if (used[slot]) return false;
+        used[slot] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t findSeed() {
+    for (uint32_t seed = 1; seed < 100000; seed++) {
+        if (isPerfect(seed)) return seed;
+    }
+    return 0;
+}
+
+inline constexpr uint32_t SEED = findSeed();
+static_assert(SEED != 0, "no perfect hash seed for the keyword set; grow TABLE_SIZE");
+
+constexpr std::array<Keyword, TABLE_SIZE> buildTable() {
+    std::array<Keyword, TABLE_SIZE> table{};
+    for (auto& slot : table) {
+        slot = Keyword{{}, TokenType::IDENTIFIER};
+    }
+    for (const Keyword& keyword : KEYWORDS) {
+        table[hash(keyword.text, SEED)] = keyword;
+    }
+    return table;
+}
+
+inline constexpr std::array<Keyword, TABLE_SIZE> TABLE = buildTable();
+
+} // namespace keyword_hash
+
+// Map an identifier to its keyword token type, or IDENTIFIER. One hash and at
+// most one short compare; no allocation.
+constexpr TokenType lookupKeyword(std::string_view text) {
+    if (text.size() < keyword_hash::MIN_LENGTH || text.size() > keyword_hash::MAX_LENGTH) {
+        return TokenType::IDENTIFIER;
+    }
+    const Keyword& entry = keyword_hash::TABLE[keyword_hash::hash(text, keyword_hash::SEED)];
+    return entry.text == text ? entry.type : TokenType::IDENTIFIER;
+}
+
+static_assert(lookupKeyword("while") == TokenType::WHILE);
+static_assert(lookupKeyword("None") == TokenType::NONE);
+static_assert(lookupKeyword("whale") == TokenType::IDENTIFIER);
+
+} // namespace pulse::lexer
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace pulse::lexer {
+
+class SourceBuffer;
+using SourceBufferPtr = std::shared_ptr<const SourceBuffer>;
+
+// Immutable view of a source file's bytes. Regular files are memory-mapped so the
+// tokenizer reads straight from the page cache; pipes, terminals and other
+// non-mappable inputs fall back to a buffered read into an owned string.
+class SourceBuffer {
+public:
+    ~SourceBuffer();
+
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+    // Load a file, memory-mapping it when possible. "-" reads standard input.
+    static SourceBufferPtr fromFile(const std::string& path);
+
+    // Wrap an in-memory string (takes ownership)
+    static SourceBufferPtr fromString(std::string text, const std::string& name = "<string>");
+
+    // Read a stream to completion in fixed-size chunks
+    static SourceBufferPtr fromStream(std::istream& stream, const std::string& name = "<stream>");
+
+    std::string_view text() const { return std::string_view(data, length); }
+    size_t size() const { return length; }
+    const std::string& getName() const { return name; }
+    bool isMapped() const { return mapped; }
+
+private:
+    SourceBuffer() = default;
+
+    static SourceBufferPtr fromDescriptor(int fd, const std::string& name);
+
+    std::string name;
+    std::string owned;          // backing storage when not memory-mapped
+    const char* data = "";
+    size_t length = 0;
+    bool mapped = false;
+};
+
+} // namespace pulse::lexer
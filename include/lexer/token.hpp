@@ -1,8 +1,14 @@
 #pragma once
 
+#include "lexer/source_buffer.hpp"
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <variant>
-#include <optional>
+#include <vector>
 
 namespace pulse::lexer {
 
@@ -77,53 +83,77 @@ enum class TokenType {
     COMMENT
 };
 
+// Literal payload of a token. String literals are views into the source buffer,
+// so they stay valid for as long as the owning TokenStream is alive.
+using LiteralValue = std::variant<std::string_view, int64_t, double, bool, std::monostate>;
+
+// Compact token: a trivially copyable view into the tokenizer's source buffer.
+// Building one never allocates; the lexeme is recovered through the TokenStream.
 struct Token {
-    TokenType type;
-    std::string lexeme;
-    std::variant<std::string, int64_t, double, bool, std::monostate> value;
-    size_t line;
-    size_t column;
-    
-    Token(TokenType type, const std::string& lexeme, size_t line, size_t column)
-        : type(type), lexeme(lexeme), value(std::monostate{}), line(line), column(column) {}
-    
-    Token(TokenType type, const std::string& lexeme, const std::string& value, size_t line, size_t column)
-        : type(type), lexeme(lexeme), value(value), line(line), column(column) {}
+    static constexpr uint32_t NO_LITERAL = UINT32_MAX;
     
-    Token(TokenType type, const std::string& lexeme, int64_t value, size_t line, size_t column)
-        : type(type), lexeme(lexeme), value(value), line(line), column(column) {}
-    
-    Token(TokenType type, const std::string& lexeme, double value, size_t line, size_t column)
-        : type(type), lexeme(lexeme), value(value), line(line), column(column) {}
+    TokenType type;
+    uint32_t offset;    // byte offset of the lexeme in the source
+    uint32_t length;    // byte length of the lexeme
+    uint32_t line;
+    uint32_t column;
+    uint32_t literal;   // index into TokenStream::literals, or NO_LITERAL
     
-    Token(TokenType type, const std::string& lexeme, bool value, size_t line, size_t column)
-        : type(type), lexeme(lexeme), value(value), line(line), column(column) {}
+    bool hasLiteral() const { return literal != NO_LITERAL; }
+};
+
+static_assert(std::is_trivially_copyable_v<Token>, "Token must stay a POD");
+
+// Token stream produced by Tokenizer::tokenize(). Owns the literal side table and
+// keeps the source buffer alive so lexemes and string literals can be borrowed.
+class TokenStream {
+public:
+    TokenStream() = default;
+    TokenStream(SourceBufferPtr source, std::vector<Token> tokens,
+                std::vector<LiteralValue> literals)
+        : source(std::move(source)), tokens(std::move(tokens)), literals(std::move(literals)) {}
+    
+    // Container access
+    size_t size() const { return tokens.size(); }
+    bool empty() const { return tokens.empty(); }
+    const Token& operator[](size_t index) const { return tokens[index]; }
+    const Token& back() const { return tokens.back(); }
+    std::vector<Token>::const_iterator begin() const { return tokens.begin(); }
+    std::vector<Token>::const_iterator end() const { return tokens.end(); }
+    
+    std::string_view getSource() const { return source->text(); }
+    const SourceBufferPtr& getBuffer() const { return source; }
+    
+    std::string_view lexeme(const Token& token) const {
+        return source->text().substr(token.offset, token.length);
+    }
     
     // Helper methods to get typed values
-    std::optional<std::string> getString() const {
-        if (std::holds_alternative<std::string>(value)) {
-            return std::get<std::string>(value);
-        }
-        return std::nullopt;
+    std::optional<std::string_view> getString(const Token& token) const {
+        return get<std::string_view>(token);
     }
     
-    std::optional<int64_t> getInteger() const {
-        if (std::holds_alternative<int64_t>(value)) {
-            return std::get<int64_t>(value);
-        }
-        return std::nullopt;
+    std::optional<int64_t> getInteger(const Token& token) const {
+        return get<int64_t>(token);
     }
     
-    std::optional<double> getFloat() const {
-        if (std::holds_alternative<double>(value)) {
-            return std::get<double>(value);
-        }
-        return std::nullopt;
+    std::optional<double> getFloat(const Token& token) const {
+        return get<double>(token);
     }
     
-    std::optional<bool> getBoolean() const {
-        if (std::holds_alternative<bool>(value)) {
-            return std::get<bool>(value);
+    std::optional<bool> getBoolean(const Token& token) const {
+        return get<bool>(token);
+    }
+    
+private:
+    SourceBufferPtr source;
+    std::vector<Token> tokens;
+    std::vector<LiteralValue> literals;
+    
+    template <typename T>
+    std::optional<T> get(const Token& token) const {
+        if (token.hasLiteral() && std::holds_alternative<T>(literals[token.literal])) {
+            return std::get<T>(literals[token.literal]);
         }
         return std::nullopt;
     }
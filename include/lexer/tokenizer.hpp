@@ -1,54 +1,85 @@
 #pragma once
 
+#include "lexer/source_buffer.hpp"
 #include "lexer/token.hpp"
-#include <vector>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace pulse::lexer {
 
+// Thrown for malformed input; what() includes the position, message does not
+class LexError : public std::runtime_error {
+public:
+    LexError(const std::string& what, std::string message, size_t line, size_t column)
+        : std::runtime_error(what), message(std::move(message)), line(line), column(column) {}
+
+    std::string message;
+    size_t line;
+    size_t column;
+};
+
 class Tokenizer {
 public:
-    explicit Tokenizer(const std::string& source);
-    
-    // Get the next token from the source
+    explicit Tokenizer(std::string source);
+
+    // Lex directly over a (typically memory-mapped) source buffer without copying it
+    explicit Tokenizer(SourceBufferPtr source);
+
+    // Get the next token from the source, lexing on demand
     Token nextToken();
-    
-    // Tokenize the entire source into a vector of tokens
-    std::vector<Token> tokenize();
-    
+
+    // Append up to max_tokens tokens to out. Returns the number appended; once the
+    // EOF token has been delivered every further call returns 0.
+    size_t tokenizeChunk(std::vector<Token>& out, size_t max_tokens);
+    bool isFinished() const { return finished; }
+
+    // Tokenize the entire source into a compact token stream.
+    // The stream takes over the literal table, so call this at most once.
+    TokenStream tokenize();
+
+    // Lexeme and literal access for tokens returned by nextToken()
+    std::string_view lexeme(const Token& token) const;
+    const LiteralValue* literal(const Token& token) const;
+
 private:
-    std::string source;
+    SourceBufferPtr buffer;
+    std::string_view source;
+    std::vector<LiteralValue> literals;
     size_t current;
     size_t start;
     size_t line;
     size_t column;
+    size_t pending_dedents;
+    size_t paren_depth;
+    bool finished;
     std::vector<size_t> indent_stack;
-    
+
     // Helper methods
     bool isAtEnd() const;
     char advance();
     char peek() const;
     char peekNext() const;
     bool match(char expected);
-    
+    void advanceRun(const char* run_end);
+
     void skipWhitespace();
     void skipComment();
-    
+
     // Token creation helpers
     Token makeToken(TokenType type);
-    Token makeToken(TokenType type, const std::string& value);
-    Token makeToken(TokenType type, int64_t value);
-    Token makeToken(TokenType type, double value);
-    Token makeToken(TokenType type, bool value);
-    
+    Token makeToken(TokenType type, LiteralValue value);
+    Token makeEmptyToken(TokenType type);
+
     // Token parsing methods
     Token string();
     Token number();
     Token identifier();
     Token handleIndentation();
-    
-    // Static keyword mapping
-    static const std::unordered_map<std::string, TokenType> keywords;
+
+    [[noreturn]] void error(const std::string& message) const;
 };
 
-} // namespace pulse::lexer 
\ No newline at end of file
+} // namespace pulse::lexer
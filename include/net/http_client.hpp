@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pulse::net {
+
+// Receives a response body piece by piece as it arrives
+using BodySink = std::function<void(const char* data, size_t size)>;
+
+struct HTTPResponse {
+    int status = 0;
+    std::map<std::string, std::string> headers; // names in lower case
+    std::string body; // empty when the body went to a sink
+
+    bool ok() const { return status >= 200 && status < 300; }
+};
+
+// HTTP/1.1 client for plain http:// URLs (host[:port]/path), used to fetch
+// libraries and by the remote compile cache. Connections are kept alive,
+// one per host and port, and reused by the next request to the same server;
+// one that the server has since closed is reopened transparently. Host names
+// are resolved once per process. Bodies are byte strings, sized by
+// Content-Length, chunked, or delimited by the end of the connection, and
+// can be streamed to a sink in constant memory. GET and HEAD follow up to
+// five redirects. Not thread-safe: use one client per thread.
+class HTTPClient {
+public:
+    HTTPClient();
+    ~HTTPClient();
+
+    HTTPClient(const HTTPClient&) = delete;
+    HTTPClient& operator=(const HTTPClient&) = delete;
+
+    // Throws std::runtime_error if the server cannot be reached or the
+    // response is malformed. With a sink the body is handed to it instead
+    // of collected in HTTPResponse::body.
+    HTTPResponse request(const std::string& method, const std::string& url, const std::string& body = "",
+                         const BodySink& sink = nullptr);
+
+    HTTPResponse get(const std::string& url, const BodySink& sink = nullptr) { return request("GET", url, "", sink); }
+    HTTPResponse put(const std::string& url, const std::string& body) { return request("PUT", url, body); }
+
+    // Streams the body of a GET into file, through a temporary next to it
+    // that replaces file once complete. Throws unless the status is 2xx.
+    HTTPResponse download(const std::string& url, const std::filesystem::path& file);
+
+    // Body of a GET, whatever the status
+    std::string fetchURL(const std::string& url);
+
+    // .pul, .toml and .json links of an HTML directory listing
+    std::vector<std::string> listDirectory(const std::string& url);
+
+    // Connections opened so far; requests beyond that reused one
+    size_t openedConnections() const { return opened; }
+
+private:
+    struct Connection;
+
+    std::map<std::string, std::unique_ptr<Connection>> connections; // by "host:port"
+    size_t opened = 0;
+    bool initialized;
+
+    Connection& connection(const std::string& host, int port);
+    // One exchange, without following redirects; with follow, the body of a
+    // redirect is not delivered
+    HTTPResponse exchange(const std::string& method, const std::string& url, const std::string& body,
+                          const BodySink& sink, bool follow);
+};
+
+} // namespace pulse::net
@@ -1,8 +1,12 @@
 #pragma once
 
+#include "parser/ast_arena.hpp"
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <variant>
 
 namespace pulse::parser {
@@ -13,47 +17,102 @@ class Expression;
 class Statement;
 class Declaration;
 
-// Type definitions for convenience
-using ASTNodePtr = std::unique_ptr<ASTNode>;
-using ExpressionPtr = std::unique_ptr<Expression>;
-using StatementPtr = std::unique_ptr<Statement>;
-using DeclarationPtr = std::unique_ptr<Declaration>;
+// Type definitions for convenience. Nodes are owned by the Program's AstArena.
+using ASTNodePtr = NodePtr<ASTNode>;
+using ExpressionPtr = NodePtr<Expression>;
+using StatementPtr = NodePtr<Statement>;
+using DeclarationPtr = NodePtr<Declaration>;
+
+// Concrete node type tag. Every node records its kind at construction so tree
+// walkers can dispatch with a single switch instead of a dynamic_cast chain.
+enum class NodeKind : uint8_t {
+    // Expressions
+    LITERAL,
+    IDENTIFIER,
+    BINARY,
+    UNARY,
+    CALL,
+    ATTRIBUTE,
+    SUBSCRIPT,
+    LIST,
+    DICT,
+    TUPLE,
+    
+    // Statements
+    ASSIGNMENT,
+    EXPRESSION_STATEMENT,
+    RETURN,
+    IF,
+    WHILE,
+    FOR,
+    MATCH,
+    
+    // Declarations
+    FUNCTION,
+    CLASS,
+    IMPORT,
+    
+    // Program root
+    PROGRAM
+};
 
 // Base class for all AST nodes
 class ASTNode {
 public:
+    explicit ASTNode(NodeKind kind) : kind(kind) {}
     virtual ~ASTNode() = default;
     virtual void accept(class ASTVisitor& visitor) = 0;
+    
+    NodeKind getKind() const { return kind; }
+    
+private:
+    NodeKind kind;
 };
 
 // Expression base class
 class Expression : public ASTNode {
 public:
+    using ASTNode::ASTNode;
     virtual ~Expression() = default;
+    
+    static bool classof(const ASTNode* node) { return node->getKind() <= NodeKind::TUPLE; }
 };
 
 // Statement base class
 class Statement : public ASTNode {
 public:
+    using ASTNode::ASTNode;
     virtual ~Statement() = default;
+    
+    static bool classof(const ASTNode* node) {
+        return node->getKind() >= NodeKind::ASSIGNMENT && node->getKind() <= NodeKind::MATCH;
+    }
 };
 
 // Declaration base class
 class Declaration : public ASTNode {
 public:
+    using ASTNode::ASTNode;
     virtual ~Declaration() = default;
+    
+    static bool classof(const ASTNode* node) {
+        return node->getKind() >= NodeKind::FUNCTION && node->getKind() <= NodeKind::IMPORT;
+    }
 };
 
 // Literal expressions
 class LiteralExpression : public Expression {
 public:
-    std::variant<std::string, int64_t, double, bool, std::monostate> value;
+    static constexpr NodeKind KIND = NodeKind::LITERAL;
     
-    explicit LiteralExpression(const std::string& value) : value(value) {}
-    explicit LiteralExpression(int64_t value) : value(value) {}
-    explicit LiteralExpression(double value) : value(value) {}
-    explicit LiteralExpression(bool value) : value(value) {}
-    LiteralExpression() : value(std::monostate{}) {} // None
+    // String payloads are views into the arena
+    std::variant<std::string_view, int64_t, double, bool, std::monostate> value;
+    
+    explicit LiteralExpression(std::string_view value) : Expression(KIND), value(value) {}
+    explicit LiteralExpression(int64_t value) : Expression(KIND), value(value) {}
+    explicit LiteralExpression(double value) : Expression(KIND), value(value) {}
+    explicit LiteralExpression(bool value) : Expression(KIND), value(value) {}
+    LiteralExpression() : Expression(KIND), value(std::monostate{}) {} // None
     
     void accept(ASTVisitor& visitor) override;
 };
@@ -61,9 +120,11 @@ public:
 // Identifier expression
 class IdentifierExpression : public Expression {
 public:
-    std::string name;
+    static constexpr NodeKind KIND = NodeKind::IDENTIFIER;
+    
+    std::string_view name;
     
-    explicit IdentifierExpression(const std::string& name) : name(name) {}
+    explicit IdentifierExpression(std::string_view name) : Expression(KIND), name(name) {}
     
     void accept(ASTVisitor& visitor) override;
 };
@@ -71,6 +132,8 @@ public:
 // Binary operation expression
 class BinaryExpression : public Expression {
 public:
+    static constexpr NodeKind KIND = NodeKind::BINARY;
+    
     enum class Operator {
         ADD, SUBTRACT, MULTIPLY, DIVIDE, FLOOR_DIVIDE, MODULO, POWER,
         EQUAL, NOT_EQUAL, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL,
@@ -82,7 +145,7 @@ public:
     ExpressionPtr right;
     
     BinaryExpression(Operator op, ExpressionPtr left, ExpressionPtr right)
-        : op(op), left(std::move(left)), right(std::move(right)) {}
+        : Expression(KIND), op(op), left(std::move(left)), right(std::move(right)) {}
     
     void accept(ASTVisitor& visitor) override;
 };
@@ -90,15 +153,18 @@ public:
 // Unary operation expression
 class UnaryExpression : public Expression {
 public:
+    static constexpr NodeKind KIND = NodeKind::UNARY;
+    
     enum class Operator {
-        PLUS, MINUS, NOT
+        PLUS, MINUS, NOT,
+        AWAIT // only inside async functions
     };
     
     Operator op;
     ExpressionPtr operand;
     
     UnaryExpression(Operator op, ExpressionPtr operand)
-        : op(op), operand(std::move(operand)) {}
+        : Expression(KIND), op(op), operand(std::move(operand)) {}
     
     void accept(ASTVisitor& visitor) override;
 };
@@ -106,11 +172,13 @@ public:
 // Function call expression
 class CallExpression : public Expression {
 public:
+    static constexpr NodeKind KIND = NodeKind::CALL;
+    
     ExpressionPtr callee;
-    std::vector<ExpressionPtr> arguments;
+    ArenaVector<ExpressionPtr> arguments;
     
-    CallExpression(ExpressionPtr callee, std::vector<ExpressionPtr> arguments)
-        : callee(std::move(callee)), arguments(std::move(arguments)) {}
+    CallExpression(ExpressionPtr callee, ArenaVector<ExpressionPtr> arguments)
+        : Expression(KIND), callee(std::move(callee)), arguments(std::move(arguments)) {}
     
     void accept(ASTVisitor& visitor) override;
 };
@@ -118,11 +186,13 @@ public:
 // Attribute access expression
 class AttributeExpression : public Expression {
 public:
+    static constexpr NodeKind KIND = NodeKind::ATTRIBUTE;
+    
     ExpressionPtr object;
-    std::string attribute;
+    std::string_view attribute;
     
-    AttributeExpression(ExpressionPtr object, const std::string& attribute)
-        : object(std::move(object)), attribute(attribute) {}
+    AttributeExpression(ExpressionPtr object, std::string_view attribute)
+        : Expression(KIND), object(std::move(object)), attribute(attribute) {}
     
     void accept(ASTVisitor& visitor) override;
 };
@@ -130,11 +200,13 @@ public:
 // Subscript expression
 class SubscriptExpression : public Expression {
 public:
+    static constexpr NodeKind KIND = NodeKind::SUBSCRIPT;
+    
     ExpressionPtr object;
     ExpressionPtr index;
     
     SubscriptExpression(ExpressionPtr object, ExpressionPtr index)
-        : object(std::move(object)), index(std::move(index)) {}
+        : Expression(KIND), object(std::move(object)), index(std::move(index)) {}
     
     void accept(ASTVisitor& visitor) override;
 };
@@ -142,10 +214,12 @@ public:
 // List expression
 class ListExpression : public Expression {
 public:
-    std::vector<ExpressionPtr> elements;
+    static constexpr NodeKind KIND = NodeKind::LIST;
     
-    explicit ListExpression(std::vector<ExpressionPtr> elements)
-        : elements(std::move(elements)) {}
+    ArenaVector<ExpressionPtr> elements;
+    
+    explicit ListExpression(ArenaVector<ExpressionPtr> elements)
+        : Expression(KIND), elements(std::move(elements)) {}
     
     void accept(ASTVisitor& visitor) override;
 };
@@ -153,6 +227,8 @@ public:
 // Dictionary expression
 class DictExpression : public Expression {
 public:
+    static constexpr NodeKind KIND = NodeKind::DICT;
+    
     struct KeyValue {
         ExpressionPtr key;
         ExpressionPtr value;
@@ -161,10 +237,10 @@ public:
             : key(std::move(key)), value(std::move(value)) {}
     };
     
-    std::vector<KeyValue> pairs;
+    ArenaVector<KeyValue> pairs;
     
-    explicit DictExpression(std::vector<KeyValue> pairs)
-        : pairs(std::move(pairs)) {}
+    explicit DictExpression(ArenaVector<KeyValue> pairs)
+        : Expression(KIND), pairs(std::move(pairs)) {}
     
     void accept(ASTVisitor& visitor) override;
 };
@@ -172,10 +248,12 @@ public:
 // Tuple expression
 class TupleExpression : public Expression {
 public:
-    std::vector<ExpressionPtr> elements;
+    static constexpr NodeKind KIND = NodeKind::TUPLE;
     
-    explicit TupleExpression(std::vector<ExpressionPtr> elements)
-        : elements(std::move(elements)) {}
+    ArenaVector<ExpressionPtr> elements;
+    
+    explicit TupleExpression(ArenaVector<ExpressionPtr> elements)
+        : Expression(KIND), elements(std::move(elements)) {}
     
     void accept(ASTVisitor& visitor) override;
 };
@@ -183,11 +261,13 @@ public:
 // Assignment statement
 class AssignmentStatement : public Statement {
 public:
-    std::string name;
+    static constexpr NodeKind KIND = NodeKind::ASSIGNMENT;
+    
+    std::string_view name;
     ExpressionPtr value;
     
-    AssignmentStatement(const std::string& name, ExpressionPtr value)
-        : name(name), value(std::move(value)) {}
+    AssignmentStatement(std::string_view name, ExpressionPtr value)
+        : Statement(KIND), name(name), value(std::move(value)) {}
     
     void accept(ASTVisitor& visitor) override;
 };
@@ -195,10 +275,12 @@ public:
 // Expression statement
 class ExpressionStatement : public Statement {
 public:
+    static constexpr NodeKind KIND = NodeKind::EXPRESSION_STATEMENT;
+    
     ExpressionPtr expression;
     
     explicit ExpressionStatement(ExpressionPtr expression)
-        : expression(std::move(expression)) {}
+        : Statement(KIND), expression(std::move(expression)) {}
     
     void accept(ASTVisitor& visitor) override;
 };
@@ -206,10 +288,12 @@ public:
 // Return statement
 class ReturnStatement : public Statement {
 public:
+    static constexpr NodeKind KIND = NodeKind::RETURN;
+    
     ExpressionPtr value;
     
     explicit ReturnStatement(ExpressionPtr value = nullptr)
-        : value(std::move(value)) {}
+        : Statement(KIND), value(std::move(value)) {}
     
     void accept(ASTVisitor& visitor) override;
 };
@@ -217,19 +301,21 @@ public:
 // If statement
 class IfStatement : public Statement {
 public:
+    static constexpr NodeKind KIND = NodeKind::IF;
+    
     struct Branch {
         ExpressionPtr condition;
-        std::vector<StatementPtr> body;
+        ArenaVector<StatementPtr> body;
         
-        Branch(ExpressionPtr condition, std::vector<StatementPtr> body)
+        Branch(ExpressionPtr condition, ArenaVector<StatementPtr> body)
             : condition(std::move(condition)), body(std::move(body)) {}
     };
     
-    std::vector<Branch> branches;
-    std::vector<StatementPtr> else_body;
+    ArenaVector<Branch> branches;
+    ArenaVector<StatementPtr> else_body;
     
-    IfStatement(std::vector<Branch> branches, std::vector<StatementPtr> else_body = {})
-        : branches(std::move(branches)), else_body(std::move(else_body)) {}
+    IfStatement(ArenaVector<Branch> branches, ArenaVector<StatementPtr> else_body)
+        : Statement(KIND), branches(std::move(branches)), else_body(std::move(else_body)) {}
     
     void accept(ASTVisitor& visitor) override;
 };
@@ -237,11 +323,13 @@ public:
 // While statement
 class WhileStatement : public Statement {
 public:
+    static constexpr NodeKind KIND = NodeKind::WHILE;
+    
     ExpressionPtr condition;
-    std::vector<StatementPtr> body;
+    ArenaVector<StatementPtr> body;
     
-    WhileStatement(ExpressionPtr condition, std::vector<StatementPtr> body)
-        : condition(std::move(condition)), body(std::move(body)) {}
+    WhileStatement(ExpressionPtr condition, ArenaVector<StatementPtr> body)
+        : Statement(KIND), condition(std::move(condition)), body(std::move(body)) {}
     
     void accept(ASTVisitor& visitor) override;
 };
@@ -249,12 +337,14 @@ public:
 // For statement
 class ForStatement : public Statement {
 public:
-    std::string variable;
+    static constexpr NodeKind KIND = NodeKind::FOR;
+    
+    std::string_view variable;
     ExpressionPtr iterable;
-    std::vector<StatementPtr> body;
+    ArenaVector<StatementPtr> body;
     
-    ForStatement(const std::string& variable, ExpressionPtr iterable, std::vector<StatementPtr> body)
-        : variable(variable), iterable(std::move(iterable)), body(std::move(body)) {}
+    ForStatement(std::string_view variable, ExpressionPtr iterable, ArenaVector<StatementPtr> body)
+        : Statement(KIND), variable(variable), iterable(std::move(iterable)), body(std::move(body)) {}
     
     void accept(ASTVisitor& visitor) override;
 };
@@ -262,11 +352,13 @@ public:
 // Match statement
 class MatchStatement : public Statement {
 public:
+    static constexpr NodeKind KIND = NodeKind::MATCH;
+    
     ExpressionPtr value;
-    std::vector<std::pair<ExpressionPtr, std::vector<StatementPtr>>> cases;
+    ArenaVector<std::pair<ExpressionPtr, ArenaVector<StatementPtr>>> cases;
     
-    MatchStatement(ExpressionPtr value, std::vector<std::pair<ExpressionPtr, std::vector<StatementPtr>>> cases)
-        : value(std::move(value)), cases(std::move(cases)) {}
+    MatchStatement(ExpressionPtr value, ArenaVector<std::pair<ExpressionPtr, ArenaVector<StatementPtr>>> cases)
+        : Statement(KIND), value(std::move(value)), cases(std::move(cases)) {}
     
     void accept(ASTVisitor& visitor) override;
 };
@@ -274,14 +366,16 @@ public:
 // Function definition
 class FunctionDeclaration : public Declaration {
 public:
-    std::string name;
-    std::vector<std::string> parameters;
-    std::vector<StatementPtr> body;
+    static constexpr NodeKind KIND = NodeKind::FUNCTION;
+    
+    std::string_view name;
+    ArenaVector<std::string_view> parameters;
+    ArenaVector<StatementPtr> body;
     bool is_async;
     
-    FunctionDeclaration(const std::string& name, std::vector<std::string> parameters,
-                       std::vector<StatementPtr> body, bool is_async = false)
-        : name(name), parameters(std::move(parameters)), body(std::move(body)), is_async(is_async) {}
+    FunctionDeclaration(std::string_view name, ArenaVector<std::string_view> parameters,
+                       ArenaVector<StatementPtr> body, bool is_async = false)
+        : Declaration(KIND), name(name), parameters(std::move(parameters)), body(std::move(body)), is_async(is_async) {}
     
     void accept(ASTVisitor& visitor) override;
 };
@@ -289,13 +383,15 @@ public:
 // Class definition
 class ClassDeclaration : public Declaration {
 public:
-    std::string name;
-    std::string base_class;
-    std::vector<DeclarationPtr> members;
+    static constexpr NodeKind KIND = NodeKind::CLASS;
     
-    ClassDeclaration(const std::string& name, const std::string& base_class = "",
-                     std::vector<DeclarationPtr> members = {})
-        : name(name), base_class(base_class), members(std::move(members)) {}
+    std::string_view name;
+    std::string_view base_class;
+    ArenaVector<DeclarationPtr> members;
+    
+    ClassDeclaration(std::string_view name, std::string_view base_class,
+                     ArenaVector<DeclarationPtr> members)
+        : Declaration(KIND), name(name), base_class(base_class), members(std::move(members)) {}
     
     void accept(ASTVisitor& visitor) override;
 };
@@ -303,23 +399,34 @@ public:
 // Import statement
 class ImportDeclaration : public Declaration {
 public:
-    std::string module;
-    std::string alias;
+    static constexpr NodeKind KIND = NodeKind::IMPORT;
+    
+    std::string_view module;
+    std::string_view alias;
     
-    ImportDeclaration(const std::string& module, const std::string& alias = "")
-        : module(module), alias(alias) {}
+    ImportDeclaration(std::string_view module, std::string_view alias = {})
+        : Declaration(KIND), module(module), alias(alias) {}
     
     void accept(ASTVisitor& visitor) override;
 };
 
-// Program root
+// Program root. Unlike the other nodes it is heap-allocated and owns the arena
+// holding the rest of the tree; the arena is declared first so it outlives the lists.
 class Program : public ASTNode {
 public:
-    std::vector<DeclarationPtr> declarations;
-    std::vector<StatementPtr> statements;
+    static constexpr NodeKind KIND = NodeKind::PROGRAM;
     
-    Program(std::vector<DeclarationPtr> declarations = {}, std::vector<StatementPtr> statements = {})
-        : declarations(std::move(declarations)), statements(std::move(statements)) {}
+    std::unique_ptr<AstArena> arena;
+    ArenaVector<DeclarationPtr> declarations;
+    ArenaVector<StatementPtr> statements;
+    
+    Program()
+        : ASTNode(KIND), arena(std::make_unique<AstArena>()),
+          declarations(arena->getResource()), statements(arena->getResource()) {}
+    
+    Program(std::unique_ptr<AstArena> arena, ArenaVector<DeclarationPtr> declarations,
+            ArenaVector<StatementPtr> statements)
+        : ASTNode(KIND), arena(std::move(arena)), declarations(std::move(declarations)), statements(std::move(statements)) {}
     
     void accept(ASTVisitor& visitor) override;
 };
@@ -359,4 +466,89 @@ public:
     virtual void visitProgram(Program* program) = 0;
 };
 
+// Kind-based type tests, used in place of dynamic_cast on AST nodes
+template <typename T>
+bool isa(const ASTNode* node) {
+    if constexpr (std::is_same_v<T, Expression> || std::is_same_v<T, Statement> ||
+                  std::is_same_v<T, Declaration>) {
+        return node && T::classof(node);
+    } else {
+        return node && node->getKind() == T::KIND;
+    }
+}
+
+template <typename T>
+T* dyn_cast(ASTNode* node) {
+    return isa<T>(node) ? static_cast<T*>(node) : nullptr;
+}
+
+template <typename T>
+const T* dyn_cast(const ASTNode* node) {
+    return isa<T>(node) ? static_cast<const T*>(node) : nullptr;
+}
+
+// Static-dispatch visitor. Derived classes implement visitXxx methods with the
+// same names as ASTVisitor (returning RetTy) and call visit(node); dispatch is a
+// single switch on the node kind and the calls are resolved at compile time.
+// Unimplemented node types fall back to the defaults below, which return RetTy().
+template <typename Derived, typename RetTy = void>
+class StaticASTVisitor {
+public:
+    RetTy visit(ASTNode* node) {
+        switch (node->getKind()) {
+#define PULSE_DISPATCH(KIND_NAME, CLASS) \
+            case NodeKind::KIND_NAME: return derived().visit##CLASS(static_cast<CLASS*>(node));
+            PULSE_DISPATCH(LITERAL, LiteralExpression)
+            PULSE_DISPATCH(IDENTIFIER, IdentifierExpression)
+            PULSE_DISPATCH(BINARY, BinaryExpression)
+            PULSE_DISPATCH(UNARY, UnaryExpression)
+            PULSE_DISPATCH(CALL, CallExpression)
+            PULSE_DISPATCH(ATTRIBUTE, AttributeExpression)
+            PULSE_DISPATCH(SUBSCRIPT, SubscriptExpression)
+            PULSE_DISPATCH(LIST, ListExpression)
+            PULSE_DISPATCH(DICT, DictExpression)
+            PULSE_DISPATCH(TUPLE, TupleExpression)
+            PULSE_DISPATCH(ASSIGNMENT, AssignmentStatement)
+            PULSE_DISPATCH(EXPRESSION_STATEMENT, ExpressionStatement)
+            PULSE_DISPATCH(RETURN, ReturnStatement)
+            PULSE_DISPATCH(IF, IfStatement)
+            PULSE_DISPATCH(WHILE, WhileStatement)
+            PULSE_DISPATCH(FOR, ForStatement)
+            PULSE_DISPATCH(MATCH, MatchStatement)
+            PULSE_DISPATCH(FUNCTION, FunctionDeclaration)
+            PULSE_DISPATCH(CLASS, ClassDeclaration)
+            PULSE_DISPATCH(IMPORT, ImportDeclaration)
+            PULSE_DISPATCH(PROGRAM, Program)
+#undef PULSE_DISPATCH
+        }
+        return RetTy();
+    }
+    
+    // Default handlers
+    RetTy visitLiteralExpression(LiteralExpression*) { return RetTy(); }
+    RetTy visitIdentifierExpression(IdentifierExpression*) { return RetTy(); }
+    RetTy visitBinaryExpression(BinaryExpression*) { return RetTy(); }
+    RetTy visitUnaryExpression(UnaryExpression*) { return RetTy(); }
+    RetTy visitCallExpression(CallExpression*) { return RetTy(); }
+    RetTy visitAttributeExpression(AttributeExpression*) { return RetTy(); }
+    RetTy visitSubscriptExpression(SubscriptExpression*) { return RetTy(); }
+    RetTy visitListExpression(ListExpression*) { return RetTy(); }
+    RetTy visitDictExpression(DictExpression*) { return RetTy(); }
+    RetTy visitTupleExpression(TupleExpression*) { return RetTy(); }
+    RetTy visitAssignmentStatement(AssignmentStatement*) { return RetTy(); }
+    RetTy visitExpressionStatement(ExpressionStatement*) { return RetTy(); }
+    RetTy visitReturnStatement(ReturnStatement*) { return RetTy(); }
+    RetTy visitIfStatement(IfStatement*) { return RetTy(); }
+    RetTy visitWhileStatement(WhileStatement*) { return RetTy(); }
+    RetTy visitForStatement(ForStatement*) { return RetTy(); }
+    RetTy visitMatchStatement(MatchStatement*) { return RetTy(); }
+    RetTy visitFunctionDeclaration(FunctionDeclaration*) { return RetTy(); }
+    RetTy visitClassDeclaration(ClassDeclaration*) { return RetTy(); }
+    RetTy visitImportDeclaration(ImportDeclaration*) { return RetTy(); }
+    RetTy visitProgram(Program*) { return RetTy(); }
+    
+private:
+    Derived& derived() { return *static_cast<Derived*>(this); }
+};
+
 } // namespace pulse::parser 
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory_resource>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace pulse::parser {
+
+// Child arrays of AST nodes live in the arena as well
+template <typename T>
+using ArenaVector = std::pmr::vector<T>;
+
+// Non-owning, move-only handle to an arena-allocated node. It mirrors the parts of
+// std::unique_ptr the tree walkers use (get, ->, bool, moves) but never deletes:
+// the AstArena that created the node releases it together with every other node.
+template <typename T>
+class NodePtr {
+public:
+    NodePtr() = default;
+    NodePtr(std::nullptr_t) {}
+    explicit NodePtr(T* node) : node(node) {}
+
+    NodePtr(NodePtr&& other) noexcept : node(other.release()) {}
+
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    NodePtr(NodePtr<U>&& other) noexcept : node(other.release()) {}
+
+    NodePtr& operator=(NodePtr&& other) noexcept {
+        node = other.release();
+        return *this;
+    }
+
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    NodePtr& operator=(NodePtr<U>&& other) noexcept {
+        node = other.release();
+        return *this;
+    }
+
+    NodePtr(const NodePtr&) = delete;
+    NodePtr& operator=(const NodePtr&) = delete;
+
+    T* get() const { return node; }
+    T* operator->() const { return node; }
+    T& operator*() const { return *node; }
+    explicit operator bool() const { return node != nullptr; }
+
+    T* release() {
+        T* released = node;
+        node = nullptr;
+        return released;
+    }
+
+private:
+    T* node = nullptr;
+};
+
+// Bump-pointer storage for one parsed program. Nodes, their child arrays and
+// their strings are carved out of large blocks and released all at once when the
+// arena is destroyed; node destructors are never run, so every container inside
+// a node must allocate from getResource().
+class AstArena {
+public:
+    static constexpr size_t INITIAL_BLOCK_SIZE = 64 * 1024;
+
+    AstArena() : resource(INITIAL_BLOCK_SIZE) {}
+
+    AstArena(const AstArena&) = delete;
+    AstArena& operator=(const AstArena&) = delete;
+
+    template <typename T, typename... Args>
+    NodePtr<T> make(Args&&... args) {
+        void* memory = resource.allocate(sizeof(T), alignof(T));
+        return NodePtr<T>(new (memory) T(std::forward<Args>(args)...));
+    }
+
+    template <typename T>
+    ArenaVector<T> makeVector() {
+        return ArenaVector<T>(&resource);
+    }
+
+    // Copy text into the arena; the view stays valid for the arena's lifetime
+    std::string_view copyString(std::string_view text) {
+        if (text.empty()) return {};
+        char* memory = static_cast<char*>(resource.allocate(text.size(), alignof(char)));
+        std::memcpy(memory, text.data(), text.size());
+        return std::string_view(memory, text.size());
+    }
+
+    std::pmr::memory_resource* getResource() { return &resource; }
+
+private:
+    std::pmr::monotonic_buffer_resource resource;
+};
+
+} // namespace pulse::parser
@@ -4,70 +4,104 @@
 #include "lexer/token.hpp"
 #include <vector>
 #include <memory>
+#include <stdexcept>
+#include <string>
 
 namespace pulse::parser {
 
+// Thrown for syntax errors; what() includes the position, message does not
+class ParseError : public std::runtime_error {
+public:
+    ParseError(const std::string& what, std::string message, size_t line, size_t column)
+        : std::runtime_error(what), message(std::move(message)), line(line), column(column) {}
+
+    std::string message;
+    size_t line;
+    size_t column;
+};
+
 class Parser {
 public:
-    explicit Parser(const std::vector<lexer::Token>& tokens);
-    
-    // Parse the entire program
+    // Borrow a token stream; it must outlive parse() but not the resulting AST
+    explicit Parser(const lexer::TokenStream& tokens);
+
+    // Take ownership of a token stream (no copy)
+    explicit Parser(lexer::TokenStream&& tokens);
+
+    Parser(const Parser&) = delete;
+    Parser& operator=(const Parser&) = delete;
+
+    // Parse the entire program; reports errors to stderr and returns nullptr
     std::unique_ptr<Program> parse();
-    
+
+    // Parse the entire program, throwing ParseError on the first syntax error
+    std::unique_ptr<Program> parseOrThrow();
+
 private:
-    std::vector<lexer::Token> tokens;
+    lexer::TokenStream ownedTokens;
+    const lexer::TokenStream* tokens;
     size_t current;
-    
-    // Helper methods
-    bool isAtEnd() const { return current >= tokens.size(); }
-    lexer::Token peek() const { return isAtEnd() ? tokens.back() : tokens[current]; }
-    lexer::Token advance() { return isAtEnd() ? tokens.back() : tokens[current++]; }
+    size_t last;
+    std::unique_ptr<AstArena> arena;
+
+    // Helper methods. Tokens are handed out by reference; comments are skipped.
+    bool isAtEnd() const { return peek().type == lexer::TokenType::EOF_TOKEN; }
+    const lexer::Token& peek() const { return (*tokens)[current]; }
+    const lexer::Token& previous() const { return (*tokens)[last]; }
+    const lexer::Token& advance();
     bool check(lexer::TokenType type) const;
+    bool checkNext(lexer::TokenType type) const;
     bool match(lexer::TokenType type);
     void consume(lexer::TokenType type, const std::string& message);
-    
+    void skipComments();
+    void skipNewlines();
+
+    // Copy a token's lexeme into the arena
+    std::string_view lexeme(const lexer::Token& token) { return arena->copyString(tokens->lexeme(token)); }
+
     // Parsing methods
     std::unique_ptr<Program> program();
-    std::unique_ptr<Declaration> declaration();
-    std::unique_ptr<Statement> statement();
-    std::unique_ptr<Expression> expression();
-    std::unique_ptr<Expression> logicalOr();
-    std::unique_ptr<Expression> logicalAnd();
-    std::unique_ptr<Expression> equality();
-    std::unique_ptr<Expression> comparison();
-    std::unique_ptr<Expression> term();
-    std::unique_ptr<Expression> factor();
-    std::unique_ptr<Expression> power();
-    std::unique_ptr<Expression> unary();
-    std::unique_ptr<Expression> primary();
-    std::unique_ptr<Expression> call();
-    std::unique_ptr<Expression> finishCall(std::unique_ptr<Expression> callee);
-    
+    DeclarationPtr declaration();
+    StatementPtr statement();
+    ExpressionPtr expression();
+    ExpressionPtr logicalOr();
+    ExpressionPtr logicalAnd();
+    ExpressionPtr equality();
+    ExpressionPtr comparison();
+    ExpressionPtr term();
+    ExpressionPtr factor();
+    ExpressionPtr power();
+    ExpressionPtr unary();
+    ExpressionPtr awaitExpression();
+    ExpressionPtr primary();
+    ExpressionPtr call();
+    ExpressionPtr finishCall(ExpressionPtr callee);
+
     // Statement parsing
-    std::unique_ptr<Statement> ifStatement();
-    std::unique_ptr<Statement> whileStatement();
-    std::unique_ptr<Statement> forStatement();
-    std::unique_ptr<Statement> matchStatement();
-    std::unique_ptr<Statement> returnStatement();
-    std::unique_ptr<Statement> assignmentStatement();
-    std::unique_ptr<Statement> expressionStatement();
-    
+    StatementPtr ifStatement();
+    StatementPtr whileStatement();
+    StatementPtr forStatement();
+    StatementPtr matchStatement();
+    StatementPtr returnStatement();
+    StatementPtr assignmentStatement();
+    StatementPtr expressionStatement();
+
     // Declaration parsing
-    std::unique_ptr<Declaration> functionDeclaration();
-    std::unique_ptr<Declaration> classDeclaration();
-    std::unique_ptr<Declaration> importDeclaration();
-    
+    DeclarationPtr functionDeclaration(bool isAsync);
+    DeclarationPtr classDeclaration();
+    DeclarationPtr importDeclaration();
+
     // Expression parsing
-    std::unique_ptr<Expression> listExpression();
-    std::unique_ptr<Expression> dictExpression();
-    std::unique_ptr<Expression> tupleExpression();
-    
-    // Block parsing
-    std::vector<std::unique_ptr<Statement>> block();
-    
+    ExpressionPtr listExpression();
+    ExpressionPtr dictExpression();
+    ExpressionPtr tupleExpression(ExpressionPtr first);
+
+    // Block parsing: an indented suite, or a single statement on the same line
+    ArenaVector<StatementPtr> block();
+
     // Error handling
     void synchronize();
-    void error(const lexer::Token& token, const std::string& message);
+    [[noreturn]] void error(const lexer::Token& token, const std::string& message);
 };
 
-} // namespace pulse::parser 
\ No newline at end of file
+} // namespace pulse::parser
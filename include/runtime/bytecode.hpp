@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "runtime/symbols.hpp"
+#include "runtime/tiering.hpp"
+#include "runtime/value.hpp"
+
+namespace pulse::runtime {
+
+// Register bytecode. R[x] is register x of the current frame (parameters
+// first, then locals, then temporaries), K[x] constant x of the function.
+//
+// Opcodes marked "+JUMP" are conditional and always followed by a JUMP word:
+// when the condition holds the VM takes that jump, otherwise it steps over
+// it, so a test and its branch cost one dispatch. Compare-and-branch ops jump
+// when the comparison equals `flag`.
+#define PULSE_OPCODES(X)                                                        \
+    X(LOAD_NONE)    /* R[a] = None */                                           \
+    X(LOAD_BOOL)    /* R[a] = bool(flag) */                                     \
+    X(LOAD_INT)     /* R[a] = sext(b | c << 16) */                              \
+    X(LOAD_CONST)   /* R[a] = K[b] */                                           \
+    X(MOVE)         /* R[a] = R[b] */                                           \
+    X(GET_GLOBAL)   /* R[a] = globals[G[b]] (inline cache G[b]) */              \
+    X(SET_GLOBAL)   /* globals[G[b]] = R[a] */                                  \
+    X(ADD) X(SUB) X(MUL) X(DIV) X(FLOOR_DIV) X(MOD) X(POW) /* R[a] = R[b] op R[c] */ \
+    X(ADDK) X(SUBK) X(MULK)                        /* R[a] = R[b] op K[c] */    \
+    X(EQ) X(NE) X(LT) X(LE) X(GT) X(GE)            /* R[a] = R[b] op R[c] */    \
+    X(NEG) X(POS) X(NOT)                           /* R[a] = op R[b] */         \
+    X(TEST_EQ) X(TEST_NE) X(TEST_LT) X(TEST_LE) X(TEST_GT) X(TEST_GE)           \
+                    /* +JUMP if (R[a] op R[b]) == flag */                       \
+    X(TEST_EQK) X(TEST_NEK) X(TEST_LTK) X(TEST_LEK) X(TEST_GTK) X(TEST_GEK)     \
+                    /* +JUMP if (R[a] op K[b]) == flag */                       \
+    X(TEST)         /* +JUMP if truthy(R[a]) == flag */                         \
+    X(JUMP)         /* pc += sext(b | c << 16) */                               \
+    X(LOOP)         /* JUMP backwards: the loop back-edge */                    \
+    X(RANGE_PREP)   /* R[a..a+2] = start, stop, step: check they are ints */   \
+    X(RANGE_NEXT)   /* +JUMP when R[a] passed R[a+1]; else R[b] = R[a], R[a] += R[a+2] */ \
+    X(ITER_PREP)    /* R[a] = iterable: check it; R[a+1] = 0 */                 \
+    X(FOR_ITER)     /* +JUMP when R[a] is exhausted; else R[b] = next item */   \
+    X(CALL)         /* R[a] = R[a](R[a+1 .. a+b]) (type profile S[c]) */        \
+    X(CALL_METHOD)  /* R[a] = R[a].A[c](R[a+1 .. a+b]) (inline cache A[c]) */   \
+    X(GET_ATTR)     /* R[a] = R[b].A[c] */                                      \
+    X(GET_INDEX)    /* R[a] = R[b][R[c]] */                                     \
+    X(BUILD_LIST)   /* R[a] = [R[b] .. R[b+c-1]] */                             \
+    X(BUILD_TUPLE)  /* R[a] = (R[b] .. R[b+c-1]) */                             \
+    X(BUILD_DICT)   /* R[a] = {R[b]: R[b+1], ...} with c pairs */               \
+    X(INHERIT)      /* class R[a] derives from class R[b] */                    \
+    X(AWAIT)        /* R[a] = await R[b]; may suspend the coroutine */          \
+    X(RETURN)       /* return R[a] */                                           \
+    X(RETURN_NONE)
+
+enum class OpCode : uint8_t {
+#define PULSE_OPCODE_ENUM(name) name,
+    PULSE_OPCODES(PULSE_OPCODE_ENUM)
+#undef PULSE_OPCODE_ENUM
+};
+
+const char* opcodeName(OpCode op);
+
+// One fixed-size 8-byte instruction word
+struct Instruction {
+    OpCode op;
+    uint8_t flag = 0;
+    uint16_t a = 0;
+    uint16_t b = 0;
+    uint16_t c = 0;
+
+    // Signed 32-bit immediate kept in b and c (jump offsets, LOAD_INT)
+    int32_t immediate() const {
+        return static_cast<int32_t>(static_cast<uint32_t>(b) | static_cast<uint32_t>(c) << 16);
+    }
+    void setImmediate(int32_t value) {
+        b = static_cast<uint16_t>(static_cast<uint32_t>(value));
+        c = static_cast<uint16_t>(static_cast<uint32_t>(value) >> 16);
+    }
+};
+
+static_assert(sizeof(Instruction) == 8, "Instructions must stay one word");
+
+// Inline cache of one global name: the address of its binding in the global
+// scope, valid while the scope's generation is unchanged
+struct GlobalCache {
+    Symbol name{};
+    Value* binding = nullptr;
+    uint64_t generation = 0;
+};
+
+// Inline cache of one attribute or method name: the last receiver kind (a
+// ValueType, or the class of an instance) and what the name resolved to.
+// Nothing here is owned: a method caching itself would otherwise form a
+// reference cycle. The attribute lives in the class's (or the runtime's)
+// method table, which outlives every hit because class ids are never reused.
+struct AttributeCache {
+    Symbol name{};
+    ValueType type = ValueType::NONE;
+    uint64_t classId = 0;
+    const Value* attribute = nullptr; // null on a miss
+};
+
+// A compiled function, or the top-level code of a chunk. The caches are
+// written by the VM while it runs the code.
+struct FunctionProto {
+    std::string name;
+    uint16_t parameterCount = 0;
+    uint16_t registerCount = 0;
+    bool isAsync = false; // calls make a CoroutineObject instead of a frame
+    std::vector<Instruction> code;
+    std::vector<Value> constants;
+    std::vector<GlobalCache> globals;
+    std::vector<AttributeCache> attributes;
+    std::vector<CallSite> callSites;
+
+    // Set on top-level functions while a native tier is installed
+    std::shared_ptr<TierProfile> tier;
+
+    // Exact counts while the VM counts calls (--profile-calls). Time is
+    // inclusive: from entering the outermost activation to leaving it, so
+    // recursion is not counted twice; a suspended coroutine does not count.
+    struct CallCounts {
+        uint64_t calls = 0;
+        uint64_t nanoseconds = 0;
+        uint32_t active = 0; // activations on the stack
+        bool listed = false; // in VM::getCountedFunctions()
+    };
+    CallCounts callCounts;
+};
+
+// Human-readable listing of a function's code, one instruction per line
+std::string disassemble(const FunctionProto& proto);
+
+} // namespace pulse::runtime
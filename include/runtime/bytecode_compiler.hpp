@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "parser/ast.hpp"
+#include "runtime/bytecode.hpp"
+#include "runtime/resolver.hpp"
+
+namespace pulse::runtime {
+
+// Compiles a resolved program to register bytecode. A function's parameters
+// and locals get the frame slots the Resolver assigned, so they are used in
+// place as registers; temporaries are allocated above them, stack-wise.
+//
+// Throws RuntimeError ("SyntaxError: ...") for constructs the VM cannot run.
+class BytecodeCompiler {
+public:
+    // With a tier source, top-level functions get a TierProfile that keeps
+    // the tree alive for the native tier
+    explicit BytecodeCompiler(const Resolver& resolver,
+                              std::shared_ptr<const pulse::parser::Program> tierSource = nullptr);
+
+    // The program's top-level code. Running it binds every function and class
+    // as a global, executes the statements and returns the value of a final
+    // expression statement (None otherwise), which is what the REPL echoes.
+    std::shared_ptr<FunctionProto> compileModule(pulse::parser::Program* program);
+
+private:
+    using Reg = uint16_t;
+    using Body = pulse::parser::ArenaVector<pulse::parser::StatementPtr>;
+
+    const Resolver& resolver;
+    std::shared_ptr<const pulse::parser::Program> tierSource;
+
+    // State of the function being compiled
+    std::shared_ptr<FunctionProto> proto;
+    Reg nextRegister = 0;
+    Reg firstTemporary = 0; // registers below are the function's variables
+    bool inFunction = false;
+    bool inAsync = false;       // compiling an async function: await is allowed
+    bool rangeShadowed = false; // the program defines its own range()
+    std::unordered_map<Symbol, uint16_t> globalIndex;
+    std::unordered_map<std::string, uint16_t> stringConstants;
+
+    std::shared_ptr<FunctionProto> compileFunction(pulse::parser::FunctionDeclaration* decl, const std::string& name);
+    Value compileClass(pulse::parser::ClassDeclaration* decl);
+    void beginProto(std::string name, size_t parameterCount, size_t frameSize);
+    std::shared_ptr<FunctionProto> endProto();
+
+    // Registers
+    Reg allocate();
+    void freeTo(Reg mark) { nextRegister = mark; }
+
+    // Emission
+    size_t emit(OpCode op, uint16_t a = 0, uint16_t b = 0, uint16_t c = 0, uint8_t flag = 0);
+    size_t emitJump();
+    void patchJump(size_t jump);
+    void patchJumps(const std::vector<size_t>& jumps);
+    void emitLoop(size_t target);
+    uint16_t constant(Value value);
+    uint16_t stringConstant(std::string_view text);
+    uint16_t globalSlot(Symbol name);
+    uint16_t attributeSlot(std::string_view name);
+    uint16_t callSite();
+
+    // Statements
+    void compileBlock(const Body& body);
+    void compileStatement(pulse::parser::Statement* stmt);
+    void compileAssignment(pulse::parser::AssignmentStatement* stmt);
+    void compileIf(pulse::parser::IfStatement* stmt);
+    void compileWhile(pulse::parser::WhileStatement* stmt);
+    void compileFor(pulse::parser::ForStatement* stmt);
+    bool compileRangeLoop(pulse::parser::ForStatement* stmt);
+    void compileMatch(pulse::parser::MatchStatement* stmt);
+    void compileReturn(pulse::parser::ReturnStatement* stmt);
+    void storeLoopVariable(const pulse::parser::ForStatement* stmt, Reg value);
+    Reg loopTarget(const pulse::parser::ForStatement* stmt);
+
+    // Expressions
+    void compileInto(pulse::parser::Expression* expr, Reg dest);
+    // A register holding the value: a local's own slot, or a new temporary
+    Reg compileOperand(pulse::parser::Expression* expr);
+    // Emit a branch taken when truthy(expr) == jumpWhen; appends the jumps to patch
+    void compileBranch(pulse::parser::Expression* expr, bool jumpWhen, std::vector<size_t>& jumps);
+    void compileLiteral(pulse::parser::LiteralExpression* literal, Reg dest);
+    void compileBinary(pulse::parser::BinaryExpression* expr, Reg dest);
+    void compileLogical(pulse::parser::BinaryExpression* expr, Reg dest);
+    void compileCall(pulse::parser::CallExpression* expr, Reg dest);
+    // build: BUILD_LIST or BUILD_TUPLE
+    void compileSequence(const pulse::parser::ArenaVector<pulse::parser::ExpressionPtr>& elements, Reg dest,
+                         OpCode build);
+    void compileDict(pulse::parser::DictExpression* expr, Reg dest);
+    const VariableSlot& slotOf(const pulse::parser::ASTNode* node) const;
+};
+
+} // namespace pulse::runtime
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pulse::runtime {
+
+class ContainerObject;
+
+struct HeapStats {
+    uint64_t allocations = 0;    // objects allocated so far
+    uint64_t allocatedBytes = 0;
+    size_t liveObjects = 0;
+    size_t liveBytes = 0;
+    size_t peakBytes = 0;
+    size_t tracked = 0;          // containers the cycle collector watches
+    uint64_t youngCollections = 0;
+    uint64_t fullCollections = 0;
+    uint64_t collected = 0;      // objects freed by breaking their cycles
+    std::chrono::nanoseconds pauseTotal{0};
+    std::chrono::nanoseconds pauseMax{0};
+};
+
+// Memory of the runtime's heap objects. Values are reference-counted, so most
+// objects are freed the moment they become unreachable; the heap adds
+//
+// - allocation: blocks of up to 256 bytes come from per-size free lists,
+//   refilled by bumping through 64 KiB chunks, so making a short-lived
+//   string or list is a pointer bump or a pop, never a malloc;
+// - cycle collection: lists, dicts, classes, instances, coroutines and
+//   futures (the objects that can hold references) are linked into a young
+//   and an old generation. Every YOUNG_THRESHOLD new containers the young
+//   ones are checked for cycles no outside reference reaches, as CPython
+//   does: each keeps its reference count minus the references from the
+//   other checked objects, and what no object with outside references leads
+//   to is garbage. Its references are dropped, which frees it. Survivors
+//   move to the old generation, which is checked with it every FULL_EVERY
+//   collections once it grew by a quarter since the last full one.
+//
+// Objects belong to the heap of the thread that made them, like their
+// reference counts; there is no locking. The heap of a thread lives until
+// the process ends, so objects may outlive the thread.
+class Heap {
+public:
+    static constexpr size_t MAX_SMALL = 256;
+    static constexpr size_t CHUNK = 64 * 1024;
+    static constexpr size_t YOUNG_THRESHOLD = 1000;
+    static constexpr size_t FULL_EVERY = 10;
+
+    // The calling thread's heap
+    static Heap& current();
+
+    void* allocate(size_t size);
+    void release(void* block, size_t size) noexcept;
+
+    // Linking of a new container, and its unlinking when it is destroyed.
+    // beforeContainer() runs a collection when one is due; it is called
+    // before the container is made, while every object is still referenced.
+    void beforeContainer();
+    void track(ContainerObject* object) noexcept;
+    void untrack(ContainerObject* object) noexcept;
+
+    // Checks the young generation, or both (full); returns the objects freed
+    size_t collect(bool full = true);
+
+    // Off: containers are still tracked but never collected implicitly
+    void setAutomatic(bool enabled) { automatic = enabled; }
+
+    const HeapStats& stats() const { return counters; }
+    // Multi-line summary: allocation rate, live bytes, collections, pauses
+    std::string report() const;
+
+private:
+    // Intrusive doubly-linked list of containers
+    struct Generation {
+        ContainerObject* head = nullptr;
+        size_t count = 0;
+    };
+
+    std::array<void*, MAX_SMALL / 16> freeLists{};
+    char* bump = nullptr;
+    char* bumpEnd = nullptr;
+    std::vector<void*> chunks;
+    Generation young, old;
+    size_t youngSinceFull = 0;
+    size_t oldAfterFull = 0;     // old generation's size after the last full collection
+    bool automatic = true;
+    bool collecting = false;
+    HeapStats counters;
+    std::chrono::steady_clock::time_point created = std::chrono::steady_clock::now();
+
+    Heap() = default;
+    ~Heap() = default;
+
+    static void link(Generation& generation, ContainerObject* object) noexcept;
+    static void unlink(Generation& generation, ContainerObject* object) noexcept;
+    void refill();
+    size_t collectGeneration(Generation& generation);
+};
+
+} // namespace pulse::runtime
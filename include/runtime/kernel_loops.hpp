@@ -0,0 +1,168 @@
+// The loops of the numeric kernels, compiled once per instruction set: each
+// kernels_<isa>.cpp defines PULSE_KERNEL_ISA and includes this file, and the
+// build gives it that instruction set's flags. The loops are plain C++ left
+// to the auto-vectorizer, so one source serves every vector width.
+//
+// Nothing here may call an inline function or template defined elsewhere
+// (the standard library included): the copy compiled with AVX flags could
+// then be the one the linker keeps for every caller.
+
+#ifndef PULSE_KERNEL_ISA
+#error "define PULSE_KERNEL_ISA before including kernel_loops.hpp"
+#endif
+
+#include "runtime/kernels.hpp"
+
+namespace pulse::runtime::kernels::PULSE_KERNEL_ISA {
+
+namespace {
+
+inline uint64_t bits(int64_t value) { return static_cast<uint64_t>(value); }
+inline int64_t value(uint64_t bits) { return static_cast<int64_t>(bits); }
+
+int64_t sumInt(const int64_t* x, size_t n) {
+    uint64_t lanes[LANES] = {};
+    size_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        for (size_t j = 0; j < LANES; j++) lanes[j] += bits(x[i + j]);
+    }
+    uint64_t total = 0;
+    for (size_t j = 0; j < LANES; j++) total += lanes[j];
+    for (; i < n; i++) total += bits(x[i]);
+    return value(total);
+}
+
+// In order, as the VM adds boxed numbers: lanes would round differently
+double sumFloat(double start, const double* x, size_t n) {
+    double total = start;
+    for (size_t i = 0; i < n; i++) total += x[i];
+    return total;
+}
+
+template <typename T, bool MIN>
+T extreme(const T* x, size_t n) {
+    if (n < LANES) {
+        T best = x[0];
+        for (size_t i = 1; i < n; i++) best = MIN ? (x[i] < best ? x[i] : best) : (x[i] > best ? x[i] : best);
+        return best;
+    }
+    T lanes[LANES];
+    for (size_t j = 0; j < LANES; j++) lanes[j] = x[j];
+    size_t i = LANES;
+    for (; i + LANES <= n; i += LANES) {
+        for (size_t j = 0; j < LANES; j++) {
+            T y = x[i + j];
+            lanes[j] = MIN ? (y < lanes[j] ? y : lanes[j]) : (y > lanes[j] ? y : lanes[j]);
+        }
+    }
+    for (; i < n; i++) {
+        lanes[0] = MIN ? (x[i] < lanes[0] ? x[i] : lanes[0]) : (x[i] > lanes[0] ? x[i] : lanes[0]);
+    }
+    T best = lanes[0];
+    for (size_t j = 1; j < LANES; j++) {
+        best = MIN ? (lanes[j] < best ? lanes[j] : best) : (lanes[j] > best ? lanes[j] : best);
+    }
+    return best;
+}
+
+int64_t minInt(const int64_t* x, size_t n) { return extreme<int64_t, true>(x, n); }
+int64_t maxInt(const int64_t* x, size_t n) { return extreme<int64_t, false>(x, n); }
+double minFloat(const double* x, size_t n) { return extreme<double, true>(x, n); }
+double maxFloat(const double* x, size_t n) { return extreme<double, false>(x, n); }
+
+bool anyNaN(const double* x, size_t n) {
+    bool found = false;
+    for (size_t i = 0; i < n; i++) found |= x[i] != x[i];
+    return found;
+}
+
+void iota(int64_t* out, size_t n, int64_t start, int64_t step) {
+    for (size_t i = 0; i < n; i++) out[i] = value(bits(start) + static_cast<uint64_t>(i) * bits(step));
+}
+
+void arithInt(Arith op, const int64_t* a, const int64_t* b, int64_t* out, size_t n) {
+    switch (op) {
+        case Arith::ADD:
+            for (size_t i = 0; i < n; i++) out[i] = value(bits(a[i]) + bits(b[i]));
+            break;
+        case Arith::SUB:
+            for (size_t i = 0; i < n; i++) out[i] = value(bits(a[i]) - bits(b[i]));
+            break;
+        case Arith::MUL:
+            for (size_t i = 0; i < n; i++) out[i] = value(bits(a[i]) * bits(b[i]));
+            break;
+    }
+}
+
+void arithFloat(Arith op, const double* a, const double* b, double* out, size_t n) {
+    switch (op) {
+        case Arith::ADD:
+            for (size_t i = 0; i < n; i++) out[i] = a[i] + b[i];
+            break;
+        case Arith::SUB:
+            for (size_t i = 0; i < n; i++) out[i] = a[i] - b[i];
+            break;
+        case Arith::MUL:
+            for (size_t i = 0; i < n; i++) out[i] = a[i] * b[i];
+            break;
+    }
+}
+
+void negateInt(const int64_t* a, int64_t* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = value(0 - bits(a[i]));
+}
+
+void negateFloat(const double* a, double* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = -a[i];
+}
+
+template <typename T>
+void compareLoop(Compare op, const T* a, const T* b, uint8_t* out, size_t n) {
+    switch (op) {
+        case Compare::EQ:
+            for (size_t i = 0; i < n; i++) out[i] = a[i] == b[i];
+            break;
+        case Compare::NE:
+            for (size_t i = 0; i < n; i++) out[i] = a[i] != b[i];
+            break;
+        case Compare::LT:
+            for (size_t i = 0; i < n; i++) out[i] = a[i] < b[i];
+            break;
+        case Compare::LE:
+            for (size_t i = 0; i < n; i++) out[i] = a[i] <= b[i];
+            break;
+        case Compare::GT:
+            for (size_t i = 0; i < n; i++) out[i] = a[i] > b[i];
+            break;
+        case Compare::GE:
+            for (size_t i = 0; i < n; i++) out[i] = a[i] >= b[i];
+            break;
+    }
+}
+
+void compareInt(Compare op, const int64_t* a, const int64_t* b, uint8_t* out, size_t n) {
+    compareLoop(op, a, b, out, n);
+}
+
+void compareFloat(Compare op, const double* a, const double* b, uint8_t* out, size_t n) {
+    compareLoop(op, a, b, out, n);
+}
+
+void widen(const int64_t* a, double* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = static_cast<double>(a[i]);
+}
+
+} // namespace
+
+extern const KernelTable table;
+const KernelTable table = {
+    PULSE_KERNEL_NAME,
+    sumInt, sumFloat,
+    minInt, maxInt, minFloat, maxFloat, anyNaN,
+    iota,
+    arithInt, arithFloat, negateInt, negateFloat,
+    compareInt, compareFloat,
+    widen,
+};
+
+} // namespace pulse::runtime::kernels::PULSE_KERNEL_ISA
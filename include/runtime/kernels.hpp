@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pulse::runtime::kernels {
+
+// Numeric loops over the unboxed storage of lists. Each is built once per
+// instruction set (see kernel_loops.hpp) and the best one the CPU runs is
+// picked on first use. Every build gives bit-identical results: reductions
+// keep LANES partial results combined in a fixed order, whatever the vector
+// width, and floating point is never contracted or reassociated. A float
+// sum is the exception: it has no lanes, so it rounds as the VM's `+` does.
+
+constexpr size_t LANES = 8;
+
+enum class Arith : uint8_t { ADD, SUB, MUL };
+enum class Compare : uint8_t { EQ, NE, LT, LE, GT, GE };
+
+struct KernelTable {
+    const char* name;
+
+    // Integer arithmetic wraps, like the VM's
+    int64_t (*sumInt)(const int64_t* x, size_t n);
+    // start + x[0] + x[1] + ..., left to right
+    double (*sumFloat)(double start, const double* x, size_t n);
+    // n > 0. The float ones assume no NaN, and return some zero of the
+    // minimum when it is zero, not necessarily the first one.
+    int64_t (*minInt)(const int64_t* x, size_t n);
+    int64_t (*maxInt)(const int64_t* x, size_t n);
+    double (*minFloat)(const double* x, size_t n);
+    double (*maxFloat)(const double* x, size_t n);
+    bool (*anyNaN)(const double* x, size_t n);
+
+    // out[i] = start + i * step
+    void (*iota)(int64_t* out, size_t n, int64_t start, int64_t step);
+    // out[i] = a[i] op b[i]; out may be a or b
+    void (*arithInt)(Arith op, const int64_t* a, const int64_t* b, int64_t* out, size_t n);
+    void (*arithFloat)(Arith op, const double* a, const double* b, double* out, size_t n);
+    void (*negateInt)(const int64_t* a, int64_t* out, size_t n);
+    void (*negateFloat)(const double* a, double* out, size_t n);
+    // out[i] = a[i] op b[i] as 0 or 1
+    void (*compareInt)(Compare op, const int64_t* a, const int64_t* b, uint8_t* out, size_t n);
+    void (*compareFloat)(Compare op, const double* a, const double* b, uint8_t* out, size_t n);
+    // out[i] = double(a[i])
+    void (*widen)(const int64_t* a, double* out, size_t n);
+};
+
+// The table in use: the widest of AVX-512, AVX2, SSE4.2 (x86) or NEON
+// (AArch64) the CPU supports, else portable loops. $PULSE_SIMD set to
+// generic, sse4.2, avx2 or avx512 caps the choice.
+const KernelTable& active();
+
+} // namespace pulse::runtime::kernels
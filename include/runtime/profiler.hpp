@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace pulse::runtime {
+
+struct FunctionProto;
+class VM;
+
+// Sampling profiler of the VM (pulse run --profile). A thread interrupts the
+// VM's thread with SIGPROF RATE times a second of wall-clock time; the
+// handler copies the call stack (VM::sampleStack) into a free slot of a
+// ring, without allocating or locking, and the thread adds the filled slots
+// to a count per distinct stack. A function running as native code is the
+// innermost frame, named "f [native]".
+//
+// The counts come out as folded stacks, the input of flamegraph.pl, inferno
+// and speedscope, and as a pprof profile for go tool pprof. Names are
+// looked up by the caller once sampling stopped, while the functions are
+// still alive. Not available on Windows.
+class Profiler {
+public:
+    static constexpr unsigned DEFAULT_RATE = 997; // Hz; off the beat of periodic work
+    static constexpr size_t MAX_FRAMES = 128;     // innermost frames kept per sample
+    static constexpr size_t SLOTS = 256;
+
+    explicit Profiler(const VM& vm, unsigned rate = DEFAULT_RATE);
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // Sample the calling thread, the VM's, until stop(). One profiler may
+    // run at a time.
+    void start();
+    void stop();
+
+    uint64_t getSamples() const { return samples; }
+    // Samples lost because the ring was full
+    uint64_t getDropped() const { return dropped.load(); }
+    unsigned getRate() const { return rate; }
+
+    // One line per distinct stack: "outer;...;inner count"
+    std::string folded() const;
+    // A perftools.profiles.Profile, serialized (pprof also reads it
+    // uncompressed); program names the source file of the functions
+    std::string pprof(const std::string& program) const;
+
+private:
+    struct Slot {
+        std::atomic<bool> full{false};
+        bool native;
+        uint32_t depth;
+        const FunctionProto* frames[MAX_FRAMES];
+    };
+    // Outermost first; true when the innermost ran as native code
+    using Stack = std::pair<std::vector<const FunctionProto*>, bool>;
+
+    const VM& vm;
+    unsigned rate;
+    std::array<Slot, SLOTS> slots;
+    uint32_t writeIndex = 0; // the handler's
+    uint32_t readIndex = 0;  // the sampling thread's
+    std::atomic<uint64_t> dropped{0};
+    uint64_t samples = 0;
+    std::map<Stack, uint64_t> stacks;
+
+    bool running = false;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread thread;
+    std::chrono::system_clock::time_point started;
+    std::chrono::nanoseconds duration{0};
+
+    static void handleSignal(int signal);
+    // In the handler: one sample of the VM's stack
+    void record() noexcept;
+    // On the sampling thread: count the filled slots
+    void collect();
+};
+
+// --profile-calls: the functions the VM counted, by inclusive time, as a
+// table for stderr
+std::string callReport(const VM& vm);
+
+} // namespace pulse::runtime
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "parser/ast.hpp"
+#include "runtime/symbols.hpp"
+
+namespace pulse::runtime {
+
+// Where a variable lives at run time
+struct VariableSlot {
+    enum class Kind : uint8_t {
+        LOCAL,  // frame slot: `depth` frames up the static chain, at `index`
+        GLOBAL  // module scope, by interned name
+    };
+
+    Kind kind = Kind::GLOBAL;
+    uint16_t depth = 0; // 0: the current function; >0: captured from an enclosing one
+    uint32_t index = 0;
+    Symbol symbol{};
+};
+
+// Slot layout of one function frame: the parameters in order, then every
+// other name the function assigns (Python scoping: assigned anywhere means
+// local everywhere in the body)
+struct FrameLayout {
+    std::vector<std::string_view> names; // by slot, for debugging and error messages
+    size_t parameterCount = 0;
+
+    size_t size() const { return names.size(); }
+};
+
+// Resolves every variable reference of a program once, before execution, so
+// the interpreter never looks a name up by string: reads and writes inside a
+// function become (depth, slot) frame accesses, module-level ones symbol
+// lookups in the global table.
+class Resolver : private pulse::parser::StaticASTVisitor<Resolver> {
+public:
+    explicit Resolver(pulse::parser::Program* program);
+
+    // The variable read or written by an IdentifierExpression, or assigned
+    // by an AssignmentStatement or ForStatement
+    const VariableSlot& slotFor(const pulse::parser::ASTNode* node) const;
+
+    const FrameLayout& frameFor(const pulse::parser::FunctionDeclaration* decl) const;
+
+private:
+    friend class pulse::parser::StaticASTVisitor<Resolver>;
+
+    struct Scope {
+        FrameLayout* layout;
+        std::unordered_map<std::string_view, uint32_t> slots;
+    };
+
+    std::unordered_map<const pulse::parser::ASTNode*, VariableSlot> resolved;
+    std::unordered_map<const pulse::parser::FunctionDeclaration*, FrameLayout> frames;
+    std::vector<Scope> scopes; // enclosing functions, innermost last; empty at module level
+
+    void declareLocals(Scope& scope, const pulse::parser::ArenaVector<pulse::parser::StatementPtr>& body);
+    void declare(Scope& scope, std::string_view name);
+    void bind(const pulse::parser::ASTNode* node, std::string_view name);
+    void resolveBlock(const pulse::parser::ArenaVector<pulse::parser::StatementPtr>& body);
+    void resolve(pulse::parser::ASTNode* node);
+
+    // Expressions
+    void visitIdentifierExpression(pulse::parser::IdentifierExpression* expr);
+    void visitBinaryExpression(pulse::parser::BinaryExpression* expr);
+    void visitUnaryExpression(pulse::parser::UnaryExpression* expr);
+    void visitCallExpression(pulse::parser::CallExpression* expr);
+    void visitAttributeExpression(pulse::parser::AttributeExpression* expr);
+    void visitSubscriptExpression(pulse::parser::SubscriptExpression* expr);
+    void visitListExpression(pulse::parser::ListExpression* expr);
+    void visitDictExpression(pulse::parser::DictExpression* expr);
+    void visitTupleExpression(pulse::parser::TupleExpression* expr);
+
+    // Statements
+    void visitAssignmentStatement(pulse::parser::AssignmentStatement* stmt);
+    void visitExpressionStatement(pulse::parser::ExpressionStatement* stmt);
+    void visitReturnStatement(pulse::parser::ReturnStatement* stmt);
+    void visitIfStatement(pulse::parser::IfStatement* stmt);
+    void visitWhileStatement(pulse::parser::WhileStatement* stmt);
+    void visitForStatement(pulse::parser::ForStatement* stmt);
+    void visitMatchStatement(pulse::parser::MatchStatement* stmt);
+
+    // Declarations
+    void visitFunctionDeclaration(pulse::parser::FunctionDeclaration* decl);
+    void visitClassDeclaration(pulse::parser::ClassDeclaration* decl);
+};
+
+} // namespace pulse::runtime
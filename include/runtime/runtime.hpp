@@ -1,167 +1,79 @@
 #pragma once
 
 #include <memory>
+#include <span>
 #include <string>
 #include <vector>
 #include <map>
-#include <functional>
-#include <variant>
+#include <unordered_map>
+#include "runtime/symbols.hpp"
+#include "runtime/value.hpp"
 
 namespace pulse::runtime {
 
-// Forward declarations
-class RuntimeValue;
-class RuntimeFunction;
-class RuntimeContext;
-
-// Type definitions
-using RuntimeValuePtr = std::unique_ptr<RuntimeValue>;
-using RuntimeFunctionPtr = std::unique_ptr<RuntimeFunction>;
-
-// Runtime value types
-enum class ValueType {
-    NONE,
-    INTEGER,
-    FLOAT,
-    BOOLEAN,
-    STRING,
-    LIST,
-    DICT,
-    FUNCTION,
-    CLASS_INSTANCE
-};
-
-// Base runtime value class
-class RuntimeValue {
-public:
-    virtual ~RuntimeValue() = default;
-    virtual ValueType getType() const = 0;
-    virtual std::string toString() const = 0;
-    virtual RuntimeValuePtr clone() const = 0;
-};
-
-// Integer value
-class IntegerValue : public RuntimeValue {
-public:
-    int64_t value;
-    
-    explicit IntegerValue(int64_t val) : value(val) {}
-    
-    ValueType getType() const override { return ValueType::INTEGER; }
-    std::string toString() const override { return std::to_string(value); }
-    RuntimeValuePtr clone() const override { return std::make_unique<IntegerValue>(value); }
-};
-
-// Float value
-class FloatValue : public RuntimeValue {
-public:
-    double value;
-    
-    explicit FloatValue(double val) : value(val) {}
-    
-    ValueType getType() const override { return ValueType::FLOAT; }
-    std::string toString() const override { return std::to_string(value); }
-    RuntimeValuePtr clone() const override { return std::make_unique<FloatValue>(value); }
-};
+struct FunctionProto;
+class NativeTier;
+class Scheduler;
+class VM;
 
-// Boolean value
-class BooleanValue : public RuntimeValue {
-public:
-    bool value;
-    
-    explicit BooleanValue(bool val) : value(val) {}
-    
-    ValueType getType() const override { return ValueType::BOOLEAN; }
-    std::string toString() const override { return value ? "True" : "False"; }
-    RuntimeValuePtr clone() const override { return std::make_unique<BooleanValue>(value); }
-};
-
-// String value
-class StringValue : public RuntimeValue {
-public:
-    std::string value;
-    
-    explicit StringValue(const std::string& val) : value(val) {}
-    
-    ValueType getType() const override { return ValueType::STRING; }
-    std::string toString() const override { return value; }
-    RuntimeValuePtr clone() const override { return std::make_unique<StringValue>(value); }
-};
-
-// List value
-class ListValue : public RuntimeValue {
-public:
-    std::vector<RuntimeValuePtr> elements;
-    
-    explicit ListValue(std::vector<RuntimeValuePtr> elems = {}) : elements(std::move(elems)) {}
-    
-    ValueType getType() const override { return ValueType::LIST; }
-    std::string toString() const override;
-    RuntimeValuePtr clone() const override;
-    
-    void append(RuntimeValuePtr element);
-    RuntimeValuePtr get(size_t index) const;
-    void set(size_t index, RuntimeValuePtr value);
-    size_t size() const { return elements.size(); }
-};
-
-// Dictionary value
-class DictValue : public RuntimeValue {
-public:
-    std::map<std::string, RuntimeValuePtr> pairs;
-    
-    explicit DictValue(std::map<std::string, RuntimeValuePtr> p = {}) : pairs(std::move(p)) {}
-    
-    ValueType getType() const override { return ValueType::DICT; }
-    std::string toString() const override;
-    RuntimeValuePtr clone() const override;
-    
-    void set(const std::string& key, RuntimeValuePtr value);
-    RuntimeValuePtr get(const std::string& key) const;
-    bool hasKey(const std::string& key) const;
-    std::vector<std::string> keys() const;
-};
-
-// Function value
-class RuntimeFunction : public RuntimeValue {
-public:
-    using FunctionPtr = std::function<RuntimeValuePtr(const std::vector<RuntimeValuePtr>&)>;
-    
-    std::string name;
-    FunctionPtr function;
-    std::vector<std::string> parameterNames;
-    
-    RuntimeFunction(const std::string& funcName, FunctionPtr func, 
-                   std::vector<std::string> params = {})
-        : name(funcName), function(std::move(func)), parameterNames(std::move(params)) {}
-    
-    ValueType getType() const override { return ValueType::FUNCTION; }
-    std::string toString() const override { return "<function " + name + ">"; }
-    RuntimeValuePtr clone() const override { return std::make_unique<RuntimeFunction>(name, function, parameterNames); }
-    
-    RuntimeValuePtr call(const std::vector<RuntimeValuePtr>& arguments);
-};
-
-// Runtime context for variable scope management
+// Runtime context for variable scope management. A context is either a named
+// scope (module globals, the REPL), keyed by interned symbol, or a function
+// frame: a contiguous array of slots laid out by the Resolver, where a
+// variable access is one indexed load.
 class RuntimeContext {
 public:
+    using SymbolMap = std::unordered_map<Symbol, Value>;
+
+    // Named scope
     RuntimeContext(RuntimeContext* parent = nullptr);
+
+    // Frame with slotCount slots, all None
+    RuntimeContext(size_t slotCount, RuntimeContext* parent);
     
-    void setVariable(const std::string& name, RuntimeValuePtr value);
-    RuntimeValuePtr getVariable(const std::string& name) const;
+    void setVariable(const std::string& name, Value value);
+    // A shared reference to the value (None when undefined); nothing is copied
+    Value getVariable(const std::string& name) const;
     bool hasVariable(const std::string& name) const;
     void removeVariable(const std::string& name);
+
+    // Named access by symbol, searching the parents; null when undefined
+    Value* findVariable(Symbol symbol);
+    const Value* findVariable(Symbol symbol) const;
+    void setVariable(Symbol symbol, Value value);
+    // This scope's binding for symbol, created as None if missing. The
+    // reference stays valid until the name is removed.
+    Value& bindVariable(Symbol symbol) { return variables[symbol]; }
+    // Bumped whenever a binding is removed; caches of binding addresses
+    // compare it to know they are still valid
+    uint64_t getGeneration() const { return generation; }
+    // Invalidate those caches without removing anything (a function
+    // binding was replaced, see NativeCode)
+    void bumpGeneration() { generation++; }
+
+    // Frame access. depth counts static parents: 0 is this frame, 1 the
+    // enclosing function's, and so on (Resolver's VariableSlot).
+    Value& slot(uint32_t index) { return slots[index]; }
+    Value& slot(uint16_t depth, uint32_t index) {
+        RuntimeContext* frame = this;
+        while (depth-- > 0) frame = frame->parent;
+        return frame->slots[index];
+    }
+    std::span<Value> getSlots() { return slots; }
+    size_t slotCount() const { return slots.size(); }
     
     // Scope management
     RuntimeContext* getParent() const { return parent; }
     std::unique_ptr<RuntimeContext> createChildScope();
+    std::unique_ptr<RuntimeContext> createFrame(size_t slotCount);
     
-    // Get all variables in current scope
-    std::map<std::string, RuntimeValuePtr> getVariables() const;
+    // Named variables of this scope, by reference
+    const SymbolMap& getVariables() const { return variables; }
 
 private:
-    std::map<std::string, RuntimeValuePtr> variables;
+    SymbolMap variables;
+    std::vector<Value> slots;
     RuntimeContext* parent;
+    uint64_t generation = 0;
 };
 
 // Main runtime system
@@ -173,14 +85,48 @@ public:
     // Initialize runtime with standard library
     void initialize();
     
-    // Execute code
-    RuntimeValuePtr execute(const std::string& code);
+    // Execute code on the bytecode VM: lex, parse, resolve, compile and run
+    // against the global scope, which persists across calls (the REPL runs
+    // each input this way). Returns the value of a final expression
+    // statement, else None. Throws LexError or ParseError for syntax errors
+    // and RuntimeError when execution fails.
+    Value execute(const std::string& code);
+
+    // The two halves of execute(): compile a chunk, then run it
+    std::shared_ptr<FunctionProto> compile(const std::string& code);
+    Value run(const std::shared_ptr<FunctionProto>& chunk);
+
+    // Continue a coroutine on the VM: true once it returned (result set),
+    // false when it suspended at an await
+    bool resume(CoroutineObject& coroutine, Value& result);
+
+    // The event loop coroutines and sockets run on
+    Scheduler& getScheduler() const { return *scheduler; }
+    // The bytecode VM, for the profiler
+    VM& getVM() const { return *vm; }
     
     // Get global context
     RuntimeContext* getGlobalContext() const;
+
+    // Tiered execution: hot functions of chunks compiled from now on are
+    // handed to tier. Null (the default) interprets everything.
+    void setNativeTier(std::unique_ptr<NativeTier> tier);
+    NativeTier* getNativeTier() const { return nativeTier.get(); }
     
     // Standard library functions
     void setupStandardLibrary();
+
+    // Bind a native function in the global scope; arity -1 is variadic
+    void defineNative(const std::string& name, NativeFunction function, int arity = -1);
+
+    // Call a function value. The arguments stay owned by the caller.
+    Value call(const Value& callee, std::span<const Value> args);
+
+    // Methods of built-in types (list.append, str.split, ...). The receiver
+    // is passed as the first argument and counts toward the arity.
+    void defineMethod(ValueType type, const std::string& name, NativeFunction function, int arity = -1);
+    // Null when values of type have no such method
+    const Value* findMethod(ValueType type, Symbol name) const;
     
     // Error handling
     void reportError(const std::string& message);
@@ -189,15 +135,57 @@ public:
 
 private:
     std::unique_ptr<RuntimeContext> globalContext;
+    // Destroyed after the VM and before the functions it compiled code for
+    std::unique_ptr<NativeTier> nativeTier;
+    std::unique_ptr<VM> vm;
+    // Destroyed before the VM: its coroutines hold frames of VM code
+    std::unique_ptr<Scheduler> scheduler;
+    std::vector<RuntimeContext::SymbolMap> methods; // by ValueType
     std::vector<std::string> errors;
     
     // Standard library functions
-    RuntimeValuePtr printFunction(const std::vector<RuntimeValuePtr>& args);
-    RuntimeValuePtr lenFunction(const std::vector<RuntimeValuePtr>& args);
-    RuntimeValuePtr strFunction(const std::vector<RuntimeValuePtr>& args);
-    RuntimeValuePtr intFunction(const std::vector<RuntimeValuePtr>& args);
-    RuntimeValuePtr floatFunction(const std::vector<RuntimeValuePtr>& args);
-    RuntimeValuePtr boolFunction(const std::vector<RuntimeValuePtr>& args);
+    static Value printFunction(Runtime& runtime, std::span<const Value> args);
+    static Value lenFunction(Runtime& runtime, std::span<const Value> args);
+    static Value strFunction(Runtime& runtime, std::span<const Value> args);
+    static Value intFunction(Runtime& runtime, std::span<const Value> args);
+    static Value floatFunction(Runtime& runtime, std::span<const Value> args);
+    static Value boolFunction(Runtime& runtime, std::span<const Value> args);
+    static Value rangeFunction(Runtime& runtime, std::span<const Value> args);
+
+    // Numeric builtins (numeric.cpp), vectorized over int and float lists
+    static Value sumFunction(Runtime& runtime, std::span<const Value> args);
+    static Value minFunction(Runtime& runtime, std::span<const Value> args);
+    static Value maxFunction(Runtime& runtime, std::span<const Value> args);
+    static Value absFunction(Runtime& runtime, std::span<const Value> args);
+    static Value mapFunction(Runtime& runtime, std::span<const Value> args);
+    static Value filterFunction(Runtime& runtime, std::span<const Value> args);
+
+    // Coroutine builtins (scheduler.cpp)
+    static Value runFunction(Runtime& runtime, std::span<const Value> args);
+    static Value spawnFunction(Runtime& runtime, std::span<const Value> args);
+    static Value sleepFunction(Runtime& runtime, std::span<const Value> args);
+    static Value gatherFunction(Runtime& runtime, std::span<const Value> args);
+
+    // Non-blocking TCP sockets served by the Scheduler (sockets.cpp)
+    static Value listenFunction(Runtime& runtime, std::span<const Value> args);
+    static Value acceptFunction(Runtime& runtime, std::span<const Value> args);
+    static Value connectFunction(Runtime& runtime, std::span<const Value> args);
+    static Value recvFunction(Runtime& runtime, std::span<const Value> args);
+    static Value sendFunction(Runtime& runtime, std::span<const Value> args);
+    static Value closeFunction(Runtime& runtime, std::span<const Value> args);
+
+    // Built-in methods; args[0] is the receiver
+    static Value listAppend(Runtime& runtime, std::span<const Value> args);
+    static Value listPop(Runtime& runtime, std::span<const Value> args);
+    static Value dictGet(Runtime& runtime, std::span<const Value> args);
+    static Value dictKeys(Runtime& runtime, std::span<const Value> args);
+    static Value dictValues(Runtime& runtime, std::span<const Value> args);
+    static Value dictItems(Runtime& runtime, std::span<const Value> args);
+    static Value stringUpper(Runtime& runtime, std::span<const Value> args);
+    static Value stringLower(Runtime& runtime, std::span<const Value> args);
+    static Value stringStrip(Runtime& runtime, std::span<const Value> args);
+    static Value stringSplit(Runtime& runtime, std::span<const Value> args);
+    static Value stringJoin(Runtime& runtime, std::span<const Value> args);
 };
 
 } // namespace pulse::runtime 
\ No newline at end of file
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+#include "runtime/value.hpp"
+
+namespace pulse::driver {
+class ThreadPool;
+}
+
+namespace pulse::runtime {
+
+class Runtime;
+class Reactor;
+
+// Event loop of a Runtime's coroutines. Coroutines run on the runtime's
+// thread, one at a time, from a ready queue: a coroutine runs until it awaits
+// something still pending, which registers it as a waiter and suspends it;
+// completing that coroutine or future queues its waiters again. Whatever
+// nothing is ready for waits in one place:
+//
+// - timers (sleep()), kept in a deadline heap;
+// - sockets, through a Reactor (epoll on Linux, poll() on other systems):
+//   a pending operation is retried when its descriptor becomes ready, so
+//   ten thousand idle connections cost ten thousand suspended frames, not
+//   ten thousand threads;
+// - blocking calls with no readiness to wait for (DNS lookups), which run
+//   on a work-stealing driver::ThreadPool and complete through the reactor.
+//
+// Values are reference-counted without atomics and belong to their thread's
+// Heap, so no Value ever crosses to a worker: offload() work sees only
+// plain C++ data, and its completion runs back on the loop's thread.
+class Scheduler {
+public:
+    // Workers for offload(), started on first use
+    static constexpr size_t WORKERS = 4;
+
+    explicit Scheduler(Runtime& runtime);
+    ~Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    // run(awaitable): the event loop, until awaitable completes. Returns its
+    // result, or throws its error. Not reentrant.
+    Value run(const Value& awaitable);
+
+    // Queue a coroutine that has not started yet (spawn())
+    void start(CoroutineObject& coroutine);
+
+    // AWAIT of waiter on awaited: true with the result stored when awaited
+    // has completed (throws its error when it failed); false once waiter is
+    // registered to be resumed, and must suspend
+    bool await(CoroutineObject& waiter, const Value& awaited, Value& result);
+
+    // Completing a native future queues its waiters
+    void resolve(FutureObject& future, Value result);
+    void fail(FutureObject& future, std::string error);
+
+    // gather(): one future completed with the list of the results of parts
+    Value gather(std::vector<Value> parts);
+
+    // A future completing after seconds
+    Value sleep(double seconds);
+
+    // Retries attempt on the loop's thread each time fd may be read (or
+    // written, when write is set) until it returns true, having resolved or
+    // failed future. One operation per direction at a time.
+    using Attempt = std::function<bool(FutureObject& future)>;
+    void watch(int fd, bool write, const Value& future, Attempt attempt);
+    // Drops the descriptor's operations, failing their futures (closing it)
+    void unwatch(int fd);
+
+    // Runs work on a worker thread, then finish on the loop's thread. work
+    // must not touch Values, nor capture any.
+    void offload(std::function<void()> work, std::function<void()> finish);
+
+    // The completion of a coroutine or future; null for other values
+    static Completion* completionOf(const Value& value);
+
+private:
+    struct Timer {
+        std::chrono::steady_clock::time_point deadline;
+        uint64_t sequence; // equal deadlines fire in the order they were set
+        Value future;
+
+        bool operator>(const Timer& other) const {
+            return deadline != other.deadline ? deadline > other.deadline : sequence > other.sequence;
+        }
+    };
+
+    struct Operation {
+        Value future; // None while idle
+        Attempt attempt;
+    };
+
+    struct Watch {
+        Operation read;
+        Operation write;
+    };
+
+    Runtime& runtime;
+    bool running = false;
+    const Completion* target = nullptr; // what run() waits for
+    std::deque<Value> ready;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    uint64_t timerSequence = 0;
+    std::unordered_map<int, Watch> watches;
+    size_t operations = 0; // pending socket operations
+    std::unique_ptr<Reactor> reactor;
+
+    // offload(): completions still to run, by job, and the jobs the workers
+    // finished since the loop last looked
+    std::unordered_map<uint64_t, std::function<void()>> finishers;
+    uint64_t nextJob = 0;
+    std::mutex finishedMutex;
+    std::vector<uint64_t> finished;
+    // Last: destroying it joins the workers, which may still post above
+    std::unique_ptr<pulse::driver::ThreadPool> pool;
+
+    Reactor& getReactor();
+    void schedule(CoroutineObject& coroutine, bool next = false);
+    // Resume one coroutine until it suspends or finishes
+    void step(CoroutineObject& coroutine);
+    // Record the outcome and queue (or tell) the waiters
+    void settle(Completion& completion);
+    void gatherStep(FutureObject& gathering, const Completion& part);
+    void fireTimers();
+    // Wait up to timeout for sockets and worker completions (-1: no limit)
+    void poll(int timeoutMilliseconds);
+    // Retry the operations of a descriptor the reactor reported ready
+    void dispatch(int fd, bool readable, bool writable);
+    void runFinished();
+    void updateInterest(int fd);
+};
+
+} // namespace pulse::runtime
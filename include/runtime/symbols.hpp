@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace pulse::runtime {
+
+// Interned identifier. Equal names always map to the same symbol, so scopes
+// hash and compare a 32-bit id instead of the string.
+enum class Symbol : uint32_t {};
+
+// Process-wide intern table. Names are interned when code is compiled or a
+// native is defined, never on the variable-access path.
+class SymbolTable {
+public:
+    static SymbolTable& global();
+
+    Symbol intern(std::string_view name);
+
+    // The symbol for name if it was ever interned
+    bool find(std::string_view name, Symbol& symbol) const;
+
+    std::string_view name(Symbol symbol) const;
+
+private:
+    SymbolTable() = default;
+
+    mutable std::shared_mutex mutex;
+    std::deque<std::string> names; // stable storage for the keys below
+    std::unordered_map<std::string_view, Symbol> ids;
+};
+
+inline Symbol intern(std::string_view name) {
+    return SymbolTable::global().intern(name);
+}
+
+inline std::string_view symbolName(Symbol symbol) {
+    return SymbolTable::global().name(symbol);
+}
+
+} // namespace pulse::runtime
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "runtime/value.hpp"
+
+namespace pulse::parser {
+    class Program;
+    class FunctionDeclaration;
+}
+
+namespace pulse::runtime {
+
+// Tiered execution. The VM counts the calls and loop back-edges of every
+// top-level function and records the argument types seen at each call site.
+// A function that gets hot is handed to a NativeTier, which compiles a
+// specialization for those argument types on a background thread and
+// publishes it on the function's TierProfile. From then on calls whose
+// arguments have exactly those types run the native code; any other call
+// (the type guard failing) keeps running the bytecode.
+
+// Argument types packed four bits per argument, the first in the low bits
+using Shape = uint32_t;
+
+constexpr size_t MAX_SHAPE_ARGUMENTS = 8;
+constexpr Shape NO_SHAPE = UINT32_MAX; // more arguments than a shape holds
+
+// Calls, or loop back-edges, since the last request that make a function hot.
+// Back-edges only pay off from the next call on: a running frame stays in
+// the interpreter.
+constexpr uint32_t CALL_THRESHOLD = 1000;
+constexpr uint32_t LOOP_THRESHOLD = 20000;
+
+// Distinct argument shapes one function is compiled for at most
+constexpr size_t MAX_SPECIALIZATIONS = 4;
+
+inline Shape argumentShape(const Value* args, size_t argc) {
+    if (argc > MAX_SHAPE_ARGUMENTS) return NO_SHAPE;
+    Shape shape = 0;
+    for (size_t i = 0; i < argc; i++) {
+        shape |= static_cast<Shape>(args[i].getType()) << (4 * i);
+    }
+    return shape;
+}
+
+inline ValueType shapeArgument(Shape shape, size_t index) {
+    return static_cast<ValueType>((shape >> (4 * index)) & 0xF);
+}
+
+static_assert(static_cast<int>(ValueType::FUTURE) < 16, "Value types must fit a shape's four bits");
+
+// Native entry point: takes the raw payloads of the arguments (int64, the
+// bits of a double, or 0/1) and returns the result's the same way
+using NativeEntry = uint64_t (*)(const uint64_t* args);
+
+// One native specialization. Native code calls the other functions of its
+// program directly, so it is only valid while the global scope's generation
+// (bumped when a function binding is replaced) is the one it was requested at.
+struct NativeCode {
+    Shape shape;
+    ValueType returnType; // BOOL, INT or FLOAT
+    uint64_t generation;
+    NativeEntry entry;
+    const NativeCode* next; // the function's other specializations
+};
+
+// Type profile of one CALL instruction (its c operand)
+struct CallSite {
+    Shape shape = NO_SHAPE;
+    bool polymorphic = false;
+
+    void record(Shape seen) {
+        if (shape == NO_SHAPE) {
+            shape = seen;
+        } else if (shape != seen) {
+            polymorphic = true;
+        }
+    }
+};
+
+// Profile and native code of a function. The counters are the interpreter
+// thread's; the compile thread only reads the source and publishes `native`.
+// No Value is reachable from here, so the compile thread never touches a
+// reference count.
+struct TierProfile {
+    std::shared_ptr<const pulse::parser::Program> source;
+    const pulse::parser::FunctionDeclaration* declaration = nullptr;
+
+    uint32_t calls = 0;
+    uint32_t backEdges = 0;
+    Shape lastShape = NO_SHAPE; // arguments of the latest profiled call
+    std::vector<Shape> requested;
+    bool profiling = true; // false once MAX_SPECIALIZATIONS were requested
+
+    // Newest first; entries are owned by the NativeTier
+    std::atomic<const NativeCode*> native{nullptr};
+};
+
+// Second execution tier (the LLVM JIT, see compiler/tiered_jit.hpp)
+class NativeTier {
+public:
+    virtual ~NativeTier() = default;
+
+    // Compile the profiled function for the argument types in shape without
+    // blocking the caller; on success the code appears on profile->native.
+    // Functions that native code cannot run exactly like the bytecode are
+    // quietly left to the interpreter.
+    virtual void request(std::shared_ptr<TierProfile> profile, Shape shape, uint64_t generation) = 0;
+};
+
+} // namespace pulse::runtime
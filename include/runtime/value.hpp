@@ -0,0 +1,466 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "runtime/heap.hpp"
+#include "runtime/symbols.hpp"
+
+namespace pulse::runtime {
+
+class Object;
+class ContainerObject;
+class Runtime;
+struct FunctionProto;
+
+// Runtime value types
+enum class ValueType : uint8_t {
+    NONE,
+    INTEGER,
+    FLOAT,
+    BOOLEAN,
+    STRING,
+    LIST,
+    DICT,
+    FUNCTION,
+    CLASS,
+    CLASS_INSTANCE,
+    COROUTINE,
+    FUTURE
+};
+
+// Python-style type name ("int", "str", ...) for messages
+const char* typeName(ValueType type);
+
+// Raised for type, value and name errors during execution; the message starts
+// with the Python-style error class, e.g. "TypeError: ..."
+class RuntimeError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// A Pulse value in 16 bytes: an 8-byte payload and a tag. None, bools, ints and
+// floats live inline, so arithmetic never allocates; strings, lists, dicts,
+// functions and instances are reference-counted heap objects shared between
+// copies (copying a Value is a refcount increment, never a deep copy).
+class Value {
+public:
+    enum class Tag : uint8_t { NONE, BOOL, INT, FLOAT, OBJECT };
+
+    Value() noexcept : tag(Tag::NONE) { payload.integer = 0; }
+
+    static Value none() noexcept { return Value(); }
+    static Value fromBool(bool value) noexcept { Value v(Tag::BOOL); v.payload.boolean = value; return v; }
+    static Value fromInt(int64_t value) noexcept { Value v(Tag::INT); v.payload.integer = value; return v; }
+    static Value fromFloat(double value) noexcept { Value v(Tag::FLOAT); v.payload.number = value; return v; }
+
+    // Takes a reference to object
+    explicit Value(Object* object) noexcept;
+
+    // Allocate a heap object on the thread's Heap and wrap it
+    template <typename T, typename... Args>
+    static Value make(Args&&... args) {
+        Heap& heap = Heap::current();
+        if constexpr (std::is_base_of_v<ContainerObject, T>) heap.beforeContainer();
+        void* memory = heap.allocate(sizeof(T));
+        T* object;
+        try {
+            object = new (memory) T(std::forward<Args>(args)...);
+        } catch (...) {
+            heap.release(memory, sizeof(T));
+            throw;
+        }
+        if constexpr (std::is_base_of_v<ContainerObject, T>) heap.track(object);
+        return Value(object);
+    }
+
+    Value(const Value& other) noexcept : payload(other.payload), tag(other.tag) { retain(); }
+    Value(Value&& other) noexcept : payload(other.payload), tag(other.tag) { other.tag = Tag::NONE; }
+    ~Value() { release(); }
+
+    Value& operator=(const Value& other) noexcept {
+        Value copy(other);
+        swap(copy);
+        return *this;
+    }
+
+    Value& operator=(Value&& other) noexcept {
+        Value moved(std::move(other));
+        swap(moved);
+        return *this;
+    }
+
+    void swap(Value& other) noexcept {
+        std::swap(payload, other.payload);
+        std::swap(tag, other.tag);
+    }
+
+    Tag getTag() const { return tag; }
+    ValueType getType() const;
+
+    bool isNone() const { return tag == Tag::NONE; }
+    bool isBool() const { return tag == Tag::BOOL; }
+    bool isInt() const { return tag == Tag::INT; }
+    bool isFloat() const { return tag == Tag::FLOAT; }
+    bool isObject() const { return tag == Tag::OBJECT; }
+    bool isNumber() const { return tag == Tag::BOOL || tag == Tag::INT || tag == Tag::FLOAT; }
+
+    // Unchecked accessors; test the tag first
+    bool asBool() const { return payload.boolean; }
+    int64_t asInt() const { return payload.integer; }
+    double asFloat() const { return payload.number; }
+    Object* asObject() const { return payload.object; }
+
+    // The object as T when it is one, else null
+    template <typename T>
+    T* as() const;
+
+    // Numeric value as a double (bools and ints promote)
+    double toFloat() const;
+
+    // Python truthiness: 0, 0.0, None, False and empty containers are false
+    bool truthy() const;
+
+    // str(value), and repr(value) as used inside containers ('quoted' strings);
+    // tuples show as (a, b) and (a,)
+    std::string toString() const;
+    std::string repr() const;
+
+    // Python equality: 1 == 1.0 == True, strings and containers by content
+    bool operator==(const Value& other) const;
+    bool operator!=(const Value& other) const { return !(*this == other); }
+
+    // Consistent with ==; throws RuntimeError for unhashable lists and dicts,
+    // and for tuples holding one
+    size_t hash() const;
+
+private:
+    explicit Value(Tag tag) noexcept : tag(tag) {}
+
+    void retain() const noexcept;
+    void release() noexcept;
+
+    union {
+        bool boolean;
+        int64_t integer;
+        double number;
+        Object* object;
+    } payload;
+    Tag tag;
+};
+
+static_assert(sizeof(Value) == 16, "Value must stay two words");
+
+// Native function ABI: arguments are borrowed from the caller's registers or
+// stack, so a call builds no vector and copies no values
+using NativeFunction = Value (*)(Runtime& runtime, std::span<const Value> args);
+
+// Header of every heap object. Objects are reference-counted by Value and
+// destroyed through a switch on their type, so they carry no vtable.
+class Object {
+public:
+    Object(const Object&) = delete;
+    Object& operator=(const Object&) = delete;
+
+    ValueType getType() const { return type; }
+    uint32_t getRefCount() const { return refcount; }
+
+    void retain() noexcept { ++refcount; }
+    void release() noexcept {
+        if (--refcount == 0) destroy(this);
+    }
+
+protected:
+    explicit Object(ValueType type) : type(type) {}
+    ~Object() = default;
+
+private:
+    uint32_t refcount = 0;
+    ValueType type;
+
+    static void destroy(Object* object) noexcept;
+};
+
+// Objects that hold Values, and so can take part in reference cycles: the
+// Heap links them into its generations for the cycle collector
+class ContainerObject : public Object {
+protected:
+    using Object::Object;
+    ~ContainerObject() = default;
+
+private:
+    friend class Heap;
+
+    ContainerObject* gcPrev = nullptr;
+    ContainerObject* gcNext = nullptr;
+    uint32_t gcRefs = 0;    // scratch of a collection
+    uint8_t gcMark = 0;
+    bool gcOld = false;     // in the old generation
+};
+
+class StringObject : public Object {
+public:
+    static constexpr ValueType TYPE = ValueType::STRING;
+
+    std::string value;
+
+    explicit StringObject(std::string value) : Object(TYPE), value(std::move(value)) {}
+};
+
+// A list keeps its elements unboxed while they are all ints, or all floats,
+// in a plain int64_t or double array, and switches to boxed Values for good
+// the first time an element of another type is stored (it adopts the type of
+// its first element while empty again). Elements are read as Values built on
+// the fly, so reading one never allocates or clones.
+//
+// Tuples are lists marked as such: they compare equal only to tuples, hash
+// by their elements, so they can be dict keys, and have no append or pop.
+class ListObject : public ContainerObject {
+public:
+    static constexpr ValueType TYPE = ValueType::LIST;
+
+    enum class Storage : uint8_t { INT, FLOAT, VALUE };
+
+    ListObject() : ContainerObject(TYPE) {}
+    // Unboxes elements when they allow it
+    explicit ListObject(std::vector<Value> elements);
+    explicit ListObject(std::vector<int64_t> elements) : ContainerObject(TYPE), ints(std::move(elements)) {}
+    explicit ListObject(std::vector<double> elements)
+        : ContainerObject(TYPE), storage(Storage::FLOAT), floats(std::move(elements)) {}
+
+    Storage getStorage() const { return storage; }
+
+    bool isTuple() const { return tuple; }
+    // Only while the tuple is being built: no one may have seen it as a list
+    void makeTuple() { tuple = true; }
+
+    size_t size() const {
+        switch (storage) {
+            case Storage::INT: return ints.size();
+            case Storage::FLOAT: return floats.size();
+            case Storage::VALUE: break;
+        }
+        return values.size();
+    }
+
+    // Unchecked; index < size()
+    Value at(size_t index) const {
+        switch (storage) {
+            case Storage::INT: return Value::fromInt(ints[index]);
+            case Storage::FLOAT: return Value::fromFloat(floats[index]);
+            case Storage::VALUE: break;
+        }
+        return values[index];
+    }
+
+    // Python indexing (negative counts from the end); throws IndexError
+    Value get(int64_t index) const { return at(position(index)); }
+    void set(int64_t index, Value value);
+
+    void append(Value element);
+    void extend(const ListObject& other);
+    void reserve(size_t count);
+    // Removes and returns the element at index; throws IndexError
+    Value pop(int64_t index);
+    void clear();
+
+    // The elements in their storage; each is empty unless it is the storage
+    std::span<const int64_t> intElements() const { return ints; }
+    std::span<const double> floatElements() const { return floats; }
+    std::span<const Value> valueElements() const { return values; }
+
+private:
+    Storage storage = Storage::INT;
+    bool tuple = false;
+    std::vector<int64_t> ints;
+    std::vector<double> floats;
+    std::vector<Value> values;
+
+    size_t position(int64_t index) const;
+    // Whether element can be stored without boxing the list
+    bool fits(const Value& element);
+    void box();
+};
+
+// Insertion-ordered dictionary with any hashable key (numbers, strings,
+// tuples of hashable values; other objects by identity). The entries are kept in
+// insertion order, each with the hash of its key; an open-addressing index in
+// the style of SwissTable maps hashes to them: one control byte per slot
+// holding 7 bits of the hash, scanned 16 slots at a time, so a lookup
+// compares keys only on a likely match, and growing never hashes a key again.
+class DictObject : public ContainerObject {
+public:
+    static constexpr ValueType TYPE = ValueType::DICT;
+
+    struct Entry {
+        Value key;
+        Value value;
+        size_t hash;
+    };
+
+    DictObject() : ContainerObject(TYPE) {}
+
+    size_t size() const { return entries.size(); }
+    // In insertion order
+    std::span<const Entry> items() const { return entries; }
+
+    void set(const Value& key, Value value);
+    // Borrowed; null when missing
+    const Value* find(const Value& key) const;
+    bool contains(const Value& key) const { return find(key) != nullptr; }
+    void clear();
+
+private:
+    static constexpr size_t GROUP = 16;
+    static constexpr uint8_t EMPTY = 0x80;
+
+    std::vector<Entry> entries;
+    std::vector<uint8_t> control; // a multiple of GROUP slots, or none yet
+    std::vector<uint32_t> slots;  // entry index of each full control byte
+
+    // Slot holding key, or of the first empty slot on its probe sequence
+    // (slots.size() when there is no index yet)
+    size_t probe(const Value& key, size_t hash, bool& found) const;
+    void grow();
+};
+
+// A native function, or Pulse code compiled to bytecode (native is null)
+class FunctionObject : public Object {
+public:
+    static constexpr ValueType TYPE = ValueType::FUNCTION;
+
+    std::string name;
+    NativeFunction native = nullptr;
+    std::shared_ptr<FunctionProto> code;
+    // Expected argument count; -1 accepts any number
+    int arity;
+
+    FunctionObject(std::string name, NativeFunction native, int arity = -1)
+        : Object(TYPE), name(std::move(name)), native(native), arity(arity) {}
+    FunctionObject(std::string name, std::shared_ptr<FunctionProto> code, int arity)
+        : Object(TYPE), name(std::move(name)), code(std::move(code)), arity(arity) {}
+};
+
+class ClassObject : public ContainerObject {
+public:
+    static constexpr ValueType TYPE = ValueType::CLASS;
+
+    std::string name;
+    Value base; // a ClassObject, or None
+    std::unordered_map<Symbol, Value> methods;
+    uint64_t id; // never reused, unlike the address, so caches can key on it
+
+    explicit ClassObject(std::string name);
+
+    // The method here or on a base class; null when there is none
+    const Value* findMethod(Symbol name) const;
+};
+
+class InstanceObject : public ContainerObject {
+public:
+    static constexpr ValueType TYPE = ValueType::CLASS_INSTANCE;
+
+    std::string className;
+    Value cls; // the ClassObject, or None for instances built by natives
+    std::map<std::string, Value, std::less<>> fields;
+
+    explicit InstanceObject(std::string className) : ContainerObject(TYPE), className(std::move(className)) {}
+    explicit InstanceObject(const Value& cls);
+};
+
+// Outcome of a coroutine or future, and who is waiting for it: coroutines
+// to resume, or gather() futures to tell
+struct Completion {
+    enum class State : uint8_t { PENDING, DONE, FAILED };
+
+    State state = State::PENDING;
+    Value result;
+    std::string error; // the RuntimeError message when FAILED
+    std::vector<Value> waiters;
+
+    bool pending() const { return state == State::PENDING; }
+};
+
+// A call of an async function. Calling one runs nothing: the arguments wait
+// in registers until the Scheduler first resumes the coroutine. At each
+// await that cannot complete at once, the frame's registers are moved here
+// and the VM returns; resuming moves them back onto the register stack.
+class CoroutineObject : public ContainerObject {
+public:
+    static constexpr ValueType TYPE = ValueType::COROUTINE;
+
+    enum class State : uint8_t { CREATED, RUNNING, SUSPENDED, FINISHED };
+
+    Value function; // the async FunctionObject, which keeps its code alive
+    State state = State::CREATED;
+    bool queued = false;        // in the scheduler's ready queue
+    uint16_t awaitRegister = 0; // receives the awaited result on resume
+    uint32_t resumeAt = 0;      // instruction index
+    Value awaiting;             // what the suspended coroutine waits for
+    std::vector<Value> registers;
+    Completion completion;
+
+    CoroutineObject(const Value& function, std::span<const Value> args)
+        : ContainerObject(TYPE), function(function), registers(args.begin(), args.end()) {}
+
+    const std::string& name() const;
+};
+
+// A result native code delivers later: a timer, a socket operation, a
+// lookup on a worker thread, or gather() of several awaitables
+class FutureObject : public ContainerObject {
+public:
+    static constexpr ValueType TYPE = ValueType::FUTURE;
+
+    Completion completion;
+    // gather(): the awaitables whose results are collected, and how many
+    // are still pending
+    std::vector<Value> gathered;
+    size_t outstanding = 0;
+
+    FutureObject() : ContainerObject(TYPE) {}
+};
+
+inline Value::Value(Object* object) noexcept : tag(object ? Tag::OBJECT : Tag::NONE) {
+    payload.object = object;
+    if (object) object->retain();
+}
+
+inline void Value::retain() const noexcept {
+    if (tag == Tag::OBJECT) payload.object->retain();
+}
+
+inline void Value::release() noexcept {
+    if (tag == Tag::OBJECT) payload.object->release();
+}
+
+inline ValueType Value::getType() const {
+    switch (tag) {
+        case Tag::NONE: return ValueType::NONE;
+        case Tag::BOOL: return ValueType::BOOLEAN;
+        case Tag::INT: return ValueType::INTEGER;
+        case Tag::FLOAT: return ValueType::FLOAT;
+        case Tag::OBJECT: return payload.object->getType();
+    }
+    return ValueType::NONE;
+}
+
+template <typename T>
+T* Value::as() const {
+    if (tag == Tag::OBJECT && payload.object->getType() == T::TYPE) {
+        return static_cast<T*>(payload.object);
+    }
+    return nullptr;
+}
+
+} // namespace pulse::runtime
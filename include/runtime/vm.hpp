@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+#include "runtime/bytecode.hpp"
+#include "runtime/symbols.hpp"
+#include "runtime/value.hpp"
+
+namespace pulse::runtime {
+
+class Runtime;
+class RuntimeContext;
+
+// Register VM for FunctionProto bytecode. All frames share one fixed
+// register stack: a call's arguments are already in place as the first
+// registers of the callee's frame, so entering a Pulse function copies
+// nothing and leaves the C++ stack alone. Dispatch is threaded through
+// computed goto where the compiler supports it, else a switch.
+//
+// With a NativeTier installed the VM is also the profiling tier: see
+// runtime/tiering.hpp.
+class VM {
+public:
+    explicit VM(Runtime& runtime);
+    ~VM();
+
+    VM(const VM&) = delete;
+    VM& operator=(const VM&) = delete;
+
+    // Run top-level code and return its result
+    Value run(const std::shared_ptr<FunctionProto>& proto);
+
+    // Call a bytecode function from native code (Runtime::call). Reentrant:
+    // the frame goes above the registers of whatever is running.
+    // Async functions are not called this way: Runtime::call makes the coroutine
+    Value call(const FunctionObject& function, std::span<const Value> args);
+
+    // Run a coroutine from where it stopped: true once it returned, with
+    // result set; false when it suspended at an await (see Scheduler)
+    bool resume(CoroutineObject& coroutine, Value& result);
+
+    // Sampling (runtime/profiler.hpp); async-signal-safe on the VM's thread.
+    // Stores the running functions, outermost first, keeping the innermost
+    // max of a deeper stack; a function running as native code comes last,
+    // with native set. Returns how many were stored.
+    size_t sampleStack(const FunctionProto** out, size_t max, bool& native) const;
+
+    // --profile-calls: exact calls and inclusive time of every function
+    void setCountCalls(bool enabled) { countCalls = enabled; }
+    // The functions called while counting, in order of their first call
+    const std::vector<FunctionProto*>& getCountedFunctions() const { return counted; }
+
+    // Frames deeper than this raise RecursionError
+    static constexpr size_t MAX_DEPTH = 10000;
+    static constexpr size_t STACK_SIZE = 1 << 20; // registers
+
+private:
+    struct Frame {
+        FunctionProto* proto;
+        const Instruction* pc; // resume point while a callee runs
+        Value* base;
+        Value* result;         // where RETURN stores; null for entry frames
+        Value owner;           // keeps a method alive while it runs, or the instance __init__ builds
+        bool returnsOwner;     // return owner instead of the result (constructors)
+        CoroutineObject* coroutine = nullptr; // set on the frame of a resumed coroutine
+        bool counted = false;  // entered while counting calls
+        uint64_t started = 0;  // steady clock, on the outermost counted activation
+    };
+
+    Runtime& runtime;
+    // Zero-filled storage: a zero Value is None, so the stack needs no
+    // initialisation pass and untouched pages are never faulted in
+    Value* stack;
+    Value* stackEnd;
+    Value* highWater; // registers past this were never written
+    // Reserved for MAX_DEPTH up front, so a signal handler may read it:
+    // the frames below sampleDepth never move
+    std::vector<Frame> frames;
+    std::atomic<uint32_t> sampleDepth{0};
+    std::atomic<const FunctionProto*> nativeCallee{nullptr}; // while native code runs
+    bool countCalls = false;
+    std::vector<FunctionProto*> counted;
+    Symbol initName;
+    RuntimeContext* globals;
+
+    // First register above the running frame
+    Value* top() const;
+    void pushFrame(FunctionProto* proto, Value* base, size_t argc, Value* result);
+    // Drop the running frame; finished is false when a coroutine suspends
+    void popFrame(bool finished = true);
+    void beginCall(Frame& frame);
+    void endCall(Frame& frame, bool finished);
+    // Call slot[0] with slot[1 .. argc], leaving the result in slot[0]. True
+    // when a bytecode frame was pushed instead (the loop must switch to it).
+    bool callValue(Value* slot, size_t argc, CallSite* site = nullptr);
+    // Call method `cache.name` of slot[0] with slot[1 .. argc]
+    bool callMethod(Value* slot, size_t argc, AttributeCache& cache);
+    // Call a function whose arguments are args[0 .. argc]
+    bool enterFunction(const Value& function, Value* args, size_t argc, Value* result, CallSite* site = nullptr);
+    // Run a native specialization whose guard the arguments pass, else
+    // profile the call; false when the bytecode has to run
+    bool tieredCall(FunctionProto* proto, Value* args, size_t argc, Value* result, CallSite* site);
+    void requestTierUp(const std::shared_ptr<TierProfile>& tier, Shape shape);
+    // Cached resolution of receiver.name; sets bound when the function takes
+    // the receiver as its first argument
+    const Value& findAttribute(const Value& receiver, AttributeCache& cache, bool& bound);
+    Value* resolveGlobal(GlobalCache& cache);
+    // Interpret until the frame at depth `entry` returns
+    Value execute(size_t entry);
+};
+
+} // namespace pulse::runtime
@@ -0,0 +1,155 @@
+#include "build/build_database.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace pulse::build {
+
+namespace {
+
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+// The program a command line starts with, found on PATH like the shell would
+fs::path resolveProgram(const std::string& program) {
+    std::string name = program.substr(0, program.find(' '));
+    if (name.find('/') != std::string::npos || name.find('\\') != std::string::npos) {
+        return name;
+    }
+    const char* path = std::getenv("PATH");
+    if (!path) return name;
+
+#ifdef _WIN32
+    const char separator = ';';
+#else
+    const char separator = ':';
+#endif
+    std::string dirs(path);
+    size_t start = 0;
+    while (start <= dirs.size()) {
+        size_t end = dirs.find(separator, start);
+        if (end == std::string::npos) end = dirs.size();
+        fs::path candidate = fs::path(dirs.substr(start, end - start)) / name;
+        std::error_code ec;
+        if (fs::is_regular_file(candidate, ec)) return candidate;
+#ifdef _WIN32
+        candidate += ".exe";
+        if (fs::is_regular_file(candidate, ec)) return candidate;
+#endif
+        start = end + 1;
+    }
+    return name;
+}
+
+} // namespace
+
+Hasher& Hasher::add(std::string_view data) {
+    for (unsigned char c : data) {
+        state = (state ^ c) * FNV_PRIME;
+    }
+    // Length-terminated, so ("ab", "c") and ("a", "bc") differ
+    return add(static_cast<uint64_t>(data.size()));
+}
+
+Hasher& Hasher::add(uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        state = (state ^ ((value >> (8 * i)) & 0xFF)) * FNV_PRIME;
+    }
+    return *this;
+}
+
+Hasher& Hasher::addFile(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("cannot read " + path.string());
+    }
+    std::vector<char> buffer(1 << 16);
+    uint64_t size = 0;
+    while (in) {
+        in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        std::streamsize count = in.gcount();
+        for (std::streamsize i = 0; i < count; i++) {
+            state = (state ^ static_cast<unsigned char>(buffer[i])) * FNV_PRIME;
+        }
+        size += static_cast<uint64_t>(count);
+    }
+    return add(size);
+}
+
+std::string toHex(uint64_t value) {
+    static const char digits[] = "0123456789abcdef";
+    std::string text(16, '0');
+    for (int i = 15; i >= 0; i--) {
+        text[i] = digits[value & 0xF];
+        value >>= 4;
+    }
+    return text;
+}
+
+uint64_t toolIdentity(const std::string& program) {
+    fs::path path = resolveProgram(program);
+    Hasher hasher;
+    hasher.add(path.string());
+
+    std::error_code ec;
+    fs::path resolved = fs::canonical(path, ec);
+    if (ec) return hasher.digest();
+    uint64_t size = fs::file_size(resolved, ec);
+    if (!ec) hasher.add(size);
+    auto modified = fs::last_write_time(resolved, ec);
+    if (!ec) hasher.add(static_cast<uint64_t>(modified.time_since_epoch().count()));
+    return hasher.digest();
+}
+
+BuildDatabase::BuildDatabase(fs::path file) : file(std::move(file)) {
+    std::ifstream in(this->file);
+    std::string line;
+    while (std::getline(in, line)) {
+        // "<16 hex digits> <output path>"
+        if (line.size() < 18 || line[16] != ' ') continue;
+        char* end = nullptr;
+        uint64_t signature = std::strtoull(line.c_str(), &end, 16);
+        if (end != line.c_str() + 16) continue;
+        entries[line.substr(17)] = signature;
+    }
+}
+
+bool BuildDatabase::upToDate(const std::string& output, uint64_t signature) const {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(output);
+        if (it == entries.end() || it->second != signature) return false;
+    }
+    std::error_code ec;
+    return fs::exists(output, ec);
+}
+
+void BuildDatabase::record(const std::string& output, uint64_t signature) {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries[output] = signature;
+}
+
+void BuildDatabase::forget(const std::string& output) {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.erase(output);
+}
+
+void BuildDatabase::save() const {
+    fs::path temporary = file;
+    temporary += ".tmp";
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::ofstream out(temporary, std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("cannot write " + temporary.string());
+        }
+        for (const auto& [output, signature] : entries) {
+            out << toHex(signature) << ' ' << output << '\n';
+        }
+    }
+    fs::rename(temporary, file);
+}
+
+} // namespace pulse::build
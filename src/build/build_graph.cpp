@@ -0,0 +1,232 @@
+#include "build/build_graph.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+namespace pulse::build {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::string formatSeconds(double seconds) {
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(2) << seconds << "s";
+    return text.str();
+}
+
+} // namespace
+
+#ifdef _WIN32
+int runCommand(const std::string& command, std::string& output) {
+    FILE* pipe = _popen((command + " 2>&1").c_str(), "r");
+    if (!pipe) return -1;
+    char buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, count);
+    }
+    return _pclose(pipe);
+}
+#else
+int runCommand(const std::string& command, std::string& output) {
+    // Close-on-exec, so that the children of concurrent jobs do not hold
+    // each other's pipes open; dup2 clears the flag on the child's copies
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) return -1;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDERR_FILENO);
+
+    const char* argv[] = {"sh", "-c", command.c_str(), nullptr};
+    pid_t pid;
+    int spawned = posix_spawn(&pid, "/bin/sh", &actions, nullptr, const_cast<char* const*>(argv), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (spawned != 0) {
+        close(fds[0]);
+        return -1;
+    }
+
+    char buffer[4096];
+    ssize_t count;
+    while ((count = read(fds[0], buffer, sizeof(buffer))) != 0) {
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        output.append(buffer, static_cast<size_t>(count));
+    }
+    close(fds[0]);
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return -1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+#endif
+
+unsigned BuildGraph::defaultJobs() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+size_t BuildGraph::add(BuildStep step) {
+    Hasher hasher;
+    hasher.add(step.signature);
+    for (size_t dependency : step.dependencies) {
+        if (dependency >= steps.size()) {
+            throw std::logic_error("build step depends on a later step");
+        }
+        hasher.add(steps[dependency].signature);
+    }
+    step.signature = hasher.digest();
+    steps.push_back(std::move(step));
+    return steps.size() - 1;
+}
+
+BuildSummary BuildGraph::run(BuildDatabase& database, unsigned jobs, CompileCache* cache) {
+    Clock::time_point start = Clock::now();
+    BuildSummary summary;
+
+    // Signatures cover everything a step reads, so staleness is decided up
+    // front and a no-op build starts no job at all
+    std::vector<bool> stale(steps.size());
+    size_t work = 0;
+    for (size_t i = 0; i < steps.size(); i++) {
+        stale[i] = !database.upToDate(steps[i].output, steps[i].signature);
+        if (stale[i]) {
+            work++;
+        } else {
+            summary.upToDate++;
+        }
+    }
+    if (work == 0) {
+        summary.seconds = secondsSince(start);
+        return summary;
+    }
+
+    std::vector<size_t> waiting(steps.size(), 0);
+    std::vector<bool> blocked(steps.size(), false);
+    std::vector<std::vector<size_t>> dependents(steps.size());
+    std::deque<size_t> ready;
+    for (size_t i = 0; i < steps.size(); i++) {
+        if (!stale[i]) continue;
+        for (size_t dependency : steps[i].dependencies) {
+            if (stale[dependency]) {
+                waiting[i]++;
+                dependents[dependency].push_back(i);
+            }
+        }
+        if (waiting[i] == 0) ready.push_back(i);
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    size_t finished = 0;
+
+    // Called with the mutex held once a step has run, failed or been skipped
+    auto finish = [&](size_t index, bool succeeded) {
+        std::vector<size_t> pending{index};
+        bool ok = succeeded;
+        while (!pending.empty()) {
+            size_t done = pending.back();
+            pending.pop_back();
+            finished++;
+            for (size_t dependent : dependents[done]) {
+                if (!ok) blocked[dependent] = true;
+                if (--waiting[dependent] > 0) continue;
+                if (blocked[dependent]) {
+                    summary.skipped++;
+                    std::cerr << "  Skipped: " << steps[dependent].label << std::endl;
+                    pending.push_back(dependent);
+                } else {
+                    ready.push_back(dependent);
+                }
+            }
+            ok = false; // everything after the first was skipped
+        }
+        wake.notify_all();
+    };
+
+    auto worker = [&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [&] { return !ready.empty() || finished == work; });
+            if (ready.empty()) return;
+            size_t index = ready.front();
+            ready.pop_front();
+            const BuildStep& step = steps[index];
+            lock.unlock();
+
+            Clock::time_point begun = Clock::now();
+            bool cacheable = cache && step.cacheKey != 0;
+            bool hit = cacheable && cache->fetch(step.cacheKey, step.output);
+            std::string output;
+            int status = hit ? 0 : runCommand(step.command, output);
+            if (status == 0 && cacheable && !hit) {
+                cache->store(step.cacheKey, step.output);
+            }
+            double seconds = secondsSince(begun);
+            if (status == 0) {
+                database.record(step.output, step.signature);
+            } else {
+                database.forget(step.output);
+            }
+
+            lock.lock();
+            if (status == 0) {
+                summary.built++;
+                if (hit) summary.cached++;
+                std::cout << "  [" << summary.built + summary.failed << "/" << work << "] " << step.label << " ("
+                          << (hit ? "cached, " : "") << formatSeconds(seconds) << ")" << std::endl;
+                std::cout << output << std::flush;
+            } else {
+                summary.failed++;
+                std::cerr << "  FAILED: " << step.label << " (exit status " << status << ")" << std::endl;
+                std::cerr << output << std::flush;
+            }
+            finish(index, status == 0);
+        }
+    };
+
+    size_t threads = std::min<size_t>(jobs == 0 ? defaultJobs() : jobs, work);
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < threads; i++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    database.save();
+    summary.seconds = secondsSince(start);
+    return summary;
+}
+
+} // namespace pulse::build
@@ -0,0 +1,211 @@
+#include "build/compile_cache.hpp"
+#include "build/build_database.hpp"
+#include "build/build_graph.hpp"
+#include "net/http_client.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace pulse::build {
+
+namespace {
+
+bool readFile(const fs::path& path, std::string& contents) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !in.bad();
+}
+
+// Writes next to path and renames over it, so readers never see a partial file
+bool writeFileAtomically(const fs::path& path, const std::string& contents) {
+    static thread_local std::mt19937_64 random{std::random_device{}()};
+    fs::path temporary = path;
+    temporary += ".tmp" + toHex(random());
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out || !out.write(contents.data(), static_cast<std::streamsize>(contents.size()))) {
+            std::error_code ec;
+            fs::remove(temporary, ec);
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(temporary, path, ec);
+    if (ec) fs::remove(temporary, ec);
+    return !ec;
+}
+
+// One per build job, so its connection to the remote is kept alive from
+// one step to the next
+pulse::net::HTTPClient& remoteClient() {
+    thread_local pulse::net::HTTPClient client;
+    return client;
+}
+
+std::string trim(const std::string& str) {
+    size_t start = str.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) return "";
+    size_t end = str.find_last_not_of(" \t\r\n");
+    return str.substr(start, end - start + 1);
+}
+
+} // namespace
+
+CompileCache::CompileCache(fs::path directory, std::string remote)
+    : directory(std::move(directory)), remote(std::move(remote)) {
+    while (!this->remote.empty() && this->remote.back() == '/') {
+        this->remote.pop_back();
+    }
+}
+
+fs::path CompileCache::defaultDirectory() {
+    if (const char* dir = std::getenv("PULSE_CACHE_DIR")) {
+        return dir;
+    }
+    const char* home = std::getenv("HOME");
+    return fs::path(home ? home : ".") / ".pulse" / "cache" / "objects";
+}
+
+fs::path CompileCache::entryPath(uint64_t key) const {
+    // Two-level fan-out keeps directories small
+    std::string name = toHex(key);
+    return directory / name.substr(0, 2) / name;
+}
+
+bool CompileCache::storeLocal(uint64_t key, const std::string& contents) {
+    fs::path entry = entryPath(key);
+    std::error_code ec;
+    if (fs::exists(entry, ec)) return true;
+    fs::create_directories(entry.parent_path(), ec);
+    return writeFileAtomically(entry, contents);
+}
+
+void CompileCache::remoteError(const std::string& message) {
+    if (!remoteFailed.exchange(true)) {
+        std::cerr << "  Warning: remote cache " << remote << ": " << message << "; using the local cache only"
+                  << std::endl;
+    }
+}
+
+bool CompileCache::fetch(uint64_t key, const std::string& output) {
+    fs::path entry = entryPath(key);
+    std::error_code ec;
+    if (fs::exists(entry, ec)) {
+        fs::path temporary = output + ".tmp";
+        fs::copy_file(entry, temporary, fs::copy_options::overwrite_existing, ec);
+        if (!ec) fs::rename(temporary, output, ec);
+        if (!ec) return true;
+        fs::remove(temporary, ec);
+    }
+
+    if (remote.empty() || remoteFailed) return false;
+    pulse::net::HTTPResponse response;
+    try {
+        response = remoteClient().get(remote + "/" + toHex(key));
+    } catch (const std::exception& e) {
+        remoteError(e.what());
+        return false;
+    }
+    if (response.status == 404) return false;
+    if (!response.ok()) {
+        remoteError("GET answered " + std::to_string(response.status));
+        return false;
+    }
+    storeLocal(key, response.body);
+    return writeFileAtomically(output, response.body);
+}
+
+void CompileCache::store(uint64_t key, const std::string& output) {
+    std::string contents;
+    if (!readFile(output, contents)) return;
+    storeLocal(key, contents);
+
+    if (remote.empty() || remoteFailed) return;
+    try {
+        pulse::net::HTTPResponse response = remoteClient().put(remote + "/" + toHex(key), contents);
+        if (!response.ok()) {
+            remoteError("PUT answered " + std::to_string(response.status));
+        }
+    } catch (const std::exception& e) {
+        remoteError(e.what());
+    }
+}
+
+std::string CompileCache::toolVersion(const std::string& program) {
+    std::string identity = toHex(toolIdentity(program));
+    fs::path known = directory / "tools" / identity;
+    std::string output;
+    if (readFile(known, output) && !output.empty()) {
+        return output;
+    }
+    if (runCommand(program + " --version", output) != 0 || output.empty()) {
+        return identity;
+    }
+    std::error_code ec;
+    fs::create_directories(known.parent_path(), ec);
+    writeFileAtomically(known, output);
+    return output;
+}
+
+uint64_t hashDependencies(const fs::path& config_file, const fs::path& pulse_home) {
+    std::map<std::string, std::string> dependencies;
+    std::ifstream file(config_file);
+    std::string line;
+    std::string section;
+    while (std::getline(file, line)) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#') continue;
+        if (line[0] == '[') {
+            section = trim(line.substr(1, line.find(']') - 1));
+            continue;
+        }
+        if (section != "dependencies" && section != "libs") continue;
+        size_t eq_pos = line.find('=');
+        if (eq_pos == std::string::npos) continue;
+        dependencies[section + "." + trim(line.substr(0, eq_pos))] = trim(line.substr(eq_pos + 1));
+    }
+
+    Hasher hasher;
+    for (const auto& [key, spec] : dependencies) {
+        hasher.add(key).add(spec);
+
+        std::string name = key.substr(key.find('.') + 1);
+        fs::path installed;
+        std::error_code ec;
+        for (const fs::path& candidate : {config_file.parent_path() / ".pulse" / "libs" / name,
+                                          pulse_home / "packages" / name, pulse_home / "libs" / name}) {
+            if (fs::is_directory(candidate, ec)) {
+                installed = candidate;
+                break;
+            }
+        }
+        if (installed.empty()) continue;
+
+        std::vector<fs::path> files;
+        for (const auto& entry : fs::recursive_directory_iterator(installed, ec)) {
+            // package.info says when it was installed, not what
+            if (entry.is_regular_file() && entry.path().filename() != "package.info") files.push_back(entry.path());
+        }
+        std::sort(files.begin(), files.end());
+        for (const auto& path : files) {
+            hasher.add(fs::relative(path, installed).generic_string());
+            try {
+                hasher.addFile(path);
+            } catch (const std::exception&) {
+                hasher.add(uint64_t{0});
+            }
+        }
+    }
+    return hasher.digest();
+}
+
+} // namespace pulse::build
@@ -0,0 +1,138 @@
+#include "build/package_store.hpp"
+#include "build/build_database.hpp"
+#include "build/sha256.hpp"
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <sys/clonefile.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace pulse::build {
+
+namespace {
+
+// Copy-on-write clone of source at target, where the file system has them
+bool reflink(const fs::path& source, const fs::path& target) {
+#ifdef __linux__
+    int in = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) return false;
+    int out = ::open(target.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0444);
+    if (out < 0) {
+        ::close(in);
+        return false;
+    }
+    bool cloned = ::ioctl(out, FICLONE, in) == 0;
+    ::close(out);
+    ::close(in);
+    if (!cloned) ::unlink(target.c_str());
+    return cloned;
+#elif defined(__APPLE__)
+    return ::clonefile(source.c_str(), target.c_str(), 0) == 0;
+#else
+    (void)source;
+    (void)target;
+    return false;
+#endif
+}
+
+void makeReadOnly(const fs::path& path) {
+    std::error_code ec;
+    fs::permissions(path, fs::perms::owner_read | fs::perms::group_read | fs::perms::others_read,
+                    fs::perm_options::replace, ec);
+}
+
+} // namespace
+
+PackageStore::PackageStore(fs::path directory) : directory(std::move(directory)) {}
+
+fs::path PackageStore::defaultDirectory() {
+    if (const char* dir = std::getenv("PULSE_STORE_DIR")) {
+        return dir;
+    }
+    const char* home = std::getenv("HOME");
+    return fs::path(home ? home : ".") / ".pulse" / "store";
+}
+
+fs::path PackageStore::entryPath(const std::string& digest) const {
+    // Digests may come from pulse.lock: nothing else may become a path
+    if (!Sha256::isDigest(digest)) {
+        throw std::runtime_error("'" + digest + "' is not a package store digest");
+    }
+    // Two-level fan-out keeps directories small
+    return directory / digest.substr(0, 2) / digest;
+}
+
+bool PackageStore::contains(const std::string& digest) const {
+    std::error_code ec;
+    return Sha256::isDigest(digest) && fs::is_regular_file(entryPath(digest), ec);
+}
+
+fs::path PackageStore::temporaryPath() const {
+    static thread_local std::mt19937_64 random{std::random_device{}()};
+    fs::path temporary = directory / "tmp";
+    fs::create_directories(temporary);
+    return temporary / (toHex(random()) + ".part");
+}
+
+std::string PackageStore::add(const fs::path& file) {
+    std::string digest = Sha256().addFile(file).hexDigest();
+    fs::path entry = entryPath(digest);
+    std::error_code ec;
+    if (fs::exists(entry, ec)) {
+        fs::remove(file, ec);
+        return digest;
+    }
+    fs::create_directories(entry.parent_path());
+    makeReadOnly(file);
+    fs::rename(file, entry, ec);
+    if (ec) {
+        fs::remove(file, ec);
+        if (!contains(digest)) {
+            throw std::runtime_error("cannot add " + file.string() + " to the package store");
+        }
+    }
+    return digest;
+}
+
+std::string PackageStore::import(const fs::path& file) {
+    std::string digest = Sha256().addFile(file).hexDigest();
+    if (contains(digest)) return digest;
+    fs::path temporary = temporaryPath();
+    fs::copy_file(file, temporary);
+    return add(temporary);
+}
+
+void PackageStore::link(const std::string& digest, const fs::path& target) {
+    fs::path entry = entryPath(digest);
+    if (!contains(digest)) {
+        throw std::runtime_error("package store has no " + digest + " for " + target.string());
+    }
+    std::error_code ec;
+    if (fs::equivalent(entry, target, ec)) return;
+    fs::remove(target, ec);
+    fs::create_directories(target.parent_path());
+
+    if (reflink(entry, target)) {
+        reflinks++;
+        return;
+    }
+    fs::create_hard_link(entry, target, ec);
+    if (!ec) {
+        hardlinks++;
+        return;
+    }
+    fs::copy_file(entry, target);
+    copies++;
+}
+
+} // namespace pulse::build
@@ -1,61 +1,244 @@
 #include "compiler/compiler.hpp"
-#include "compiler/llvm_backend.hpp"
-#include <iostream>
+#include "driver/time_report.hpp"
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Analysis/ModuleSummaryAnalysis.h>
+#include <llvm/Analysis/ProfileSummaryInfo.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Intrinsics.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/Metadata.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Target/TargetOptions.h>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <stdexcept>
 
 namespace pulse::compiler {
 
-Compiler::Compiler() 
+namespace {
+
+llvm::StringRef toStringRef(std::string_view text) {
+    return llvm::StringRef(text.data(), text.size());
+}
+
+// The value of an integer literal, also through a unary minus (range(10, 0, -1))
+std::optional<int64_t> constantInteger(pulse::parser::Expression* expr) {
+    if (auto literal = pulse::parser::dyn_cast<pulse::parser::LiteralExpression>(expr)) {
+        if (std::holds_alternative<int64_t>(literal->value)) {
+            return std::get<int64_t>(literal->value);
+        }
+    } else if (auto unary = pulse::parser::dyn_cast<pulse::parser::UnaryExpression>(expr)) {
+        if (unary->op == pulse::parser::UnaryExpression::Operator::MINUS) {
+            if (auto value = constantInteger(unary->operand.get())) {
+                return -*value;
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+llvm::OptimizationLevel toOptimizationLevel(unsigned level) {
+    switch (level) {
+        case 0: return llvm::OptimizationLevel::O0;
+        case 1: return llvm::OptimizationLevel::O1;
+        case 2: return llvm::OptimizationLevel::O2;
+        default: return llvm::OptimizationLevel::O3;
+    }
+}
+
+llvm::CodeGenOpt::Level toCodeGenLevel(unsigned level) {
+    switch (level) {
+        case 0: return llvm::CodeGenOpt::None;
+        case 1: return llvm::CodeGenOpt::Less;
+        case 2: return llvm::CodeGenOpt::Default;
+        default: return llvm::CodeGenOpt::Aggressive;
+    }
+}
+
+// "+avx2,+fma,-avx512f,..." for the host, so -march=native matches what the CPU has
+std::string hostCPUFeatures() {
+    llvm::StringMap<bool> features;
+    std::string result;
+    if (llvm::sys::getHostCPUFeatures(features)) {
+        for (const auto& feature : features) {
+            if (!result.empty()) result += ',';
+            result += (feature.getValue() ? "+" : "-") + feature.getKey().str();
+        }
+    }
+    return result;
+}
+
+void initializeTargets() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        llvm::InitializeAllTargetInfos();
+        llvm::InitializeAllTargets();
+        llvm::InitializeAllTargetMCs();
+        llvm::InitializeAllAsmPrinters();
+    });
+}
+
+} // namespace
+
+std::string Compiler::backendVersion() {
+    return std::string("LLVM ") + LLVM_VERSION_STRING + "\nhost: " + llvm::sys::getDefaultTargetTriple() + " " +
+           llvm::sys::getHostCPUName().str() + " " + hostCPUFeatures();
+}
+
+Compiler::Compiler(CompileOptions options)
     : context(std::make_unique<llvm::LLVMContext>()),
       module(std::make_unique<llvm::Module>("pulse_module", *context)),
-      builder(std::make_unique<llvm::IRBuilder<>>(*context)),
-      currentFunction(nullptr),
-      currentBlock(nullptr) {
+      builder(std::make_unique<Builder>(*context)),
+      options(std::move(options)),
+      currentFunction(nullptr) {
+    if (this->options.optLevel > 3) {
+        throw std::invalid_argument("Optimization level must be between 0 and 3");
+    }
 }
 
 Compiler::~Compiler() = default;
 
+void Compiler::addImport(std::shared_ptr<const pulse::driver::InterfaceFile> interface) {
+    // The first module to export a name provides it
+    for (auto& constant : interface->load().constants) {
+        std::string name = constant.name;
+        importedConstants.emplace(std::move(name), std::move(constant));
+    }
+    imports.push_back(std::move(interface));
+}
+
+std::map<std::string, ValueType, std::less<>> Compiler::importedConstantTypes() const {
+    std::map<std::string, ValueType, std::less<>> types;
+    for (const auto& [name, constant] : importedConstants) {
+        switch (constant.type) {
+            case pulse::driver::ModuleInterface::ConstantType::INT: types[name] = ValueType::INT; break;
+            case pulse::driver::ModuleInterface::ConstantType::FLOAT: types[name] = ValueType::FLOAT; break;
+            case pulse::driver::ModuleInterface::ConstantType::BOOL: types[name] = ValueType::BOOL; break;
+            case pulse::driver::ModuleInterface::ConstantType::STR: types[name] = ValueType::STR; break;
+        }
+    }
+    return types;
+}
+
 bool Compiler::compile(pulse::parser::Program* program, const std::string& outputFile) {
     try {
         if (!program) {
             throw std::runtime_error("No program to compile");
         }
-        
+
         // Setup standard library
         setupStandardLibrary();
-        
-        // Create main function
-        createMainFunction();
-        
-        // Compile all declarations
-        for (const auto& decl : program->declarations) {
-            compileDeclaration(decl.get());
+
+        // Infer the types of the top-level code; functions are specialized
+        // lazily, per call signature
+        {
+            pulse::driver::TimeReport::Scope phase("type inference");
+            inference = std::make_unique<TypeInference>(program, importedConstantTypes());
+        }
+
+        {
+            pulse::driver::TimeReport::Scope phase("IR generation");
+            // Create main function
+            createMainFunction();
+            declareLocals(inference->entry());
+
+            // Compile all declarations (exports the untyped entry points)
+            for (const auto& decl : program->declarations) {
+                compileDeclaration(decl.get());
+            }
+
+            // Compile all statements in main
+            compileBlock(program->statements);
+
+            // Add return statement to main if not present
+            if (!blockTerminated()) {
+                builder->CreateRet(builder->getInt32(0));
+            }
+            compilePendingInstances();
         }
-        
-        // Compile all statements in main
-        for (const auto& stmt : program->statements) {
-            compileStatement(stmt.get());
+
+        finishModule();
+
+        if (!outputFile.empty()) {
+            pulse::driver::TimeReport::Scope phase("emit");
+            writeOutput(outputFile);
         }
-        
-        // Add return statement to main if not present
-        if (!currentBlock->getTerminator()) {
-            builder->CreateRet(builder->getInt32(0));
+
+        return true;
+
+    } catch (const std::exception& e) {
+        error = e.what();
+        return false;
+    }
+}
+
+bool Compiler::compileSpecialization(const pulse::parser::Program* program, pulse::parser::FunctionDeclaration* decl,
+                                     const Signature& params, const std::string& symbol, ValueType& returnType) {
+    try {
+        setupStandardLibrary();
+        // The inference only reads the tree
+        inference = std::make_unique<TypeInference>(const_cast<pulse::parser::Program*>(program));
+
+        const FunctionInstance& instance = inference->instantiate(decl, params);
+        std::string reason;
+        if (!inference->matchesInterpreter(instance, reason)) {
+            throw std::runtime_error(reason);
         }
-        
-        // Verify module
-        std::string error;
-        if (llvm::verifyModule(*module, &error)) {
-            throw std::runtime_error("Module verification failed: " + error);
+
+        {
+            pulse::driver::TimeReport::Scope phase("IR generation");
+            createAdapter(getOrCreateInstance(instance), instance, symbol);
+            compilePendingInstances();
         }
-        
+        finishModule();
+        returnType = instance.returnType;
         return true;
-        
+
     } catch (const std::exception& e) {
-        std::cerr << "Compilation error: " << e.what() << std::endl;
+        error = e.what();
         return false;
     }
 }
 
+// Emit every specialization reached so far; compiling one body may declare
+// further instances
+void Compiler::compilePendingInstances() {
+    while (!pendingInstances.empty()) {
+        const FunctionInstance* instance = pendingInstances.back();
+        pendingInstances.pop_back();
+        compileInstance(*instance);
+    }
+}
+
+// Verify, pick the target and optimize
+void Compiler::finishModule() {
+    {
+        pulse::driver::TimeReport::Scope phase("verify");
+        std::string verifyErrors;
+        llvm::raw_string_ostream errorStream(verifyErrors);
+        if (llvm::verifyModule(*module, &errorStream)) {
+            throw std::runtime_error("Module verification failed: " + errorStream.str());
+        }
+    }
+
+    pulse::driver::TimeReport::Scope phase("optimize");
+    configureTarget();
+    optimize();
+}
+
 std::string Compiler::getIRString() const {
     std::string irString;
     llvm::raw_string_ostream stream(irString);
@@ -71,22 +254,25 @@ llvm::LLVMContext* Compiler::getContext() const {
     return context.get();
 }
 
+std::pair<std::unique_ptr<llvm::LLVMContext>, std::unique_ptr<llvm::Module>> Compiler::releaseModule() {
+    // Nothing may refer to the context once it is handed over
+    builder.reset();
+    instanceFunctions.clear();
+    pendingInstances.clear();
+    variables.clear();
+    functions.clear();
+    currentFunction = nullptr;
+    return {std::move(context), std::move(module)};
+}
+
 llvm::Value* Compiler::compileExpression(pulse::parser::Expression* expr) {
     if (!expr) return nullptr;
-    
-    if (auto literal = dynamic_cast<pulse::parser::LiteralExpression*>(expr)) {
-        return compileLiteralExpression(literal);
-    } else if (auto id = dynamic_cast<pulse::parser::IdentifierExpression*>(expr)) {
-        return compileIdentifierExpression(id);
-    } else if (auto binary = dynamic_cast<pulse::parser::BinaryExpression*>(expr)) {
-        return compileBinaryExpression(binary);
-    } else if (auto unary = dynamic_cast<pulse::parser::UnaryExpression*>(expr)) {
-        return compileUnaryExpression(unary);
-    } else if (auto call = dynamic_cast<pulse::parser::CallExpression*>(expr)) {
-        return compileCallExpression(call);
-    }
-    
-    return nullptr;
+
+    llvm::Value* value = visit(expr);
+    if (!value) {
+        throw std::runtime_error("Expression kind is not supported by native code generation");
+    }
+    return value;
 }
 
 llvm::Value* Compiler::compileLiteralExpression(pulse::parser::LiteralExpression* expr) {
@@ -96,124 +282,590 @@ llvm::Value* Compiler::compileLiteralExpression(pulse::parser::LiteralExpression
         return llvm::ConstantFP::get(builder->getDoubleTy(), std::get<double>(expr->value));
     } else if (std::holds_alternative<bool>(expr->value)) {
         return builder->getInt1(std::get<bool>(expr->value));
-    } else if (std::holds_alternative<std::string>(expr->value)) {
-        return builder->CreateGlobalStringPtr(std::get<std::string>(expr->value));
+    } else if (std::holds_alternative<std::string_view>(expr->value)) {
+        return builder->CreateGlobalStringPtr(toStringRef(std::get<std::string_view>(expr->value)));
     }
-    
-    return builder->getInt32(0); // None/null
+
+    return builder->getInt64(0); // None/null
 }
 
 llvm::Value* Compiler::compileIdentifierExpression(pulse::parser::IdentifierExpression* expr) {
     auto it = variables.find(expr->name);
     if (it != variables.end()) {
-        return builder->CreateLoad(builder->getInt64Ty(), it->second);
+        return builder->CreateLoad(it->second->getAllocatedType(), it->second, toStringRef(expr->name));
+    }
+
+    auto constant = importedConstants.find(expr->name);
+    if (constant != importedConstants.end()) {
+        const auto& value = constant->second;
+        switch (value.type) {
+            case pulse::driver::ModuleInterface::ConstantType::INT:
+                return builder->getInt64(value.intValue);
+            case pulse::driver::ModuleInterface::ConstantType::FLOAT:
+                return llvm::ConstantFP::get(builder->getDoubleTy(), value.floatValue);
+            case pulse::driver::ModuleInterface::ConstantType::BOOL:
+                return builder->getInt1(value.intValue != 0);
+            case pulse::driver::ModuleInterface::ConstantType::STR:
+                return builder->CreateGlobalStringPtr(value.text);
+        }
     }
-    
+
     // Return default value for undefined variables
     return builder->getInt64(0);
 }
 
 llvm::Value* Compiler::compileBinaryExpression(pulse::parser::BinaryExpression* expr) {
+    using Op = pulse::parser::BinaryExpression::Operator;
+
+    if (expr->op == Op::AND || expr->op == Op::OR) {
+        return compileLogicalExpression(expr);
+    }
+
     auto left = compileExpression(expr->left.get());
     auto right = compileExpression(expr->right.get());
-    
-    if (!left || !right) return nullptr;
-    
+
+    if (left->getType()->isPointerTy() || right->getType()->isPointerTy()) {
+        throw std::runtime_error("String and object operands are not supported by native code generation");
+    }
+
+    // Bool equality stays on i1
+    if (left->getType()->isIntegerTy(1) && right->getType()->isIntegerTy(1)) {
+        if (expr->op == Op::EQUAL) return builder->CreateICmpEQ(left, right);
+        if (expr->op == Op::NOT_EQUAL) return builder->CreateICmpNE(left, right);
+    }
+
+    // True division and any float operand promote to double; bools act as
+    // ints. So does an int raised to a negative constant, as in the VM; an
+    // exponent only known to be negative at run time cannot change the type.
+    auto exponent = llvm::dyn_cast<llvm::ConstantInt>(right);
+    bool negativePower = expr->op == Op::POWER && exponent && !exponent->getType()->isIntegerTy(1) &&
+                         exponent->isNegative();
+    bool isFloat = left->getType()->isDoubleTy() || right->getType()->isDoubleTy() || expr->op == Op::DIVIDE ||
+                   negativePower;
+    if (isFloat) {
+        left = coerce(left, builder->getDoubleTy());
+        right = coerce(right, builder->getDoubleTy());
+
+        auto zero = llvm::ConstantFP::get(builder->getDoubleTy(), 0.0);
+        switch (expr->op) {
+            case Op::DIVIDE:
+                raiseIf(builder->CreateFCmpOEQ(right, zero), "ZeroDivisionError: division by zero");
+                break;
+            case Op::FLOOR_DIVIDE:
+                raiseIf(builder->CreateFCmpOEQ(right, zero), "ZeroDivisionError: float floor division by zero");
+                break;
+            case Op::MODULO:
+                raiseIf(builder->CreateFCmpOEQ(right, zero), "ZeroDivisionError: float modulo");
+                break;
+            case Op::POWER:
+                raiseIf(builder->CreateAnd(builder->CreateFCmpOEQ(left, zero), builder->CreateFCmpOLT(right, zero)),
+                        "ZeroDivisionError: 0.0 cannot be raised to a negative power");
+                break;
+            default:
+                break;
+        }
+
+        switch (expr->op) {
+            case Op::ADD: return builder->CreateFAdd(left, right);
+            case Op::SUBTRACT: return builder->CreateFSub(left, right);
+            case Op::MULTIPLY: return builder->CreateFMul(left, right);
+            case Op::DIVIDE: return builder->CreateFDiv(left, right);
+            case Op::MODULO: {
+                // Like floor division, the remainder takes the divisor's sign
+                auto remainder = builder->CreateFRem(left, right);
+                auto inexact = builder->CreateFCmpUNE(remainder, zero);
+                auto signsDiffer = builder->CreateXor(builder->CreateFCmpOLT(remainder, zero),
+                                                      builder->CreateFCmpOLT(right, zero));
+                return builder->CreateSelect(builder->CreateAnd(inexact, signsDiffer),
+                                             builder->CreateFAdd(remainder, right), remainder);
+            }
+            case Op::FLOOR_DIVIDE:
+                return builder->CreateUnaryIntrinsic(llvm::Intrinsic::floor, builder->CreateFDiv(left, right));
+            case Op::POWER:
+                return builder->CreateBinaryIntrinsic(llvm::Intrinsic::pow, left, right);
+            case Op::EQUAL: return builder->CreateFCmpOEQ(left, right);
+            case Op::NOT_EQUAL: return builder->CreateFCmpUNE(left, right);
+            case Op::LESS: return builder->CreateFCmpOLT(left, right);
+            case Op::LESS_EQUAL: return builder->CreateFCmpOLE(left, right);
+            case Op::GREATER: return builder->CreateFCmpOGT(left, right);
+            case Op::GREATER_EQUAL: return builder->CreateFCmpOGE(left, right);
+            default: return nullptr;
+        }
+    }
+
+    left = coerce(left, builder->getInt64Ty());
+    right = coerce(right, builder->getInt64Ty());
+
+    // A zero divisor raises as in the VM. So that INT64_MIN // -1 cannot
+    // trap, -1 divides as 1 and the quotient is negated (wrapping, as the VM's).
+    llvm::Value* byMinusOne = nullptr;
+    if (expr->op == Op::FLOOR_DIVIDE || expr->op == Op::MODULO) {
+        raiseIf(builder->CreateICmpEQ(right, builder->getInt64(0)),
+                "ZeroDivisionError: integer division or modulo by zero");
+        byMinusOne = builder->CreateICmpEQ(right, builder->getInt64(-1));
+        right = builder->CreateSelect(byMinusOne, builder->getInt64(1), right);
+    }
+
     switch (expr->op) {
-        case pulse::parser::BinaryExpression::Operator::ADD:
+        case Op::ADD:
             return builder->CreateAdd(left, right);
-        case pulse::parser::BinaryExpression::Operator::SUBTRACT:
+        case Op::SUBTRACT:
             return builder->CreateSub(left, right);
-        case pulse::parser::BinaryExpression::Operator::MULTIPLY:
+        case Op::MULTIPLY:
             return builder->CreateMul(left, right);
-        case pulse::parser::BinaryExpression::Operator::DIVIDE:
-            return builder->CreateSDiv(left, right);
-        case pulse::parser::BinaryExpression::Operator::MODULO:
-            return builder->CreateSRem(left, right);
-        case pulse::parser::BinaryExpression::Operator::EQUAL:
+        case Op::MODULO: {
+            // Python's remainder takes the sign of the divisor
+            auto remainder = builder->CreateSRem(left, right);
+            auto inexact = builder->CreateICmpNE(remainder, builder->getInt64(0));
+            auto signsDiffer = builder->CreateICmpSLT(builder->CreateXor(remainder, right), builder->getInt64(0));
+            return builder->CreateSelect(builder->CreateAnd(inexact, signsDiffer),
+                                         builder->CreateAdd(remainder, right), remainder);
+        }
+        case Op::FLOOR_DIVIDE: {
+            // Round toward negative infinity: truncate, then step down when the
+            // remainder is non-zero and its sign differs from the divisor's
+            auto quotient = builder->CreateSDiv(left, right);
+            auto remainder = builder->CreateSRem(left, right);
+            auto inexact = builder->CreateICmpNE(remainder, builder->getInt64(0));
+            auto signsDiffer = builder->CreateICmpSLT(builder->CreateXor(remainder, right), builder->getInt64(0));
+            auto adjust = builder->CreateZExt(builder->CreateAnd(inexact, signsDiffer), builder->getInt64Ty());
+            quotient = builder->CreateSub(quotient, adjust);
+            return builder->CreateSelect(byMinusOne, builder->CreateNeg(quotient), quotient);
+        }
+        case Op::POWER:
+            raiseIf(builder->CreateICmpSLT(right, builder->getInt64(0)),
+                    "native code cannot raise an int to a negative int power; use a float, or pulse run --interpret");
+            return builder->CreateCall(getIntPower(), {left, right});
+        case Op::EQUAL:
             return builder->CreateICmpEQ(left, right);
-        case pulse::parser::BinaryExpression::Operator::NOT_EQUAL:
+        case Op::NOT_EQUAL:
             return builder->CreateICmpNE(left, right);
-        case pulse::parser::BinaryExpression::Operator::LESS:
+        case Op::LESS:
             return builder->CreateICmpSLT(left, right);
-        case pulse::parser::BinaryExpression::Operator::LESS_EQUAL:
+        case Op::LESS_EQUAL:
             return builder->CreateICmpSLE(left, right);
-        case pulse::parser::BinaryExpression::Operator::GREATER:
+        case Op::GREATER:
             return builder->CreateICmpSGT(left, right);
-        case pulse::parser::BinaryExpression::Operator::GREATER_EQUAL:
+        case Op::GREATER_EQUAL:
             return builder->CreateICmpSGE(left, right);
         default:
             return nullptr;
     }
 }
 
+// `a and b` / `a or b` short-circuit: the right operand only runs when needed
+llvm::Value* Compiler::compileLogicalExpression(pulse::parser::BinaryExpression* expr) {
+    bool isAnd = expr->op == pulse::parser::BinaryExpression::Operator::AND;
+
+    auto left = toBool(compileExpression(expr->left.get()));
+    auto leftBlock = builder->GetInsertBlock();
+
+    auto rhsBlock = llvm::BasicBlock::Create(*context, isAnd ? "and.rhs" : "or.rhs", currentFunction);
+    auto endBlock = llvm::BasicBlock::Create(*context, isAnd ? "and.end" : "or.end");
+    if (isAnd) {
+        builder->CreateCondBr(left, rhsBlock, endBlock);
+    } else {
+        builder->CreateCondBr(left, endBlock, rhsBlock);
+    }
+
+    builder->SetInsertPoint(rhsBlock);
+    auto right = toBool(compileExpression(expr->right.get()));
+    auto rightBlock = builder->GetInsertBlock();
+    builder->CreateBr(endBlock);
+
+    endBlock->insertInto(currentFunction);
+    builder->SetInsertPoint(endBlock);
+    auto result = builder->CreatePHI(builder->getInt1Ty(), 2);
+    result->addIncoming(builder->getInt1(!isAnd), leftBlock);
+    result->addIncoming(right, rightBlock);
+    return result;
+}
+
 llvm::Value* Compiler::compileUnaryExpression(pulse::parser::UnaryExpression* expr) {
     auto operand = compileExpression(expr->operand.get());
-    if (!operand) return nullptr;
-    
+
     switch (expr->op) {
         case pulse::parser::UnaryExpression::Operator::PLUS:
-            return operand;
+            return operand->getType()->isDoubleTy() ? operand : coerce(operand, builder->getInt64Ty());
         case pulse::parser::UnaryExpression::Operator::MINUS:
-            return builder->CreateNeg(operand);
+            if (operand->getType()->isDoubleTy()) {
+                return builder->CreateFNeg(operand);
+            }
+            return builder->CreateNeg(coerce(operand, builder->getInt64Ty()));
         case pulse::parser::UnaryExpression::Operator::NOT:
-            return builder->CreateNot(operand);
+            return builder->CreateNot(toBool(operand));
         default:
             return nullptr;
     }
 }
 
 llvm::Value* Compiler::compileCallExpression(pulse::parser::CallExpression* expr) {
-    auto callee = compileExpression(expr->callee.get());
-    if (!callee) return nullptr;
-    
+    auto callee = pulse::parser::dyn_cast<pulse::parser::IdentifierExpression>(expr->callee.get());
+    if (!callee) {
+        throw std::runtime_error("Only direct calls are supported by native code generation");
+    }
+
+    // Calls of functions in this module go to the specialization for the
+    // argument types at hand
+    if (auto decl = inference->findFunction(callee->name)) {
+        std::vector<llvm::Value*> args;
+        Signature signature;
+        for (const auto& argument : expr->arguments) {
+            args.push_back(compileExpression(argument.get()));
+            signature.push_back(getValueType(args.back()->getType()));
+        }
+
+        llvm::Function* function = getOrCreateInstance(inference->instantiate(decl, signature));
+        for (size_t i = 0; i < args.size(); i++) {
+            args[i] = coerce(args[i], function->getArg(static_cast<unsigned>(i))->getType());
+        }
+        return builder->CreateCall(function, args);
+    }
+
+    if (callee->name == "out" || callee->name == "print") {
+        return compilePrintCall(expr);
+    }
+    if (TypeInference::isNumericBuiltin(callee->name)) {
+        return compileNumericCall(callee->name, expr);
+    }
+    if (TypeInference::isBuiltin(callee->name)) {
+        return compileConversionCall(callee->name, expr);
+    }
+
+    // Functions of imported modules take the parameters their interface says
+    for (const auto& import : imports) {
+        int arity = import->functionArity(callee->name);
+        if (arity >= 0 && static_cast<size_t>(arity) != expr->arguments.size()) {
+            throw std::runtime_error("Function '" + std::string(callee->name) + "' of module '" +
+                                     std::string(import->module()) + "' expects " + std::to_string(arity) +
+                                     " arguments, got " + std::to_string(expr->arguments.size()));
+        }
+        if (arity >= 0) break;
+    }
+
+    // Unknown names are external functions that take and return int64
+    auto it = functions.find(callee->name);
+    llvm::Function* function = nullptr;
+    if (it != functions.end()) {
+        function = it->second;
+    } else {
+        std::vector<llvm::Type*> paramTypes(expr->arguments.size(), builder->getInt64Ty());
+        function = getOrCreateFunction(std::string(callee->name), builder->getInt64Ty(), paramTypes);
+        functions.emplace(std::string(callee->name), function);
+    }
+
+    if (function->arg_size() != expr->arguments.size()) {
+        throw std::runtime_error("Function '" + std::string(callee->name) + "' expects " +
+                                 std::to_string(function->arg_size()) + " arguments");
+    }
+
+    std::vector<llvm::Value*> args;
+    for (size_t i = 0; i < expr->arguments.size(); i++) {
+        auto arg = compileExpression(expr->arguments[i].get());
+        args.push_back(coerce(arg, function->getArg(static_cast<unsigned>(i))->getType()));
+    }
+
+    return builder->CreateCall(function, args);
+}
+
+// int(x), float(x) and bool(x) on native values
+llvm::Value* Compiler::compileConversionCall(std::string_view name, pulse::parser::CallExpression* expr) {
+    if (expr->arguments.size() != 1) {
+        throw std::runtime_error(std::string(name) + "() expects 1 argument");
+    }
+
+    auto value = compileExpression(expr->arguments[0].get());
+    if (name == "bool") {
+        return toBool(value);
+    }
+    if (value->getType()->isPointerTy()) {
+        throw std::runtime_error(std::string(name) + "() of a string is not supported by native code generation");
+    }
+    // fptosi truncates toward zero, like int() on a float
+    return coerce(value, name == "float" ? builder->getDoubleTy() : builder->getInt64Ty());
+}
+
+// min(), max() and abs() lower to intrinsics and selects, which the loop
+// vectorizer turns into SIMD min/max/abs instructions
+llvm::Value* Compiler::compileNumericCall(std::string_view name, pulse::parser::CallExpression* expr) {
     std::vector<llvm::Value*> args;
-    for (const auto& arg : expr->arguments) {
-        auto compiledArg = compileExpression(arg.get());
-        if (compiledArg) {
-            args.push_back(compiledArg);
+    Signature signature;
+    for (const auto& argument : expr->arguments) {
+        args.push_back(compileExpression(argument.get()));
+        signature.push_back(getValueType(args.back()->getType()));
+    }
+    ValueType type = TypeInference::numericBuiltinType(name, signature);
+    if (type != ValueType::INT && type != ValueType::FLOAT) {
+        throw std::runtime_error(std::string(name) + "() of these arguments is not supported by native code generation");
+    }
+
+    if (name == "abs") {
+        if (type == ValueType::FLOAT) {
+            return builder->CreateUnaryIntrinsic(llvm::Intrinsic::fabs, args[0]);
         }
+        // Not poison at the smallest int: it wraps, like the VM's abs()
+        return builder->CreateBinaryIntrinsic(llvm::Intrinsic::abs, coerce(args[0], builder->getInt64Ty()),
+                                              builder->getFalse());
     }
-    
-    // For now, assume all functions return int64
-    return builder->CreateCall(
-        llvm::FunctionType::get(builder->getInt64Ty(), false),
-        callee,
-        args
-    );
+
+    // The first of equal candidates wins, and a NaN only where Python's
+    // `b < a` (or `b > a`) comparisons would keep it
+    bool min = name == "min";
+    llvm::Value* best = args[0];
+    for (size_t i = 1; i < args.size(); i++) {
+        llvm::Value* candidate = args[i];
+        if (type == ValueType::INT) {
+            best = builder->CreateBinaryIntrinsic(min ? llvm::Intrinsic::smin : llvm::Intrinsic::smax, best, candidate);
+        } else {
+            llvm::Value* better = min ? builder->CreateFCmpOLT(candidate, best) : builder->CreateFCmpOGT(candidate, best);
+            best = builder->CreateSelect(better, candidate, best);
+        }
+    }
+    return best;
+}
+
+// out()/print() lower to one printf call with a format built from the argument types
+llvm::Value* Compiler::compilePrintCall(pulse::parser::CallExpression* expr) {
+    std::string format;
+    std::vector<llvm::Value*> args;
+    args.push_back(nullptr); // format string, filled in below
+
+    for (const auto& argument : expr->arguments) {
+        auto value = compileExpression(argument.get());
+        if (!format.empty()) format += ' ';
+
+        llvm::Type* type = value->getType();
+        if (type->isIntegerTy(1)) {
+            format += "%s";
+            args.push_back(builder->CreateSelect(value, builder->CreateGlobalStringPtr("True"),
+                                                 builder->CreateGlobalStringPtr("False")));
+        } else if (type->isIntegerTy()) {
+            format += "%lld";
+            args.push_back(coerce(value, builder->getInt64Ty()));
+        } else if (type->isDoubleTy()) {
+            // As the interpreter prints it (Value::toString), not printf's %g
+            auto text = createEntryBlockAlloca(llvm::ArrayType::get(builder->getInt8Ty(), 64), "float.text");
+            auto buffer = builder->CreateConstInBoundsGEP2_32(text->getAllocatedType(), text, 0, 0);
+            builder->CreateCall(getFloatFormatter(), {value, buffer});
+            format += "%s";
+            args.push_back(buffer);
+        } else {
+            format += "%s";
+            args.push_back(value);
+        }
+    }
+    format += '\n';
+
+    args[0] = builder->CreateGlobalStringPtr(format);
+    builder->CreateCall(module->getFunction("printf"), args);
+    return builder->getInt64(0);
+}
+
+// pulse.format_float(value, out): the shortest digits that read back as
+// value, fixed or scientific as std::to_chars picks, with ".0" when neither
+// a '.' nor an exponent shows, into out (64 bytes): the text of
+// Value::toString. Built on printf and strtod, since compiled programs link
+// against the C library only:
+//
+//   for (p = 0; p < 16 && strtod(snprintf("%.*e", p, value)) != value; p++);
+//   fixed = snprintf("%.*f", max(p - exponent, 0), value), if |exponent| < 24
+//   out = the shorter, fixed on a tie
+//
+// Past 10^24 either side the fixed form is always the longer.
+llvm::Function* Compiler::getFloatFormatter() {
+    if (auto existing = module->getFunction("pulse.format_float")) {
+        return existing;
+    }
+
+    auto i8Ptr = builder->getInt8PtrTy();
+    auto i32 = builder->getInt32Ty();
+    auto i64 = builder->getInt64Ty();
+    auto f64 = builder->getDoubleTy();
+    auto declare = [&](const char* name, llvm::Type* result, std::vector<llvm::Type*> params, bool variadic = false) {
+        return module->getOrInsertFunction(name, llvm::FunctionType::get(result, params, variadic));
+    };
+    auto snprintf = declare("snprintf", i32, {i8Ptr, i64, i8Ptr}, true);
+    auto strtod = declare("strtod", f64, {i8Ptr, llvm::PointerType::getUnqual(i8Ptr)});
+    auto strchr = declare("strchr", i8Ptr, {i8Ptr, i32});
+    auto atoi = declare("atoi", i32, {i8Ptr});
+    auto strlen = declare("strlen", i64, {i8Ptr});
+    auto strcpy = declare("strcpy", i8Ptr, {i8Ptr, i8Ptr});
+    auto strpbrk = declare("strpbrk", i8Ptr, {i8Ptr, i8Ptr});
+    auto strcat = declare("strcat", i8Ptr, {i8Ptr, i8Ptr});
+
+    auto type = llvm::FunctionType::get(builder->getVoidTy(), {f64, i8Ptr}, false);
+    auto function = llvm::Function::Create(type, llvm::Function::InternalLinkage, "pulse.format_float", module.get());
+    llvm::Value* value = function->getArg(0);
+    llvm::Value* out = function->getArg(1);
+    auto block = [&](const char* name) { return llvm::BasicBlock::Create(*context, name, function); };
+    auto entry = block("entry");
+    auto special = block("special");
+    auto finite = block("finite");
+    auto search = block("search");
+    auto found = block("found");
+    auto fixed = block("fixed");
+    auto finish = block("finish");
+    auto suffix = block("suffix");
+    auto done = block("done");
+
+    Builder b(entry);
+    auto scientific = b.CreateAlloca(b.getInt8Ty(), b.getInt32(32), "scientific");
+    auto plain = b.CreateAlloca(b.getInt8Ty(), b.getInt32(64), "fixed");
+    // nan fails the first comparison and inf the second
+    auto infinite = b.CreateFCmpUEQ(b.CreateUnaryIntrinsic(llvm::Intrinsic::fabs, value),
+                                    llvm::ConstantFP::getInfinity(f64));
+    b.CreateCondBr(infinite, special, finite);
+
+    b.SetInsertPoint(special);
+    auto name = b.CreateSelect(b.CreateFCmpUNO(value, value), b.CreateGlobalStringPtr("nan"),
+                               b.CreateSelect(b.CreateFCmpOGT(value, llvm::ConstantFP::get(f64, 0.0)),
+                                              b.CreateGlobalStringPtr("inf"), b.CreateGlobalStringPtr("-inf")));
+    b.CreateCall(strcpy, {out, name});
+    b.CreateRetVoid();
+
+    b.SetInsertPoint(finite);
+    b.CreateBr(search);
+
+    b.SetInsertPoint(search);
+    auto precision = b.CreatePHI(i32, 2, "precision");
+    precision->addIncoming(b.getInt32(0), finite);
+    b.CreateCall(snprintf, {scientific, b.getInt64(32), b.CreateGlobalStringPtr("%.*e"), precision, value});
+    auto readBack = b.CreateCall(strtod, {scientific, llvm::ConstantPointerNull::get(llvm::PointerType::getUnqual(i8Ptr))});
+    auto exact = b.CreateOr(b.CreateFCmpOEQ(readBack, value), b.CreateICmpEQ(precision, b.getInt32(16)));
+    precision->addIncoming(b.CreateAdd(precision, b.getInt32(1)), search);
+    b.CreateCondBr(exact, found, search);
+
+    b.SetInsertPoint(found);
+    auto exponent = b.CreateCall(atoi, {b.CreateConstGEP1_32(b.getInt8Ty(), b.CreateCall(strchr, {scientific, b.getInt32('e')}), 1)});
+    auto near = b.CreateAnd(b.CreateICmpSGT(exponent, b.getInt32(-24)), b.CreateICmpSLT(exponent, b.getInt32(24)));
+    b.CreateCall(strcpy, {out, scientific});
+    b.CreateCondBr(near, fixed, finish);
+
+    b.SetInsertPoint(fixed);
+    auto decimals = b.CreateBinaryIntrinsic(llvm::Intrinsic::smax, b.CreateSub(precision, exponent), b.getInt32(0));
+    b.CreateCall(snprintf, {plain, b.getInt64(64), b.CreateGlobalStringPtr("%.*f"), decimals, value});
+    auto shorter = b.CreateICmpULE(b.CreateCall(strlen, {plain}), b.CreateCall(strlen, {scientific}));
+    b.CreateCall(strcpy, {out, b.CreateSelect(shorter, plain, scientific)});
+    b.CreateBr(finish);
+
+    b.SetInsertPoint(finish);
+    auto marked = b.CreateCall(strpbrk, {out, b.CreateGlobalStringPtr(".e")});
+    b.CreateCondBr(b.CreateIsNull(marked), suffix, done);
+
+    b.SetInsertPoint(suffix);
+    b.CreateCall(strcat, {out, b.CreateGlobalStringPtr(".0")});
+    b.CreateBr(done);
+
+    b.SetInsertPoint(done);
+    b.CreateRetVoid();
+    return function;
+}
+
+// pulse.int_power(base, exponent) for exponent >= 0: exact, by squaring,
+// and wrapping on overflow like the VM's power()
+llvm::Function* Compiler::getIntPower() {
+    if (auto existing = module->getFunction("pulse.int_power")) {
+        return existing;
+    }
+
+    auto i64 = builder->getInt64Ty();
+    auto type = llvm::FunctionType::get(i64, {i64, i64}, false);
+    auto function = llvm::Function::Create(type, llvm::Function::InternalLinkage, "pulse.int_power", module.get());
+    auto entry = llvm::BasicBlock::Create(*context, "entry", function);
+    auto loop = llvm::BasicBlock::Create(*context, "loop", function);
+    auto done = llvm::BasicBlock::Create(*context, "done", function);
+
+    Builder b(entry);
+    auto zero = b.getInt64(0);
+    b.CreateCondBr(b.CreateICmpEQ(function->getArg(1), zero), done, loop);
+
+    b.SetInsertPoint(loop);
+    auto result = b.CreatePHI(i64, 2, "result");
+    auto base = b.CreatePHI(i64, 2, "base");
+    auto exponent = b.CreatePHI(i64, 2, "exponent");
+    result->addIncoming(b.getInt64(1), entry);
+    base->addIncoming(function->getArg(0), entry);
+    exponent->addIncoming(function->getArg(1), entry);
+    auto odd = b.CreateICmpNE(b.CreateAnd(exponent, b.getInt64(1)), zero);
+    auto nextResult = b.CreateSelect(odd, b.CreateMul(result, base), result);
+    auto nextExponent = b.CreateLShr(exponent, b.getInt64(1));
+    result->addIncoming(nextResult, loop);
+    base->addIncoming(b.CreateMul(base, base), loop);
+    exponent->addIncoming(nextExponent, loop);
+    b.CreateCondBr(b.CreateICmpEQ(nextExponent, zero), done, loop);
+
+    b.SetInsertPoint(done);
+    auto power = b.CreatePHI(i64, 2, "power");
+    power->addIncoming(b.getInt64(1), entry);
+    power->addIncoming(nextResult, loop);
+    b.CreateRet(power);
+    return function;
+}
+
+// pulse.raise(message): what an uncaught RuntimeError does to the VM's
+// program, for compiled code: the output so far is flushed, message goes to
+// stderr and the process exits with status 1
+llvm::Function* Compiler::getRaise() {
+    if (auto existing = module->getFunction("pulse.raise")) {
+        return existing;
+    }
+
+    auto i8Ptr = builder->getInt8PtrTy();
+    auto i32 = builder->getInt32Ty();
+    auto i64 = builder->getInt64Ty();
+    auto declare = [&](const char* name, llvm::Type* result, std::vector<llvm::Type*> params) {
+        return module->getOrInsertFunction(name, llvm::FunctionType::get(result, params, false));
+    };
+    auto fflush = declare("fflush", i32, {i8Ptr});
+    auto write = declare("write", i64, {i32, i8Ptr, i64});
+    auto strlen = declare("strlen", i64, {i8Ptr});
+    auto exit = declare("exit", builder->getVoidTy(), {i32});
+
+    auto type = llvm::FunctionType::get(builder->getVoidTy(), {i8Ptr}, false);
+    auto function = llvm::Function::Create(type, llvm::Function::InternalLinkage, "pulse.raise", module.get());
+    function->setDoesNotReturn();
+    function->addFnAttr(llvm::Attribute::Cold);
+    Builder b(llvm::BasicBlock::Create(*context, "entry", function));
+    llvm::Value* message = function->getArg(0);
+    b.CreateCall(fflush, {llvm::ConstantPointerNull::get(i8Ptr)});
+    b.CreateCall(write, {b.getInt32(2), message, b.CreateCall(strlen, {message})});
+    b.CreateCall(write, {b.getInt32(2), b.CreateGlobalStringPtr("\n"), b.getInt64(1)});
+    b.CreateCall(exit, {b.getInt32(1)});
+    b.CreateUnreachable();
+    return function;
+}
+
+// Raises message when failed holds; code generation continues on the other path
+void Compiler::raiseIf(llvm::Value* failed, const char* message) {
+    auto raise = llvm::BasicBlock::Create(*context, "raise", currentFunction);
+    auto next = llvm::BasicBlock::Create(*context, "next", currentFunction);
+    builder->CreateCondBr(failed, raise, next);
+    builder->SetInsertPoint(raise);
+    builder->CreateCall(getRaise(), {builder->CreateGlobalStringPtr(message)});
+    builder->CreateUnreachable();
+    builder->SetInsertPoint(next);
 }
 
 void Compiler::compileStatement(pulse::parser::Statement* stmt) {
     if (!stmt) return;
-    
-    if (auto assign = dynamic_cast<pulse::parser::AssignmentStatement*>(stmt)) {
-        compileAssignmentStatement(assign);
-    } else if (auto expr = dynamic_cast<pulse::parser::ExpressionStatement*>(stmt)) {
-        compileExpressionStatement(expr);
-    } else if (auto ret = dynamic_cast<pulse::parser::ReturnStatement*>(stmt)) {
-        compileReturnStatement(ret);
-    } else if (auto if_stmt = dynamic_cast<pulse::parser::IfStatement*>(stmt)) {
-        compileIfStatement(if_stmt);
-    } else if (auto while_stmt = dynamic_cast<pulse::parser::WhileStatement*>(stmt)) {
-        compileWhileStatement(while_stmt);
-    } else if (auto for_stmt = dynamic_cast<pulse::parser::ForStatement*>(stmt)) {
-        compileForStatement(for_stmt);
+
+    visit(stmt);
+}
+
+void Compiler::compileBlock(const pulse::parser::ArenaVector<pulse::parser::StatementPtr>& body) {
+    for (const auto& stmt : body) {
+        // Code after a return is unreachable; emitting it would follow a terminator
+        if (blockTerminated()) return;
+        compileStatement(stmt.get());
     }
 }
 
 void Compiler::compileAssignmentStatement(pulse::parser::AssignmentStatement* stmt) {
     auto value = compileExpression(stmt->value.get());
-    if (!value) return;
-    
+
     // Create or update variable
-    auto it = variables.find(stmt->name);
-    if (it != variables.end()) {
-        builder->CreateStore(value, it->second);
-    } else {
-        auto alloca = builder->CreateAlloca(value->getType(), nullptr, stmt->name);
-        builder->CreateStore(value, alloca);
-        variables[stmt->name] = alloca;
-    }
+    auto slot = getOrCreateVariable(stmt->name, value->getType());
+    builder->CreateStore(coerce(value, slot->getAllocatedType()), slot);
 }
 
 void Compiler::compileExpressionStatement(pulse::parser::ExpressionStatement* stmt) {
@@ -221,85 +873,344 @@ void Compiler::compileExpressionStatement(pulse::parser::ExpressionStatement* st
 }
 
 void Compiler::compileReturnStatement(pulse::parser::ReturnStatement* stmt) {
+    llvm::Type* returnType = currentFunction->getReturnType();
     if (stmt->value) {
         auto value = compileExpression(stmt->value.get());
-        builder->CreateRet(value);
+        builder->CreateRet(coerce(value, returnType));
     } else {
-        builder->CreateRetVoid();
+        builder->CreateRet(llvm::Constant::getNullValue(returnType));
     }
 }
 
+// if/elif/else: one conditional branch per arm, all falling into a shared join
+// block. The join is dropped when every arm returns.
 void Compiler::compileIfStatement(pulse::parser::IfStatement* stmt) {
-    // Implementation for if statements
-    // This is a simplified version - would need more complex control flow handling
+    auto mergeBlock = llvm::BasicBlock::Create(*context, "if.end");
+
+    for (size_t i = 0; i < stmt->branches.size(); i++) {
+        const auto& branch = stmt->branches[i];
+        bool last = i + 1 == stmt->branches.size();
+
+        auto condition = toBool(compileExpression(branch.condition.get()));
+        auto thenBlock = llvm::BasicBlock::Create(*context, "if.then", currentFunction);
+        auto elseBlock = (last && stmt->else_body.empty())
+            ? mergeBlock
+            : llvm::BasicBlock::Create(*context, last ? "if.else" : "if.elif");
+        builder->CreateCondBr(condition, thenBlock, elseBlock);
+
+        builder->SetInsertPoint(thenBlock);
+        compileBlock(branch.body);
+        if (!blockTerminated()) {
+            builder->CreateBr(mergeBlock);
+        }
+
+        if (elseBlock != mergeBlock) {
+            elseBlock->insertInto(currentFunction);
+            builder->SetInsertPoint(elseBlock);
+        }
+    }
+
+    if (!stmt->else_body.empty()) {
+        compileBlock(stmt->else_body);
+        if (!blockTerminated()) {
+            builder->CreateBr(mergeBlock);
+        }
+    }
+
+    if (mergeBlock->hasNPredecessorsOrMore(1)) {
+        mergeBlock->insertInto(currentFunction);
+        builder->SetInsertPoint(mergeBlock);
+    } else {
+        // Every arm returned; the builder stays on a terminated block so the
+        // rest of the enclosing body is skipped
+        delete mergeBlock;
+    }
 }
 
+// Loops are emitted in rotated form: a guard tests the condition once, and the
+// latch at the bottom of the body re-tests it and branches back. This is the
+// shape LoopRotate would otherwise have to produce before LICM, the unroller
+// and the vectorizer can work on the loop.
 void Compiler::compileWhileStatement(pulse::parser::WhileStatement* stmt) {
-    // Implementation for while statements
-    // This is a simplified version - would need more complex control flow handling
+    auto bodyBlock = llvm::BasicBlock::Create(*context, "while.body", currentFunction);
+    auto exitBlock = llvm::BasicBlock::Create(*context, "while.end");
+
+    builder->CreateCondBr(toBool(compileExpression(stmt->condition.get())), bodyBlock, exitBlock);
+
+    builder->SetInsertPoint(bodyBlock);
+    compileBlock(stmt->body);
+    if (!blockTerminated()) {
+        auto condition = toBool(compileExpression(stmt->condition.get()));
+        builder->CreateCondBr(condition, bodyBlock, exitBlock);
+    }
+
+    exitBlock->insertInto(currentFunction);
+    builder->SetInsertPoint(exitBlock);
 }
 
 void Compiler::compileForStatement(pulse::parser::ForStatement* stmt) {
-    // Implementation for for statements
-    // This is a simplified version - would need more complex control flow handling
+    if (compileRangeLoop(stmt)) {
+        return;
+    }
+
+    throw std::runtime_error("Native code generation only supports 'for " + std::string(stmt->variable) +
+                             " in range(...)' loops");
+}
+
+// for x in range([start,] stop[, step]) becomes a counted loop on a hidden int64
+// induction variable: bounds and step are evaluated once, the body cannot
+// disturb the iteration by assigning to x, and after mem2reg the counter is a
+// canonical phi that SCEV, the unroller and the vectorizer recognise.
+bool Compiler::compileRangeLoop(pulse::parser::ForStatement* stmt) {
+    auto call = pulse::parser::dyn_cast<pulse::parser::CallExpression>(stmt->iterable.get());
+    if (!call) return false;
+
+    auto callee = pulse::parser::dyn_cast<pulse::parser::IdentifierExpression>(call->callee.get());
+    if (!callee || callee->name != "range" || inference->findFunction(callee->name)) return false;
+
+    const auto& args = call->arguments;
+    if (args.empty() || args.size() > 3) {
+        throw std::runtime_error("range() expects 1 to 3 arguments");
+    }
+
+    auto int64Ty = builder->getInt64Ty();
+    llvm::Value* start = builder->getInt64(0);
+    llvm::Value* stop = nullptr;
+    llvm::Value* step = builder->getInt64(1);
+    std::optional<int64_t> constantStep = 1;
+
+    if (args.size() == 1) {
+        stop = coerce(compileExpression(args[0].get()), int64Ty);
+    } else {
+        start = coerce(compileExpression(args[0].get()), int64Ty);
+        stop = coerce(compileExpression(args[1].get()), int64Ty);
+    }
+    if (args.size() == 3) {
+        constantStep = constantInteger(args[2].get());
+        step = coerce(compileExpression(args[2].get()), int64Ty);
+        if (constantStep && *constantStep == 0) {
+            throw std::runtime_error("range() step must not be zero");
+        }
+    }
+
+    // With a literal step the loop test is a single compare; otherwise pick the
+    // direction at run time
+    auto inBounds = [&](llvm::Value* value) -> llvm::Value* {
+        if (constantStep) {
+            return *constantStep > 0 ? builder->CreateICmpSLT(value, stop) : builder->CreateICmpSGT(value, stop);
+        }
+        auto ascending = builder->CreateICmpSGT(step, builder->getInt64(0));
+        return builder->CreateSelect(ascending, builder->CreateICmpSLT(value, stop),
+                                     builder->CreateICmpSGT(value, stop));
+    };
+
+    auto counter = createEntryBlockAlloca(int64Ty, std::string(stmt->variable) + ".iv");
+    auto variable = getOrCreateVariable(stmt->variable, int64Ty);
+    builder->CreateStore(start, counter);
+
+    auto bodyBlock = llvm::BasicBlock::Create(*context, "for.body", currentFunction);
+    auto exitBlock = llvm::BasicBlock::Create(*context, "for.end");
+    builder->CreateCondBr(inBounds(start), bodyBlock, exitBlock);
+
+    builder->SetInsertPoint(bodyBlock);
+    auto current = builder->CreateLoad(int64Ty, counter);
+    builder->CreateStore(coerce(current, variable->getAllocatedType()), variable);
+    compileBlock(stmt->body);
+
+    if (!blockTerminated()) {
+        // The bound check keeps the increment from wrapping
+        auto value = builder->CreateLoad(int64Ty, counter);
+        auto next = builder->CreateNSWAdd(value, step, "iv.next");
+        builder->CreateStore(next, counter);
+        markMustProgress(builder->CreateCondBr(inBounds(next), bodyBlock, exitBlock));
+    }
+
+    exitBlock->insertInto(currentFunction);
+    builder->SetInsertPoint(exitBlock);
+    return true;
 }
 
 void Compiler::compileDeclaration(pulse::parser::Declaration* decl) {
     if (!decl) return;
-    
-    if (auto func = dynamic_cast<pulse::parser::FunctionDeclaration*>(decl)) {
-        compileFunctionDeclaration(func);
-    } else if (auto cls = dynamic_cast<pulse::parser::ClassDeclaration*>(decl)) {
-        compileClassDeclaration(cls);
-    }
+
+    visit(decl);
 }
 
+// Other modules call this function through the untyped ABI (int64 arguments,
+// int64 result). It is exported as the all-int specialization itself, or as a
+// thin wrapper around it when that specialization returns another type.
 void Compiler::compileFunctionDeclaration(pulse::parser::FunctionDeclaration* decl) {
-    // Create function type
+    Signature untyped(decl->parameters.size(), ValueType::INT);
+    llvm::Function* implementation = getOrCreateInstance(inference->instantiate(decl, untyped));
+
+    auto int64Ty = builder->getInt64Ty();
+    if (implementation->getReturnType() == int64Ty) {
+        implementation->setLinkage(llvm::Function::ExternalLinkage);
+        implementation->setDSOLocal(false);
+        implementation->setName(toStringRef(decl->name));
+        functions.emplace(std::string(decl->name), implementation);
+        return;
+    }
+
+    std::vector<llvm::Type*> paramTypes(decl->parameters.size(), int64Ty);
+    auto wrapper = llvm::Function::Create(llvm::FunctionType::get(int64Ty, paramTypes, false),
+                                          llvm::Function::ExternalLinkage, toStringRef(decl->name), module.get());
+    functions.emplace(std::string(decl->name), wrapper);
+
+    auto savedBlock = builder->GetInsertBlock();
+    builder->SetInsertPoint(llvm::BasicBlock::Create(*context, "entry", wrapper));
+
+    std::vector<llvm::Value*> args;
+    for (auto& arg : wrapper->args()) {
+        args.push_back(&arg);
+    }
+    builder->CreateRet(coerce(builder->CreateCall(implementation, args), int64Ty));
+
+    builder->SetInsertPoint(savedBlock);
+}
+
+llvm::Function* Compiler::getOrCreateInstance(const FunctionInstance& instance) {
+    auto it = instanceFunctions.find(&instance);
+    if (it != instanceFunctions.end()) {
+        return it->second;
+    }
+
     std::vector<llvm::Type*> paramTypes;
-    for (size_t i = 0; i < decl->parameters.size(); ++i) {
-        paramTypes.push_back(builder->getInt64Ty());
-    }
-    
-    auto funcType = llvm::FunctionType::get(builder->getInt64Ty(), paramTypes, false);
-    
-    // Create function
-    auto function = llvm::Function::Create(
-        funcType,
-        llvm::Function::ExternalLinkage,
-        decl->name,
-        module.get()
-    );
-    
+    for (ValueType type : instance.params) {
+        paramTypes.push_back(getLLVMType(type));
+    }
+    auto funcType = llvm::FunctionType::get(getLLVMType(instance.returnType), paramTypes, false);
+
+    // Specializations are private to the module; the optimizer may inline,
+    // clone or drop them freely
+    auto function = llvm::Function::Create(funcType, llvm::Function::InternalLinkage,
+                                           instance.symbol, module.get());
+    for (size_t i = 0; i < instance.params.size(); i++) {
+        function->getArg(static_cast<unsigned>(i))->setName(toStringRef(instance.decl->parameters[i]));
+    }
+
+    instanceFunctions.emplace(&instance, function);
+    pendingInstances.push_back(&instance);
+    return function;
+}
+
+void Compiler::compileInstance(const FunctionInstance& instance) {
+    llvm::Function* function = getOrCreateInstance(instance);
+
+    // Compile the body in its own scope, then resume where main left off
+    auto savedBlock = builder->GetInsertBlock();
+    auto savedFunction = currentFunction;
+    auto savedVariables = std::move(variables);
+    variables.clear();
+    currentFunction = function;
+
     // Create entry block
     auto entryBlock = llvm::BasicBlock::Create(*context, "entry", function);
     builder->SetInsertPoint(entryBlock);
-    
-    // Store function parameters
-    size_t paramIndex = 0;
+    declareLocals(instance);
+
+    // Parameters are spilled to slots like any other local; mem2reg undoes it.
+    // A slot is wider than its parameter when the body assigns e.g. a float.
     for (auto& arg : function->args()) {
-        auto alloca = builder->CreateAlloca(builder->getInt64Ty(), nullptr, decl->parameters[paramIndex]);
-        builder->CreateStore(&arg, alloca);
-        variables[decl->parameters[paramIndex]] = alloca;
-        paramIndex++;
+        auto slot = getOrCreateVariable(instance.decl->parameters[arg.getArgNo()], arg.getType());
+        builder->CreateStore(coerce(&arg, slot->getAllocatedType()), slot);
     }
-    
+
     // Compile function body
-    for (const auto& stmt : decl->body) {
-        compileStatement(stmt.get());
+    compileBlock(*instance.body);
+
+    // Falling off the end returns the zero of the inferred return type
+    if (!blockTerminated()) {
+        builder->CreateRet(llvm::Constant::getNullValue(function->getReturnType()));
     }
-    
-    // Add return if not present
-    if (!entryBlock->getTerminator()) {
-        builder->CreateRet(builder->getInt64(0));
+
+    variables = std::move(savedVariables);
+    currentFunction = savedFunction;
+    builder->SetInsertPoint(savedBlock);
+}
+
+// One slot per local, typed with the join of everything assigned to it
+void Compiler::declareLocals(const FunctionInstance& instance) {
+    for (const auto& [name, type] : instance.locals) {
+        getOrCreateVariable(name, getLLVMType(type));
     }
 }
 
-void Compiler::compileClassDeclaration(pulse::parser::ClassDeclaration* decl) {
+void Compiler::compileClassDeclaration(pulse::parser::ClassDeclaration* /*decl*/) {
     // Implementation for class declarations
     // This would involve creating LLVM struct types and methods
 }
 
+llvm::Value* Compiler::toBool(llvm::Value* value) {
+    llvm::Type* type = value->getType();
+    if (type->isIntegerTy(1)) {
+        return value;
+    } else if (type->isIntegerTy()) {
+        return builder->CreateICmpNE(value, llvm::ConstantInt::get(type, 0));
+    } else if (type->isDoubleTy()) {
+        return builder->CreateFCmpUNE(value, llvm::ConstantFP::get(type, 0.0));
+    } else if (type->isPointerTy()) {
+        return builder->CreateIsNotNull(value);
+    }
+    throw std::runtime_error("Value cannot be used as a condition");
+}
+
+llvm::Value* Compiler::coerce(llvm::Value* value, llvm::Type* type) {
+    llvm::Type* from = value->getType();
+    if (from == type) {
+        return value;
+    }
+
+    if (type->isIntegerTy(1)) {
+        return toBool(value);
+    } else if (from->isIntegerTy(1) && type->isIntegerTy()) {
+        return builder->CreateZExt(value, type);
+    } else if (from->isIntegerTy() && type->isIntegerTy()) {
+        return builder->CreateSExtOrTrunc(value, type);
+    } else if (from->isIntegerTy() && type->isDoubleTy()) {
+        return from->isIntegerTy(1) ? builder->CreateUIToFP(value, type) : builder->CreateSIToFP(value, type);
+    } else if (from->isDoubleTy() && type->isIntegerTy()) {
+        return builder->CreateFPToSI(value, type);
+    } else if (from->isPointerTy() && type->isIntegerTy()) {
+        return builder->CreatePtrToInt(value, type);
+    } else if (from->isIntegerTy() && type->isPointerTy()) {
+        return builder->CreateIntToPtr(value, type);
+    }
+
+    throw std::runtime_error("Incompatible types in native code generation");
+}
+
+llvm::AllocaInst* Compiler::createEntryBlockAlloca(llvm::Type* type, std::string_view name) {
+    llvm::BasicBlock& entry = currentFunction->getEntryBlock();
+    Builder entryBuilder(&entry, entry.begin());
+    return entryBuilder.CreateAlloca(type, nullptr, toStringRef(name));
+}
+
+llvm::AllocaInst* Compiler::getOrCreateVariable(std::string_view name, llvm::Type* type) {
+    auto it = variables.find(name);
+    if (it != variables.end()) {
+        return it->second;
+    }
+
+    auto slot = createEntryBlockAlloca(type, name);
+    variables.emplace(std::string(name), slot);
+    return slot;
+}
+
+bool Compiler::blockTerminated() const {
+    auto block = builder->GetInsertBlock();
+    return block && block->getTerminator();
+}
+
+// Range loops always terminate, which lets the optimizer delete empty ones
+void Compiler::markMustProgress(llvm::BranchInst* latch) {
+    auto self = llvm::MDNode::getTemporary(*context, llvm::None);
+    auto progress = llvm::MDNode::get(*context, llvm::MDString::get(*context, "llvm.loop.mustprogress"));
+    auto loopID = llvm::MDNode::getDistinct(*context, {self.get(), progress});
+    loopID->replaceOperandWith(0, loopID);
+    latch->setMetadata(llvm::LLVMContext::MD_loop, loopID);
+}
+
 llvm::Type* Compiler::getLLVMType(const std::string& typeName) {
     if (typeName == "int" || typeName == "i64") {
         return builder->getInt64Ty();
@@ -310,25 +1221,159 @@ llvm::Type* Compiler::getLLVMType(const std::string& typeName) {
     } else if (typeName == "str") {
         return builder->getInt8PtrTy();
     }
-    
+
     return builder->getInt64Ty(); // Default to int64
 }
 
-llvm::Type* Compiler::getLLVMType(pulse::parser::Expression* expr) {
-    // Infer type from expression
-    if (auto literal = dynamic_cast<pulse::parser::LiteralExpression*>(expr)) {
-        if (std::holds_alternative<int64_t>(literal->value)) {
-            return builder->getInt64Ty();
-        } else if (std::holds_alternative<double>(literal->value)) {
-            return builder->getDoubleTy();
-        } else if (std::holds_alternative<bool>(literal->value)) {
-            return builder->getInt1Ty();
-        } else if (std::holds_alternative<std::string>(literal->value)) {
-            return builder->getInt8PtrTy();
+llvm::Type* Compiler::getLLVMType(ValueType type) {
+    switch (type) {
+        case ValueType::BOOL: return builder->getInt1Ty();
+        case ValueType::FLOAT: return builder->getDoubleTy();
+        case ValueType::STR: return builder->getInt8PtrTy();
+        default: return builder->getInt64Ty(); // int, and the untyped fallback
+    }
+}
+
+ValueType Compiler::getValueType(llvm::Type* type) {
+    if (type->isIntegerTy(1)) return ValueType::BOOL;
+    if (type->isDoubleTy()) return ValueType::FLOAT;
+    if (type->isPointerTy()) return ValueType::STR;
+    return ValueType::INT;
+}
+
+// Pick the target and tag every function with its CPU and features, so the
+// optimizer's cost model and any later (LTO) code generation agree on them
+void Compiler::configureTarget() {
+    initializeTargets();
+
+    std::string triple = options.targetTriple.empty() ? llvm::sys::getDefaultTargetTriple() : options.targetTriple;
+    std::string lookupError;
+    const llvm::Target* target = llvm::TargetRegistry::lookupTarget(triple, lookupError);
+    if (!target) {
+        throw std::runtime_error("Unknown target '" + triple + "': " + lookupError);
+    }
+
+    std::string cpu = options.targetCPU;
+    std::string features;
+    if (cpu == "native") {
+        cpu = llvm::sys::getHostCPUName().str();
+        features = hostCPUFeatures();
+    }
+    if (cpu.empty()) {
+        cpu = "generic";
+    }
+
+    llvm::TargetOptions targetOptions;
+    targetMachine.reset(target->createTargetMachine(triple, cpu, features, targetOptions,
+                                                    llvm::Reloc::PIC_, llvm::None,
+                                                    toCodeGenLevel(options.optLevel)));
+    if (!targetMachine) {
+        throw std::runtime_error("Could not create a target machine for '" + triple + "'");
+    }
+
+    module->setTargetTriple(triple);
+    module->setDataLayout(targetMachine->createDataLayout());
+
+    for (auto& function : *module) {
+        if (function.isDeclaration()) continue;
+        function.addFnAttr("target-cpu", cpu);
+        if (!features.empty()) {
+            function.addFnAttr("target-features", features);
         }
     }
-    
-    return builder->getInt64Ty(); // Default to int64
+}
+
+void Compiler::optimize() {
+    llvm::LoopAnalysisManager loopAnalyses;
+    llvm::FunctionAnalysisManager functionAnalyses;
+    llvm::CGSCCAnalysisManager cgsccAnalyses;
+    llvm::ModuleAnalysisManager moduleAnalyses;
+
+    llvm::PipelineTuningOptions tuning;
+    tuning.LoopVectorization = options.optLevel >= 2;
+    tuning.SLPVectorization = options.optLevel >= 2;
+
+    // --time-report: every pass and analysis as a part of "optimize".
+    // Pass managers and adaptors only run other passes, which are counted.
+    llvm::PassInstrumentationCallbacks instrumentation;
+    std::vector<std::unique_ptr<pulse::driver::TimeReport::Scope>> running;
+    bool timed = pulse::driver::TimeReport::get().isEnabled();
+    if (timed) {
+        auto counted = [](llvm::StringRef pass) {
+            return !pass.contains("PassManager") && !pass.contains("Adaptor") && !pass.contains("RepeatedPass");
+        };
+        auto begin = [&running, counted](llvm::StringRef pass) {
+            if (counted(pass)) {
+                running.push_back(std::make_unique<pulse::driver::TimeReport::Scope>("optimize/" + pass.str()));
+            }
+        };
+        auto end = [&running, counted](llvm::StringRef pass) {
+            if (counted(pass) && !running.empty()) running.pop_back();
+        };
+        instrumentation.registerBeforeNonSkippedPassCallback([begin](llvm::StringRef pass, llvm::Any) { begin(pass); });
+        instrumentation.registerAfterPassCallback(
+            [end](llvm::StringRef pass, llvm::Any, const llvm::PreservedAnalyses&) { end(pass); });
+        instrumentation.registerAfterPassInvalidatedCallback(
+            [end](llvm::StringRef pass, const llvm::PreservedAnalyses&) { end(pass); });
+        instrumentation.registerBeforeAnalysisCallback([begin](llvm::StringRef pass, llvm::Any) { begin(pass); });
+        instrumentation.registerAfterAnalysisCallback([end](llvm::StringRef pass, llvm::Any) { end(pass); });
+    }
+
+    llvm::PassBuilder passBuilder(targetMachine.get(), tuning, llvm::None, timed ? &instrumentation : nullptr);
+    passBuilder.registerModuleAnalyses(moduleAnalyses);
+    passBuilder.registerCGSCCAnalyses(cgsccAnalyses);
+    passBuilder.registerFunctionAnalyses(functionAnalyses);
+    passBuilder.registerLoopAnalyses(loopAnalyses);
+    passBuilder.crossRegisterProxies(loopAnalyses, functionAnalyses, cgsccAnalyses, moduleAnalyses);
+
+    llvm::OptimizationLevel level = toOptimizationLevel(options.optLevel);
+    llvm::ModulePassManager passes;
+    if (options.optLevel == 0) {
+        passes = passBuilder.buildO0DefaultPipeline(level, options.thinLTOPreLink);
+    } else if (options.thinLTOPreLink) {
+        // Leaves cross-module inlining and the heavy loop passes to the link step
+        passes = passBuilder.buildThinLTOPreLinkDefaultPipeline(level);
+    } else {
+        passes = passBuilder.buildPerModuleDefaultPipeline(level);
+    }
+
+    passes.run(*module, moduleAnalyses);
+}
+
+void Compiler::writeOutput(const std::string& outputFile) {
+    std::error_code ec;
+    llvm::raw_fd_ostream out(outputFile, ec, llvm::sys::fs::OF_None);
+    if (ec) {
+        throw std::runtime_error("Could not open " + outputFile + ": " + ec.message());
+    }
+
+    auto endsWith = [&](const std::string& suffix) {
+        return outputFile.size() >= suffix.size() &&
+               outputFile.compare(outputFile.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+
+    if (options.thinLTOPreLink) {
+        // The summary lets the ThinLTO link import across modules without
+        // loading every one of them
+        llvm::ProfileSummaryInfo profileSummary(*module);
+        llvm::ModuleSummaryIndex index = llvm::buildModuleSummaryIndex(*module, nullptr, &profileSummary);
+        llvm::WriteBitcodeToFile(*module, out, false, &index);
+    } else if (endsWith(".ll")) {
+        module->print(out, nullptr);
+    } else if (endsWith(".bc")) {
+        llvm::WriteBitcodeToFile(*module, out);
+    } else {
+        llvm::legacy::PassManager codegen;
+        if (targetMachine->addPassesToEmitFile(codegen, out, nullptr, llvm::CGFT_ObjectFile)) {
+            throw std::runtime_error("Target cannot emit object files");
+        }
+        codegen.run(*module);
+    }
+
+    out.flush();
+    if (out.has_error()) {
+        throw std::runtime_error("Failed to write " + outputFile);
+    }
 }
 
 void Compiler::createMainFunction() {
@@ -336,15 +1381,43 @@ void Compiler::createMainFunction() {
     auto mainFunc = llvm::Function::Create(
         mainType,
         llvm::Function::ExternalLinkage,
-        "main",
+        options.entryPoint,
         module.get()
     );
-    
+
     auto entryBlock = llvm::BasicBlock::Create(*context, "entry", mainFunc);
     builder->SetInsertPoint(entryBlock);
-    
+
     currentFunction = mainFunc;
-    currentBlock = entryBlock;
+}
+
+// uint64 symbol(const uint64* args): unpack each argument from its raw bits,
+// call the specialization and pack the result the same way
+void Compiler::createAdapter(llvm::Function* implementation, const FunctionInstance& instance,
+                             const std::string& symbol) {
+    auto int64Ty = builder->getInt64Ty();
+    auto adapterType = llvm::FunctionType::get(int64Ty, {llvm::PointerType::getUnqual(int64Ty)}, false);
+    auto adapter = llvm::Function::Create(adapterType, llvm::Function::ExternalLinkage, symbol, module.get());
+    builder->SetInsertPoint(llvm::BasicBlock::Create(*context, "entry", adapter));
+
+    std::vector<llvm::Value*> args;
+    for (size_t i = 0; i < instance.params.size(); i++) {
+        auto slot = builder->CreateConstInBoundsGEP1_64(int64Ty, adapter->getArg(0), i);
+        llvm::Value* bits = builder->CreateLoad(int64Ty, slot);
+        switch (instance.params[i]) {
+            case ValueType::FLOAT: args.push_back(builder->CreateBitCast(bits, builder->getDoubleTy())); break;
+            case ValueType::BOOL: args.push_back(builder->CreateTrunc(bits, builder->getInt1Ty())); break;
+            default: args.push_back(bits); break;
+        }
+    }
+
+    llvm::Value* result = builder->CreateCall(implementation, args);
+    if (result->getType()->isDoubleTy()) {
+        result = builder->CreateBitCast(result, int64Ty);
+    } else {
+        result = builder->CreateZExt(result, int64Ty);
+    }
+    builder->CreateRet(result);
 }
 
 void Compiler::setupStandardLibrary() {
@@ -356,8 +1429,11 @@ void Compiler::setupStandardLibrary() {
 
 llvm::Function* Compiler::getOrCreateFunction(const std::string& name, llvm::Type* returnType,
                                              const std::vector<llvm::Type*>& paramTypes) {
+    if (auto existing = module->getFunction(name)) {
+        return existing;
+    }
     auto funcType = llvm::FunctionType::get(returnType, paramTypes, false);
     return llvm::Function::Create(funcType, llvm::Function::ExternalLinkage, name, module.get());
 }
 
-} // namespace pulse::compiler 
\ No newline at end of file
+} // namespace pulse::compiler
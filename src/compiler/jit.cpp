@@ -0,0 +1,176 @@
+#include "compiler/jit.hpp"
+#include "compiler/compiler.hpp"
+#include <llvm/ExecutionEngine/JITEventListener.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/ExecutionEngine/SectionMemoryManager.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Object/SymbolSize.h>
+#include <llvm/Support/TargetSelect.h>
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace pulse::compiler {
+
+namespace {
+
+// Unwrap an llvm::Expected, turning its error into an exception
+template <typename T>
+T check(llvm::Expected<T> value, const char* what) {
+    if (!value) {
+        throw std::runtime_error(std::string(what) + ": " + llvm::toString(value.takeError()));
+    }
+    return std::move(*value);
+}
+
+void check(llvm::Error error, const char* what) {
+    if (error) {
+        throw std::runtime_error(std::string(what) + ": " + llvm::toString(std::move(error)));
+    }
+}
+
+llvm::CodeGenOpt::Level toCodeGenLevel(unsigned level) {
+    switch (level) {
+        case 0: return llvm::CodeGenOpt::None;
+        case 1: return llvm::CodeGenOpt::Less;
+        case 2: return llvm::CodeGenOpt::Default;
+        default: return llvm::CodeGenOpt::Aggressive;
+    }
+}
+
+void initializeNativeTarget() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmPrinter();
+    });
+}
+
+#ifndef _WIN32
+// Appends every function the JIT loads to /tmp/perf-PID.map, where perf
+// looks up addresses in anonymous executable memory. One file per process,
+// shared by all the JITs in it.
+class PerfMapListener : public llvm::JITEventListener {
+public:
+    static PerfMapListener& get() {
+        static PerfMapListener listener;
+        return listener;
+    }
+
+    void notifyObjectLoaded(ObjectKey, const llvm::object::ObjectFile& object,
+                            const llvm::RuntimeDyld::LoadedObjectInfo& info) override {
+        // The copy with the addresses the sections were loaded at
+        llvm::object::OwningBinary<llvm::object::ObjectFile> loaded = info.getObjectForDebug(object);
+        if (!loaded.getBinary()) return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!map) return;
+        for (const auto& [symbol, size] : llvm::object::computeSymbolSizes(*loaded.getBinary())) {
+            auto type = symbol.getType();
+            auto name = symbol.getName();
+            auto address = symbol.getAddress();
+            if (!type || !name || !address || *type != llvm::object::SymbolRef::ST_Function || size == 0) {
+                llvm::consumeError(type.takeError());
+                llvm::consumeError(name.takeError());
+                llvm::consumeError(address.takeError());
+                continue;
+            }
+            std::fprintf(map, "%llx %llx %s\n", static_cast<unsigned long long>(*address),
+                         static_cast<unsigned long long>(size), name->str().c_str());
+        }
+        std::fflush(map);
+    }
+
+private:
+    std::mutex mutex;
+    std::FILE* map;
+
+    PerfMapListener() {
+        std::string path = "/tmp/perf-" + std::to_string(::getpid()) + ".map";
+        map = std::fopen(path.c_str(), "w");
+        if (!map) std::fprintf(stderr, "warning: cannot write %s\n", path.c_str());
+    }
+};
+#endif
+
+// perf wants to see the objects as they are loaded, which ORC's default
+// layer keeps to itself
+llvm::orc::LLJITBuilderState::ObjectLinkingLayerCreator perfLinkingLayer(unsigned perf) {
+    return [perf](llvm::orc::ExecutionSession& session, const llvm::Triple&)
+               -> llvm::Expected<std::unique_ptr<llvm::orc::ObjectLayer>> {
+        auto layer = std::make_unique<llvm::orc::RTDyldObjectLinkingLayer>(
+            session, [] { return std::make_unique<llvm::SectionMemoryManager>(); });
+#ifndef _WIN32
+        if (perf & PERF_MAP) layer->registerJITEventListener(PerfMapListener::get());
+#endif
+        if (perf & PERF_JITDUMP) {
+            // Null when LLVM was built without LLVM_USE_PERF
+            if (llvm::JITEventListener* jitdump = llvm::JITEventListener::createPerfJITEventListener()) {
+                layer->registerJITEventListener(*jitdump);
+            } else {
+                static std::once_flag warned;
+                std::call_once(warned, [] {
+                    std::fprintf(stderr, "warning: this LLVM was built without jitdump support\n");
+                });
+            }
+        }
+        return llvm::Expected<std::unique_ptr<llvm::orc::ObjectLayer>>(std::move(layer));
+    };
+}
+
+} // namespace
+
+JIT::JIT(unsigned optLevel, unsigned perf) {
+    initializeNativeTarget();
+
+    auto machine = check(llvm::orc::JITTargetMachineBuilder::detectHost(), "Cannot target the host");
+    machine.setCodeGenOptLevel(toCodeGenLevel(optLevel));
+
+    llvm::orc::LLLazyJITBuilder builder;
+    builder.setJITTargetMachineBuilder(std::move(machine));
+    if (perf != PERF_NONE) builder.setObjectLinkingLayerCreator(perfLinkingLayer(perf));
+    jit = check(builder.create(), "Cannot create the JIT");
+
+    auto process = check(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+                             jit->getDataLayout().getGlobalPrefix()),
+                         "Cannot resolve host symbols");
+    jit->getMainJITDylib().addGenerator(std::move(process));
+}
+
+JIT::~JIT() = default;
+
+void JIT::addModule(Compiler& compiler) {
+    auto [context, module] = compiler.releaseModule();
+    check(jit->addLazyIRModule(llvm::orc::ThreadSafeModule(std::move(module), std::move(context))),
+          "Cannot add module to the JIT");
+}
+
+uint64_t JIT::addModuleNow(Compiler& compiler, const std::string& symbol) {
+    auto [context, module] = compiler.releaseModule();
+    check(jit->addIRModule(llvm::orc::ThreadSafeModule(std::move(module), std::move(context))),
+          "Cannot add module to the JIT");
+    return check(jit->lookup(symbol), "Cannot find the compiled function").getAddress();
+}
+
+int JIT::run(const std::string& entryPoint) {
+    auto symbol = check(jit->lookup(entryPoint), "Cannot find the entry point");
+    auto entry = reinterpret_cast<int (*)()>(static_cast<uintptr_t>(symbol.getAddress()));
+
+    int result = entry();
+
+    // The program printed through the host's stdio
+    std::fflush(stdout);
+    return result;
+}
+
+} // namespace pulse::compiler
@@ -0,0 +1,133 @@
+#include "compiler/tiered_jit.hpp"
+#include "compiler/compiler.hpp"
+#include "compiler/jit.hpp"
+#include <iostream>
+#include <stdexcept>
+
+namespace pulse::compiler {
+
+namespace {
+
+// The VM's value types as the native code's; UNKNOWN for the others
+ValueType nativeType(pulse::runtime::ValueType type) {
+    switch (type) {
+        case pulse::runtime::ValueType::BOOLEAN: return ValueType::BOOL;
+        case pulse::runtime::ValueType::INTEGER: return ValueType::INT;
+        case pulse::runtime::ValueType::FLOAT: return ValueType::FLOAT;
+        default: return ValueType::UNKNOWN;
+    }
+}
+
+pulse::runtime::ValueType runtimeType(ValueType type) {
+    switch (type) {
+        case ValueType::BOOL: return pulse::runtime::ValueType::BOOLEAN;
+        case ValueType::FLOAT: return pulse::runtime::ValueType::FLOAT;
+        default: return pulse::runtime::ValueType::INTEGER;
+    }
+}
+
+// "scale(float, int)" for trace output
+std::string describe(const pulse::parser::FunctionDeclaration* decl, const Signature& params) {
+    std::string text(decl->name);
+    text += '(';
+    for (size_t i = 0; i < params.size(); i++) {
+        if (i > 0) text += ", ";
+        text += typeName(params[i]);
+    }
+    return text + ')';
+}
+
+} // namespace
+
+TieredJIT::TieredJIT(unsigned optLevel, bool trace, unsigned perf)
+    : optLevel(optLevel), trace(trace), perf(perf) {
+    thread = std::thread([this] { compileLoop(); });
+}
+
+TieredJIT::~TieredJIT() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        queue.clear();
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+void TieredJIT::request(std::shared_ptr<pulse::runtime::TierProfile> profile, pulse::runtime::Shape shape,
+                        uint64_t generation) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(Job{std::move(profile), shape, generation});
+    }
+    wake.notify_one();
+}
+
+void TieredJIT::compileLoop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping) return;
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+        // Started here so that runs which never get hot pay nothing for it
+        if (!jit) {
+            try {
+                jit = std::make_unique<JIT>(optLevel, perf);
+            } catch (const std::exception& e) {
+                if (trace) std::cerr << "tier: " << e.what() << std::endl;
+                return;
+            }
+        }
+        compile(job);
+    }
+}
+
+void TieredJIT::compile(const Job& job) {
+    auto decl = const_cast<pulse::parser::FunctionDeclaration*>(job.profile->declaration);
+    Signature params;
+    for (size_t i = 0; i < decl->parameters.size(); i++) {
+        params.push_back(nativeType(pulse::runtime::shapeArgument(job.shape, i)));
+    }
+
+    CompileOptions options;
+    options.optLevel = optLevel;
+    options.targetCPU = "native";
+    Compiler compiler(options);
+
+    // Named after the function for perf and debuggers
+    std::string symbol = "__pulse_tier_" + std::string(decl->name) + "_" + std::to_string(compiled++);
+    ValueType returnType = ValueType::UNKNOWN;
+    if (!compiler.compileSpecialization(job.profile->source.get(), decl, params, symbol, returnType)) {
+        if (trace) {
+            std::cerr << "tier: " << describe(decl, params) << " stays interpreted: " << compiler.getError() << std::endl;
+        }
+        return;
+    }
+
+    uint64_t address = 0;
+    try {
+        address = jit->addModuleNow(compiler, symbol);
+    } catch (const std::exception& e) {
+        if (trace) std::cerr << "tier: " << describe(decl, params) << ": " << e.what() << std::endl;
+        return;
+    }
+
+    pulse::runtime::NativeCode& native = code.emplace_back();
+    native.shape = job.shape;
+    native.returnType = runtimeType(returnType);
+    native.generation = job.generation;
+    native.entry = reinterpret_cast<pulse::runtime::NativeEntry>(static_cast<uintptr_t>(address));
+    native.next = job.profile->native.load(std::memory_order_relaxed);
+    job.profile->native.store(&native, std::memory_order_release);
+
+    if (trace) {
+        std::cerr << "tier: " << describe(decl, params) << " -> " << typeName(returnType) << " now runs natively"
+                  << std::endl;
+    }
+}
+
+} // namespace pulse::compiler
@@ -0,0 +1,590 @@
+#include "compiler/type_inference.hpp"
+#include <stdexcept>
+
+namespace pulse::compiler {
+
+namespace {
+
+bool isNumeric(ValueType type) {
+    return type == ValueType::BOOL || type == ValueType::INT || type == ValueType::FLOAT;
+}
+
+// A numeric literal other than zero, also through a unary minus
+bool isNonZeroNumber(pulse::parser::Expression* expr) {
+    if (auto unary = pulse::parser::dyn_cast<pulse::parser::UnaryExpression>(expr)) {
+        return unary->op == pulse::parser::UnaryExpression::Operator::MINUS && isNonZeroNumber(unary->operand.get());
+    }
+    auto literal = pulse::parser::dyn_cast<pulse::parser::LiteralExpression>(expr);
+    if (!literal) return false;
+    if (auto value = std::get_if<int64_t>(&literal->value)) return *value != 0;
+    if (auto value = std::get_if<double>(&literal->value)) return *value != 0.0;
+    return false;
+}
+
+// A divisor that can neither raise ZeroDivisionError in the VM nor trap in
+// native code (INT64_MIN // -1): a positive literal
+bool isSafeDivisor(pulse::parser::Expression* expr) {
+    auto literal = pulse::parser::dyn_cast<pulse::parser::LiteralExpression>(expr);
+    if (!literal) return false;
+    if (auto value = std::get_if<int64_t>(&literal->value)) return *value > 0;
+    if (auto value = std::get_if<double>(&literal->value)) return *value > 0.0;
+    return false;
+}
+
+// Whether control never falls off the end of body
+bool alwaysReturns(const pulse::parser::ArenaVector<pulse::parser::StatementPtr>& body) {
+    for (const auto& stmt : body) {
+        if (pulse::parser::isa<pulse::parser::ReturnStatement>(stmt.get())) return true;
+        auto branch = pulse::parser::dyn_cast<pulse::parser::IfStatement>(stmt.get());
+        if (branch && !branch->else_body.empty() && alwaysReturns(branch->else_body)) {
+            bool every = true;
+            for (const auto& arm : branch->branches) {
+                every = every && alwaysReturns(arm.body);
+            }
+            if (every) return true;
+        }
+    }
+    return false;
+}
+
+char mangleCode(ValueType type) {
+    switch (type) {
+        case ValueType::UNKNOWN: return 'u';
+        case ValueType::BOOL: return 'b';
+        case ValueType::INT: return 'i';
+        case ValueType::FLOAT: return 'f';
+        case ValueType::STR: return 's';
+        case ValueType::DYNAMIC: return 'd';
+    }
+    return 'd';
+}
+
+} // namespace
+
+const char* typeName(ValueType type) {
+    switch (type) {
+        case ValueType::UNKNOWN: return "unknown";
+        case ValueType::BOOL: return "bool";
+        case ValueType::INT: return "int";
+        case ValueType::FLOAT: return "float";
+        case ValueType::STR: return "str";
+        case ValueType::DYNAMIC: return "dynamic";
+    }
+    return "dynamic";
+}
+
+ValueType join(ValueType a, ValueType b) {
+    if (a == b || b == ValueType::UNKNOWN) return a;
+    if (a == ValueType::UNKNOWN) return b;
+    if (isNumeric(a) && isNumeric(b)) {
+        return a > b ? a : b;
+    }
+    return ValueType::DYNAMIC;
+}
+
+TypeInference::TypeInference(pulse::parser::Program* program, std::map<std::string, ValueType, std::less<>> constants)
+    : importedConstants(std::move(constants)) {
+    for (const auto& decl : program->declarations) {
+        if (auto function = pulse::parser::dyn_cast<pulse::parser::FunctionDeclaration>(decl.get())) {
+            if (!declarations.emplace(function->name, function).second) {
+                throw std::runtime_error("Function '" + std::string(function->name) + "' is already defined");
+            }
+        }
+    }
+
+    entryInstance = std::make_unique<FunctionInstance>();
+    entryInstance->body = &program->statements;
+    worklist.push_back(entryInstance.get());
+    solve();
+}
+
+pulse::parser::FunctionDeclaration* TypeInference::findFunction(std::string_view name) const {
+    auto it = declarations.find(name);
+    return it != declarations.end() ? it->second : nullptr;
+}
+
+const FunctionInstance& TypeInference::instantiate(pulse::parser::FunctionDeclaration* decl, const Signature& params) {
+    if (params.size() != decl->parameters.size()) {
+        throw std::runtime_error("Function '" + std::string(decl->name) + "' expects " +
+                                 std::to_string(decl->parameters.size()) + " arguments");
+    }
+
+    FunctionInstance& instance = getOrCreate(decl, params);
+    solve();
+    return instance;
+}
+
+bool TypeInference::isBuiltin(std::string_view name) {
+    return name == "out" || name == "print" || name == "int" || name == "float" || name == "bool" ||
+           isNumericBuiltin(name);
+}
+
+bool TypeInference::isNumericBuiltin(std::string_view name) {
+    return name == "min" || name == "max" || name == "abs";
+}
+
+ValueType TypeInference::numericBuiltinType(std::string_view name, const Signature& arguments) {
+    if (name == "abs") {
+        if (arguments.size() != 1) return ValueType::DYNAMIC;
+        if (arguments[0] == ValueType::UNKNOWN || arguments[0] == ValueType::FLOAT) return arguments[0];
+        return arguments[0] == ValueType::INT || arguments[0] == ValueType::BOOL ? ValueType::INT : ValueType::DYNAMIC;
+    }
+    // min() and max() return one of their arguments unchanged, so native
+    // code only has them for arguments of one type: all ints or all floats
+    if (arguments.size() < 2) return ValueType::DYNAMIC;
+    ValueType type = ValueType::UNKNOWN;
+    for (ValueType argument : arguments) {
+        if (argument == ValueType::UNKNOWN) continue;
+        if (type != ValueType::UNKNOWN && argument != type) return ValueType::DYNAMIC;
+        type = argument;
+    }
+    return type == ValueType::UNKNOWN || type == ValueType::INT || type == ValueType::FLOAT ? type : ValueType::DYNAMIC;
+}
+
+bool TypeInference::matchesInterpreter(const FunctionInstance& instance, std::string& reason) {
+    ParityCheck check;
+    bool matches = checkInstance(instance, check);
+    reason = std::move(check.reason);
+    return matches;
+}
+
+bool TypeInference::checkInstance(const FunctionInstance& instance, ParityCheck& check) {
+    // Recursion: the instance is assumed to pass while it is being checked
+    if (!check.visited.insert(&instance).second) return true;
+
+    std::string name(instance.decl ? instance.decl->name : "<module>");
+    if (!isNumeric(instance.returnType)) {
+        check.reason = name + " returns " + (instance.returnType == ValueType::UNKNOWN ? "nothing" : "a non-number");
+        return false;
+    }
+    for (const auto& [local, type] : instance.locals) {
+        if (!isNumeric(type)) {
+            check.reason.assign(1, '\'').append(local).append("' in ").append(name).append(" is not always a number");
+            return false;
+        }
+    }
+    // Falling off the end returns None in the VM but a zero in native code
+    if (!alwaysReturns(*instance.body)) {
+        check.reason = name + " may end without returning a value";
+        return false;
+    }
+
+    FunctionInstance* saved = current;
+    current = const_cast<FunctionInstance*>(&instance);
+    bool matches = checkBlock(*instance.body, check);
+    current = saved;
+    return matches;
+}
+
+bool TypeInference::checkBlock(const pulse::parser::ArenaVector<pulse::parser::StatementPtr>& body,
+                               ParityCheck& check) {
+    for (const auto& stmt : body) {
+        if (stmt && !checkStatement(stmt.get(), check)) return false;
+    }
+    return true;
+}
+
+bool TypeInference::checkStatement(pulse::parser::Statement* stmt, ParityCheck& check) {
+    using namespace pulse::parser;
+
+    switch (stmt->getKind()) {
+        case NodeKind::ASSIGNMENT: {
+            // A slot wider than the value would turn e.g. an int into a float
+            auto assignment = static_cast<AssignmentStatement*>(stmt);
+            if (infer(assignment->value.get()) != current->locals.at(assignment->name)) {
+                check.reason = "'" + std::string(assignment->name) + "' is assigned values of different types";
+                return false;
+            }
+            return checkExpression(assignment->value.get(), check);
+        }
+        case NodeKind::EXPRESSION_STATEMENT:
+            return checkExpression(static_cast<ExpressionStatement*>(stmt)->expression.get(), check);
+        case NodeKind::RETURN: {
+            auto ret = static_cast<ReturnStatement*>(stmt);
+            if (!ret->value || infer(ret->value.get()) != current->returnType) {
+                check.reason = "returns values of different types";
+                return false;
+            }
+            return checkExpression(ret->value.get(), check);
+        }
+        case NodeKind::IF: {
+            auto branch = static_cast<IfStatement*>(stmt);
+            for (const auto& arm : branch->branches) {
+                if (!checkExpression(arm.condition.get(), check, true) || !checkBlock(arm.body, check)) return false;
+            }
+            return checkBlock(branch->else_body, check);
+        }
+        case NodeKind::WHILE: {
+            auto loop = static_cast<WhileStatement*>(stmt);
+            return checkExpression(loop->condition.get(), check, true) && checkBlock(loop->body, check);
+        }
+        case NodeKind::FOR: {
+            auto loop = static_cast<ForStatement*>(stmt);
+            if (!isRangeCall(loop->iterable.get())) {
+                check.reason = "loops over a container";
+                return false;
+            }
+            // The VM raises for float bounds and a zero step
+            const auto& args = static_cast<CallExpression*>(loop->iterable.get())->arguments;
+            if (args.empty() || args.size() > 3 || (args.size() == 3 && !isNonZeroNumber(args[2].get()))) {
+                check.reason = "range() needs a constant step";
+                return false;
+            }
+            for (const auto& arg : args) {
+                ValueType type = infer(arg.get());
+                if ((type != ValueType::INT && type != ValueType::BOOL) || !checkExpression(arg.get(), check)) {
+                    if (check.reason.empty()) check.reason = "range() bounds must be ints";
+                    return false;
+                }
+            }
+            return checkBlock(loop->body, check);
+        }
+        default:
+            check.reason = "statement kind has no native equivalent";
+            return false;
+    }
+}
+
+bool TypeInference::checkExpression(pulse::parser::Expression* expr, ParityCheck& check, bool condition) {
+    using namespace pulse::parser;
+    using Op = BinaryExpression::Operator;
+
+    switch (expr->getKind()) {
+        case NodeKind::LITERAL: {
+            const auto& value = static_cast<LiteralExpression*>(expr)->value;
+            if (std::holds_alternative<std::string_view>(value) || std::holds_alternative<std::monostate>(value)) {
+                check.reason = "uses a string or None";
+                return false;
+            }
+            return true;
+        }
+        case NodeKind::IDENTIFIER:
+            // Native code reads globals as 0
+            if (!current->locals.count(static_cast<IdentifierExpression*>(expr)->name)) {
+                check.reason = "reads global '" + std::string(static_cast<IdentifierExpression*>(expr)->name) + "'";
+                return false;
+            }
+            return true;
+        case NodeKind::UNARY:
+            return checkExpression(static_cast<UnaryExpression*>(expr)->operand.get(), check, condition);
+        case NodeKind::BINARY: {
+            auto binary = static_cast<BinaryExpression*>(expr);
+            switch (binary->op) {
+                case Op::AND:
+                case Op::OR:
+                    // The VM yields an operand, native code a bool
+                    if (!condition) {
+                        check.reason = "uses the value of 'and'/'or'";
+                        return false;
+                    }
+                    return checkExpression(binary->left.get(), check, true) &&
+                           checkExpression(binary->right.get(), check, true);
+                case Op::DIVIDE:
+                case Op::FLOOR_DIVIDE:
+                case Op::MODULO:
+                    if (!isSafeDivisor(binary->right.get())) {
+                        check.reason = "divides by a value that may be zero";
+                        return false;
+                    }
+                    break;
+                case Op::POWER:
+                    check.reason = "uses '**'";
+                    return false;
+                default:
+                    break;
+            }
+            if (!isNumeric(infer(binary->left.get())) || !isNumeric(infer(binary->right.get()))) {
+                check.reason = "operates on a non-number";
+                return false;
+            }
+            return checkExpression(binary->left.get(), check) && checkExpression(binary->right.get(), check);
+        }
+        case NodeKind::CALL: {
+            auto call = static_cast<CallExpression*>(expr);
+            auto callee = dyn_cast<IdentifierExpression>(call->callee.get());
+            if (!callee) {
+                check.reason = "makes an indirect call";
+                return false;
+            }
+            Signature arguments;
+            for (const auto& argument : call->arguments) {
+                if (!checkExpression(argument.get(), check)) return false;
+                arguments.push_back(infer(argument.get()));
+            }
+            if (auto decl = findFunction(callee->name)) {
+                if (decl->parameters.size() != arguments.size()) {
+                    check.reason = "calls " + std::string(callee->name) + " with the wrong number of arguments";
+                    return false;
+                }
+                // Solving a new instance moves the analysis cursor
+                FunctionInstance* saved = current;
+                const FunctionInstance& instance = instantiate(decl, arguments);
+                current = saved;
+                return checkInstance(instance, check);
+            }
+            if ((callee->name == "int" || callee->name == "float" || callee->name == "bool") && arguments.size() == 1) {
+                return true;
+            }
+            if (isNumericBuiltin(callee->name) && isNumeric(numericBuiltinType(callee->name, arguments))) {
+                return true;
+            }
+            check.reason = "calls " + std::string(callee->name) + "()";
+            return false;
+        }
+        default:
+            check.reason = "expression kind has no native equivalent";
+            return false;
+    }
+}
+
+FunctionInstance& TypeInference::getOrCreate(pulse::parser::FunctionDeclaration* decl, const Signature& params) {
+    // Coroutines suspend with their frame on the VM; native code has no frames to save
+    if (decl->is_async) {
+        throw std::runtime_error("async function '" + std::string(decl->name) +
+                                 "' is not supported by native code generation; run it with pulse run --interpret");
+    }
+    auto& slot = instances[InstanceKey(decl, params)];
+    if (!slot) {
+        slot = std::make_unique<FunctionInstance>();
+        slot->decl = decl;
+        slot->params = params;
+        slot->body = &decl->body;
+        slot->symbol = std::string(decl->name) + '.';
+        for (ValueType type : params) {
+            slot->symbol += mangleCode(type);
+        }
+        if (params.empty()) {
+            slot->symbol += 'v';
+        }
+
+        // The sweep in progress has to run again to analyze the new body
+        worklist.push_back(slot.get());
+        changed = true;
+    }
+    return *slot;
+}
+
+// Types only widen and the lattice is four levels deep, so re-running every
+// instance until a sweep changes nothing terminates quickly
+void TypeInference::solve() {
+    if (solving) return;
+    solving = true;
+
+    do {
+        changed = false;
+        for (size_t i = 0; i < worklist.size(); i++) {
+            analyze(*worklist[i]);
+        }
+    } while (changed);
+
+    solving = false;
+}
+
+void TypeInference::analyze(FunctionInstance& instance) {
+    current = &instance;
+    if (instance.decl) {
+        for (size_t i = 0; i < instance.params.size(); i++) {
+            assign(instance.decl->parameters[i], instance.params[i]);
+        }
+    }
+    analyzeBlock(*instance.body);
+    current = nullptr;
+}
+
+void TypeInference::analyzeBlock(const pulse::parser::ArenaVector<pulse::parser::StatementPtr>& body) {
+    for (const auto& stmt : body) {
+        if (stmt) visit(stmt.get());
+    }
+}
+
+ValueType TypeInference::infer(pulse::parser::Expression* expr) {
+    if (!expr) return ValueType::INT;
+
+    switch (expr->getKind()) {
+        case pulse::parser::NodeKind::LITERAL:
+        case pulse::parser::NodeKind::IDENTIFIER:
+        case pulse::parser::NodeKind::BINARY:
+        case pulse::parser::NodeKind::UNARY:
+        case pulse::parser::NodeKind::CALL:
+            return visit(expr);
+        default:
+            // Containers, attributes and subscripts have no native lowering yet
+            return ValueType::DYNAMIC;
+    }
+}
+
+void TypeInference::assign(std::string_view name, ValueType type) {
+    auto [it, inserted] = current->locals.try_emplace(name, type);
+    if (inserted) {
+        changed |= type != ValueType::UNKNOWN;
+        return;
+    }
+
+    ValueType widened = join(it->second, type);
+    if (widened != it->second) {
+        it->second = widened;
+        changed = true;
+    }
+}
+
+bool TypeInference::isRangeCall(pulse::parser::Expression* expr) const {
+    auto call = pulse::parser::dyn_cast<pulse::parser::CallExpression>(expr);
+    if (!call) return false;
+    auto callee = pulse::parser::dyn_cast<pulse::parser::IdentifierExpression>(call->callee.get());
+    return callee && callee->name == "range" && !findFunction(callee->name);
+}
+
+ValueType TypeInference::visitLiteralExpression(pulse::parser::LiteralExpression* expr) {
+    if (std::holds_alternative<double>(expr->value)) return ValueType::FLOAT;
+    if (std::holds_alternative<bool>(expr->value)) return ValueType::BOOL;
+    if (std::holds_alternative<std::string_view>(expr->value)) return ValueType::STR;
+    return ValueType::INT; // integers, and None which lowers to 0
+}
+
+ValueType TypeInference::visitIdentifierExpression(pulse::parser::IdentifierExpression* expr) {
+    // Names not assigned (yet) stay open; the compiler reads undefined ones as 0
+    auto it = current->locals.find(expr->name);
+    if (it != current->locals.end()) return it->second;
+    auto constant = importedConstants.find(expr->name);
+    return constant != importedConstants.end() ? constant->second : ValueType::UNKNOWN;
+}
+
+ValueType TypeInference::visitBinaryExpression(pulse::parser::BinaryExpression* expr) {
+    using Op = pulse::parser::BinaryExpression::Operator;
+
+    ValueType left = infer(expr->left.get());
+    ValueType right = infer(expr->right.get());
+
+    switch (expr->op) {
+        case Op::AND:
+        case Op::OR:
+        case Op::EQUAL:
+        case Op::NOT_EQUAL:
+        case Op::LESS:
+        case Op::LESS_EQUAL:
+        case Op::GREATER:
+        case Op::GREATER_EQUAL:
+            return ValueType::BOOL;
+        default:
+            break;
+    }
+
+    ValueType operands = join(left, right);
+    if (operands == ValueType::STR || operands == ValueType::DYNAMIC) {
+        return ValueType::DYNAMIC;
+    }
+    if (expr->op == Op::DIVIDE) {
+        return ValueType::FLOAT;
+    }
+    if (operands == ValueType::UNKNOWN) {
+        return ValueType::UNKNOWN;
+    }
+    // Bools do arithmetic as ints; int ** int stays an int
+    return operands == ValueType::FLOAT ? ValueType::FLOAT : ValueType::INT;
+}
+
+ValueType TypeInference::visitUnaryExpression(pulse::parser::UnaryExpression* expr) {
+    if (expr->op == pulse::parser::UnaryExpression::Operator::AWAIT) {
+        throw std::runtime_error("'await' outside async function");
+    }
+    ValueType operand = infer(expr->operand.get());
+
+    if (expr->op == pulse::parser::UnaryExpression::Operator::NOT) {
+        return ValueType::BOOL;
+    }
+    switch (operand) {
+        case ValueType::UNKNOWN:
+        case ValueType::FLOAT:
+            return operand;
+        case ValueType::BOOL:
+        case ValueType::INT:
+            return ValueType::INT;
+        default:
+            return ValueType::DYNAMIC;
+    }
+}
+
+ValueType TypeInference::visitCallExpression(pulse::parser::CallExpression* expr) {
+    Signature arguments;
+    arguments.reserve(expr->arguments.size());
+    for (const auto& argument : expr->arguments) {
+        arguments.push_back(infer(argument.get()));
+    }
+
+    auto callee = pulse::parser::dyn_cast<pulse::parser::IdentifierExpression>(expr->callee.get());
+    if (!callee) {
+        return ValueType::DYNAMIC;
+    }
+
+    if (auto decl = findFunction(callee->name)) {
+        if (decl->parameters.size() != arguments.size()) {
+            return ValueType::DYNAMIC; // reported by the compiler
+        }
+        return getOrCreate(decl, arguments).returnType;
+    }
+
+    if (callee->name == "float") return ValueType::FLOAT;
+    if (callee->name == "bool") return ValueType::BOOL;
+    if (callee->name == "range") return ValueType::DYNAMIC;
+    if (isNumericBuiltin(callee->name)) return numericBuiltinType(callee->name, arguments);
+
+    // int(), out()/print() (which return 0), and external functions
+    return ValueType::INT;
+}
+
+ValueType TypeInference::visitAssignmentStatement(pulse::parser::AssignmentStatement* stmt) {
+    assign(stmt->name, infer(stmt->value.get()));
+    return ValueType::UNKNOWN;
+}
+
+ValueType TypeInference::visitExpressionStatement(pulse::parser::ExpressionStatement* stmt) {
+    infer(stmt->expression.get());
+    return ValueType::UNKNOWN;
+}
+
+ValueType TypeInference::visitReturnStatement(pulse::parser::ReturnStatement* stmt) {
+    // A bare return (or falling off the end) yields the zero of whatever the
+    // function returns elsewhere, so only returned values take part
+    if (stmt->value) {
+        ValueType type = infer(stmt->value.get());
+        ValueType widened = join(current->returnType, type);
+        if (widened != current->returnType) {
+            current->returnType = widened;
+            changed = true;
+        }
+    }
+    return ValueType::UNKNOWN;
+}
+
+ValueType TypeInference::visitIfStatement(pulse::parser::IfStatement* stmt) {
+    for (const auto& branch : stmt->branches) {
+        infer(branch.condition.get());
+        analyzeBlock(branch.body);
+    }
+    analyzeBlock(stmt->else_body);
+    return ValueType::UNKNOWN;
+}
+
+ValueType TypeInference::visitWhileStatement(pulse::parser::WhileStatement* stmt) {
+    infer(stmt->condition.get());
+    analyzeBlock(stmt->body);
+    return ValueType::UNKNOWN;
+}
+
+ValueType TypeInference::visitForStatement(pulse::parser::ForStatement* stmt) {
+    bool range = isRangeCall(stmt->iterable.get());
+    infer(stmt->iterable.get());
+    assign(stmt->variable, range ? ValueType::INT : ValueType::DYNAMIC);
+    analyzeBlock(stmt->body);
+    return ValueType::UNKNOWN;
+}
+
+ValueType TypeInference::visitMatchStatement(pulse::parser::MatchStatement* stmt) {
+    infer(stmt->value.get());
+    for (const auto& match : stmt->cases) {
+        analyzeBlock(match.second);
+    }
+    return ValueType::UNKNOWN;
+}
+
+} // namespace pulse::compiler
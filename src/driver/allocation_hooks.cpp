@@ -0,0 +1,52 @@
+#include "driver/time_report.hpp"
+#include <cstdlib>
+#include <new>
+
+// Linked into the pulse driver only, so that --time-report can count the
+// allocations of each phase; the libraries, and the other tools and
+// benchmarks built on them, keep the standard allocator. Nothrow and sized
+// forms forward to these in the standard library.
+
+namespace {
+
+void* allocate(std::size_t size) {
+    void* block;
+    while (!(block = std::malloc(size ? size : 1))) {
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+    pulse::driver::countAllocation(block, size);
+    return block;
+}
+
+void release(void* block) noexcept {
+    pulse::driver::countRelease(block);
+    std::free(block);
+}
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return allocate(size);
+}
+
+void operator delete(void* block) noexcept {
+    release(block);
+}
+
+void operator delete[](void* block) noexcept {
+    release(block);
+}
+
+void operator delete(void* block, std::size_t) noexcept {
+    release(block);
+}
+
+void operator delete[](void* block, std::size_t) noexcept {
+    release(block);
+}
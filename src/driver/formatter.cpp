@@ -0,0 +1,231 @@
+#include "driver/formatter.hpp"
+#include "lexer/tokenizer.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace pulse::driver {
+
+using lexer::Token;
+using lexer::TokenType;
+
+namespace {
+
+bool synthetic(TokenType type) {
+    return type == TokenType::INDENT || type == TokenType::DEDENT || type == TokenType::NEWLINE ||
+           type == TokenType::EOF_TOKEN;
+}
+
+// A token a value ends with; an operator after any other is unary
+bool endsValue(TokenType type) {
+    switch (type) {
+        case TokenType::IDENTIFIER:
+        case TokenType::STRING:
+        case TokenType::INTEGER:
+        case TokenType::FLOAT:
+        case TokenType::BOOLEAN:
+        case TokenType::NONE:
+        case TokenType::RPAREN:
+        case TokenType::RBRACKET:
+        case TokenType::RBRACE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool opens(TokenType type) {
+    return type == TokenType::LPAREN || type == TokenType::LBRACKET || type == TokenType::LBRACE;
+}
+
+bool closes(TokenType type) {
+    return type == TokenType::RPAREN || type == TokenType::RBRACKET || type == TokenType::RBRACE;
+}
+
+} // namespace
+
+std::string TokenFormatter::format(const lexer::SourceBufferPtr& source, const LineRanges* ranges) {
+    text = source->text();
+    lexer::Tokenizer tokenizer(source);
+    lexer::TokenStream stream = tokenizer.tokenize();
+    tokens = &stream;
+    newline = text.find("\r\n") != std::string_view::npos ? "\r\n" : "\n";
+    lineStarts.clear();
+    lineStarts.push_back(0);
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '\n') lineStarts.push_back(static_cast<uint32_t>(i + 1));
+    }
+
+    std::vector<LogicalLine> lines = logicalLines(stream);
+    std::string out;
+    out.reserve(text.size() + text.size() / 8 + 16);
+
+    size_t range = 0;
+    size_t copied = 0;       // source bytes up to here are accounted for
+    uint32_t previousEnd = 0; // last physical line of the previous logical line
+    for (const LogicalLine& line : lines) {
+        const Token& first = stream[line.first];
+        const Token& last = stream[line.last];
+        uint32_t startLine = lineOf(first.offset);
+        uint32_t endLine = lineOf(last.offset + (last.length > 0 ? last.length - 1 : 0));
+        size_t begin = lineStarts[startLine - 1];
+        size_t end = endLine < lineStarts.size() ? lineStarts[endLine] : text.size();
+
+        bool touched = !ranges;
+        if (ranges) {
+            while (range < ranges->size() && (*ranges)[range].second < startLine) range++;
+            touched = range < ranges->size() && (*ranges)[range].first <= endLine;
+        }
+
+        if (ranges) {
+            out.append(text.substr(copied, begin - copied));
+        } else if (previousEnd > 0) {
+            uint32_t blank = std::min<uint32_t>(startLine - previousEnd - 1, 2);
+            for (uint32_t i = 0; i < blank; i++) out += newline;
+        }
+
+        if (touched) {
+            std::string_view indent = ranges ? text.substr(begin, first.offset - begin) : std::string_view();
+            emit(out, line, ranges ? indent.size() : line.depth * INDENT, ranges != nullptr);
+        } else {
+            out.append(text.substr(begin, end - begin));
+        }
+        copied = end;
+        previousEnd = endLine;
+    }
+    if (ranges) {
+        out.append(text.substr(copied));
+    }
+
+    verify(stream, out);
+    tokens = nullptr;
+    return out;
+}
+
+uint32_t TokenFormatter::lineOf(size_t offset) const {
+    return static_cast<uint32_t>(std::upper_bound(lineStarts.begin(), lineStarts.end(), offset) -
+                                 lineStarts.begin());
+}
+
+// A comment on a line of its own is a line too, indented like the code
+// that follows it
+std::vector<TokenFormatter::LogicalLine> TokenFormatter::logicalLines(const lexer::TokenStream& stream) const {
+    std::vector<LogicalLine> lines;
+    size_t depth = 0;
+    size_t waiting = 0; // comment lines at the end of lines, still without a depth
+    for (size_t i = 0; i < stream.size(); i++) {
+        TokenType type = stream[i].type;
+        if (type == TokenType::INDENT) {
+            depth++;
+        } else if (type == TokenType::DEDENT) {
+            depth = depth > 0 ? depth - 1 : 0;
+        }
+        if (synthetic(type)) continue;
+
+        size_t last = i;
+        while (last + 1 < stream.size() && !synthetic(stream[last + 1].type)) last++;
+        bool comment = last == i && type == TokenType::COMMENT;
+        lines.push_back({i, last, depth});
+        if (comment) {
+            waiting++;
+        } else {
+            for (size_t j = lines.size() - 1 - waiting; j < lines.size(); j++) lines[j].depth = depth;
+            waiting = 0;
+        }
+        i = last;
+    }
+    for (size_t j = lines.size() - waiting; j < lines.size(); j++) lines[j].depth = 0;
+    return lines;
+}
+
+// Whether tokens separated by no line break get a space between them
+bool TokenFormatter::spaced(const Token& previous, bool previousUnary, const Token& next) const {
+    TokenType before = previous.type;
+    TokenType after = next.type;
+    if (opens(before) || closes(after)) return false;
+    if (after == TokenType::COMMA) return false;
+    if (before == TokenType::COMMA) return true;
+    if (before == TokenType::DOT || after == TokenType::DOT) return false;
+    if (after == TokenType::COLON) return false;
+    // Slices: a[1:n]
+    if (before == TokenType::COLON) return brackets.empty() || brackets.back() != TokenType::LBRACKET;
+    if (previousUnary) return false;
+    // Calls and subscripts
+    if (after == TokenType::LPAREN || after == TokenType::LBRACKET) return !endsValue(before);
+    return true;
+}
+
+void TokenFormatter::emit(std::string& out, const LogicalLine& line, size_t indent, bool keepBreaks) {
+    const lexer::TokenStream& stream = *tokens;
+    out.append(indent, ' ');
+    const Token& first = stream[line.first];
+    size_t base = first.offset - lineStarts[lineOf(first.offset) - 1];
+    brackets.clear();
+
+    bool previousUnary = false;
+    for (size_t i = line.first; i <= line.last; i++) {
+        const Token& token = stream[i];
+        if (i > line.first) {
+            const Token& previous = stream[i - 1];
+            std::string_view gap = text.substr(previous.offset + previous.length,
+                                               token.offset - previous.offset - previous.length);
+            size_t lineStart = lineStarts[lineOf(token.offset) - 1];
+            if (gap.find('\n') != std::string_view::npos) {
+                // A break inside brackets: keep it, and the alignment relative to the line
+                out += newline;
+                if (keepBreaks) {
+                    out.append(text.substr(lineStart, token.offset - lineStart));
+                } else {
+                    size_t column = token.offset - lineStart;
+                    out.append(indent + (column > base ? column - base : INDENT), ' ');
+                }
+            } else if (token.type == TokenType::COMMENT) {
+                out += "  ";
+            } else if (spaced(previous, previousUnary, token)) {
+                out += ' ';
+            }
+            previousUnary = (token.type == TokenType::MINUS || token.type == TokenType::PLUS ||
+                             token.type == TokenType::MULTIPLY) &&
+                            !endsValue(previous.type);
+        } else {
+            previousUnary = token.type == TokenType::MINUS || token.type == TokenType::PLUS ||
+                            token.type == TokenType::MULTIPLY;
+        }
+
+        std::string_view lexeme = stream.lexeme(token);
+        if (token.type == TokenType::COMMENT) {
+            size_t end = lexeme.find_last_not_of(" \t\r");
+            lexeme = lexeme.substr(0, end == std::string_view::npos ? 0 : end + 1);
+        }
+        out.append(lexeme);
+
+        if (opens(token.type)) {
+            brackets.push_back(token.type);
+        } else if (closes(token.type) && !brackets.empty()) {
+            brackets.pop_back();
+        }
+    }
+    out += newline;
+}
+
+// The same tokens, in the same blocks. NEWLINEs are left out: removed
+// blank lines drop some, and INDENT and DEDENT already mark the lines
+// that matter.
+void TokenFormatter::verify(const lexer::TokenStream& before, const std::string& formatted) const {
+    lexer::Tokenizer tokenizer(formatted);
+    lexer::TokenStream after = tokenizer.tokenize();
+    auto strip = [](std::string_view lexeme) { return lexeme.substr(0, lexeme.find_last_not_of(" \t\r") + 1); };
+    size_t i = 0, j = 0;
+    while (true) {
+        while (i < before.size() && before[i].type == TokenType::NEWLINE) i++;
+        while (j < after.size() && after[j].type == TokenType::NEWLINE) j++;
+        if (i == before.size() || j == after.size()) break;
+        const Token& a = before[i++];
+        const Token& b = after[j++];
+        if (a.type != b.type || strip(before.lexeme(a)) != strip(after.lexeme(b))) break;
+    }
+    if (i != before.size() || j != after.size()) {
+        throw std::runtime_error("formatting would change the program's tokens; left as is");
+    }
+}
+
+} // namespace pulse::driver
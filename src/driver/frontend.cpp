@@ -0,0 +1,149 @@
+#include "driver/frontend.hpp"
+#include "driver/thread_pool.hpp"
+#include "driver/time_report.hpp"
+#include "lexer/source_buffer.hpp"
+#include "lexer/tokenizer.hpp"
+#include "parser/parser.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <set>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace pulse::driver {
+
+std::ostream& operator<<(std::ostream& out, const Diagnostic& diagnostic) {
+    out << diagnostic.file;
+    if (diagnostic.line > 0) {
+        out << ":" << diagnostic.line << ":" << diagnostic.column;
+    }
+    return out << ": error: " << diagnostic.message;
+}
+
+Diagnostic diagnose(const std::string& file, const std::exception& error) {
+    if (auto lexError = dynamic_cast<const lexer::LexError*>(&error)) {
+        return {file, lexError->line, lexError->column, lexError->message};
+    }
+    if (auto parseError = dynamic_cast<const parser::ParseError*>(&error)) {
+        return {file, parseError->line, parseError->column, parseError->message};
+    }
+    return {file, 0, 0, error.what()};
+}
+
+namespace {
+
+bool isSkippedDirectory(const fs::path& dir) {
+    std::string name = dir.filename().string();
+    return name == "build" || (!name.empty() && name[0] == '.');
+}
+
+void collectDirectory(const fs::path& dir, std::vector<std::string>& out) {
+    fs::path root = dir;
+    if (fs::exists(dir / "pulse.toml") && fs::is_directory(dir / "src")) {
+        root = dir / "src";
+    }
+
+    auto it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied);
+    for (auto end = fs::recursive_directory_iterator(); it != end; ++it) {
+        if (it->is_directory() && isSkippedDirectory(it->path())) {
+            it.disable_recursion_pending();
+            continue;
+        }
+        if (it->is_regular_file() && it->path().extension() == ".pul") {
+            out.push_back(it->path().lexically_normal().string());
+        }
+    }
+}
+
+void parseUnit(CompilationUnit& unit) {
+    try {
+        {
+            TimeReport::Scope phase("tokenize");
+            auto source = lexer::SourceBuffer::fromFile(unit.path);
+            lexer::Tokenizer tokenizer(source);
+            unit.tokens = tokenizer.tokenize();
+        }
+
+        TimeReport::Scope phase("parse");
+        parser::Parser parser(unit.tokens);
+        unit.program = parser.parseOrThrow();
+    } catch (const std::exception& e) {
+        unit.diagnostics.push_back(diagnose(unit.path, e));
+    }
+}
+
+} // namespace
+
+std::vector<std::string> collectSources(const std::vector<std::string>& inputs) {
+    std::vector<std::string> files;
+
+    for (const auto& input : inputs) {
+        if (input != "-" && fs::is_directory(input)) {
+            std::vector<std::string> found;
+            collectDirectory(input, found);
+            std::sort(found.begin(), found.end());
+            files.insert(files.end(), found.begin(), found.end());
+        } else {
+            files.push_back(input);
+        }
+    }
+
+    // Keep the first occurrence of each file so the order follows the command line
+    std::set<std::string> seen;
+    std::vector<std::string> unique;
+    for (auto& file : files) {
+        std::string key = file == "-" ? file : fs::path(file).lexically_normal().string();
+        if (seen.insert(key).second) {
+            unique.push_back(std::move(file));
+        }
+    }
+
+    return unique;
+}
+
+std::vector<CompilationUnit> parseFiles(const std::vector<std::string>& paths, size_t jobs) {
+    std::vector<CompilationUnit> units(paths.size());
+    for (size_t i = 0; i < paths.size(); i++) {
+        units[i].path = paths[i];
+    }
+
+    if (jobs == 0) {
+        jobs = ThreadPool::defaultThreadCount();
+    }
+    jobs = std::min(jobs, paths.size());
+
+    // A single file (or -j1) is not worth the thread start-up
+    if (jobs <= 1) {
+        for (auto& unit : units) {
+            parseUnit(unit);
+        }
+        return units;
+    }
+
+    // Each task writes only its own slot, so no locking is needed on the results
+    ThreadPool pool(jobs);
+    for (auto& unit : units) {
+        pool.submit([&unit] { parseUnit(unit); });
+    }
+    pool.wait();
+
+    return units;
+}
+
+std::vector<Diagnostic> collectDiagnostics(const std::vector<CompilationUnit>& units) {
+    std::vector<Diagnostic> diagnostics;
+
+    for (const auto& unit : units) {
+        size_t first = diagnostics.size();
+        diagnostics.insert(diagnostics.end(), unit.diagnostics.begin(), unit.diagnostics.end());
+        std::stable_sort(diagnostics.begin() + first, diagnostics.end(),
+                         [](const Diagnostic& a, const Diagnostic& b) {
+                             return a.line != b.line ? a.line < b.line : a.column < b.column;
+                         });
+    }
+
+    return diagnostics;
+}
+
+} // namespace pulse::driver
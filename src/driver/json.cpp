@@ -0,0 +1,301 @@
+#include "driver/json.hpp"
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace pulse::driver {
+
+namespace {
+
+const Json NULL_JSON;
+const std::string EMPTY_STRING;
+
+class JsonParser {
+public:
+    explicit JsonParser(std::string_view text) : text(text) {}
+
+    Json document() {
+        Json value = parseValue(0);
+        skipSpace();
+        if (position != text.size()) fail("trailing characters");
+        return value;
+    }
+
+private:
+    static constexpr int MAX_DEPTH = 256;
+
+    std::string_view text;
+    size_t position = 0;
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::runtime_error("invalid JSON at offset " + std::to_string(position) + ": " + message);
+    }
+
+    void skipSpace() {
+        while (position < text.size() &&
+               (text[position] == ' ' || text[position] == '\t' || text[position] == '\n' || text[position] == '\r')) {
+            position++;
+        }
+    }
+
+    bool consume(std::string_view word) {
+        if (text.substr(position, word.size()) != word) return false;
+        position += word.size();
+        return true;
+    }
+
+    Json parseValue(int depth) {
+        if (depth > MAX_DEPTH) fail("nested too deeply");
+        skipSpace();
+        if (position >= text.size()) fail("unexpected end");
+        char c = text[position];
+        if (c == '{') return parseObject(depth);
+        if (c == '[') return parseArray(depth);
+        if (c == '"') return Json(parseString());
+        if (consume("true")) return Json(true);
+        if (consume("false")) return Json(false);
+        if (consume("null")) return Json();
+        if (c == '-' || (c >= '0' && c <= '9')) return parseNumber();
+        fail(std::string("unexpected '") + c + "'");
+    }
+
+    Json parseObject(int depth) {
+        position++; // {
+        Json::Object members;
+        skipSpace();
+        if (consume("}")) return Json(std::move(members));
+        while (true) {
+            skipSpace();
+            if (position >= text.size() || text[position] != '"') fail("expected a member name");
+            std::string key = parseString();
+            skipSpace();
+            if (!consume(":")) fail("expected ':'");
+            members.emplace_back(std::move(key), parseValue(depth + 1));
+            skipSpace();
+            if (consume("}")) return Json(std::move(members));
+            if (!consume(",")) fail("expected ',' or '}'");
+        }
+    }
+
+    Json parseArray(int depth) {
+        position++; // [
+        Json::Array elements;
+        skipSpace();
+        if (consume("]")) return Json(std::move(elements));
+        while (true) {
+            elements.push_back(parseValue(depth + 1));
+            skipSpace();
+            if (consume("]")) return Json(std::move(elements));
+            if (!consume(",")) fail("expected ',' or ']'");
+        }
+    }
+
+    Json parseNumber() {
+        size_t start = position;
+        if (text[position] == '-') position++;
+        while (position < text.size() && (std::isdigit(static_cast<unsigned char>(text[position])) ||
+                                          text[position] == '.' || text[position] == 'e' || text[position] == 'E' ||
+                                          text[position] == '+' || text[position] == '-')) {
+            position++;
+        }
+        std::string number(text.substr(start, position - start));
+        char* end = nullptr;
+        double value = std::strtod(number.c_str(), &end);
+        if (end != number.c_str() + number.size()) fail("malformed number");
+        return Json(value);
+    }
+
+    uint32_t hexQuad() {
+        if (position + 4 > text.size()) fail("truncated \\u escape");
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = text[position++];
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= static_cast<uint32_t>(c - '0');
+            else if (c >= 'a' && c <= 'f') value |= static_cast<uint32_t>(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') value |= static_cast<uint32_t>(c - 'A' + 10);
+            else fail("malformed \\u escape");
+        }
+        return value;
+    }
+
+    static void appendUtf8(std::string& out, uint32_t code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    std::string parseString() {
+        position++; // "
+        std::string out;
+        while (true) {
+            size_t run = position;
+            while (position < text.size() && text[position] != '"' && text[position] != '\\') position++;
+            out.append(text.substr(run, position - run));
+            if (position >= text.size()) fail("unterminated string");
+            if (text[position++] == '"') return out;
+
+            if (position >= text.size()) fail("unterminated string");
+            char escape = text[position++];
+            switch (escape) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    uint32_t code = hexQuad();
+                    // A surrogate pair is one code point
+                    if (code >= 0xD800 && code < 0xDC00 && consume("\\u")) {
+                        uint32_t low = hexQuad();
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(out, code);
+                    break;
+                }
+                default:
+                    fail("unknown escape");
+            }
+        }
+    }
+};
+
+void dumpString(std::string& out, const std::string& text) {
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escape[8];
+                    std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+                    out += escape;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+} // namespace
+
+Json Json::parse(std::string_view text) {
+    return JsonParser(text).document();
+}
+
+std::string Json::dump() const {
+    std::string out;
+    dump(out);
+    return out;
+}
+
+void Json::dump(std::string& out) const {
+    switch (type) {
+        case Type::NUL:
+            out += "null";
+            break;
+        case Type::BOOL:
+            out += boolean ? "true" : "false";
+            break;
+        case Type::NUMBER: {
+            // Integers (ids, positions) without a fraction
+            char text[32];
+            if (std::isfinite(number) && number == std::floor(number) && std::fabs(number) < 9.007199254740992e15) {
+                std::snprintf(text, sizeof(text), "%lld", static_cast<long long>(number));
+            } else if (std::isfinite(number)) {
+                std::snprintf(text, sizeof(text), "%.17g", number);
+            } else {
+                std::snprintf(text, sizeof(text), "null");
+            }
+            out += text;
+            break;
+        }
+        case Type::STRING:
+            dumpString(out, string);
+            break;
+        case Type::ARRAY:
+            out += '[';
+            for (size_t i = 0; i < array.size(); i++) {
+                if (i > 0) out += ',';
+                array[i].dump(out);
+            }
+            out += ']';
+            break;
+        case Type::OBJECT:
+            out += '{';
+            for (size_t i = 0; i < object.size(); i++) {
+                if (i > 0) out += ',';
+                dumpString(out, object[i].first);
+                out += ':';
+                object[i].second.dump(out);
+            }
+            out += '}';
+            break;
+    }
+}
+
+const std::string& Json::asString() const {
+    return type == Type::STRING ? string : EMPTY_STRING;
+}
+
+const Json& Json::operator[](std::string_view key) const {
+    if (type != Type::OBJECT) return NULL_JSON;
+    for (const auto& [name, value] : object) {
+        if (name == key) return value;
+    }
+    return NULL_JSON;
+}
+
+Json& Json::operator[](std::string_view key) {
+    if (type != Type::OBJECT) {
+        *this = Json(Object());
+    }
+    for (auto& [name, value] : object) {
+        if (name == key) return value;
+    }
+    object.emplace_back(std::string(key), Json());
+    return object.back().second;
+}
+
+const Json& Json::operator[](size_t index) const {
+    return type == Type::ARRAY && index < array.size() ? array[index] : NULL_JSON;
+}
+
+bool Json::contains(std::string_view key) const {
+    if (type != Type::OBJECT) return false;
+    for (const auto& member : object) {
+        if (member.first == key) return true;
+    }
+    return false;
+}
+
+void Json::push(Json value) {
+    if (type != Type::ARRAY) {
+        *this = Json(Array());
+    }
+    array.push_back(std::move(value));
+}
+
+} // namespace pulse::driver
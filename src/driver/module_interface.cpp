@@ -0,0 +1,580 @@
+#include "driver/module_interface.hpp"
+#include "lexer/tokenizer.hpp"
+#include "parser/parser.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace pulse::driver {
+
+namespace {
+
+// .pulc layout, little-endian throughout:
+//   header     magic "PULC", u32 version, u64 source hash, u32 module name,
+//              u32 counts of functions, classes, constants, methods and
+//              parameters, u32 size of the string table
+//   functions  u32 name, u32 first parameter, u32 parameter count
+//   classes    u32 name, u32 base, u32 first method, u32 method count
+//   constants  u32 name, u32 type, u64 value (int, bool, double bits, or
+//              the string of a STR)
+//   methods    as functions
+//   parameters u32 name
+//   strings    u32 length and the bytes of each string
+// Names are offsets into the string table. Each table is sorted by name.
+constexpr char MAGIC[4] = {'P', 'U', 'L', 'C'};
+constexpr uint32_t FORMAT_VERSION = 2;
+constexpr size_t HEADER_SIZE = 44;
+constexpr size_t FUNCTION_SIZE = 12;
+constexpr size_t CLASS_SIZE = 16;
+constexpr size_t CONSTANT_SIZE = 16;
+constexpr size_t PARAMETER_SIZE = 4;
+
+uint32_t get32(const char* at) {
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; i--) {
+        value = (value << 8) | static_cast<unsigned char>(at[i]);
+    }
+    return value;
+}
+
+uint64_t get64(const char* at) {
+    return get32(at) | (static_cast<uint64_t>(get32(at + 4)) << 32);
+}
+
+void put32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out += static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+void put64(std::string& out, uint64_t value) {
+    put32(out, static_cast<uint32_t>(value));
+    put32(out, static_cast<uint32_t>(value >> 32));
+}
+
+// String table under construction; equal strings are stored once
+class StringTable {
+public:
+    uint32_t add(std::string_view text) {
+        auto it = offsets.find(std::string(text));
+        if (it != offsets.end()) return it->second;
+        uint32_t offset = static_cast<uint32_t>(bytes.size());
+        put32(bytes, static_cast<uint32_t>(text.size()));
+        bytes.append(text);
+        offsets.emplace(std::string(text), offset);
+        return offset;
+    }
+
+    const std::string& data() const { return bytes; }
+
+private:
+    std::string bytes;
+    std::map<std::string, uint32_t> offsets;
+};
+
+ModuleInterface::Function exportFunction(const parser::FunctionDeclaration& decl) {
+    ModuleInterface::Function function;
+    function.name = std::string(decl.name);
+    for (auto parameter : decl.parameters) {
+        function.parameters.emplace_back(parameter);
+    }
+    return function;
+}
+
+// Every name a block binds, nested blocks included, with how often
+void countBindings(const parser::ArenaVector<parser::StatementPtr>& body, std::map<std::string_view, int>& counts) {
+    for (const auto& stmt : body) {
+        if (auto assign = parser::dyn_cast<parser::AssignmentStatement>(stmt.get())) {
+            counts[assign->name]++;
+        } else if (auto if_stmt = parser::dyn_cast<parser::IfStatement>(stmt.get())) {
+            for (const auto& branch : if_stmt->branches) {
+                countBindings(branch.body, counts);
+            }
+            countBindings(if_stmt->else_body, counts);
+        } else if (auto while_stmt = parser::dyn_cast<parser::WhileStatement>(stmt.get())) {
+            countBindings(while_stmt->body, counts);
+        } else if (auto for_stmt = parser::dyn_cast<parser::ForStatement>(stmt.get())) {
+            counts[for_stmt->variable]++;
+            countBindings(for_stmt->body, counts);
+        } else if (auto match = parser::dyn_cast<parser::MatchStatement>(stmt.get())) {
+            for (const auto& match_case : match->cases) {
+                countBindings(match_case.second, counts);
+            }
+        }
+    }
+}
+
+// A literal, or a negated numeric one
+bool constantValue(const parser::Expression* expr, ModuleInterface::Constant& constant) {
+    bool negate = false;
+    if (auto unary = parser::dyn_cast<parser::UnaryExpression>(expr)) {
+        if (unary->op != parser::UnaryExpression::Operator::MINUS) return false;
+        negate = true;
+        expr = unary->operand.get();
+    }
+    auto literal = parser::dyn_cast<parser::LiteralExpression>(expr);
+    if (!literal) return false;
+
+    if (auto value = std::get_if<int64_t>(&literal->value)) {
+        constant.type = ModuleInterface::ConstantType::INT;
+        constant.intValue = negate ? static_cast<int64_t>(0ull - static_cast<uint64_t>(*value)) : *value;
+    } else if (auto value = std::get_if<double>(&literal->value)) {
+        constant.type = ModuleInterface::ConstantType::FLOAT;
+        constant.floatValue = negate ? -*value : *value;
+    } else if (negate) {
+        return false;
+    } else if (auto value = std::get_if<bool>(&literal->value)) {
+        constant.type = ModuleInterface::ConstantType::BOOL;
+        constant.intValue = *value ? 1 : 0;
+    } else if (auto value = std::get_if<std::string_view>(&literal->value)) {
+        constant.type = ModuleInterface::ConstantType::STR;
+        constant.text = std::string(*value);
+    } else {
+        return false; // None
+    }
+    return true;
+}
+
+template <typename T>
+void sortByName(std::vector<T>& items) {
+    std::sort(items.begin(), items.end(), [](const T& a, const T& b) { return a.name < b.name; });
+}
+
+} // namespace
+
+ModuleInterface ModuleInterface::extract(const parser::Program& program, std::string module, uint64_t source_hash) {
+    ModuleInterface interface;
+    interface.module = std::move(module);
+    interface.sourceHash = source_hash;
+
+    for (const auto& decl : program.declarations) {
+        if (auto function = parser::dyn_cast<parser::FunctionDeclaration>(decl.get())) {
+            interface.functions.push_back(exportFunction(*function));
+        } else if (auto cls = parser::dyn_cast<parser::ClassDeclaration>(decl.get())) {
+            Class exported;
+            exported.name = std::string(cls->name);
+            exported.base = std::string(cls->base_class);
+            for (const auto& member : cls->members) {
+                if (auto method = parser::dyn_cast<parser::FunctionDeclaration>(member.get())) {
+                    exported.methods.push_back(exportFunction(*method));
+                }
+            }
+            sortByName(exported.methods);
+            interface.classes.push_back(std::move(exported));
+        }
+    }
+
+    std::map<std::string_view, int> bindings;
+    countBindings(program.statements, bindings);
+    for (const auto& stmt : program.statements) {
+        auto assign = parser::dyn_cast<parser::AssignmentStatement>(stmt.get());
+        if (!assign || bindings[assign->name] != 1) continue;
+        Constant constant;
+        constant.name = std::string(assign->name);
+        if (constantValue(assign->value.get(), constant)) {
+            interface.constants.push_back(std::move(constant));
+        }
+    }
+
+    sortByName(interface.functions);
+    sortByName(interface.classes);
+    sortByName(interface.constants);
+    return interface;
+}
+
+uint64_t hashInterfaceSource(std::string_view source) {
+    // FNV-1a, seeded with the format version so a new layout misses
+    uint64_t hash = 14695981039346656037ull ^ FORMAT_VERSION;
+    for (unsigned char c : source) {
+        hash = (hash ^ c) * 1099511628211ull;
+    }
+    return hash;
+}
+
+std::unique_ptr<InterfaceFile> InterfaceFile::open(const fs::path& path, uint64_t source_hash) {
+    std::error_code ec;
+    if (!fs::is_regular_file(path, ec)) return nullptr;
+    lexer::SourceBufferPtr bytes;
+    try {
+        bytes = lexer::SourceBuffer::fromFile(path.string());
+    } catch (const std::exception&) {
+        return nullptr;
+    }
+    std::unique_ptr<InterfaceFile> file(new InterfaceFile(std::move(bytes)));
+    if (!file->validate() || get64(file->data() + 8) != source_hash) return nullptr;
+    return file;
+}
+
+// Checks the header, the table sizes and every string reference once, so
+// that lookups need no bounds checks
+bool InterfaceFile::validate() {
+    size_t size = bytes->size();
+    const char* at = data();
+    if (size < HEADER_SIZE || std::memcmp(at, MAGIC, 4) != 0 || get32(at + 4) != FORMAT_VERSION) {
+        return false;
+    }
+    moduleName = get32(at + 16);
+    functions.count = get32(at + 20);
+    classes.count = get32(at + 24);
+    constants.count = get32(at + 28);
+    methods.count = get32(at + 32);
+    parameters.count = get32(at + 36);
+    stringBytes = get32(at + 40);
+
+    uint64_t offset = HEADER_SIZE;
+    for (auto [table, record_size] : {std::pair{&functions, FUNCTION_SIZE}, std::pair{&classes, CLASS_SIZE},
+                                      std::pair{&constants, CONSTANT_SIZE}, std::pair{&methods, FUNCTION_SIZE},
+                                      std::pair{&parameters, PARAMETER_SIZE}}) {
+        table->offset = static_cast<size_t>(offset);
+        offset += static_cast<uint64_t>(table->count) * record_size;
+    }
+    strings = static_cast<size_t>(offset);
+    if (offset + stringBytes != size || !validString(moduleName)) return false;
+
+    auto validFunctions = [&](uint32_t first, uint32_t count, const Table& table) {
+        if (static_cast<uint64_t>(first) + count > table.count) return false;
+        for (uint32_t i = 0; i < count; i++) {
+            const char* record = data() + table.offset + (first + i) * FUNCTION_SIZE;
+            if (!validString(get32(record))) return false;
+            if (static_cast<uint64_t>(get32(record + 4)) + get32(record + 8) > parameters.count) return false;
+        }
+        return true;
+    };
+    if (!validFunctions(0, functions.count, functions) || !validFunctions(0, methods.count, methods)) return false;
+    for (uint32_t i = 0; i < classes.count; i++) {
+        const char* record = data() + classes.offset + i * CLASS_SIZE;
+        if (!validString(get32(record)) || !validString(get32(record + 4))) return false;
+        if (static_cast<uint64_t>(get32(record + 8)) + get32(record + 12) > methods.count) return false;
+    }
+    for (uint32_t i = 0; i < constants.count; i++) {
+        const char* record = data() + constants.offset + i * CONSTANT_SIZE;
+        uint32_t type = get32(record + 4);
+        if (!validString(get32(record)) || type > static_cast<uint32_t>(ModuleInterface::ConstantType::STR)) {
+            return false;
+        }
+        if (type == static_cast<uint32_t>(ModuleInterface::ConstantType::STR) &&
+            (get64(record + 8) > UINT32_MAX || !validString(static_cast<uint32_t>(get64(record + 8))))) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < parameters.count; i++) {
+        if (!validString(get32(data() + parameters.offset + i * PARAMETER_SIZE))) return false;
+    }
+    return true;
+}
+
+bool InterfaceFile::validString(uint32_t offset) const {
+    return static_cast<uint64_t>(offset) + 4 <= stringBytes &&
+           static_cast<uint64_t>(offset) + 4 + get32(data() + strings + offset) <= stringBytes;
+}
+
+std::string_view InterfaceFile::string(uint32_t offset) const {
+    const char* at = data() + strings + offset;
+    return std::string_view(at + 4, get32(at));
+}
+
+const char* InterfaceFile::find(const Table& table, size_t record_size, std::string_view name) const {
+    uint32_t low = 0;
+    uint32_t high = table.count;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        const char* record = data() + table.offset + middle * record_size;
+        int order = string(get32(record)).compare(name);
+        if (order == 0) return record;
+        if (order < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return nullptr;
+}
+
+ModuleInterface::Function InterfaceFile::function(const char* record) const {
+    ModuleInterface::Function function;
+    function.name = std::string(string(get32(record)));
+    uint32_t first = get32(record + 4);
+    for (uint32_t i = 0; i < get32(record + 8); i++) {
+        function.parameters.emplace_back(string(get32(data() + parameters.offset + (first + i) * PARAMETER_SIZE)));
+    }
+    return function;
+}
+
+std::string_view InterfaceFile::module() const {
+    return string(moduleName);
+}
+
+int InterfaceFile::functionArity(std::string_view name) const {
+    const char* record = find(functions, FUNCTION_SIZE, name);
+    return record ? static_cast<int>(get32(record + 8)) : -1;
+}
+
+bool InterfaceFile::hasClass(std::string_view name) const {
+    return find(classes, CLASS_SIZE, name) != nullptr;
+}
+
+bool InterfaceFile::findConstant(std::string_view name, ModuleInterface::Constant& constant) const {
+    const char* record = find(constants, CONSTANT_SIZE, name);
+    if (!record) return false;
+    constant = ModuleInterface::Constant();
+    constant.name = std::string(name);
+    constant.type = static_cast<ModuleInterface::ConstantType>(get32(record + 4));
+    uint64_t bits = get64(record + 8);
+    switch (constant.type) {
+        case ModuleInterface::ConstantType::INT:
+        case ModuleInterface::ConstantType::BOOL:
+            constant.intValue = static_cast<int64_t>(bits);
+            break;
+        case ModuleInterface::ConstantType::FLOAT:
+            std::memcpy(&constant.floatValue, &bits, sizeof bits);
+            break;
+        case ModuleInterface::ConstantType::STR:
+            constant.text = std::string(string(static_cast<uint32_t>(bits)));
+            break;
+    }
+    return true;
+}
+
+ModuleInterface InterfaceFile::load() const {
+    ModuleInterface interface;
+    interface.module = std::string(module());
+    interface.sourceHash = get64(data() + 8);
+    for (uint32_t i = 0; i < functions.count; i++) {
+        interface.functions.push_back(function(data() + functions.offset + i * FUNCTION_SIZE));
+    }
+    for (uint32_t i = 0; i < classes.count; i++) {
+        const char* record = data() + classes.offset + i * CLASS_SIZE;
+        ModuleInterface::Class cls;
+        cls.name = std::string(string(get32(record)));
+        cls.base = std::string(string(get32(record + 4)));
+        for (uint32_t m = 0; m < get32(record + 12); m++) {
+            cls.methods.push_back(function(data() + methods.offset + (get32(record + 8) + m) * FUNCTION_SIZE));
+        }
+        interface.classes.push_back(std::move(cls));
+    }
+    for (uint32_t i = 0; i < constants.count; i++) {
+        ModuleInterface::Constant constant;
+        findConstant(string(get32(data() + constants.offset + i * CONSTANT_SIZE)), constant);
+        interface.constants.push_back(std::move(constant));
+    }
+    return interface;
+}
+
+std::unique_ptr<InterfaceFile> InterfaceFile::fromInterface(const ModuleInterface& interface) {
+    std::unique_ptr<InterfaceFile> file(new InterfaceFile(lexer::SourceBuffer::fromString(serialize(interface))));
+    if (!file->validate()) {
+        throw std::logic_error("serialized interface of " + interface.module + " does not validate");
+    }
+    return file;
+}
+
+std::string InterfaceFile::serialize(const ModuleInterface& interface) {
+    StringTable strings;
+    std::string function_records;
+    std::string class_records;
+    std::string constant_records;
+    std::string method_records;
+    std::string parameter_records;
+    uint32_t parameter_count = 0;
+    uint32_t method_count = 0;
+
+    auto addFunction = [&](std::string& records, const ModuleInterface::Function& function) {
+        put32(records, strings.add(function.name));
+        put32(records, parameter_count);
+        put32(records, static_cast<uint32_t>(function.parameters.size()));
+        for (const auto& parameter : function.parameters) {
+            put32(parameter_records, strings.add(parameter));
+            parameter_count++;
+        }
+    };
+
+    // Sorted here too, as lookups depend on it
+    auto functions = interface.functions;
+    auto classes = interface.classes;
+    auto constants = interface.constants;
+    sortByName(functions);
+    sortByName(classes);
+    sortByName(constants);
+
+    uint32_t module_name = strings.add(interface.module);
+    for (const auto& function : functions) {
+        addFunction(function_records, function);
+    }
+    for (auto& cls : classes) {
+        sortByName(cls.methods);
+        put32(class_records, strings.add(cls.name));
+        put32(class_records, strings.add(cls.base));
+        put32(class_records, method_count);
+        put32(class_records, static_cast<uint32_t>(cls.methods.size()));
+        for (const auto& method : cls.methods) {
+            addFunction(method_records, method);
+            method_count++;
+        }
+    }
+    for (const auto& constant : constants) {
+        put32(constant_records, strings.add(constant.name));
+        put32(constant_records, static_cast<uint32_t>(constant.type));
+        uint64_t bits = 0;
+        switch (constant.type) {
+            case ModuleInterface::ConstantType::INT:
+            case ModuleInterface::ConstantType::BOOL:
+                bits = static_cast<uint64_t>(constant.intValue);
+                break;
+            case ModuleInterface::ConstantType::FLOAT:
+                std::memcpy(&bits, &constant.floatValue, sizeof bits);
+                break;
+            case ModuleInterface::ConstantType::STR:
+                bits = strings.add(constant.text);
+                break;
+        }
+        put64(constant_records, bits);
+    }
+
+    std::string out(MAGIC, 4);
+    put32(out, FORMAT_VERSION);
+    put64(out, interface.sourceHash);
+    put32(out, module_name);
+    put32(out, static_cast<uint32_t>(functions.size()));
+    put32(out, static_cast<uint32_t>(classes.size()));
+    put32(out, static_cast<uint32_t>(constants.size()));
+    put32(out, method_count);
+    put32(out, parameter_count);
+    put32(out, static_cast<uint32_t>(strings.data().size()));
+    out += function_records;
+    out += class_records;
+    out += constant_records;
+    out += method_records;
+    out += parameter_records;
+    out += strings.data();
+    return out;
+}
+
+void InterfaceFile::write(const ModuleInterface& interface, const fs::path& path) {
+    std::string out = serialize(interface);
+    static thread_local std::mt19937_64 random{std::random_device{}()};
+    fs::path temporary = path;
+    temporary += ".tmp" + std::to_string(random());
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file || !file.write(out.data(), static_cast<std::streamsize>(out.size()))) {
+            std::error_code ec;
+            fs::remove(temporary, ec);
+            throw std::runtime_error("cannot write " + path.string());
+        }
+    }
+    fs::rename(temporary, path);
+}
+
+fs::path findModule(std::string_view module, const fs::path& importer) {
+    fs::path relative;
+    size_t start = 0;
+    while (start <= module.size()) {
+        size_t dot = module.find('.', start);
+        if (dot == std::string_view::npos) dot = module.size();
+        relative /= std::string(module.substr(start, dot - start));
+        start = dot + 1;
+    }
+    relative += ".pul";
+
+    std::vector<fs::path> roots;
+    fs::path dir = fs::absolute(importer).parent_path();
+    roots.push_back(dir);
+    for (fs::path project = dir; !project.empty(); project = project.parent_path()) {
+        std::error_code ec;
+        if (fs::exists(project / "pulse.toml", ec)) {
+            roots.push_back(project / ".pulse" / "libs");
+            break;
+        }
+        if (project == project.root_path()) break;
+    }
+    if (const char* home = std::getenv("HOME")) {
+        roots.push_back(fs::path(home) / ".pulse" / "libs");
+    }
+
+    for (const auto& root : roots) {
+        std::error_code ec;
+        if (fs::is_regular_file(root / relative, ec)) {
+            return (root / relative).lexically_normal();
+        }
+    }
+    return {};
+}
+
+std::vector<fs::path> importedSources(const fs::path& source) {
+    std::vector<fs::path> sources;
+    std::ifstream in(source);
+    std::string line;
+    while (std::getline(in, line)) {
+        // Imports are top-level statements, so they start their line
+        if (line.rfind("import", 0) != 0 || line.size() < 7 || (line[6] != ' ' && line[6] != '\t')) continue;
+        size_t start = line.find_first_not_of(" \t", 6);
+        if (start == std::string::npos) continue;
+        size_t end = line.find_first_of(" \t;#\r", start);
+        fs::path found = findModule(line.substr(start, end == std::string::npos ? end : end - start), source);
+        if (!found.empty()) sources.push_back(found);
+    }
+    return sources;
+}
+
+InterfaceCache::InterfaceCache(fs::path directory) : directory(std::move(directory)) {}
+
+fs::path InterfaceCache::defaultDirectory() {
+    if (const char* dir = std::getenv("PULSE_INTERFACE_DIR")) {
+        return dir;
+    }
+    const char* home = std::getenv("HOME");
+    return fs::path(home ? home : ".") / ".pulse" / "cache" / "interfaces";
+}
+
+std::shared_ptr<const InterfaceFile> InterfaceCache::load(std::string_view module, const fs::path& source,
+                                                           const parser::Program* parsed) {
+    std::string key = fs::absolute(source).lexically_normal().string();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = loaded.find(key);
+        if (it != loaded.end()) return it->second;
+    }
+
+    auto buffer = lexer::SourceBuffer::fromFile(source.string());
+    uint64_t hash = hashInterfaceSource(buffer->text());
+    std::string hex(16, '0');
+    for (int i = 0; i < 16; i++) {
+        hex[15 - i] = "0123456789abcdef"[(hash >> (4 * i)) & 0xF];
+    }
+    fs::path file = directory / hex.substr(0, 2) / (hex + "." + std::string(module) + ".pulc");
+
+    std::shared_ptr<const InterfaceFile> interface = InterfaceFile::open(file, hash);
+    if (interface) {
+        hitCount++;
+    } else {
+        missCount++;
+        ModuleInterface extracted;
+        if (parsed) {
+            extracted = ModuleInterface::extract(*parsed, std::string(module), hash);
+        } else {
+            lexer::Tokenizer tokenizer(buffer);
+            auto tokens = tokenizer.tokenize();
+            parser::Parser parser(tokens);
+            auto program = parser.parseOrThrow();
+            extracted = ModuleInterface::extract(*program, std::string(module), hash);
+        }
+        // A cache that cannot be written only costs the next build a parse
+        std::error_code ec;
+        fs::create_directories(file.parent_path(), ec);
+        try {
+            InterfaceFile::write(extracted, file);
+        } catch (const std::exception&) {
+        }
+        interface = InterfaceFile::fromInterface(extracted);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return loaded.emplace(key, interface).first->second;
+}
+
+} // namespace pulse::driver
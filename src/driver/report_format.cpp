@@ -0,0 +1,19 @@
+#include "driver/report_format.hpp"
+#include <cstdio>
+#include <iterator>
+
+namespace pulse::driver {
+
+std::string formatBytes(double bytes) {
+    static const char* const UNITS[] = {"B", "KiB", "MiB", "GiB"};
+    size_t unit = 0;
+    while (bytes >= 1024 && unit + 1 < std::size(UNITS)) {
+        bytes /= 1024;
+        unit++;
+    }
+    char text[32];
+    std::snprintf(text, sizeof(text), unit == 0 ? "%.0f %s" : "%.1f %s", bytes, UNITS[unit]);
+    return text;
+}
+
+} // namespace pulse::driver
@@ -0,0 +1,175 @@
+#include "driver/rpc.hpp"
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace pulse::driver {
+
+namespace {
+
+#ifdef _WIN32
+long readSome(int fd, char* data, size_t size) {
+    return _read(fd, data, static_cast<unsigned>(size));
+}
+long writeSome(int fd, const char* data, size_t size) {
+    return _write(fd, data, static_cast<unsigned>(size));
+}
+void closeDescriptor(int fd) {
+    _close(fd);
+}
+#else
+long readSome(int fd, char* data, size_t size) {
+    return ::read(fd, data, size);
+}
+long writeSome(int fd, const char* data, size_t size) {
+#ifdef MSG_NOSIGNAL
+    // A client gone away must not end the daemon with SIGPIPE
+    long sent = ::send(fd, data, size, MSG_NOSIGNAL);
+    if (sent >= 0 || errno != ENOTSOCK) return sent;
+#endif
+    return ::write(fd, data, size);
+}
+void closeDescriptor(int fd) {
+    ::close(fd);
+}
+#endif
+
+} // namespace
+
+RpcChannel::RpcChannel(int input, int output, bool owned) : input(input), output(output), owned(owned) {}
+
+RpcChannel::~RpcChannel() {
+    if (!owned) return;
+    closeDescriptor(input);
+    if (output != input) closeDescriptor(output);
+}
+
+std::unique_ptr<RpcChannel> RpcChannel::connect(const std::string& path) {
+#ifdef _WIN32
+    throw std::runtime_error("pulsed sockets are not supported on this platform");
+#else
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("socket path too long: " + path);
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error("cannot connect to " + path + ": " + std::strerror(error));
+    }
+    return std::make_unique<RpcChannel>(fd, fd, true);
+#endif
+}
+
+bool RpcChannel::fill() {
+    char chunk[65536];
+    while (true) {
+        long count = readSome(input, chunk, sizeof(chunk));
+        if (count > 0) {
+            buffer.append(chunk, static_cast<size_t>(count));
+            return true;
+        }
+        if (count == 0) return false;
+        if (errno != EINTR) return false;
+    }
+}
+
+bool RpcChannel::read(Json& message) {
+    size_t headerEnd;
+    while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+        if (!fill()) {
+            if (buffer.find_first_not_of(" \t\r\n") == std::string::npos) return false;
+            throw std::runtime_error("input ended inside a message header");
+        }
+    }
+
+    // Content-Type is the only other header, and always JSON
+    size_t length = std::string::npos;
+    size_t position = 0;
+    while (position < headerEnd) {
+        size_t end = buffer.find("\r\n", position);
+        std::string line = buffer.substr(position, end - position);
+        position = end + 2;
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        std::string name = line.substr(0, colon);
+        for (char& c : name) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        if (name == "content-length") {
+            length = std::strtoul(line.c_str() + colon + 1, nullptr, 10);
+        }
+    }
+    if (length == std::string::npos) {
+        throw std::runtime_error("message without Content-Length");
+    }
+
+    size_t start = headerEnd + 4;
+    while (buffer.size() < start + length) {
+        if (!fill()) throw std::runtime_error("input ended inside a message");
+    }
+    message = Json::parse(std::string_view(buffer).substr(start, length));
+    buffer.erase(0, start + length);
+    return true;
+}
+
+void RpcChannel::write(const Json& message) {
+    std::string body = message.dump();
+    std::string frame = "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    std::lock_guard<std::mutex> lock(writing);
+    size_t written = 0;
+    while (written < frame.size()) {
+        long count = writeSome(output, frame.data() + written, frame.size() - written);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) {
+            throw std::runtime_error(std::string("cannot write message: ") + std::strerror(errno));
+        }
+        written += static_cast<size_t>(count);
+    }
+}
+
+Json RpcChannel::call(const std::string& method, Json params) {
+    int64_t id = nextId++;
+    Json request;
+    request["jsonrpc"] = "2.0";
+    request["id"] = id;
+    request["method"] = method;
+    request["params"] = std::move(params);
+    write(request);
+
+    Json message;
+    while (read(message)) {
+        const Json& response = message;
+        // Notifications and responses to other requests are not ours
+        if (response["id"].asInt(-1) != id || response.contains("method")) continue;
+        if (response.contains("error")) {
+            throw std::runtime_error(method + ": " + response["error"]["message"].asString());
+        }
+        return response["result"];
+    }
+    throw std::runtime_error(method + ": connection closed before the response");
+}
+
+std::string daemonSocketPath(const std::filesystem::path& project) {
+    if (const char* path = std::getenv("PULSE_DAEMON_SOCKET")) {
+        return path;
+    }
+    return (project / "build" / "pulsed.sock").string();
+}
+
+} // namespace pulse::driver
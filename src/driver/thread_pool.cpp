@@ -0,0 +1,170 @@
+#include "driver/thread_pool.hpp"
+#include <algorithm>
+
+namespace pulse::driver {
+
+namespace {
+// Identifies the pool and queue of the current worker thread, if any
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_index = 0;
+}
+
+size_t ThreadPool::defaultThreadCount() {
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) {
+        threads = defaultThreadCount();
+    }
+
+    queues.reserve(threads);
+    for (size_t i = 0; i < threads; i++) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; i++) {
+        workers.emplace_back([this, i] { run(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(Task task) {
+    // Work spawned by a worker stays on its own deque; outside work is dealt out
+    size_t index = current_pool == this
+        ? current_index
+        : next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+
+    bool helpers;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending++;
+        queued++;
+        helpers = waiting > 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+
+    wake.notify_one();
+    if (helpers) {
+        // Workers waiting inside a task run queued work too
+        idle.notify_all();
+    }
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (current_pool == this) {
+        help(current_index, lock);
+    } else {
+        idle.wait(lock, [this] { return pending.load() == 0; });
+    }
+
+    if (failure) {
+        std::exception_ptr error = failure;
+        failure = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+bool ThreadPool::popLocal(size_t index, Task& task) {
+    WorkQueue& queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) return false;
+
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(size_t index, Task& task) {
+    for (size_t offset = 1; offset < queues.size(); offset++) {
+        WorkQueue& victim = *queues[(index + offset) % queues.size()];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || victim.tasks.empty()) continue;
+
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::execute(Task& task) {
+    queued--;
+
+    try {
+        task();
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!failure) failure = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--pending <= waiting) {
+        idle.notify_all();
+    }
+}
+
+// wait() on a worker: the task calling it stays pending, and it may hold
+// the only worker, so run queued tasks until nothing but waiting tasks is
+// left. Other workers' tasks are waited for as wait() does.
+void ThreadPool::help(size_t index, std::unique_lock<std::mutex>& lock) {
+    waiting++;
+    while (pending.load() > waiting) {
+        if (queued.load() == 0) {
+            idle.wait(lock, [this] { return pending.load() <= waiting || queued.load() > 0; });
+            continue;
+        }
+        lock.unlock();
+        Task task;
+        if (popLocal(index, task) || steal(index, task)) {
+            execute(task);
+        } else {
+            // Being pushed, or behind a contended lock; retry
+            std::this_thread::yield();
+        }
+        lock.lock();
+    }
+    waiting--;
+}
+
+void ThreadPool::run(size_t index) {
+    current_pool = this;
+    current_index = index;
+
+    while (true) {
+        Task task;
+        if (popLocal(index, task) || steal(index, task)) {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (queued.load() > 0) {
+            // A task is being pushed or sits behind a contended lock; retry
+            lock.unlock();
+            std::this_thread::yield();
+            continue;
+        }
+        if (stopping) return;
+        wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+    }
+}
+
+} // namespace pulse::driver
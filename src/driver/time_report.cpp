@@ -0,0 +1,213 @@
+#include "driver/time_report.hpp"
+#include "driver/report_format.hpp"
+#include <algorithm>
+#include <cstdio>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#include <time.h>
+#else
+#include <malloc.h>
+#include <time.h>
+#endif
+
+namespace pulse::driver {
+
+namespace {
+
+// Plain data, so it is usable from operator new at any point of a thread's life
+thread_local AllocationCounters counters;
+
+size_t usableSize(void* block) {
+#if defined(_WIN32)
+    return _msize(block);
+#elif defined(__APPLE__)
+    return malloc_size(block);
+#elif defined(__GLIBC__)
+    return malloc_usable_size(block);
+#else
+    (void)block;
+    return 0;
+#endif
+}
+
+// Set by TimeReport::enable; until then operator new only allocates
+std::atomic<bool> counting{false};
+
+std::chrono::nanoseconds threadCpuTime() {
+#if defined(_WIN32)
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) return {};
+    auto ticks = [](const FILETIME& time) {
+        return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    return std::chrono::nanoseconds((ticks(kernel) + ticks(user)) * 100);
+#else
+    timespec now{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return std::chrono::seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec);
+#endif
+}
+
+double milliseconds(std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+std::string jsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+            quoted += escape;
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+} // namespace
+
+const AllocationCounters& threadAllocations() {
+    return counters;
+}
+
+void countAllocation(void* block, size_t size) {
+    if (!counting.load(std::memory_order_relaxed)) return;
+    counters.allocations++;
+    counters.allocatedBytes += size;
+    counters.live += static_cast<int64_t>(usableSize(block));
+    if (counters.live > counters.peak) counters.peak = counters.live;
+}
+
+void countRelease(void* block) {
+    if (!block || !counting.load(std::memory_order_relaxed)) return;
+    counters.live -= static_cast<int64_t>(usableSize(block));
+}
+
+TimeReport::Scope::Scope(std::string phase) : active(TimeReport::get().isEnabled()) {
+    if (!active) return;
+    name = std::move(phase);
+    allocations = counters;
+    // The peak is the phase's own from here; the enclosing one's comes back after
+    outerPeak = counters.peak;
+    counters.peak = counters.live;
+    cpu = threadCpuTime();
+    wall = std::chrono::steady_clock::now();
+}
+
+TimeReport::Scope::~Scope() {
+    if (!active) return;
+    Phase run;
+    run.wall = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - wall);
+    run.cpu = threadCpuTime() - cpu;
+    run.allocations = counters.allocations - allocations.allocations;
+    run.allocatedBytes = counters.allocatedBytes - allocations.allocatedBytes;
+    run.peakBytes = static_cast<uint64_t>(std::max<int64_t>(0, counters.peak - allocations.live));
+    counters.peak = std::max(outerPeak, counters.peak);
+    run.name = std::move(name);
+    TimeReport::get().add(run);
+}
+
+TimeReport& TimeReport::get() {
+    static TimeReport report;
+    return report;
+}
+
+void TimeReport::enable() {
+    started = std::chrono::steady_clock::now();
+    enabled.store(true, std::memory_order_relaxed);
+    counting.store(true, std::memory_order_relaxed);
+}
+
+void TimeReport::add(const Phase& run) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto [it, inserted] = index.emplace(run.name, phases.size());
+    if (inserted) {
+        phases.push_back(Phase{run.name});
+    }
+    Phase& phase = phases[it->second];
+    phase.count++;
+    phase.wall += run.wall;
+    phase.cpu += run.cpu;
+    phase.allocations += run.allocations;
+    phase.allocatedBytes += run.allocatedBytes;
+    phase.peakBytes = std::max(phase.peakBytes, run.peakBytes);
+}
+
+std::vector<TimeReport::Phase> TimeReport::getPhases() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto parentOf = [](const std::string& name) {
+        size_t slash = name.find('/');
+        return slash == std::string::npos ? std::string() : name.substr(0, slash);
+    };
+
+    std::vector<Phase> ordered;
+    std::vector<bool> placed(phases.size());
+    for (size_t i = 0; i < phases.size(); i++) {
+        std::string parent = parentOf(phases[i].name);
+        if (!parent.empty() && index.count(parent)) continue;
+        ordered.push_back(phases[i]);
+        placed[i] = true;
+
+        std::vector<Phase> parts;
+        for (size_t j = 0; j < phases.size(); j++) {
+            if (!placed[j] && parentOf(phases[j].name) == phases[i].name) {
+                parts.push_back(phases[j]);
+                placed[j] = true;
+            }
+        }
+        std::stable_sort(parts.begin(), parts.end(), [](const Phase& a, const Phase& b) { return a.wall > b.wall; });
+        ordered.insert(ordered.end(), parts.begin(), parts.end());
+    }
+    return ordered;
+}
+
+std::string TimeReport::text() const {
+    std::string text;
+    char line[512];
+    std::snprintf(line, sizeof(line), "time-report: %.3f ms wall in total\n",
+                  milliseconds(std::chrono::steady_clock::now() - started));
+    text += line;
+    std::snprintf(line, sizeof(line), "time-report: %6s %10s %10s %10s %11s %11s  %s\n", "runs", "wall ms", "cpu ms",
+                  "allocs", "allocated", "peak", "phase");
+    text += line;
+    for (const Phase& phase : getPhases()) {
+        // Parts are indented under their phase; names last, as LLVM's run long
+        size_t slash = phase.name.find('/');
+        std::string shown = slash == std::string::npos ? phase.name : "  " + phase.name.substr(slash + 1);
+        std::snprintf(line, sizeof(line), "time-report: %6llu %10.3f %10.3f %10llu %11s %11s  ",
+                      static_cast<unsigned long long>(phase.count), milliseconds(phase.wall), milliseconds(phase.cpu),
+                      static_cast<unsigned long long>(phase.allocations),
+                      formatBytes(static_cast<double>(phase.allocatedBytes)).c_str(),
+                      formatBytes(static_cast<double>(phase.peakBytes)).c_str());
+        text += line + shown + "\n";
+    }
+    return text;
+}
+
+std::string TimeReport::json() const {
+    auto total = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started);
+    std::string json = "{\"wall_ns\": " + std::to_string(total.count()) + ", \"phases\": [";
+    bool first = true;
+    for (const Phase& phase : getPhases()) {
+        json += first ? "\n  " : ",\n  ";
+        first = false;
+        json += "{\"name\": " + jsonString(phase.name) + ", \"count\": " + std::to_string(phase.count) +
+                ", \"wall_ns\": " + std::to_string(phase.wall.count()) +
+                ", \"cpu_ns\": " + std::to_string(phase.cpu.count()) +
+                ", \"allocations\": " + std::to_string(phase.allocations) +
+                ", \"allocated_bytes\": " + std::to_string(phase.allocatedBytes) +
+                ", \"peak_bytes\": " + std::to_string(phase.peakBytes) + "}";
+    }
+    return json + "\n]}\n";
+}
+
+} // namespace pulse::driver
@@ -0,0 +1,744 @@
+#include "driver/workspace.hpp"
+#include "driver/module_interface.hpp"
+#include "driver/thread_pool.hpp"
+#include "lexer/tokenizer.hpp"
+#include "parser/parser.hpp"
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace pulse::driver {
+
+using lexer::Token;
+using lexer::TokenType;
+
+namespace {
+
+bool isIdentifierChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// Whether a line can start a top-level statement. Lines inside a string or
+// brackets can look the same; the chunk before them is then left open and
+// merged with theirs.
+bool startsStatement(std::string_view line) {
+    if (line.empty()) return false;
+    char c = line[0];
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '#' || c == ')' || c == ']' || c == '}') {
+        return false;
+    }
+    // Branches continue the statement before them
+    for (std::string_view keyword : {std::string_view("elif"), std::string_view("else")}) {
+        if (line.substr(0, keyword.size()) == keyword &&
+            (line.size() == keyword.size() || !isIdentifierChar(line[keyword.size()]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whether a text, read from the start of a chunk, ends inside a string or
+// brackets, which the next top-level statement cannot start in. Strings,
+// escapes and comments as the tokenizer reads them; a character scan only,
+// so that the chunks of a text are found before any is lexed.
+class Continuation {
+public:
+    void scan(std::string_view text) {
+        for (char c : text) {
+            if (escaped) {
+                escaped = false;
+            } else if (quote != 0) {
+                if (c == '\\') {
+                    escaped = true;
+                } else if (c == quote) {
+                    quote = 0;
+                }
+            } else if (comment) {
+                comment = c != '\n';
+            } else if (c == '#') {
+                comment = true;
+            } else if (c == '"' || c == '\'') {
+                quote = c;
+            } else if (c == '(' || c == '[' || c == '{') {
+                depth++;
+            } else if (c == ')' || c == ']' || c == '}') {
+                depth--;
+            }
+        }
+    }
+    bool open() const { return quote != 0 || depth > 0; }
+
+private:
+    char quote = 0;
+    bool escaped = false;
+    bool comment = false;
+    int64_t depth = 0;
+};
+
+// Names a chunk binds, from its tokens: definitions, parameters,
+// assignments and for-loop variables at the start of a statement, and imports
+class SymbolCollector {
+public:
+    explicit SymbolCollector(const lexer::TokenStream& tokens) : tokens(tokens) {}
+
+    std::vector<Symbol> collect() {
+        size_t depth = 0;
+        size_t brackets = 0;
+        bool statementStart = true;
+        for (size_t i = 0; i < tokens.size(); i++) {
+            const Token& token = tokens[i];
+            switch (token.type) {
+                case TokenType::INDENT:
+                    depth++;
+                    if (header && headerDone) openHeader(depth, false);
+                    statementStart = true;
+                    continue;
+                case TokenType::DEDENT:
+                    depth = depth > 0 ? depth - 1 : 0;
+                    while (!scopes.empty() && !scopes.back().inlineBody && depth < scopes.back().depth) close();
+                    statementStart = true;
+                    continue;
+                case TokenType::NEWLINE:
+                    while (!scopes.empty() && scopes.back().inlineBody) close();
+                    statementStart = true;
+                    continue;
+                case TokenType::COMMENT:
+                    continue;
+                case TokenType::EOF_TOKEN:
+                    while (!scopes.empty()) close();
+                    continue;
+                default:
+                    break;
+            }
+
+            lastLine = token.line;
+            // "def f(): return 1": the body is the rest of the line
+            if (header && headerDone) openHeader(depth, true);
+
+            if (token.type == TokenType::LPAREN || token.type == TokenType::LBRACKET ||
+                token.type == TokenType::LBRACE) {
+                brackets++;
+            } else if ((token.type == TokenType::RPAREN || token.type == TokenType::RBRACKET ||
+                        token.type == TokenType::RBRACE) &&
+                       brackets > 0) {
+                brackets--;
+            }
+
+            if ((token.type == TokenType::DEF || token.type == TokenType::CLASS) && next(i, TokenType::IDENTIFIER)) {
+                i = definition(i);
+                statementStart = false;
+                continue;
+            }
+            if (token.type == TokenType::IMPORT) {
+                i = import(i);
+                statementStart = false;
+                continue;
+            }
+            if (token.type == TokenType::COLON && brackets == 0) {
+                if (header) headerDone = true;
+                statementStart = true; // a suite on the same line
+                continue;
+            }
+            if (statementStart && token.type == TokenType::IDENTIFIER && next(i, TokenType::ASSIGN)) {
+                bind(token, Symbol::Kind::VARIABLE);
+            } else if (token.type == TokenType::FOR && next(i, TokenType::IDENTIFIER)) {
+                bind(tokens[i + 1], Symbol::Kind::VARIABLE);
+            }
+            statementStart = false;
+        }
+        return std::move(symbols);
+    }
+
+private:
+    struct Scope {
+        Symbol::Kind kind = Symbol::Kind::FUNCTION; // or CLASS
+        std::string name;
+        size_t depth = 0; // of its body
+        bool inlineBody = false;
+        uint32_t start = 0;
+        std::vector<size_t> locals;
+        std::set<std::string, std::less<>> bound;
+    };
+
+    const lexer::TokenStream& tokens;
+    std::vector<Symbol> symbols;
+    std::vector<Scope> scopes;
+    std::set<std::string, std::less<>> globals;
+    std::optional<Scope> header; // a def or class whose body comes next
+    bool headerDone = false;     // its ':' was seen
+    uint32_t lastLine = 1;
+
+    bool next(size_t i, TokenType type) const { return i + 1 < tokens.size() && tokens[i + 1].type == type; }
+
+    std::string name(const Token& token) const { return std::string(tokens.lexeme(token)); }
+
+    Symbol make(const Token& token, Symbol::Kind kind) const {
+        Symbol symbol;
+        symbol.name = name(token);
+        symbol.kind = kind;
+        symbol.position = {token.line, token.column};
+        return symbol;
+    }
+
+    // First binding of a name in its scope
+    void bind(const Token& token, Symbol::Kind kind) {
+        Symbol symbol = make(token, kind);
+        if (scopes.empty()) {
+            if (!globals.insert(symbol.name).second) return;
+        } else {
+            Scope& scope = scopes.back();
+            if (!scope.bound.insert(symbol.name).second) return;
+            symbol.container = scope.name;
+            if (scope.kind == Symbol::Kind::FUNCTION) {
+                symbol.local = true;
+                scope.locals.push_back(symbols.size());
+            }
+        }
+        symbols.push_back(std::move(symbol));
+    }
+
+    // def/class name: the symbol, the parameters, and the scope to come
+    size_t definition(size_t i) {
+        bool isClass = tokens[i].type == TokenType::CLASS;
+        const Token& nameToken = tokens[i + 1];
+        Symbol::Kind kind = isClass ? Symbol::Kind::CLASS : Symbol::Kind::FUNCTION;
+        if (!isClass && !scopes.empty() && scopes.back().kind == Symbol::Kind::CLASS) {
+            kind = Symbol::Kind::METHOD;
+        }
+        if (scopes.empty()) {
+            globals.insert(name(nameToken));
+            symbols.push_back(make(nameToken, kind));
+        } else if (kind == Symbol::Kind::METHOD) {
+            Symbol symbol = make(nameToken, kind);
+            symbol.container = scopes.back().name;
+            symbols.push_back(std::move(symbol));
+        } else {
+            bind(nameToken, kind);
+        }
+
+        header = Scope();
+        header->kind = isClass ? Symbol::Kind::CLASS : Symbol::Kind::FUNCTION;
+        header->name = name(nameToken);
+        header->start = nameToken.line;
+        headerDone = false;
+
+        size_t j = i + 2;
+        if (isClass || j >= tokens.size() || tokens[j].type != TokenType::LPAREN) return i + 1;
+        // Parameters: the names after '(' and ',' at the first level
+        size_t level = 0;
+        for (; j < tokens.size(); j++) {
+            TokenType type = tokens[j].type;
+            if (type == TokenType::LPAREN || type == TokenType::LBRACKET || type == TokenType::LBRACE) {
+                level++;
+            } else if (type == TokenType::RPAREN || type == TokenType::RBRACKET || type == TokenType::RBRACE) {
+                if (--level == 0) break;
+            } else if (type == TokenType::IDENTIFIER && level == 1 &&
+                       (tokens[j - 1].type == TokenType::LPAREN || tokens[j - 1].type == TokenType::COMMA)) {
+                Symbol symbol = make(tokens[j], Symbol::Kind::PARAMETER);
+                symbol.container = header->name;
+                symbol.local = true;
+                if (header->bound.insert(symbol.name).second) {
+                    header->locals.push_back(symbols.size());
+                    symbols.push_back(std::move(symbol));
+                }
+            } else if (synthetic(type)) {
+                break;
+            }
+        }
+        return std::min(j, tokens.size() - 1);
+    }
+
+    // import a.b [as c]
+    size_t import(size_t i) {
+        size_t j = i + 1;
+        if (j >= tokens.size() || tokens[j].type != TokenType::IDENTIFIER) return i;
+        const Token& first = tokens[j];
+        std::string module = name(first);
+        while (j + 2 < tokens.size() && tokens[j + 1].type == TokenType::DOT &&
+               tokens[j + 2].type == TokenType::IDENTIFIER) {
+            module += "." + name(tokens[j + 2]);
+            j += 2;
+        }
+        Symbol symbol = make(first, Symbol::Kind::MODULE);
+        symbol.name = module;
+        symbol.module = module;
+        if (j + 2 < tokens.size() && tokens[j + 1].type == TokenType::AS &&
+            tokens[j + 2].type == TokenType::IDENTIFIER) {
+            j += 2;
+            symbol.name = name(tokens[j]);
+            symbol.position = {tokens[j].line, tokens[j].column};
+        }
+        symbols.push_back(std::move(symbol));
+        return j;
+    }
+
+    static bool synthetic(TokenType type) {
+        return type == TokenType::NEWLINE || type == TokenType::INDENT || type == TokenType::DEDENT ||
+               type == TokenType::EOF_TOKEN;
+    }
+
+    void openHeader(size_t depth, bool inlineBody) {
+        header->depth = depth;
+        header->inlineBody = inlineBody;
+        scopes.push_back(std::move(*header));
+        header.reset();
+        headerDone = false;
+    }
+
+    void close() {
+        Scope& scope = scopes.back();
+        for (size_t index : scope.locals) {
+            symbols[index].scopeStart = scope.start;
+            symbols[index].scopeEnd = lastLine;
+        }
+        scopes.pop_back();
+    }
+};
+
+// Where a chunk-relative symbol is in the document
+Symbol place(Symbol symbol, uint32_t line) {
+    symbol.position.line += line - 1;
+    if (symbol.local) {
+        symbol.scopeStart += line - 1;
+        symbol.scopeEnd += line - 1;
+    }
+    return symbol;
+}
+
+} // namespace
+
+Document::Document(std::string path, std::string_view text) : path(std::move(path)) {
+    size_t next = 0;
+    chunks = split(text, 0, next);
+    if (chunks.empty()) chunks.push_back(analyze(""));
+}
+
+std::string Document::text() const {
+    std::string text;
+    size_t size = 0;
+    for (const Chunk& chunk : chunks) size += chunk.text().size();
+    text.reserve(size);
+    for (const Chunk& chunk : chunks) text += chunk.text();
+    return text;
+}
+
+uint32_t Document::lineCount() const {
+    const Chunk& last = chunks.back();
+    uint32_t count = last.line + last.lines();
+    std::string_view text = last.text();
+    return !text.empty() && text.back() == '\n' ? count + 1 : count;
+}
+
+size_t Document::chunkAtLine(uint32_t line) const {
+    auto it = std::upper_bound(chunks.begin(), chunks.end(), line,
+                               [](uint32_t value, const Chunk& chunk) { return value < chunk.line; });
+    return it == chunks.begin() ? 0 : static_cast<size_t>(it - chunks.begin()) - 1;
+}
+
+std::string_view Document::line(uint32_t index) const {
+    const Chunk& chunk = chunks[chunkAtLine(index)];
+    uint32_t local = index - chunk.line;
+    if (local >= chunk.lines()) return {};
+    std::string_view text = chunk.text();
+    size_t start = chunk.lineStarts[local];
+    size_t end = local + 1 < chunk.lines() ? chunk.lineStarts[local + 1] - 1 : text.size();
+    if (end > start && text[end - 1] == '\n') end--;
+    return text.substr(start, end - start);
+}
+
+std::pair<size_t, size_t> Document::locate(Position position) const {
+    size_t index = chunkAtLine(position.line);
+    const Chunk& chunk = chunks[index];
+    uint32_t local = position.line - chunk.line;
+    if (local >= chunk.lines()) {
+        // Past the last line: the end of the text
+        return {index, chunk.text().size()};
+    }
+    std::string_view text = chunk.text();
+    size_t start = chunk.lineStarts[local];
+    size_t end = local + 1 < chunk.lines() ? chunk.lineStarts[local + 1] - 1 : text.size();
+    if (end > text.size()) end = text.size();
+    return {index, std::min(start + position.column, end)};
+}
+
+size_t Document::offsetOf(Position position) const {
+    auto [index, offset] = locate(position);
+    for (size_t i = 0; i < index; i++) offset += chunks[i].text().size();
+    return offset;
+}
+
+Position Document::positionOf(size_t offset) const {
+    size_t index = 0;
+    while (index + 1 < chunks.size() && offset >= chunks[index].text().size()) {
+        offset -= chunks[index++].text().size();
+    }
+    const Chunk& chunk = chunks[index];
+    offset = std::min(offset, chunk.text().size());
+    size_t local = static_cast<size_t>(
+                       std::upper_bound(chunk.lineStarts.begin(), chunk.lineStarts.end(), offset) -
+                       chunk.lineStarts.begin()) -
+                   1;
+    // At the end of a text ending in a line break: the empty line after it
+    if (offset == chunk.text().size() && offset > 0 && chunk.text().back() == '\n') {
+        return {chunk.line + chunk.lines(), 0};
+    }
+    return {chunk.line + static_cast<uint32_t>(local), static_cast<uint32_t>(offset - chunk.lineStarts[local])};
+}
+
+Document::Chunk Document::analyze(std::string text) const {
+    Chunk chunk;
+    chunk.lineStarts.push_back(0);
+    for (size_t i = 0; i + 1 < text.size(); i++) {
+        if (text[i] == '\n') chunk.lineStarts.push_back(static_cast<uint32_t>(i + 1));
+    }
+    chunk.source = lexer::SourceBuffer::fromString(std::move(text), path);
+
+    try {
+        lexer::Tokenizer tokenizer(chunk.source);
+        chunk.tokens = tokenizer.tokenize();
+    } catch (const lexer::LexError& e) {
+        chunk.diagnostics.push_back({path, e.line, e.column, e.message});
+        return chunk;
+    } catch (const std::exception& e) {
+        chunk.diagnostics.push_back({path, 0, 0, e.what()});
+        return chunk;
+    }
+
+    try {
+        parser::Parser parser(chunk.tokens);
+        chunk.program = parser.parseOrThrow();
+    } catch (const parser::ParseError& e) {
+        chunk.diagnostics.push_back({path, e.line, e.column, e.message});
+    } catch (const std::exception& e) {
+        chunk.diagnostics.push_back({path, 0, 0, e.what()});
+    }
+    chunk.symbols = SymbolCollector(chunk.tokens).collect();
+    return chunk;
+}
+
+std::vector<Document::Chunk> Document::split(std::string_view text, uint32_t line, size_t& next) {
+    // Top-level statements by their first lines. Chunks taken in are cut
+    // the same way, and a chunk ends at the first statement that does not
+    // leave it open, so that a text comes out in the same chunks however it
+    // was edited into it.
+    std::vector<std::string_view> pieces;
+    auto cut = [&pieces](std::string_view text) {
+        size_t start = 0;
+        for (size_t position = 0; position < text.size();) {
+            size_t end = text.find('\n', position);
+            end = end == std::string_view::npos ? text.size() : end + 1;
+            if (position > start && startsStatement(text.substr(position, end - position))) {
+                pieces.push_back(text.substr(start, position - start));
+                start = position;
+            }
+            position = end;
+        }
+        if (start < text.size()) pieces.push_back(text.substr(start));
+    };
+    cut(text);
+
+    std::vector<Chunk> result;
+    std::string merged;
+    Continuation continuation;
+    for (size_t i = 0; i < pieces.size() || !merged.empty();) {
+        if (i == pieces.size()) {
+            if (next < chunks.size()) {
+                // Open at the end of the text: take in the next chunk
+                cut(chunks[next++].text());
+                continue;
+            }
+        } else {
+            continuation.scan(pieces[i]);
+            merged += pieces[i++];
+            if (continuation.open()) continue;
+        }
+        Chunk chunk = analyze(std::move(merged));
+        merged.clear();
+        continuation = Continuation();
+        chunk.line = line;
+        line += chunk.lines();
+        result.push_back(std::move(chunk));
+    }
+    reparsed += result.size();
+    return result;
+}
+
+void Document::edit(Position start, Position end, std::string_view replacement) {
+    auto [first, startOffset] = locate(start);
+    auto [last, endOffset] = locate(end);
+    if (last < first || (last == first && endOffset < startOffset)) {
+        last = first;
+        endOffset = startOffset;
+    }
+
+    std::string region(chunks[first].text().substr(0, startOffset));
+    region += replacement;
+    region += chunks[last].text().substr(endOffset);
+    // A line break deleted joins the first line of the next chunk to the last
+    size_t next = last + 1;
+    while (!region.empty() && region.back() != '\n' && next < chunks.size()) region += chunks[next++].text();
+    // A first line that no longer starts a statement (indented, say) joins the chunk before
+    size_t from = first;
+    if (from > 0 && !region.empty() && !startsStatement(region)) region.insert(0, chunks[--from].text());
+
+    reparsed = 0;
+    uint32_t line = chunks[from].line;
+    std::vector<Chunk> rebuilt = split(region, line, next);
+    if (!rebuilt.empty()) line = rebuilt.back().line + rebuilt.back().lines();
+    chunks.erase(chunks.begin() + static_cast<std::ptrdiff_t>(from), chunks.begin() + static_cast<std::ptrdiff_t>(next));
+    chunks.insert(chunks.begin() + static_cast<std::ptrdiff_t>(from), std::make_move_iterator(rebuilt.begin()),
+                  std::make_move_iterator(rebuilt.end()));
+    for (size_t i = from + rebuilt.size(); i < chunks.size(); i++) {
+        chunks[i].line = line;
+        line += chunks[i].lines();
+    }
+    // Everything deleted: one empty chunk, as for an empty file
+    if (chunks.empty()) {
+        chunks.push_back(analyze(""));
+        reparsed++;
+    }
+}
+
+void Document::setText(std::string_view text) {
+    std::string old = this->text();
+    size_t prefix = 0;
+    size_t limit = std::min(old.size(), text.size());
+    while (prefix < limit && old[prefix] == text[prefix]) prefix++;
+    if (prefix == old.size() && prefix == text.size()) {
+        reparsed = 0;
+        return;
+    }
+    size_t suffix = 0;
+    while (suffix < limit - prefix && old[old.size() - 1 - suffix] == text[text.size() - 1 - suffix]) suffix++;
+    edit(positionOf(prefix), positionOf(old.size() - suffix),
+         text.substr(prefix, text.size() - suffix - prefix));
+}
+
+std::vector<Diagnostic> Document::diagnostics() const {
+    std::vector<Diagnostic> diagnostics;
+    for (const Chunk& chunk : chunks) {
+        for (Diagnostic diagnostic : chunk.diagnostics) {
+            if (diagnostic.line > 0) diagnostic.line += chunk.line;
+            diagnostics.push_back(std::move(diagnostic));
+        }
+    }
+    return diagnostics;
+}
+
+std::vector<Symbol> Document::symbols() const {
+    std::vector<Symbol> symbols;
+    for (const Chunk& chunk : chunks) {
+        for (const Symbol& symbol : chunk.symbols) symbols.push_back(place(symbol, chunk.line));
+    }
+    return symbols;
+}
+
+std::vector<std::string> Document::imports() const {
+    std::vector<std::string> modules;
+    for (const Chunk& chunk : chunks) {
+        for (const Symbol& symbol : chunk.symbols) {
+            if (symbol.kind == Symbol::Kind::MODULE) modules.push_back(symbol.module);
+        }
+    }
+    return modules;
+}
+
+bool Document::identifierAt(Position position, std::string& name, bool& attribute) const {
+    auto [index, offset] = locate(position);
+    const Chunk& chunk = chunks[index];
+    const lexer::TokenStream& tokens = chunk.tokens;
+    // The last token starting at or before the offset
+    auto it = std::upper_bound(tokens.begin(), tokens.end(), offset,
+                               [](size_t value, const Token& token) { return value < token.offset; });
+    while (it != tokens.begin()) {
+        --it;
+        if (it->length > 0) break;
+    }
+    if (it == tokens.end() || it->type != TokenType::IDENTIFIER || offset < it->offset ||
+        offset > it->offset + it->length) {
+        return false;
+    }
+    size_t at = static_cast<size_t>(it - tokens.begin());
+    name = std::string(tokens.lexeme(*it));
+    attribute = at > 0 && tokens[at - 1].type == TokenType::DOT;
+    return true;
+}
+
+std::vector<Symbol> Document::lookup(std::string_view name, Position position) const {
+    std::vector<Symbol> locals;
+    std::vector<Symbol> globals;
+    for (const Chunk& chunk : chunks) {
+        bool inside = position.line >= chunk.line && position.line < chunk.line + chunk.lines();
+        for (const Symbol& symbol : chunk.symbols) {
+            if (symbol.name != name) continue;
+            if (symbol.local) {
+                Symbol placed = place(symbol, chunk.line);
+                if (inside && position.line >= placed.scopeStart && position.line <= placed.scopeEnd) {
+                    locals.push_back(std::move(placed));
+                }
+            } else if (symbol.container.empty()) {
+                globals.push_back(place(symbol, chunk.line));
+            }
+        }
+    }
+    std::stable_sort(locals.begin(), locals.end(), [](const Symbol& a, const Symbol& b) {
+        return a.scopeEnd - a.scopeStart < b.scopeEnd - b.scopeStart;
+    });
+    locals.insert(locals.end(), globals.begin(), globals.end());
+    return locals;
+}
+
+std::string Workspace::normalize(const std::string& path) {
+    std::error_code error;
+    fs::path absolute = fs::absolute(path, error);
+    return (error ? fs::path(path) : absolute).lexically_normal().string();
+}
+
+Document& Workspace::open(const std::string& path, std::string_view text) {
+    std::string key = normalize(path);
+    auto& document = opened[key];
+    if (document) {
+        document->setText(text);
+    } else {
+        document = std::make_unique<Document>(key, text);
+    }
+    return *document;
+}
+
+void Workspace::close(const std::string& path) {
+    opened.erase(normalize(path));
+}
+
+Document* Workspace::find(const std::string& path) {
+    auto it = opened.find(normalize(path));
+    return it == opened.end() ? nullptr : it->second.get();
+}
+
+size_t Workspace::refresh(const std::string& path, DiskFile& file) {
+    std::error_code error;
+    auto modified = fs::last_write_time(path, error);
+    uintmax_t size = error ? 0 : fs::file_size(path, error);
+    if (error) {
+        throw std::runtime_error("cannot read " + path + ": " + error.message());
+    }
+    if (file.document && modified == file.modified && size == file.size) return 0;
+
+    auto source = lexer::SourceBuffer::fromFile(path);
+    file.modified = modified;
+    file.size = size;
+    if (file.document) {
+        file.document->setText(source->text());
+    } else {
+        file.document = std::make_unique<Document>(path, source->text());
+    }
+    return file.document->lastReparsed();
+}
+
+const Document& Workspace::load(const std::string& path) {
+    std::string key = normalize(path);
+    DiskFile& file = files[key];
+    refresh(key, file);
+    return *file.document;
+}
+
+const Document* Workspace::source(const std::string& path) {
+    if (Document* document = find(path)) return document;
+    try {
+        return &load(path);
+    } catch (const std::exception&) {
+        return nullptr;
+    }
+}
+
+std::optional<Location> Workspace::definition(const std::string& path, Position position) {
+    const Document* document = source(path);
+    if (!document) return std::nullopt;
+    std::string name;
+    bool attribute = false;
+    if (!document->identifierAt(position, name, attribute)) return std::nullopt;
+
+    // Imported modules: the file an `import` names, then the top-level names in it
+    std::vector<std::pair<std::string, std::string>> modules;
+    for (const auto& module : document->imports()) {
+        fs::path file = findModule(module, document->getPath());
+        if (!file.empty()) modules.emplace_back(module, normalize(file.string()));
+    }
+
+    if (attribute) {
+        // Methods and class attributes of that name, here and in the imports
+        for (const Symbol& symbol : document->symbols()) {
+            if (symbol.name == name && !symbol.container.empty() && !symbol.local) {
+                return Location{document->getPath(), symbol.position};
+            }
+        }
+    } else {
+        for (const Symbol& symbol : document->lookup(name, position)) {
+            if (symbol.kind == Symbol::Kind::MODULE) {
+                for (const auto& [module, file] : modules) {
+                    if (module == symbol.module) return Location{file, {0, 0}};
+                }
+            }
+            return Location{document->getPath(), symbol.position};
+        }
+    }
+
+    for (const auto& [module, file] : modules) {
+        const Document* imported = source(file);
+        if (!imported) continue;
+        for (const Symbol& symbol : imported->symbols()) {
+            if (symbol.name != name || symbol.local || symbol.kind == Symbol::Kind::MODULE) continue;
+            if (attribute ? !symbol.container.empty() : symbol.container.empty()) {
+                return Location{imported->getPath(), symbol.position};
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+std::vector<Diagnostic> Workspace::check(const std::vector<std::string>& paths, size_t jobs, size_t& reparsed) {
+    // Entries first, so that the threads only touch their own
+    std::vector<std::pair<std::string, DiskFile*>> entries;
+    for (const auto& path : paths) {
+        std::string key = normalize(path);
+        entries.emplace_back(key, &files[key]);
+    }
+
+    std::vector<std::vector<Diagnostic>> results(entries.size());
+    std::vector<size_t> counts(entries.size());
+    auto run = [&](size_t i) {
+        auto& [key, file] = entries[i];
+        try {
+            counts[i] = refresh(key, *file);
+            results[i] = file->document->diagnostics();
+        } catch (const std::exception& e) {
+            results[i].push_back({key, 0, 0, e.what()});
+        }
+        // Reported under the path asked for
+        for (auto& diagnostic : results[i]) diagnostic.file = paths[i];
+    };
+
+    if (jobs == 0) jobs = ThreadPool::defaultThreadCount();
+    jobs = std::min(jobs, entries.size());
+    // The same file named twice must not be refreshed by two threads at once
+    std::set<DiskFile*> distinct;
+    for (const auto& entry : entries) distinct.insert(entry.second);
+    if (jobs <= 1 || distinct.size() != entries.size()) {
+        for (size_t i = 0; i < entries.size(); i++) run(i);
+    } else {
+        ThreadPool pool(jobs);
+        for (size_t i = 0; i < entries.size(); i++) pool.submit([&run, i] { run(i); });
+        pool.wait();
+    }
+
+    reparsed = 0;
+    std::vector<Diagnostic> diagnostics;
+    for (size_t i = 0; i < entries.size(); i++) {
+        reparsed += counts[i];
+        diagnostics.insert(diagnostics.end(), results[i].begin(), results[i].end());
+    }
+    return diagnostics;
+}
+
+} // namespace pulse::driver
@@ -0,0 +1,122 @@
+#include "lexer/source_buffer.hpp"
+#include <cerrno>
+#include <fstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace pulse::lexer {
+
+namespace {
+
+constexpr size_t READ_CHUNK_SIZE = 64 * 1024;
+
+} // namespace
+
+SourceBuffer::~SourceBuffer() {
+#ifndef _WIN32
+    if (mapped) {
+        munmap(const_cast<char*>(data), length);
+    }
+#endif
+}
+
+SourceBufferPtr SourceBuffer::fromString(std::string text, const std::string& name) {
+    std::shared_ptr<SourceBuffer> buffer(new SourceBuffer());
+    buffer->name = name;
+    buffer->owned = std::move(text);
+    buffer->data = buffer->owned.data();
+    buffer->length = buffer->owned.size();
+    return buffer;
+}
+
+SourceBufferPtr SourceBuffer::fromStream(std::istream& stream, const std::string& name) {
+    std::string text;
+    char chunk[READ_CHUNK_SIZE];
+
+    while (stream.read(chunk, sizeof(chunk)) || stream.gcount() > 0) {
+        text.append(chunk, static_cast<size_t>(stream.gcount()));
+    }
+
+    return fromString(std::move(text), name);
+}
+
+#ifdef _WIN32
+
+SourceBufferPtr SourceBuffer::fromFile(const std::string& path) {
+    // Memory mapping is only wired up for POSIX; use a buffered read here
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+    return fromStream(file, path);
+}
+
+#else
+
+SourceBufferPtr SourceBuffer::fromFile(const std::string& path) {
+    if (path == "-") {
+        return fromDescriptor(STDIN_FILENO, "<stdin>");
+    }
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+    try {
+        auto buffer = fromDescriptor(fd, path);
+        close(fd);
+        return buffer;
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+}
+
+SourceBufferPtr SourceBuffer::fromDescriptor(int fd, const std::string& name) {
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        size_t size = static_cast<size_t>(info.st_size);
+        void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            // The lexer scans front to back exactly once
+            madvise(address, size, MADV_SEQUENTIAL);
+
+            std::shared_ptr<SourceBuffer> buffer(new SourceBuffer());
+            buffer->name = name;
+            buffer->data = static_cast<const char*>(address);
+            buffer->length = size;
+            buffer->mapped = true;
+            return buffer;
+        }
+    }
+
+    // Pipes, character devices, empty files or a failed mmap: buffered read
+    std::string text;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        text.reserve(static_cast<size_t>(info.st_size));
+    }
+
+    char chunk[READ_CHUNK_SIZE];
+    while (true) {
+        ssize_t bytes_read = read(fd, chunk, sizeof(chunk));
+        if (bytes_read < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Failed to read: " + name);
+        }
+        if (bytes_read == 0) break;
+        text.append(chunk, static_cast<size_t>(bytes_read));
+    }
+
+    return fromString(std::move(text), name);
+}
+
+#endif
+
+} // namespace pulse::lexer
@@ -1,300 +1,339 @@
-#include "lexer/token.hpp"
-#include <unordered_map>
-#include <cctype>
-#include <sstream>
+#include "lexer/tokenizer.hpp"
+#include "lexer/char_class.hpp"
+#include "lexer/keywords.hpp"
+#include <charconv>
+#include <limits>
 #include <stdexcept>
 
 namespace pulse::lexer {
 
-class Tokenizer {
-private:
-    std::string source;
-    size_t current;
-    size_t start;
-    size_t line;
-    size_t column;
-    std::vector<size_t> indent_stack;
-    
-    // Keyword mapping
-    static const std::unordered_map<std::string, TokenType> keywords;
-    
-    // Helper methods
-    bool isAtEnd() const { return current >= source.length(); }
-    char advance() { 
-        if (isAtEnd()) return '\0';
-        char c = source[current++];
-        if (c == '\n') {
-            line++;
-            column = 0;
-        } else {
-            column++;
-        }
-        return c;
+Tokenizer::Tokenizer(std::string source)
+    : Tokenizer(SourceBuffer::fromString(std::move(source))) {}
+
+Tokenizer::Tokenizer(SourceBufferPtr source)
+    : buffer(std::move(source)), source(buffer->text()),
+      current(0), start(0), line(1), column(0), pending_dedents(0), paren_depth(0), finished(false) {
+    if (this->source.size() >= std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("Source file too large to tokenize");
     }
-    
-    char peek() const { return isAtEnd() ? '\0' : source[current]; }
-    char peekNext() const { return current + 1 >= source.length() ? '\0' : source[current + 1]; }
-    
-    bool match(char expected) {
-        if (isAtEnd()) return false;
-        if (source[current] != expected) return false;
-        current++;
+    indent_stack.push_back(0); // Base indentation level
+}
+
+// Helper methods
+bool Tokenizer::isAtEnd() const { return current >= source.length(); }
+
+char Tokenizer::advance() {
+    if (isAtEnd()) return '\0';
+    char c = source[current++];
+    if (c == '\n') {
+        line++;
+        column = 0;
+    } else {
         column++;
-        return true;
-    }
-    
-    void skipWhitespace() {
-        while (!isAtEnd() && std::isspace(peek()) && peek() != '\n') {
-            advance();
-        }
     }
-    
-    void skipComment() {
-        while (!isAtEnd() && peek() != '\n') {
-            advance();
+    return c;
+}
+
+char Tokenizer::peek() const { return isAtEnd() ? '\0' : source[current]; }
+char Tokenizer::peekNext() const { return current + 1 >= source.length() ? '\0' : source[current + 1]; }
+
+bool Tokenizer::match(char expected) {
+    if (isAtEnd()) return false;
+    if (source[current] != expected) return false;
+    current++;
+    column++;
+    return true;
+}
+
+// Skip a run of characters known not to contain a newline
+void Tokenizer::advanceRun(const char* run_end) {
+    size_t count = static_cast<size_t>(run_end - (source.data() + current));
+    current += count;
+    column += count;
+}
+
+void Tokenizer::skipWhitespace() {
+    advanceRun(scan::whitespaceEnd(source.data() + current, source.data() + source.size()));
+}
+
+void Tokenizer::skipComment() {
+    advanceRun(scan::lineEnd(source.data() + current, source.data() + source.size()));
+}
+
+void Tokenizer::error(const std::string& message) const {
+    throw LexError(message + " at line " + std::to_string(line), message, line, column);
+}
+
+// Token creation helpers
+Token Tokenizer::makeToken(TokenType type) {
+    uint32_t length = static_cast<uint32_t>(current - start);
+    return Token{type, static_cast<uint32_t>(start), length, static_cast<uint32_t>(line),
+                 static_cast<uint32_t>(column - length), Token::NO_LITERAL};
+}
+
+Token Tokenizer::makeToken(TokenType type, LiteralValue value) {
+    Token token = makeToken(type);
+    token.literal = static_cast<uint32_t>(literals.size());
+    literals.push_back(value);
+    return token;
+}
+
+// Synthetic tokens (INDENT, DEDENT, NEWLINE, EOF) have an empty lexeme
+Token Tokenizer::makeEmptyToken(TokenType type) {
+    return Token{type, static_cast<uint32_t>(current), 0, static_cast<uint32_t>(line),
+                 static_cast<uint32_t>(column), Token::NO_LITERAL};
+}
+
+// Token parsing methods
+Token Tokenizer::string() {
+    char quote = peek();
+    advance(); // consume opening quote
+
+    // Jump over plain characters; only quotes, escapes and newlines need a look
+    const char* end = source.data() + source.size();
+    while (true) {
+        advanceRun(scan::findAny(source.data() + current, end, quote, '\\', '\n'));
+        if (isAtEnd() || peek() == quote) break;
+        if (peek() == '\\') {
+            advance(); // consume backslash
+            if (!isAtEnd()) advance(); // consume escaped character
+        } else {
+            advance(); // newline inside the string
         }
     }
-    
-    Token makeToken(TokenType type) {
-        return Token(type, source.substr(start, current - start), line, column - (current - start));
-    }
-    
-    Token makeToken(TokenType type, const std::string& value) {
-        return Token(type, source.substr(start, current - start), value, line, column - (current - start));
-    }
-    
-    Token makeToken(TokenType type, int64_t value) {
-        return Token(type, source.substr(start, current - start), value, line, column - (current - start));
-    }
-    
-    Token makeToken(TokenType type, double value) {
-        return Token(type, source.substr(start, current - start), value, line, column - (current - start));
-    }
-    
-    Token makeToken(TokenType type, bool value) {
-        return Token(type, source.substr(start, current - start), value, line, column - (current - start));
+
+    if (isAtEnd()) {
+        error("Unterminated string");
     }
-    
-    // Token parsing methods
-    Token string() {
-        char quote = peek();
-        advance(); // consume opening quote
-        
-        while (!isAtEnd() && peek() != quote) {
-            if (peek() == '\\') {
-                advance(); // consume backslash
-                if (!isAtEnd()) advance(); // consume escaped character
-            } else {
-                advance();
-            }
-        }
-        
-        if (isAtEnd()) {
-            throw std::runtime_error("Unterminated string at line " + std::to_string(line));
-        }
-        
-        advance(); // consume closing quote
-        
-        std::string value = source.substr(start + 1, current - start - 2);
-        return makeToken(TokenType::STRING, value);
+
+    advance(); // consume closing quote
+
+    // The literal borrows the characters between the quotes
+    std::string_view value = source.substr(start + 1, current - start - 2);
+    return makeToken(TokenType::STRING, value);
+}
+
+Token Tokenizer::number() {
+    while (!isAtEnd() && isDigit(peek())) {
+        advance();
     }
-    
-    Token number() {
-        while (!isAtEnd() && std::isdigit(peek())) {
+
+    // Look for decimal part
+    if (!isAtEnd() && peek() == '.' && isDigit(peekNext())) {
+        advance(); // consume '.'
+
+        while (!isAtEnd() && isDigit(peek())) {
             advance();
         }
-        
-        // Look for decimal part
-        if (!isAtEnd() && peek() == '.' && std::isdigit(peekNext())) {
-            advance(); // consume '.'
-            
-            while (!isAtEnd() && std::isdigit(peek())) {
-                advance();
-            }
-            
-            double value = std::stod(source.substr(start, current - start));
-            return makeToken(TokenType::FLOAT, value);
-        }
-        
-        int64_t value = std::stoll(source.substr(start, current - start));
-        return makeToken(TokenType::INTEGER, value);
+
+        double value = 0.0;
+        std::from_chars(source.data() + start, source.data() + current, value);
+        return makeToken(TokenType::FLOAT, value);
     }
-    
-    Token identifier() {
-        while (!isAtEnd() && (std::isalnum(peek()) || peek() == '_')) {
-            advance();
-        }
-        
-        std::string text = source.substr(start, current - start);
-        
-        // Check if it's a keyword
-        auto it = keywords.find(text);
-        if (it != keywords.end()) {
-            return makeToken(it->second);
-        }
-        
-        // Check for boolean literals
-        if (text == "True") return makeToken(TokenType::BOOLEAN, true);
-        if (text == "False") return makeToken(TokenType::BOOLEAN, false);
-        if (text == "None") return makeToken(TokenType::NONE);
-        
-        return makeToken(TokenType::IDENTIFIER);
+
+    int64_t value = 0;
+    auto result = std::from_chars(source.data() + start, source.data() + current, value);
+    if (result.ec == std::errc::result_out_of_range) {
+        error("Integer literal out of range");
+    }
+    return makeToken(TokenType::INTEGER, value);
+}
+
+Token Tokenizer::identifier() {
+    advanceRun(scan::identifierEnd(source.data() + current, source.data() + source.size()));
+
+    std::string_view text = source.substr(start, current - start);
+
+    TokenType type = lookupKeyword(text);
+    if (type == TokenType::BOOLEAN) {
+        return makeToken(TokenType::BOOLEAN, text[0] == 'T');
     }
-    
-    Token handleIndentation() {
-        size_t indent_level = 0;
-        size_t temp_current = current;
-        
+
+    return makeToken(type);
+}
+
+Token Tokenizer::handleIndentation() {
+    size_t indent_level = 0;
+    size_t temp_current = current;
+
+    while (true) {
+        indent_level = 0;
         while (temp_current < source.length() && source[temp_current] == ' ') {
             indent_level++;
             temp_current++;
         }
-        
-        if (indent_level % 4 != 0) {
-            throw std::runtime_error("Invalid indentation at line " + std::to_string(line));
-        }
-        
-        size_t spaces = indent_level / 4;
-        
-        if (indent_stack.empty() || spaces > indent_stack.back()) {
-            indent_stack.push_back(spaces);
-            return Token(TokenType::INDENT, "", line, column);
-        } else if (spaces < indent_stack.back()) {
-            std::vector<Token> dedent_tokens;
-            while (!indent_stack.empty() && indent_stack.back() > spaces) {
-                indent_stack.pop_back();
-                dedent_tokens.push_back(Token(TokenType::DEDENT, "", line, column));
+
+        // Blank lines do not affect indentation; fold them into this newline
+        if (temp_current < source.length() &&
+            (source[temp_current] == '\n' || source[temp_current] == '\r')) {
+            while (current <= temp_current) {
+                advance();
             }
-            
-            if (indent_stack.empty() || indent_stack.back() != spaces) {
-                throw std::runtime_error("Invalid indentation at line " + std::to_string(line));
+            if (current < source.length() && source[current - 1] == '\r' && source[current] == '\n') {
+                advance();
             }
-            
-            // Return the first dedent token, others will be handled in subsequent calls
-            return dedent_tokens[0];
+            temp_current = current;
+            continue;
         }
-        
-        return Token(TokenType::NEWLINE, "", line, column);
+        break;
     }
 
-public:
-    Tokenizer(const std::string& source) 
-        : source(source), current(0), start(0), line(1), column(0) {
-        indent_stack.push_back(0); // Base indentation level
+    // Comment-only lines keep the current level
+    if (temp_current < source.length() && source[temp_current] == '#') {
+        return makeEmptyToken(TokenType::NEWLINE);
     }
-    
-    Token nextToken() {
-        skipWhitespace();
-        
-        if (isAtEnd()) {
-            return Token(TokenType::EOF_TOKEN, "", line, column);
-        }
-        
-        start = current;
-        
-        char c = advance();
-        
-        // Handle newlines and indentation
-        if (c == '\n') {
-            return handleIndentation();
-        }
-        
-        // Handle comments
-        if (c == '#') {
-            skipComment();
-            return makeToken(TokenType::COMMENT);
-        }
-        
-        // Handle string literals
-        if (c == '"' || c == '\'') {
-            current = start; // Reset to start of string
-            column = column - 1; // Adjust column
-            return string();
-        }
-        
-        // Handle numbers
-        if (std::isdigit(c)) {
-            current = start; // Reset to start of number
-            column = column - 1; // Adjust column
-            return number();
+
+    // Reaching EOF closes every open block
+    if (temp_current >= source.length()) {
+        indent_level = 0;
+    }
+
+    if (indent_level % 4 != 0) {
+        error("Invalid indentation");
+    }
+
+    size_t spaces = indent_level / 4;
+
+    if (indent_stack.empty() || spaces > indent_stack.back()) {
+        indent_stack.push_back(spaces);
+        return makeEmptyToken(TokenType::INDENT);
+    } else if (spaces < indent_stack.back()) {
+        size_t dedents = 0;
+        while (!indent_stack.empty() && indent_stack.back() > spaces) {
+            indent_stack.pop_back();
+            dedents++;
         }
-        
-        // Handle identifiers and keywords
-        if (std::isalpha(c) || c == '_') {
-            current = start; // Reset to start of identifier
-            column = column - 1; // Adjust column
-            return identifier();
+
+        if (indent_stack.empty() || indent_stack.back() != spaces) {
+            error("Invalid indentation");
         }
-        
-        // Handle operators and delimiters
-        switch (c) {
-            case '(': return makeToken(TokenType::LPAREN);
-            case ')': return makeToken(TokenType::RPAREN);
-            case '[': return makeToken(TokenType::LBRACKET);
-            case ']': return makeToken(TokenType::RBRACKET);
-            case '{': return makeToken(TokenType::LBRACE);
-            case '}': return makeToken(TokenType::RBRACE);
-            case ',': return makeToken(TokenType::COMMA);
-            case '.': return makeToken(TokenType::DOT);
-            case ':': return makeToken(TokenType::COLON);
-            case '=': 
-                if (match('=')) return makeToken(TokenType::EQUAL);
-                return makeToken(TokenType::ASSIGN);
-            case '!':
-                if (match('=')) return makeToken(TokenType::NOT_EQUAL);
-                break;
-            case '<':
-                if (match('=')) return makeToken(TokenType::LESS_EQUAL);
-                return makeToken(TokenType::LESS);
-            case '>':
-                if (match('=')) return makeToken(TokenType::GREATER_EQUAL);
-                return makeToken(TokenType::GREATER);
-            case '+': return makeToken(TokenType::PLUS);
-            case '-': return makeToken(TokenType::MINUS);
-            case '*': 
-                if (match('*')) return makeToken(TokenType::POWER);
-                return makeToken(TokenType::MULTIPLY);
-            case '/': 
-                if (match('/')) return makeToken(TokenType::FLOOR_DIVIDE);
-                return makeToken(TokenType::DIVIDE);
-            case '%': return makeToken(TokenType::MODULO);
+
+        // Return the first dedent token, others will be handled in subsequent calls
+        pending_dedents = dedents - 1;
+        return makeEmptyToken(TokenType::DEDENT);
+    }
+
+    return makeEmptyToken(TokenType::NEWLINE);
+}
+
+Token Tokenizer::nextToken() {
+    if (pending_dedents > 0) {
+        pending_dedents--;
+        return makeEmptyToken(TokenType::DEDENT);
+    }
+
+    skipWhitespace();
+
+    if (isAtEnd()) {
+        finished = true;
+        return makeEmptyToken(TokenType::EOF_TOKEN);
+    }
+
+    start = current;
+
+    char c = advance();
+
+    // Handle newlines and indentation; inside brackets a newline is just whitespace
+    if (c == '\n') {
+        if (paren_depth > 0) {
+            return nextToken();
         }
-        
-        throw std::runtime_error("Unexpected character '" + std::string(1, c) + "' at line " + std::to_string(line));
+        return handleIndentation();
+    }
+
+    // Handle comments
+    if (c == '#') {
+        skipComment();
+        return makeToken(TokenType::COMMENT);
+    }
+
+    // Handle string literals
+    if (c == '"' || c == '\'') {
+        current = start; // Reset to start of string
+        column = column - 1; // Adjust column
+        return string();
     }
-    
-    std::vector<Token> tokenize() {
-        std::vector<Token> tokens;
-        Token token;
-        
-        do {
-            token = nextToken();
-            tokens.push_back(token);
-        } while (token.type != TokenType::EOF_TOKEN);
-        
-        return tokens;
+
+    // Handle numbers
+    if (isDigit(c)) {
+        current = start; // Reset to start of number
+        column = column - 1; // Adjust column
+        return number();
+    }
+
+    // Handle identifiers and keywords
+    if (isIdentStart(c)) {
+        current = start; // Reset to start of identifier
+        column = column - 1; // Adjust column
+        return identifier();
     }
-};
-
-// Initialize static keyword map
-const std::unordered_map<std::string, TokenType> Tokenizer::keywords = {
-    {"if", TokenType::IF},
-    {"elif", TokenType::ELIF},
-    {"else", TokenType::ELSE},
-    {"while", TokenType::WHILE},
-    {"for", TokenType::FOR},
-    {"in", TokenType::IN},
-    {"def", TokenType::DEF},
-    {"class", TokenType::CLASS},
-    {"return", TokenType::RETURN},
-    {"import", TokenType::IMPORT},
-    {"as", TokenType::AS},
-    {"match", TokenType::MATCH},
-    {"async", TokenType::ASYNC},
-    {"await", TokenType::AWAIT},
-    {"and", TokenType::AND},
-    {"or", TokenType::OR},
-    {"not", TokenType::NOT}
-};
-
-} // namespace pulse::lexer 
\ No newline at end of file
+
+    // Handle operators and delimiters
+    switch (c) {
+        case '(': paren_depth++; return makeToken(TokenType::LPAREN);
+        case ')': if (paren_depth > 0) paren_depth--; return makeToken(TokenType::RPAREN);
+        case '[': paren_depth++; return makeToken(TokenType::LBRACKET);
+        case ']': if (paren_depth > 0) paren_depth--; return makeToken(TokenType::RBRACKET);
+        case '{': paren_depth++; return makeToken(TokenType::LBRACE);
+        case '}': if (paren_depth > 0) paren_depth--; return makeToken(TokenType::RBRACE);
+        case ',': return makeToken(TokenType::COMMA);
+        case '.': return makeToken(TokenType::DOT);
+        case ':': return makeToken(TokenType::COLON);
+        case '=':
+            if (match('=')) return makeToken(TokenType::EQUAL);
+            return makeToken(TokenType::ASSIGN);
+        case '!':
+            if (match('=')) return makeToken(TokenType::NOT_EQUAL);
+            break;
+        case '<':
+            if (match('=')) return makeToken(TokenType::LESS_EQUAL);
+            return makeToken(TokenType::LESS);
+        case '>':
+            if (match('=')) return makeToken(TokenType::GREATER_EQUAL);
+            return makeToken(TokenType::GREATER);
+        case '+': return makeToken(TokenType::PLUS);
+        case '-': return makeToken(TokenType::MINUS);
+        case '*':
+            if (match('*')) return makeToken(TokenType::POWER);
+            return makeToken(TokenType::MULTIPLY);
+        case '/':
+            if (match('/')) return makeToken(TokenType::FLOOR_DIVIDE);
+            return makeToken(TokenType::DIVIDE);
+        case '%': return makeToken(TokenType::MODULO);
+    }
+
+    error("Unexpected character '" + std::string(1, c) + "'");
+}
+
+size_t Tokenizer::tokenizeChunk(std::vector<Token>& out, size_t max_tokens) {
+    size_t count = 0;
+    while (!finished && count < max_tokens) {
+        out.push_back(nextToken());
+        count++;
+    }
+    return count;
+}
+
+TokenStream Tokenizer::tokenize() {
+    std::vector<Token> tokens;
+    // Most tokens are a handful of bytes; reserve to avoid regrowth on large inputs
+    tokens.reserve(source.size() / 4 + 1);
+    Token token;
+
+    do {
+        token = nextToken();
+        tokens.push_back(token);
+    } while (token.type != TokenType::EOF_TOKEN);
+
+    return TokenStream(buffer, std::move(tokens), std::move(literals));
+}
+
+std::string_view Tokenizer::lexeme(const Token& token) const {
+    return source.substr(token.offset, token.length);
+}
+
+const LiteralValue* Tokenizer::literal(const Token& token) const {
+    return token.hasLiteral() ? &literals[token.literal] : nullptr;
+}
+
+} // namespace pulse::lexer
@@ -1,49 +1,151 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
+#include <filesystem>
+#include <map>
+#include <stdexcept>
 #include <string>
+#include <vector>
+#include "compiler/compiler.hpp"
+#include "compiler/jit.hpp"
+#include "compiler/tiered_jit.hpp"
+#include "driver/frontend.hpp"
+#include "driver/module_interface.hpp"
+#include "driver/thread_pool.hpp"
+#include "driver/time_report.hpp"
+#include "lexer/source_buffer.hpp"
 #include "lexer/tokenizer.hpp"
 #include "parser/parser.hpp"
+#include "runtime/bytecode.hpp"
+#include "runtime/heap.hpp"
+#include "runtime/profiler.hpp"
+#include "runtime/runtime.hpp"
+#include "runtime/vm.hpp"
 
-void printTokens(const std::vector<pulse::lexer::Token>& tokens) {
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+void printTokens(const pulse::lexer::TokenStream& tokens) {
     std::cout << "=== Tokens ===" << std::endl;
     for (const auto& token : tokens) {
         std::cout << "Type: " << static_cast<int>(token.type) 
-                  << ", Lexeme: '" << token.lexeme << "'"
+                  << ", Lexeme: '" << tokens.lexeme(token) << "'"
                   << ", Line: " << token.line 
                   << ", Column: " << token.column << std::endl;
     }
     std::cout << "=============" << std::endl;
 }
 
-void printAST(pulse::parser::ASTNode* node, int depth = 0) {
-    std::string indent(depth * 2, ' ');
+// Prints the tree through ASTVisitor; each node is dispatched by its accept()
+class ASTPrinter : public pulse::parser::ASTVisitor {
+public:
+    void print(pulse::parser::ASTNode* node, int depth = 0) {
+        if (!node) return;
+        int saved = this->depth;
+        this->depth = depth;
+        node->accept(*this);
+        this->depth = saved;
+    }
     
-    if (auto program = dynamic_cast<pulse::parser::Program*>(node)) {
-        std::cout << indent << "Program:" << std::endl;
+    void visitProgram(pulse::parser::Program* program) override {
+        std::cout << indent() << "Program:" << std::endl;
         for (const auto& decl : program->declarations) {
-            printAST(decl.get(), depth + 1);
+            print(decl.get(), depth + 1);
         }
         for (const auto& stmt : program->statements) {
-            printAST(stmt.get(), depth + 1);
+            print(stmt.get(), depth + 1);
         }
-    } else if (auto func = dynamic_cast<pulse::parser::FunctionDeclaration*>(node)) {
-        std::cout << indent << "Function: " << func->name << std::endl;
+    }
+    
+    void visitFunctionDeclaration(pulse::parser::FunctionDeclaration* func) override {
+        std::cout << indent() << "Function: " << func->name << std::endl;
         for (const auto& param : func->parameters) {
-            std::cout << indent << "  Param: " << param << std::endl;
-        }
-        for (const auto& stmt : func->body) {
-            printAST(stmt.get(), depth + 1);
-        }
-    } else if (auto assign = dynamic_cast<pulse::parser::AssignmentStatement*>(node)) {
-        std::cout << indent << "Assignment: " << assign->name << std::endl;
-        printAST(assign->value.get(), depth + 1);
-    } else if (auto expr = dynamic_cast<pulse::parser::ExpressionStatement*>(node)) {
-        std::cout << indent << "Expression:" << std::endl;
-        printAST(expr->expression.get(), depth + 1);
-    } else if (auto literal = dynamic_cast<pulse::parser::LiteralExpression*>(node)) {
-        std::cout << indent << "Literal: ";
-        if (std::holds_alternative<std::string>(literal->value)) {
-            std::cout << "'" << std::get<std::string>(literal->value) << "'";
+            std::cout << indent() << "  Param: " << param << std::endl;
+        }
+        printBody(func->body, depth + 1);
+    }
+    
+    void visitClassDeclaration(pulse::parser::ClassDeclaration* cls) override {
+        std::cout << indent() << "Class: " << cls->name;
+        if (!cls->base_class.empty()) {
+            std::cout << " (" << cls->base_class << ")";
+        }
+        std::cout << std::endl;
+        for (const auto& member : cls->members) {
+            print(member.get(), depth + 1);
+        }
+    }
+    
+    void visitImportDeclaration(pulse::parser::ImportDeclaration* import) override {
+        std::cout << indent() << "Import: " << import->module;
+        if (!import->alias.empty()) {
+            std::cout << " as " << import->alias;
+        }
+        std::cout << std::endl;
+    }
+    
+    void visitAssignmentStatement(pulse::parser::AssignmentStatement* assign) override {
+        std::cout << indent() << "Assignment: " << assign->name << std::endl;
+        print(assign->value.get(), depth + 1);
+    }
+    
+    void visitExpressionStatement(pulse::parser::ExpressionStatement* expr) override {
+        std::cout << indent() << "Expression:" << std::endl;
+        print(expr->expression.get(), depth + 1);
+    }
+    
+    void visitReturnStatement(pulse::parser::ReturnStatement* ret) override {
+        std::cout << indent() << "Return:" << std::endl;
+        print(ret->value.get(), depth + 1);
+    }
+    
+    void visitIfStatement(pulse::parser::IfStatement* if_stmt) override {
+        std::cout << indent() << "If Statement:" << std::endl;
+        for (const auto& branch : if_stmt->branches) {
+            std::cout << indent() << "  Condition:" << std::endl;
+            print(branch.condition.get(), depth + 2);
+            std::cout << indent() << "  Body:" << std::endl;
+            printBody(branch.body, depth + 2);
+        }
+        if (!if_stmt->else_body.empty()) {
+            std::cout << indent() << "  Else:" << std::endl;
+            printBody(if_stmt->else_body, depth + 2);
+        }
+    }
+    
+    void visitWhileStatement(pulse::parser::WhileStatement* while_stmt) override {
+        std::cout << indent() << "While Statement:" << std::endl;
+        std::cout << indent() << "  Condition:" << std::endl;
+        print(while_stmt->condition.get(), depth + 2);
+        std::cout << indent() << "  Body:" << std::endl;
+        printBody(while_stmt->body, depth + 2);
+    }
+    
+    void visitForStatement(pulse::parser::ForStatement* for_stmt) override {
+        std::cout << indent() << "For Statement: " << for_stmt->variable << std::endl;
+        std::cout << indent() << "  Iterable:" << std::endl;
+        print(for_stmt->iterable.get(), depth + 2);
+        std::cout << indent() << "  Body:" << std::endl;
+        printBody(for_stmt->body, depth + 2);
+    }
+    
+    void visitMatchStatement(pulse::parser::MatchStatement* match) override {
+        std::cout << indent() << "Match Statement:" << std::endl;
+        print(match->value.get(), depth + 1);
+        for (const auto& [pattern, body] : match->cases) {
+            std::cout << indent() << "  Case:" << std::endl;
+            print(pattern.get(), depth + 2);
+            printBody(body, depth + 2);
+        }
+    }
+    
+    void visitLiteralExpression(pulse::parser::LiteralExpression* literal) override {
+        std::cout << indent() << "Literal: ";
+        if (std::holds_alternative<std::string_view>(literal->value)) {
+            std::cout << "'" << std::get<std::string_view>(literal->value) << "'";
         } else if (std::holds_alternative<int64_t>(literal->value)) {
             std::cout << std::get<int64_t>(literal->value);
         } else if (std::holds_alternative<double>(literal->value)) {
@@ -54,60 +156,652 @@ void printAST(pulse::parser::ASTNode* node, int depth = 0) {
             std::cout << "None";
         }
         std::cout << std::endl;
-    } else if (auto id = dynamic_cast<pulse::parser::IdentifierExpression*>(node)) {
-        std::cout << indent << "Identifier: " << id->name << std::endl;
-    } else if (auto binary = dynamic_cast<pulse::parser::BinaryExpression*>(node)) {
-        std::cout << indent << "Binary Op: " << static_cast<int>(binary->op) << std::endl;
-        printAST(binary->left.get(), depth + 1);
-        printAST(binary->right.get(), depth + 1);
-    } else if (auto call = dynamic_cast<pulse::parser::CallExpression*>(node)) {
-        std::cout << indent << "Function Call:" << std::endl;
-        printAST(call->callee.get(), depth + 1);
+    }
+    
+    void visitIdentifierExpression(pulse::parser::IdentifierExpression* id) override {
+        std::cout << indent() << "Identifier: " << id->name << std::endl;
+    }
+    
+    void visitBinaryExpression(pulse::parser::BinaryExpression* binary) override {
+        std::cout << indent() << "Binary Op: " << static_cast<int>(binary->op) << std::endl;
+        print(binary->left.get(), depth + 1);
+        print(binary->right.get(), depth + 1);
+    }
+    
+    void visitUnaryExpression(pulse::parser::UnaryExpression* unary) override {
+        std::cout << indent() << "Unary Op: " << static_cast<int>(unary->op) << std::endl;
+        print(unary->operand.get(), depth + 1);
+    }
+    
+    void visitCallExpression(pulse::parser::CallExpression* call) override {
+        std::cout << indent() << "Function Call:" << std::endl;
+        print(call->callee.get(), depth + 1);
         for (const auto& arg : call->arguments) {
-            printAST(arg.get(), depth + 1);
+            print(arg.get(), depth + 1);
         }
-    } else if (auto if_stmt = dynamic_cast<pulse::parser::IfStatement*>(node)) {
-        std::cout << indent << "If Statement:" << std::endl;
-        for (const auto& branch : if_stmt->branches) {
-            std::cout << indent << "  Condition:" << std::endl;
-            printAST(branch.condition.get(), depth + 2);
-            std::cout << indent << "  Body:" << std::endl;
-            for (const auto& stmt : branch.body) {
-                printAST(stmt.get(), depth + 2);
+    }
+    
+    void visitAttributeExpression(pulse::parser::AttributeExpression* attr) override {
+        std::cout << indent() << "Attribute: " << attr->attribute << std::endl;
+        print(attr->object.get(), depth + 1);
+    }
+    
+    void visitSubscriptExpression(pulse::parser::SubscriptExpression* subscript) override {
+        std::cout << indent() << "Subscript:" << std::endl;
+        print(subscript->object.get(), depth + 1);
+        print(subscript->index.get(), depth + 1);
+    }
+    
+    void visitListExpression(pulse::parser::ListExpression* list) override {
+        std::cout << indent() << "List:" << std::endl;
+        for (const auto& element : list->elements) {
+            print(element.get(), depth + 1);
+        }
+    }
+    
+    void visitDictExpression(pulse::parser::DictExpression* dict) override {
+        std::cout << indent() << "Dict:" << std::endl;
+        for (const auto& pair : dict->pairs) {
+            print(pair.key.get(), depth + 1);
+            print(pair.value.get(), depth + 2);
+        }
+    }
+    
+    void visitTupleExpression(pulse::parser::TupleExpression* tuple) override {
+        std::cout << indent() << "Tuple:" << std::endl;
+        for (const auto& element : tuple->elements) {
+            print(element.get(), depth + 1);
+        }
+    }
+    
+private:
+    int depth = 0;
+    
+    std::string indent() const { return std::string(depth * 2, ' '); }
+    
+    void printBody(const pulse::parser::ArenaVector<pulse::parser::StatementPtr>& body, int bodyDepth) {
+        for (const auto& stmt : body) {
+            print(stmt.get(), bodyDepth);
+        }
+    }
+};
+
+void printAST(pulse::parser::ASTNode* node) {
+    ASTPrinter printer;
+    printer.print(node);
+}
+
+struct DriverOptions {
+    size_t jobs = 0;
+    std::vector<std::string> inputs;
+    std::string output;
+    bool emitLLVM = false;
+    bool run = false;
+    bool repl = false;
+    bool interpret = false;
+    bool dumpBytecode = false;
+    bool dumpTokens = false;
+    bool dumpAST = false;
+    std::string timeReport; // "text" or "json" on stderr; empty for none
+    std::string timeReportFile;
+    bool tier = true;
+    bool traceTier = false;
+    bool heapStats = false;
+    bool profile = false;
+    std::string profileOutput = "pulse";
+    unsigned profileRate = pulse::runtime::Profiler::DEFAULT_RATE;
+    bool profileCalls = false;
+    unsigned perf = pulse::compiler::PERF_NONE;
+    pulse::compiler::CompileOptions compile;
+
+    bool codegen() const { return emitLLVM || !output.empty(); }
+};
+
+void printUsage() {
+    std::cout << "Usage: pulse [options] [file.pul | directory ...]" << std::endl;
+    std::cout << "       pulse run [options] file.pul | directory" << std::endl;
+    std::cout << "       pulse repl" << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  -j, --jobs N         Lex, parse and compile with N threads (default: all cores)" << std::endl;
+    std::cout << "  -O0 .. -O3           Optimization level (default: -O2)" << std::endl;
+    std::cout << "  --opt-level N        Same as -ON" << std::endl;
+    std::cout << "  -march=CPU           Generate code for CPU (native: the host CPU)" << std::endl;
+    std::cout << "  --target TRIPLE      Target triple (default: host)" << std::endl;
+    std::cout << "  --thin-lto           ThinLTO pre-link pipeline; emit bitcode with a summary" << std::endl;
+    std::cout << "  --entry NAME         Function for top-level code (default: main)" << std::endl;
+    std::cout << "  --emit-llvm          Print the optimized LLVM IR" << std::endl;
+    std::cout << "  -o PATH              Write .ll/.bc/object output (a directory for several files)" << std::endl;
+    std::cout << "  --interpret          pulse run: execute on the bytecode VM instead of the JIT" << std::endl;
+    std::cout << "  --dump-bytecode      pulse run --interpret: print the bytecode before running" << std::endl;
+    std::cout << "  --dump-tokens        Print the tokens of one file (default: a built-in example)" << std::endl;
+    std::cout << "  --dump-ast           Print the syntax tree of one file" << std::endl;
+    std::cout << "  --time-report[=json] Print time, allocations and peak memory per phase on stderr" << std::endl;
+    std::cout << "  --time-report-file P Write the time report to P as JSON" << std::endl;
+    std::cout << "  --no-tier            VM: never move hot functions to native code" << std::endl;
+    std::cout << "  --trace-tier         VM: report functions moved to native code on stderr" << std::endl;
+    std::cout << "  --heap-stats         VM: print allocation and cycle collection statistics on exit" << std::endl;
+    std::cout << "  --profile            pulse run: sample the VM's call stack; write pulse.folded and pulse.pprof" << std::endl;
+    std::cout << "  --profile-output P   Write the profile to P.folded and P.pprof" << std::endl;
+    std::cout << "  --profile-rate HZ    Samples per second (default: 997)" << std::endl;
+    std::cout << "  --profile-calls      pulse run: print exact calls and time per function on exit" << std::endl;
+    std::cout << "  --perf-map           JIT: list generated functions in /tmp/perf-PID.map for perf" << std::endl;
+    std::cout << "  --jitdump            JIT: write a jitdump for perf inject --jit" << std::endl;
+    std::cout << "  --version            Show the version and the code generator's target" << std::endl;
+    std::cout << "  -h, --help           Show this help" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Without -o or --emit-llvm files and project directories are parsed in" << std::endl;
+    std::cout << "parallel with diagnostics reported in input order; --dump-tokens and" << std::endl;
+    std::cout << "--dump-ast print one file's tokens and syntax tree instead." << std::endl;
+    std::cout << std::endl;
+    std::cout << "pulse run compiles in memory and executes the program through the JIT;" << std::endl;
+    std::cout << "its exit status is the program's. Code is generated for the host CPU" << std::endl;
+    std::cout << "unless -march is given. With --interpret (or in a build without LLVM)" << std::endl;
+    std::cout << "a single file runs on the bytecode VM instead, which starts instantly." << std::endl;
+    std::cout << "--profile and --profile-calls also run on the VM; hot functions that moved" << std::endl;
+    std::cout << "to native code appear as 'f [native]'." << std::endl;
+    std::cout << std::endl;
+    std::cout << "pulse repl reads statements interactively and runs them on the VM." << std::endl;
+    std::cout << "On the VM, hot numeric functions are compiled in the background and" << std::endl;
+    std::cout << "calls whose argument types match switch to the native code." << std::endl;
+}
+
+void printVersion() {
+    std::cout << "pulse " << PULSE_VERSION << std::endl;
+#ifdef PULSE_HAVE_LLVM
+    std::cout << pulse::compiler::Compiler::backendVersion() << std::endl;
+#endif
+}
+
+unsigned parseOptLevel(const std::string& value) {
+    if (value.size() != 1 || value[0] < '0' || value[0] > '3') {
+        throw std::invalid_argument("Invalid optimization level '" + value + "' (expected 0-3)");
+    }
+    return static_cast<unsigned>(value[0] - '0');
+}
+
+DriverOptions parseArguments(int argc, char* argv[]) {
+    DriverOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + arg);
             }
+            return argv[++i];
+        };
+
+        if (i == 1 && arg == "run") {
+            options.run = true;
+        } else if (i == 1 && arg == "repl") {
+            options.repl = true;
+        } else if (arg == "--interpret") {
+            options.interpret = true;
+        } else if (arg == "--dump-bytecode") {
+            options.dumpBytecode = true;
+        } else if (arg == "--dump-tokens") {
+            options.dumpTokens = true;
+        } else if (arg == "--dump-ast") {
+            options.dumpAST = true;
+        } else if (arg == "--time-report" || arg == "--time-report=text") {
+            options.timeReport = "text";
+        } else if (arg == "--time-report=json") {
+            options.timeReport = "json";
+        } else if (arg == "--time-report-file") {
+            options.timeReportFile = value();
+        } else if (arg == "--no-tier") {
+            options.tier = false;
+        } else if (arg == "--trace-tier") {
+            options.traceTier = true;
+        } else if (arg == "--heap-stats") {
+            options.heapStats = true;
+        } else if (arg == "--profile") {
+            options.profile = true;
+        } else if (arg == "--profile-output") {
+            options.profile = true;
+            options.profileOutput = value();
+        } else if (arg == "--profile-rate") {
+            options.profileRate = static_cast<unsigned>(std::max(1, std::atoi(value().c_str())));
+        } else if (arg == "--profile-calls") {
+            options.profileCalls = true;
+        } else if (arg == "--perf-map") {
+            options.perf |= pulse::compiler::PERF_MAP;
+        } else if (arg == "--jitdump") {
+            options.perf |= pulse::compiler::PERF_JITDUMP;
+        } else if (arg == "-j" || arg == "--jobs") {
+            options.jobs = static_cast<size_t>(std::max(1, std::atoi(value().c_str())));
+        } else if (arg.rfind("-j", 0) == 0 && arg.size() > 2) {
+            options.jobs = static_cast<size_t>(std::max(1, std::atoi(arg.c_str() + 2)));
+        } else if (arg.rfind("-O", 0) == 0 && arg.size() == 3) {
+            options.compile.optLevel = parseOptLevel(arg.substr(2));
+        } else if (arg == "--opt-level") {
+            options.compile.optLevel = parseOptLevel(value());
+        } else if (arg.rfind("--opt-level=", 0) == 0) {
+            options.compile.optLevel = parseOptLevel(arg.substr(12));
+        } else if (arg.rfind("-march=", 0) == 0) {
+            options.compile.targetCPU = arg.substr(7);
+        } else if (arg == "-march" || arg == "--march") {
+            options.compile.targetCPU = value();
+        } else if (arg == "--target") {
+            options.compile.targetTriple = value();
+        } else if (arg == "--thin-lto") {
+            options.compile.thinLTOPreLink = true;
+        } else if (arg == "--entry") {
+            options.compile.entryPoint = value();
+        } else if (arg == "--emit-llvm") {
+            options.emitLLVM = true;
+        } else if (arg == "-o") {
+            options.output = value();
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage();
+            std::exit(0);
+        } else if (arg == "--version") {
+            printVersion();
+            std::exit(0);
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            throw std::invalid_argument("Unknown option: " + arg);
+        } else {
+            options.inputs.push_back(arg);
         }
-        if (!if_stmt->else_body.empty()) {
-            std::cout << indent << "  Else:" << std::endl;
-            for (const auto& stmt : if_stmt->else_body) {
-                printAST(stmt.get(), depth + 2);
+    }
+
+    return options;
+}
+
+// Top-level code of the module named "main" becomes the program entry point;
+// other modules get an init function so that their objects link together
+std::string moduleEntryPoint(const std::string& path) {
+    std::string stem = std::filesystem::path(path).stem().string();
+    return stem == "main" ? "main" : "__pulse_init_" + stem;
+}
+
+// The units of this run by absolute path, so that a module imported from a
+// file compiled alongside it is not parsed a second time
+using ParsedUnits = std::map<std::string, const pulse::parser::Program*>;
+
+ParsedUnits indexUnits(const std::vector<pulse::driver::CompilationUnit>& units) {
+    ParsedUnits parsed;
+    for (const auto& unit : units) {
+        if (unit.ok() && unit.path != "-") {
+            parsed[std::filesystem::absolute(unit.path).lexically_normal().string()] = unit.program.get();
+        }
+    }
+    return parsed;
+}
+
+// Interfaces of the modules that program, read from path, imports and that
+// have a source on the search path; the others (std.io, time) belong to the
+// runtime. Throws std::runtime_error if an imported module does not parse.
+std::vector<std::shared_ptr<const pulse::driver::InterfaceFile>> loadImports(
+        const pulse::parser::Program& program, const std::string& path, pulse::driver::InterfaceCache& interfaces,
+        const ParsedUnits& parsed) {
+    std::vector<std::shared_ptr<const pulse::driver::InterfaceFile>> imports;
+    std::filesystem::path importer = path == "-" ? std::filesystem::current_path() / "-" : std::filesystem::path(path);
+    for (const auto& decl : program.declarations) {
+        auto import = pulse::parser::dyn_cast<pulse::parser::ImportDeclaration>(decl.get());
+        if (!import) continue;
+        std::filesystem::path source = pulse::driver::findModule(import->module, importer);
+        if (source.empty()) continue;
+        pulse::driver::TimeReport::Scope phase("interfaces");
+        std::string key = std::filesystem::absolute(source).lexically_normal().string();
+        auto unit = parsed.find(key);
+        try {
+            imports.push_back(interfaces.load(import->module, source, unit != parsed.end() ? unit->second : nullptr));
+        } catch (const std::exception& e) {
+            throw std::runtime_error("import " + std::string(import->module) + ": " + e.what());
+        }
+    }
+    return imports;
+}
+
+#ifdef PULSE_HAVE_LLVM
+// Compile one parsed unit; returns an empty string on success, else the error
+std::string compileUnit(pulse::driver::CompilationUnit& unit, const pulse::compiler::CompileOptions& options,
+                        const std::string& output, bool printIR, pulse::driver::InterfaceCache& interfaces,
+                        const ParsedUnits& parsed) {
+    pulse::compiler::Compiler compiler(options);
+    try {
+        for (auto& import : loadImports(*unit.program, unit.path, interfaces, parsed)) {
+            compiler.addImport(std::move(import));
+        }
+    } catch (const std::exception& e) {
+        return e.what();
+    }
+    if (!compiler.compile(unit.program.get(), output)) {
+        return compiler.getError();
+    }
+    if (printIR) {
+        std::cout << compiler.getIRString();
+    }
+    return "";
+}
+#endif
+
+// Parse many files in parallel, optionally compile each one to its own output
+// in options.output, and report diagnostics in a stable order
+int buildProject(const DriverOptions& options) {
+    auto files = pulse::driver::collectSources(options.inputs);
+    if (files.empty()) {
+        std::cerr << "Error: no .pul files found" << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto units = pulse::driver::parseFiles(files, options.jobs);
+    pulse::driver::InterfaceCache interfaces;
+
+    if (options.codegen()) {
+#ifdef PULSE_HAVE_LLVM
+        if (options.output.empty()) {
+            throw std::invalid_argument("-o DIRECTORY is required when compiling several files");
+        }
+        std::filesystem::create_directories(options.output);
+
+        // One object (or ThinLTO bitcode) per module, named after the file;
+        // the module called "main" holds the program entry point
+        std::vector<std::string> outputs(units.size());
+        std::map<std::string, std::string> modules;
+        for (size_t i = 0; i < units.size(); i++) {
+            std::string stem = std::filesystem::path(units[i].path).stem().string();
+            auto [it, inserted] = modules.emplace(stem, units[i].path);
+            if (!inserted) {
+                throw std::invalid_argument("Duplicate module name '" + stem + "': " + it->second +
+                                            " and " + units[i].path);
             }
+            std::string extension = options.compile.thinLTOPreLink ? ".bc" : ".o";
+            outputs[i] = (std::filesystem::path(options.output) / (stem + extension)).string();
+        }
+
+        ParsedUnits parsed = indexUnits(units);
+        pulse::driver::ThreadPool pool(std::min(options.jobs == 0 ? pulse::driver::ThreadPool::defaultThreadCount()
+                                                                  : options.jobs, units.size()));
+        for (size_t i = 0; i < units.size(); i++) {
+            if (!units[i].ok()) continue;
+            pool.submit([&, i] {
+                auto& unit = units[i];
+                pulse::compiler::CompileOptions compileOptions = options.compile;
+                compileOptions.entryPoint = moduleEntryPoint(unit.path);
+                std::string error = compileUnit(unit, compileOptions, outputs[i], false, interfaces, parsed);
+                if (!error.empty()) {
+                    unit.diagnostics.push_back({unit.path, 0, 0, error});
+                }
+            });
         }
-    } else {
-        std::cout << indent << "Unknown Node Type" << std::endl;
+        pool.wait();
+#else
+        throw std::runtime_error("pulse was built without LLVM; code generation is unavailable");
+#endif
     }
+
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+    size_t tokens = 0;
+    size_t succeeded = 0;
+    for (const auto& unit : units) {
+        tokens += unit.tokens.size();
+        if (unit.ok()) succeeded++;
+    }
+
+    auto diagnostics = pulse::driver::collectDiagnostics(units);
+    for (const auto& diagnostic : diagnostics) {
+        std::cerr << diagnostic << std::endl;
+    }
+
+    size_t threads = options.jobs == 0 ? pulse::driver::ThreadPool::defaultThreadCount() : options.jobs;
+    std::cout << (options.codegen() ? "Compiled " : "Parsed ") << succeeded << "/" << units.size()
+              << " files (" << tokens << " tokens) in " << elapsed.count() << " ms using "
+              << std::min(threads, units.size()) << " thread(s)";
+    if (interfaces.hits() + interfaces.misses() > 0) {
+        std::cout << "; " << interfaces.hits() + interfaces.misses() << " imported module(s), "
+                  << interfaces.hits() << " from .pulc";
+    }
+    std::cout << std::endl;
+
+    return diagnostics.empty() ? 0 : 1;
 }
 
-std::string readFile(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        throw std::runtime_error("Could not open file: " + filename);
+// Single file with -o/--emit-llvm: no dumps, just the compiler output
+int compileFile(const DriverOptions& options) {
+    auto units = pulse::driver::parseFiles(options.inputs, 1);
+    auto& unit = units.front();
+    for (const auto& diagnostic : unit.diagnostics) {
+        std::cerr << diagnostic << std::endl;
     }
-    
-    std::string content((std::istreambuf_iterator<char>(file)),
-                        std::istreambuf_iterator<char>());
-    return content;
+    if (!unit.ok()) {
+        return 1;
+    }
+
+#ifdef PULSE_HAVE_LLVM
+    pulse::driver::InterfaceCache interfaces;
+    std::string error = compileUnit(unit, options.compile, options.output, options.emitLLVM, interfaces, {});
+    if (!error.empty()) {
+        std::cerr << unit.path << ": error: " << error << std::endl;
+        return 1;
+    }
+    return 0;
+#else
+    throw std::runtime_error("pulse was built without LLVM; code generation is unavailable");
+#endif
 }
 
-int main(int argc, char* argv[]) {
+// Tiered execution on the VM; the JIT only starts once a function gets hot
+void installNativeTier(pulse::runtime::Runtime& runtime, const DriverOptions& options) {
+#ifdef PULSE_HAVE_LLVM
+    if (options.tier) {
+        runtime.setNativeTier(std::make_unique<pulse::compiler::TieredJIT>(options.compile.optLevel, options.traceTier,
+                                                                           options.perf));
+    }
+#else
+    (void)runtime;
+    (void)options;
+#endif
+}
+
+// --heap-stats: the VM's allocation and collection counters, on stderr
+void reportHeap(const DriverOptions& options) {
+    if (options.heapStats) {
+        std::cout.flush();
+        std::cerr << pulse::runtime::Heap::current().report();
+    }
+}
+
+// --profile and --profile-calls: write the samples, print the counts. The
+// functions they name must still be alive.
+void reportProfile(const DriverOptions& options, pulse::runtime::Runtime& runtime,
+                   pulse::runtime::Profiler* profiler, const std::string& path) {
+    std::cout.flush();
+    if (profiler) {
+        profiler->stop();
+        std::string folded = options.profileOutput + ".folded";
+        std::string pprof = options.profileOutput + ".pprof";
+        std::ofstream(folded, std::ios::binary) << profiler->folded();
+        std::ofstream(pprof, std::ios::binary) << profiler->pprof(path);
+        std::cerr << "profile: " << profiler->getSamples() << " samples at " << profiler->getRate() << " Hz";
+        if (profiler->getDropped() > 0) std::cerr << " (" << profiler->getDropped() << " dropped)";
+        std::cerr << "; wrote " << folded << " and " << pprof << std::endl;
+    }
+    if (options.profileCalls) {
+        std::cerr << pulse::runtime::callReport(runtime.getVM());
+    }
+}
+
+// pulse run --interpret: one file on the bytecode VM, with no LLVM startup
+int interpretProgram(const DriverOptions& options) {
+    const std::string& path = options.inputs[0];
+    if (path != "-" && std::filesystem::is_directory(path)) {
+        throw std::invalid_argument("the interpreter runs single files; use pulse run without --interpret for " + path);
+    }
+
+    auto source = pulse::lexer::SourceBuffer::fromFile(path);
+    pulse::runtime::Runtime runtime;
+    runtime.initialize();
+    installNativeTier(runtime, options);
+    std::unique_ptr<pulse::runtime::Profiler> profiler;
+    std::shared_ptr<pulse::runtime::FunctionProto> chunk;
+    int status = 0;
     try {
-        std::string source;
-        
-        if (argc > 1) {
-            // Read from file
-            source = readFile(argv[1]);
+        pulse::driver::TimeReport::Scope phase("bytecode");
+        chunk = runtime.compile(std::string(source->text()));
+    } catch (const std::exception& e) {
+        // Reported as pulse run reports them
+        std::cerr << pulse::driver::diagnose(path, e) << std::endl;
+        reportHeap(options);
+        return 1;
+    }
+    try {
+        if (options.dumpBytecode) {
+            std::cout << pulse::runtime::disassemble(*chunk) << std::endl;
+        }
+        runtime.getVM().setCountCalls(options.profileCalls);
+        if (options.profile) {
+            profiler = std::make_unique<pulse::runtime::Profiler>(runtime.getVM(), options.profileRate);
+            profiler->start();
+        }
+        pulse::driver::TimeReport::Scope phase("run");
+        runtime.run(chunk);
+    } catch (const std::exception& e) {
+        std::cout.flush();
+        std::cerr << path << ": " << e.what() << std::endl;
+        status = 1;
+    }
+    reportProfile(options, runtime, profiler.get(), path);
+    reportHeap(options);
+    return status;
+}
+
+// pulse repl: each input runs as a chunk against globals that persist; an
+// input opening a block (a line ending in ':') continues until a blank line
+int runRepl(const DriverOptions& options) {
+#ifndef _WIN32
+    bool interactive = isatty(STDIN_FILENO);
+#else
+    bool interactive = true;
+#endif
+    pulse::runtime::Runtime runtime;
+    runtime.initialize();
+    installNativeTier(runtime, options);
+
+    std::string chunk;
+    std::string line;
+    while (true) {
+        if (interactive) {
+            std::cout << (chunk.empty() ? ">>> " : "... ") << std::flush;
+        }
+        if (!std::getline(std::cin, line)) {
+            if (chunk.empty()) break;
+            line.clear();
+        }
+
+        size_t end = line.find_last_not_of(" \t\r");
+        bool opensBlock = end != std::string::npos && line[end] == ':';
+        bool blank = end == std::string::npos;
+        if (!chunk.empty() || opensBlock) {
+            chunk += line + "\n";
+            if (!blank) continue;
+        } else if (blank) {
+            continue;
+        } else {
+            chunk = line + "\n";
+        }
+
+        try {
+            pulse::runtime::Value result = runtime.execute(chunk);
+            if (!result.isNone()) {
+                std::cout << result.repr() << std::endl;
+            }
+        } catch (const std::exception& e) {
+            std::cout.flush();
+            std::cerr << e.what() << std::endl;
+        }
+        chunk.clear();
+        if (std::cin.eof()) break;
+    }
+    if (interactive) {
+        std::cout << std::endl;
+    }
+    reportHeap(options);
+    return 0;
+}
+
+// pulse run: compile in memory and execute through the JIT, with no object
+// files, no system linker and no second process
+int runProgram(const DriverOptions& options) {
+    if (options.inputs.size() != 1) {
+        throw std::invalid_argument("pulse run expects one file or project directory");
+    }
+    if (options.codegen() || options.compile.thinLTOPreLink) {
+        throw std::invalid_argument("pulse run does not write output (-o, --emit-llvm, --thin-lto)");
+    }
+    if (options.interpret || options.dumpBytecode || options.profile || options.profileCalls) {
+        return interpretProgram(options);
+    }
+
+#ifdef PULSE_HAVE_LLVM
+    bool project = options.inputs[0] != "-" && std::filesystem::is_directory(options.inputs[0]);
+    auto files = pulse::driver::collectSources(options.inputs);
+    if (files.empty()) {
+        std::cerr << "Error: no .pul files found" << std::endl;
+        return 1;
+    }
+
+    auto units = pulse::driver::parseFiles(files, options.jobs);
+    auto diagnostics = pulse::driver::collectDiagnostics(units);
+    for (const auto& diagnostic : diagnostics) {
+        std::cerr << diagnostic << std::endl;
+    }
+    if (!diagnostics.empty()) {
+        return 1;
+    }
+
+    // The code never leaves this machine, so tune for it
+    pulse::compiler::CompileOptions compileOptions = options.compile;
+    if (compileOptions.targetCPU.empty()) {
+        compileOptions.targetCPU = "native";
+    }
+
+    // A lone file is the program whatever its name; in a project the module
+    // called main is, and the others are linked in for it to call
+    pulse::compiler::JIT jit(compileOptions.optLevel, options.perf);
+    pulse::driver::InterfaceCache interfaces;
+    ParsedUnits parsed = indexUnits(units);
+    bool hasMain = false;
+    for (auto& unit : units) {
+        compileOptions.entryPoint = project ? moduleEntryPoint(unit.path) : "main";
+        hasMain |= compileOptions.entryPoint == "main";
+
+        pulse::compiler::Compiler compiler(compileOptions);
+        for (auto& import : loadImports(*unit.program, unit.path, interfaces, parsed)) {
+            compiler.addImport(std::move(import));
+        }
+        if (!compiler.compile(unit.program.get())) {
+            std::cerr << unit.path << ": error: " << compiler.getError() << std::endl;
+            return 1;
+        }
+        jit.addModule(compiler);
+    }
+    if (!hasMain) {
+        std::cerr << "Error: " << options.inputs[0] << " has no main.pul" << std::endl;
+        return 1;
+    }
+
+    pulse::driver::TimeReport::Scope phase("run");
+    return jit.run("main");
+#else
+    return interpretProgram(options);
+#endif
+}
+
+// --dump-tokens and --dump-ast: one file, or the built-in example without one
+int dumpFile(const DriverOptions& options) {
+    pulse::lexer::SourceBufferPtr source;
+    pulse::lexer::TokenStream tokens;
+    {
+        pulse::driver::TimeReport::Scope phase("tokenize");
+        if (!options.inputs.empty()) {
+            // Map the file (or read stdin when given "-")
+            source = pulse::lexer::SourceBuffer::fromFile(options.inputs[0]);
         } else {
-            // Use example source code
-            source = R"(
+            source = pulse::lexer::SourceBuffer::fromString(R"(
 # Example Pulse program
 def greet(name):
     if name == "World":
@@ -125,39 +819,90 @@ def factorial(n):
 greet("World")
 result = factorial(5)
 out("Factorial of 5 is: " + str(result))
-)";
-        }
-        
-        std::cout << "=== Pulse Compiler ===" << std::endl;
-        std::cout << "Source code:" << std::endl;
-        std::cout << source << std::endl;
-        
-        // Tokenize
-        std::cout << "\n=== Tokenization ===" << std::endl;
+)");
+        }
         pulse::lexer::Tokenizer tokenizer(source);
-        auto tokens = tokenizer.tokenize();
+        tokens = tokenizer.tokenize();
+    }
+    if (options.dumpTokens) {
         printTokens(tokens);
-        
-        // Parse
-        std::cout << "\n=== Parsing ===" << std::endl;
+    }
+    if (!options.dumpAST) {
+        return 0;
+    }
+
+    std::unique_ptr<pulse::parser::Program> ast;
+    {
+        pulse::driver::TimeReport::Scope phase("parse");
         pulse::parser::Parser parser(tokens);
-        auto ast = parser.parse();
-        
-        if (ast) {
-            std::cout << "Parse successful!" << std::endl;
-            std::cout << "\n=== Abstract Syntax Tree ===" << std::endl;
-            printAST(ast.get());
-        } else {
-            std::cout << "Parse failed!" << std::endl;
-            return 1;
+        ast = parser.parse();
+    }
+    if (!ast) {
+        std::cerr << "Parse failed" << std::endl;
+        return 1;
+    }
+    printAST(ast.get());
+    return 0;
+}
+
+int dispatch(const DriverOptions& options) {
+    if (options.run) {
+        return runProgram(options);
+    }
+    if (options.repl) {
+        return runRepl(options);
+    }
+    if (options.dumpTokens || options.dumpAST) {
+        return dumpFile(options);
+    }
+    if (options.inputs.empty()) {
+        if (options.codegen()) {
+            throw std::invalid_argument("No input file");
         }
-        
-        std::cout << "\n=== Compilation Complete ===" << std::endl;
-        
+        printUsage();
+        return 1;
+    }
+
+    bool several = options.inputs.size() > 1 ||
+        (options.inputs[0] != "-" && std::filesystem::is_directory(options.inputs[0]));
+    if (options.codegen() && !several) {
+        return compileFile(options);
+    }
+    return buildProject(options);
+}
+
+// --time-report and --time-report-file, once the work is done
+void writeTimeReport(const DriverOptions& options) {
+    auto& report = pulse::driver::TimeReport::get();
+    if (!report.isEnabled()) return;
+    std::cout.flush();
+    if (options.timeReport == "json") {
+        std::cerr << report.json();
+    } else if (!options.timeReport.empty()) {
+        std::cerr << report.text();
+    }
+    if (!options.timeReportFile.empty()) {
+        std::ofstream file(options.timeReportFile, std::ios::binary);
+        file << report.json();
+        if (!file) {
+            std::cerr << "Error: cannot write " << options.timeReportFile << std::endl;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    DriverOptions options;
+    int status;
+    try {
+        options = parseArguments(argc, argv);
+        if (!options.timeReport.empty() || !options.timeReportFile.empty()) {
+            pulse::driver::TimeReport::get().enable();
+        }
+        status = dispatch(options);
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
-        return 1;
+        status = 1;
     }
-    
-    return 0;
-} 
\ No newline at end of file
+    writeTimeReport(options);
+    return status;
+}
@@ -0,0 +1,471 @@
+#include "net/http_client.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <regex>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace pulse::net {
+
+namespace {
+
+// A server that hangs up mid-request is an error, not a SIGPIPE
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+constexpr int TIMEOUT_SECONDS = 30;
+constexpr size_t READ_SIZE = 64 * 1024;
+
+struct URLParts {
+    std::string host;
+    int port = 80;
+    std::string path;
+};
+
+URLParts parseURL(const std::string& url) {
+    static const std::regex url_regex("https?://([^/:]+)(:([0-9]+))?(/.*)?");
+    std::smatch match;
+
+    URLParts parts;
+    if (std::regex_match(url, match, url_regex)) {
+        parts.host = match[1].str();
+        if (match[3].matched) {
+            parts.port = std::atoi(match[3].str().c_str());
+        }
+        parts.path = (match[4].matched && !match[4].str().empty()) ? match[4].str() : "/";
+    }
+    return parts;
+}
+
+void closeSocket(int fd) {
+#ifdef _WIN32
+    closesocket(fd);
+#else
+    close(fd);
+#endif
+}
+
+// getaddrinfo results by "host:port", shared by every client of the process
+struct ResolvedAddress {
+    int family;
+    int socktype;
+    int protocol;
+    sockaddr_storage address;
+    socklen_t length;
+};
+
+std::mutex dns_mutex;
+std::map<std::string, std::vector<ResolvedAddress>> dns_cache;
+
+std::vector<ResolvedAddress> resolve(const std::string& host, int port) {
+    std::string key = host + ":" + std::to_string(port);
+    {
+        std::lock_guard<std::mutex> lock(dns_mutex);
+        auto it = dns_cache.find(key);
+        if (it != dns_cache.end()) return it->second;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* results = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &results) != 0 || !results) {
+        throw std::runtime_error("Failed to resolve hostname: " + host);
+    }
+    std::vector<ResolvedAddress> addresses;
+    for (addrinfo* info = results; info; info = info->ai_next) {
+        ResolvedAddress resolved{};
+        resolved.family = info->ai_family;
+        resolved.socktype = info->ai_socktype;
+        resolved.protocol = info->ai_protocol;
+        resolved.length = static_cast<socklen_t>(info->ai_addrlen);
+        std::memcpy(&resolved.address, info->ai_addr, info->ai_addrlen);
+        addresses.push_back(resolved);
+    }
+    freeaddrinfo(results);
+
+    std::lock_guard<std::mutex> lock(dns_mutex);
+    dns_cache[key] = addresses;
+    return addresses;
+}
+
+void setTimeouts(int fd) {
+#ifdef _WIN32
+    DWORD timeout = TIMEOUT_SECONDS * 1000;
+#else
+    timeval timeout{TIMEOUT_SECONDS, 0};
+#endif
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+    // Requests are written in one piece; do not hold back their last segment
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+}
+
+std::string lowercase(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+std::string trim(const std::string& str) {
+    size_t start = str.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) return "";
+    size_t end = str.find_last_not_of(" \t\r\n");
+    return str.substr(start, end - start + 1);
+}
+
+constexpr int MAX_REDIRECTS = 5;
+
+bool isRedirect(int status) {
+    return status == 301 || status == 302 || status == 303 || status == 307 || status == 308;
+}
+
+// A Location header against the URL that answered with it
+std::string resolveLocation(const std::string& base, const std::string& location) {
+    if (location.rfind("http://", 0) == 0 || location.rfind("https://", 0) == 0) {
+        return location;
+    }
+    size_t authority = base.find("://");
+    size_t path_start = base.find('/', authority == std::string::npos ? 0 : authority + 3);
+    std::string origin = path_start == std::string::npos ? base : base.substr(0, path_start);
+    if (!location.empty() && location[0] == '/') {
+        return origin + location;
+    }
+    std::string directory = path_start == std::string::npos ? "/" : base.substr(path_start);
+    directory = directory.substr(0, directory.rfind('/') + 1);
+    return origin + directory + location;
+}
+
+// The server closed a kept-alive connection before answering; the request
+// can be sent again on a new one
+struct StaleConnection : std::runtime_error {
+    StaleConnection() : std::runtime_error("Connection closed by server") {}
+};
+
+} // namespace
+
+// A socket and what has been received on it but not consumed yet
+struct HTTPClient::Connection {
+    int fd = -1;
+    std::string buffer;
+    size_t position = 0;
+
+    ~Connection() {
+        if (fd != -1) closeSocket(fd);
+    }
+
+    size_t available() const { return buffer.size() - position; }
+
+    // Receives more; false at the end of the stream
+    bool fill() {
+        if (position > 0 && position == buffer.size()) {
+            buffer.clear();
+            position = 0;
+        } else if (position > READ_SIZE) {
+            buffer.erase(0, position);
+            position = 0;
+        }
+        size_t old_size = buffer.size();
+        buffer.resize(old_size + READ_SIZE);
+        int count;
+        do {
+            count = static_cast<int>(recv(fd, &buffer[old_size], static_cast<int>(READ_SIZE), 0));
+        } while (count < 0 && errno == EINTR);
+        buffer.resize(old_size + static_cast<size_t>(std::max(count, 0)));
+        if (count < 0) {
+            throw std::runtime_error("Failed to receive HTTP response");
+        }
+        return count > 0;
+    }
+
+    std::string readLine() {
+        for (;;) {
+            size_t end = buffer.find("\r\n", position);
+            if (end != std::string::npos) {
+                std::string line = buffer.substr(position, end - position);
+                position = end + 2;
+                return line;
+            }
+            if (!fill()) {
+                throw std::runtime_error("Connection closed in the middle of a response");
+            }
+        }
+    }
+
+    // Passes exactly size body bytes to deliver
+    void readBody(size_t size, const BodySink& deliver) {
+        while (size > 0) {
+            if (available() == 0 && !fill()) {
+                throw std::runtime_error("Connection closed in the middle of a response body");
+            }
+            size_t count = std::min(size, available());
+            deliver(buffer.data() + position, count);
+            position += count;
+            size -= count;
+        }
+    }
+
+    void readToEnd(const BodySink& deliver) {
+        do {
+            if (available() > 0) {
+                deliver(buffer.data() + position, available());
+                position = buffer.size();
+            }
+        } while (fill());
+    }
+
+    void sendAll(const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            auto count = send(fd, data.data() + sent, static_cast<int>(data.size() - sent), SEND_FLAGS);
+            if (count <= 0) {
+                if (count < 0 && errno == EINTR) continue;
+                throw std::runtime_error("Failed to send HTTP request");
+            }
+            sent += static_cast<size_t>(count);
+        }
+    }
+};
+
+HTTPClient::HTTPClient() : initialized(false) {
+#ifdef _WIN32
+    WSADATA wsaData;
+    initialized = WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+#endif
+}
+
+HTTPClient::~HTTPClient() {
+    connections.clear();
+#ifdef _WIN32
+    if (initialized) {
+        WSACleanup();
+    }
+#endif
+}
+
+HTTPClient::Connection& HTTPClient::connection(const std::string& host, int port) {
+    std::string key = host + ":" + std::to_string(port);
+    auto it = connections.find(key);
+    if (it != connections.end()) return *it->second;
+
+    auto conn = std::make_unique<Connection>();
+    for (const ResolvedAddress& address : resolve(host, port)) {
+        int fd = static_cast<int>(socket(address.family, address.socktype, address.protocol));
+        if (fd == -1) continue;
+        if (::connect(fd, reinterpret_cast<const sockaddr*>(&address.address), address.length) == 0) {
+            conn->fd = fd;
+            break;
+        }
+        closeSocket(fd);
+    }
+    if (conn->fd == -1) {
+        throw std::runtime_error("Failed to connect to server " + key);
+    }
+    setTimeouts(conn->fd);
+    opened++;
+    return *connections.emplace(key, std::move(conn)).first->second;
+}
+
+HTTPResponse HTTPClient::request(const std::string& method, const std::string& url, const std::string& body,
+                                 const BodySink& sink) {
+    // GET and HEAD follow redirects (a directory URL without its slash, a
+    // moved package); the bodies of the redirects themselves are dropped
+    bool follow = method == "GET" || method == "HEAD";
+    std::string target = url;
+    for (int redirects = 0;; redirects++) {
+        HTTPResponse response = exchange(method, target, body, sink, follow);
+        auto location = response.headers.find("location");
+        if (!follow || !isRedirect(response.status) || location == response.headers.end()) {
+            return response;
+        }
+        if (redirects == MAX_REDIRECTS) {
+            throw std::runtime_error("Too many redirects from " + url);
+        }
+        target = resolveLocation(target, location->second);
+    }
+}
+
+HTTPResponse HTTPClient::exchange(const std::string& method, const std::string& url, const std::string& body,
+                                  const BodySink& sink, bool follow) {
+    URLParts parts = parseURL(url);
+    if (parts.host.empty()) {
+        throw std::runtime_error("Invalid URL format");
+    }
+    std::string key = parts.host + ":" + std::to_string(parts.port);
+
+    std::string request = method + " " + parts.path + " HTTP/1.1\r\n"
+                          "Host: " + parts.host + (parts.port != 80 ? ":" + std::to_string(parts.port) : "") + "\r\n"
+                          "User-Agent: Pulse-Package-Manager/1.0\r\n"
+                          "Connection: keep-alive\r\n";
+    if (!body.empty() || method == "PUT" || method == "POST") {
+        request += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    }
+    request += "\r\n";
+    request += body;
+
+    // A kept-alive connection may have been closed by the server since; that
+    // shows as a failure before the first byte of the answer, and the request
+    // is then sent once more on a fresh connection
+    for (int attempt = 0;; attempt++) {
+        bool reused = connections.count(key) > 0;
+        Connection& conn = connection(parts.host, parts.port);
+        try {
+            HTTPResponse response;
+            bool keep_alive = true;
+            try {
+                conn.sendAll(request);
+                if (conn.available() == 0 && !conn.fill()) throw StaleConnection();
+            } catch (const std::runtime_error&) {
+                if (reused) throw StaleConnection();
+                throw;
+            }
+
+            // "HTTP/1.1 200 OK", skipping any interim 1xx answers
+            std::string version;
+            do {
+                std::string status_line = conn.readLine();
+                size_t space = status_line.find(' ');
+                if (status_line.rfind("HTTP/", 0) != 0 || space == std::string::npos) {
+                    throw std::runtime_error("Malformed HTTP status line from " + key);
+                }
+                version = status_line.substr(0, space);
+                response.status = std::atoi(status_line.c_str() + space + 1);
+                response.headers.clear();
+                for (std::string line = conn.readLine(); !line.empty(); line = conn.readLine()) {
+                    size_t colon = line.find(':');
+                    if (colon == std::string::npos) continue;
+                    response.headers[lowercase(trim(line.substr(0, colon)))] = trim(line.substr(colon + 1));
+                }
+            } while (response.status >= 100 && response.status < 200);
+
+            auto header = [&](const std::string& name) {
+                auto it = response.headers.find(name);
+                return it != response.headers.end() ? lowercase(it->second) : std::string();
+            };
+            std::string connection_header = header("connection");
+            keep_alive = connection_header.find("close") == std::string::npos &&
+                         (version != "HTTP/1.0" || connection_header.find("keep-alive") != std::string::npos);
+
+            BodySink deliver = sink ? sink : BodySink([&](const char* data, size_t size) {
+                response.body.append(data, size);
+            });
+            if (follow && isRedirect(response.status) && response.headers.count("location")) {
+                deliver = [](const char*, size_t) {};
+            }
+
+            bool has_body = method != "HEAD" && response.status != 204 && response.status != 304;
+            if (!has_body) {
+                // nothing follows the headers
+            } else if (header("transfer-encoding").find("chunked") != std::string::npos) {
+                for (;;) {
+                    std::string size_line = conn.readLine();
+                    size_t size = std::strtoull(size_line.c_str(), nullptr, 16);
+                    if (size == 0) break;
+                    conn.readBody(size, deliver);
+                    conn.readLine();
+                }
+                // Trailer headers, up to the empty line
+                while (!conn.readLine().empty()) {
+                }
+            } else if (response.headers.count("content-length")) {
+                conn.readBody(std::strtoull(response.headers["content-length"].c_str(), nullptr, 10), deliver);
+            } else {
+                conn.readToEnd(deliver);
+                keep_alive = false;
+            }
+
+            if (!keep_alive) {
+                connections.erase(key);
+            }
+            return response;
+
+        } catch (const StaleConnection&) {
+            connections.erase(key);
+            if (attempt > 0) throw std::runtime_error("Connection to " + key + " closed by server");
+        } catch (...) {
+            connections.erase(key);
+            throw;
+        }
+    }
+}
+
+HTTPResponse HTTPClient::download(const std::string& url, const fs::path& file) {
+    fs::path temporary = file;
+    temporary += ".part";
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot write " + temporary.string());
+    }
+
+    HTTPResponse response;
+    try {
+        response = get(url, [&](const char* data, size_t size) {
+            out.write(data, static_cast<std::streamsize>(size));
+        });
+    } catch (...) {
+        out.close();
+        fs::remove(temporary);
+        throw;
+    }
+    out.close();
+
+    if (!response.ok() || !out) {
+        fs::remove(temporary);
+        throw std::runtime_error("GET " + url + ": " +
+                                 (response.ok() ? "cannot write " + file.string()
+                                                : "HTTP " + std::to_string(response.status)));
+    }
+    fs::rename(temporary, file);
+    return response;
+}
+
+std::string HTTPClient::fetchURL(const std::string& url) {
+    return get(url).body;
+}
+
+std::vector<std::string> HTTPClient::listDirectory(const std::string& url) {
+    std::string response = fetchURL(url);
+    std::vector<std::string> files;
+
+    // Simple HTML parsing to extract links
+    std::regex link_regex("<a[^>]*href=[\"']([^\"']+)[\"'][^>]*>");
+    std::sregex_iterator iter(response.begin(), response.end(), link_regex);
+    std::sregex_iterator end;
+
+    for (; iter != end; ++iter) {
+        std::string link = (*iter)[1];
+        if (link.find(".pul") != std::string::npos ||
+            link.find(".toml") != std::string::npos ||
+            link.find(".json") != std::string::npos) {
+            files.push_back(link);
+        }
+    }
+
+    return files;
+}
+
+} // namespace pulse::net
@@ -4,38 +4,87 @@
 
 namespace pulse::parser {
 
-Parser::Parser(const std::vector<lexer::Token>& tokens) 
-    : tokens(tokens), current(0) {}
+namespace {
+
+// The text a string literal stands for, between its quotes: \n, \t, \r, \0,
+// \\ and escaped quotes are decoded; any other backslash stays, as in Python
+std::string decodeEscapes(std::string_view text) {
+    std::string decoded;
+    decoded.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] != '\\' || i + 1 == text.size()) {
+            decoded += text[i];
+            continue;
+        }
+        switch (text[++i]) {
+            case 'n': decoded += '\n'; break;
+            case 't': decoded += '\t'; break;
+            case 'r': decoded += '\r'; break;
+            case '0': decoded += '\0'; break;
+            case '\\': decoded += '\\'; break;
+            case '\'': decoded += '\''; break;
+            case '"': decoded += '"'; break;
+            default:
+                decoded += '\\';
+                decoded += text[i];
+                break;
+        }
+    }
+    return decoded;
+}
+
+} // namespace
+
+Parser::Parser(const lexer::TokenStream& tokens)
+    : tokens(&tokens), current(0), last(0), arena(std::make_unique<AstArena>()) {
+    if (this->tokens->empty() || this->tokens->back().type != lexer::TokenType::EOF_TOKEN) {
+        throw std::runtime_error("Token stream must end with an EOF token");
+    }
+    skipComments();
+}
+
+Parser::Parser(lexer::TokenStream&& tokens)
+    : ownedTokens(std::move(tokens)), tokens(&ownedTokens), current(0), last(0),
+      arena(std::make_unique<AstArena>()) {
+    if (this->tokens->empty() || this->tokens->back().type != lexer::TokenType::EOF_TOKEN) {
+        throw std::runtime_error("Token stream must end with an EOF token");
+    }
+    skipComments();
+}
 
 std::unique_ptr<Program> Parser::parse() {
     try {
-        return program();
+        return parseOrThrow();
     } catch (const std::runtime_error& e) {
         std::cerr << "Parse error: " << e.what() << std::endl;
         return nullptr;
     }
 }
 
+std::unique_ptr<Program> Parser::parseOrThrow() {
+    return program();
+}
+
 std::unique_ptr<Program> Parser::program() {
-    std::vector<std::unique_ptr<Declaration>> declarations;
-    std::vector<std::unique_ptr<Statement>> statements;
-    
+    auto declarations = arena->makeVector<DeclarationPtr>();
+    auto statements = arena->makeVector<StatementPtr>();
+
     while (!isAtEnd()) {
         if (peek().type == lexer::TokenType::INDENT) {
             advance(); // consume indent
             continue;
         }
-        
+
         if (peek().type == lexer::TokenType::DEDENT) {
             advance(); // consume dedent
             continue;
         }
-        
+
         if (peek().type == lexer::TokenType::NEWLINE) {
             advance(); // consume newline
             continue;
         }
-        
+
         if (auto decl = declaration()) {
             declarations.push_back(std::move(decl));
         } else if (auto stmt = statement()) {
@@ -44,512 +93,588 @@ std::unique_ptr<Program> Parser::program() {
             break;
         }
     }
-    
-    return std::make_unique<Program>(std::move(declarations), std::move(statements));
+
+    // The program takes the arena with it; start a fresh one for any later parse
+    auto program = std::make_unique<Program>(std::move(arena), std::move(declarations), std::move(statements));
+    arena = std::make_unique<AstArena>();
+    return program;
 }
 
-std::unique_ptr<Declaration> Parser::declaration() {
+DeclarationPtr Parser::declaration() {
     if (match(lexer::TokenType::IMPORT)) {
         return importDeclaration();
     }
-    
+
     if (match(lexer::TokenType::DEF)) {
-        return functionDeclaration();
+        return functionDeclaration(false);
     }
-    
+
+    if (match(lexer::TokenType::ASYNC)) {
+        consume(lexer::TokenType::DEF, "Expect 'def' after 'async'.");
+        return functionDeclaration(true);
+    }
+
     if (match(lexer::TokenType::CLASS)) {
         return classDeclaration();
     }
-    
+
     return nullptr;
 }
 
-std::unique_ptr<Statement> Parser::statement() {
+StatementPtr Parser::statement() {
     if (match(lexer::TokenType::IF)) {
         return ifStatement();
     }
-    
+
     if (match(lexer::TokenType::WHILE)) {
         return whileStatement();
     }
-    
+
     if (match(lexer::TokenType::FOR)) {
         return forStatement();
     }
-    
+
     if (match(lexer::TokenType::MATCH)) {
         return matchStatement();
     }
-    
+
     if (match(lexer::TokenType::RETURN)) {
         return returnStatement();
     }
-    
+
     // Check for assignment (identifier = expression)
-    if (peek().type == lexer::TokenType::IDENTIFIER && 
-        peek().type != lexer::TokenType::EOF_TOKEN) {
-        auto temp_current = current;
-        advance(); // consume identifier
-        
-        if (peek().type == lexer::TokenType::ASSIGN) {
-            current = temp_current; // reset
-            return assignmentStatement();
-        }
-        
-        current = temp_current; // reset
+    if (check(lexer::TokenType::IDENTIFIER) && checkNext(lexer::TokenType::ASSIGN)) {
+        return assignmentStatement();
     }
-    
+
     return expressionStatement();
 }
 
-std::unique_ptr<Expression> Parser::expression() {
+ExpressionPtr Parser::expression() {
     return logicalOr();
 }
 
-std::unique_ptr<Expression> Parser::logicalOr() {
+ExpressionPtr Parser::logicalOr() {
     auto expr = logicalAnd();
-    
+
     while (match(lexer::TokenType::OR)) {
-        auto operator_token = tokens[current - 1];
         auto right = logicalAnd();
-        expr = std::make_unique<BinaryExpression>(
+        expr = arena->make<BinaryExpression>(
             BinaryExpression::Operator::OR, std::move(expr), std::move(right)
         );
     }
-    
+
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::logicalAnd() {
+ExpressionPtr Parser::logicalAnd() {
     auto expr = equality();
-    
+
     while (match(lexer::TokenType::AND)) {
-        auto operator_token = tokens[current - 1];
         auto right = equality();
-        expr = std::make_unique<BinaryExpression>(
+        expr = arena->make<BinaryExpression>(
             BinaryExpression::Operator::AND, std::move(expr), std::move(right)
         );
     }
-    
+
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::equality() {
+ExpressionPtr Parser::equality() {
     auto expr = comparison();
-    
+
     while (match(lexer::TokenType::EQUAL) || match(lexer::TokenType::NOT_EQUAL)) {
-        auto operator_token = tokens[current - 1];
+        lexer::TokenType operator_type = previous().type;
         auto right = comparison();
-        
-        BinaryExpression::Operator op = (operator_token.type == lexer::TokenType::EQUAL) 
-            ? BinaryExpression::Operator::EQUAL 
+
+        BinaryExpression::Operator op = (operator_type == lexer::TokenType::EQUAL)
+            ? BinaryExpression::Operator::EQUAL
             : BinaryExpression::Operator::NOT_EQUAL;
-            
-        expr = std::make_unique<BinaryExpression>(op, std::move(expr), std::move(right));
+
+        expr = arena->make<BinaryExpression>(op, std::move(expr), std::move(right));
     }
-    
+
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::comparison() {
+ExpressionPtr Parser::comparison() {
     auto expr = term();
-    
+
     while (match(lexer::TokenType::LESS) || match(lexer::TokenType::LESS_EQUAL) ||
            match(lexer::TokenType::GREATER) || match(lexer::TokenType::GREATER_EQUAL)) {
-        auto operator_token = tokens[current - 1];
+        lexer::TokenType operator_type = previous().type;
         auto right = term();
-        
+
         BinaryExpression::Operator op;
-        switch (operator_token.type) {
+        switch (operator_type) {
             case lexer::TokenType::LESS: op = BinaryExpression::Operator::LESS; break;
             case lexer::TokenType::LESS_EQUAL: op = BinaryExpression::Operator::LESS_EQUAL; break;
             case lexer::TokenType::GREATER: op = BinaryExpression::Operator::GREATER; break;
             case lexer::TokenType::GREATER_EQUAL: op = BinaryExpression::Operator::GREATER_EQUAL; break;
             default: op = BinaryExpression::Operator::LESS; break;
         }
-        
-        expr = std::make_unique<BinaryExpression>(op, std::move(expr), std::move(right));
+
+        expr = arena->make<BinaryExpression>(op, std::move(expr), std::move(right));
     }
-    
+
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::term() {
+ExpressionPtr Parser::term() {
     auto expr = factor();
-    
+
     while (match(lexer::TokenType::PLUS) || match(lexer::TokenType::MINUS)) {
-        auto operator_token = tokens[current - 1];
+        lexer::TokenType operator_type = previous().type;
         auto right = factor();
-        
-        BinaryExpression::Operator op = (operator_token.type == lexer::TokenType::PLUS) 
-            ? BinaryExpression::Operator::ADD 
+
+        BinaryExpression::Operator op = (operator_type == lexer::TokenType::PLUS)
+            ? BinaryExpression::Operator::ADD
             : BinaryExpression::Operator::SUBTRACT;
-            
-        expr = std::make_unique<BinaryExpression>(op, std::move(expr), std::move(right));
+
+        expr = arena->make<BinaryExpression>(op, std::move(expr), std::move(right));
     }
-    
+
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::factor() {
+ExpressionPtr Parser::factor() {
     auto expr = power();
-    
+
     while (match(lexer::TokenType::MULTIPLY) || match(lexer::TokenType::DIVIDE) ||
            match(lexer::TokenType::FLOOR_DIVIDE) || match(lexer::TokenType::MODULO)) {
-        auto operator_token = tokens[current - 1];
+        lexer::TokenType operator_type = previous().type;
         auto right = power();
-        
+
         BinaryExpression::Operator op;
-        switch (operator_token.type) {
+        switch (operator_type) {
             case lexer::TokenType::MULTIPLY: op = BinaryExpression::Operator::MULTIPLY; break;
             case lexer::TokenType::DIVIDE: op = BinaryExpression::Operator::DIVIDE; break;
             case lexer::TokenType::FLOOR_DIVIDE: op = BinaryExpression::Operator::FLOOR_DIVIDE; break;
             case lexer::TokenType::MODULO: op = BinaryExpression::Operator::MODULO; break;
             default: op = BinaryExpression::Operator::MULTIPLY; break;
         }
-        
-        expr = std::make_unique<BinaryExpression>(op, std::move(expr), std::move(right));
+
+        expr = arena->make<BinaryExpression>(op, std::move(expr), std::move(right));
     }
-    
+
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::power() {
+ExpressionPtr Parser::power() {
     auto expr = unary();
-    
+
     while (match(lexer::TokenType::POWER)) {
         auto right = unary();
-        expr = std::make_unique<BinaryExpression>(
+        expr = arena->make<BinaryExpression>(
             BinaryExpression::Operator::POWER, std::move(expr), std::move(right)
         );
     }
-    
+
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::unary() {
-    if (match(lexer::TokenType::MINUS) || match(lexer::TokenType::NOT)) {
-        auto operator_token = tokens[current - 1];
-        auto operand = unary();
-        
-        UnaryExpression::Operator op = (operator_token.type == lexer::TokenType::MINUS) 
-            ? UnaryExpression::Operator::MINUS 
-            : UnaryExpression::Operator::NOT;
-            
-        return std::make_unique<UnaryExpression>(op, std::move(operand));
+// await binds looser than calls, attributes and subscripts and tighter than
+// the operators: -await f(x)[0] negates the awaited f(x)[0]
+ExpressionPtr Parser::awaitExpression() {
+    if (match(lexer::TokenType::AWAIT)) {
+        auto operand = call();
+        return arena->make<UnaryExpression>(UnaryExpression::Operator::AWAIT, std::move(operand));
     }
-    
-    return primary();
+    return call();
 }
 
-std::unique_ptr<Expression> Parser::primary() {
-    if (match(lexer::TokenType::FALSE)) {
-        return std::make_unique<LiteralExpression>(false);
+ExpressionPtr Parser::unary() {
+    if (match(lexer::TokenType::MINUS) || match(lexer::TokenType::PLUS) || match(lexer::TokenType::NOT)) {
+        lexer::TokenType operator_type = previous().type;
+        auto operand = unary();
+
+        UnaryExpression::Operator op;
+        switch (operator_type) {
+            case lexer::TokenType::MINUS: op = UnaryExpression::Operator::MINUS; break;
+            case lexer::TokenType::PLUS: op = UnaryExpression::Operator::PLUS; break;
+            default: op = UnaryExpression::Operator::NOT; break;
+        }
+
+        return arena->make<UnaryExpression>(op, std::move(operand));
     }
-    
-    if (match(lexer::TokenType::TRUE)) {
-        return std::make_unique<LiteralExpression>(true);
+
+    return awaitExpression();
+}
+
+ExpressionPtr Parser::primary() {
+    if (match(lexer::TokenType::BOOLEAN)) {
+        if (auto value = tokens->getBoolean(previous())) {
+            return arena->make<LiteralExpression>(*value);
+        }
     }
-    
+
     if (match(lexer::TokenType::NONE)) {
-        return std::make_unique<LiteralExpression>();
+        return arena->make<LiteralExpression>();
     }
-    
+
     if (match(lexer::TokenType::INTEGER)) {
-        auto token = tokens[current - 1];
-        if (auto value = token.getInteger()) {
-            return std::make_unique<LiteralExpression>(*value);
+        if (auto value = tokens->getInteger(previous())) {
+            return arena->make<LiteralExpression>(*value);
         }
     }
-    
+
     if (match(lexer::TokenType::FLOAT)) {
-        auto token = tokens[current - 1];
-        if (auto value = token.getFloat()) {
-            return std::make_unique<LiteralExpression>(*value);
+        if (auto value = tokens->getFloat(previous())) {
+            return arena->make<LiteralExpression>(*value);
         }
     }
-    
+
     if (match(lexer::TokenType::STRING)) {
-        auto token = tokens[current - 1];
-        if (auto value = token.getString()) {
-            return std::make_unique<LiteralExpression>(*value);
+        if (auto value = tokens->getString(previous())) {
+            // Decoded once here, so the VM and native code see the same text
+            std::string_view text = *value;
+            if (text.find('\\') != std::string_view::npos) {
+                return arena->make<LiteralExpression>(arena->copyString(decodeEscapes(text)));
+            }
+            return arena->make<LiteralExpression>(arena->copyString(text));
         }
     }
-    
+
     if (match(lexer::TokenType::IDENTIFIER)) {
-        auto token = tokens[current - 1];
-        return std::make_unique<IdentifierExpression>(token.lexeme);
+        return arena->make<IdentifierExpression>(lexeme(previous()));
     }
-    
+
     if (match(lexer::TokenType::LPAREN)) {
+        // () is the empty tuple, (a, ...) a tuple, (a) a grouping
+        if (match(lexer::TokenType::RPAREN)) {
+            return arena->make<TupleExpression>(arena->makeVector<ExpressionPtr>());
+        }
+
         auto expr = expression();
+        if (match(lexer::TokenType::COMMA)) {
+            return tupleExpression(std::move(expr));
+        }
         consume(lexer::TokenType::RPAREN, "Expect ')' after expression.");
         return expr;
     }
-    
+
     if (match(lexer::TokenType::LBRACKET)) {
         return listExpression();
     }
-    
+
     if (match(lexer::TokenType::LBRACE)) {
         return dictExpression();
     }
-    
+
     error(peek(), "Expect expression.");
-    return nullptr;
 }
 
-std::unique_ptr<Expression> Parser::call() {
+ExpressionPtr Parser::call() {
     auto expr = primary();
-    
+
     while (true) {
         if (match(lexer::TokenType::LPAREN)) {
             expr = finishCall(std::move(expr));
         } else if (match(lexer::TokenType::DOT)) {
             consume(lexer::TokenType::IDENTIFIER, "Expect property name after '.'.");
-            auto name = tokens[current - 1].lexeme;
-            expr = std::make_unique<AttributeExpression>(std::move(expr), name);
+            auto name = lexeme(previous());
+            expr = arena->make<AttributeExpression>(std::move(expr), name);
         } else if (match(lexer::TokenType::LBRACKET)) {
             auto index = expression();
             consume(lexer::TokenType::RBRACKET, "Expect ']' after index.");
-            expr = std::make_unique<SubscriptExpression>(std::move(expr), std::move(index));
+            expr = arena->make<SubscriptExpression>(std::move(expr), std::move(index));
         } else {
             break;
         }
     }
-    
+
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::finishCall(std::unique_ptr<Expression> callee) {
-    std::vector<std::unique_ptr<Expression>> arguments;
-    
+ExpressionPtr Parser::finishCall(ExpressionPtr callee) {
+    auto arguments = arena->makeVector<ExpressionPtr>();
+
     if (!check(lexer::TokenType::RPAREN)) {
         do {
             arguments.push_back(expression());
         } while (match(lexer::TokenType::COMMA));
     }
-    
+
     consume(lexer::TokenType::RPAREN, "Expect ')' after arguments.");
-    
-    return std::make_unique<CallExpression>(std::move(callee), std::move(arguments));
+
+    return arena->make<CallExpression>(std::move(callee), std::move(arguments));
 }
 
 // Statement parsing implementations
-std::unique_ptr<Statement> Parser::ifStatement() {
-    consume(lexer::TokenType::COLON, "Expect ':' after if condition.");
-    
+StatementPtr Parser::ifStatement() {
     auto condition = expression();
+    consume(lexer::TokenType::COLON, "Expect ':' after if condition.");
     auto then_branch = block();
-    
-    std::vector<IfStatement::Branch> branches;
+
+    auto branches = arena->makeVector<IfStatement::Branch>();
     branches.emplace_back(std::move(condition), std::move(then_branch));
-    
+
     while (match(lexer::TokenType::ELIF)) {
-        consume(lexer::TokenType::COLON, "Expect ':' after elif condition.");
         auto elif_condition = expression();
+        consume(lexer::TokenType::COLON, "Expect ':' after elif condition.");
         auto elif_branch = block();
         branches.emplace_back(std::move(elif_condition), std::move(elif_branch));
     }
-    
-    std::vector<std::unique_ptr<Statement>> else_branch;
+
+    auto else_branch = arena->makeVector<StatementPtr>();
     if (match(lexer::TokenType::ELSE)) {
         consume(lexer::TokenType::COLON, "Expect ':' after else.");
         else_branch = block();
     }
-    
-    return std::make_unique<IfStatement>(std::move(branches), std::move(else_branch));
+
+    return arena->make<IfStatement>(std::move(branches), std::move(else_branch));
 }
 
-std::unique_ptr<Statement> Parser::whileStatement() {
+StatementPtr Parser::whileStatement() {
     auto condition = expression();
     consume(lexer::TokenType::COLON, "Expect ':' after while condition.");
     auto body = block();
-    
-    return std::make_unique<WhileStatement>(std::move(condition), std::move(body));
+
+    return arena->make<WhileStatement>(std::move(condition), std::move(body));
 }
 
-std::unique_ptr<Statement> Parser::forStatement() {
+StatementPtr Parser::forStatement() {
     consume(lexer::TokenType::IDENTIFIER, "Expect variable name after 'for'.");
-    auto variable = tokens[current - 1].lexeme;
-    
+    auto variable = lexeme(previous());
+
     consume(lexer::TokenType::IN, "Expect 'in' after variable name.");
     auto iterable = expression();
-    
+
     consume(lexer::TokenType::COLON, "Expect ':' after iterable.");
     auto body = block();
-    
-    return std::make_unique<ForStatement>(variable, std::move(iterable), std::move(body));
+
+    return arena->make<ForStatement>(variable, std::move(iterable), std::move(body));
 }
 
-std::unique_ptr<Statement> Parser::matchStatement() {
+StatementPtr Parser::matchStatement() {
     auto value = expression();
     consume(lexer::TokenType::COLON, "Expect ':' after match value.");
-    
-    std::vector<std::pair<ExpressionPtr, std::vector<StatementPtr>>> cases;
-    
+    skipNewlines();
+    consume(lexer::TokenType::INDENT, "Expect indented cases after match.");
+
+    auto cases = arena->makeVector<std::pair<ExpressionPtr, ArenaVector<StatementPtr>>>();
+
     while (!isAtEnd() && !check(lexer::TokenType::DEDENT)) {
+        if (match(lexer::TokenType::NEWLINE)) continue;
+
         auto pattern = expression();
         consume(lexer::TokenType::COLON, "Expect ':' after pattern.");
         auto case_body = block();
         cases.emplace_back(std::move(pattern), std::move(case_body));
     }
-    
-    return std::make_unique<MatchStatement>(std::move(value), std::move(cases));
+
+    if (!isAtEnd()) {
+        consume(lexer::TokenType::DEDENT, "Expect end of match cases.");
+    }
+
+    return arena->make<MatchStatement>(std::move(value), std::move(cases));
 }
 
-std::unique_ptr<Statement> Parser::returnStatement() {
-    std::unique_ptr<Expression> value = nullptr;
-    
-    if (!check(lexer::TokenType::NEWLINE) && !check(lexer::TokenType::DEDENT)) {
+StatementPtr Parser::returnStatement() {
+    ExpressionPtr value;
+
+    if (!check(lexer::TokenType::NEWLINE) && !check(lexer::TokenType::DEDENT) && !isAtEnd()) {
         value = expression();
     }
-    
-    return std::make_unique<ReturnStatement>(std::move(value));
+
+    return arena->make<ReturnStatement>(std::move(value));
 }
 
-std::unique_ptr<Statement> Parser::assignmentStatement() {
+StatementPtr Parser::assignmentStatement() {
     consume(lexer::TokenType::IDENTIFIER, "Expect variable name.");
-    auto name = tokens[current - 1].lexeme;
-    
+    auto name = lexeme(previous());
+
     consume(lexer::TokenType::ASSIGN, "Expect '=' after variable name.");
     auto value = expression();
-    
-    return std::make_unique<AssignmentStatement>(name, std::move(value));
+
+    return arena->make<AssignmentStatement>(name, std::move(value));
 }
 
-std::unique_ptr<Statement> Parser::expressionStatement() {
+StatementPtr Parser::expressionStatement() {
     auto expr = expression();
-    return std::make_unique<ExpressionStatement>(std::move(expr));
+    return arena->make<ExpressionStatement>(std::move(expr));
 }
 
 // Declaration parsing implementations
-std::unique_ptr<Declaration> Parser::functionDeclaration() {
+DeclarationPtr Parser::functionDeclaration(bool isAsync) {
     consume(lexer::TokenType::IDENTIFIER, "Expect function name.");
-    auto name = tokens[current - 1].lexeme;
-    
+    auto name = lexeme(previous());
+
     consume(lexer::TokenType::LPAREN, "Expect '(' after function name.");
-    
-    std::vector<std::string> parameters;
+
+    auto parameters = arena->makeVector<std::string_view>();
     if (!check(lexer::TokenType::RPAREN)) {
         do {
             consume(lexer::TokenType::IDENTIFIER, "Expect parameter name.");
-            parameters.push_back(tokens[current - 1].lexeme);
+            parameters.push_back(lexeme(previous()));
         } while (match(lexer::TokenType::COMMA));
     }
-    
+
     consume(lexer::TokenType::RPAREN, "Expect ')' after parameters.");
     consume(lexer::TokenType::COLON, "Expect ':' after function parameters.");
-    
+
     auto body = block();
-    
-    return std::make_unique<FunctionDeclaration>(name, std::move(parameters), std::move(body));
+
+    return arena->make<FunctionDeclaration>(name, std::move(parameters), std::move(body), isAsync);
 }
 
-std::unique_ptr<Declaration> Parser::classDeclaration() {
+DeclarationPtr Parser::classDeclaration() {
     consume(lexer::TokenType::IDENTIFIER, "Expect class name.");
-    auto name = tokens[current - 1].lexeme;
-    
-    std::string base_class;
+    auto name = lexeme(previous());
+
+    std::string_view base_class;
     if (match(lexer::TokenType::LPAREN)) {
         consume(lexer::TokenType::IDENTIFIER, "Expect base class name.");
-        base_class = tokens[current - 1].lexeme;
+        base_class = lexeme(previous());
         consume(lexer::TokenType::RPAREN, "Expect ')' after base class.");
     }
-    
+
     consume(lexer::TokenType::COLON, "Expect ':' after class declaration.");
-    
-    std::vector<std::unique_ptr<Declaration>> members;
+    skipNewlines();
+    consume(lexer::TokenType::INDENT, "Expect indented class body.");
+
+    auto members = arena->makeVector<DeclarationPtr>();
     while (!isAtEnd() && !check(lexer::TokenType::DEDENT)) {
+        if (match(lexer::TokenType::NEWLINE)) continue;
+
         if (auto member = declaration()) {
             members.push_back(std::move(member));
         } else {
-            break;
+            error(peek(), "Expect method or class declaration in class body.");
         }
     }
-    
-    return std::make_unique<ClassDeclaration>(name, base_class, std::move(members));
+
+    if (!isAtEnd()) {
+        consume(lexer::TokenType::DEDENT, "Expect end of class body.");
+    }
+
+    return arena->make<ClassDeclaration>(name, base_class, std::move(members));
 }
 
-std::unique_ptr<Declaration> Parser::importDeclaration() {
+DeclarationPtr Parser::importDeclaration() {
     consume(lexer::TokenType::IDENTIFIER, "Expect module name after 'import'.");
-    auto module = tokens[current - 1].lexeme;
-    
-    std::string alias;
+    auto module = lexeme(previous());
+
+    // Dotted module paths (import std.io) are stored as one name
+    if (check(lexer::TokenType::DOT)) {
+        std::string path(module);
+        while (match(lexer::TokenType::DOT)) {
+            consume(lexer::TokenType::IDENTIFIER, "Expect module name after '.'.");
+            path += '.';
+            path += tokens->lexeme(previous());
+        }
+        module = arena->copyString(path);
+    }
+
+    std::string_view alias;
     if (match(lexer::TokenType::AS)) {
         consume(lexer::TokenType::IDENTIFIER, "Expect alias name after 'as'.");
-        alias = tokens[current - 1].lexeme;
+        alias = lexeme(previous());
     }
-    
-    return std::make_unique<ImportDeclaration>(module, alias);
+
+    return arena->make<ImportDeclaration>(module, alias);
 }
 
 // Expression parsing implementations
-std::unique_ptr<Expression> Parser::listExpression() {
-    std::vector<std::unique_ptr<Expression>> elements;
-    
+ExpressionPtr Parser::listExpression() {
+    auto elements = arena->makeVector<ExpressionPtr>();
+
     if (!check(lexer::TokenType::RBRACKET)) {
         do {
+            if (check(lexer::TokenType::RBRACKET)) break; // trailing comma
             elements.push_back(expression());
         } while (match(lexer::TokenType::COMMA));
     }
-    
+
     consume(lexer::TokenType::RBRACKET, "Expect ']' after list elements.");
-    
-    return std::make_unique<ListExpression>(std::move(elements));
+
+    return arena->make<ListExpression>(std::move(elements));
 }
 
-std::unique_ptr<Expression> Parser::dictExpression() {
-    std::vector<DictExpression::KeyValue> pairs;
-    
+ExpressionPtr Parser::dictExpression() {
+    auto pairs = arena->makeVector<DictExpression::KeyValue>();
+
     if (!check(lexer::TokenType::RBRACE)) {
         do {
+            if (check(lexer::TokenType::RBRACE)) break; // trailing comma
             auto key = expression();
             consume(lexer::TokenType::COLON, "Expect ':' after key.");
             auto value = expression();
             pairs.emplace_back(std::move(key), std::move(value));
         } while (match(lexer::TokenType::COMMA));
     }
-    
+
     consume(lexer::TokenType::RBRACE, "Expect '}' after dictionary pairs.");
-    
-    return std::make_unique<DictExpression>(std::move(pairs));
+
+    return arena->make<DictExpression>(std::move(pairs));
 }
 
-std::unique_ptr<Expression> Parser::tupleExpression() {
-    std::vector<std::unique_ptr<Expression>> elements;
-    
-    if (!check(lexer::TokenType::RPAREN)) {
-        do {
-            elements.push_back(expression());
-        } while (match(lexer::TokenType::COMMA));
+ExpressionPtr Parser::tupleExpression(ExpressionPtr first) {
+    auto elements = arena->makeVector<ExpressionPtr>();
+    elements.push_back(std::move(first));
+
+    // The comma after the first element has already been consumed
+    while (!check(lexer::TokenType::RPAREN)) {
+        elements.push_back(expression());
+        if (!match(lexer::TokenType::COMMA)) break;
     }
-    
+
     consume(lexer::TokenType::RPAREN, "Expect ')' after tuple elements.");
-    
-    return std::make_unique<TupleExpression>(std::move(elements));
+
+    return arena->make<TupleExpression>(std::move(elements));
 }
 
-std::vector<std::unique_ptr<Statement>> Parser::block() {
-    std::vector<std::unique_ptr<Statement>> statements;
-    
+ArenaVector<StatementPtr> Parser::block() {
+    auto statements = arena->makeVector<StatementPtr>();
+
+    // Single-line suite: "if done: return value"
+    skipNewlines();
+    if (!match(lexer::TokenType::INDENT)) {
+        if (auto stmt = statement()) {
+            statements.push_back(std::move(stmt));
+        }
+        return statements;
+    }
+
     while (!isAtEnd() && !check(lexer::TokenType::DEDENT)) {
+        if (match(lexer::TokenType::NEWLINE)) continue;
+
         if (auto stmt = statement()) {
             statements.push_back(std::move(stmt));
         } else {
             break;
         }
     }
-    
+
+    if (!isAtEnd()) {
+        consume(lexer::TokenType::DEDENT, "Expect end of block.");
+    }
+
     return statements;
 }
 
 // Helper method implementations
+const lexer::Token& Parser::advance() {
+    last = current;
+    if (!isAtEnd()) {
+        current++;
+        skipComments();
+    }
+    return (*tokens)[last];
+}
+
 bool Parser::check(lexer::TokenType type) const {
-    if (isAtEnd()) return false;
     return peek().type == type;
 }
 
+bool Parser::checkNext(lexer::TokenType type) const {
+    size_t next = current + 1;
+    while (next < tokens->size() && (*tokens)[next].type == lexer::TokenType::COMMENT) {
+        next++;
+    }
+    return next < tokens->size() && (*tokens)[next].type == type;
+}
+
 bool Parser::match(lexer::TokenType type) {
     if (check(type)) {
         advance();
@@ -563,19 +688,30 @@ void Parser::consume(lexer::TokenType type, const std::string& message) {
         advance();
         return;
     }
-    
+
     error(peek(), message);
 }
 
+void Parser::skipComments() {
+    while ((*tokens)[current].type == lexer::TokenType::COMMENT) {
+        current++;
+    }
+}
+
+void Parser::skipNewlines() {
+    while (match(lexer::TokenType::NEWLINE)) {}
+}
+
 void Parser::synchronize() {
     advance();
-    
+
     while (!isAtEnd()) {
-        if (tokens[current - 1].type == lexer::TokenType::NEWLINE) return;
-        
+        if (previous().type == lexer::TokenType::NEWLINE) return;
+
         switch (peek().type) {
             case lexer::TokenType::CLASS:
             case lexer::TokenType::DEF:
+            case lexer::TokenType::ASYNC:
             case lexer::TokenType::IF:
             case lexer::TokenType::WHILE:
             case lexer::TokenType::FOR:
@@ -584,15 +720,15 @@ void Parser::synchronize() {
             default:
                 break;
         }
-        
+
         advance();
     }
 }
 
 void Parser::error(const lexer::Token& token, const std::string& message) {
-    std::string error_msg = "Error at line " + std::to_string(token.line) + 
+    std::string error_msg = "Error at line " + std::to_string(token.line) +
                            ", column " + std::to_string(token.column) + ": " + message;
-    throw std::runtime_error(error_msg);
+    throw ParseError(error_msg, message, token.line, token.column);
 }
 
-} // namespace pulse::parser 
\ No newline at end of file
+} // namespace pulse::parser
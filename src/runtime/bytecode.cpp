@@ -0,0 +1,80 @@
+#include "runtime/bytecode.hpp"
+#include <sstream>
+
+namespace pulse::runtime {
+
+const char* opcodeName(OpCode op) {
+    switch (op) {
+#define PULSE_OPCODE_NAME(name) case OpCode::name: return #name;
+        PULSE_OPCODES(PULSE_OPCODE_NAME)
+#undef PULSE_OPCODE_NAME
+    }
+    return "?";
+}
+
+std::string disassemble(const FunctionProto& proto) {
+    std::ostringstream out;
+    out << (proto.isAsync ? "async " : "") << proto.name << ": " << proto.parameterCount << " parameter(s), " << proto.registerCount
+        << " register(s), " << proto.constants.size() << " constant(s)\n";
+
+    for (size_t i = 0; i < proto.code.size(); i++) {
+        const Instruction& instruction = proto.code[i];
+        out << "  " << i << "\t" << opcodeName(instruction.op);
+        switch (instruction.op) {
+            case OpCode::JUMP:
+            case OpCode::LOOP:
+                out << "\t-> " << static_cast<int64_t>(i) + 1 + instruction.immediate();
+                break;
+            case OpCode::LOAD_INT:
+                out << "\t" << instruction.a << " " << instruction.immediate();
+                break;
+            case OpCode::LOAD_CONST:
+                out << "\t" << instruction.a << " " << proto.constants[instruction.b].repr();
+                break;
+            case OpCode::ADDK:
+            case OpCode::SUBK:
+            case OpCode::MULK:
+                out << "\t" << instruction.a << " " << instruction.b << " " << proto.constants[instruction.c].repr();
+                break;
+            case OpCode::TEST_EQK:
+            case OpCode::TEST_NEK:
+            case OpCode::TEST_LTK:
+            case OpCode::TEST_LEK:
+            case OpCode::TEST_GTK:
+            case OpCode::TEST_GEK:
+                out << "\t" << instruction.a << " " << proto.constants[instruction.b].repr()
+                    << " flag=" << static_cast<int>(instruction.flag);
+                break;
+            case OpCode::GET_GLOBAL:
+            case OpCode::SET_GLOBAL:
+                out << "\t" << instruction.a << " " << symbolName(proto.globals[instruction.b].name);
+                break;
+            case OpCode::CALL_METHOD:
+            case OpCode::GET_ATTR:
+                out << "\t" << instruction.a << " " << instruction.b << " ."
+                    << symbolName(proto.attributes[instruction.c].name);
+                break;
+            default:
+                out << "\t" << instruction.a << " " << instruction.b << " " << instruction.c;
+                if (instruction.flag) out << " flag=" << static_cast<int>(instruction.flag);
+                break;
+        }
+        out << "\n";
+    }
+
+    // Functions and methods defined by this code follow their definer
+    for (const auto& constant : proto.constants) {
+        if (auto function = constant.as<FunctionObject>(); function && function->code) {
+            out << "\n" << disassemble(*function->code);
+        } else if (auto cls = constant.as<ClassObject>()) {
+            for (const auto& [name, method] : cls->methods) {
+                if (auto function = method.as<FunctionObject>(); function && function->code) {
+                    out << "\n" << disassemble(*function->code);
+                }
+            }
+        }
+    }
+    return out.str();
+}
+
+} // namespace pulse::runtime
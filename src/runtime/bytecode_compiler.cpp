@@ -0,0 +1,694 @@
+#include "runtime/bytecode_compiler.hpp"
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+
+namespace pulse::runtime {
+
+namespace {
+
+using pulse::parser::BinaryExpression;
+using pulse::parser::dyn_cast;
+
+[[noreturn]] void syntaxError(const std::string& message) {
+    throw RuntimeError("SyntaxError: " + message);
+}
+
+// A literal usable as a K operand: an int, float or string
+std::optional<Value> literalConstant(pulse::parser::Expression* expr) {
+    auto literal = dyn_cast<pulse::parser::LiteralExpression>(expr);
+    if (!literal) return std::nullopt;
+    if (auto value = std::get_if<int64_t>(&literal->value)) return Value::fromInt(*value);
+    if (auto value = std::get_if<double>(&literal->value)) return Value::fromFloat(*value);
+    if (auto value = std::get_if<std::string_view>(&literal->value)) {
+        return Value::make<StringObject>(std::string(*value));
+    }
+    return std::nullopt;
+}
+
+bool isComparison(BinaryExpression::Operator op) {
+    return op >= BinaryExpression::Operator::EQUAL && op <= BinaryExpression::Operator::GREATER_EQUAL;
+}
+
+// Offset of the comparison within EQ..GE, TEST_EQ..TEST_GE and TEST_EQK..TEST_GEK
+int comparisonIndex(BinaryExpression::Operator op) {
+    return static_cast<int>(op) - static_cast<int>(BinaryExpression::Operator::EQUAL);
+}
+
+OpCode offsetOp(OpCode first, int index) {
+    return static_cast<OpCode>(static_cast<int>(first) + index);
+}
+
+} // namespace
+
+BytecodeCompiler::BytecodeCompiler(const Resolver& resolver, std::shared_ptr<const pulse::parser::Program> tierSource)
+    : resolver(resolver), tierSource(std::move(tierSource)) {}
+
+std::shared_ptr<FunctionProto> BytecodeCompiler::compileModule(pulse::parser::Program* program) {
+    for (const auto& decl : program->declarations) {
+        auto function = dyn_cast<pulse::parser::FunctionDeclaration>(decl.get());
+        auto cls = dyn_cast<pulse::parser::ClassDeclaration>(decl.get());
+        if ((function && function->name == "range") || (cls && cls->name == "range")) {
+            rangeShadowed = true;
+        }
+    }
+
+    // Functions and classes first, so the module code can refer to them as constants
+    std::vector<std::pair<Symbol, Value>> definitions;
+    std::vector<std::pair<size_t, Symbol>> bases;
+    for (const auto& decl : program->declarations) {
+        if (auto function = dyn_cast<pulse::parser::FunctionDeclaration>(decl.get())) {
+            std::string name(function->name);
+            auto code = compileFunction(function, name);
+            // Coroutines stay on the VM: suspending needs their frame in registers
+            if (tierSource && !code->isAsync) {
+                code->tier = std::make_shared<TierProfile>();
+                code->tier->source = tierSource;
+                code->tier->declaration = function;
+            }
+            definitions.emplace_back(intern(name), Value::make<FunctionObject>(name, code, code->parameterCount));
+        } else if (auto cls = dyn_cast<pulse::parser::ClassDeclaration>(decl.get())) {
+            if (!cls->base_class.empty()) {
+                bases.emplace_back(definitions.size(), intern(cls->base_class));
+            }
+            definitions.emplace_back(intern(cls->name), compileClass(cls));
+        } else if (auto import = dyn_cast<pulse::parser::ImportDeclaration>(decl.get())) {
+            throw RuntimeError("ImportError: the interpreter runs single files; cannot import '" +
+                               std::string(import->module) + "'");
+        }
+    }
+
+    beginProto("<module>", 0, 0);
+    inFunction = false;
+    inAsync = false;
+
+    // Bind the definitions in source order; a base class is looked up when
+    // its subclass is bound, so it must come first
+    size_t nextBase = 0;
+    for (size_t i = 0; i < definitions.size(); i++) {
+        Reg reg = allocate();
+        emit(OpCode::LOAD_CONST, reg, constant(definitions[i].second));
+        if (nextBase < bases.size() && bases[nextBase].first == i) {
+            Reg base = allocate();
+            emit(OpCode::GET_GLOBAL, base, globalSlot(bases[nextBase].second));
+            emit(OpCode::INHERIT, reg, base);
+            nextBase++;
+        }
+        emit(OpCode::SET_GLOBAL, reg, globalSlot(definitions[i].first));
+        freeTo(reg);
+    }
+
+    const auto& statements = program->statements;
+    for (size_t i = 0; i < statements.size(); i++) {
+        auto expression = dyn_cast<pulse::parser::ExpressionStatement>(statements[i].get());
+        if (expression && i + 1 == statements.size()) {
+            Reg result = compileOperand(expression->expression.get());
+            emit(OpCode::RETURN, result);
+            return endProto();
+        }
+        compileStatement(statements[i].get());
+    }
+    emit(OpCode::RETURN_NONE);
+    return endProto();
+}
+
+std::shared_ptr<FunctionProto> BytecodeCompiler::compileFunction(pulse::parser::FunctionDeclaration* decl,
+                                                                 const std::string& name) {
+    const FrameLayout& layout = resolver.frameFor(decl);
+    beginProto(name, layout.parameterCount, layout.size());
+    proto->isAsync = decl->is_async;
+    inFunction = true;
+    inAsync = decl->is_async;
+    compileBlock(decl->body);
+    emit(OpCode::RETURN_NONE);
+    return endProto();
+}
+
+// Methods are plain functions whose first parameter receives the instance
+Value BytecodeCompiler::compileClass(pulse::parser::ClassDeclaration* decl) {
+    std::string className(decl->name);
+    Value cls = Value::make<ClassObject>(className);
+    for (const auto& member : decl->members) {
+        auto method = dyn_cast<pulse::parser::FunctionDeclaration>(member.get());
+        if (!method) {
+            syntaxError("class '" + className + "' may only contain method definitions");
+        }
+        std::string name(method->name);
+        auto code = compileFunction(method, className + "." + name);
+        cls.as<ClassObject>()->methods[intern(name)] =
+            Value::make<FunctionObject>(name, code, code->parameterCount);
+    }
+    return cls;
+}
+
+void BytecodeCompiler::beginProto(std::string name, size_t parameterCount, size_t frameSize) {
+    if (frameSize > std::numeric_limits<Reg>::max() / 2) {
+        syntaxError("too many variables in '" + name + "'");
+    }
+    proto = std::make_shared<FunctionProto>();
+    proto->name = std::move(name);
+    proto->parameterCount = static_cast<uint16_t>(parameterCount);
+    proto->registerCount = static_cast<uint16_t>(frameSize);
+    nextRegister = firstTemporary = static_cast<Reg>(frameSize);
+    globalIndex.clear();
+    stringConstants.clear();
+}
+
+std::shared_ptr<FunctionProto> BytecodeCompiler::endProto() {
+    return std::move(proto);
+}
+
+BytecodeCompiler::Reg BytecodeCompiler::allocate() {
+    if (nextRegister == std::numeric_limits<Reg>::max()) {
+        syntaxError("expression too complex in '" + proto->name + "'");
+    }
+    Reg reg = nextRegister++;
+    if (nextRegister > proto->registerCount) {
+        proto->registerCount = nextRegister;
+    }
+    return reg;
+}
+
+size_t BytecodeCompiler::emit(OpCode op, uint16_t a, uint16_t b, uint16_t c, uint8_t flag) {
+    proto->code.push_back(Instruction{op, flag, a, b, c});
+    return proto->code.size() - 1;
+}
+
+size_t BytecodeCompiler::emitJump() {
+    return emit(OpCode::JUMP);
+}
+
+// Offsets count from the instruction after the jump
+void BytecodeCompiler::patchJump(size_t jump) {
+    auto offset = static_cast<int64_t>(proto->code.size()) - static_cast<int64_t>(jump + 1);
+    if (offset > std::numeric_limits<int32_t>::max()) {
+        syntaxError("function '" + proto->name + "' is too large");
+    }
+    proto->code[jump].setImmediate(static_cast<int32_t>(offset));
+}
+
+void BytecodeCompiler::patchJumps(const std::vector<size_t>& jumps) {
+    for (size_t jump : jumps) {
+        patchJump(jump);
+    }
+}
+
+void BytecodeCompiler::emitLoop(size_t target) {
+    size_t loop = emit(OpCode::LOOP);
+    proto->code[loop].setImmediate(static_cast<int32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(loop + 1)));
+}
+
+uint16_t BytecodeCompiler::constant(Value value) {
+    auto& constants = proto->constants;
+    if (!value.isObject()) {
+        for (size_t i = 0; i < constants.size(); i++) {
+            const Value& existing = constants[i];
+            if (existing.getTag() == value.getTag() &&
+                (value.isFloat() ? existing.asFloat() == value.asFloat() && std::signbit(existing.asFloat()) ==
+                                       std::signbit(value.asFloat())
+                                 : existing.asInt() == value.asInt())) {
+                return static_cast<uint16_t>(i);
+            }
+        }
+    } else if (auto string = value.as<StringObject>()) {
+        auto it = stringConstants.find(string->value);
+        if (it != stringConstants.end()) return it->second;
+    }
+
+    if (constants.size() > std::numeric_limits<uint16_t>::max()) {
+        syntaxError("too many constants in '" + proto->name + "'");
+    }
+    auto index = static_cast<uint16_t>(constants.size());
+    if (auto string = value.as<StringObject>()) {
+        stringConstants.emplace(string->value, index);
+    }
+    constants.push_back(std::move(value));
+    return index;
+}
+
+uint16_t BytecodeCompiler::stringConstant(std::string_view text) {
+    return constant(Value::make<StringObject>(std::string(text)));
+}
+
+uint16_t BytecodeCompiler::globalSlot(Symbol name) {
+    auto [it, inserted] = globalIndex.try_emplace(name, static_cast<uint16_t>(proto->globals.size()));
+    if (inserted) {
+        if (proto->globals.size() > std::numeric_limits<uint16_t>::max()) {
+            syntaxError("too many global names in '" + proto->name + "'");
+        }
+        proto->globals.push_back(GlobalCache{name});
+    }
+    return it->second;
+}
+
+uint16_t BytecodeCompiler::attributeSlot(std::string_view name) {
+    // One cache per use site: sites see different receivers
+    if (proto->attributes.size() > std::numeric_limits<uint16_t>::max()) {
+        syntaxError("too many attribute accesses in '" + proto->name + "'");
+    }
+    AttributeCache cache;
+    cache.name = intern(name);
+    proto->attributes.push_back(std::move(cache));
+    return static_cast<uint16_t>(proto->attributes.size() - 1);
+}
+
+// Functions with more calls than operand values share the last profile
+uint16_t BytecodeCompiler::callSite() {
+    constexpr size_t last = std::numeric_limits<uint16_t>::max();
+    if (proto->callSites.size() < last) {
+        proto->callSites.emplace_back();
+    }
+    return static_cast<uint16_t>(proto->callSites.size() - 1);
+}
+
+const VariableSlot& BytecodeCompiler::slotOf(const pulse::parser::ASTNode* node) const {
+    const VariableSlot& slot = resolver.slotFor(node);
+    if (slot.kind == VariableSlot::Kind::LOCAL && slot.depth != 0) {
+        syntaxError("closures are not supported");
+    }
+    return slot;
+}
+
+// Statements
+
+void BytecodeCompiler::compileBlock(const Body& body) {
+    for (const auto& stmt : body) {
+        compileStatement(stmt.get());
+    }
+}
+
+void BytecodeCompiler::compileStatement(pulse::parser::Statement* stmt) {
+    Reg mark = nextRegister;
+    switch (stmt->getKind()) {
+        case pulse::parser::NodeKind::ASSIGNMENT:
+            compileAssignment(static_cast<pulse::parser::AssignmentStatement*>(stmt));
+            break;
+        case pulse::parser::NodeKind::EXPRESSION_STATEMENT:
+            compileInto(static_cast<pulse::parser::ExpressionStatement*>(stmt)->expression.get(), allocate());
+            break;
+        case pulse::parser::NodeKind::RETURN:
+            compileReturn(static_cast<pulse::parser::ReturnStatement*>(stmt));
+            break;
+        case pulse::parser::NodeKind::IF:
+            compileIf(static_cast<pulse::parser::IfStatement*>(stmt));
+            break;
+        case pulse::parser::NodeKind::WHILE:
+            compileWhile(static_cast<pulse::parser::WhileStatement*>(stmt));
+            break;
+        case pulse::parser::NodeKind::FOR:
+            compileFor(static_cast<pulse::parser::ForStatement*>(stmt));
+            break;
+        case pulse::parser::NodeKind::MATCH:
+            compileMatch(static_cast<pulse::parser::MatchStatement*>(stmt));
+            break;
+        default:
+            syntaxError("unsupported statement");
+    }
+    freeTo(mark);
+}
+
+// A local is computed straight into its slot: `total = total + i` is one ADD
+void BytecodeCompiler::compileAssignment(pulse::parser::AssignmentStatement* stmt) {
+    const VariableSlot& slot = slotOf(stmt);
+    if (slot.kind == VariableSlot::Kind::LOCAL) {
+        compileInto(stmt->value.get(), static_cast<Reg>(slot.index));
+        return;
+    }
+    Reg value = compileOperand(stmt->value.get());
+    emit(OpCode::SET_GLOBAL, value, globalSlot(slot.symbol));
+}
+
+void BytecodeCompiler::compileReturn(pulse::parser::ReturnStatement* stmt) {
+    if (!inFunction) {
+        syntaxError("'return' outside function");
+    }
+    if (!stmt->value) {
+        emit(OpCode::RETURN_NONE);
+        return;
+    }
+    emit(OpCode::RETURN, compileOperand(stmt->value.get()));
+}
+
+void BytecodeCompiler::compileIf(pulse::parser::IfStatement* stmt) {
+    std::vector<size_t> ends;
+    for (size_t i = 0; i < stmt->branches.size(); i++) {
+        const auto& branch = stmt->branches[i];
+        std::vector<size_t> next;
+        compileBranch(branch.condition.get(), false, next);
+        compileBlock(branch.body);
+        if (i + 1 < stmt->branches.size() || !stmt->else_body.empty()) {
+            ends.push_back(emitJump());
+        }
+        patchJumps(next);
+    }
+    compileBlock(stmt->else_body);
+    patchJumps(ends);
+}
+
+void BytecodeCompiler::compileWhile(pulse::parser::WhileStatement* stmt) {
+    size_t start = proto->code.size();
+    std::vector<size_t> exits;
+    compileBranch(stmt->condition.get(), false, exits);
+    compileBlock(stmt->body);
+    emitLoop(start);
+    patchJumps(exits);
+}
+
+// Where a loop writes each item: the variable's own slot when it is a local
+BytecodeCompiler::Reg BytecodeCompiler::loopTarget(const pulse::parser::ForStatement* stmt) {
+    const VariableSlot& slot = slotOf(stmt);
+    return slot.kind == VariableSlot::Kind::LOCAL ? static_cast<Reg>(slot.index) : allocate();
+}
+
+void BytecodeCompiler::storeLoopVariable(const pulse::parser::ForStatement* stmt, Reg value) {
+    const VariableSlot& slot = slotOf(stmt);
+    if (slot.kind == VariableSlot::Kind::GLOBAL) {
+        emit(OpCode::SET_GLOBAL, value, globalSlot(slot.symbol));
+    }
+}
+
+void BytecodeCompiler::compileFor(pulse::parser::ForStatement* stmt) {
+    if (compileRangeLoop(stmt)) {
+        return;
+    }
+
+    // R[base] holds the iterable, R[base + 1] the position
+    Reg base = allocate();
+    allocate();
+    compileInto(stmt->iterable.get(), base);
+    emit(OpCode::ITER_PREP, base);
+
+    Reg target = loopTarget(stmt);
+    size_t start = emit(OpCode::FOR_ITER, base, target);
+    size_t exit = emitJump();
+    storeLoopVariable(stmt, target);
+    compileBlock(stmt->body);
+    emitLoop(start);
+    patchJump(exit);
+}
+
+// for x in range(...) runs on three hidden int registers (counter, stop,
+// step) with no list and no iterator object; as in native code, range is
+// recognised by name unless the program defines its own
+bool BytecodeCompiler::compileRangeLoop(pulse::parser::ForStatement* stmt) {
+    auto call = dyn_cast<pulse::parser::CallExpression>(stmt->iterable.get());
+    if (!call || rangeShadowed) return false;
+    auto callee = dyn_cast<pulse::parser::IdentifierExpression>(call->callee.get());
+    if (!callee || callee->name != "range" || slotOf(callee).kind != VariableSlot::Kind::GLOBAL) return false;
+
+    const auto& args = call->arguments;
+    if (args.empty() || args.size() > 3) return false; // the range() builtin reports the error
+
+    Reg base = allocate();
+    allocate();
+    allocate();
+    if (args.size() == 1) {
+        emit(OpCode::LOAD_INT, base);
+        compileInto(args[0].get(), base + 1);
+    } else {
+        compileInto(args[0].get(), base);
+        compileInto(args[1].get(), base + 1);
+    }
+    if (args.size() == 3) {
+        compileInto(args[2].get(), base + 2);
+    } else {
+        proto->code[emit(OpCode::LOAD_INT, base + 2)].setImmediate(1);
+    }
+    emit(OpCode::RANGE_PREP, base);
+
+    Reg target = loopTarget(stmt);
+    size_t start = emit(OpCode::RANGE_NEXT, base, target);
+    size_t exit = emitJump();
+    storeLoopVariable(stmt, target);
+    compileBlock(stmt->body);
+    emitLoop(start);
+    patchJump(exit);
+    return true;
+}
+
+// Cases compare the subject, evaluated once, for equality in order; `_`
+// matches anything
+void BytecodeCompiler::compileMatch(pulse::parser::MatchStatement* stmt) {
+    Reg subject = allocate();
+    compileInto(stmt->value.get(), subject);
+
+    std::vector<size_t> ends;
+    for (const auto& [pattern, body] : stmt->cases) {
+        auto name = dyn_cast<pulse::parser::IdentifierExpression>(pattern.get());
+        if (name && name->name == "_") {
+            compileBlock(body);
+            break;
+        }
+
+        Reg mark = nextRegister;
+        if (auto value = literalConstant(pattern.get())) {
+            emit(OpCode::TEST_EQK, subject, constant(std::move(*value)));
+        } else {
+            emit(OpCode::TEST_EQ, subject, compileOperand(pattern.get()));
+        }
+        freeTo(mark);
+        size_t next = emitJump();
+        compileBlock(body);
+        ends.push_back(emitJump());
+        patchJump(next);
+    }
+    patchJumps(ends);
+}
+
+// Expressions
+
+BytecodeCompiler::Reg BytecodeCompiler::compileOperand(pulse::parser::Expression* expr) {
+    if (auto identifier = dyn_cast<pulse::parser::IdentifierExpression>(expr)) {
+        const VariableSlot& slot = slotOf(identifier);
+        if (slot.kind == VariableSlot::Kind::LOCAL) {
+            return static_cast<Reg>(slot.index);
+        }
+    }
+    Reg reg = allocate();
+    compileInto(expr, reg);
+    return reg;
+}
+
+void BytecodeCompiler::compileInto(pulse::parser::Expression* expr, Reg dest) {
+    Reg mark = nextRegister;
+    switch (expr->getKind()) {
+        case pulse::parser::NodeKind::LITERAL:
+            compileLiteral(static_cast<pulse::parser::LiteralExpression*>(expr), dest);
+            break;
+        case pulse::parser::NodeKind::IDENTIFIER: {
+            const VariableSlot& slot = slotOf(expr);
+            if (slot.kind == VariableSlot::Kind::GLOBAL) {
+                emit(OpCode::GET_GLOBAL, dest, globalSlot(slot.symbol));
+            } else if (slot.index != dest) {
+                emit(OpCode::MOVE, dest, static_cast<Reg>(slot.index));
+            }
+            break;
+        }
+        case pulse::parser::NodeKind::BINARY:
+            compileBinary(static_cast<BinaryExpression*>(expr), dest);
+            break;
+        case pulse::parser::NodeKind::UNARY: {
+            auto unary = static_cast<pulse::parser::UnaryExpression*>(expr);
+            if (unary->op == pulse::parser::UnaryExpression::Operator::AWAIT && !inAsync) {
+                syntaxError("'await' outside async function");
+            }
+            Reg operand = compileOperand(unary->operand.get());
+            switch (unary->op) {
+                case pulse::parser::UnaryExpression::Operator::MINUS: emit(OpCode::NEG, dest, operand); break;
+                case pulse::parser::UnaryExpression::Operator::PLUS: emit(OpCode::POS, dest, operand); break;
+                case pulse::parser::UnaryExpression::Operator::NOT: emit(OpCode::NOT, dest, operand); break;
+                case pulse::parser::UnaryExpression::Operator::AWAIT: emit(OpCode::AWAIT, dest, operand); break;
+            }
+            break;
+        }
+        case pulse::parser::NodeKind::CALL:
+            compileCall(static_cast<pulse::parser::CallExpression*>(expr), dest);
+            break;
+        case pulse::parser::NodeKind::ATTRIBUTE: {
+            auto attribute = static_cast<pulse::parser::AttributeExpression*>(expr);
+            Reg object = compileOperand(attribute->object.get());
+            emit(OpCode::GET_ATTR, dest, object, attributeSlot(attribute->attribute));
+            break;
+        }
+        case pulse::parser::NodeKind::SUBSCRIPT: {
+            auto subscript = static_cast<pulse::parser::SubscriptExpression*>(expr);
+            Reg object = compileOperand(subscript->object.get());
+            Reg index = compileOperand(subscript->index.get());
+            emit(OpCode::GET_INDEX, dest, object, index);
+            break;
+        }
+        case pulse::parser::NodeKind::LIST:
+            compileSequence(static_cast<pulse::parser::ListExpression*>(expr)->elements, dest, OpCode::BUILD_LIST);
+            break;
+        case pulse::parser::NodeKind::TUPLE:
+            // Tuples are lists marked immutable at run time
+            compileSequence(static_cast<pulse::parser::TupleExpression*>(expr)->elements, dest, OpCode::BUILD_TUPLE);
+            break;
+        case pulse::parser::NodeKind::DICT:
+            compileDict(static_cast<pulse::parser::DictExpression*>(expr), dest);
+            break;
+        default:
+            syntaxError("unsupported expression");
+    }
+    freeTo(mark);
+}
+
+void BytecodeCompiler::compileLiteral(pulse::parser::LiteralExpression* literal, Reg dest) {
+    if (auto value = std::get_if<int64_t>(&literal->value)) {
+        if (*value >= std::numeric_limits<int32_t>::min() && *value <= std::numeric_limits<int32_t>::max()) {
+            proto->code[emit(OpCode::LOAD_INT, dest)].setImmediate(static_cast<int32_t>(*value));
+        } else {
+            emit(OpCode::LOAD_CONST, dest, constant(Value::fromInt(*value)));
+        }
+    } else if (auto value = std::get_if<double>(&literal->value)) {
+        emit(OpCode::LOAD_CONST, dest, constant(Value::fromFloat(*value)));
+    } else if (auto value = std::get_if<std::string_view>(&literal->value)) {
+        emit(OpCode::LOAD_CONST, dest, stringConstant(*value));
+    } else if (auto value = std::get_if<bool>(&literal->value)) {
+        emit(OpCode::LOAD_BOOL, dest, 0, 0, *value);
+    } else {
+        emit(OpCode::LOAD_NONE, dest);
+    }
+}
+
+void BytecodeCompiler::compileBinary(BinaryExpression* expr, Reg dest) {
+    using Operator = BinaryExpression::Operator;
+    if (expr->op == Operator::AND || expr->op == Operator::OR) {
+        compileLogical(expr, dest);
+        return;
+    }
+
+    // x + 1, x - 1.5, s * 2: the constant stays in K instead of a register
+    if (expr->op == Operator::ADD || expr->op == Operator::SUBTRACT || expr->op == Operator::MULTIPLY) {
+        if (auto value = literalConstant(expr->right.get())) {
+            Reg left = compileOperand(expr->left.get());
+            OpCode op = expr->op == Operator::ADD ? OpCode::ADDK
+                      : expr->op == Operator::SUBTRACT ? OpCode::SUBK : OpCode::MULK;
+            emit(op, dest, left, constant(std::move(*value)));
+            return;
+        }
+    }
+
+    Reg left = compileOperand(expr->left.get());
+    Reg right = compileOperand(expr->right.get());
+    OpCode op;
+    switch (expr->op) {
+        case Operator::ADD: op = OpCode::ADD; break;
+        case Operator::SUBTRACT: op = OpCode::SUB; break;
+        case Operator::MULTIPLY: op = OpCode::MUL; break;
+        case Operator::DIVIDE: op = OpCode::DIV; break;
+        case Operator::FLOOR_DIVIDE: op = OpCode::FLOOR_DIV; break;
+        case Operator::MODULO: op = OpCode::MOD; break;
+        case Operator::POWER: op = OpCode::POW; break;
+        default: op = offsetOp(OpCode::EQ, comparisonIndex(expr->op)); break;
+    }
+    emit(op, dest, left, right);
+}
+
+// `a and b` is a when a is falsy, else b (and `or` the converse). The left
+// value lands in dest before the right side runs, so a variable's own slot
+// is only used when the right side cannot read it.
+void BytecodeCompiler::compileLogical(BinaryExpression* expr, Reg dest) {
+    Reg result = dest < firstTemporary ? allocate() : dest;
+    compileInto(expr->left.get(), result);
+    emit(OpCode::TEST, result, 0, 0, expr->op == BinaryExpression::Operator::OR);
+    size_t end = emitJump();
+    compileInto(expr->right.get(), result);
+    patchJump(end);
+    if (result != dest) {
+        emit(OpCode::MOVE, dest, result);
+    }
+}
+
+// Conditions never materialise a bool: comparisons become compare-and-branch
+// instructions and and/or/not become control flow
+void BytecodeCompiler::compileBranch(pulse::parser::Expression* expr, bool jumpWhen, std::vector<size_t>& jumps) {
+    using Operator = BinaryExpression::Operator;
+    Reg mark = nextRegister;
+
+    if (auto unary = dyn_cast<pulse::parser::UnaryExpression>(expr)) {
+        if (unary->op == pulse::parser::UnaryExpression::Operator::NOT) {
+            compileBranch(unary->operand.get(), !jumpWhen, jumps);
+            return;
+        }
+    }
+
+    if (auto binary = dyn_cast<BinaryExpression>(expr)) {
+        if (binary->op == Operator::AND || binary->op == Operator::OR) {
+            // The left side decides alone when it is falsy (and) or truthy (or)
+            bool decisive = binary->op == Operator::OR;
+            if (jumpWhen == decisive) {
+                compileBranch(binary->left.get(), jumpWhen, jumps);
+                compileBranch(binary->right.get(), jumpWhen, jumps);
+            } else {
+                std::vector<size_t> skip;
+                compileBranch(binary->left.get(), decisive, skip);
+                compileBranch(binary->right.get(), jumpWhen, jumps);
+                patchJumps(skip);
+            }
+            return;
+        }
+
+        if (isComparison(binary->op)) {
+            Reg left = compileOperand(binary->left.get());
+            int index = comparisonIndex(binary->op);
+            if (auto value = literalConstant(binary->right.get())) {
+                emit(offsetOp(OpCode::TEST_EQK, index), left, constant(std::move(*value)), 0, jumpWhen);
+            } else {
+                Reg right = compileOperand(binary->right.get());
+                emit(offsetOp(OpCode::TEST_EQ, index), left, right, 0, jumpWhen);
+            }
+            jumps.push_back(emitJump());
+            freeTo(mark);
+            return;
+        }
+    }
+
+    emit(OpCode::TEST, compileOperand(expr), 0, 0, jumpWhen);
+    jumps.push_back(emitJump());
+    freeTo(mark);
+}
+
+// A call's callee (or receiver) and arguments sit in consecutive registers;
+// the callee's frame starts right there, so arguments are never copied
+void BytecodeCompiler::compileCall(pulse::parser::CallExpression* expr, Reg dest) {
+    // A temporary on top of the register stack can hold the callee itself
+    Reg base = dest >= firstTemporary && dest + 1 == nextRegister ? dest : allocate();
+    auto method = dyn_cast<pulse::parser::AttributeExpression>(expr->callee.get());
+    compileInto(method ? method->object.get() : expr->callee.get(), base);
+
+    for (const auto& argument : expr->arguments) {
+        compileInto(argument.get(), allocate());
+    }
+    auto count = static_cast<uint16_t>(expr->arguments.size());
+
+    if (method) {
+        emit(OpCode::CALL_METHOD, base, count, attributeSlot(method->attribute));
+    } else {
+        emit(OpCode::CALL, base, count, callSite());
+    }
+    if (dest != base) {
+        emit(OpCode::MOVE, dest, base);
+    }
+}
+
+void BytecodeCompiler::compileSequence(const pulse::parser::ArenaVector<pulse::parser::ExpressionPtr>& elements,
+                                       Reg dest, OpCode build) {
+    Reg first = nextRegister;
+    for (const auto& element : elements) {
+        compileInto(element.get(), allocate());
+    }
+    emit(build, dest, first, static_cast<uint16_t>(elements.size()));
+}
+
+void BytecodeCompiler::compileDict(pulse::parser::DictExpression* expr, Reg dest) {
+    Reg first = nextRegister;
+    for (const auto& pair : expr->pairs) {
+        compileInto(pair.key.get(), allocate());
+        compileInto(pair.value.get(), allocate());
+    }
+    emit(OpCode::BUILD_DICT, dest, first, static_cast<uint16_t>(expr->pairs.size()));
+}
+
+} // namespace pulse::runtime
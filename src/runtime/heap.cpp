@@ -0,0 +1,332 @@
+#include "runtime/heap.hpp"
+#include <algorithm>
+#include <cstdio>
+#include "driver/report_format.hpp"
+#include "runtime/value.hpp"
+
+namespace pulse::runtime {
+
+namespace {
+
+enum : uint8_t { UNMARKED, CANDIDATE, REACHABLE };
+
+constexpr size_t GRANULE = 16;
+
+size_t sizeClass(size_t size) {
+    return (size + GRANULE - 1) / GRANULE - 1;
+}
+
+ContainerObject* asContainer(const Value& value) {
+    if (!value.isObject()) return nullptr;
+    switch (value.getType()) {
+        case ValueType::LIST:
+        case ValueType::DICT:
+        case ValueType::CLASS:
+        case ValueType::CLASS_INSTANCE:
+        case ValueType::COROUTINE:
+        case ValueType::FUTURE:
+            return static_cast<ContainerObject*>(value.asObject());
+        default:
+            return nullptr;
+    }
+}
+
+template <typename Visit>
+void forEachReference(const Completion& completion, Visit& visit) {
+    visit(completion.result);
+    for (const Value& waiter : completion.waiters) visit(waiter);
+}
+
+// Calls visit with every Value object holds directly
+template <typename Visit>
+void forEachReference(ContainerObject* object, Visit visit) {
+    switch (object->getType()) {
+        case ValueType::LIST:
+            for (const Value& element : static_cast<ListObject*>(object)->valueElements()) visit(element);
+            break;
+        case ValueType::DICT:
+            for (const auto& entry : static_cast<DictObject*>(object)->items()) {
+                visit(entry.key);
+                visit(entry.value);
+            }
+            break;
+        case ValueType::CLASS: {
+            auto cls = static_cast<ClassObject*>(object);
+            visit(cls->base);
+            for (const auto& [name, method] : cls->methods) visit(method);
+            break;
+        }
+        case ValueType::CLASS_INSTANCE: {
+            auto instance = static_cast<InstanceObject*>(object);
+            visit(instance->cls);
+            for (const auto& [name, field] : instance->fields) visit(field);
+            break;
+        }
+        case ValueType::COROUTINE: {
+            auto coroutine = static_cast<CoroutineObject*>(object);
+            visit(coroutine->function);
+            visit(coroutine->awaiting);
+            for (const Value& reg : coroutine->registers) visit(reg);
+            forEachReference(coroutine->completion, visit);
+            break;
+        }
+        case ValueType::FUTURE: {
+            auto future = static_cast<FutureObject*>(object);
+            for (const Value& part : future->gathered) visit(part);
+            forEachReference(future->completion, visit);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Drops every reference object holds, breaking the cycles through it
+void clearReferences(ContainerObject* object) {
+    switch (object->getType()) {
+        case ValueType::LIST:
+            static_cast<ListObject*>(object)->clear();
+            break;
+        case ValueType::DICT:
+            static_cast<DictObject*>(object)->clear();
+            break;
+        case ValueType::CLASS: {
+            auto cls = static_cast<ClassObject*>(object);
+            auto methods = std::move(cls->methods);
+            cls->methods.clear();
+            Value base = std::move(cls->base);
+            break;
+        }
+        case ValueType::CLASS_INSTANCE: {
+            auto instance = static_cast<InstanceObject*>(object);
+            auto fields = std::move(instance->fields);
+            instance->fields.clear();
+            Value cls = std::move(instance->cls);
+            break;
+        }
+        case ValueType::COROUTINE: {
+            auto coroutine = static_cast<CoroutineObject*>(object);
+            auto registers = std::move(coroutine->registers);
+            auto waiters = std::move(coroutine->completion.waiters);
+            Value result = std::move(coroutine->completion.result);
+            Value awaiting = std::move(coroutine->awaiting);
+            break;
+        }
+        case ValueType::FUTURE: {
+            auto future = static_cast<FutureObject*>(object);
+            auto gathered = std::move(future->gathered);
+            auto waiters = std::move(future->completion.waiters);
+            Value result = std::move(future->completion.result);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+} // namespace
+
+Heap& Heap::current() {
+    // Never destroyed: objects in statics may be released after the thread's
+    // thread_local destructors ran
+    static thread_local Heap* heap = new Heap;
+    return *heap;
+}
+
+void* Heap::allocate(size_t size) {
+    counters.allocations++;
+    counters.allocatedBytes += size;
+    counters.liveObjects++;
+    counters.liveBytes += size;
+    if (counters.liveBytes > counters.peakBytes) counters.peakBytes = counters.liveBytes;
+
+    if (size > MAX_SMALL) return ::operator new(size);
+    size_t index = sizeClass(size);
+    if (void* block = freeLists[index]) {
+        freeLists[index] = *static_cast<void**>(block);
+        return block;
+    }
+    size_t rounded = (index + 1) * GRANULE;
+    if (static_cast<size_t>(bumpEnd - bump) < rounded) refill();
+    void* block = bump;
+    bump += rounded;
+    return block;
+}
+
+void Heap::release(void* block, size_t size) noexcept {
+    counters.liveObjects--;
+    counters.liveBytes -= size;
+
+    if (size > MAX_SMALL) {
+        ::operator delete(block);
+        return;
+    }
+    size_t index = sizeClass(size);
+    *static_cast<void**>(block) = freeLists[index];
+    freeLists[index] = block;
+}
+
+void Heap::refill() {
+    // The rest of the old chunk goes to the free lists of its size
+    while (static_cast<size_t>(bumpEnd - bump) >= GRANULE) {
+        size_t rest = static_cast<size_t>(bumpEnd - bump);
+        size_t index = sizeClass(std::min(rest, MAX_SMALL) / GRANULE * GRANULE);
+        *reinterpret_cast<void**>(bump) = freeLists[index];
+        freeLists[index] = bump;
+        bump += (index + 1) * GRANULE;
+    }
+    char* chunk = static_cast<char*>(::operator new(CHUNK));
+    chunks.push_back(chunk);
+    bump = chunk;
+    bumpEnd = chunk + CHUNK;
+}
+
+void Heap::link(Generation& generation, ContainerObject* object) noexcept {
+    object->gcPrev = nullptr;
+    object->gcNext = generation.head;
+    if (generation.head) generation.head->gcPrev = object;
+    generation.head = object;
+    generation.count++;
+}
+
+void Heap::unlink(Generation& generation, ContainerObject* object) noexcept {
+    if (object->gcPrev) {
+        object->gcPrev->gcNext = object->gcNext;
+    } else {
+        generation.head = object->gcNext;
+    }
+    if (object->gcNext) object->gcNext->gcPrev = object->gcPrev;
+    object->gcPrev = object->gcNext = nullptr;
+    generation.count--;
+}
+
+void Heap::beforeContainer() {
+    if (!automatic || collecting || young.count < YOUNG_THRESHOLD) return;
+    // Full collections only once the old generation grew by a quarter, so
+    // a program building a large structure does not rescan it over and over
+    bool full = ++youngSinceFull >= FULL_EVERY && old.count + young.count > oldAfterFull + oldAfterFull / 4;
+    collect(full);
+}
+
+void Heap::track(ContainerObject* object) noexcept {
+    object->gcOld = false;
+    link(young, object);
+    counters.tracked++;
+}
+
+void Heap::untrack(ContainerObject* object) noexcept {
+    unlink(object->gcOld ? old : young, object);
+    counters.tracked--;
+}
+
+size_t Heap::collect(bool full) {
+    if (collecting) return 0;
+    collecting = true;
+    auto start = std::chrono::steady_clock::now();
+
+    if (full) {
+        // The young generation joins the old one, and both are checked
+        while (ContainerObject* object = young.head) {
+            unlink(young, object);
+            object->gcOld = true;
+            link(old, object);
+        }
+    }
+    size_t freed = collectGeneration(full ? old : young);
+    if (full) {
+        counters.fullCollections++;
+        youngSinceFull = 0;
+        oldAfterFull = old.count;
+    } else {
+        counters.youngCollections++;
+        // Survivors are promoted
+        while (ContainerObject* object = young.head) {
+            unlink(young, object);
+            object->gcOld = true;
+            link(old, object);
+        }
+    }
+
+    auto pause = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    counters.pauseTotal += pause;
+    if (pause > counters.pauseMax) counters.pauseMax = pause;
+    collecting = false;
+    return freed;
+}
+
+size_t Heap::collectGeneration(Generation& generation) {
+    // Count the references from outside the generation: each object's count
+    // less those from the objects being checked
+    for (ContainerObject* object = generation.head; object; object = object->gcNext) {
+        object->gcRefs = object->getRefCount();
+        object->gcMark = CANDIDATE;
+    }
+    for (ContainerObject* object = generation.head; object; object = object->gcNext) {
+        forEachReference(object, [](const Value& value) {
+            ContainerObject* child = asContainer(value);
+            if (child && child->gcMark == CANDIDATE) child->gcRefs--;
+        });
+    }
+
+    // Whatever those with outside references lead to is alive
+    std::vector<ContainerObject*> pending;
+    for (ContainerObject* object = generation.head; object; object = object->gcNext) {
+        if (object->gcRefs > 0 && object->gcMark == CANDIDATE) {
+            object->gcMark = REACHABLE;
+            pending.push_back(object);
+        }
+        while (!pending.empty()) {
+            ContainerObject* alive = pending.back();
+            pending.pop_back();
+            forEachReference(alive, [&pending](const Value& value) {
+                ContainerObject* child = asContainer(value);
+                if (child && child->gcMark == CANDIDATE) {
+                    child->gcMark = REACHABLE;
+                    pending.push_back(child);
+                }
+            });
+        }
+    }
+
+    std::vector<ContainerObject*> garbage;
+    for (ContainerObject* object = generation.head; object; object = object->gcNext) {
+        if (object->gcMark == CANDIDATE) garbage.push_back(object);
+        object->gcMark = UNMARKED;
+    }
+
+    // Held while their references are dropped, so none is destroyed while
+    // another still points at it; the releases then free them all
+    for (ContainerObject* object : garbage) object->retain();
+    for (ContainerObject* object : garbage) clearReferences(object);
+    for (ContainerObject* object : garbage) object->release();
+
+    counters.collected += garbage.size();
+    return garbage.size();
+}
+
+std::string Heap::report() const {
+    using pulse::driver::formatBytes;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - created).count();
+    double rate = seconds > 0 ? static_cast<double>(counters.allocatedBytes) / seconds : 0;
+    auto milliseconds = [](std::chrono::nanoseconds duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    };
+
+    char text[512];
+    std::snprintf(text, sizeof(text),
+                  "heap: %llu objects allocated, %s (%s/s)\n"
+                  "heap: %zu live objects, %s live, %s peak, %zu containers tracked\n"
+                  "heap: %llu young and %llu full collections freed %llu objects in cycles; "
+                  "pauses %.3f ms total, %.3f ms max\n",
+                  static_cast<unsigned long long>(counters.allocations),
+                  formatBytes(static_cast<double>(counters.allocatedBytes)).c_str(), formatBytes(rate).c_str(),
+                  counters.liveObjects, formatBytes(static_cast<double>(counters.liveBytes)).c_str(),
+                  formatBytes(static_cast<double>(counters.peakBytes)).c_str(), counters.tracked,
+                  static_cast<unsigned long long>(counters.youngCollections),
+                  static_cast<unsigned long long>(counters.fullCollections),
+                  static_cast<unsigned long long>(counters.collected), milliseconds(counters.pauseTotal),
+                  milliseconds(counters.pauseMax));
+    return text;
+}
+
+} // namespace pulse::runtime
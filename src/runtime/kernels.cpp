@@ -0,0 +1,57 @@
+// The portable build of the numeric kernels (NEON on AArch64, where it is
+// the baseline) and the choice of the build to run
+#define PULSE_KERNEL_ISA generic
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PULSE_KERNEL_NAME "neon"
+#else
+#define PULSE_KERNEL_NAME "generic"
+#endif
+#include "runtime/kernel_loops.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace pulse::runtime::kernels {
+
+#if defined(PULSE_KERNELS_X86)
+namespace sse42 { extern const KernelTable table; }
+namespace avx2 { extern const KernelTable table; }
+namespace avx512 { extern const KernelTable table; }
+#endif
+
+namespace {
+
+const KernelTable& choose() {
+    const char* cap = std::getenv("PULSE_SIMD");
+    auto allowed = [cap](const char* name) {
+        if (!cap || !*cap) return true;
+        // Builds from the widest down; allowed until the cap is passed
+        static const char* const ORDER[] = {"avx512", "avx2", "sse4.2"};
+        for (const char* wider : ORDER) {
+            if (std::strcmp(wider, cap) == 0) return true;
+            if (std::strcmp(wider, name) == 0) return false;
+        }
+        return false;
+    };
+    (void)allowed;
+
+#if defined(PULSE_KERNELS_X86)
+    __builtin_cpu_init();
+    if (allowed("avx512") && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") &&
+        __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl")) {
+        return avx512::table;
+    }
+    if (allowed("avx2") && __builtin_cpu_supports("avx2")) return avx2::table;
+    if (allowed("sse4.2") && __builtin_cpu_supports("sse4.2")) return sse42::table;
+#endif
+    return generic::table;
+}
+
+} // namespace
+
+const KernelTable& active() {
+    static const KernelTable& table = choose();
+    return table;
+}
+
+} // namespace pulse::runtime::kernels
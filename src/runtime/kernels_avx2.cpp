@@ -0,0 +1,4 @@
+// The numeric kernels for AVX2, built with -mavx2 (see CMakeLists.txt)
+#define PULSE_KERNEL_ISA avx2
+#define PULSE_KERNEL_NAME "avx2"
+#include "runtime/kernel_loops.hpp"
@@ -0,0 +1,4 @@
+// The numeric kernels for AVX-512, built with -mavx512f -mavx512dq -mavx512bw -mavx512vl (see CMakeLists.txt)
+#define PULSE_KERNEL_ISA avx512
+#define PULSE_KERNEL_NAME "avx512"
+#include "runtime/kernel_loops.hpp"
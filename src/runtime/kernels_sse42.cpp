@@ -0,0 +1,4 @@
+// The numeric kernels for SSE4.2, built with -msse4.2 (see CMakeLists.txt)
+#define PULSE_KERNEL_ISA sse42
+#define PULSE_KERNEL_NAME "sse4.2"
+#include "runtime/kernel_loops.hpp"
@@ -0,0 +1,517 @@
+// Numeric builtins: sum, min, max, abs, map and filter. Lists of ints or
+// floats are processed in place of their unboxed storage by the kernels;
+// everything else goes element by element with Python semantics.
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include "runtime/bytecode.hpp"
+#include "runtime/kernels.hpp"
+#include "runtime/runtime.hpp"
+
+namespace pulse::runtime {
+
+namespace {
+
+using Storage = ListObject::Storage;
+
+int64_t wrapAdd(int64_t a, int64_t b) { return static_cast<int64_t>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b)); }
+
+const ListObject& iterableList(const Value& value) {
+    auto list = value.as<ListObject>();
+    if (!list) {
+        throw RuntimeError(std::string("TypeError: '") + typeName(value.getType()) + "' object is not iterable");
+    }
+    return *list;
+}
+
+// a < b the way the VM's LT compares
+bool lessThan(const Value& a, const Value& b) {
+    if (a.isNumber() && b.isNumber()) {
+        if (a.isFloat() || b.isFloat()) return a.toFloat() < b.toFloat();
+        int64_t left = a.isInt() ? a.asInt() : a.asBool();
+        int64_t right = b.isInt() ? b.asInt() : b.asBool();
+        return left < right;
+    }
+    auto left = a.as<StringObject>();
+    auto right = b.as<StringObject>();
+    if (left && right) return left->value < right->value;
+    throw RuntimeError(std::string("TypeError: '<' not supported between instances of '") + typeName(a.getType()) +
+                       "' and '" + typeName(b.getType()) + "'");
+}
+
+// The first smallest (or largest) of count values, as Python's min() and max()
+template <typename Get>
+Value extremeOf(size_t count, Get get, bool min) {
+    Value best = get(0);
+    for (size_t i = 1; i < count; i++) {
+        Value item = get(i);
+        if (min ? lessThan(item, best) : lessThan(best, item)) best = std::move(item);
+    }
+    return best;
+}
+
+// A function whose body is straight-line arithmetic and comparisons on its
+// parameters and number constants, translated from its bytecode into steps
+// that each run one kernel over a block of elements. Only what the kernels
+// compute exactly like the VM qualifies: +, -, *, unary -, and comparisons
+// of ints and floats.
+class VectorProgram {
+public:
+    enum class Kind : uint8_t { NONE, INT, FLOAT, BOOL };
+
+    static constexpr size_t BLOCK = 256;
+
+    // Empty when proto cannot be run this way on lists of these storages
+    static std::optional<VectorProgram> compile(const FunctionProto& proto, std::span<const Storage> parameters);
+
+    Kind resultKind() const { return kinds[result]; }
+
+    // Runs elements [begin, begin + n) of the lists, n <= BLOCK; the
+    // result column is valid until the next run
+    void run(std::span<const ListObject* const> lists, size_t begin, size_t n);
+    const int64_t* ints() const { return columns[result].ints; }
+    const double* floats() const { return columns[result].floats; }
+    const uint8_t* bools() const { return columns[result].bools; }
+
+private:
+    enum class Op : uint8_t { PARAMETER, INT, FLOAT, COPY, WIDEN, ARITH, NEGATE, COMPARE };
+
+    struct Step {
+        Op op;
+        Kind kind; // of the operands
+        uint8_t sub = 0; // kernels::Arith or kernels::Compare
+        uint16_t dest = 0, a = 0, b = 0;
+        int64_t intValue = 0;
+        double floatValue = 0;
+    };
+
+    // Where a register's block is: its own buffers, or a parameter's list
+    struct Column {
+        const int64_t* ints = nullptr;
+        const double* floats = nullptr;
+        const uint8_t* bools = nullptr;
+    };
+
+    struct Buffers {
+        std::vector<int64_t> ints;
+        std::vector<double> floats;
+        std::vector<uint8_t> bools;
+    };
+
+    std::vector<Step> steps;
+    std::vector<Kind> kinds; // of each register once the steps ran
+    uint16_t result = 0;
+    std::vector<Column> columns;
+    std::vector<Buffers> buffers;
+
+    uint16_t addRegister(Kind kind) {
+        kinds.push_back(kind);
+        return static_cast<uint16_t>(kinds.size() - 1);
+    }
+    // A register holding reg as a float, widening it if needed
+    uint16_t asFloat(uint16_t reg);
+    bool loadConstant(const Value& constant, uint16_t dest);
+    bool binary(Op op, uint8_t sub, uint16_t dest, uint16_t a, uint16_t b);
+
+    int64_t* intBuffer(uint16_t reg) {
+        auto& data = buffers[reg].ints;
+        if (data.empty()) data.resize(BLOCK);
+        columns[reg].ints = data.data();
+        return data.data();
+    }
+    double* floatBuffer(uint16_t reg) {
+        auto& data = buffers[reg].floats;
+        if (data.empty()) data.resize(BLOCK);
+        columns[reg].floats = data.data();
+        return data.data();
+    }
+    uint8_t* boolBuffer(uint16_t reg) {
+        auto& data = buffers[reg].bools;
+        if (data.empty()) data.resize(BLOCK);
+        columns[reg].bools = data.data();
+        return data.data();
+    }
+};
+
+uint16_t VectorProgram::asFloat(uint16_t reg) {
+    if (kinds[reg] == Kind::FLOAT) return reg;
+    uint16_t widened = addRegister(Kind::FLOAT);
+    steps.push_back({Op::WIDEN, Kind::INT, 0, widened, reg, 0});
+    return widened;
+}
+
+bool VectorProgram::loadConstant(const Value& constant, uint16_t dest) {
+    if (constant.isInt()) {
+        steps.push_back({Op::INT, Kind::INT, 0, dest, 0, 0, constant.asInt()});
+        kinds[dest] = Kind::INT;
+    } else if (constant.isFloat()) {
+        steps.push_back({Op::FLOAT, Kind::FLOAT, 0, dest, 0, 0, 0, constant.asFloat()});
+        kinds[dest] = Kind::FLOAT;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool VectorProgram::binary(Op op, uint8_t sub, uint16_t dest, uint16_t a, uint16_t b) {
+    Kind left = kinds[a], right = kinds[b];
+    if ((left != Kind::INT && left != Kind::FLOAT) || (right != Kind::INT && right != Kind::FLOAT)) return false;
+    Kind kind = left == Kind::INT && right == Kind::INT ? Kind::INT : Kind::FLOAT;
+    if (kind == Kind::FLOAT) {
+        a = asFloat(a);
+        b = asFloat(b);
+    }
+    steps.push_back({op, kind, sub, dest, a, b});
+    kinds[dest] = op == Op::COMPARE ? Kind::BOOL : kind;
+    return true;
+}
+
+std::optional<VectorProgram> VectorProgram::compile(const FunctionProto& proto, std::span<const Storage> parameters) {
+    if (proto.parameterCount != parameters.size()) return std::nullopt;
+
+    VectorProgram program;
+    program.kinds.assign(proto.registerCount, Kind::NONE);
+    for (uint16_t i = 0; i < proto.parameterCount; i++) {
+        if (parameters[i] == Storage::VALUE) return std::nullopt;
+        program.kinds[i] = parameters[i] == Storage::INT ? Kind::INT : Kind::FLOAT;
+        program.steps.push_back({Op::PARAMETER, program.kinds[i], 0, i, i, 0});
+    }
+
+    // Constants of the K forms go to a register of their own
+    auto constantRegister = [&program](const Value& constant) -> std::optional<uint16_t> {
+        uint16_t reg = program.addRegister(Kind::NONE);
+        if (!program.loadConstant(constant, reg)) return std::nullopt;
+        return reg;
+    };
+
+    for (const Instruction& instruction : proto.code) {
+        bool ok = true;
+        switch (instruction.op) {
+            case OpCode::LOAD_INT:
+                ok = program.loadConstant(Value::fromInt(instruction.immediate()), instruction.a);
+                break;
+            case OpCode::LOAD_CONST:
+                ok = program.loadConstant(proto.constants[instruction.b], instruction.a);
+                break;
+            case OpCode::MOVE:
+            case OpCode::POS: {
+                Kind kind = program.kinds[instruction.b];
+                ok = kind == Kind::INT || kind == Kind::FLOAT || (kind == Kind::BOOL && instruction.op == OpCode::MOVE);
+                program.steps.push_back({Op::COPY, kind, 0, instruction.a, instruction.b, 0});
+                program.kinds[instruction.a] = kind;
+                break;
+            }
+            case OpCode::ADD:
+            case OpCode::SUB:
+            case OpCode::MUL: {
+                auto sub = instruction.op == OpCode::ADD   ? kernels::Arith::ADD
+                           : instruction.op == OpCode::SUB ? kernels::Arith::SUB
+                                                           : kernels::Arith::MUL;
+                ok = program.binary(Op::ARITH, static_cast<uint8_t>(sub), instruction.a, instruction.b, instruction.c);
+                break;
+            }
+            case OpCode::ADDK:
+            case OpCode::SUBK:
+            case OpCode::MULK: {
+                auto constant = constantRegister(proto.constants[instruction.c]);
+                auto sub = instruction.op == OpCode::ADDK   ? kernels::Arith::ADD
+                           : instruction.op == OpCode::SUBK ? kernels::Arith::SUB
+                                                            : kernels::Arith::MUL;
+                ok = constant && program.binary(Op::ARITH, static_cast<uint8_t>(sub), instruction.a, instruction.b,
+                                                *constant);
+                break;
+            }
+            case OpCode::EQ:
+            case OpCode::NE:
+            case OpCode::LT:
+            case OpCode::LE:
+            case OpCode::GT:
+            case OpCode::GE: {
+                auto sub = static_cast<uint8_t>(static_cast<int>(instruction.op) - static_cast<int>(OpCode::EQ));
+                ok = program.binary(Op::COMPARE, sub, instruction.a, instruction.b, instruction.c);
+                break;
+            }
+            case OpCode::NEG: {
+                Kind kind = program.kinds[instruction.b];
+                ok = kind == Kind::INT || kind == Kind::FLOAT;
+                program.steps.push_back({Op::NEGATE, kind, 0, instruction.a, instruction.b, 0});
+                program.kinds[instruction.a] = kind;
+                break;
+            }
+            case OpCode::RETURN:
+                if (program.kinds[instruction.a] == Kind::NONE) return std::nullopt;
+                program.result = instruction.a;
+                program.columns.resize(program.kinds.size());
+                program.buffers.resize(program.kinds.size());
+                return program;
+            default:
+                return std::nullopt;
+        }
+        if (!ok) return std::nullopt;
+    }
+    return std::nullopt;
+}
+
+static_assert(static_cast<int>(OpCode::GE) - static_cast<int>(OpCode::EQ) == static_cast<int>(kernels::Compare::GE),
+              "Comparison opcodes and kernels::Compare must be in the same order");
+
+void VectorProgram::run(std::span<const ListObject* const> lists, size_t begin, size_t n) {
+    const kernels::KernelTable& k = kernels::active();
+    for (const Step& step : steps) {
+        // Read the operands before the destination is pointed at its buffer:
+        // it may be one of them
+        Column a = columns[step.a];
+        Column b = columns[step.b];
+        switch (step.op) {
+            case Op::PARAMETER:
+                if (step.kind == Kind::INT) {
+                    columns[step.dest].ints = lists[step.a]->intElements().data() + begin;
+                } else {
+                    columns[step.dest].floats = lists[step.a]->floatElements().data() + begin;
+                }
+                break;
+            case Op::INT:
+                std::fill_n(intBuffer(step.dest), n, step.intValue);
+                break;
+            case Op::FLOAT:
+                std::fill_n(floatBuffer(step.dest), n, step.floatValue);
+                break;
+            case Op::COPY:
+                if (step.dest == step.a) break;
+                if (step.kind == Kind::INT) std::copy_n(a.ints, n, intBuffer(step.dest));
+                else if (step.kind == Kind::FLOAT) std::copy_n(a.floats, n, floatBuffer(step.dest));
+                else std::copy_n(a.bools, n, boolBuffer(step.dest));
+                break;
+            case Op::WIDEN:
+                k.widen(a.ints, floatBuffer(step.dest), n);
+                break;
+            case Op::ARITH:
+                if (step.kind == Kind::INT) {
+                    k.arithInt(static_cast<kernels::Arith>(step.sub), a.ints, b.ints, intBuffer(step.dest), n);
+                } else {
+                    k.arithFloat(static_cast<kernels::Arith>(step.sub), a.floats, b.floats, floatBuffer(step.dest), n);
+                }
+                break;
+            case Op::NEGATE:
+                if (step.kind == Kind::INT) k.negateInt(a.ints, intBuffer(step.dest), n);
+                else k.negateFloat(a.floats, floatBuffer(step.dest), n);
+                break;
+            case Op::COMPARE:
+                if (step.kind == Kind::INT) {
+                    k.compareInt(static_cast<kernels::Compare>(step.sub), a.ints, b.ints, boolBuffer(step.dest), n);
+                } else {
+                    k.compareFloat(static_cast<kernels::Compare>(step.sub), a.floats, b.floats, boolBuffer(step.dest),
+                                   n);
+                }
+                break;
+        }
+    }
+}
+
+// The vector program of function over lists, if it has one
+std::optional<VectorProgram> vectorize(const Value& function, std::span<const ListObject* const> lists) {
+    auto object = function.as<FunctionObject>();
+    if (!object || !object->code) return std::nullopt;
+    std::vector<Storage> storages;
+    for (const ListObject* list : lists) storages.push_back(list->getStorage());
+    return VectorProgram::compile(*object->code, storages);
+}
+
+} // namespace
+
+Value Runtime::sumFunction(Runtime&, std::span<const Value> args) {
+    if (args.empty() || args.size() > 2) {
+        throw RuntimeError("TypeError: sum expected 1 or 2 arguments, got " + std::to_string(args.size()));
+    }
+    const ListObject& list = iterableList(args[0]);
+    Value start = args.size() == 2 ? args[1] : Value::fromInt(0);
+    if (start.as<StringObject>()) {
+        throw RuntimeError("TypeError: sum() can't sum strings [use ''.join(seq) instead]");
+    }
+
+    const kernels::KernelTable& k = kernels::active();
+    if (list.getStorage() == Storage::INT && start.isInt()) {
+        return Value::fromInt(wrapAdd(start.asInt(), k.sumInt(list.intElements().data(), list.size())));
+    }
+    if (list.getStorage() == Storage::FLOAT && list.size() != 0 && start.isNumber()) {
+        return Value::fromFloat(k.sumFloat(start.toFloat(), list.floatElements().data(), list.size()));
+    }
+
+    Value total = start;
+    for (size_t i = 0; i < list.size(); i++) {
+        Value item = list.at(i);
+        if (total.isNumber() && item.isNumber()) {
+            if (total.isFloat() || item.isFloat()) {
+                total = Value::fromFloat(total.toFloat() + item.toFloat());
+            } else {
+                int64_t a = total.isInt() ? total.asInt() : total.asBool();
+                int64_t b = item.isInt() ? item.asInt() : item.asBool();
+                total = Value::fromInt(wrapAdd(a, b));
+            }
+        } else if (total.as<ListObject>() && item.as<ListObject>()) {
+            Value joined = Value::make<ListObject>();
+            joined.as<ListObject>()->extend(*total.as<ListObject>());
+            joined.as<ListObject>()->extend(*item.as<ListObject>());
+            total = std::move(joined);
+        } else {
+            throw RuntimeError(std::string("TypeError: unsupported operand type(s) for +: '") +
+                               typeName(total.getType()) + "' and '" + typeName(item.getType()) + "'");
+        }
+    }
+    return total;
+}
+
+namespace {
+
+Value minOrMax(std::span<const Value> args, bool min) {
+    const char* name = min ? "min" : "max";
+    if (args.empty()) {
+        throw RuntimeError(std::string("TypeError: ") + name + " expected at least 1 argument, got 0");
+    }
+    if (args.size() > 1) {
+        return extremeOf(args.size(), [args](size_t i) { return args[i]; }, min);
+    }
+
+    const ListObject& list = iterableList(args[0]);
+    size_t count = list.size();
+    if (count == 0) {
+        throw RuntimeError(std::string("ValueError: ") + name + "() arg is an empty sequence");
+    }
+    const kernels::KernelTable& k = kernels::active();
+    if (list.getStorage() == Storage::INT) {
+        const int64_t* data = list.intElements().data();
+        return Value::fromInt(min ? k.minInt(data, count) : k.maxInt(data, count));
+    }
+    if (list.getStorage() == Storage::FLOAT) {
+        // NaNs make the answer depend on the order of the comparisons, and
+        // which zero comes first decides between 0.0 and -0.0: both take the
+        // sequential path below
+        const double* data = list.floatElements().data();
+        if (!k.anyNaN(data, count)) {
+            double best = min ? k.minFloat(data, count) : k.maxFloat(data, count);
+            if (best != 0.0) return Value::fromFloat(best);
+        }
+    }
+    return extremeOf(count, [&list](size_t i) { return list.at(i); }, min);
+}
+
+} // namespace
+
+Value Runtime::minFunction(Runtime&, std::span<const Value> args) {
+    return minOrMax(args, true);
+}
+
+Value Runtime::maxFunction(Runtime&, std::span<const Value> args) {
+    return minOrMax(args, false);
+}
+
+Value Runtime::absFunction(Runtime&, std::span<const Value> args) {
+    const Value& value = args[0];
+    if (value.isFloat()) return Value::fromFloat(std::fabs(value.asFloat()));
+    if (value.isInt() || value.isBool()) {
+        int64_t number = value.isInt() ? value.asInt() : value.asBool();
+        // Wraps at the smallest int like the VM's negation
+        return Value::fromInt(number < 0 ? static_cast<int64_t>(0 - static_cast<uint64_t>(number)) : number);
+    }
+    throw RuntimeError(std::string("TypeError: bad operand type for abs(): '") + typeName(value.getType()) + "'");
+}
+
+// map(f, xs, ...) builds a list, there being no iterators at run time
+Value Runtime::mapFunction(Runtime& runtime, std::span<const Value> args) {
+    if (args.size() < 2) {
+        throw RuntimeError("TypeError: map() must have at least two arguments.");
+    }
+    const Value& function = args[0];
+    std::vector<const ListObject*> lists;
+    size_t count = SIZE_MAX;
+    for (const Value& arg : args.subspan(1)) {
+        lists.push_back(&iterableList(arg));
+        count = std::min(count, lists.back()->size());
+    }
+
+    if (auto program = vectorize(function, lists)) {
+        std::vector<int64_t> ints;
+        std::vector<double> floats;
+        std::vector<Value> bools;
+        for (size_t begin = 0; begin < count; begin += VectorProgram::BLOCK) {
+            size_t n = std::min(VectorProgram::BLOCK, count - begin);
+            program->run(lists, begin, n);
+            switch (program->resultKind()) {
+                case VectorProgram::Kind::INT: ints.insert(ints.end(), program->ints(), program->ints() + n); break;
+                case VectorProgram::Kind::FLOAT:
+                    floats.insert(floats.end(), program->floats(), program->floats() + n);
+                    break;
+                default:
+                    for (size_t i = 0; i < n; i++) bools.push_back(Value::fromBool(program->bools()[i]));
+                    break;
+            }
+        }
+        switch (program->resultKind()) {
+            case VectorProgram::Kind::INT: return Value::make<ListObject>(std::move(ints));
+            case VectorProgram::Kind::FLOAT: return Value::make<ListObject>(std::move(floats));
+            default: return Value::make<ListObject>(std::move(bools));
+        }
+    }
+
+    Value result = Value::make<ListObject>();
+    auto output = result.as<ListObject>();
+    output->reserve(count);
+    std::vector<Value> arguments(lists.size());
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = 0; j < lists.size(); j++) arguments[j] = lists[j]->at(i);
+        output->append(runtime.call(function, arguments));
+    }
+    return result;
+}
+
+// filter(f, xs) keeps the elements f finds true; filter(None, xs) the true ones
+Value Runtime::filterFunction(Runtime& runtime, std::span<const Value> args) {
+    if (args.size() != 2) {
+        throw RuntimeError("TypeError: filter expected 2 arguments, got " + std::to_string(args.size()));
+    }
+    const Value& function = args[0];
+    const ListObject& list = iterableList(args[1]);
+    const ListObject* lists[] = {&list};
+    size_t count = list.size();
+
+    std::optional<VectorProgram> program;
+    if (!function.isNone()) program = vectorize(function, lists);
+    if (program) {
+        std::vector<uint8_t> keep(VectorProgram::BLOCK);
+        std::vector<int64_t> ints;
+        std::vector<double> floats;
+        for (size_t begin = 0; begin < count; begin += VectorProgram::BLOCK) {
+            size_t n = std::min(VectorProgram::BLOCK, count - begin);
+            program->run(lists, begin, n);
+            switch (program->resultKind()) {
+                case VectorProgram::Kind::INT:
+                    for (size_t i = 0; i < n; i++) keep[i] = program->ints()[i] != 0;
+                    break;
+                case VectorProgram::Kind::FLOAT:
+                    for (size_t i = 0; i < n; i++) keep[i] = program->floats()[i] != 0.0;
+                    break;
+                default:
+                    std::copy_n(program->bools(), n, keep.begin());
+                    break;
+            }
+            for (size_t i = 0; i < n; i++) {
+                if (!keep[i]) continue;
+                if (list.getStorage() == Storage::INT) ints.push_back(list.intElements()[begin + i]);
+                else floats.push_back(list.floatElements()[begin + i]);
+            }
+        }
+        if (list.getStorage() == Storage::INT) return Value::make<ListObject>(std::move(ints));
+        return Value::make<ListObject>(std::move(floats));
+    }
+
+    Value result = Value::make<ListObject>();
+    auto output = result.as<ListObject>();
+    for (size_t i = 0; i < count; i++) {
+        Value item = list.at(i);
+        bool keep = function.isNone() ? item.truthy() : runtime.call(function, std::span<const Value>(&item, 1)).truthy();
+        if (keep) output->append(std::move(item));
+    }
+    return result;
+}
+
+} // namespace pulse::runtime
@@ -0,0 +1,267 @@
+#include "runtime/profiler.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <stdexcept>
+#include "runtime/bytecode.hpp"
+#include "runtime/vm.hpp"
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <signal.h>
+#endif
+
+namespace pulse::runtime {
+
+namespace {
+
+// The profiler the signal handler records for; null while none runs
+std::atomic<Profiler*> activeProfiler{nullptr};
+
+std::string frameName(const FunctionProto* proto, bool native) {
+    return native ? proto->name + " [native]" : proto->name;
+}
+
+// Just enough of the protobuf wire format for profile.proto
+class ProtoWriter {
+public:
+    std::string bytes;
+
+    void varint(uint64_t value) {
+        while (value >= 0x80) {
+            bytes += static_cast<char>(value | 0x80);
+            value >>= 7;
+        }
+        bytes += static_cast<char>(value);
+    }
+    void integer(uint32_t field, uint64_t value) {
+        varint(field << 3);
+        varint(value);
+    }
+    void message(uint32_t field, const std::string& content) {
+        varint(field << 3 | 2);
+        varint(content.size());
+        bytes += content;
+    }
+    void packed(uint32_t field, const std::vector<uint64_t>& values) {
+        ProtoWriter content;
+        for (uint64_t value : values) content.varint(value);
+        message(field, content.bytes);
+    }
+};
+
+} // namespace
+
+Profiler::Profiler(const VM& vm, unsigned rate) : vm(vm), rate(std::clamp(rate, 1u, 100000u)) {}
+
+Profiler::~Profiler() {
+    stop();
+}
+
+#ifndef _WIN32
+
+void Profiler::handleSignal(int) {
+    int saved = errno;
+    if (Profiler* profiler = activeProfiler.load(std::memory_order_acquire)) profiler->record();
+    errno = saved;
+}
+
+void Profiler::start() {
+    if (running) return;
+    Profiler* expected = nullptr;
+    if (!activeProfiler.compare_exchange_strong(expected, this)) {
+        throw std::runtime_error("another profiler is already running");
+    }
+
+    // Installed for good: a signal still on its way when stop() returns
+    // must not find the default action, which ends the process
+    static std::once_flag installed;
+    std::call_once(installed, [] {
+        struct sigaction action {};
+        action.sa_handler = handleSignal;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        sigaction(SIGPROF, &action, nullptr);
+    });
+
+    running = true;
+    stopping = false;
+    started = std::chrono::system_clock::now();
+    pthread_t target = pthread_self();
+    thread = std::thread([this, target] {
+        auto interval = std::chrono::nanoseconds(1000000000 / rate);
+        auto next = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            // Behind schedule, catch up instead of sending a burst
+            next = std::max(next + interval, std::chrono::steady_clock::now());
+            if (wake.wait_until(lock, next, [this] { return stopping; })) break;
+            pthread_kill(target, SIGPROF);
+            collect();
+        }
+    });
+}
+
+#else
+
+void Profiler::handleSignal(int) {}
+
+void Profiler::start() {
+    throw std::runtime_error("--profile is not supported on this platform");
+}
+
+#endif
+
+// On the VM's thread, so no sample is being recorded meanwhile
+void Profiler::stop() {
+    if (!running) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    thread.join();
+    activeProfiler.store(nullptr, std::memory_order_release);
+    duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now() - started);
+    collect();
+    running = false;
+}
+
+void Profiler::record() noexcept {
+    Slot& slot = slots[writeIndex % SLOTS];
+    if (slot.full.load(std::memory_order_acquire)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    bool native = false;
+    slot.depth = static_cast<uint32_t>(vm.sampleStack(slot.frames, MAX_FRAMES, native));
+    slot.native = native;
+    slot.full.store(true, std::memory_order_release);
+    writeIndex++;
+}
+
+void Profiler::collect() {
+    while (true) {
+        Slot& slot = slots[readIndex % SLOTS];
+        if (!slot.full.load(std::memory_order_acquire)) break;
+        // Nothing on the stack: the thread was not running Pulse code
+        if (slot.depth > 0) {
+            stacks[Stack(std::vector<const FunctionProto*>(slot.frames, slot.frames + slot.depth), slot.native)]++;
+            samples++;
+        }
+        slot.full.store(false, std::memory_order_release);
+        readIndex++;
+    }
+}
+
+std::string Profiler::folded() const {
+    // Functions of the same name (methods of different classes) share a line
+    std::map<std::string, uint64_t> lines;
+    for (const auto& [stack, count] : stacks) {
+        const auto& [frames, native] = stack;
+        std::string line;
+        for (size_t i = 0; i < frames.size(); i++) {
+            if (i > 0) line += ';';
+            line += frameName(frames[i], native && i + 1 == frames.size());
+        }
+        lines[line] += count;
+    }
+
+    std::string text;
+    for (const auto& [line, count] : lines) {
+        text += line + " " + std::to_string(count) + "\n";
+    }
+    return text;
+}
+
+std::string Profiler::pprof(const std::string& program) const {
+    std::vector<std::string> strings{""};
+    std::map<std::string, uint64_t> stringIndex{{"", 0}};
+    auto intern = [&](const std::string& text) {
+        auto [it, inserted] = stringIndex.emplace(text, strings.size());
+        if (inserted) strings.push_back(text);
+        return it->second;
+    };
+
+    // One function, and one location naming it, per frame kind
+    std::map<std::pair<const FunctionProto*, bool>, uint64_t> functionIds;
+    ProtoWriter profile;
+    uint64_t filename = intern(program);
+    auto functionId = [&](const FunctionProto* proto, bool native) {
+        auto [it, inserted] = functionIds.emplace(std::make_pair(proto, native), functionIds.size() + 1);
+        if (inserted) {
+            // pprof drops <...> from names as C++ template arguments
+            std::string name = frameName(proto, native);
+            std::string shown = name;
+            std::replace(shown.begin(), shown.end(), '<', '[');
+            std::replace(shown.begin(), shown.end(), '>', ']');
+            ProtoWriter function;
+            function.integer(1, it->second);
+            function.integer(2, intern(shown));
+            function.integer(3, intern(name));
+            function.integer(4, filename);
+            profile.message(5, function.bytes);
+
+            ProtoWriter line;
+            line.integer(1, it->second);
+            ProtoWriter location;
+            location.integer(1, it->second);
+            location.message(4, line.bytes);
+            profile.message(4, location.bytes);
+        }
+        return it->second;
+    };
+
+    uint64_t period = 1000000000 / rate;
+    for (const auto& [stack, count] : stacks) {
+        const auto& [frames, native] = stack;
+        // Leaf first
+        std::vector<uint64_t> locations;
+        for (size_t i = frames.size(); i-- > 0;) {
+            locations.push_back(functionId(frames[i], native && i + 1 == frames.size()));
+        }
+        ProtoWriter sample;
+        sample.packed(1, locations);
+        sample.packed(2, {count, count * period});
+        profile.message(2, sample.bytes);
+    }
+
+    auto valueType = [&](const char* type, const char* unit) {
+        ProtoWriter value;
+        value.integer(1, intern(type));
+        value.integer(2, intern(unit));
+        return value.bytes;
+    };
+    profile.message(1, valueType("samples", "count"));
+    profile.message(1, valueType("wall", "nanoseconds"));
+    profile.integer(9, static_cast<uint64_t>(
+                           std::chrono::duration_cast<std::chrono::nanoseconds>(started.time_since_epoch()).count()));
+    profile.integer(10, static_cast<uint64_t>(duration.count()));
+    profile.message(11, valueType("wall", "nanoseconds"));
+    profile.integer(12, period);
+    for (const std::string& text : strings) profile.message(6, text);
+    return profile.bytes;
+}
+
+std::string callReport(const VM& vm) {
+    std::vector<const FunctionProto*> functions(vm.getCountedFunctions().begin(), vm.getCountedFunctions().end());
+    std::stable_sort(functions.begin(), functions.end(), [](const FunctionProto* a, const FunctionProto* b) {
+        return a->callCounts.nanoseconds > b->callCounts.nanoseconds;
+    });
+
+    std::string text;
+    char line[256];
+    std::snprintf(line, sizeof(line), "calls: %12s %12s %12s  %s\n", "calls", "total ms", "us/call", "function");
+    text += line;
+    for (const FunctionProto* function : functions) {
+        const auto& counts = function->callCounts;
+        double milliseconds = static_cast<double>(counts.nanoseconds) / 1e6;
+        double perCall = counts.calls > 0 ? static_cast<double>(counts.nanoseconds) / 1e3 / counts.calls : 0;
+        std::snprintf(line, sizeof(line), "calls: %12llu %12.3f %12.3f  %s\n",
+                      static_cast<unsigned long long>(counts.calls), milliseconds, perCall, function->name.c_str());
+        text += line;
+    }
+    return text;
+}
+
+} // namespace pulse::runtime
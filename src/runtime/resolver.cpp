@@ -0,0 +1,198 @@
+#include "runtime/resolver.hpp"
+#include <stdexcept>
+
+namespace pulse::runtime {
+
+Resolver::Resolver(pulse::parser::Program* program) {
+    for (const auto& decl : program->declarations) {
+        resolve(decl.get());
+    }
+    resolveBlock(program->statements);
+}
+
+const VariableSlot& Resolver::slotFor(const pulse::parser::ASTNode* node) const {
+    auto it = resolved.find(node);
+    if (it == resolved.end()) {
+        throw std::logic_error("Node has no resolved variable");
+    }
+    return it->second;
+}
+
+const FrameLayout& Resolver::frameFor(const pulse::parser::FunctionDeclaration* decl) const {
+    auto it = frames.find(decl);
+    if (it == frames.end()) {
+        throw std::logic_error("Function '" + std::string(decl->name) + "' was not resolved");
+    }
+    return it->second;
+}
+
+// First pass over a function body: every assigned name gets a slot, wherever
+// in the body the assignment is
+void Resolver::declareLocals(Scope& scope, const pulse::parser::ArenaVector<pulse::parser::StatementPtr>& body) {
+    for (const auto& stmt : body) {
+        if (auto assignment = pulse::parser::dyn_cast<pulse::parser::AssignmentStatement>(stmt.get())) {
+            declare(scope, assignment->name);
+        } else if (auto loop = pulse::parser::dyn_cast<pulse::parser::ForStatement>(stmt.get())) {
+            declare(scope, loop->variable);
+            declareLocals(scope, loop->body);
+        } else if (auto loop = pulse::parser::dyn_cast<pulse::parser::WhileStatement>(stmt.get())) {
+            declareLocals(scope, loop->body);
+        } else if (auto branch = pulse::parser::dyn_cast<pulse::parser::IfStatement>(stmt.get())) {
+            for (const auto& arm : branch->branches) {
+                declareLocals(scope, arm.body);
+            }
+            declareLocals(scope, branch->else_body);
+        } else if (auto match = pulse::parser::dyn_cast<pulse::parser::MatchStatement>(stmt.get())) {
+            for (const auto& matchCase : match->cases) {
+                declareLocals(scope, matchCase.second);
+            }
+        }
+    }
+}
+
+void Resolver::declare(Scope& scope, std::string_view name) {
+    auto [it, inserted] = scope.slots.try_emplace(name, static_cast<uint32_t>(scope.layout->names.size()));
+    if (inserted) {
+        scope.layout->names.push_back(name);
+    }
+}
+
+void Resolver::bind(const pulse::parser::ASTNode* node, std::string_view name) {
+    VariableSlot slot;
+    for (size_t i = scopes.size(); i-- > 0;) {
+        auto it = scopes[i].slots.find(name);
+        if (it != scopes[i].slots.end()) {
+            slot.kind = VariableSlot::Kind::LOCAL;
+            slot.depth = static_cast<uint16_t>(scopes.size() - 1 - i);
+            slot.index = it->second;
+            resolved[node] = slot;
+            return;
+        }
+    }
+
+    slot.symbol = intern(name);
+    resolved[node] = slot;
+}
+
+void Resolver::resolveBlock(const pulse::parser::ArenaVector<pulse::parser::StatementPtr>& body) {
+    for (const auto& stmt : body) {
+        resolve(stmt.get());
+    }
+}
+
+void Resolver::resolve(pulse::parser::ASTNode* node) {
+    if (node) visit(node);
+}
+
+void Resolver::visitIdentifierExpression(pulse::parser::IdentifierExpression* expr) {
+    bind(expr, expr->name);
+}
+
+void Resolver::visitBinaryExpression(pulse::parser::BinaryExpression* expr) {
+    resolve(expr->left.get());
+    resolve(expr->right.get());
+}
+
+void Resolver::visitUnaryExpression(pulse::parser::UnaryExpression* expr) {
+    resolve(expr->operand.get());
+}
+
+void Resolver::visitCallExpression(pulse::parser::CallExpression* expr) {
+    resolve(expr->callee.get());
+    for (const auto& argument : expr->arguments) {
+        resolve(argument.get());
+    }
+}
+
+void Resolver::visitAttributeExpression(pulse::parser::AttributeExpression* expr) {
+    resolve(expr->object.get());
+}
+
+void Resolver::visitSubscriptExpression(pulse::parser::SubscriptExpression* expr) {
+    resolve(expr->object.get());
+    resolve(expr->index.get());
+}
+
+void Resolver::visitListExpression(pulse::parser::ListExpression* expr) {
+    for (const auto& element : expr->elements) {
+        resolve(element.get());
+    }
+}
+
+void Resolver::visitDictExpression(pulse::parser::DictExpression* expr) {
+    for (const auto& pair : expr->pairs) {
+        resolve(pair.key.get());
+        resolve(pair.value.get());
+    }
+}
+
+void Resolver::visitTupleExpression(pulse::parser::TupleExpression* expr) {
+    for (const auto& element : expr->elements) {
+        resolve(element.get());
+    }
+}
+
+void Resolver::visitAssignmentStatement(pulse::parser::AssignmentStatement* stmt) {
+    resolve(stmt->value.get());
+    bind(stmt, stmt->name);
+}
+
+void Resolver::visitExpressionStatement(pulse::parser::ExpressionStatement* stmt) {
+    resolve(stmt->expression.get());
+}
+
+void Resolver::visitReturnStatement(pulse::parser::ReturnStatement* stmt) {
+    resolve(stmt->value.get());
+}
+
+void Resolver::visitIfStatement(pulse::parser::IfStatement* stmt) {
+    for (const auto& branch : stmt->branches) {
+        resolve(branch.condition.get());
+        resolveBlock(branch.body);
+    }
+    resolveBlock(stmt->else_body);
+}
+
+void Resolver::visitWhileStatement(pulse::parser::WhileStatement* stmt) {
+    resolve(stmt->condition.get());
+    resolveBlock(stmt->body);
+}
+
+void Resolver::visitForStatement(pulse::parser::ForStatement* stmt) {
+    resolve(stmt->iterable.get());
+    bind(stmt, stmt->variable);
+    resolveBlock(stmt->body);
+}
+
+void Resolver::visitMatchStatement(pulse::parser::MatchStatement* stmt) {
+    resolve(stmt->value.get());
+    for (const auto& [pattern, body] : stmt->cases) {
+        resolve(pattern.get());
+        resolveBlock(body);
+    }
+}
+
+void Resolver::visitFunctionDeclaration(pulse::parser::FunctionDeclaration* decl) {
+    FrameLayout& layout = frames[decl];
+    layout = FrameLayout();
+
+    scopes.push_back(Scope{&layout, {}});
+    for (const auto& parameter : decl->parameters) {
+        declare(scopes.back(), parameter);
+    }
+    layout.parameterCount = layout.names.size();
+    declareLocals(scopes.back(), decl->body);
+
+    resolveBlock(decl->body);
+    scopes.pop_back();
+}
+
+// Methods do not see the class body's names (as in Python), so members are
+// resolved in the scope around the class
+void Resolver::visitClassDeclaration(pulse::parser::ClassDeclaration* decl) {
+    for (const auto& member : decl->members) {
+        resolve(member.get());
+    }
+}
+
+} // namespace pulse::runtime
@@ -0,0 +1,477 @@
+#include "runtime/runtime.hpp"
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <utility>
+#include "lexer/tokenizer.hpp"
+#include "parser/parser.hpp"
+#include "runtime/bytecode_compiler.hpp"
+#include "runtime/kernels.hpp"
+#include "runtime/resolver.hpp"
+#include "runtime/scheduler.hpp"
+#include "runtime/vm.hpp"
+
+namespace pulse::runtime {
+
+namespace {
+
+std::string_view trim(std::string_view text) {
+    size_t begin = text.find_first_not_of(" \t\n\r");
+    if (begin == std::string_view::npos) return {};
+    size_t end = text.find_last_not_of(" \t\n\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+// The receiver of a built-in method, which may have been called unbound
+template <typename T>
+T& receiver(std::span<const Value> args, const char* method) {
+    T* object = args.empty() ? nullptr : args[0].as<T>();
+    if (!object) {
+        throw RuntimeError(std::string("TypeError: descriptor '") + method + "' requires a '" +
+                           typeName(T::TYPE) + "' object");
+    }
+    return *object;
+}
+
+// Tuples share the methods of lists, but not those that change the list
+ListObject& mutableList(std::span<const Value> args, const char* method) {
+    auto& list = receiver<ListObject>(args, method);
+    if (list.isTuple()) {
+        throw RuntimeError(std::string("AttributeError: 'tuple' object has no attribute '") + method + "'");
+    }
+    return list;
+}
+
+void expectArguments(std::span<const Value> args, size_t min, size_t max, const char* method) {
+    if (args.size() < min || args.size() > max) {
+        throw RuntimeError(std::string("TypeError: ") + method + "() takes " + std::to_string(min - 1) + " to " +
+                           std::to_string(max - 1) + " argument(s) (" + std::to_string(args.size() - 1) + " given)");
+    }
+}
+
+} // namespace
+
+RuntimeContext::RuntimeContext(RuntimeContext* parent) : parent(parent) {}
+
+RuntimeContext::RuntimeContext(size_t slotCount, RuntimeContext* parent) : slots(slotCount), parent(parent) {}
+
+void RuntimeContext::setVariable(const std::string& name, Value value) {
+    variables[intern(name)] = std::move(value);
+}
+
+Value RuntimeContext::getVariable(const std::string& name) const {
+    Symbol symbol;
+    if (!SymbolTable::global().find(name, symbol)) {
+        return Value(); // never interned, so bound nowhere
+    }
+    const Value* value = findVariable(symbol);
+    return value ? *value : Value();
+}
+
+bool RuntimeContext::hasVariable(const std::string& name) const {
+    Symbol symbol;
+    return SymbolTable::global().find(name, symbol) && findVariable(symbol);
+}
+
+void RuntimeContext::removeVariable(const std::string& name) {
+    Symbol symbol;
+    if (SymbolTable::global().find(name, symbol) && variables.erase(symbol)) {
+        generation++;
+    }
+}
+
+Value* RuntimeContext::findVariable(Symbol symbol) {
+    return const_cast<Value*>(std::as_const(*this).findVariable(symbol));
+}
+
+const Value* RuntimeContext::findVariable(Symbol symbol) const {
+    for (const RuntimeContext* scope = this; scope; scope = scope->parent) {
+        auto it = scope->variables.find(symbol);
+        if (it != scope->variables.end()) {
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
+
+void RuntimeContext::setVariable(Symbol symbol, Value value) {
+    variables[symbol] = std::move(value);
+}
+
+std::unique_ptr<RuntimeContext> RuntimeContext::createChildScope() {
+    return std::make_unique<RuntimeContext>(this);
+}
+
+std::unique_ptr<RuntimeContext> RuntimeContext::createFrame(size_t slotCount) {
+    return std::make_unique<RuntimeContext>(slotCount, this);
+}
+
+Runtime::Runtime()
+    : globalContext(std::make_unique<RuntimeContext>()),
+      vm(std::make_unique<VM>(*this)),
+      scheduler(std::make_unique<Scheduler>(*this)),
+      methods(static_cast<size_t>(ValueType::FUTURE) + 1) {}
+
+Runtime::~Runtime() = default;
+
+void Runtime::initialize() {
+    setupStandardLibrary();
+}
+
+RuntimeContext* Runtime::getGlobalContext() const {
+    return globalContext.get();
+}
+
+void Runtime::setupStandardLibrary() {
+    defineNative("print", printFunction);
+    defineNative("out", printFunction);
+    defineNative("len", lenFunction, 1);
+    defineNative("str", strFunction, 1);
+    defineNative("int", intFunction, 1);
+    defineNative("float", floatFunction, 1);
+    defineNative("bool", boolFunction, 1);
+    defineNative("range", rangeFunction);
+    defineNative("sum", sumFunction);
+    defineNative("min", minFunction);
+    defineNative("max", maxFunction);
+    defineNative("abs", absFunction, 1);
+    defineNative("map", mapFunction);
+    defineNative("filter", filterFunction);
+    defineNative("run", runFunction, 1);
+    defineNative("spawn", spawnFunction, 1);
+    defineNative("sleep", sleepFunction, 1);
+    defineNative("gather", gatherFunction);
+    defineNative("listen", listenFunction, 2);
+    defineNative("accept", acceptFunction, 1);
+    defineNative("connect", connectFunction, 2);
+    defineNative("recv", recvFunction);
+    defineNative("send", sendFunction, 2);
+    defineNative("close", closeFunction, 1);
+
+    defineMethod(ValueType::LIST, "append", listAppend, 2);
+    defineMethod(ValueType::LIST, "pop", listPop);
+    defineMethod(ValueType::DICT, "get", dictGet);
+    defineMethod(ValueType::DICT, "keys", dictKeys, 1);
+    defineMethod(ValueType::DICT, "values", dictValues, 1);
+    defineMethod(ValueType::DICT, "items", dictItems, 1);
+    defineMethod(ValueType::STRING, "upper", stringUpper, 1);
+    defineMethod(ValueType::STRING, "lower", stringLower, 1);
+    defineMethod(ValueType::STRING, "strip", stringStrip, 1);
+    defineMethod(ValueType::STRING, "split", stringSplit);
+    defineMethod(ValueType::STRING, "join", stringJoin, 2);
+}
+
+Value Runtime::execute(const std::string& code) {
+    return run(compile(code));
+}
+
+std::shared_ptr<FunctionProto> Runtime::compile(const std::string& code) {
+    pulse::lexer::Tokenizer tokenizer(code);
+    pulse::parser::Parser parser(tokenizer.tokenize());
+    std::shared_ptr<pulse::parser::Program> program = parser.parseOrThrow();
+
+    // The chunk copies every name and literal it needs, so the tree is dropped
+    // here unless the native tier may still compile its functions
+    Resolver resolver(program.get());
+    BytecodeCompiler compiler(resolver, nativeTier ? program : nullptr);
+    return compiler.compileModule(program.get());
+}
+
+void Runtime::setNativeTier(std::unique_ptr<NativeTier> tier) {
+    nativeTier = std::move(tier);
+}
+
+Value Runtime::run(const std::shared_ptr<FunctionProto>& chunk) {
+    return vm->run(chunk);
+}
+
+bool Runtime::resume(CoroutineObject& coroutine, Value& result) {
+    return vm->resume(coroutine, result);
+}
+
+void Runtime::defineNative(const std::string& name, NativeFunction function, int arity) {
+    globalContext->setVariable(name, Value::make<FunctionObject>(name, function, arity));
+}
+
+Value Runtime::call(const Value& callee, std::span<const Value> args) {
+    auto function = callee.as<FunctionObject>();
+    if (!function) {
+        throw RuntimeError(std::string("TypeError: '") + typeName(callee.getType()) + "' object is not callable");
+    }
+    if (function->arity >= 0 && args.size() != static_cast<size_t>(function->arity)) {
+        throw RuntimeError("TypeError: " + function->name + "() takes " + std::to_string(function->arity) +
+                           " argument(s) (" + std::to_string(args.size()) + " given)");
+    }
+    if (function->code) {
+        if (function->code->isAsync) {
+            return Value::make<CoroutineObject>(callee, args);
+        }
+        return vm->call(*function, args);
+    }
+    return function->native(*this, args);
+}
+
+void Runtime::defineMethod(ValueType type, const std::string& name, NativeFunction function, int arity) {
+    methods[static_cast<size_t>(type)][intern(name)] = Value::make<FunctionObject>(name, function, arity);
+}
+
+const Value* Runtime::findMethod(ValueType type, Symbol name) const {
+    const auto& table = methods[static_cast<size_t>(type)];
+    auto it = table.find(name);
+    return it != table.end() ? &it->second : nullptr;
+}
+
+void Runtime::reportError(const std::string& message) {
+    errors.push_back(message);
+}
+
+bool Runtime::hasErrors() const {
+    return !errors.empty();
+}
+
+std::vector<std::string> Runtime::getErrors() const {
+    return errors;
+}
+
+Value Runtime::printFunction(Runtime&, std::span<const Value> args) {
+    std::string line;
+    for (const auto& arg : args) {
+        if (!line.empty()) line += ' ';
+        line += arg.toString();
+    }
+    line += '\n';
+    std::cout << line;
+    return Value();
+}
+
+Value Runtime::lenFunction(Runtime&, std::span<const Value> args) {
+    const Value& value = args[0];
+    if (auto string = value.as<StringObject>()) return Value::fromInt(static_cast<int64_t>(string->value.size()));
+    if (auto list = value.as<ListObject>()) return Value::fromInt(static_cast<int64_t>(list->size()));
+    if (auto dict = value.as<DictObject>()) return Value::fromInt(static_cast<int64_t>(dict->size()));
+    throw RuntimeError(std::string("TypeError: object of type '") + typeName(value.getType()) + "' has no len()");
+}
+
+Value Runtime::strFunction(Runtime&, std::span<const Value> args) {
+    if (args[0].as<StringObject>()) return args[0];
+    return Value::make<StringObject>(args[0].toString());
+}
+
+Value Runtime::intFunction(Runtime&, std::span<const Value> args) {
+    const Value& value = args[0];
+    switch (value.getTag()) {
+        case Value::Tag::INT: return value;
+        case Value::Tag::BOOL: return Value::fromInt(value.asBool());
+        case Value::Tag::FLOAT: {
+            double number = value.asFloat();
+            if (!std::isfinite(number)) {
+                throw RuntimeError("ValueError: cannot convert float " + value.toString() + " to integer");
+            }
+            return Value::fromInt(static_cast<int64_t>(number));
+        }
+        default: break;
+    }
+
+    if (auto string = value.as<StringObject>()) {
+        std::string_view text = trim(string->value);
+        if (!text.empty() && text[0] == '+') text.remove_prefix(1);
+        int64_t result = 0;
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), result);
+        if (error == std::errc() && end == text.data() + text.size() && !text.empty()) {
+            return Value::fromInt(result);
+        }
+        throw RuntimeError("ValueError: invalid literal for int(): " + value.repr());
+    }
+    throw RuntimeError(std::string("TypeError: int() argument must be a string or a number, not '") +
+                       typeName(value.getType()) + "'");
+}
+
+Value Runtime::floatFunction(Runtime&, std::span<const Value> args) {
+    const Value& value = args[0];
+    if (value.isNumber()) {
+        return Value::fromFloat(value.toFloat());
+    }
+
+    if (auto string = value.as<StringObject>()) {
+        std::string_view text = trim(string->value);
+        if (!text.empty() && text[0] == '+') text.remove_prefix(1);
+        double result = 0;
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), result);
+        if (error == std::errc() && end == text.data() + text.size() && !text.empty()) {
+            return Value::fromFloat(result);
+        }
+        throw RuntimeError("ValueError: could not convert string to float: " + value.repr());
+    }
+    throw RuntimeError(std::string("TypeError: float() argument must be a string or a number, not '") +
+                       typeName(value.getType()) + "'");
+}
+
+Value Runtime::boolFunction(Runtime&, std::span<const Value> args) {
+    return Value::fromBool(args[0].truthy());
+}
+
+Value Runtime::rangeFunction(Runtime&, std::span<const Value> args) {
+    if (args.empty() || args.size() > 3) {
+        throw RuntimeError("TypeError: range expected 1 to 3 arguments, got " + std::to_string(args.size()));
+    }
+    int64_t bounds[3] = {0, 0, 1};
+    for (size_t i = 0; i < args.size(); i++) {
+        if (!args[i].isInt() && !args[i].isBool()) {
+            throw RuntimeError(std::string("TypeError: '") + typeName(args[i].getType()) +
+                               "' object cannot be interpreted as an integer");
+        }
+        bounds[args.size() == 1 ? 1 : i] = args[i].isInt() ? args[i].asInt() : args[i].asBool();
+    }
+    auto [start, stop, step] = bounds;
+    if (step == 0) {
+        throw RuntimeError("ValueError: range() arg 3 must not be zero");
+    }
+
+    // ceil((stop - start) / step) elements, computed without overflow
+    uint64_t span = step > 0 ? (stop > start ? static_cast<uint64_t>(stop) - static_cast<uint64_t>(start) : 0)
+                             : (start > stop ? static_cast<uint64_t>(start) - static_cast<uint64_t>(stop) : 0);
+    uint64_t stride = step > 0 ? static_cast<uint64_t>(step) : 0 - static_cast<uint64_t>(step);
+    uint64_t count = span == 0 ? 0 : (span - 1) / stride + 1;
+
+    std::vector<int64_t> elements(static_cast<size_t>(count));
+    kernels::active().iota(elements.data(), elements.size(), start, step);
+    return Value::make<ListObject>(std::move(elements));
+}
+
+Value Runtime::listAppend(Runtime&, std::span<const Value> args) {
+    mutableList(args, "append").append(args[1]);
+    return Value();
+}
+
+Value Runtime::listPop(Runtime&, std::span<const Value> args) {
+    auto& list = mutableList(args, "pop");
+    expectArguments(args, 1, 2, "pop");
+    if (list.size() == 0) {
+        throw RuntimeError("IndexError: pop from empty list");
+    }
+    int64_t index = -1;
+    if (args.size() == 2) {
+        if (!args[1].isInt()) {
+            throw RuntimeError(std::string("TypeError: '") + typeName(args[1].getType()) +
+                               "' object cannot be interpreted as an integer");
+        }
+        index = args[1].asInt();
+    }
+    return list.pop(index);
+}
+
+Value Runtime::dictGet(Runtime&, std::span<const Value> args) {
+    auto& dict = receiver<DictObject>(args, "get");
+    expectArguments(args, 2, 3, "get");
+    const Value* value = dict.find(args[1]);
+    return value ? *value : args.size() == 3 ? args[2] : Value();
+}
+
+Value Runtime::dictKeys(Runtime&, std::span<const Value> args) {
+    auto& dict = receiver<DictObject>(args, "keys");
+    std::vector<Value> keys;
+    keys.reserve(dict.size());
+    for (const auto& entry : dict.items()) {
+        keys.push_back(entry.key);
+    }
+    return Value::make<ListObject>(std::move(keys));
+}
+
+Value Runtime::dictValues(Runtime&, std::span<const Value> args) {
+    auto& dict = receiver<DictObject>(args, "values");
+    std::vector<Value> values;
+    values.reserve(dict.size());
+    for (const auto& entry : dict.items()) {
+        values.push_back(entry.value);
+    }
+    return Value::make<ListObject>(std::move(values));
+}
+
+// Pairs come back as (key, value) tuples
+Value Runtime::dictItems(Runtime&, std::span<const Value> args) {
+    auto& dict = receiver<DictObject>(args, "items");
+    std::vector<Value> items;
+    items.reserve(dict.size());
+    for (const auto& entry : dict.items()) {
+        Value pair = Value::make<ListObject>(std::vector<Value>{entry.key, entry.value});
+        pair.as<ListObject>()->makeTuple();
+        items.push_back(std::move(pair));
+    }
+    return Value::make<ListObject>(std::move(items));
+}
+
+Value Runtime::stringUpper(Runtime&, std::span<const Value> args) {
+    std::string text = receiver<StringObject>(args, "upper").value;
+    for (char& c : text) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    return Value::make<StringObject>(std::move(text));
+}
+
+Value Runtime::stringLower(Runtime&, std::span<const Value> args) {
+    std::string text = receiver<StringObject>(args, "lower").value;
+    for (char& c : text) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return Value::make<StringObject>(std::move(text));
+}
+
+Value Runtime::stringStrip(Runtime&, std::span<const Value> args) {
+    return Value::make<StringObject>(std::string(trim(receiver<StringObject>(args, "strip").value)));
+}
+
+// split() breaks on runs of whitespace, split(sep) on each sep
+Value Runtime::stringSplit(Runtime&, std::span<const Value> args) {
+    std::string_view text = receiver<StringObject>(args, "split").value;
+    expectArguments(args, 1, 2, "split");
+    std::vector<Value> parts;
+
+    if (args.size() == 1 || args[1].isNone()) {
+        size_t position = 0;
+        while (true) {
+            position = text.find_first_not_of(" \t\n\r", position);
+            if (position == std::string_view::npos) break;
+            size_t end = text.find_first_of(" \t\n\r", position);
+            parts.push_back(Value::make<StringObject>(std::string(text.substr(position, end - position))));
+            if (end == std::string_view::npos) break;
+            position = end;
+        }
+        return Value::make<ListObject>(std::move(parts));
+    }
+
+    auto separator = args[1].as<StringObject>();
+    if (!separator) {
+        throw RuntimeError(std::string("TypeError: must be str or None, not ") + typeName(args[1].getType()));
+    }
+    if (separator->value.empty()) {
+        throw RuntimeError("ValueError: empty separator");
+    }
+    size_t position = 0;
+    while (true) {
+        size_t end = text.find(separator->value, position);
+        parts.push_back(Value::make<StringObject>(std::string(text.substr(position, end - position))));
+        if (end == std::string_view::npos) break;
+        position = end + separator->value.size();
+    }
+    return Value::make<ListObject>(std::move(parts));
+}
+
+Value Runtime::stringJoin(Runtime&, std::span<const Value> args) {
+    const std::string& separator = receiver<StringObject>(args, "join").value;
+    auto list = args[1].as<ListObject>();
+    if (!list) {
+        throw RuntimeError("TypeError: can only join a list");
+    }
+    std::string result;
+    for (size_t i = 0; i < list->size(); i++) {
+        auto part = list->getStorage() == ListObject::Storage::VALUE ? list->valueElements()[i].as<StringObject>()
+                                                                     : nullptr;
+        if (!part) {
+            throw RuntimeError("TypeError: sequence item " + std::to_string(i) + ": expected str instance, " +
+                               typeName(list->at(i).getType()) + " found");
+        }
+        if (i > 0) result += separator;
+        result += part->value;
+    }
+    return Value::make<StringObject>(std::move(result));
+}
+
+} // namespace pulse::runtime
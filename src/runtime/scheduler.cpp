@@ -0,0 +1,583 @@
+// The coroutine event loop: ready queue, timers, the reactor and offloaded
+// blocking work, and the run, spawn, sleep and gather builtins
+#include "runtime/scheduler.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include "driver/thread_pool.hpp"
+#include "runtime/runtime.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <sys/epoll.h>
+#define PULSE_REACTOR_EPOLL 1
+#else
+#define PULSE_REACTOR_EPOLL 0
+#endif
+
+namespace pulse::runtime {
+
+namespace {
+
+[[noreturn]] void systemError(const char* call) {
+    throw RuntimeError(std::string("OSError: ") + call + ": " + std::strerror(errno));
+}
+
+using Clock = std::chrono::steady_clock;
+
+} // namespace
+
+// Readiness of descriptors: epoll on Linux, poll() on other POSIX systems. A
+// self-pipe lets worker threads wake a loop that is waiting. On Windows there
+// are no sockets yet, and waiting is sleeping.
+class Reactor {
+public:
+    Reactor();
+    ~Reactor();
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    // Interest in fd; neither direction drops it
+    void set(int fd, bool read, bool write);
+    // Blocks up to timeout (-1: no limit) and reports the ready descriptors
+    template <typename Ready>
+    void wait(int timeoutMilliseconds, Ready ready);
+    // From any thread
+    void wake();
+
+private:
+#ifndef _WIN32
+    int wakeRead = -1;
+    int wakeWrite = -1;
+    void drainWake();
+#endif
+#if PULSE_REACTOR_EPOLL
+    int epollFd = -1;
+    std::unordered_map<int, uint32_t> interest;
+#else
+    std::unordered_map<int, short> interest;
+#endif
+};
+
+#ifndef _WIN32
+
+Reactor::Reactor() {
+    int pipeFds[2];
+    if (::pipe(pipeFds) != 0) systemError("pipe");
+    wakeRead = pipeFds[0];
+    wakeWrite = pipeFds[1];
+    for (int fd : pipeFds) {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+#if PULSE_REACTOR_EPOLL
+    epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) systemError("epoll_create1");
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = wakeRead;
+    ::epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeRead, &event);
+#endif
+}
+
+Reactor::~Reactor() {
+#if PULSE_REACTOR_EPOLL
+    ::close(epollFd);
+#endif
+    ::close(wakeRead);
+    ::close(wakeWrite);
+}
+
+void Reactor::wake() {
+    char byte = 1;
+    // A full pipe already wakes the loop
+    [[maybe_unused]] auto written = ::write(wakeWrite, &byte, 1);
+}
+
+void Reactor::drainWake() {
+    char buffer[64];
+    while (::read(wakeRead, buffer, sizeof(buffer)) > 0) {}
+}
+
+#if PULSE_REACTOR_EPOLL
+
+void Reactor::set(int fd, bool read, bool write) {
+    uint32_t events = (read ? uint32_t(EPOLLIN) : 0u) | (write ? uint32_t(EPOLLOUT) : 0u);
+    auto it = interest.find(fd);
+    if (events == 0) {
+        if (it != interest.end()) {
+            ::epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+            interest.erase(it);
+        }
+        return;
+    }
+    if (it != interest.end() && it->second == events) return;
+
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+    if (::epoll_ctl(epollFd, it != interest.end() ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event) != 0) {
+        systemError("epoll_ctl");
+    }
+    interest[fd] = events;
+}
+
+template <typename Ready>
+void Reactor::wait(int timeoutMilliseconds, Ready ready) {
+    epoll_event events[256];
+    int count = ::epoll_wait(epollFd, events, 256, timeoutMilliseconds);
+    for (int i = 0; i < count; i++) {
+        int fd = events[i].data.fd;
+        if (fd == wakeRead) {
+            drainWake();
+            continue;
+        }
+        // Errors and hang-ups wake both directions; the retried call reports them
+        uint32_t flags = events[i].events;
+        bool failed = flags & (EPOLLERR | EPOLLHUP);
+        ready(fd, failed || (flags & EPOLLIN), failed || (flags & EPOLLOUT));
+    }
+}
+
+#else
+
+void Reactor::set(int fd, bool read, bool write) {
+    short events = static_cast<short>((read ? POLLIN : 0) | (write ? POLLOUT : 0));
+    if (events == 0) {
+        interest.erase(fd);
+    } else {
+        interest[fd] = events;
+    }
+}
+
+template <typename Ready>
+void Reactor::wait(int timeoutMilliseconds, Ready ready) {
+    std::vector<pollfd> fds;
+    fds.reserve(interest.size() + 1);
+    fds.push_back(pollfd{wakeRead, POLLIN, 0});
+    for (const auto& [fd, events] : interest) fds.push_back(pollfd{fd, events, 0});
+
+    int count = ::poll(fds.data(), static_cast<nfds_t>(fds.size()), timeoutMilliseconds);
+    if (count <= 0) return;
+    if (fds[0].revents) drainWake();
+    for (size_t i = 1; i < fds.size(); i++) {
+        short flags = fds[i].revents;
+        if (!flags) continue;
+        bool failed = flags & (POLLERR | POLLHUP | POLLNVAL);
+        ready(fds[i].fd, failed || (flags & POLLIN), failed || (flags & POLLOUT));
+    }
+}
+
+#endif
+
+#else // _WIN32
+
+Reactor::Reactor() = default;
+Reactor::~Reactor() = default;
+void Reactor::wake() {}
+
+void Reactor::set(int fd, bool read, bool write) {
+    (void)fd;
+    if (read || write) throw RuntimeError("OSError: sockets are not supported on this platform");
+}
+
+// Nothing wakes the wait early: offloaded work is noticed within 10 ms
+template <typename Ready>
+void Reactor::wait(int timeoutMilliseconds, Ready ready) {
+    (void)ready;
+    int limit = timeoutMilliseconds < 0 ? 10 : std::min(timeoutMilliseconds, 10);
+    std::this_thread::sleep_for(std::chrono::milliseconds(limit));
+}
+
+#endif
+
+Scheduler::Scheduler(Runtime& runtime) : runtime(runtime) {}
+
+Scheduler::~Scheduler() = default;
+
+Completion* Scheduler::completionOf(const Value& value) {
+    if (auto coroutine = value.as<CoroutineObject>()) return &coroutine->completion;
+    if (auto future = value.as<FutureObject>()) return &future->completion;
+    return nullptr;
+}
+
+Reactor& Scheduler::getReactor() {
+    if (!reactor) reactor = std::make_unique<Reactor>();
+    return *reactor;
+}
+
+Value Scheduler::run(const Value& awaitable) {
+    Completion* completion = completionOf(awaitable);
+    if (!completion) {
+        throw RuntimeError(std::string("TypeError: run() expects a coroutine or future, not '") +
+                           typeName(awaitable.getType()) + "'");
+    }
+    if (running) throw RuntimeError("RuntimeError: run() cannot be called from a running coroutine");
+
+    struct Running {
+        Scheduler& scheduler;
+        ~Running() {
+            scheduler.running = false;
+            scheduler.target = nullptr;
+        }
+    } guard{*this};
+    running = true;
+    target = completion;
+    Value keep = awaitable;
+    if (auto coroutine = awaitable.as<CoroutineObject>()) start(*coroutine);
+
+    while (completion->pending()) {
+        while (!ready.empty()) {
+            Value next = std::move(ready.front());
+            ready.pop_front();
+            step(*next.as<CoroutineObject>());
+        }
+        if (!completion->pending()) break;
+
+        fireTimers();
+        if (!ready.empty()) {
+            // Sockets get their turn between rounds of ready coroutines
+            if (operations > 0 || !finishers.empty()) poll(0);
+            continue;
+        }
+        if (timers.empty() && operations == 0 && finishers.empty()) {
+            throw RuntimeError("RuntimeError: deadlock: nothing left to run can complete what run() awaits");
+        }
+
+        int timeout = -1;
+        if (!timers.empty()) {
+            auto wait = std::chrono::ceil<std::chrono::milliseconds>(timers.top().deadline - Clock::now()).count();
+            timeout = static_cast<int>(std::clamp<decltype(wait)>(wait, 0, INT_MAX));
+        }
+        poll(timeout);
+    }
+
+    if (completion->state == Completion::State::FAILED) throw RuntimeError(completion->error);
+    return completion->result;
+}
+
+void Scheduler::start(CoroutineObject& coroutine) {
+    if (coroutine.state == CoroutineObject::State::CREATED) schedule(coroutine);
+}
+
+void Scheduler::schedule(CoroutineObject& coroutine, bool next) {
+    if (coroutine.queued) return;
+    coroutine.queued = true;
+    if (next) {
+        ready.emplace_front(&coroutine);
+    } else {
+        ready.emplace_back(&coroutine);
+    }
+}
+
+bool Scheduler::await(CoroutineObject& waiter, const Value& awaited, Value& result) {
+    Completion* completion = completionOf(awaited);
+    if (!completion) {
+        throw RuntimeError(std::string("TypeError: object ") + typeName(awaited.getType()) +
+                           " can't be used in 'await' expression");
+    }
+    auto coroutine = awaited.as<CoroutineObject>();
+    if (coroutine == &waiter) {
+        throw RuntimeError("RuntimeError: coroutine '" + waiter.name() + "' awaits itself");
+    }
+
+    switch (completion->state) {
+        case Completion::State::DONE: {
+            // result may be the register holding awaited
+            Value value = completion->result;
+            result = std::move(value);
+            return true;
+        }
+        case Completion::State::FAILED:
+            throw RuntimeError(completion->error);
+        case Completion::State::PENDING:
+            break;
+    }
+
+    completion->waiters.emplace_back(&waiter);
+    waiter.awaiting = awaited;
+    // A coroutine awaited as it is made runs next, as a call would
+    if (coroutine && coroutine->state == CoroutineObject::State::CREATED) schedule(*coroutine, true);
+    return false;
+}
+
+void Scheduler::step(CoroutineObject& coroutine) {
+    coroutine.queued = false;
+    Value keep(&coroutine);
+    try {
+        if (coroutine.state == CoroutineObject::State::SUSPENDED) {
+            Value awaited = std::move(coroutine.awaiting);
+            const Completion& outcome = *completionOf(awaited);
+            if (outcome.state == Completion::State::FAILED) throw RuntimeError(outcome.error);
+            coroutine.registers[coroutine.awaitRegister] = outcome.result;
+        }
+        Value result;
+        if (runtime.resume(coroutine, result)) {
+            coroutine.completion.result = std::move(result);
+            coroutine.completion.state = Completion::State::DONE;
+            settle(coroutine.completion);
+        }
+    } catch (const RuntimeError& error) {
+        coroutine.state = CoroutineObject::State::FINISHED;
+        coroutine.registers.clear();
+        coroutine.completion.error = error.what();
+        coroutine.completion.state = Completion::State::FAILED;
+        // Nobody is told: a spawned coroutine's error would vanish
+        if (coroutine.completion.waiters.empty() && &coroutine.completion != target) {
+            std::cout.flush();
+            std::cerr << "error in coroutine '" << coroutine.name() << "': " << error.what() << std::endl;
+        }
+        settle(coroutine.completion);
+    }
+}
+
+void Scheduler::settle(Completion& completion) {
+    std::vector<Value> waiters = std::move(completion.waiters);
+    completion.waiters.clear();
+    for (const Value& waiter : waiters) {
+        if (auto coroutine = waiter.as<CoroutineObject>()) {
+            schedule(*coroutine);
+        } else if (auto gathering = waiter.as<FutureObject>()) {
+            gatherStep(*gathering, completion);
+        }
+    }
+}
+
+void Scheduler::resolve(FutureObject& future, Value result) {
+    if (!future.completion.pending()) return;
+    future.completion.result = std::move(result);
+    future.completion.state = Completion::State::DONE;
+    settle(future.completion);
+}
+
+void Scheduler::fail(FutureObject& future, std::string error) {
+    if (!future.completion.pending()) return;
+    future.completion.error = std::move(error);
+    future.completion.state = Completion::State::FAILED;
+    settle(future.completion);
+}
+
+namespace {
+
+Value gatheredResults(const FutureObject& gathering) {
+    std::vector<Value> results;
+    results.reserve(gathering.gathered.size());
+    for (const Value& part : gathering.gathered) results.push_back(Scheduler::completionOf(part)->result);
+    return Value::make<ListObject>(std::move(results));
+}
+
+} // namespace
+
+// The first failure fails the whole gather, like Python's asyncio.gather
+Value Scheduler::gather(std::vector<Value> parts) {
+    for (const Value& part : parts) {
+        if (!completionOf(part)) {
+            throw RuntimeError(std::string("TypeError: gather() arguments must be coroutines or futures, not '") +
+                               typeName(part.getType()) + "'");
+        }
+    }
+
+    Value future = Value::make<FutureObject>();
+    auto gathering = future.as<FutureObject>();
+    gathering->gathered = std::move(parts);
+    for (const Value& part : gathering->gathered) {
+        Completion* completion = completionOf(part);
+        if (completion->state == Completion::State::FAILED) {
+            fail(*gathering, completion->error);
+            return future;
+        }
+        if (completion->pending()) {
+            gathering->outstanding++;
+            completion->waiters.push_back(future);
+            if (auto coroutine = part.as<CoroutineObject>()) start(*coroutine);
+        }
+    }
+    if (gathering->outstanding == 0) {
+        resolve(*gathering, gatheredResults(*gathering));
+        gathering->gathered.clear();
+    }
+    return future;
+}
+
+void Scheduler::gatherStep(FutureObject& gathering, const Completion& part) {
+    if (!gathering.completion.pending()) return;
+    if (part.state == Completion::State::FAILED) {
+        fail(gathering, part.error);
+    } else if (--gathering.outstanding == 0) {
+        resolve(gathering, gatheredResults(gathering));
+    } else {
+        return;
+    }
+    // The parts are not needed once the results are in
+    gathering.gathered.clear();
+}
+
+Value Scheduler::sleep(double seconds) {
+    if (!(seconds >= 0)) throw RuntimeError("ValueError: sleep length must be non-negative");
+    Value future = Value::make<FutureObject>();
+    auto delay = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    timers.push(Timer{Clock::now() + delay, timerSequence++, future});
+    return future;
+}
+
+void Scheduler::fireTimers() {
+    auto now = Clock::now();
+    while (!timers.empty() && timers.top().deadline <= now) {
+        Value future = timers.top().future;
+        timers.pop();
+        resolve(*future.as<FutureObject>(), Value());
+    }
+}
+
+void Scheduler::watch(int fd, bool write, const Value& future, Attempt attempt) {
+    Operation& operation = write ? watches[fd].write : watches[fd].read;
+    if (!operation.future.isNone()) {
+        throw RuntimeError(std::string("RuntimeError: the socket already has a pending ") + (write ? "send" : "receive"));
+    }
+    operation.future = future;
+    operation.attempt = std::move(attempt);
+    operations++;
+    try {
+        updateInterest(fd);
+    } catch (...) {
+        Operation& failed = write ? watches[fd].write : watches[fd].read;
+        failed = Operation{};
+        operations--;
+        updateInterest(fd);
+        throw;
+    }
+}
+
+void Scheduler::unwatch(int fd) {
+    auto it = watches.find(fd);
+    if (it == watches.end()) return;
+    Watch dropped = std::move(it->second);
+    watches.erase(it);
+    if (reactor) reactor->set(fd, false, false);
+
+    for (Operation* operation : {&dropped.read, &dropped.write}) {
+        if (operation->future.isNone()) continue;
+        operations--;
+        fail(*operation->future.as<FutureObject>(), "OSError: the socket was closed");
+    }
+}
+
+void Scheduler::updateInterest(int fd) {
+    auto it = watches.find(fd);
+    if (it == watches.end()) return;
+    bool read = !it->second.read.future.isNone();
+    bool write = !it->second.write.future.isNone();
+    if (!read && !write) watches.erase(it);
+    getReactor().set(fd, read, write);
+}
+
+void Scheduler::dispatch(int fd, bool readable, bool writable) {
+    auto retry = [this, fd](bool write) {
+        auto it = watches.find(fd);
+        if (it == watches.end()) return;
+        Operation& operation = write ? it->second.write : it->second.read;
+        if (operation.future.isNone()) return;
+
+        Value future = operation.future;
+        bool done;
+        try {
+            done = operation.attempt(*future.as<FutureObject>());
+        } catch (const std::exception& error) {
+            fail(*future.as<FutureObject>(), error.what());
+            done = true;
+        }
+        if (!done) return;
+
+        it = watches.find(fd);
+        if (it == watches.end()) return;
+        Operation& finished = write ? it->second.write : it->second.read;
+        if (finished.future.asObject() == future.asObject()) {
+            finished = Operation{};
+            operations--;
+        }
+    };
+    if (readable) retry(false);
+    if (writable) retry(true);
+    updateInterest(fd);
+}
+
+void Scheduler::poll(int timeoutMilliseconds) {
+    getReactor().wait(timeoutMilliseconds, [this](int fd, bool readable, bool writable) {
+        dispatch(fd, readable, writable);
+    });
+    runFinished();
+}
+
+void Scheduler::offload(std::function<void()> work, std::function<void()> finish) {
+    if (!pool) pool = std::make_unique<pulse::driver::ThreadPool>(WORKERS);
+    Reactor& wakeup = getReactor();
+    uint64_t job = nextJob++;
+    finishers.emplace(job, std::move(finish));
+    pool->submit([this, job, &wakeup, work = std::move(work)] {
+        work();
+        {
+            std::lock_guard<std::mutex> lock(finishedMutex);
+            finished.push_back(job);
+        }
+        wakeup.wake();
+    });
+}
+
+void Scheduler::runFinished() {
+    std::vector<uint64_t> jobs;
+    {
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        jobs.swap(finished);
+    }
+    for (uint64_t job : jobs) {
+        auto node = finishers.extract(job);
+        if (node) node.mapped()();
+    }
+}
+
+// Builtins
+
+Value Runtime::runFunction(Runtime& runtime, std::span<const Value> args) {
+    return runtime.getScheduler().run(args[0]);
+}
+
+Value Runtime::spawnFunction(Runtime& runtime, std::span<const Value> args) {
+    auto coroutine = args[0].as<CoroutineObject>();
+    if (!coroutine) {
+        throw RuntimeError(std::string("TypeError: spawn() expects a coroutine, not '") +
+                           typeName(args[0].getType()) + "'");
+    }
+    runtime.getScheduler().start(*coroutine);
+    return args[0];
+}
+
+Value Runtime::sleepFunction(Runtime& runtime, std::span<const Value> args) {
+    if (!args[0].isNumber()) {
+        throw RuntimeError(std::string("TypeError: sleep() expects a number, not '") +
+                           typeName(args[0].getType()) + "'");
+    }
+    return runtime.getScheduler().sleep(args[0].toFloat());
+}
+
+// gather(a, b, ...) or gather([a, b, ...])
+Value Runtime::gatherFunction(Runtime& runtime, std::span<const Value> args) {
+    std::vector<Value> parts;
+    auto list = args.size() == 1 ? args[0].as<ListObject>() : nullptr;
+    if (list) {
+        parts.reserve(list->size());
+        for (size_t i = 0; i < list->size(); i++) parts.push_back(list->at(i));
+    } else {
+        parts.assign(args.begin(), args.end());
+    }
+    return runtime.getScheduler().gather(std::move(parts));
+}
+
+} // namespace pulse::runtime
@@ -0,0 +1,346 @@
+// TCP sockets for coroutines: listen, accept, connect, recv, send and close.
+// Every descriptor is non-blocking; an operation the kernel cannot finish at
+// once returns a future the Scheduler completes when the descriptor is ready.
+// A socket is an instance of the native class "socket" with its descriptor
+// in .fd and its local port in .port.
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+#include "runtime/runtime.hpp"
+#include "runtime/scheduler.hpp"
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace pulse::runtime {
+
+#ifndef _WIN32
+
+namespace {
+
+// Sends to a peer that hung up fail with EPIPE instead of raising SIGPIPE
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+constexpr int64_t DEFAULT_RECEIVE = 64 * 1024;
+
+std::string osError(const char* call, int error = errno) {
+    return std::string("OSError: ") + call + ": " + std::strerror(error);
+}
+
+bool wouldBlock(int error) {
+    return error == EAGAIN || error == EWOULDBLOCK || error == EINTR;
+}
+
+void prepare(int fd) {
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+}
+
+// Requests go out as soon as they are written, not after Nagle's delay
+void noDelay(int fd) {
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+Value makeSocket(int fd) {
+    Value socket = Value::make<InstanceObject>(std::string("socket"));
+    auto instance = socket.as<InstanceObject>();
+    sockaddr_storage address{};
+    socklen_t length = sizeof(address);
+    int64_t port = 0;
+    if (::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) == 0) {
+        if (address.ss_family == AF_INET) port = ntohs(reinterpret_cast<sockaddr_in*>(&address)->sin_port);
+        if (address.ss_family == AF_INET6) port = ntohs(reinterpret_cast<sockaddr_in6*>(&address)->sin6_port);
+    }
+    instance->fields["fd"] = Value::fromInt(fd);
+    instance->fields["port"] = Value::fromInt(port);
+    return socket;
+}
+
+InstanceObject& socketObject(const Value& value, const char* function) {
+    auto instance = value.as<InstanceObject>();
+    if (!instance || !instance->cls.isNone() || instance->className != "socket") {
+        throw RuntimeError(std::string("TypeError: ") + function + "() expects a socket, not '" +
+                           typeName(value.getType()) + "'");
+    }
+    return *instance;
+}
+
+int descriptor(const Value& value, const char* function) {
+    auto& socket = socketObject(value, function);
+    auto fd = socket.fields.find("fd");
+    if (fd == socket.fields.end() || !fd->second.isInt()) {
+        throw RuntimeError(std::string("TypeError: ") + function + "() expects a socket");
+    }
+    if (fd->second.asInt() < 0) throw RuntimeError("OSError: the socket is closed");
+    return static_cast<int>(fd->second.asInt());
+}
+
+const std::string& stringArgument(const Value& value, const char* function) {
+    auto string = value.as<StringObject>();
+    if (!string) {
+        throw RuntimeError(std::string("TypeError: ") + function + "() expects a str, not '" +
+                           typeName(value.getType()) + "'");
+    }
+    return string->value;
+}
+
+int portArgument(const Value& value, const char* function) {
+    if (!value.isInt() || value.asInt() < 0 || value.asInt() > 65535) {
+        throw RuntimeError(std::string("ValueError: ") + function + "() port must be an int in 0..65535");
+    }
+    return static_cast<int>(value.asInt());
+}
+
+// Try the operation now and leave it to the Scheduler if it would block
+Value startOperation(Scheduler& scheduler, int fd, bool write, Scheduler::Attempt attempt) {
+    Value future = Value::make<FutureObject>();
+    if (!attempt(*future.as<FutureObject>())) {
+        scheduler.watch(fd, write, future, std::move(attempt));
+    }
+    return future;
+}
+
+// Addresses of a name, looked up on a worker thread
+struct Lookup {
+    std::string host;
+    std::string service;
+    std::vector<sockaddr_storage> addresses;
+    std::vector<socklen_t> lengths;
+    std::string error;
+};
+
+// Connects to the addresses in turn from index on, completing future with
+// the first that accepts
+void connectFrom(Scheduler& scheduler, const Value& future, std::shared_ptr<Lookup> lookup, size_t index,
+                 int lastError) {
+    for (; index < lookup->addresses.size(); index++) {
+        const auto* address = reinterpret_cast<const sockaddr*>(&lookup->addresses[index]);
+        int fd = ::socket(address->sa_family, SOCK_STREAM, 0);
+        if (fd < 0) {
+            lastError = errno;
+            continue;
+        }
+        prepare(fd);
+        if (::connect(fd, address, lookup->lengths[index]) == 0) {
+            noDelay(fd);
+            scheduler.resolve(*future.as<FutureObject>(), makeSocket(fd));
+            return;
+        }
+        if (errno == EINPROGRESS) {
+            // Writable once the handshake is over, one way or the other
+            size_t next = index + 1;
+            scheduler.watch(fd, true, future, [&scheduler, fd, lookup, next, future](FutureObject& pending) {
+                int error = 0;
+                socklen_t length = sizeof(error);
+                ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length);
+                if (error == 0) {
+                    noDelay(fd);
+                    scheduler.resolve(pending, makeSocket(fd));
+                    return true;
+                }
+                // The next address first, so its socket cannot reuse this
+                // descriptor while the Scheduler still watches it
+                connectFrom(scheduler, future, lookup, next, error);
+                ::close(fd);
+                return true;
+            });
+            return;
+        }
+        lastError = errno;
+        ::close(fd);
+    }
+    scheduler.fail(*future.as<FutureObject>(), osError("connect", lastError) + " (" + lookup->host + ")");
+}
+
+} // namespace
+
+Value Runtime::listenFunction(Runtime& runtime, std::span<const Value> args) {
+    (void)runtime;
+    const std::string& host = stringArgument(args[0], "listen");
+    int port = portArgument(args[1], "listen");
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* results = nullptr;
+    std::string service = std::to_string(port);
+    if (int status = ::getaddrinfo(host.empty() ? nullptr : host.c_str(), service.c_str(), &hints, &results)) {
+        throw RuntimeError("OSError: listen: " + host + ": " + ::gai_strerror(status));
+    }
+
+    int fd = -1;
+    int error = 0;
+    for (addrinfo* address = results; address; address = address->ai_next) {
+        fd = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (fd < 0) {
+            error = errno;
+            continue;
+        }
+        int on = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (::bind(fd, address->ai_addr, address->ai_addrlen) == 0 && ::listen(fd, SOMAXCONN) == 0) break;
+        error = errno;
+        ::close(fd);
+        fd = -1;
+    }
+    ::freeaddrinfo(results);
+    if (fd < 0) throw RuntimeError(osError("listen", error));
+
+    prepare(fd);
+    return makeSocket(fd);
+}
+
+Value Runtime::acceptFunction(Runtime& runtime, std::span<const Value> args) {
+    int fd = descriptor(args[0], "accept");
+    Scheduler& scheduler = runtime.getScheduler();
+    return startOperation(scheduler, fd, false, [&scheduler, fd](FutureObject& future) {
+        int client = ::accept(fd, nullptr, nullptr);
+        if (client < 0) {
+            // A connection reset while queued is the next one's turn
+            if (wouldBlock(errno) || errno == ECONNABORTED) return false;
+            scheduler.fail(future, osError("accept"));
+            return true;
+        }
+        prepare(client);
+        noDelay(client);
+        scheduler.resolve(future, makeSocket(client));
+        return true;
+    });
+}
+
+Value Runtime::connectFunction(Runtime& runtime, std::span<const Value> args) {
+    auto lookup = std::make_shared<Lookup>();
+    lookup->host = stringArgument(args[0], "connect");
+    lookup->service = std::to_string(portArgument(args[1], "connect"));
+
+    // getaddrinfo blocks, and has no descriptor to wait on
+    Scheduler& scheduler = runtime.getScheduler();
+    Value future = Value::make<FutureObject>();
+    scheduler.offload(
+        [lookup] {
+            addrinfo hints{};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            addrinfo* results = nullptr;
+            if (int status = ::getaddrinfo(lookup->host.c_str(), lookup->service.c_str(), &hints, &results)) {
+                lookup->error = "OSError: connect: " + lookup->host + ": " + ::gai_strerror(status);
+                return;
+            }
+            for (addrinfo* address = results; address; address = address->ai_next) {
+                sockaddr_storage storage{};
+                std::memcpy(&storage, address->ai_addr, address->ai_addrlen);
+                lookup->addresses.push_back(storage);
+                lookup->lengths.push_back(address->ai_addrlen);
+            }
+            ::freeaddrinfo(results);
+        },
+        [&scheduler, lookup, future] {
+            if (!lookup->error.empty()) {
+                scheduler.fail(*future.as<FutureObject>(), lookup->error);
+                return;
+            }
+            connectFrom(scheduler, future, lookup, 0, EHOSTUNREACH);
+        });
+    return future;
+}
+
+// recv(socket[, size]): up to size bytes as a str, "" once the peer closed
+Value Runtime::recvFunction(Runtime& runtime, std::span<const Value> args) {
+    if (args.empty() || args.size() > 2) {
+        throw RuntimeError("TypeError: recv() takes 1 or 2 arguments (" + std::to_string(args.size()) + " given)");
+    }
+    int fd = descriptor(args[0], "recv");
+    int64_t size = DEFAULT_RECEIVE;
+    if (args.size() == 2) {
+        if (!args[1].isInt() || args[1].asInt() <= 0) throw RuntimeError("ValueError: recv() size must be positive");
+        size = args[1].asInt();
+    }
+
+    Scheduler& scheduler = runtime.getScheduler();
+    return startOperation(scheduler, fd, false, [&scheduler, fd, size](FutureObject& future) {
+        std::string buffer(static_cast<size_t>(size), '\0');
+        ssize_t received = ::recv(fd, buffer.data(), buffer.size(), 0);
+        if (received < 0) {
+            if (wouldBlock(errno)) return false;
+            scheduler.fail(future, osError("recv"));
+            return true;
+        }
+        buffer.resize(static_cast<size_t>(received));
+        scheduler.resolve(future, Value::make<StringObject>(std::move(buffer)));
+        return true;
+    });
+}
+
+// send(socket, data): completes with len(data) once all of it is written
+Value Runtime::sendFunction(Runtime& runtime, std::span<const Value> args) {
+    int fd = descriptor(args[0], "send");
+    auto data = std::make_shared<std::string>(stringArgument(args[1], "send"));
+    auto sent = std::make_shared<size_t>(0);
+
+    Scheduler& scheduler = runtime.getScheduler();
+    return startOperation(scheduler, fd, true, [&scheduler, fd, data, sent](FutureObject& future) {
+        while (*sent < data->size()) {
+            ssize_t written = ::send(fd, data->data() + *sent, data->size() - *sent, SEND_FLAGS);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                if (wouldBlock(errno)) return false;
+                scheduler.fail(future, osError("send"));
+                return true;
+            }
+            *sent += static_cast<size_t>(written);
+        }
+        scheduler.resolve(future, Value::fromInt(static_cast<int64_t>(data->size())));
+        return true;
+    });
+}
+
+// Pending operations on the socket fail; closing twice does nothing
+Value Runtime::closeFunction(Runtime& runtime, std::span<const Value> args) {
+    auto& socket = socketObject(args[0], "close");
+    auto fd = socket.fields.find("fd");
+    if (fd == socket.fields.end() || !fd->second.isInt() || fd->second.asInt() < 0) return Value();
+    int descriptor = static_cast<int>(fd->second.asInt());
+    fd->second = Value::fromInt(-1);
+    runtime.getScheduler().unwatch(descriptor);
+    ::close(descriptor);
+    return Value();
+}
+
+#else // _WIN32
+
+namespace {
+
+[[noreturn]] void unsupported() {
+    throw RuntimeError("OSError: sockets are not supported on this platform");
+}
+
+} // namespace
+
+Value Runtime::listenFunction(Runtime&, std::span<const Value>) { unsupported(); }
+Value Runtime::acceptFunction(Runtime&, std::span<const Value>) { unsupported(); }
+Value Runtime::connectFunction(Runtime&, std::span<const Value>) { unsupported(); }
+Value Runtime::recvFunction(Runtime&, std::span<const Value>) { unsupported(); }
+Value Runtime::sendFunction(Runtime&, std::span<const Value>) { unsupported(); }
+Value Runtime::closeFunction(Runtime&, std::span<const Value>) { unsupported(); }
+
+#endif
+
+} // namespace pulse::runtime
@@ -0,0 +1,41 @@
+#include "runtime/symbols.hpp"
+#include <mutex>
+
+namespace pulse::runtime {
+
+SymbolTable& SymbolTable::global() {
+    static SymbolTable table;
+    return table;
+}
+
+Symbol SymbolTable::intern(std::string_view name) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = ids.find(name);
+        if (it != ids.end()) return it->second;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(name);
+    if (it != ids.end()) return it->second;
+
+    Symbol symbol = static_cast<Symbol>(names.size());
+    const std::string& stored = names.emplace_back(name);
+    ids.emplace(stored, symbol);
+    return symbol;
+}
+
+bool SymbolTable::find(std::string_view name, Symbol& symbol) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(name);
+    if (it == ids.end()) return false;
+    symbol = it->second;
+    return true;
+}
+
+std::string_view SymbolTable::name(Symbol symbol) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return names[static_cast<uint32_t>(symbol)];
+}
+
+} // namespace pulse::runtime
@@ -0,0 +1,503 @@
+#include "runtime/value.hpp"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <functional>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace pulse::runtime {
+
+namespace {
+
+// Python's float repr: shortest round-trip digits, always with a '.' or exponent
+std::string formatFloat(double value) {
+    if (std::isnan(value)) return "nan";
+    if (std::isinf(value)) return value > 0 ? "inf" : "-inf";
+
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    std::string text(buffer, result.ptr);
+    if (text.find_first_of(".e") == std::string::npos) {
+        text += ".0";
+    }
+    return text;
+}
+
+std::string quote(const std::string& text) {
+    std::string result = "'";
+    for (char c : text) {
+        switch (c) {
+            case '\'': result += "\\'"; break;
+            case '\\': result += "\\\\"; break;
+            case '\n': result += "\\n"; break;
+            case '\t': result += "\\t"; break;
+            case '\r': result += "\\r"; break;
+            default: result += c; break;
+        }
+    }
+    return result + "'";
+}
+
+size_t hashInteger(int64_t value) {
+    return std::hash<int64_t>()(value);
+}
+
+} // namespace
+
+const char* typeName(ValueType type) {
+    switch (type) {
+        case ValueType::NONE: return "NoneType";
+        case ValueType::INTEGER: return "int";
+        case ValueType::FLOAT: return "float";
+        case ValueType::BOOLEAN: return "bool";
+        case ValueType::STRING: return "str";
+        case ValueType::LIST: return "list";
+        case ValueType::DICT: return "dict";
+        case ValueType::FUNCTION: return "function";
+        case ValueType::CLASS: return "type";
+        case ValueType::CLASS_INSTANCE: return "instance";
+        case ValueType::COROUTINE: return "coroutine";
+        case ValueType::FUTURE: return "future";
+    }
+    return "object";
+}
+
+namespace {
+
+template <typename T>
+void destroyAs(Object* object) noexcept {
+    Heap& heap = Heap::current();
+    T* typed = static_cast<T*>(object);
+    if constexpr (std::is_base_of_v<ContainerObject, T>) heap.untrack(typed);
+    typed->~T();
+    heap.release(typed, sizeof(T));
+}
+
+} // namespace
+
+void Object::destroy(Object* object) noexcept {
+    switch (object->type) {
+        case ValueType::STRING: destroyAs<StringObject>(object); break;
+        case ValueType::LIST: destroyAs<ListObject>(object); break;
+        case ValueType::DICT: destroyAs<DictObject>(object); break;
+        case ValueType::FUNCTION: destroyAs<FunctionObject>(object); break;
+        case ValueType::CLASS: destroyAs<ClassObject>(object); break;
+        case ValueType::CLASS_INSTANCE: destroyAs<InstanceObject>(object); break;
+        case ValueType::COROUTINE: destroyAs<CoroutineObject>(object); break;
+        case ValueType::FUTURE: destroyAs<FutureObject>(object); break;
+        default: break; // inline types never reach the heap
+    }
+}
+
+double Value::toFloat() const {
+    switch (tag) {
+        case Tag::BOOL: return payload.boolean ? 1.0 : 0.0;
+        case Tag::INT: return static_cast<double>(payload.integer);
+        case Tag::FLOAT: return payload.number;
+        default:
+            throw RuntimeError(std::string("TypeError: expected a number, got '") + typeName(getType()) + "'");
+    }
+}
+
+bool Value::truthy() const {
+    switch (tag) {
+        case Tag::NONE: return false;
+        case Tag::BOOL: return payload.boolean;
+        case Tag::INT: return payload.integer != 0;
+        case Tag::FLOAT: return payload.number != 0.0;
+        case Tag::OBJECT: break;
+    }
+
+    if (auto string = as<StringObject>()) return !string->value.empty();
+    if (auto list = as<ListObject>()) return list->size() != 0;
+    if (auto dict = as<DictObject>()) return dict->size() != 0;
+    return true;
+}
+
+std::string Value::toString() const {
+    switch (tag) {
+        case Tag::NONE: return "None";
+        case Tag::BOOL: return payload.boolean ? "True" : "False";
+        case Tag::INT: return std::to_string(payload.integer);
+        case Tag::FLOAT: return formatFloat(payload.number);
+        case Tag::OBJECT: break;
+    }
+
+    switch (payload.object->getType()) {
+        case ValueType::STRING:
+            return static_cast<StringObject*>(payload.object)->value;
+        case ValueType::LIST: {
+            auto list = static_cast<ListObject*>(payload.object);
+            std::string result = list->isTuple() ? "(" : "[";
+            for (size_t i = 0; i < list->size(); i++) {
+                if (i > 0) result += ", ";
+                result += list->at(i).repr();
+            }
+            if (!list->isTuple()) return result + "]";
+            return result + (list->size() == 1 ? ",)" : ")");
+        }
+        case ValueType::DICT: {
+            std::string result = "{";
+            for (const auto& entry : static_cast<DictObject*>(payload.object)->items()) {
+                if (result.size() > 1) result += ", ";
+                result += entry.key.repr() + ": " + entry.value.repr();
+            }
+            return result + "}";
+        }
+        case ValueType::FUNCTION:
+            return "<function " + static_cast<FunctionObject*>(payload.object)->name + ">";
+        case ValueType::CLASS:
+            return "<class '" + static_cast<ClassObject*>(payload.object)->name + "'>";
+        case ValueType::CLASS_INSTANCE:
+            return "<" + static_cast<InstanceObject*>(payload.object)->className + " object>";
+        case ValueType::COROUTINE:
+            return "<coroutine " + static_cast<CoroutineObject*>(payload.object)->name() + ">";
+        case ValueType::FUTURE:
+            return static_cast<FutureObject*>(payload.object)->completion.pending() ? "<future pending>"
+                                                                                   : "<future done>";
+        default:
+            return "<object>";
+    }
+}
+
+std::string Value::repr() const {
+    if (auto string = as<StringObject>()) {
+        return quote(string->value);
+    }
+    return toString();
+}
+
+bool Value::operator==(const Value& other) const {
+    if (isNumber() && other.isNumber()) {
+        if (tag == Tag::FLOAT || other.tag == Tag::FLOAT) {
+            return toFloat() == other.toFloat();
+        }
+        int64_t left = tag == Tag::INT ? payload.integer : payload.boolean;
+        int64_t right = other.tag == Tag::INT ? other.payload.integer : other.payload.boolean;
+        return left == right;
+    }
+    if (tag != other.tag) return false;
+    if (tag == Tag::NONE) return true;
+
+    Object* left = payload.object;
+    Object* right = other.payload.object;
+    if (left == right) return true;
+    if (left->getType() != right->getType()) return false;
+
+    switch (left->getType()) {
+        case ValueType::STRING:
+            return static_cast<StringObject*>(left)->value == static_cast<StringObject*>(right)->value;
+        case ValueType::LIST: {
+            auto a = static_cast<ListObject*>(left);
+            auto b = static_cast<ListObject*>(right);
+            if (a->size() != b->size() || a->isTuple() != b->isTuple()) return false;
+            if (a->getStorage() == b->getStorage() && a->getStorage() == ListObject::Storage::INT) {
+                return std::equal(a->intElements().begin(), a->intElements().end(), b->intElements().begin());
+            }
+            for (size_t i = 0; i < a->size(); i++) {
+                if (a->at(i) != b->at(i)) return false;
+            }
+            return true;
+        }
+        case ValueType::DICT: {
+            auto a = static_cast<DictObject*>(left);
+            auto b = static_cast<DictObject*>(right);
+            if (a->size() != b->size()) return false;
+            for (const auto& entry : a->items()) {
+                const Value* match = b->find(entry.key);
+                if (!match || *match != entry.value) return false;
+            }
+            return true;
+        }
+        default:
+            return false; // functions and instances compare by identity
+    }
+}
+
+size_t Value::hash() const {
+    switch (tag) {
+        case Tag::NONE: return 0;
+        case Tag::BOOL: return hashInteger(payload.boolean);
+        case Tag::INT: return hashInteger(payload.integer);
+        case Tag::FLOAT: {
+            // Integral floats hash like the equal int (1.0 and 1 are one key)
+            double integral;
+            if (std::modf(payload.number, &integral) == 0.0 && std::abs(integral) < 9.2e18) {
+                return hashInteger(static_cast<int64_t>(integral));
+            }
+            return std::hash<double>()(payload.number);
+        }
+        case Tag::OBJECT: break;
+    }
+
+    switch (payload.object->getType()) {
+        case ValueType::STRING:
+            return std::hash<std::string>()(static_cast<StringObject*>(payload.object)->value);
+        case ValueType::LIST: {
+            auto list = static_cast<ListObject*>(payload.object);
+            if (!list->isTuple()) break;
+            // Element by element, in order; an unhashable element throws
+            size_t hash = hashInteger(static_cast<int64_t>(list->size()));
+            for (size_t i = 0; i < list->size(); i++) {
+                hash ^= list->at(i).hash() + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+            }
+            return hash;
+        }
+        case ValueType::DICT:
+            break;
+        default:
+            return std::hash<const void*>()(payload.object);
+    }
+    throw RuntimeError(std::string("TypeError: unhashable type: '") + typeName(getType()) + "'");
+}
+
+ListObject::ListObject(std::vector<Value> elements) : ContainerObject(TYPE) {
+    bool allInts = true, allFloats = true;
+    for (const Value& element : elements) {
+        allInts = allInts && element.isInt();
+        allFloats = allFloats && element.isFloat();
+    }
+    if (elements.empty() || allInts) {
+        ints.reserve(elements.size());
+        for (const Value& element : elements) ints.push_back(element.asInt());
+    } else if (allFloats) {
+        storage = Storage::FLOAT;
+        floats.reserve(elements.size());
+        for (const Value& element : elements) floats.push_back(element.asFloat());
+    } else {
+        storage = Storage::VALUE;
+        values = std::move(elements);
+    }
+}
+
+size_t ListObject::position(int64_t index) const {
+    int64_t count = static_cast<int64_t>(size());
+    if (index < 0) index += count;
+    if (index < 0 || index >= count) {
+        throw RuntimeError("IndexError: list index out of range");
+    }
+    return static_cast<size_t>(index);
+}
+
+bool ListObject::fits(const Value& element) {
+    if (size() == 0) {
+        // An empty list takes the storage of what it is given
+        storage = element.isInt() ? Storage::INT : element.isFloat() ? Storage::FLOAT : Storage::VALUE;
+        return true;
+    }
+    if (storage == Storage::VALUE) return true;
+    return storage == Storage::INT ? element.isInt() : element.isFloat();
+}
+
+void ListObject::box() {
+    std::vector<Value> boxed;
+    boxed.reserve(size() + 1);
+    for (size_t i = 0; i < size(); i++) boxed.push_back(at(i));
+    values = std::move(boxed);
+    ints = {};
+    floats = {};
+    storage = Storage::VALUE;
+}
+
+void ListObject::set(int64_t index, Value value) {
+    size_t i = position(index);
+    if (!fits(value)) box();
+    switch (storage) {
+        case Storage::INT: ints[i] = value.asInt(); break;
+        case Storage::FLOAT: floats[i] = value.asFloat(); break;
+        case Storage::VALUE: values[i] = std::move(value); break;
+    }
+}
+
+void ListObject::append(Value element) {
+    if (!fits(element)) box();
+    switch (storage) {
+        case Storage::INT: ints.push_back(element.asInt()); break;
+        case Storage::FLOAT: floats.push_back(element.asFloat()); break;
+        case Storage::VALUE: values.push_back(std::move(element)); break;
+    }
+}
+
+void ListObject::extend(const ListObject& other) {
+    if (size() == 0 && storage != other.storage) {
+        ints.clear();
+        floats.clear();
+        values.clear();
+        storage = other.storage;
+    }
+    if (storage != other.storage && storage != Storage::VALUE) {
+        if (other.size() == 0) return;
+        box();
+    }
+    // other may be this list, so it is read by index after growing
+    size_t count = other.size();
+    switch (storage) {
+        case Storage::INT: {
+            size_t end = ints.size();
+            ints.resize(end + count);
+            std::copy_n(other.ints.data(), count, ints.data() + end);
+            break;
+        }
+        case Storage::FLOAT: {
+            size_t end = floats.size();
+            floats.resize(end + count);
+            std::copy_n(other.floats.data(), count, floats.data() + end);
+            break;
+        }
+        case Storage::VALUE: {
+            values.reserve(values.size() + count);
+            for (size_t i = 0; i < count; i++) values.push_back(other.at(i));
+            break;
+        }
+    }
+}
+
+void ListObject::reserve(size_t count) {
+    switch (storage) {
+        case Storage::INT: ints.reserve(count); break;
+        case Storage::FLOAT: floats.reserve(count); break;
+        case Storage::VALUE: values.reserve(count); break;
+    }
+}
+
+Value ListObject::pop(int64_t index) {
+    size_t i = position(index);
+    Value element = at(i);
+    switch (storage) {
+        case Storage::INT: ints.erase(ints.begin() + static_cast<ptrdiff_t>(i)); break;
+        case Storage::FLOAT: floats.erase(floats.begin() + static_cast<ptrdiff_t>(i)); break;
+        case Storage::VALUE: values.erase(values.begin() + static_cast<ptrdiff_t>(i)); break;
+    }
+    return element;
+}
+
+void ListObject::clear() {
+    // Moved out first: dropping an element may reach this list again
+    std::vector<Value> dropped = std::move(values);
+    ints = {};
+    floats = {};
+    values = {};
+    storage = Storage::INT;
+}
+
+namespace {
+
+// Value::hash() is the identity for ints; spread it so that both the slot
+// (high bits) and the control byte (low 7 bits) depend on all of it
+size_t mixHash(size_t hash) {
+    uint64_t h = static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>(h ^ (h >> 32));
+}
+
+// Bit i set where group[i] == byte
+uint32_t matchGroup(const uint8_t* group, uint8_t byte) {
+#ifdef __SSE2__
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(static_cast<char>(byte)))));
+#else
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < 16; i++) {
+        mask |= static_cast<uint32_t>(group[i] == byte) << i;
+    }
+    return mask;
+#endif
+}
+
+} // namespace
+
+size_t DictObject::probe(const Value& key, size_t hash, bool& found) const {
+    found = false;
+    if (control.empty()) return 0;
+
+    size_t mixed = mixHash(hash);
+    auto tag = static_cast<uint8_t>(mixed & 0x7f);
+    size_t groups = control.size() / GROUP;
+    size_t group = (mixed >> 7) & (groups - 1);
+    // Triangular steps visit every group of a power-of-two table
+    for (size_t step = 1;; step++) {
+        const uint8_t* bytes = control.data() + group * GROUP;
+        for (uint32_t match = matchGroup(bytes, tag); match; match &= match - 1) {
+            size_t slot = group * GROUP + static_cast<size_t>(__builtin_ctz(match));
+            const Entry& entry = entries[slots[slot]];
+            if (entry.hash == hash && entry.key == key) {
+                found = true;
+                return slot;
+            }
+        }
+        if (uint32_t empty = matchGroup(bytes, EMPTY)) {
+            return group * GROUP + static_cast<size_t>(__builtin_ctz(empty));
+        }
+        group = (group + step) & (groups - 1);
+    }
+}
+
+void DictObject::grow() {
+    size_t capacity = control.empty() ? GROUP : control.size() * 2;
+    control.assign(capacity, EMPTY);
+    slots.assign(capacity, 0);
+    // Entries are distinct, so each goes to the first empty slot on its sequence
+    for (size_t i = 0; i < entries.size(); i++) {
+        bool found;
+        size_t slot = probe(entries[i].key, entries[i].hash, found);
+        control[slot] = static_cast<uint8_t>(mixHash(entries[i].hash) & 0x7f);
+        slots[slot] = static_cast<uint32_t>(i);
+    }
+}
+
+void DictObject::set(const Value& key, Value value) {
+    size_t hash = key.hash();
+    bool found;
+    size_t slot = probe(key, hash, found);
+    if (found) {
+        entries[slots[slot]].value = std::move(value);
+        return;
+    }
+    // Keep at most 7/8 of the slots full so every probe meets an empty one
+    if ((entries.size() + 1) * 8 > control.size() * 7) {
+        grow();
+        slot = probe(key, hash, found);
+    }
+    control[slot] = static_cast<uint8_t>(mixHash(hash) & 0x7f);
+    slots[slot] = static_cast<uint32_t>(entries.size());
+    entries.push_back({key, std::move(value), hash});
+}
+
+const Value* DictObject::find(const Value& key) const {
+    if (entries.empty()) return nullptr;
+    bool found;
+    size_t slot = probe(key, key.hash(), found);
+    return found ? &entries[slots[slot]].value : nullptr;
+}
+
+void DictObject::clear() {
+    std::vector<Entry> dropped = std::move(entries);
+    entries = {};
+    control = {};
+    slots = {};
+}
+
+ClassObject::ClassObject(std::string name) : ContainerObject(TYPE), name(std::move(name)) {
+    static std::atomic<uint64_t> nextId{1};
+    id = nextId.fetch_add(1, std::memory_order_relaxed);
+}
+
+const Value* ClassObject::findMethod(Symbol name) const {
+    for (const ClassObject* cls = this; cls; cls = cls->base.as<ClassObject>()) {
+        auto it = cls->methods.find(name);
+        if (it != cls->methods.end()) return &it->second;
+    }
+    return nullptr;
+}
+
+InstanceObject::InstanceObject(const Value& cls)
+    : ContainerObject(TYPE), className(cls.as<ClassObject>()->name), cls(cls) {}
+
+const std::string& CoroutineObject::name() const {
+    return function.as<FunctionObject>()->name;
+}
+
+} // namespace pulse::runtime
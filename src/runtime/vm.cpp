@@ -0,0 +1,985 @@
+#include "runtime/vm.hpp"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include "parser/ast.hpp"
+#include "runtime/runtime.hpp"
+#include "runtime/scheduler.hpp"
+
+// Threaded dispatch: every handler jumps straight to the next one through a
+// label table, giving each opcode its own indirect branch to predict. MSVC
+// has no labels-as-values and falls back to a switch.
+#if defined(__GNUC__) || defined(__clang__)
+#define PULSE_VM_COMPUTED_GOTO 1
+#else
+#define PULSE_VM_COMPUTED_GOTO 0
+#endif
+
+namespace pulse::runtime {
+
+namespace {
+
+static_assert(static_cast<int>(Value::Tag::NONE) == 0, "The VM stack relies on zeroed memory being None");
+
+uint64_t steadyNanoseconds() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Integer arithmetic wraps like the native code
+int64_t wrapAdd(int64_t a, int64_t b) { return static_cast<int64_t>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b)); }
+int64_t wrapSub(int64_t a, int64_t b) { return static_cast<int64_t>(static_cast<uint64_t>(a) - static_cast<uint64_t>(b)); }
+int64_t wrapMul(int64_t a, int64_t b) { return static_cast<int64_t>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b)); }
+
+bool isIntegral(const Value& value) {
+    return value.isInt() || value.isBool();
+}
+
+int64_t integral(const Value& value) {
+    return value.isInt() ? value.asInt() : static_cast<int64_t>(value.asBool());
+}
+
+[[noreturn]] void operandError(const char* op, const Value& left, const Value& right) {
+    throw RuntimeError(std::string("TypeError: unsupported operand type(s) for ") + op + ": '" +
+                       typeName(left.getType()) + "' and '" + typeName(right.getType()) + "'");
+}
+
+Value repeat(const Value& sequence, int64_t count) {
+    count = std::max<int64_t>(count, 0);
+    if (auto string = sequence.as<StringObject>()) {
+        std::string result;
+        result.reserve(string->value.size() * static_cast<size_t>(count));
+        for (int64_t i = 0; i < count; i++) result += string->value;
+        return Value::make<StringObject>(std::move(result));
+    }
+    auto list = sequence.as<ListObject>();
+    Value result = Value::make<ListObject>();
+    auto repeated = result.as<ListObject>();
+    for (int64_t i = 0; i < count; i++) {
+        if (i == 0) repeated->reserve(list->size() * static_cast<size_t>(count));
+        repeated->extend(*list);
+    }
+    if (list->isTuple()) repeated->makeTuple();
+    return result;
+}
+
+bool isSequence(const Value& value) {
+    return value.as<StringObject>() || value.as<ListObject>();
+}
+
+// Slow paths of the arithmetic opcodes; the int and float cases are inlined in the loop
+
+Value add(const Value& left, const Value& right) {
+    if (left.isNumber() && right.isNumber()) {
+        if (left.isFloat() || right.isFloat()) return Value::fromFloat(left.toFloat() + right.toFloat());
+        return Value::fromInt(wrapAdd(integral(left), integral(right)));
+    }
+    if (auto a = left.as<StringObject>()) {
+        if (auto b = right.as<StringObject>()) return Value::make<StringObject>(a->value + b->value);
+    }
+    if (auto a = left.as<ListObject>()) {
+        if (auto b = right.as<ListObject>()) {
+            Value result = Value::make<ListObject>();
+            result.as<ListObject>()->extend(*a);
+            result.as<ListObject>()->extend(*b);
+            if (a->isTuple() && b->isTuple()) result.as<ListObject>()->makeTuple();
+            return result;
+        }
+    }
+    operandError("+", left, right);
+}
+
+Value subtract(const Value& left, const Value& right) {
+    if (left.isNumber() && right.isNumber()) {
+        if (left.isFloat() || right.isFloat()) return Value::fromFloat(left.toFloat() - right.toFloat());
+        return Value::fromInt(wrapSub(integral(left), integral(right)));
+    }
+    operandError("-", left, right);
+}
+
+Value multiply(const Value& left, const Value& right) {
+    if (left.isNumber() && right.isNumber()) {
+        if (left.isFloat() || right.isFloat()) return Value::fromFloat(left.toFloat() * right.toFloat());
+        return Value::fromInt(wrapMul(integral(left), integral(right)));
+    }
+    if (isSequence(left) && isIntegral(right)) return repeat(left, integral(right));
+    if (isIntegral(left) && isSequence(right)) return repeat(right, integral(left));
+    operandError("*", left, right);
+}
+
+Value divide(const Value& left, const Value& right) {
+    if (!left.isNumber() || !right.isNumber()) operandError("/", left, right);
+    double divisor = right.toFloat();
+    if (divisor == 0.0) throw RuntimeError("ZeroDivisionError: division by zero");
+    return Value::fromFloat(left.toFloat() / divisor);
+}
+
+Value floorDivide(const Value& left, const Value& right) {
+    if (!left.isNumber() || !right.isNumber()) operandError("//", left, right);
+    if (left.isFloat() || right.isFloat()) {
+        double divisor = right.toFloat();
+        if (divisor == 0.0) throw RuntimeError("ZeroDivisionError: float floor division by zero");
+        return Value::fromFloat(std::floor(left.toFloat() / divisor));
+    }
+    int64_t a = integral(left);
+    int64_t b = integral(right);
+    if (b == 0) throw RuntimeError("ZeroDivisionError: integer division or modulo by zero");
+    if (b == -1) return Value::fromInt(wrapSub(0, a));
+    int64_t quotient = a / b;
+    if (a % b != 0 && ((a < 0) != (b < 0))) quotient--;
+    return Value::fromInt(quotient);
+}
+
+// Python's modulo takes the sign of the divisor
+Value modulo(const Value& left, const Value& right) {
+    if (!left.isNumber() || !right.isNumber()) operandError("%", left, right);
+    if (left.isFloat() || right.isFloat()) {
+        double b = right.toFloat();
+        if (b == 0.0) throw RuntimeError("ZeroDivisionError: float modulo");
+        double remainder = std::fmod(left.toFloat(), b);
+        if (remainder != 0.0 && ((remainder < 0) != (b < 0))) remainder += b;
+        return Value::fromFloat(remainder);
+    }
+    int64_t a = integral(left);
+    int64_t b = integral(right);
+    if (b == 0) throw RuntimeError("ZeroDivisionError: integer division or modulo by zero");
+    if (b == -1) return Value::fromInt(0);
+    int64_t remainder = a % b;
+    if (remainder != 0 && ((remainder < 0) != (b < 0))) remainder += b;
+    return Value::fromInt(remainder);
+}
+
+Value power(const Value& left, const Value& right) {
+    if (!left.isNumber() || !right.isNumber()) operandError("**", left, right);
+    if (isIntegral(left) && isIntegral(right) && integral(right) >= 0) {
+        int64_t base = integral(left);
+        uint64_t exponent = static_cast<uint64_t>(integral(right));
+        int64_t result = 1;
+        while (exponent) {
+            if (exponent & 1) result = wrapMul(result, base);
+            base = wrapMul(base, base);
+            exponent >>= 1;
+        }
+        return Value::fromInt(result);
+    }
+    double base = left.toFloat();
+    double exponent = right.toFloat();
+    if (base == 0.0 && exponent < 0) {
+        throw RuntimeError("ZeroDivisionError: 0.0 cannot be raised to a negative power");
+    }
+    return Value::fromFloat(std::pow(base, exponent));
+}
+
+enum class Comparison { EQ, NE, LT, LE, GT, GE };
+
+const char* comparisonSymbol(Comparison op) {
+    switch (op) {
+        case Comparison::EQ: return "==";
+        case Comparison::NE: return "!=";
+        case Comparison::LT: return "<";
+        case Comparison::LE: return "<=";
+        case Comparison::GT: return ">";
+        case Comparison::GE: return ">=";
+    }
+    return "?";
+}
+
+template <typename T>
+bool ordered(Comparison op, const T& a, const T& b) {
+    switch (op) {
+        case Comparison::LT: return a < b;
+        case Comparison::LE: return a <= b;
+        case Comparison::GT: return a > b;
+        case Comparison::GE: return a >= b;
+        case Comparison::EQ: return a == b;
+        case Comparison::NE: return a != b;
+    }
+    return false;
+}
+
+bool compare(Comparison op, const Value& left, const Value& right) {
+    if (op == Comparison::EQ) return left == right;
+    if (op == Comparison::NE) return left != right;
+
+    if (left.isNumber() && right.isNumber()) {
+        if (left.isFloat() || right.isFloat()) return ordered(op, left.toFloat(), right.toFloat());
+        return ordered(op, integral(left), integral(right));
+    }
+    auto a = left.as<StringObject>();
+    auto b = right.as<StringObject>();
+    if (a && b) return ordered(op, a->value, b->value);
+
+    throw RuntimeError(std::string("TypeError: '") + comparisonSymbol(op) + "' not supported between instances of '" +
+                       typeName(left.getType()) + "' and '" + typeName(right.getType()) + "'");
+}
+
+Value negate(const Value& operand) {
+    if (operand.isFloat()) return Value::fromFloat(-operand.asFloat());
+    if (isIntegral(operand)) return Value::fromInt(wrapSub(0, integral(operand)));
+    throw RuntimeError(std::string("TypeError: bad operand type for unary -: '") + typeName(operand.getType()) + "'");
+}
+
+Value plus(const Value& operand) {
+    if (operand.isFloat() || operand.isInt()) return operand;
+    if (operand.isBool()) return Value::fromInt(operand.asBool());
+    throw RuntimeError(std::string("TypeError: bad operand type for unary +: '") + typeName(operand.getType()) + "'");
+}
+
+Value subscript(const Value& object, const Value& index) {
+    if (auto list = object.as<ListObject>()) {
+        if (!isIntegral(index)) {
+            throw RuntimeError(std::string("TypeError: list indices must be integers, not '") +
+                               typeName(index.getType()) + "'");
+        }
+        return list->get(integral(index));
+    }
+    if (auto string = object.as<StringObject>()) {
+        if (!isIntegral(index)) {
+            throw RuntimeError(std::string("TypeError: string indices must be integers, not '") +
+                               typeName(index.getType()) + "'");
+        }
+        int64_t size = static_cast<int64_t>(string->value.size());
+        int64_t position = integral(index);
+        if (position < 0) position += size;
+        if (position < 0 || position >= size) throw RuntimeError("IndexError: string index out of range");
+        return Value::make<StringObject>(std::string(1, string->value[static_cast<size_t>(position)]));
+    }
+    if (auto dict = object.as<DictObject>()) {
+        if (const Value* value = dict->find(index)) return *value;
+        throw RuntimeError("KeyError: " + index.repr());
+    }
+    throw RuntimeError(std::string("TypeError: '") + typeName(object.getType()) + "' object is not subscriptable");
+}
+
+int64_t rangeBound(const Value& value) {
+    if (!isIntegral(value)) {
+        throw RuntimeError(std::string("TypeError: '") + typeName(value.getType()) +
+                           "' object cannot be interpreted as an integer");
+    }
+    return integral(value);
+}
+
+// Next item of a list, str or dict (its keys) at *position; false at the end
+bool iterate(const Value& iterable, Value& position, Value& item) {
+    auto index = static_cast<size_t>(position.asInt());
+    if (auto list = iterable.as<ListObject>()) {
+        if (index >= list->size()) return false;
+        item = list->at(index);
+    } else if (auto string = iterable.as<StringObject>()) {
+        if (index >= string->value.size()) return false;
+        item = Value::make<StringObject>(std::string(1, string->value[index]));
+    } else {
+        auto dict = iterable.as<DictObject>();
+        if (index >= dict->size()) return false;
+        item = dict->items()[index].key;
+    }
+    position = Value::fromInt(static_cast<int64_t>(index + 1));
+    return true;
+}
+
+[[noreturn]] void arityError(const FunctionObject& function, size_t given) {
+    throw RuntimeError("TypeError: " + function.name + "() takes " + std::to_string(function.arity) +
+                       " argument(s) (" + std::to_string(given) + " given)");
+}
+
+} // namespace
+
+VM::VM(Runtime& runtime)
+    : runtime(runtime),
+      stack(static_cast<Value*>(std::calloc(STACK_SIZE, sizeof(Value)))),
+      stackEnd(stack + STACK_SIZE), highWater(stack), initName(intern("__init__")),
+      globals(runtime.getGlobalContext()) {
+    if (!stack) throw std::bad_alloc();
+    frames.reserve(MAX_DEPTH);
+}
+
+VM::~VM() {
+    frames.clear();
+    for (Value* value = stack; value < highWater; value++) {
+        value->~Value();
+    }
+    std::free(stack);
+}
+
+Value* VM::top() const {
+    if (frames.empty()) return stack;
+    const Frame& frame = frames.back();
+    return frame.base + frame.proto->registerCount;
+}
+
+// The parameters are already in place; the remaining registers start as None
+void VM::pushFrame(FunctionProto* proto, Value* base, size_t argc, Value* result) {
+    if (frames.size() >= MAX_DEPTH || base + proto->registerCount > stackEnd) {
+        throw RuntimeError("RecursionError: maximum recursion depth exceeded in '" + proto->name + "'");
+    }
+    Value* end = base + proto->registerCount;
+    for (Value* reg = base + argc; reg < end; reg++) {
+        *reg = Value();
+    }
+    highWater = std::max(highWater, end);
+    frames.push_back(Frame{proto, proto->code.data(), base, result, Value(), false});
+    sampleDepth.store(static_cast<uint32_t>(frames.size()), std::memory_order_release);
+    if (countCalls) beginCall(frames.back());
+}
+
+void VM::popFrame(bool finished) {
+    Frame& frame = frames.back();
+    if (frame.counted) endCall(frame, finished);
+    sampleDepth.store(static_cast<uint32_t>(frames.size() - 1), std::memory_order_release);
+    frames.pop_back();
+}
+
+void VM::beginCall(Frame& frame) {
+    auto& counts = frame.proto->callCounts;
+    if (!counts.listed) {
+        counts.listed = true;
+        counted.push_back(frame.proto);
+    }
+    frame.counted = true;
+    if (counts.active++ == 0) frame.started = steadyNanoseconds();
+}
+
+void VM::endCall(Frame& frame, bool finished) {
+    auto& counts = frame.proto->callCounts;
+    if (finished) counts.calls++;
+    if (--counts.active == 0) counts.nanoseconds += steadyNanoseconds() - frame.started;
+}
+
+size_t VM::sampleStack(const FunctionProto** out, size_t max, bool& native) const {
+    size_t depth = sampleDepth.load(std::memory_order_acquire);
+    const FunctionProto* callee = nativeCallee.load(std::memory_order_acquire);
+    native = callee != nullptr;
+    if (max == 0) return 0;
+    size_t room = native ? max - 1 : max;
+    const Frame* running = frames.data();
+    size_t count = 0;
+    for (size_t i = depth > room ? depth - room : 0; i < depth; i++) {
+        out[count++] = running[i].proto;
+    }
+    if (native) out[count++] = callee;
+    return count;
+}
+
+Value VM::run(const std::shared_ptr<FunctionProto>& proto) {
+    size_t entry = frames.size();
+    pushFrame(proto.get(), top(), 0, nullptr);
+    return execute(entry);
+}
+
+Value VM::call(const FunctionObject& function, std::span<const Value> args) {
+    if (args.size() != function.code->parameterCount) {
+        arityError(function, args.size());
+    }
+    size_t entry = frames.size();
+    Value* base = top();
+    pushFrame(function.code.get(), base, 0, nullptr);
+    std::copy(args.begin(), args.end(), base);
+    return execute(entry);
+}
+
+// The saved registers go back on the stack above whatever is running, so
+// the AWAIT that suspends it always finds the coroutine's frame on top
+bool VM::resume(CoroutineObject& coroutine, Value& result) {
+    FunctionProto* proto = coroutine.function.as<FunctionObject>()->code.get();
+    size_t entry = frames.size();
+    Value* base = top();
+    pushFrame(proto, base, 0, nullptr);
+    std::move(coroutine.registers.begin(), coroutine.registers.end(), base);
+    coroutine.registers.clear();
+
+    Frame& frame = frames.back();
+    frame.pc = proto->code.data() + coroutine.resumeAt;
+    frame.coroutine = &coroutine;
+    coroutine.state = CoroutineObject::State::RUNNING;
+    result = execute(entry);
+    if (coroutine.state != CoroutineObject::State::RUNNING) return false;
+    coroutine.state = CoroutineObject::State::FINISHED;
+    return true;
+}
+
+bool VM::enterFunction(const Value& callee, Value* args, size_t argc, Value* result, CallSite* site) {
+    auto function = callee.as<FunctionObject>();
+    if (function->arity >= 0 && argc != static_cast<size_t>(function->arity)) {
+        arityError(*function, argc);
+    }
+    if (function->code) {
+        // An async function runs nothing yet: its call is a coroutine
+        if (function->code->isAsync) {
+            *result = Value::make<CoroutineObject>(callee, std::span<const Value>(args, argc));
+            return false;
+        }
+        if (function->code->tier && tieredCall(function->code.get(), args, argc, result, site)) {
+            return false;
+        }
+        pushFrame(function->code.get(), args, argc, result);
+        return true;
+    }
+    Value value = function->native(runtime, std::span<const Value>(args, argc));
+    *result = std::move(value);
+    return false;
+}
+
+bool VM::tieredCall(FunctionProto* proto, Value* args, size_t argc, Value* result, CallSite* site) {
+    const auto& tier = proto->tier;
+    const NativeCode* code = tier->native.load(std::memory_order_acquire);
+    if (!code && !tier->profiling) return false;
+
+    Shape shape = argumentShape(args, argc);
+    for (; code; code = code->next) {
+        if (code->shape != shape || code->generation != globals->getGeneration()) continue;
+
+        uint64_t raw[MAX_SHAPE_ARGUMENTS];
+        for (size_t i = 0; i < argc; i++) {
+            const Value& arg = args[i];
+            raw[i] = arg.isFloat() ? std::bit_cast<uint64_t>(arg.asFloat())
+                   : arg.isInt()   ? static_cast<uint64_t>(arg.asInt())
+                                   : static_cast<uint64_t>(arg.asBool());
+        }
+        // Samples taken meanwhile show the function as native code
+        nativeCallee.store(proto, std::memory_order_release);
+        uint64_t started = countCalls ? steadyNanoseconds() : 0;
+        uint64_t value = code->entry(raw);
+        if (countCalls) {
+            auto& counts = proto->callCounts;
+            if (!counts.listed) {
+                counts.listed = true;
+                counted.push_back(proto);
+            }
+            counts.calls++;
+            if (counts.active == 0) counts.nanoseconds += steadyNanoseconds() - started;
+        }
+        nativeCallee.store(nullptr, std::memory_order_release);
+        switch (code->returnType) {
+            case ValueType::FLOAT: *result = Value::fromFloat(std::bit_cast<double>(value)); break;
+            case ValueType::BOOLEAN: *result = Value::fromBool(value & 1); break;
+            default: *result = Value::fromInt(static_cast<int64_t>(value)); break;
+        }
+        return true;
+    }
+
+    if (tier->profiling) {
+        tier->lastShape = shape;
+        if (site) site->record(shape);
+        if (++tier->calls >= CALL_THRESHOLD) {
+            // A site that always passed the same types asks for those
+            requestTierUp(tier, site && !site->polymorphic ? site->shape : shape);
+        }
+    }
+    return false;
+}
+
+// A shape asked for before leaves the counters past the threshold, so the
+// next call with other argument types asks for those
+void VM::requestTierUp(const std::shared_ptr<TierProfile>& tier, Shape shape) {
+    NativeTier* nativeTier = runtime.getNativeTier();
+    if (!nativeTier || shape == NO_SHAPE ||
+        std::find(tier->requested.begin(), tier->requested.end(), shape) != tier->requested.end()) {
+        return;
+    }
+
+    tier->calls = 0;
+    tier->backEdges = 0;
+    tier->requested.push_back(shape);
+    if (tier->requested.size() >= MAX_SPECIALIZATIONS) {
+        tier->profiling = false;
+    }
+
+    // Only numbers have a native representation; other shapes still count
+    // toward the limit so a function called with strings stops profiling
+    for (size_t i = 0; i < tier->declaration->parameters.size(); i++) {
+        ValueType type = shapeArgument(shape, i);
+        if (type != ValueType::INTEGER && type != ValueType::FLOAT && type != ValueType::BOOLEAN) return;
+    }
+    nativeTier->request(tier, shape, globals->getGeneration());
+}
+
+bool VM::callValue(Value* slot, size_t argc, CallSite* site) {
+    if (slot->as<FunctionObject>()) {
+        return enterFunction(*slot, slot + 1, argc, slot, site);
+    }
+
+    // Calling a class builds an instance and runs __init__ on it, with the
+    // instance taking the class's register as `self`
+    if (auto cls = slot->as<ClassObject>()) {
+        Value instance = Value::make<InstanceObject>(*slot);
+        const Value* init = cls->findMethod(initName);
+        if (!init) {
+            if (argc != 0) throw RuntimeError("TypeError: " + cls->name + "() takes no arguments");
+            *slot = std::move(instance);
+            return false;
+        }
+        *slot = instance;
+        if (enterFunction(*init, slot, argc + 1, slot)) {
+            frames.back().owner = std::move(instance);
+            frames.back().returnsOwner = true;
+            return true;
+        }
+        *slot = std::move(instance);
+        return false;
+    }
+
+    throw RuntimeError(std::string("TypeError: '") + typeName(slot->getType()) + "' object is not callable");
+}
+
+bool VM::callMethod(Value* slot, size_t argc, AttributeCache& cache) {
+    bool bound = false;
+    Value method = findAttribute(*slot, cache, bound);
+    if (!bound) {
+        // A plain attribute (Class.method, a stored callable): call it like a variable
+        *slot = std::move(method);
+        return callValue(slot, argc);
+    }
+    if (enterFunction(method, slot, argc + 1, slot)) {
+        frames.back().owner = std::move(method);
+        return true;
+    }
+    return false;
+}
+
+// Instances look in their fields, then their class chain; other values in
+// the runtime's method table for their type. The cache remembers the last
+// receiver type (and class) seen at this site and the method it resolved to.
+const Value& VM::findAttribute(const Value& receiver, AttributeCache& cache, bool& bound) {
+    ValueType type = receiver.getType();
+    auto instance = receiver.as<InstanceObject>();
+    if (instance && !instance->fields.empty()) {
+        auto field = instance->fields.find(symbolName(cache.name));
+        if (field != instance->fields.end()) {
+            bound = false;
+            return field->second;
+        }
+    }
+
+    auto cls = instance ? instance->cls.as<ClassObject>() : receiver.as<ClassObject>();
+    bool hit = cache.type == type && cache.attribute && (cls ? cache.classId == cls->id : true);
+    if (!hit) {
+        const Value* attribute = nullptr;
+        if (cls) {
+            attribute = cls->findMethod(cache.name);
+        } else if (!instance) {
+            attribute = runtime.findMethod(type, cache.name);
+        }
+        if (!attribute) {
+            std::string name(symbolName(cache.name));
+            if (auto owner = receiver.as<ClassObject>()) {
+                throw RuntimeError("AttributeError: type object '" + owner->name + "' has no attribute '" + name + "'");
+            }
+            std::string typeLabel = instance ? instance->className : typeName(type);
+            throw RuntimeError("AttributeError: '" + typeLabel + "' object has no attribute '" + name + "'");
+        }
+        cache.type = type;
+        cache.classId = cls ? cls->id : 0;
+        cache.attribute = attribute;
+    }
+    bound = type != ValueType::CLASS;
+    return *cache.attribute;
+}
+
+Value* VM::resolveGlobal(GlobalCache& cache) {
+    Value* binding = globals->findVariable(cache.name);
+    if (!binding) {
+        throw RuntimeError("NameError: name '" + std::string(symbolName(cache.name)) + "' is not defined");
+    }
+    cache.binding = binding;
+    cache.generation = globals->getGeneration();
+    return binding;
+}
+
+Value VM::execute(size_t entry) {
+    FunctionProto* proto = frames.back().proto;
+    const Instruction* pc = frames.back().pc;
+    Value* R = frames.back().base;
+    const Value* K = proto->constants.data();
+    Instruction instruction{};
+    Value result;
+
+// Reload the running frame after a call or return
+#define VM_LOAD_FRAME()                       \
+    do {                                      \
+        Frame& frame = frames.back();         \
+        proto = frame.proto;                  \
+        pc = frame.pc;                        \
+        R = frame.base;                       \
+        K = proto->constants.data();          \
+    } while (false)
+
+// Conditional opcodes are followed by a JUMP word: take it or step over it
+#define VM_BRANCH(condition)                  \
+    do {                                      \
+        if (condition) {                      \
+            pc += 1 + pc->immediate();        \
+        } else {                              \
+            pc += 1;                          \
+        }                                     \
+    } while (false)
+
+#if PULSE_VM_COMPUTED_GOTO
+#define PULSE_VM_LABEL(name) &&op_##name,
+    static const void* const dispatch[] = {PULSE_OPCODES(PULSE_VM_LABEL)};
+#undef PULSE_VM_LABEL
+#define VM_CASE(name) op_##name
+#define VM_NEXT()                                                       \
+    do {                                                                \
+        instruction = *pc++;                                            \
+        goto* dispatch[static_cast<uint8_t>(instruction.op)];           \
+    } while (false)
+#else
+#define VM_CASE(name) case OpCode::name
+#define VM_NEXT() continue
+#endif
+
+// Integer and float fast paths around a generic fallback
+#define VM_ARITHMETIC(name, intExpr, floatExpr, slow, rightValue)                  \
+    VM_CASE(name): {                                                               \
+        const Value& left = R[instruction.b];                                      \
+        const Value& right = rightValue;                                           \
+        if (left.isInt() && right.isInt()) {                                       \
+            int64_t a = left.asInt(), b = right.asInt();                           \
+            R[instruction.a] = Value::fromInt(intExpr);                            \
+        } else if (left.isFloat() && right.isFloat()) {                            \
+            double a = left.asFloat(), b = right.asFloat();                        \
+            R[instruction.a] = Value::fromFloat(floatExpr);                        \
+        } else {                                                                   \
+            R[instruction.a] = slow(left, right);                                  \
+        }                                                                          \
+        VM_NEXT();                                                                 \
+    }
+
+#define VM_COMPARE(name, op, comparison, rightValue)                               \
+    VM_CASE(name): {                                                               \
+        const Value& left = R[instruction.b];                                      \
+        const Value& right = rightValue;                                           \
+        bool value = left.isInt() && right.isInt() ? left.asInt() op right.asInt() \
+                                                   : compare(comparison, left, right); \
+        R[instruction.a] = Value::fromBool(value);                                 \
+        VM_NEXT();                                                                 \
+    }
+
+#define VM_TEST(name, op, comparison, rightValue)                                  \
+    VM_CASE(name): {                                                               \
+        const Value& left = R[instruction.a];                                      \
+        const Value& right = rightValue;                                           \
+        bool value = left.isInt() && right.isInt() ? left.asInt() op right.asInt() \
+                                                   : compare(comparison, left, right); \
+        VM_BRANCH(value == static_cast<bool>(instruction.flag));                   \
+        VM_NEXT();                                                                 \
+    }
+
+    try {
+#if PULSE_VM_COMPUTED_GOTO
+        VM_NEXT();
+        {
+#else
+        for (;;) {
+            instruction = *pc++;
+            switch (instruction.op) {
+#endif
+
+        VM_CASE(LOAD_NONE): {
+            R[instruction.a] = Value();
+            VM_NEXT();
+        }
+        VM_CASE(LOAD_BOOL): {
+            R[instruction.a] = Value::fromBool(instruction.flag);
+            VM_NEXT();
+        }
+        VM_CASE(LOAD_INT): {
+            R[instruction.a] = Value::fromInt(instruction.immediate());
+            VM_NEXT();
+        }
+        VM_CASE(LOAD_CONST): {
+            R[instruction.a] = K[instruction.b];
+            VM_NEXT();
+        }
+        VM_CASE(MOVE): {
+            R[instruction.a] = R[instruction.b];
+            VM_NEXT();
+        }
+
+        VM_CASE(GET_GLOBAL): {
+            GlobalCache& cache = proto->globals[instruction.b];
+            Value* binding = cache.binding;
+            if (!binding || cache.generation != globals->getGeneration()) {
+                binding = resolveGlobal(cache);
+            }
+            R[instruction.a] = *binding;
+            VM_NEXT();
+        }
+        VM_CASE(SET_GLOBAL): {
+            GlobalCache& cache = proto->globals[instruction.b];
+            if (!cache.binding || cache.generation != globals->getGeneration()) {
+                cache.binding = &globals->bindVariable(cache.name);
+                cache.generation = globals->getGeneration();
+            }
+            // Replacing a function invalidates native code compiled against it
+            Value& binding = *cache.binding;
+            const Value& value = R[instruction.a];
+            if (binding.as<FunctionObject>() && !(value.isObject() && value.asObject() == binding.asObject())) {
+                globals->bumpGeneration();
+                cache.generation = globals->getGeneration();
+            }
+            binding = value;
+            VM_NEXT();
+        }
+
+        VM_ARITHMETIC(ADD, wrapAdd(a, b), a + b, add, R[instruction.c])
+        VM_ARITHMETIC(SUB, wrapSub(a, b), a - b, subtract, R[instruction.c])
+        VM_ARITHMETIC(MUL, wrapMul(a, b), a * b, multiply, R[instruction.c])
+        VM_ARITHMETIC(ADDK, wrapAdd(a, b), a + b, add, K[instruction.c])
+        VM_ARITHMETIC(SUBK, wrapSub(a, b), a - b, subtract, K[instruction.c])
+        VM_ARITHMETIC(MULK, wrapMul(a, b), a * b, multiply, K[instruction.c])
+
+        VM_CASE(DIV): {
+            R[instruction.a] = divide(R[instruction.b], R[instruction.c]);
+            VM_NEXT();
+        }
+        VM_CASE(FLOOR_DIV): {
+            R[instruction.a] = floorDivide(R[instruction.b], R[instruction.c]);
+            VM_NEXT();
+        }
+        VM_CASE(MOD): {
+            const Value& left = R[instruction.b];
+            const Value& right = R[instruction.c];
+            if (left.isInt() && right.isInt() && right.asInt() > 0) {
+                int64_t remainder = left.asInt() % right.asInt();
+                R[instruction.a] = Value::fromInt(remainder < 0 ? remainder + right.asInt() : remainder);
+            } else {
+                R[instruction.a] = modulo(left, right);
+            }
+            VM_NEXT();
+        }
+        VM_CASE(POW): {
+            R[instruction.a] = power(R[instruction.b], R[instruction.c]);
+            VM_NEXT();
+        }
+
+        VM_COMPARE(EQ, ==, Comparison::EQ, R[instruction.c])
+        VM_COMPARE(NE, !=, Comparison::NE, R[instruction.c])
+        VM_COMPARE(LT, <, Comparison::LT, R[instruction.c])
+        VM_COMPARE(LE, <=, Comparison::LE, R[instruction.c])
+        VM_COMPARE(GT, >, Comparison::GT, R[instruction.c])
+        VM_COMPARE(GE, >=, Comparison::GE, R[instruction.c])
+
+        VM_CASE(NEG): {
+            R[instruction.a] = negate(R[instruction.b]);
+            VM_NEXT();
+        }
+        VM_CASE(POS): {
+            R[instruction.a] = plus(R[instruction.b]);
+            VM_NEXT();
+        }
+        VM_CASE(NOT): {
+            R[instruction.a] = Value::fromBool(!R[instruction.b].truthy());
+            VM_NEXT();
+        }
+
+        VM_TEST(TEST_EQ, ==, Comparison::EQ, R[instruction.b])
+        VM_TEST(TEST_NE, !=, Comparison::NE, R[instruction.b])
+        VM_TEST(TEST_LT, <, Comparison::LT, R[instruction.b])
+        VM_TEST(TEST_LE, <=, Comparison::LE, R[instruction.b])
+        VM_TEST(TEST_GT, >, Comparison::GT, R[instruction.b])
+        VM_TEST(TEST_GE, >=, Comparison::GE, R[instruction.b])
+        VM_TEST(TEST_EQK, ==, Comparison::EQ, K[instruction.b])
+        VM_TEST(TEST_NEK, !=, Comparison::NE, K[instruction.b])
+        VM_TEST(TEST_LTK, <, Comparison::LT, K[instruction.b])
+        VM_TEST(TEST_LEK, <=, Comparison::LE, K[instruction.b])
+        VM_TEST(TEST_GTK, >, Comparison::GT, K[instruction.b])
+        VM_TEST(TEST_GEK, >=, Comparison::GE, K[instruction.b])
+
+        VM_CASE(TEST): {
+            VM_BRANCH(R[instruction.a].truthy() == static_cast<bool>(instruction.flag));
+            VM_NEXT();
+        }
+        VM_CASE(JUMP): {
+            pc += instruction.immediate();
+            VM_NEXT();
+        }
+        VM_CASE(LOOP): {
+            pc += instruction.immediate();
+            const auto& tier = proto->tier;
+            if (tier && tier->profiling && ++tier->backEdges >= LOOP_THRESHOLD) {
+                requestTierUp(tier, tier->lastShape);
+            }
+            VM_NEXT();
+        }
+
+        VM_CASE(RANGE_PREP): {
+            Value* range = R + instruction.a;
+            for (int i = 0; i < 3; i++) {
+                range[i] = Value::fromInt(rangeBound(range[i]));
+            }
+            if (range[2].asInt() == 0) throw RuntimeError("ValueError: range() arg 3 must not be zero");
+            VM_NEXT();
+        }
+        VM_CASE(RANGE_NEXT): {
+            Value* range = R + instruction.a;
+            int64_t current = range[0].asInt();
+            int64_t stop = range[1].asInt();
+            int64_t step = range[2].asInt();
+            bool more = step > 0 ? current < stop : current > stop;
+            if (more) {
+                R[instruction.b] = Value::fromInt(current);
+                // Stepping past the int64 range ends the loop instead of wrapping
+                bool overflow = step > 0 ? current > std::numeric_limits<int64_t>::max() - step
+                                         : current < std::numeric_limits<int64_t>::min() - step;
+                range[0] = Value::fromInt(overflow ? stop : current + step);
+            }
+            VM_BRANCH(!more);
+            VM_NEXT();
+        }
+        VM_CASE(ITER_PREP): {
+            const Value& iterable = R[instruction.a];
+            if (!iterable.as<ListObject>() && !iterable.as<StringObject>() && !iterable.as<DictObject>()) {
+                throw RuntimeError(std::string("TypeError: '") + typeName(iterable.getType()) +
+                                   "' object is not iterable");
+            }
+            R[instruction.a + 1] = Value::fromInt(0);
+            VM_NEXT();
+        }
+        VM_CASE(FOR_ITER): {
+            Value* iterator = R + instruction.a;
+            auto list = iterator[0].as<ListObject>();
+            bool more;
+            if (list) {
+                auto index = static_cast<size_t>(iterator[1].asInt());
+                more = index < list->size();
+                if (more) {
+                    R[instruction.b] = list->at(index);
+                    iterator[1] = Value::fromInt(static_cast<int64_t>(index + 1));
+                }
+            } else {
+                more = iterate(iterator[0], iterator[1], R[instruction.b]);
+            }
+            VM_BRANCH(!more);
+            VM_NEXT();
+        }
+
+        VM_CASE(CALL): {
+            frames.back().pc = pc;
+            if (callValue(R + instruction.a, instruction.b, &proto->callSites[instruction.c])) {
+                VM_LOAD_FRAME();
+            }
+            VM_NEXT();
+        }
+        VM_CASE(CALL_METHOD): {
+            frames.back().pc = pc;
+            if (callMethod(R + instruction.a, instruction.b, proto->attributes[instruction.c])) {
+                VM_LOAD_FRAME();
+            }
+            VM_NEXT();
+        }
+        VM_CASE(GET_ATTR): {
+            bool bound = false;
+            R[instruction.a] = findAttribute(R[instruction.b], proto->attributes[instruction.c], bound);
+            VM_NEXT();
+        }
+        VM_CASE(GET_INDEX): {
+            const Value& object = R[instruction.b];
+            const Value& index = R[instruction.c];
+            auto list = object.as<ListObject>();
+            if (list && index.isInt() && index.asInt() >= 0 && static_cast<size_t>(index.asInt()) < list->size()) {
+                R[instruction.a] = list->at(static_cast<size_t>(index.asInt()));
+            } else {
+                R[instruction.a] = subscript(object, index);
+            }
+            VM_NEXT();
+        }
+        VM_CASE(BUILD_LIST): {
+            // The elements are temporaries, so they are moved, not copied
+            Value* first = R + instruction.b;
+            std::vector<Value> elements(std::make_move_iterator(first), std::make_move_iterator(first + instruction.c));
+            R[instruction.a] = Value::make<ListObject>(std::move(elements));
+            VM_NEXT();
+        }
+        VM_CASE(BUILD_TUPLE): {
+            Value* first = R + instruction.b;
+            std::vector<Value> elements(std::make_move_iterator(first), std::make_move_iterator(first + instruction.c));
+            Value tuple = Value::make<ListObject>(std::move(elements));
+            tuple.as<ListObject>()->makeTuple();
+            R[instruction.a] = std::move(tuple);
+            VM_NEXT();
+        }
+        VM_CASE(BUILD_DICT): {
+            Value dict = Value::make<DictObject>();
+            Value* pair = R + instruction.b;
+            for (uint16_t i = 0; i < instruction.c; i++, pair += 2) {
+                dict.as<DictObject>()->set(pair[0], std::move(pair[1]));
+            }
+            R[instruction.a] = std::move(dict);
+            VM_NEXT();
+        }
+        VM_CASE(INHERIT): {
+            auto base = R[instruction.b].as<ClassObject>();
+            if (!base) {
+                throw RuntimeError(std::string("TypeError: cannot inherit from '") +
+                                   typeName(R[instruction.b].getType()) + "'");
+            }
+            R[instruction.a].as<ClassObject>()->base = R[instruction.b];
+            VM_NEXT();
+        }
+
+        VM_CASE(AWAIT): {
+            Frame& frame = frames.back();
+            if (!frame.coroutine) throw RuntimeError("SyntaxError: 'await' outside async function");
+            frame.pc = pc;
+            if (runtime.getScheduler().await(*frame.coroutine, R[instruction.b], R[instruction.a])) {
+                VM_NEXT();
+            }
+            // Suspended: the registers wait in the coroutine until the
+            // Scheduler resumes it with the awaited result in R[a]
+            CoroutineObject& coroutine = *frame.coroutine;
+            coroutine.registers.assign(std::make_move_iterator(R), std::make_move_iterator(R + proto->registerCount));
+            coroutine.resumeAt = static_cast<uint32_t>(pc - proto->code.data());
+            coroutine.awaitRegister = instruction.a;
+            coroutine.state = CoroutineObject::State::SUSPENDED;
+            popFrame(false);
+            return Value();
+        }
+
+        VM_CASE(RETURN): {
+            result = std::move(R[instruction.a]);
+            goto doReturn;
+        }
+        VM_CASE(RETURN_NONE): {
+            result = Value();
+            goto doReturn;
+        }
+
+        doReturn: {
+            Frame& finished = frames.back();
+            if (finished.returnsOwner) result = std::move(finished.owner);
+            Value* destination = finished.result;
+            popFrame();
+            if (frames.size() == entry) {
+                return result;
+            }
+            *destination = std::move(result);
+            VM_LOAD_FRAME();
+            VM_NEXT();
+        }
+
+#if PULSE_VM_COMPUTED_GOTO
+        }
+#else
+            }
+        }
+#endif
+    } catch (...) {
+        while (frames.size() > entry) popFrame();
+        throw;
+    }
+
+#undef VM_LOAD_FRAME
+#undef VM_BRANCH
+#undef VM_CASE
+#undef VM_NEXT
+#undef VM_ARITHMETIC
+#undef VM_COMPARE
+#undef VM_TEST
+}
+
+} // namespace pulse::runtime
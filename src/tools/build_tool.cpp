@@ -9,6 +9,15 @@
 #include <algorithm>
 #include <sstream>
 #include <regex>
+#include <optional>
+#include "build/build_graph.hpp"
+#include "driver/frontend.hpp"
+#include "driver/module_interface.hpp"
+#include "driver/rpc.hpp"
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#endif
 
 namespace fs = std::filesystem;
 
@@ -22,6 +31,17 @@ struct BuildTarget {
     bool enabled;
 };
 
+// Code generation settings from the [build] section of pulse.toml
+struct BuildSettings {
+    int opt_level = 2;          // opt_level = 0..3
+    std::string march;          // march = "native" | CPU name
+    bool thin_lto = false;      // lto = "thin"
+    std::string pulse_compiler = "pulse";
+    unsigned jobs = 0;          // -j N; 0 runs one job per hardware thread
+    bool cache = true;          // cache = false (or --no-cache) skips the compile cache
+    std::string cache_remote;   // cache_remote = "http://host:port/prefix"
+};
+
 // Build System for multi-target compilation
 class BuildSystem {
 private:
@@ -29,16 +49,27 @@ private:
     fs::path buildDir;
     std::map<std::string, BuildTarget> targets;
     std::vector<std::string> sourceFiles;
+    BuildSettings settings;
+    std::optional<uint64_t> pulseCompilerIdentity;
+    std::optional<std::string> pulseCompilerVersion;
+    std::optional<uint64_t> dependencyHash;
+    std::unique_ptr<pulse::build::CompileCache> cache; // null with cache = false
     
 public:
-    BuildSystem(const fs::path& project_dir) : projectDir(project_dir) {
+    BuildSystem(const fs::path& project_dir, const BuildSettings& build_settings = BuildSettings())
+        : projectDir(project_dir), settings(build_settings) {
         buildDir = projectDir / "build";
         fs::create_directories(buildDir);
         initializeTargets();
         discoverSourceFiles();
+        if (settings.cache) {
+            cache = std::make_unique<pulse::build::CompileCache>(pulse::build::CompileCache::defaultDirectory(),
+                                                                 settings.cache_remote);
+        }
     }
     
-    void buildTarget(const std::string& target_name) {
+    // Returns false if a step of the build failed
+    bool buildTarget(const std::string& target_name) {
         if (targets.find(target_name) == targets.end()) {
             throw std::runtime_error("Unknown build target: " + target_name);
         }
@@ -46,45 +77,67 @@ public:
         BuildTarget& target = targets[target_name];
         if (!target.enabled) {
             std::cout << "Target " << target_name << " is disabled" << std::endl;
-            return;
-        }
-        
-        std::cout << "Building for target: " << target_name << " (" << target.platform << ")" << std::endl;
-        
-        // Create target-specific build directory
-        fs::path target_build_dir = buildDir / target_name;
-        fs::create_directories(target_build_dir);
-        
-        // Compile source files
-        std::vector<std::string> object_files;
-        
-        for (const auto& source_file : sourceFiles) {
-            std::string object_file = compileSourceFile(source_file, target, target_build_dir);
-            if (!object_file.empty()) {
-                object_files.push_back(object_file);
-            }
+            return true;
         }
-        
-        // Link executable
-        if (!object_files.empty()) {
-            linkExecutable(object_files, target, target_build_dir);
+        if (!checkWithDaemon()) {
+            return false;
         }
         
-        std::cout << "Build completed for target: " << target_name << std::endl;
+        pulse::build::BuildGraph graph;
+        addTargetSteps(graph, target_name, target);
+        return runGraph(graph);
     }
     
-    void buildAllTargets() {
+    // All enabled targets go into one graph, so their compiles and links
+    // share the job pool
+    bool buildAllTargets() {
         std::cout << "Building for all enabled targets..." << std::endl;
+        if (!checkWithDaemon()) {
+            return false;
+        }
         
+        pulse::build::BuildGraph graph;
         for (auto& [name, target] : targets) {
             if (target.enabled) {
-                try {
-                    buildTarget(name);
-                } catch (const std::exception& e) {
-                    std::cerr << "Build failed for target " << name << ": " << e.what() << std::endl;
-                }
+                addTargetSteps(graph, name, target);
             }
         }
+        return runGraph(graph);
+    }
+    
+    // Syntax errors in the sources, printed; returns false if there were any.
+    // A running pulsed has the files parsed already and answers in about a
+    // millisecond; without one they are parsed here.
+    bool check() {
+        bool from_daemon = false;
+        std::vector<pulse::driver::Diagnostic> diagnostics = daemonDiagnostics(from_daemon);
+        if (!from_daemon) {
+            diagnostics = pulse::driver::collectDiagnostics(pulse::driver::parseFiles(sourceFiles, settings.jobs));
+        }
+        for (const auto& diagnostic : diagnostics) {
+            std::cerr << diagnostic << std::endl;
+        }
+        std::cout << sourceFiles.size() << " file(s) checked" << (from_daemon ? " by pulsed" : "") << ", "
+                  << diagnostics.size() << " error(s)" << std::endl;
+        return diagnostics.empty();
+    }
+    
+    // Execute the project in memory through the compiler's JIT: no objects,
+    // no link step. Returns the program's exit status.
+    int run() {
+        std::string run_cmd = settings.pulse_compiler + " run -O" + std::to_string(settings.opt_level);
+        if (!settings.march.empty()) {
+            run_cmd += " -march=" + settings.march;
+        }
+        run_cmd += " " + projectDir.string();
+        
+        int result = system(run_cmd.c_str());
+#ifndef _WIN32
+        if (WIFEXITED(result)) {
+            return WEXITSTATUS(result);
+        }
+#endif
+        return result;
     }
     
     void listTargets() {
@@ -114,6 +167,12 @@ public:
         }
         
         std::cout << "  Build directory: " << buildDir << std::endl;
+        std::cout << "  Compiler: " << settings.pulse_compiler << " -O" << settings.opt_level
+                  << (settings.march.empty() ? "" : " -march=" + settings.march)
+                  << (settings.thin_lto ? " --thin-lto" : "") << std::endl;
+        std::cout << "  Compile cache: "
+                  << (cache ? pulse::build::CompileCache::defaultDirectory().string() : std::string("off"))
+                  << (cache && !settings.cache_remote.empty() ? " + " + settings.cache_remote : "") << std::endl;
     }
     
 private:
@@ -185,62 +244,243 @@ private:
         }
     }
     
-    std::string compileSourceFile(const std::string& source_file, const BuildTarget& target, const fs::path& build_dir) {
-        fs::path source_path(source_file);
-        std::string object_file = (build_dir / source_path.stem()).string() + ".o";
+    void addTargetSteps(pulse::build::BuildGraph& graph, const std::string& target_name, const BuildTarget& target) {
+        std::cout << "Building for target: " << target_name << " (" << target.platform << ")" << std::endl;
         
-        std::string compile_cmd = target.compiler + " -c " + source_file + " -o " + object_file;
+        // Create target-specific build directory
+        fs::path target_build_dir = buildDir / target_name;
+        fs::create_directories(target_build_dir);
         
-        // Add compiler flags
-        for (const auto& flag : target.flags) {
-            compile_cmd += " " + flag;
+        std::vector<size_t> compile_steps;
+        for (const auto& source_file : sourceFiles) {
+            compile_steps.push_back(graph.add(compileStep(source_file, target_name, target, target_build_dir)));
         }
         
-        std::cout << "  Compiling: " << fs::relative(source_path, projectDir) << std::endl;
+        if (!compile_steps.empty()) {
+            graph.add(linkStep(graph, compile_steps, target_name, target, target_build_dir));
+        }
+    }
+    
+    // Ask a running pulsed (see daemonSocketPath) for the diagnostics of
+    // the sources as on disk; from_daemon is false if none answered
+    std::vector<pulse::driver::Diagnostic> daemonDiagnostics(bool& from_daemon) {
+        std::vector<pulse::driver::Diagnostic> diagnostics;
+        from_daemon = false;
+        std::string socket = pulse::driver::daemonSocketPath(projectDir);
+        std::error_code ec;
+        if (!fs::exists(socket, ec)) {
+            return diagnostics;
+        }
+        
+        pulse::driver::Json result;
+        try {
+            auto channel = pulse::driver::RpcChannel::connect(socket);
+            pulse::driver::Json params;
+            params["files"] = pulse::driver::Json::Array();
+            for (const auto& source_file : sourceFiles) {
+                params["files"].push(fs::absolute(source_file).string());
+            }
+            result = channel->call("pulse/check", std::move(params));
+        } catch (const std::exception&) {
+            // A daemon that went away leaves its socket behind
+            return diagnostics;
+        }
+        
+        const pulse::driver::Json& answer = result;
+        for (const auto& item : answer["diagnostics"].items()) {
+            diagnostics.push_back({item["file"].asString(), static_cast<size_t>(item["line"].asInt()),
+                                   static_cast<size_t>(item["column"].asInt()), item["message"].asString()});
+        }
+        from_daemon = true;
+        return diagnostics;
+    }
+    
+    // With a daemon running, a syntax error stops the build before any
+    // compile is started; without one the compiles report it
+    bool checkWithDaemon() {
+        bool from_daemon = false;
+        std::vector<pulse::driver::Diagnostic> diagnostics = daemonDiagnostics(from_daemon);
+        for (const auto& diagnostic : diagnostics) {
+            std::cerr << diagnostic << std::endl;
+        }
+        if (!diagnostics.empty()) {
+            std::cerr << diagnostics.size() << " error(s) reported by pulsed; nothing was built" << std::endl;
+        }
+        return diagnostics.empty();
+    }
+    
+    bool runGraph(pulse::build::BuildGraph& graph) {
+        pulse::build::BuildDatabase database(buildDir / ".pulse_build_db");
+        pulse::build::BuildSummary summary = graph.run(database, settings.jobs, cache.get());
+        
+        std::cout << (summary.ok() ? "Build completed: " : "Build failed: ") << summary.built << " built";
+        if (summary.cached > 0) std::cout << " (" << summary.cached << " from cache)";
+        std::cout << ", " << summary.upToDate << " up to date";
+        if (summary.failed > 0) std::cout << ", " << summary.failed << " failed";
+        if (summary.skipped > 0) std::cout << ", " << summary.skipped << " skipped";
+        std::cout << " (" << static_cast<long>(summary.seconds * 1000) << " ms)" << std::endl;
+        return summary.ok();
+    }
+    
+    pulse::build::BuildStep compileStep(const std::string& source_file, const std::string& target_name,
+                                        const BuildTarget& target, const fs::path& build_dir) {
+        fs::path source_path(source_file);
+        std::string object_extension = settings.thin_lto ? ".bc" : (target.platform == "windows" ? ".obj" : ".o");
+        std::string object_file = (build_dir / source_path.stem()).string() + object_extension;
+        
+        // Pulse sources go through the Pulse compiler; target.flags are for the
+        // C++ toolchain and do not affect generated code
+        std::string codegen_flags = " -O" + std::to_string(settings.opt_level);
+        if (!settings.march.empty()) {
+            codegen_flags += " -march=" + settings.march;
+        }
+        if (settings.thin_lto) {
+            codegen_flags += " --thin-lto";
+        }
         
-        // Execute compilation command
-        int result = system(compile_cmd.c_str());
-        if (result != 0) {
-            std::cerr << "  Compilation failed for: " << source_file << std::endl;
-            return "";
+        // Only main.pul defines the program entry point
+        if (source_path.stem() != "main") {
+            codegen_flags += " --entry __pulse_init_" + source_path.stem().string();
         }
+        std::string compile_cmd = settings.pulse_compiler + codegen_flags + " " + source_file + " -o " + object_file;
+        
+        // Every flag is part of the command, and the object path makes it per target
+        // Constants of imported modules are compiled in, so their sources count too
+        std::vector<fs::path> imports = pulse::driver::importedSources(source_path);
+        pulse::build::Hasher signature;
+        signature.addFile(source_path).add(compile_cmd).add(compilerIdentity());
+        for (const auto& import : imports) {
+            signature.addFile(import);
+        }
+        
+        std::string label = "Compiling " + fs::relative(source_path, projectDir).string() + " (" + target_name + ")";
+        pulse::build::BuildStep step{label, compile_cmd, object_file, signature.digest(), {}};
         
-        return object_file;
+        // The cache key leaves out every path, so other checkouts and
+        // machines building the same source share the object
+        if (cache) {
+            pulse::build::Hasher key;
+            key.add("pulse object").addFile(source_path).add(codegen_flags).add(target.compiler);
+            for (const auto& flag : target.flags) {
+                key.add(flag);
+            }
+            key.add(compilerVersion()).add(dependencies());
+            for (const auto& import : imports) {
+                key.addFile(import);
+            }
+            step.cacheKey = key.digest();
+        }
+        return step;
     }
     
-    void linkExecutable(const std::vector<std::string>& object_files, const BuildTarget& target, const fs::path& build_dir) {
+    pulse::build::BuildStep linkStep(const pulse::build::BuildGraph& graph, const std::vector<size_t>& compile_steps,
+                                     const std::string& target_name, const BuildTarget& target,
+                                     const fs::path& build_dir) {
         std::string output_file = (build_dir / target.output_name).string();
         
         std::string link_cmd = target.compiler;
         
         // Add object files
-        for (const auto& obj_file : object_files) {
-            link_cmd += " " + obj_file;
+        for (size_t step : compile_steps) {
+            link_cmd += " " + graph.step(step).output;
         }
         
         // Add output file
         link_cmd += " -o " + output_file;
         
+        // ThinLTO bitcode needs an LTO-capable linker driver (clang with lld or gold)
+        if (settings.thin_lto) {
+            link_cmd += " -flto=thin";
+        }
+        
         // Add platform-specific flags
         if (target.platform == "windows") {
             link_cmd += " -static-libgcc -static-libstdc++";
+        } else {
+            link_cmd += " -lm";
         }
         
-        std::cout << "  Linking: " << target.output_name << std::endl;
+        pulse::build::Hasher signature;
+        signature.add(link_cmd).add(pulse::build::toolIdentity(target.compiler));
         
-        // Execute linking command
-        int result = system(link_cmd.c_str());
-        if (result != 0) {
-            std::cerr << "  Linking failed for target: " << target.name << std::endl;
-        } else {
-            std::cout << "  Successfully built: " << output_file << std::endl;
+        return {"Linking " + target_name + "/" + target.output_name, link_cmd, output_file, signature.digest(),
+                compile_steps};
+    }
+    
+    // Includes the LLVM version and host CPU, which `-march=native` depends on
+    const std::string& compilerVersion() {
+        if (!pulseCompilerVersion) {
+            pulseCompilerVersion = cache->toolVersion(settings.pulse_compiler);
         }
+        return *pulseCompilerVersion;
+    }
+    
+    uint64_t dependencies() {
+        if (!dependencyHash) {
+            const char* home = std::getenv("HOME");
+            dependencyHash = pulse::build::hashDependencies(projectDir / "pulse.toml",
+                                                            fs::path(home ? home : ".") / ".pulse");
+        }
+        return *dependencyHash;
+    }
+    
+    uint64_t compilerIdentity() {
+        if (!pulseCompilerIdentity) {
+            pulseCompilerIdentity = pulse::build::toolIdentity(settings.pulse_compiler);
+        }
+        return *pulseCompilerIdentity;
     }
 };
 
 // Configuration parser for pulse.toml
 class ConfigParser {
 public:
+    static BuildSettings parseBuildSettings(const fs::path& config_file) {
+        BuildSettings settings;
+        
+        if (!fs::exists(config_file)) {
+            return settings;
+        }
+        
+        std::ifstream file(config_file);
+        std::string line;
+        std::string section;
+        
+        while (std::getline(file, line)) {
+            line = trim(line);
+            if (line.empty() || line[0] == '#') continue;
+            
+            if (line[0] == '[') {
+                section = trim(line.substr(1, line.find(']') - 1));
+                continue;
+            }
+            if (section != "build") continue;
+            
+            size_t eq_pos = line.find('=');
+            if (eq_pos == std::string::npos) continue;
+            
+            std::string key = trim(line.substr(0, eq_pos));
+            std::string value = unquote(trim(line.substr(eq_pos + 1)));
+            
+            if (key == "opt_level") {
+                if (value.size() != 1 || value[0] < '0' || value[0] > '3') {
+                    throw std::runtime_error("pulse.toml: opt_level must be 0, 1, 2 or 3");
+                }
+                settings.opt_level = value[0] - '0';
+            } else if (key == "march") {
+                settings.march = value;
+            } else if (key == "lto") {
+                settings.thin_lto = value == "thin";
+            } else if (key == "cache") {
+                settings.cache = value != "false" && value != "off";
+            } else if (key == "cache_remote") {
+                settings.cache_remote = value;
+            }
+        }
+        
+        return settings;
+    }
+    
     static std::vector<std::string> parseBuildTargets(const fs::path& config_file) {
         std::vector<std::string> targets;
         
@@ -277,6 +517,21 @@ private:
         return str.substr(start, end - start + 1);
     }
     
+    static std::string unquote(const std::string& str) {
+        // Strip a trailing comment, then surrounding quotes
+        std::string value = str;
+        if (value.empty() || value[0] != '"') {
+            value = trim(value.substr(0, value.find('#')));
+        }
+        if (value.length() >= 2 && value[0] == '"') {
+            size_t close = value.find('"', 1);
+            if (close != std::string::npos) {
+                return value.substr(1, close - 1);
+            }
+        }
+        return value;
+    }
+    
     static void parseTargetsArray(const std::string& str, std::vector<std::string>& targets) {
         std::istringstream iss(str);
         std::string target;
@@ -294,38 +549,106 @@ private:
     }
 };
 
+// PULSE_COMPILER overrides; otherwise prefer the pulse next to this pulbuild
+std::string findPulseCompiler(const char* argv0) {
+    if (const char* env = std::getenv("PULSE_COMPILER")) {
+        return env;
+    }
+    
+    std::error_code ec;
+    fs::path self = fs::canonical(fs::path(argv0), ec);
+    if (!ec) {
+#ifdef _WIN32
+        fs::path sibling = self.parent_path() / "pulse.exe";
+#else
+        fs::path sibling = self.parent_path() / "pulse";
+#endif
+        if (fs::exists(sibling)) {
+            return sibling.string();
+        }
+    }
+    
+    return "pulse";
+}
+
+unsigned parseJobs(const std::string& text) {
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos || std::stoul(text) == 0) {
+        throw std::runtime_error("-j needs a positive job count, got '" + text + "'");
+    }
+    return static_cast<unsigned>(std::stoul(text));
+}
+
 int main(int argc, char* argv[]) {
     try {
         if (argc < 2) {
             std::cout << "Pulse Build Tool (pulbuild)" << std::endl;
-            std::cout << "Usage: pulbuild <command> [target]" << std::endl;
+            std::cout << "Usage: pulbuild <command> [target] [-j N]" << std::endl;
             std::cout << std::endl;
             std::cout << "Commands:" << std::endl;
             std::cout << "  build [target]  Build project for target(s)" << std::endl;
+            std::cout << "  check           Report syntax errors (through pulsed if it is running)" << std::endl;
+            std::cout << "  run             Run the project through the JIT (no build)" << std::endl;
             std::cout << "  clean           Clean build directory" << std::endl;
             std::cout << "  targets         List available build targets" << std::endl;
             std::cout << "  info            Show project information" << std::endl;
             std::cout << std::endl;
+            std::cout << "Options:" << std::endl;
+            std::cout << "  -j N            Run N compile/link jobs at once (default: one per CPU)" << std::endl;
+            std::cout << "  --no-cache      Do not use the compile cache (~/.pulse/cache)" << std::endl;
+            std::cout << std::endl;
             std::cout << "Examples:" << std::endl;
             std::cout << "  pulbuild build          # Build for all targets" << std::endl;
             std::cout << "  pulbuild build win      # Build for Windows" << std::endl;
             std::cout << "  pulbuild build linux    # Build for Linux" << std::endl;
+            std::cout << "  pulbuild build -j 8     # Build with 8 parallel jobs" << std::endl;
             std::cout << "  pulbuild clean          # Clean build artifacts" << std::endl;
+            std::cout << std::endl;
+            std::cout << "With pulsed --project . running, build and check ask it for syntax" << std::endl;
+            std::cout << "errors first: it keeps the sources parsed between runs." << std::endl;
             return 0;
         }
         
         std::string command = argv[1];
-        std::string target = (argc > 2) ? argv[2] : "";
+        std::string target;
+        unsigned jobs = 0;
+        bool use_cache = true;
+        for (int i = 2; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "-j" || arg == "--jobs") {
+                if (i + 1 >= argc) {
+                    throw std::runtime_error(arg + " needs a job count");
+                }
+                jobs = parseJobs(argv[++i]);
+            } else if (arg.rfind("-j", 0) == 0) {
+                jobs = parseJobs(arg.substr(2));
+            } else if (arg == "--no-cache") {
+                use_cache = false;
+            } else if (target.empty()) {
+                target = arg;
+            } else {
+                throw std::runtime_error("Unexpected argument: " + arg);
+            }
+        }
         
         // Initialize build system
-        BuildSystem buildSystem(fs::current_path());
+        BuildSettings settings = ConfigParser::parseBuildSettings(fs::current_path() / "pulse.toml");
+        settings.pulse_compiler = findPulseCompiler(argv[0]);
+        settings.jobs = jobs;
+        settings.cache = settings.cache && use_cache;
+        if (settings.cache_remote.empty()) {
+            if (const char* remote = std::getenv("PULSE_CACHE_REMOTE")) {
+                settings.cache_remote = remote;
+            }
+        }
+        BuildSystem buildSystem(fs::current_path(), settings);
         
         if (command == "build") {
-            if (target.empty()) {
-                buildSystem.buildAllTargets();
-            } else {
-                buildSystem.buildTarget(target);
-            }
+            bool ok = target.empty() ? buildSystem.buildAllTargets() : buildSystem.buildTarget(target);
+            return ok ? 0 : 1;
+        } else if (command == "check") {
+            return buildSystem.check() ? 0 : 1;
+        } else if (command == "run") {
+            return buildSystem.run();
         } else if (command == "clean") {
             buildSystem.clean();
         } else if (command == "targets") {
@@ -5,13 +5,31 @@
 #include <sstream>
 #include <algorithm>
 #include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include "build/build_database.hpp"
+#include "build/build_graph.hpp"
+#include "driver/formatter.hpp"
+#include "driver/frontend.hpp"
+#include "driver/thread_pool.hpp"
+#include "lexer/source_buffer.hpp"
+#include "lexer/tokenizer.hpp"
 
+namespace fs = std::filesystem;
+using pulse::driver::LineRanges;
+using pulse::driver::TokenFormatter;
+
+// Line-based formatter of earlier versions (--heuristic): string heuristics
+// per line, with no knowledge of the syntax
 class PulseFormatter {
 public:
     PulseFormatter() : indentSize(4), maxLineLength(80) {}
     
-    void setIndentSize(int size) { indentSize = size; }
-    void setMaxLineLength(int length) { maxLineLength = length; }
+    void setIndentSize(size_t size) { indentSize = size; }
+    void setMaxLineLength(size_t length) { maxLineLength = length; }
     
     std::string format(const std::string& input) {
         std::vector<std::string> lines = splitLines(input);
@@ -74,8 +92,8 @@ public:
     }
     
 private:
-    int indentSize;
-    int maxLineLength;
+    size_t indentSize;
+    size_t maxLineLength;
     
     std::vector<std::string> splitLines(const std::string& input) {
         std::vector<std::string> lines;
@@ -197,19 +215,217 @@ private:
     }
 };
 
+struct FormatOptions {
+    bool heuristic = false;
+    bool check = false;
+    bool changed = false;
+    std::string revision = "HEAD";
+    bool cache = true;
+    size_t jobs = 0;
+    int indentSize = 4;
+    int maxLineLength = 80;
+};
+
+// Hashes of files known to be formatted, as empty files named after them
+// under $PULSE_FORMAT_CACHE or ~/.pulse/cache/format. Many runs may share it.
+class FormatCache {
+public:
+    explicit FormatCache(const FormatOptions& options) {
+        // The output depends on the formatter and its settings
+        settings.add(std::string_view("pulfmt 2"));
+        settings.add(static_cast<uint64_t>(options.heuristic));
+        settings.add(static_cast<uint64_t>(options.indentSize));
+        settings.add(static_cast<uint64_t>(options.maxLineLength));
+        if (const char* dir = std::getenv("PULSE_FORMAT_CACHE")) {
+            directory = dir;
+        } else {
+            const char* home = std::getenv("HOME");
+            directory = fs::path(home ? home : ".") / ".pulse" / "cache" / "format";
+        }
+    }
+
+    uint64_t key(std::string_view content) const {
+        pulse::build::Hasher hasher = settings;
+        return hasher.add(content).digest();
+    }
+
+    bool contains(uint64_t key) const {
+        std::error_code error;
+        return fs::exists(entry(key), error);
+    }
+
+    // Best effort: a cache that cannot be written only costs time
+    void add(uint64_t key) const {
+        std::error_code error;
+        fs::path path = entry(key);
+        fs::create_directories(path.parent_path(), error);
+        std::ofstream(path, std::ios::binary);
+    }
+
+private:
+    pulse::build::Hasher settings;
+    fs::path directory;
+
+    fs::path entry(uint64_t key) const {
+        std::string name = pulse::build::toHex(key);
+        return directory / name.substr(0, 2) / name;
+    }
+};
+
+std::string quote(const std::string& text) {
+    std::string quoted = "'";
+    for (char c : text) {
+        if (c == '\'') quoted += "'\\''";
+        else quoted += c;
+    }
+    return quoted + "'";
+}
+
+// --changed: the lines of each .pul file that git diff reports as changed
+// since revision, by path relative to the working directory. Deleted lines
+// mark the line after them. Untracked files are not in the diff.
+std::map<std::string, LineRanges> changedLines(const std::string& revision, const std::vector<std::string>& paths) {
+    std::string command = "git diff -U0 --no-color --no-ext-diff --no-prefix --relative ";
+    command += quote(revision);
+    command += " --";
+    if (paths.empty()) {
+        command += " '*.pul'";
+    }
+    for (const auto& path : paths) {
+        command += ' ';
+        command += quote(path);
+    }
+    std::string output;
+    if (pulse::build::runCommand(command, output) != 0) {
+        throw std::runtime_error("git diff failed:\n" + output);
+    }
+
+    std::map<std::string, LineRanges> changes;
+    LineRanges* current = nullptr;
+    std::istringstream lines(output);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.rfind("+++ ", 0) == 0) {
+            std::string path = line.substr(4);
+            current = path == "/dev/null" ? nullptr : &changes[fs::path(path).lexically_normal().string()];
+        } else if (line.rfind("@@ ", 0) == 0 && current) {
+            // @@ -a,b +start,count @@
+            size_t plus = line.find(" +");
+            if (plus == std::string::npos) continue;
+            unsigned long start = std::strtoul(line.c_str() + plus + 2, nullptr, 10);
+            unsigned long count = 1;
+            size_t comma = line.find(',', plus);
+            size_t space = line.find(' ', plus + 2);
+            if (comma != std::string::npos && comma < space) {
+                count = std::strtoul(line.c_str() + comma + 1, nullptr, 10);
+            }
+            uint32_t first = static_cast<uint32_t>(std::max(1ul, count == 0 ? start + 1 : start));
+            uint32_t last = static_cast<uint32_t>(count == 0 ? first : start + count - 1);
+            current->emplace_back(first, last);
+        }
+    }
+    return changes;
+}
+
+enum class Outcome { UNCHANGED, CACHED, REFORMATTED, FAILED };
+
+struct FileResult {
+    Outcome outcome = Outcome::UNCHANGED;
+    std::string message;
+};
+
+// Through a temporary next to the file, so that an interrupted run never
+// leaves it half written; the file keeps its permissions
+void writeFile(const fs::path& path, const std::string& content) {
+    fs::path temporary = path;
+    temporary += ".pulfmt.tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary);
+        out << content;
+        if (!out.flush()) {
+            throw std::runtime_error("cannot write " + temporary.string());
+        }
+    }
+    std::error_code error;
+    fs::permissions(temporary, fs::status(path).permissions(), error);
+    fs::rename(temporary, path);
+}
+
+FileResult formatFile(const std::string& path, const FormatOptions& options, const FormatCache* cache,
+                      const LineRanges* ranges) {
+    FileResult result;
+    try {
+        auto source = pulse::lexer::SourceBuffer::fromFile(path);
+        std::string_view content = source->text();
+        uint64_t key = cache ? cache->key(content) : 0;
+        if (cache && cache->contains(key)) {
+            result.outcome = Outcome::CACHED;
+            return result;
+        }
+
+        std::string formatted;
+        if (options.heuristic) {
+            PulseFormatter formatter;
+            formatter.setIndentSize(static_cast<size_t>(options.indentSize));
+            formatter.setMaxLineLength(static_cast<size_t>(options.maxLineLength));
+            formatted = formatter.format(std::string(content));
+        } else {
+            TokenFormatter formatter;
+            formatted = formatter.format(source, ranges);
+        }
+
+        if (formatted == content) {
+            // Only a whole file is known to be formatted
+            if (cache && !ranges) cache->add(key);
+            return result;
+        }
+        result.outcome = Outcome::REFORMATTED;
+        if (options.check) {
+            result.message = "Would reformat: " + path;
+            return result;
+        }
+        source.reset();
+        writeFile(path, formatted);
+        if (cache && !ranges) cache->add(cache->key(formatted));
+        result.message = "Formatted: " + path;
+    } catch (const pulse::lexer::LexError& e) {
+        result.outcome = Outcome::FAILED;
+        result.message = path + ":" + std::to_string(e.line) + ":" + std::to_string(e.column) + ": error: " + e.message;
+    } catch (const std::exception& e) {
+        result.outcome = Outcome::FAILED;
+        result.message = path + ": error: " + e.what();
+    }
+    return result;
+}
+
 void showHelp() {
     std::cout << "Pulse Code Formatter (pulfmt)" << std::endl;
-    std::cout << "Usage: pulfmt [options] <file>" << std::endl;
+    std::cout << "Usage: pulfmt [options] <file | directory ...>" << std::endl;
+    std::cout << "       pulfmt --changed[=REV] [options] [file | directory ...]" << std::endl;
     std::cout << std::endl;
     std::cout << "Options:" << std::endl;
-    std::cout << "  -i, --indent <size>     Set indentation size (default: 4)" << std::endl;
-    std::cout << "  -l, --line-length <len> Set maximum line length (default: 80)" << std::endl;
+    std::cout << "  --check                 Report files that need formatting; change nothing" << std::endl;
+    std::cout << "  --changed[=REV]         Only the lines git diff reports as changed since REV" << std::endl;
+    std::cout << "                          (default: HEAD); without files, every changed .pul file" << std::endl;
+    std::cout << "  -j, --jobs <n>          Format n files at once (default: all cores)" << std::endl;
+    std::cout << "  --no-cache              Do not skip files recorded as formatted" << std::endl;
+    std::cout << "  --heuristic             The line-based formatter of earlier versions" << std::endl;
+    std::cout << "  -i, --indent <size>     --heuristic: indentation size (default: 4)" << std::endl;
+    std::cout << "  -l, --line-length <len> --heuristic: maximum line length (default: 80)" << std::endl;
     std::cout << "  -h, --help              Show this help message" << std::endl;
     std::cout << std::endl;
+    std::cout << "Files are formatted from their tokens: four spaces per block, canonical" << std::endl;
+    std::cout << "spacing, comments and line breaks inside brackets kept. The hashes of" << std::endl;
+    std::cout << "formatted files are kept in ~/.pulse/cache/format ($PULSE_FORMAT_CACHE), so" << std::endl;
+    std::cout << "unchanged files are skipped on the next run. --changed keeps the" << std::endl;
+    std::cout << "indentation of the lines it formats. --check exits with status 1 when a" << std::endl;
+    std::cout << "file needs formatting." << std::endl;
+    std::cout << std::endl;
     std::cout << "Examples:" << std::endl;
-    std::cout << "  pulfmt input.pul                    # Format input.pul" << std::endl;
-    std::cout << "  pulfmt -i 2 input.pul              # Use 2-space indentation" << std::endl;
-    std::cout << "  pulfmt -l 100 input.pul            # Set max line length to 100" << std::endl;
+    std::cout << "  pulfmt input.pul                   # Format input.pul" << std::endl;
+    std::cout << "  pulfmt src                         # Format every .pul file under src" << std::endl;
+    std::cout << "  pulfmt --changed                   # Pre-commit: the lines changed since HEAD" << std::endl;
+    std::cout << "  pulfmt --check -j 8 .              # CI: fail if anything is unformatted" << std::endl;
 }
 
 int main(int argc, char* argv[]) {
@@ -218,9 +434,8 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    std::string inputFile;
-    int indentSize = 4;
-    int maxLineLength = 80;
+    FormatOptions options;
+    std::vector<std::string> inputs;
     
     // Parse command line arguments
     for (int i = 1; i < argc; ++i) {
@@ -231,20 +446,40 @@ int main(int argc, char* argv[]) {
             return 0;
         } else if (arg == "-i" || arg == "--indent") {
             if (i + 1 < argc) {
-                indentSize = std::stoi(argv[++i]);
+                options.indentSize = std::stoi(argv[++i]);
             } else {
                 std::cerr << "Error: Indent size not specified" << std::endl;
                 return 1;
             }
         } else if (arg == "-l" || arg == "--line-length") {
             if (i + 1 < argc) {
-                maxLineLength = std::stoi(argv[++i]);
+                options.maxLineLength = std::stoi(argv[++i]);
             } else {
                 std::cerr << "Error: Line length not specified" << std::endl;
                 return 1;
             }
+        } else if (arg == "-j" || arg == "--jobs") {
+            if (i + 1 < argc) {
+                options.jobs = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+            } else {
+                std::cerr << "Error: Number of jobs not specified" << std::endl;
+                return 1;
+            }
+        } else if (arg.rfind("-j", 0) == 0 && arg.size() > 2) {
+            options.jobs = static_cast<size_t>(std::max(1, std::atoi(arg.c_str() + 2)));
+        } else if (arg == "--check") {
+            options.check = true;
+        } else if (arg == "--changed") {
+            options.changed = true;
+        } else if (arg.rfind("--changed=", 0) == 0) {
+            options.changed = true;
+            options.revision = arg.substr(10);
+        } else if (arg == "--no-cache") {
+            options.cache = false;
+        } else if (arg == "--heuristic") {
+            options.heuristic = true;
         } else if (arg[0] != '-') {
-            inputFile = arg;
+            inputs.push_back(arg);
         } else {
             std::cerr << "Unknown option: " << arg << std::endl;
             showHelp();
@@ -252,42 +487,86 @@ int main(int argc, char* argv[]) {
         }
     }
     
-    if (inputFile.empty()) {
+    if (!options.heuristic && (options.indentSize != 4 || options.maxLineLength != 80)) {
+        std::cerr << "Error: blocks are indented by 4 spaces and lines are not broken; "
+                  << "-i and -l apply to --heuristic" << std::endl;
+        return 1;
+    }
+    if (options.heuristic && options.changed) {
+        std::cerr << "Error: --changed needs the token formatter; drop --heuristic" << std::endl;
+        return 1;
+    }
+    if (inputs.empty() && !options.changed) {
         std::cerr << "Error: No input file specified" << std::endl;
         showHelp();
         return 1;
     }
     
     try {
-        // Read input file
-        std::ifstream file(inputFile);
-        if (!file.is_open()) {
-            std::cerr << "Error: Could not open file: " << inputFile << std::endl;
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::string> files = pulse::driver::collectSources(inputs);
+        std::map<std::string, LineRanges> changes;
+        if (options.changed) {
+            changes = changedLines(options.revision, inputs);
+            // Only what changed, whether the files were named or found in the diff
+            std::vector<std::string> changedFiles;
+            for (const auto& file : inputs.empty() ? std::vector<std::string>() : files) {
+                if (changes.count(fs::path(file).lexically_normal().string())) changedFiles.push_back(file);
+            }
+            if (inputs.empty()) {
+                for (const auto& [file, ranges] : changes) {
+                    if (fs::exists(file)) changedFiles.push_back(file);
+                }
+            }
+            files = std::move(changedFiles);
+        }
+
+        std::unique_ptr<FormatCache> cache;
+        if (options.cache) cache = std::make_unique<FormatCache>(options);
+
+        std::vector<FileResult> results(files.size());
+        auto run = [&](size_t i) {
+            const LineRanges* ranges = nullptr;
+            if (options.changed) ranges = &changes.at(fs::path(files[i]).lexically_normal().string());
+            results[i] = formatFile(files[i], options, cache.get(), ranges);
+        };
+        size_t jobs = std::min(options.jobs == 0 ? pulse::driver::ThreadPool::defaultThreadCount() : options.jobs,
+                               files.size());
+        if (jobs <= 1) {
+            for (size_t i = 0; i < files.size(); i++) run(i);
+        } else {
+            pulse::driver::ThreadPool pool(jobs);
+            for (size_t i = 0; i < files.size(); i++) pool.submit([&run, i] { run(i); });
+            pool.wait();
+        }
+
+        // In input order, whichever thread finished first
+        size_t reformatted = 0, cached = 0, failed = 0;
+        for (const auto& result : results) {
+            if (result.outcome == Outcome::FAILED) {
+                std::cerr << result.message << std::endl;
+                failed++;
+                continue;
+            }
+            if (!result.message.empty()) std::cout << result.message << std::endl;
+            if (result.outcome == Outcome::REFORMATTED) reformatted++;
+            if (result.outcome == Outcome::CACHED) cached++;
+        }
+        if (files.size() > 1) {
+            auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+            std::cout << (options.check ? "Checked " : "Formatted ") << files.size() << " files: " << reformatted
+                      << (options.check ? " need formatting" : " changed") << ", " << cached << " cached";
+            if (failed > 0) std::cout << ", " << failed << " failed";
+            std::cout << " (" << elapsed.count() << " ms, " << jobs << " thread(s))" << std::endl;
+        }
+        if (failed > 0 || (options.check && reformatted > 0)) {
             return 1;
         }
         
-        std::string content((std::istreambuf_iterator<char>(file)),
-                           std::istreambuf_iterator<char>());
-        file.close();
-        
-        // Format the content
-        PulseFormatter formatter;
-        formatter.setIndentSize(indentSize);
-        formatter.setMaxLineLength(maxLineLength);
-        
-        std::string formatted = formatter.format(content);
-        
-        // Write output
-        std::ofstream outFile(inputFile);
-        outFile << formatted;
-        outFile.close();
-        
-        std::cout << "Formatted: " << inputFile << std::endl;
-        
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
     }
     
     return 0;
-} 
\ No newline at end of file
+}
@@ -15,25 +15,21 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <deque>
+#include <functional>
 #include <future>
-
-#ifdef _WIN32
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#pragma comment(lib, "ws2_32.lib")
-#else
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <netdb.h>
-#include <unistd.h>
-#include <fcntl.h>
-#endif
+#include <iomanip>
+#include <optional>
+#include "build/build_graph.hpp"
+#include "build/package_store.hpp"
+#include "build/sha256.hpp"
+#include "driver/report_format.hpp"
+#include "net/http_client.hpp"
 
 namespace fs = std::filesystem;
+using pulse::net::HTTPClient;
 
 // Forward declarations
-class HTTPClient;
 class ManifestParser;
 class BuildSystem;
 
@@ -44,6 +40,7 @@ struct Package {
     std::string description;
     std::string source_url;
     std::vector<std::string> dependencies;
+    std::map<std::string, std::string> dependency_specs; // name -> URL or version
     std::map<std::string, std::string> targets;
     std::vector<std::string> source_files;
     std::string manifest_path;
@@ -67,150 +64,21 @@ struct BuildTarget {
     bool enabled;
 };
 
-// HTTP Client for fetching libraries
-class HTTPClient {
-private:
-    int sockfd;
-    bool initialized;
-    
-public:
-    HTTPClient() : sockfd(-1), initialized(false) {
-#ifdef _WIN32
-        WSADATA wsaData;
-        initialized = WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
-#endif
-    }
-    
-    ~HTTPClient() {
-        if (sockfd != -1) {
-#ifdef _WIN32
-            closesocket(sockfd);
-        }
-        if (initialized) {
-            WSACleanup();
-        }
-#else
-            close(sockfd);
-        }
-#endif
-    }
-    
-    std::string fetchURL(const std::string& url) {
-        try {
-            // Parse URL
-            auto [host, path] = parseURL(url);
-            if (host.empty()) {
-                throw std::runtime_error("Invalid URL format");
-            }
-            
-            // Create socket
-            sockfd = socket(AF_INET, SOCK_STREAM, 0);
-            if (sockfd == -1) {
-                throw std::runtime_error("Failed to create socket");
-            }
-            
-            // Resolve hostname
-            struct hostent* server = gethostbyname(host.c_str());
-            if (server == nullptr) {
-                throw std::runtime_error("Failed to resolve hostname: " + host);
-            }
-            
-            // Setup connection
-            struct sockaddr_in server_addr;
-            memset(&server_addr, 0, sizeof(server_addr));
-            server_addr.sin_family = AF_INET;
-            server_addr.sin_port = htons(80);
-            memcpy(&server_addr.sin_addr.s_addr, server->h_addr, server->h_length);
-            
-            // Connect
-            if (connect(sockfd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-                throw std::runtime_error("Failed to connect to server");
-            }
-            
-            // Send HTTP request
-            std::string request = "GET " + path + " HTTP/1.1\r\n"
-                                "Host: " + host + "\r\n"
-                                "User-Agent: Pulse-Package-Manager/1.0\r\n"
-                                "Connection: close\r\n\r\n";
-            
-            if (send(sockfd, request.c_str(), request.length(), 0) < 0) {
-                throw std::runtime_error("Failed to send HTTP request");
-            }
-            
-            // Receive response
-            std::string response;
-            char buffer[4096];
-            int bytes_received;
-            
-            while ((bytes_received = recv(sockfd, buffer, sizeof(buffer) - 1, 0)) > 0) {
-                buffer[bytes_received] = '\0';
-                response += buffer;
-            }
-            
-            // Close socket
-#ifdef _WIN32
-            closesocket(sockfd);
-#else
-            close(sockfd);
-#endif
-            sockfd = -1;
-            
-            // Extract body from response
-            size_t body_start = response.find("\r\n\r\n");
-            if (body_start != std::string::npos) {
-                return response.substr(body_start + 4);
-            }
-            
-            return response;
-            
-        } catch (const std::exception& e) {
-            if (sockfd != -1) {
-#ifdef _WIN32
-                closesocket(sockfd);
-#else
-                close(sockfd);
-#endif
-                sockfd = -1;
-            }
-            throw;
-        }
-    }
-    
-    std::vector<std::string> listDirectory(const std::string& url) {
-        std::string response = fetchURL(url);
-        std::vector<std::string> files;
-        
-        // Simple HTML parsing to extract links
-        std::regex link_regex("<a[^>]*href=[\"']([^\"']+)[\"'][^>]*>");
-        std::sregex_iterator iter(response.begin(), response.end(), link_regex);
-        std::sregex_iterator end;
-        
-        for (; iter != end; ++iter) {
-            std::string link = (*iter)[1];
-            if (link.find(".pul") != std::string::npos || 
-                link.find(".toml") != std::string::npos ||
-                link.find(".json") != std::string::npos) {
-                files.push_back(link);
-            }
-        }
-        
-        return files;
-    }
-    
-private:
-    std::pair<std::string, std::string> parseURL(const std::string& url) {
-        std::regex url_regex("https?://([^/]+)(/.*)?");
-        std::smatch match;
-        
-        if (std::regex_match(url, match, url_regex)) {
-            std::string host = match[1].str();
-            std::string path = (match[2].matched && !match[2].str().empty()) ? match[2].str() : "/";
-            return {host, path};
-        }
-        
-        return {"", ""};
-    }
-};
+// Package names become directories under libs/, yet come from downloaded
+// manifests: a name must be a single path component that cannot climb out
+// of libs/ or name a root ("..", "a/b", "C:x", "/etc" are all refused)
+bool isSafePackageName(const std::string& name) {
+    if (name.empty() || name == "." || name.find("..") != std::string::npos) return false;
+    if (name.find_first_of("/\\:") != std::string::npos || name.find('\0') != std::string::npos) return false;
+    fs::path path(name);
+    return !path.is_absolute() && !path.has_root_name() && !path.has_root_directory();
+}
+
+// The same for a file of a package, which may sit in subdirectories of it
+bool isInsidePackage(const std::string& file) {
+    fs::path relative = fs::path(file).lexically_normal();
+    return !relative.empty() && !relative.is_absolute() && !relative.has_root_name() && *relative.begin() != "..";
+}
 
 // Manifest Parser for pulse.toml and pulse.json
 class ManifestParser {
@@ -234,19 +102,42 @@ public:
         return pkg;
     }
     
+    // True if content is a TOML or JSON manifest naming its package
+    static bool isManifest(const std::string& content, const std::string& source_url, Package& pkg) {
+        pkg = Package();
+        pkg.source_url = source_url;
+        if (parseTOML(content, pkg)) {
+            return true;
+        }
+        pkg = Package();
+        pkg.source_url = source_url;
+        return parseJSON(content, pkg);
+    }
+    
+    // The [dependencies] and [libs] of a project's pulse.toml
+    static std::map<std::string, std::string> parseProjectDependencies(const fs::path& config_file) {
+        std::ifstream file(config_file);
+        std::stringstream content;
+        content << file.rdbuf();
+        Package pkg;
+        parseTOML(content.str(), pkg);
+        return pkg.dependency_specs;
+    }
+    
 private:
     static bool parseTOML(const std::string& content, Package& pkg) {
         try {
             // Simple TOML-like parsing
             std::istringstream iss(content);
             std::string line;
+            std::string section;
             
             while (std::getline(iss, line)) {
                 line = trim(line);
                 if (line.empty() || line[0] == '#') continue;
                 
                 if (line[0] == '[') {
-                    // Section header
+                    section = trim(line.substr(1, line.find(']') - 1));
                     continue;
                 }
                 
@@ -260,10 +151,19 @@ private:
                         value = value.substr(1, value.length() - 2);
                     }
                     
-                    if (key == "name") pkg.name = value;
+                    if (section == "dependencies" || section == "libs") {
+                        // [libs] repeats [dependencies] in older manifests
+                        if (!pkg.dependency_specs.count(key)) {
+                            pkg.dependencies.push_back(key);
+                        }
+                        pkg.dependency_specs[key] = value;
+                    } else if (!section.empty() && section != "package" && section != "project") {
+                        continue;
+                    } else if (key == "name") pkg.name = value;
                     else if (key == "version") pkg.version = value;
                     else if (key == "description") pkg.description = value;
                     else if (key == "source_url") pkg.source_url = value;
+                    else if (key == "sources" || key == "files") parseStringArray(value, pkg.source_files);
                 }
             }
             
@@ -323,12 +223,618 @@ private:
         }
     }
     
+    // ["src/a.pul", "src/b.pul"] on one line
+    static void parseStringArray(const std::string& value, std::vector<std::string>& items) {
+        size_t start = value.find('[');
+        size_t end = value.rfind(']');
+        if (start == std::string::npos || end == std::string::npos || end < start) return;
+        std::istringstream iss(value.substr(start + 1, end - start - 1));
+        std::string item;
+        while (std::getline(iss, item, ',')) {
+            item = trim(item);
+            if (item.length() >= 2 && item[0] == '"' && item[item.length()-1] == '"') {
+                item = item.substr(1, item.length() - 2);
+            }
+            if (!item.empty()) items.push_back(item);
+        }
+    }
+    
+    static std::string trim(const std::string& str) {
+        size_t start = str.find_first_not_of(" \t\r\n");
+        if (start == std::string::npos) return "";
+        size_t end = str.find_last_not_of(" \t\r\n");
+        return str.substr(start, end - start + 1);
+    }
+};
+
+// Pool of download threads, each with its own HTTPClient and so its own
+// kept-alive connections; the thread count bounds the connections open at
+// once. Jobs may submit more jobs.
+class FetchPool {
+public:
+    using Job = std::function<void(HTTPClient&)>;
+    
+    explicit FetchPool(unsigned connections) {
+        for (unsigned i = 0; i < std::max(1u, connections); i++) {
+            workers.emplace_back([this] { work(); });
+        }
+    }
+    
+    ~FetchPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+    
+    void submit(Job job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+            pending++;
+        }
+        wake.notify_one();
+    }
+    
+    // Until every submitted job, and every job they submitted, has run
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return pending == 0; });
+    }
+    
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::deque<Job> jobs;
+    size_t pending = 0;
+    bool stopping = false;
+    
+    void work() {
+        HTTPClient client;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) return;
+            Job job = std::move(jobs.front());
+            jobs.pop_front();
+            lock.unlock();
+            job(client); // jobs report their own errors
+            lock.lock();
+            if (--pending == 0) {
+                idle.notify_all();
+            }
+        }
+    }
+};
+
+// One package as pulse.lock pins it
+struct LockedPackage {
+    std::string name;
+    std::string version;
+    std::string url;
+    std::vector<std::string> dependencies; // names of other locked packages
+    std::map<std::string, std::string> files; // path in the package -> PackageStore digest
+    
+    // Of everything above but the name; kept in package.info, so an install
+    // that already matches the lock is recognized without reading its files
+    std::string contentHash() const {
+        pulse::build::Sha256 hash;
+        hash.add(url).add("\n").add(version).add("\n");
+        for (const auto& [file, digest] : files) {
+            hash.add(file).add("\n").add(digest).add("\n");
+        }
+        return hash.hexDigest();
+    }
+    
+    // Names and paths become directories under libs/, digests names in the
+    // store: none may lead anywhere else
+    bool safe() const {
+        if (!isSafePackageName(name)) return false;
+        for (const auto& [file, digest] : files) {
+            if (!isInsidePackage(file) || !pulse::build::Sha256::isDigest(digest)) return false;
+        }
+        return true;
+    }
+};
+
+// pulse.lock, next to pulse.toml: every package an install resolved, with
+// the URL it came from and the SHA-256 of each of its files. specs
+// hashes the dependency entries of pulse.toml it was resolved from; while
+// they are unchanged the lock is installed as is, from the package store.
+class Lockfile {
+public:
+    std::string specs;
+    std::vector<LockedPackage> packages; // dependencies first
+    
+    // Hash of the URL dependencies of a project
+    static std::string hashSpecs(const std::map<std::string, std::string>& urls) {
+        pulse::build::Sha256 hash;
+        for (const auto& [name, url] : urls) {
+            hash.add(name).add("\n").add(url).add("\n");
+        }
+        return hash.hexDigest();
+    }
+    
+    // False if there is no such file, it cannot be parsed, it is of an
+    // older format, or an entry in it is not safe()
+    bool load(const fs::path& file) {
+        std::ifstream in(file);
+        if (!in) return false;
+        packages.clear();
+        std::string line;
+        bool versioned = false;
+        try {
+            while (std::getline(in, line)) {
+                line = trim(line);
+                if (line.empty() || line[0] == '#') continue;
+                if (line[0] == '[') {
+                    packages.emplace_back();
+                    packages.back().name = trim(line.substr(1, line.find(']') - 1));
+                    continue;
+                }
+                size_t eq_pos = line[0] == '"' ? line.find('=', line.find('"', 1)) : line.find('=');
+                if (eq_pos == std::string::npos) return false;
+                std::string key = unquote(trim(line.substr(0, eq_pos)));
+                std::string value = trim(line.substr(eq_pos + 1));
+                if (packages.empty()) {
+                    if (key == "lock") versioned = value == "2";
+                    else if (key == "specs") specs = unquote(value);
+                    continue;
+                }
+                LockedPackage& pkg = packages.back();
+                if (line[0] == '"') pkg.files[key] = unquote(value);
+                else if (key == "url") pkg.url = unquote(value);
+                else if (key == "version") pkg.version = unquote(value);
+                else if (key == "dependencies") parseNames(value, pkg.dependencies);
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+        for (const auto& pkg : packages) {
+            if (!pkg.safe()) return false;
+        }
+        return versioned;
+    }
+    
+    // Written through a temporary and renamed, so it is never half written
+    void save(const fs::path& file) const {
+        fs::path temporary = file;
+        temporary += ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::trunc);
+            out << "# Written by pulpm install; commit it, and edit pulse.toml instead of this file.\n";
+            out << "lock = 2\n";
+            out << "specs = \"" << specs << "\"\n";
+            for (const auto& pkg : packages) {
+                out << "\n[" << pkg.name << "]\n";
+                out << "url = \"" << pkg.url << "\"\n";
+                out << "version = \"" << pkg.version << "\"\n";
+                out << "dependencies = [";
+                for (size_t i = 0; i < pkg.dependencies.size(); i++) {
+                    out << (i ? ", " : "") << "\"" << pkg.dependencies[i] << "\"";
+                }
+                out << "]\n";
+                for (const auto& [path, digest] : pkg.files) {
+                    out << "\"" << path << "\" = \"" << digest << "\"\n";
+                }
+            }
+            if (!out) {
+                throw std::runtime_error("cannot write " + temporary.string());
+            }
+        }
+        fs::rename(temporary, file);
+    }
+    
+private:
     static std::string trim(const std::string& str) {
         size_t start = str.find_first_not_of(" \t\r\n");
         if (start == std::string::npos) return "";
         size_t end = str.find_last_not_of(" \t\r\n");
         return str.substr(start, end - start + 1);
     }
+    
+    static std::string unquote(const std::string& value) {
+        if (value.length() >= 2 && value.front() == '"' && value.back() == '"') {
+            return value.substr(1, value.length() - 2);
+        }
+        return value;
+    }
+    
+    static void parseNames(const std::string& value, std::vector<std::string>& names) {
+        std::istringstream iss(value.substr(value.find('[') + 1, value.rfind(']') - value.find('[') - 1));
+        std::string name;
+        while (std::getline(iss, name, ',')) {
+            name = unquote(trim(name));
+            if (!name.empty()) names.push_back(name);
+        }
+    }
+};
+
+// Installs libraries with everything they depend on into the libs directory.
+// First the manifests: each package's is fetched as soon as the manifest
+// naming it has been read, so the dependency graph is resolved level by
+// level in parallel rather than one round trip at a time. Then the files of
+// all packages are downloaded together. Both phases share a FetchPool.
+// Packages are recorded dependencies first once all their files arrived.
+// Every file goes through the PackageStore and is linked from there.
+class DependencyResolver {
+public:
+    // With reuse_installed, a package already in libs_dir from the same URL
+    // is taken as it is instead of fetched again
+    DependencyResolver(const fs::path& libs_dir, unsigned connections, pulse::build::PackageStore& store,
+                       bool reuse_installed = true)
+        : libsDir(libs_dir), store(store), reuseInstalled(reuse_installed), pool(connections) {}
+    
+    // roots: dependency name -> URL. Returns false if anything failed.
+    bool install(const std::map<std::string, std::string>& roots) {
+        auto start = std::chrono::steady_clock::now();
+        
+        for (const auto& [name, url] : roots) {
+            addNode(name, url);
+        }
+        pool.wait();
+        
+        bool ok = true;
+        for (const auto& node : nodes) {
+            if (node->failed) ok = false;
+        }
+        std::vector<size_t> order;
+        if (!installOrder(order) || !checkNames()) {
+            return false;
+        }
+        
+        downloadFiles();
+        pool.wait();
+        
+        size_t installed = 0;
+        size_t up_to_date = 0;
+        for (size_t index : order) {
+            Node& node = *nodes[index];
+            if (node.failed) {
+                std::cerr << "Failed to install " << node.name << " from " << node.url << std::endl;
+                ok = false;
+            } else if (node.installed) {
+                up_to_date++;
+            } else {
+                writeManifest(node);
+                savePackageInfo(directory(node), node.pkg, locked(node).contentHash());
+                std::cout << "Installed " << node.pkg.name << " v" << node.pkg.version << " to " << directory(node)
+                          << std::endl;
+                installed++;
+            }
+        }
+        
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << installed << " package(s) installed, " << up_to_date << " already up to date; "
+                  << filesDone << " file(s), " << pulse::driver::formatBytes(static_cast<double>(bytesDone)) << " in "
+                  << static_cast<long>(seconds * 1000) << " ms" << std::endl;
+        resolvedOrder = std::move(order);
+        return ok;
+    }
+    
+    // What install() installed, as pulse.lock records it
+    std::vector<LockedPackage> lockedPackages() const {
+        std::vector<LockedPackage> packages;
+        for (size_t index : resolvedOrder) {
+            packages.push_back(locked(*nodes[index]));
+        }
+        return packages;
+    }
+    
+    static std::string extractPackageNameFromURL(const std::string& spec) {
+        std::string url = normalizeURL(spec);
+        size_t last_slash = url.find_last_of('/');
+        if (last_slash != std::string::npos && last_slash < url.length() - 1) {
+            return url.substr(last_slash + 1);
+        }
+        return "unknown";
+    }
+    
+    static void savePackageInfo(const fs::path& package_dir, const Package& pkg, const std::string& content) {
+        fs::path info_file = package_dir / "package.info";
+        std::ofstream out_file(info_file);
+        
+        out_file << "Name: " << pkg.name << std::endl;
+        out_file << "Version: " << pkg.version << std::endl;
+        out_file << "Description: " << pkg.description << std::endl;
+        out_file << "Source URL: " << pkg.source_url << std::endl;
+        out_file << "Last Updated: " << std::chrono::system_clock::to_time_t(pkg.last_updated) << std::endl;
+        out_file << "Content: " << content << std::endl;
+        
+        out_file.close();
+    }
+    
+private:
+    struct Node {
+        std::string name; // as the first dependent names it
+        std::string url;
+        Package pkg;
+        std::string manifest_file; // "pulse.toml" or "pulse.json"; empty if discovered
+        std::string manifest;
+        std::vector<size_t> dependencies;
+        std::map<std::string, std::string> files; // as linked from the store
+        bool installed = false; // already in the libs directory from this URL
+        bool failed = false;
+    };
+    
+    fs::path libsDir;
+    pulse::build::PackageStore& store;
+    bool reuseInstalled;
+    FetchPool pool;
+    std::vector<size_t> resolvedOrder;
+    
+    std::mutex mutex; // nodes, byURL and the counters, and stdout
+    std::vector<std::unique_ptr<Node>> nodes;
+    std::map<std::string, size_t> byURL;
+    size_t filesTotal = 0;
+    size_t filesDone = 0;
+    uint64_t bytesDone = 0;
+    
+    static std::string normalizeURL(std::string url) {
+        while (!url.empty() && url.back() == '/') {
+            url.pop_back();
+        }
+        return url;
+    }
+    
+    fs::path directory(const Node& node) const {
+        return libsDir / node.pkg.name;
+    }
+    
+    size_t addNode(const std::string& name, const std::string& spec) {
+        std::string url = normalizeURL(spec);
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = byURL.find(url);
+        if (it != byURL.end()) return it->second;
+        
+        size_t index = nodes.size();
+        nodes.push_back(std::make_unique<Node>());
+        nodes.back()->name = name;
+        nodes.back()->url = url;
+        byURL[url] = index;
+        pool.submit([this, index](HTTPClient& client) { resolve(client, index); });
+        return index;
+    }
+    
+    // Reads the package's manifest, from an earlier install of the same URL
+    // when there is one, and queues its dependencies
+    void resolve(HTTPClient& client, size_t index) {
+        Node* node;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            node = nodes[index].get();
+        }
+        
+        try {
+            // Checked before the name reaches any path
+            if (!isSafePackageName(node->name)) {
+                throw std::runtime_error("'" + node->name + "' is not a valid package name");
+            }
+            if (!reuseInstalled || !readInstalled(*node)) {
+                fetchManifest(client, *node);
+            }
+            // The manifest's name is the directory it installs into
+            if (node->pkg.name != node->name) {
+                throw std::runtime_error("the manifest names the package '" + node->pkg.name + "', not '" +
+                                         node->name + "'");
+            }
+        } catch (const std::exception& e) {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::cerr << "  " << node->name << ": " << e.what() << std::endl;
+            node->failed = true;
+            return;
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::cout << "  Resolved " << node->pkg.name << " v" << node->pkg.version
+                      << (node->installed ? " (installed)" : "") << std::endl;
+        }
+        
+        for (const auto& [dep_name, spec] : node->pkg.dependency_specs) {
+            if (spec.find("http://") != 0 && spec.find("https://") != 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                std::cerr << "  " << node->pkg.name << ": dependency " << dep_name << " = \"" << spec
+                          << "\" is not a URL; skipped" << std::endl;
+                continue;
+            }
+            size_t dependency = addNode(dep_name, spec);
+            std::lock_guard<std::mutex> lock(mutex);
+            node->dependencies.push_back(dependency);
+        }
+    }
+    
+    bool readInstalled(Node& node) {
+        fs::path dir = libsDir / node.name;
+        std::ifstream info(dir / "package.info");
+        std::string line;
+        std::string version;
+        bool same_source = false;
+        while (std::getline(info, line)) {
+            if (line == "Source URL: " + node.url) same_source = true;
+            if (line.rfind("Version: ", 0) == 0) version = line.substr(9);
+        }
+        if (!same_source) return false;
+        
+        // Its files join the store, for the lock to pin them
+        for (const auto& entry : fs::recursive_directory_iterator(dir)) {
+            if (!entry.is_regular_file() || entry.path() == dir / "package.info") continue;
+            node.files[fs::relative(entry.path(), dir).generic_string()] = store.import(entry.path());
+        }
+        
+        for (const char* manifest_file : {"pulse.toml", "pulse.json"}) {
+            std::ifstream in(dir / manifest_file);
+            if (!in) continue;
+            std::stringstream content;
+            content << in.rdbuf();
+            if (ManifestParser::isManifest(content.str(), node.url, node.pkg)) {
+                node.installed = true;
+                return true;
+            }
+        }
+        // Installed by discovery: no manifest, so no dependencies either
+        node.pkg = Package();
+        node.pkg.name = node.name;
+        node.pkg.version = version;
+        node.pkg.source_url = node.url;
+        node.installed = true;
+        return true;
+    }
+    
+    void fetchManifest(HTTPClient& client, Node& node) {
+        for (const char* manifest_file : {"pulse.toml", "pulse.json"}) {
+            pulse::net::HTTPResponse response = client.get(node.url + "/" + manifest_file);
+            if (response.ok() && ManifestParser::isManifest(response.body, node.url, node.pkg)) {
+                node.manifest_file = manifest_file;
+                node.manifest = std::move(response.body);
+                node.pkg.last_updated = std::chrono::system_clock::now();
+                if (node.pkg.source_files.empty()) {
+                    node.pkg.source_files = client.listDirectory(node.url);
+                }
+                return;
+            }
+        }
+        
+        // No manifest: the listing's files make up the package, named as
+        // its dependent names it
+        node.pkg = Package();
+        node.pkg.name = node.name;
+        node.pkg.version = "1.0.0";
+        node.pkg.description = "Package from " + node.url;
+        node.pkg.source_url = node.url;
+        node.pkg.last_updated = std::chrono::system_clock::now();
+        node.pkg.source_files = client.listDirectory(node.url);
+        if (node.pkg.source_files.empty()) {
+            throw std::runtime_error("no manifest and no source files at " + node.url);
+        }
+    }
+    
+    // Dependencies before dependents; false (after reporting it) on a cycle
+    bool installOrder(std::vector<size_t>& order) {
+        enum class Mark { NONE, VISITING, DONE };
+        std::vector<Mark> marks(nodes.size(), Mark::NONE);
+        std::vector<size_t> path;
+        
+        std::function<bool(size_t)> visit = [&](size_t index) {
+            if (marks[index] == Mark::DONE) return true;
+            if (marks[index] == Mark::VISITING) {
+                std::string cycle;
+                auto from = std::find(path.begin(), path.end(), index);
+                for (auto it = from; it != path.end(); ++it) {
+                    cycle += nodes[*it]->pkg.name + " -> ";
+                }
+                std::cerr << "Circular dependency: " << cycle << nodes[index]->pkg.name << std::endl;
+                return false;
+            }
+            marks[index] = Mark::VISITING;
+            path.push_back(index);
+            for (size_t dependency : nodes[index]->dependencies) {
+                if (!visit(dependency)) return false;
+            }
+            path.pop_back();
+            marks[index] = Mark::DONE;
+            order.push_back(index);
+            return true;
+        };
+        
+        for (size_t i = 0; i < nodes.size(); i++) {
+            if (!visit(i)) return false;
+        }
+        return true;
+    }
+    
+    // Two URLs must not install into the same directory
+    bool checkNames() {
+        std::map<std::string, const Node*> owners;
+        for (const auto& node : nodes) {
+            if (node->failed) continue;
+            auto [it, inserted] = owners.emplace(node->pkg.name, node.get());
+            if (!inserted) {
+                std::cerr << "Package name conflict: " << it->second->url << " and " << node->url << " both provide "
+                          << node->pkg.name << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    void downloadFiles() {
+        for (const auto& node : nodes) {
+            if (node->failed || node->installed) continue;
+            filesTotal += node->pkg.source_files.size();
+        }
+        for (const auto& node : nodes) {
+            if (node->failed || node->installed) continue;
+            // Whatever another URL or version left there goes
+            fs::remove_all(directory(*node));
+            fs::create_directories(directory(*node));
+            for (const auto& file : node->pkg.source_files) {
+                Node* owner = node.get();
+                pool.submit([this, owner, file](HTTPClient& client) { downloadFile(client, *owner, file); });
+            }
+        }
+    }
+    
+    void downloadFile(HTTPClient& client, Node& node, const std::string& file) {
+        fs::path file_path = directory(node) / file;
+        std::string relative_name;
+        uint64_t size = 0;
+        std::string digest;
+        try {
+            // Names come from the server: keep them inside the package
+            if (!isInsidePackage(file)) {
+                throw std::runtime_error("file name outside the package");
+            }
+            relative_name = fs::path(file).lexically_normal().generic_string();
+            fs::path temporary = store.temporaryPath();
+            client.download(node.url + "/" + file, temporary);
+            size = fs::file_size(temporary);
+            digest = store.add(temporary);
+            store.link(digest, file_path);
+        } catch (const std::exception& e) {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::cerr << "  " << node.pkg.name << "/" << file << ": " << e.what() << std::endl;
+            node.failed = true;
+            return;
+        }
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        node.files[relative_name] = digest;
+        filesDone++;
+        bytesDone += size;
+        std::cout << "  [" << filesDone << "/" << filesTotal << "] " << node.pkg.name << "/" << file << " ("
+                  << pulse::driver::formatBytes(static_cast<double>(size)) << ")" << std::endl;
+    }
+    
+    void writeManifest(Node& node) {
+        if (node.manifest_file.empty()) return;
+        fs::path temporary = store.temporaryPath();
+        {
+            std::ofstream out(temporary, std::ios::binary);
+            out << node.manifest;
+        }
+        std::string digest = store.add(temporary);
+        store.link(digest, directory(node) / node.manifest_file);
+        node.files[node.manifest_file] = digest;
+    }
+    
+    LockedPackage locked(const Node& node) const {
+        LockedPackage pkg;
+        pkg.name = node.pkg.name;
+        pkg.version = node.pkg.version;
+        pkg.url = node.url;
+        pkg.files = node.files;
+        for (size_t dependency : node.dependencies) {
+            pkg.dependencies.push_back(nodes[dependency]->pkg.name);
+        }
+        return pkg;
+    }
 };
 
 // Build System for multi-target compilation
@@ -337,15 +843,33 @@ private:
     fs::path projectDir;
     fs::path buildDir;
     std::map<std::string, BuildTarget> targets;
+    unsigned jobs = 0; // 0 runs one job per hardware thread
+    std::map<std::string, uint64_t> compilerIdentities;
+    std::map<std::string, std::string> compilerVersions;
+    std::optional<uint64_t> dependencyHash;
+    std::unique_ptr<pulse::build::CompileCache> cache; // null after disableCache()
     
 public:
     BuildSystem(const fs::path& project_dir) : projectDir(project_dir) {
         buildDir = projectDir / "build";
         fs::create_directories(buildDir);
         initializeTargets();
+        
+        const char* remote = std::getenv("PULSE_CACHE_REMOTE");
+        cache = std::make_unique<pulse::build::CompileCache>(pulse::build::CompileCache::defaultDirectory(),
+                                                             remote ? remote : "");
+    }
+    
+    void setJobs(unsigned job_count) {
+        jobs = job_count;
+    }
+    
+    void disableCache() {
+        cache.reset();
     }
     
-    void buildTarget(const std::string& target_name) {
+    // Returns false if a step of the build failed
+    bool buildTarget(const std::string& target_name) {
         if (targets.find(target_name) == targets.end()) {
             throw std::runtime_error("Unknown build target: " + target_name);
         }
@@ -353,46 +877,27 @@ public:
         BuildTarget& target = targets[target_name];
         if (!target.enabled) {
             std::cout << "Target " << target_name << " is disabled" << std::endl;
-            return;
-        }
-        
-        std::cout << "Building for target: " << target_name << std::endl;
-        
-        // Create target-specific build directory
-        fs::path target_build_dir = buildDir / target_name;
-        fs::create_directories(target_build_dir);
-        
-        // Compile source files
-        std::vector<std::string> source_files = findSourceFiles();
-        std::vector<std::string> object_files;
-        
-        for (const auto& source_file : source_files) {
-            std::string object_file = compileSourceFile(source_file, target, target_build_dir);
-            if (!object_file.empty()) {
-                object_files.push_back(object_file);
-            }
-        }
-        
-        // Link executable
-        if (!object_files.empty()) {
-            linkExecutable(object_files, target, target_build_dir);
+            return true;
         }
         
-        std::cout << "Build completed for target: " << target_name << std::endl;
+        pulse::build::BuildGraph graph;
+        addTargetSteps(graph, target_name, target, findSourceFiles());
+        return runGraph(graph);
     }
     
-    void buildAllTargets() {
+    // All enabled targets go into one graph, so their compiles and links
+    // share the job pool
+    bool buildAllTargets() {
         std::cout << "Building for all enabled targets..." << std::endl;
         
+        std::vector<std::string> source_files = findSourceFiles();
+        pulse::build::BuildGraph graph;
         for (auto& [name, target] : targets) {
             if (target.enabled) {
-                try {
-                    buildTarget(name);
-                } catch (const std::exception& e) {
-                    std::cerr << "Build failed for target " << name << ": " << e.what() << std::endl;
-                }
+                addTargetSteps(graph, name, target, source_files);
             }
         }
+        return runGraph(graph);
     }
     
     void listTargets() {
@@ -445,7 +950,39 @@ private:
         return source_files;
     }
     
-    std::string compileSourceFile(const std::string& source_file, const BuildTarget& target, const fs::path& build_dir) {
+    void addTargetSteps(pulse::build::BuildGraph& graph, const std::string& target_name, const BuildTarget& target,
+                        const std::vector<std::string>& source_files) {
+        std::cout << "Building for target: " << target_name << std::endl;
+        
+        // Create target-specific build directory
+        fs::path target_build_dir = buildDir / target_name;
+        fs::create_directories(target_build_dir);
+        
+        std::vector<size_t> compile_steps;
+        for (const auto& source_file : source_files) {
+            compile_steps.push_back(graph.add(compileStep(source_file, target_name, target, target_build_dir)));
+        }
+        
+        if (!compile_steps.empty()) {
+            graph.add(linkStep(graph, compile_steps, target_name, target, target_build_dir));
+        }
+    }
+    
+    bool runGraph(pulse::build::BuildGraph& graph) {
+        pulse::build::BuildDatabase database(buildDir / ".pulse_build_db");
+        pulse::build::BuildSummary summary = graph.run(database, jobs, cache.get());
+        
+        std::cout << (summary.ok() ? "Build completed: " : "Build failed: ") << summary.built << " built";
+        if (summary.cached > 0) std::cout << " (" << summary.cached << " from cache)";
+        std::cout << ", " << summary.upToDate << " up to date";
+        if (summary.failed > 0) std::cout << ", " << summary.failed << " failed";
+        if (summary.skipped > 0) std::cout << ", " << summary.skipped << " skipped";
+        std::cout << " (" << static_cast<long>(summary.seconds * 1000) << " ms)" << std::endl;
+        return summary.ok();
+    }
+    
+    pulse::build::BuildStep compileStep(const std::string& source_file, const std::string& target_name,
+                                        const BuildTarget& target, const fs::path& build_dir) {
         fs::path source_path(source_file);
         std::string object_file = (build_dir / source_path.stem()).string() + ".o";
         
@@ -456,26 +993,35 @@ private:
             compile_cmd += " " + flag;
         }
         
-        std::cout << "Compiling: " << source_path.filename().string() << std::endl;
+        pulse::build::Hasher signature;
+        signature.addFile(source_path).add(compile_cmd).add(compilerIdentity(target.compiler));
         
-        // Execute compilation command
-        int result = system(compile_cmd.c_str());
-        if (result != 0) {
-            std::cerr << "Compilation failed for: " << source_file << std::endl;
-            return "";
-        }
+        pulse::build::BuildStep step{"Compiling " + source_path.filename().string() + " (" + target_name + ")",
+                                     compile_cmd, object_file, signature.digest(), {}};
         
-        return object_file;
+        // Without paths, so other checkouts and machines share the object
+        if (cache) {
+            pulse::build::Hasher key;
+            key.add("object").addFile(source_path).add(target.compiler);
+            for (const auto& flag : target.flags) {
+                key.add(flag);
+            }
+            key.add(compilerVersion(target.compiler)).add(dependencies());
+            step.cacheKey = key.digest();
+        }
+        return step;
     }
     
-    void linkExecutable(const std::vector<std::string>& object_files, const BuildTarget& target, const fs::path& build_dir) {
+    pulse::build::BuildStep linkStep(const pulse::build::BuildGraph& graph, const std::vector<size_t>& compile_steps,
+                                     const std::string& target_name, const BuildTarget& target,
+                                     const fs::path& build_dir) {
         std::string output_file = (build_dir / target.output_name).string();
         
         std::string link_cmd = target.compiler;
         
         // Add object files
-        for (const auto& obj_file : object_files) {
-            link_cmd += " " + obj_file;
+        for (size_t step : compile_steps) {
+            link_cmd += " " + graph.step(step).output;
         }
         
         // Add output file
@@ -486,13 +1032,37 @@ private:
             link_cmd += " -static-libgcc -static-libstdc++";
         }
         
-        std::cout << "Linking: " << target.output_name << std::endl;
+        pulse::build::Hasher signature;
+        signature.add(link_cmd).add(compilerIdentity(target.compiler));
         
-        // Execute linking command
-        int result = system(link_cmd.c_str());
-        if (result != 0) {
-            std::cerr << "Linking failed for target: " << target.name << std::endl;
+        return {"Linking " + target_name + "/" + target.output_name, link_cmd, output_file, signature.digest(),
+                compile_steps};
+    }
+    
+    const std::string& compilerVersion(const std::string& compiler) {
+        auto it = compilerVersions.find(compiler);
+        if (it == compilerVersions.end()) {
+            it = compilerVersions.emplace(compiler, cache->toolVersion(compiler)).first;
+        }
+        return it->second;
+    }
+    
+    uint64_t dependencies() {
+        if (!dependencyHash) {
+            const char* home = std::getenv("HOME");
+            dependencyHash = pulse::build::hashDependencies(projectDir / "pulse.toml",
+                                                            fs::path(home ? home : ".") / ".pulse");
+        }
+        return *dependencyHash;
+    }
+    
+    // Resolved once per compiler, not once per step
+    uint64_t compilerIdentity(const std::string& compiler) {
+        auto it = compilerIdentities.find(compiler);
+        if (it == compilerIdentities.end()) {
+            it = compilerIdentities.emplace(compiler, pulse::build::toolIdentity(compiler)).first;
         }
+        return it->second;
     }
 };
 
@@ -504,8 +1074,9 @@ private:
     fs::path packagesDir;
     fs::path cacheDir;
     fs::path libsDir;
-    std::unique_ptr<HTTPClient> httpClient;
     std::unique_ptr<BuildSystem> buildSystem;
+    std::unique_ptr<pulse::build::PackageStore> store;
+    unsigned connections = 8; // -j N: downloads at once
     
 public:
     PackageManager() {
@@ -523,8 +1094,8 @@ public:
         fs::create_directories(libsDir);
         
         // Initialize components
-        httpClient = std::make_unique<HTTPClient>();
         buildSystem = std::make_unique<BuildSystem>(fs::current_path());
+        store = std::make_unique<pulse::build::PackageStore>(pulse::build::PackageStore::defaultDirectory());
     }
     
     void run(int argc, char* argv[]) {
@@ -536,11 +1107,22 @@ public:
         std::string command = argv[1];
         
         if (command == "install") {
-            if (argc < 3) {
-                std::cerr << "Error: Package name or URL required for install command" << std::endl;
-                return;
+            std::string package_spec;
+            for (int i = 2; i < argc; i++) {
+                std::string arg = argv[i];
+                if (arg == "-j" && i + 1 < argc) {
+                    connections = parseJobs(argv[++i]);
+                } else if (arg.rfind("-j", 0) == 0) {
+                    connections = parseJobs(arg.substr(2));
+                } else {
+                    package_spec = arg;
+                }
+            }
+            if (package_spec.empty()) {
+                installProject();
+            } else {
+                installPackage(package_spec);
             }
-            installPackage(argv[2]);
         } else if (command == "remove") {
             if (argc < 3) {
                 std::cerr << "Error: Package name required for remove command" << std::endl;
@@ -556,14 +1138,34 @@ public:
             }
             searchPackages(argv[2]);
         } else if (command == "update") {
+            for (int i = 2; i < argc; i++) {
+                std::string arg = argv[i];
+                if (arg == "-j" && i + 1 < argc) {
+                    connections = parseJobs(argv[++i]);
+                } else if (arg.rfind("-j", 0) == 0) {
+                    connections = parseJobs(arg.substr(2));
+                }
+            }
             updatePackages();
         } else if (command == "init") {
             initProject();
         } else if (command == "build") {
-            if (argc < 3) {
-                buildSystem->buildAllTargets();
-            } else {
-                buildSystem->buildTarget(argv[2]);
+            std::string target;
+            for (int i = 2; i < argc; i++) {
+                std::string arg = argv[i];
+                if (arg == "-j" && i + 1 < argc) {
+                    buildSystem->setJobs(parseJobs(argv[++i]));
+                } else if (arg.rfind("-j", 0) == 0) {
+                    buildSystem->setJobs(parseJobs(arg.substr(2)));
+                } else if (arg == "--no-cache") {
+                    buildSystem->disableCache();
+                } else {
+                    target = arg;
+                }
+            }
+            bool ok = target.empty() ? buildSystem->buildAllTargets() : buildSystem->buildTarget(target);
+            if (!ok) {
+                throw std::runtime_error("build failed");
             }
         } else if (command == "targets") {
             buildSystem->listTargets();
@@ -582,18 +1184,26 @@ public:
     }
     
 private:
+    static unsigned parseJobs(const std::string& text) {
+        if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos || std::stoul(text) == 0) {
+            throw std::runtime_error("-j needs a positive job count, got '" + text + "'");
+        }
+        return static_cast<unsigned>(std::stoul(text));
+    }
+    
     void showHelp() {
         std::cout << "Pulse Package Manager (pulpm)" << std::endl;
         std::cout << "Usage: pulpm <command> [options]" << std::endl;
         std::cout << std::endl;
         std::cout << "Commands:" << std::endl;
+        std::cout << "  install [-j N]          Install the dependencies of ./pulse.toml as pulse.lock pins them" << std::endl;
         std::cout << "  install <package|url>  Install a package or fetch from URL" << std::endl;
         std::cout << "  remove <package>        Remove a package" << std::endl;
         std::cout << "  list                    List installed packages" << std::endl;
         std::cout << "  search <term>           Search for packages" << std::endl;
-        std::cout << "  update                  Update all packages" << std::endl;
+        std::cout << "  update [-j N]           Resolve ./pulse.toml again and rewrite pulse.lock" << std::endl;
         std::cout << "  init                    Initialize a new project" << std::endl;
-        std::cout << "  build [target]          Build project for target(s)" << std::endl;
+        std::cout << "  build [target] [-j N]   Build project for target(s), N jobs at once" << std::endl;
         std::cout << "  targets                 List available build targets" << std::endl;
         std::cout << "  fetch <url>             Fetch library from URL" << std::endl;
         std::cout << "  help                    Show this help message" << std::endl;
@@ -606,6 +1216,9 @@ private:
         } else {
             // Traditional package installation
             std::cout << "Installing package: " << package_spec << std::endl;
+            if (!isSafePackageName(package_spec)) {
+                throw std::runtime_error("'" + package_spec + "' is not a valid package name");
+            }
             
             if (isPackageInstalled(package_spec)) {
                 std::cout << "Package " << package_spec << " is already installed" << std::endl;
@@ -625,129 +1238,160 @@ private:
         }
     }
     
+    // The library at url and everything it depends on
     void fetchLibrary(const std::string& url) {
         std::cout << "Fetching library from: " << url << std::endl;
         
-        try {
-            // Try to fetch manifest first
-            std::string manifest_content = httpClient->fetchURL(url + "/pulse.toml");
-            Package pkg = ManifestParser::parseManifest(manifest_content, url);
-            
-            if (pkg.name.empty()) {
-                // Try JSON manifest
-                manifest_content = httpClient->fetchURL(url + "/pulse.json");
-                pkg = ManifestParser::parseManifest(manifest_content, url);
-            }
-            
-            if (pkg.name.empty()) {
-                // No manifest found, try to discover files
-                discoverAndDownloadFiles(url);
-                return;
-            }
-            
-            // Download package with manifest
-            downloadPackageWithManifest(pkg);
-            
-        } catch (const std::exception& e) {
-            std::cerr << "Failed to fetch library: " << e.what() << std::endl;
-            
-            // Fallback: try to discover and download files
-            try {
-                discoverAndDownloadFiles(url);
-            } catch (const std::exception& e2) {
-                std::cerr << "Failed to discover files: " << e2.what() << std::endl;
-            }
+        DependencyResolver resolver(libsDir, connections, *store);
+        if (!resolver.install({{DependencyResolver::extractPackageNameFromURL(url), url}})) {
+            throw std::runtime_error("failed to fetch " + url);
         }
     }
     
-    void discoverAndDownloadFiles(const std::string& url) {
-        std::cout << "No manifest found, discovering files..." << std::endl;
+    // Every [dependencies] and [libs] entry of the project's pulse.toml:
+    // URLs into the project's .pulse/libs, linked from the package store,
+    // versions installed as traditional packages. While pulse.toml's URLs
+    // are those pulse.lock was resolved from, the lock is installed as is
+    // and the network is only used for files the store lacks. refresh
+    // resolves everything again, as `pulpm update`.
+    void installProject(bool refresh = false) {
+        fs::path project_dir = fs::current_path();
+        fs::path config_file = project_dir / "pulse.toml";
+        if (!fs::exists(config_file)) {
+            throw std::runtime_error("no pulse.toml here; use 'pulpm install <package|url>'");
+        }
         
-        try {
-            std::vector<std::string> files = httpClient->listDirectory(url);
-            
-            if (files.empty()) {
-                std::cout << "No source files found" << std::endl;
-                return;
+        std::map<std::string, std::string> urls;
+        for (const auto& [name, spec] : ManifestParser::parseProjectDependencies(config_file)) {
+            if (spec.find("http://") == 0 || spec.find("https://") == 0) {
+                urls[name] = spec;
+            } else {
+                installPackage(name);
             }
-            
-            // Create package directory
-            std::string package_name = extractPackageNameFromURL(url);
-            fs::path package_dir = libsDir / package_name;
-            fs::create_directories(package_dir);
-            
-            // Download each file
-            for (const auto& file : files) {
-                std::string file_url = url + "/" + file;
-                std::string file_content = httpClient->fetchURL(file_url);
-                
-                fs::path file_path = package_dir / file;
-                fs::create_directories(file_path.parent_path());
-                
-                std::ofstream out_file(file_path);
-                out_file << file_content;
-                out_file.close();
-                
-                std::cout << "Downloaded: " << file << std::endl;
+        }
+        if (urls.empty()) {
+            std::cout << "No library dependencies to fetch" << std::endl;
+            return;
+        }
+        
+        fs::path project_libs = project_dir / ".pulse" / "libs";
+        fs::path lock_file = project_dir / "pulse.lock";
+        Lockfile lock;
+        if (!refresh && lock.load(lock_file)) {
+            if (lock.specs == Lockfile::hashSpecs(urls)) {
+                installLocked(lock, project_libs);
+                return;
             }
-            
-            std::cout << "Library downloaded successfully to: " << package_dir << std::endl;
-            
-        } catch (const std::exception& e) {
-            throw std::runtime_error("Failed to discover files: " + std::string(e.what()));
+            std::cout << "pulse.toml changed since pulse.lock was written; resolving again" << std::endl;
         }
+        
+        std::cout << "Resolving " << urls.size() << " dependencies with up to " << connections
+                  << " connections..." << std::endl;
+        DependencyResolver resolver(project_libs, connections, *store, !refresh);
+        if (!resolver.install(urls)) {
+            throw std::runtime_error("some dependencies could not be installed");
+        }
+        lock.specs = Lockfile::hashSpecs(urls);
+        lock.packages = resolver.lockedPackages();
+        lock.save(lock_file);
+        std::cout << "Wrote " << lock_file.filename().string() << " (" << lock.packages.size() << " packages)"
+                  << std::endl;
     }
     
-    void downloadPackageWithManifest(const Package& pkg) {
-        std::cout << "Downloading package: " << pkg.name << " v" << pkg.version << std::endl;
+    // Links the locked packages into libs_dir. A package whose package.info
+    // records the lock's content is left alone; files the store lacks are
+    // downloaded from the locked URL and must have the locked digest. The
+    // lock's names and paths were checked by Lockfile::load.
+    void installLocked(const Lockfile& lock, const fs::path& libs_dir) {
+        auto start = std::chrono::steady_clock::now();
         
-        fs::path package_dir = libsDir / pkg.name;
-        fs::create_directories(package_dir);
+        std::vector<const LockedPackage*> stale;
+        std::vector<std::pair<const LockedPackage*, std::string>> missing;
+        for (const auto& pkg : lock.packages) {
+            if (readContent(libs_dir / pkg.name) == pkg.contentHash() && filesPresent(libs_dir / pkg.name, pkg)) {
+                continue;
+            }
+            stale.push_back(&pkg);
+            for (const auto& [file, digest] : pkg.files) {
+                if (!store->contains(digest)) missing.emplace_back(&pkg, file);
+            }
+        }
         
-        // Download source files
-        for (const auto& source_file : pkg.source_files) {
-            std::string file_url = pkg.source_url + "/" + source_file;
-            std::string file_content = httpClient->fetchURL(file_url);
-            
-            fs::path file_path = package_dir / source_file;
-            fs::create_directories(file_path.parent_path());
-            
-            std::ofstream out_file(file_path);
-            out_file << file_content;
-            out_file.close();
-            
-            std::cout << "Downloaded: " << source_file << std::endl;
+        if (!missing.empty()) {
+            std::cout << "Fetching " << missing.size() << " file(s) missing from the package store..." << std::endl;
+            std::mutex mutex;
+            std::vector<std::string> errors;
+            FetchPool pool(connections);
+            for (const auto& [pkg, file] : missing) {
+                pool.submit([&, pkg = pkg, file = file](HTTPClient& client) {
+                    try {
+                        fs::path temporary = store->temporaryPath();
+                        client.download(pkg->url + "/" + file, temporary);
+                        if (store->add(temporary) != pkg->files.at(file)) {
+                            throw std::runtime_error("content differs from pulse.lock");
+                        }
+                    } catch (const std::exception& e) {
+                        std::lock_guard<std::mutex> guard(mutex);
+                        errors.push_back(pkg->name + "/" + file + ": " + e.what());
+                    }
+                });
+            }
+            pool.wait();
+            if (!errors.empty()) {
+                for (const auto& error : errors) {
+                    std::cerr << "  " << error << std::endl;
+                }
+                throw std::runtime_error("cannot install pulse.lock; 'pulpm update' resolves it again");
+            }
         }
         
-        // Save package info
-        savePackageInfo(package_dir, pkg);
+        for (const LockedPackage* pkg : stale) {
+            fs::path dir = libs_dir / pkg->name;
+            fs::remove_all(dir);
+            fs::create_directories(dir);
+            for (const auto& [file, digest] : pkg->files) {
+                store->link(digest, dir / file);
+            }
+            Package info;
+            info.name = pkg->name;
+            info.version = pkg->version;
+            info.description = "Package from " + pkg->url;
+            info.source_url = pkg->url;
+            info.last_updated = std::chrono::system_clock::now();
+            DependencyResolver::savePackageInfo(dir, info, pkg->contentHash());
+            std::cout << "Installed " << pkg->name << " v" << pkg->version << " from pulse.lock" << std::endl;
+        }
         
-        std::cout << "Package " << pkg.name << " downloaded successfully" << std::endl;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << lock.packages.size() << " package(s) from pulse.lock, " << lock.packages.size() - stale.size()
+                  << " already up to date; files " << store->reflinked() << " reflinked, " << store->hardlinked()
+                  << " hardlinked, " << store->copied() << " copied, " << missing.size() << " downloaded in "
+                  << static_cast<long>(seconds * 1000) << " ms" << std::endl;
     }
     
-    std::string extractPackageNameFromURL(const std::string& url) {
-        size_t last_slash = url.find_last_of('/');
-        if (last_slash != std::string::npos && last_slash < url.length() - 1) {
-            return url.substr(last_slash + 1);
+    // The Content: line of a package.info, empty if there is none
+    static std::string readContent(const fs::path& package_dir) {
+        std::ifstream info(package_dir / "package.info");
+        std::string line;
+        while (std::getline(info, line)) {
+            if (line.rfind("Content: ", 0) == 0) return line.substr(9);
         }
-        return "unknown";
+        return "";
     }
     
-    void savePackageInfo(const fs::path& package_dir, const Package& pkg) {
-        fs::path info_file = package_dir / "package.info";
-        std::ofstream out_file(info_file);
-        
-        out_file << "Name: " << pkg.name << std::endl;
-        out_file << "Version: " << pkg.version << std::endl;
-        out_file << "Description: " << pkg.description << std::endl;
-        out_file << "Source URL: " << pkg.source_url << std::endl;
-        out_file << "Last Updated: " << std::chrono::system_clock::to_time_t(pkg.last_updated) << std::endl;
-        
-        out_file.close();
+    static bool filesPresent(const fs::path& package_dir, const LockedPackage& pkg) {
+        std::error_code ec;
+        for (const auto& entry : pkg.files) {
+            if (!fs::is_regular_file(package_dir / entry.first, ec)) return false;
+        }
+        return true;
     }
     
     void removePackage(const std::string& packageName) {
         std::cout << "Removing package: " << packageName << std::endl;
+        if (!isSafePackageName(packageName)) {
+            throw std::runtime_error("'" + packageName + "' is not a valid package name");
+        }
         
         if (!isPackageInstalled(packageName)) {
             std::cout << "Package " << packageName << " is not installed" << std::endl;
@@ -780,6 +1424,17 @@ private:
             }
         }
         
+        // List the project's libraries
+        fs::path project_libs = fs::current_path() / ".pulse" / "libs";
+        bool project_empty = !fs::is_directory(project_libs) || fs::is_empty(project_libs);
+        if (!project_empty) {
+            for (const auto& entry : fs::directory_iterator(project_libs)) {
+                if (entry.is_directory()) {
+                    std::cout << "  " << entry.path().filename().string() << " (project)" << std::endl;
+                }
+            }
+        }
+        
         // List fetched libraries
         if (fs::exists(libsDir) && !fs::is_empty(libsDir)) {
             for (const auto& entry : fs::directory_iterator(libsDir)) {
@@ -790,19 +1445,50 @@ private:
             }
         }
         
-        if (fs::is_empty(packagesDir) && fs::is_empty(libsDir)) {
+        if (fs::is_empty(packagesDir) && fs::is_empty(libsDir) && project_empty) {
             std::cout << "  No packages installed" << std::endl;
         }
     }
     
+    // Searches what is on this machine (the project's pulse.lock and the
+    // installed packages), without the network
     void searchPackages(const std::string& term) {
         std::cout << "Searching for packages containing: " << term << std::endl;
-        std::cout << "Note: Package search not yet implemented" << std::endl;
+        
+        std::set<std::string> seen;
+        auto report = [&](const std::string& name, const std::string& version, const std::string& where) {
+            if (name.find(term) == std::string::npos || !seen.insert(name + " " + where).second) return;
+            std::cout << "  " << name << (version.empty() ? "" : " v" + version) << " (" << where << ")" << std::endl;
+        };
+        
+        Lockfile lock;
+        if (lock.load(fs::current_path() / "pulse.lock")) {
+            for (const auto& pkg : lock.packages) {
+                report(pkg.name, pkg.version, "pulse.lock");
+            }
+        }
+        for (const auto& [dir, where] : {std::pair{fs::current_path() / ".pulse" / "libs", "project"},
+                                         std::pair{libsDir, "fetched"}, std::pair{packagesDir, "traditional"}}) {
+            std::error_code ec;
+            for (const auto& entry : fs::directory_iterator(dir, ec)) {
+                if (!entry.is_directory()) continue;
+                std::ifstream info(entry.path() / "package.info");
+                std::string line;
+                std::string version;
+                while (std::getline(info, line)) {
+                    if (line.rfind("Version: ", 0) == 0) version = line.substr(9);
+                }
+                report(entry.path().filename().string(), version, where);
+            }
+        }
+        if (seen.empty()) {
+            std::cout << "  No matching packages" << std::endl;
+        }
     }
     
     void updatePackages() {
         std::cout << "Updating packages..." << std::endl;
-        std::cout << "Note: Package updates not yet implemented" << std::endl;
+        installProject(true);
     }
     
     void initProject() {
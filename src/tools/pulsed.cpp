@@ -0,0 +1,613 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "driver/formatter.hpp"
+#include "driver/frontend.hpp"
+#include "driver/json.hpp"
+#include "driver/rpc.hpp"
+#include "driver/workspace.hpp"
+#include "lexer/source_buffer.hpp"
+#include "lexer/tokenizer.hpp"
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+using pulse::driver::Json;
+using pulse::driver::Position;
+using pulse::driver::RpcChannel;
+using pulse::driver::Symbol;
+
+namespace {
+
+// JSON-RPC and LSP error codes
+constexpr int INVALID_REQUEST = -32600;
+constexpr int METHOD_NOT_FOUND = -32601;
+constexpr int INVALID_PARAMS = -32602;
+constexpr int INTERNAL_ERROR = -32603;
+constexpr int SERVER_NOT_INITIALIZED = -32002;
+constexpr int REQUEST_FAILED = -32803;
+
+// An error response to a request
+struct RequestError {
+    int code;
+    std::string message;
+};
+
+// The socket to remove on the way out
+std::string listeningSocket;
+
+void removeSocket() {
+    if (!listeningSocket.empty()) {
+        std::remove(listeningSocket.c_str());
+    }
+}
+
+void onSignal(int) {
+    removeSocket();
+    std::_Exit(1);
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// file:///a%20b.pul -> /a b.pul; other schemes are kept as names
+std::string uriToPath(const std::string& uri) {
+    if (uri.rfind("file://", 0) != 0) return uri;
+    std::string path;
+    for (size_t i = 7; i < uri.size(); i++) {
+        if (uri[i] == '%' && i + 2 < uri.size() && hexValue(uri[i + 1]) >= 0 && hexValue(uri[i + 2]) >= 0) {
+            path += static_cast<char>(hexValue(uri[i + 1]) * 16 + hexValue(uri[i + 2]));
+            i += 2;
+        } else {
+            path += uri[i];
+        }
+    }
+    return path;
+}
+
+std::string pathToUri(const std::string& path) {
+    if (path.find("://") != std::string::npos) return path;
+    static const char* const HEX = "0123456789ABCDEF";
+    std::string uri = "file://";
+    for (unsigned char c : path) {
+        if (std::isalnum(c) || c == '/' || c == '-' || c == '_' || c == '.' || c == '~') {
+            uri += static_cast<char>(c);
+        } else {
+            uri += '%';
+            uri += HEX[c >> 4];
+            uri += HEX[c & 15];
+        }
+    }
+    return uri;
+}
+
+size_t utf8Length(unsigned char c) {
+    if (c >= 0xF0) return 4;
+    if (c >= 0xE0) return 3;
+    if (c >= 0xC0) return 2;
+    return 1;
+}
+
+// Positions in UTF-16 code units, the LSP default, to byte columns and back
+uint32_t byteColumn(std::string_view line, uint32_t character) {
+    size_t bytes = 0;
+    uint32_t units = 0;
+    while (bytes < line.size() && units < character) {
+        size_t length = utf8Length(static_cast<unsigned char>(line[bytes]));
+        units += length == 4 ? 2 : 1;
+        bytes += length;
+    }
+    return static_cast<uint32_t>(std::min(bytes, line.size()));
+}
+
+uint32_t utf16Column(std::string_view line, uint32_t column) {
+    size_t bytes = 0;
+    uint32_t units = 0;
+    while (bytes < line.size() && bytes < column) {
+        size_t length = utf8Length(static_cast<unsigned char>(line[bytes]));
+        units += length == 4 ? 2 : 1;
+        bytes += length;
+    }
+    return units;
+}
+
+int symbolKind(Symbol::Kind kind, bool member) {
+    // LSP SymbolKind
+    switch (kind) {
+        case Symbol::Kind::FUNCTION: return 12;
+        case Symbol::Kind::METHOD: return 6;
+        case Symbol::Kind::CLASS: return 5;
+        case Symbol::Kind::MODULE: return 2;
+        case Symbol::Kind::PARAMETER: return 13;
+        case Symbol::Kind::VARIABLE: return member ? 8 : 13;
+    }
+    return 13;
+}
+
+// The editor's requests and the build API, one handler for any number of
+// channels: the editor on stdin/stdout and clients of the socket. Requests
+// are served one at a time; each is a few milliseconds on the chunks a
+// change touched.
+class Server {
+public:
+    Server(bool verbose, size_t jobs) : verbose(verbose), jobs(jobs) {}
+
+    // Until the channel ends, or the editor's `exit`
+    void serve(RpcChannel& channel, bool editor) {
+        Json message;
+        while (true) {
+            try {
+                if (!channel.read(message)) return;
+            } catch (const std::exception& e) {
+                log(std::string("dropped connection: ") + e.what());
+                return;
+            }
+            const Json& request = message;
+            std::string method = request["method"].asString();
+            bool isRequest = request.contains("id");
+            auto start = std::chrono::steady_clock::now();
+
+            Json response;
+            response["jsonrpc"] = "2.0";
+            if (isRequest) response["id"] = request["id"];
+            try {
+                if (method.empty()) {
+                    if (!isRequest) continue; // a response to us; we send no requests
+                    throw RequestError{INVALID_REQUEST, "request without a method"};
+                }
+                if (method == "exit" && editor) {
+                    removeSocket();
+                    std::exit(shutdownRequested ? 0 : 1);
+                }
+                Json result;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (editor && !initialized && method != "initialize") {
+                        throw RequestError{SERVER_NOT_INITIALIZED, "initialize first"};
+                    }
+                    result = handle(method, request["params"], channel);
+                }
+                response["result"] = std::move(result);
+            } catch (const RequestError& e) {
+                response["error"]["code"] = e.code;
+                response["error"]["message"] = e.message;
+            } catch (const std::exception& e) {
+                response["error"]["code"] = INTERNAL_ERROR;
+                response["error"]["message"] = e.what();
+            }
+
+            if (verbose) {
+                auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+                char line[256];
+                std::snprintf(line, sizeof(line), "%s: %.3f ms", method.c_str(), elapsed.count());
+                log(line + lastDetail);
+            }
+            lastDetail.clear();
+            if (!isRequest) {
+                if (response.contains("error")) log(method + ": " + response["error"]["message"].asString());
+                continue;
+            }
+            try {
+                channel.write(response);
+            } catch (const std::exception& e) {
+                log(std::string("dropped connection: ") + e.what());
+                return;
+            }
+        }
+    }
+
+    bool wasShutDown() const { return shutdownRequested; }
+
+private:
+    std::mutex mutex; // for everything below
+    pulse::driver::Workspace workspace;
+    bool verbose;
+    size_t jobs;
+    bool initialized = false;
+    bool shutdownRequested = false;
+    bool utf8 = false; // positions in bytes, if the editor agreed to it
+    std::string lastDetail;
+
+    void log(const std::string& text) {
+        std::cerr << "pulsed: " << text << std::endl;
+    }
+
+    Json handle(const std::string& method, const Json& params, RpcChannel& channel) {
+        if (method == "initialize") return initialize(params);
+        if (method == "initialized" || method == "$/cancelRequest" || method == "$/setTrace" ||
+            method == "textDocument/didSave" || method == "workspace/didChangeConfiguration") {
+            return Json();
+        }
+        if (method == "shutdown") {
+            shutdownRequested = true;
+            return Json();
+        }
+        if (method == "textDocument/didOpen") {
+            const Json& document = params["textDocument"];
+            std::string path = uriToPath(document["uri"].asString());
+            auto& opened = workspace.open(path, document["text"].asString());
+            changed(opened, document["uri"].asString(), document["version"], channel);
+            return Json();
+        }
+        if (method == "textDocument/didChange") return didChange(params, channel);
+        if (method == "textDocument/didClose") {
+            std::string uri = params["textDocument"]["uri"].asString();
+            workspace.close(uriToPath(uri));
+            Json notification;
+            notification["jsonrpc"] = "2.0";
+            notification["method"] = "textDocument/publishDiagnostics";
+            notification["params"]["uri"] = uri;
+            notification["params"]["diagnostics"] = Json::Array();
+            channel.write(notification);
+            return Json();
+        }
+        if (method == "textDocument/definition") return definition(params);
+        if (method == "textDocument/formatting") return format(params, false);
+        if (method == "textDocument/rangeFormatting") return format(params, true);
+        if (method == "textDocument/documentSymbol") return documentSymbols(params);
+        if (method == "pulse/check") return check(params);
+        throw RequestError{METHOD_NOT_FOUND, "unsupported method " + method};
+    }
+
+    Json initialize(const Json& params) {
+        initialized = true;
+        for (const Json& encoding : params["capabilities"]["general"]["positionEncodings"].items()) {
+            if (encoding.asString() == "utf-8") utf8 = true;
+        }
+
+        Json capabilities;
+        capabilities["positionEncoding"] = utf8 ? "utf-8" : "utf-16";
+        Json& sync = capabilities["textDocumentSync"];
+        sync["openClose"] = true;
+        sync["change"] = 2; // incremental
+        sync["save"] = false;
+        capabilities["definitionProvider"] = true;
+        capabilities["documentFormattingProvider"] = true;
+        capabilities["documentRangeFormattingProvider"] = true;
+        capabilities["documentSymbolProvider"] = true;
+
+        Json result;
+        result["capabilities"] = std::move(capabilities);
+        result["serverInfo"]["name"] = "pulsed";
+        result["serverInfo"]["version"] = "0.1.0";
+        return result;
+    }
+
+    pulse::driver::Document& document(const Json& params) {
+        std::string path = uriToPath(params["textDocument"]["uri"].asString());
+        pulse::driver::Document* document = workspace.find(path);
+        if (!document) {
+            throw RequestError{INVALID_PARAMS, "document not open: " + params["textDocument"]["uri"].asString()};
+        }
+        return *document;
+    }
+
+    Position toPosition(const pulse::driver::Document& document, const Json& position) const {
+        uint32_t line = static_cast<uint32_t>(std::max<int64_t>(0, position["line"].asInt()));
+        uint32_t character = static_cast<uint32_t>(std::max<int64_t>(0, position["character"].asInt()));
+        return {line, utf8 ? character : byteColumn(document.line(line), character)};
+    }
+
+    Json toJson(const pulse::driver::Document& document, Position position) const {
+        Json json;
+        json["line"] = position.line;
+        json["character"] = utf8 ? position.column : utf16Column(document.line(position.line), position.column);
+        return json;
+    }
+
+    Json range(const pulse::driver::Document& document, Position start, Position end) const {
+        Json json;
+        json["start"] = toJson(document, start);
+        json["end"] = toJson(document, end);
+        return json;
+    }
+
+    Json didChange(const Json& params, RpcChannel& channel) {
+        pulse::driver::Document& changing = document(params);
+        size_t reparsed = 0;
+        for (const Json& change : params["contentChanges"].items()) {
+            if (change.contains("range")) {
+                Position start = toPosition(changing, change["range"]["start"]);
+                Position end = toPosition(changing, change["range"]["end"]);
+                changing.edit(start, end, change["text"].asString());
+            } else {
+                changing.setText(change["text"].asString());
+            }
+            reparsed += changing.lastReparsed();
+        }
+        lastDetail = ", " + std::to_string(reparsed) + " of " + std::to_string(changing.chunkCount()) +
+                     " chunk(s) parsed again";
+        changed(changing, params["textDocument"]["uri"].asString(), params["textDocument"]["version"], channel);
+        return Json();
+    }
+
+    // Diagnostics after a change, for the editor to show
+    void changed(const pulse::driver::Document& document, const std::string& uri, const Json& version,
+                 RpcChannel& channel) {
+        Json diagnostics = Json::Array();
+        for (const auto& diagnostic : document.diagnostics()) {
+            Position start{diagnostic.line > 0 ? static_cast<uint32_t>(diagnostic.line - 1) : 0,
+                           static_cast<uint32_t>(diagnostic.column)};
+            std::string_view line = document.line(start.line);
+            start.column = std::min<uint32_t>(start.column, static_cast<uint32_t>(line.size()));
+            // One character, or to the end of the line when it is at the end
+            Position end{start.line, start.column < line.size() ? start.column + 1 : start.column};
+            Json item;
+            item["range"] = range(document, start, end);
+            item["severity"] = 1;
+            item["source"] = "pulse";
+            item["message"] = diagnostic.message;
+            diagnostics.push(std::move(item));
+        }
+        Json notification;
+        notification["jsonrpc"] = "2.0";
+        notification["method"] = "textDocument/publishDiagnostics";
+        notification["params"]["uri"] = uri;
+        if (version.isNumber()) notification["params"]["version"] = version;
+        notification["params"]["diagnostics"] = std::move(diagnostics);
+        channel.write(notification);
+    }
+
+    Json definition(const Json& params) {
+        std::string path = uriToPath(params["textDocument"]["uri"].asString());
+        const pulse::driver::Document* from = workspace.find(path);
+        if (!from) from = &workspace.load(path);
+        Position position = toPosition(*from, params["position"]);
+        std::optional<pulse::driver::Location> location = workspace.definition(path, position);
+        if (!location) return Json();
+
+        const pulse::driver::Document* target = workspace.find(location->path);
+        if (!target) target = &workspace.load(location->path);
+        std::string_view line = target->line(location->position.line);
+        uint32_t length = 0;
+        while (location->position.column + length < line.size() &&
+               (std::isalnum(static_cast<unsigned char>(line[location->position.column + length])) ||
+                line[location->position.column + length] == '_')) {
+            length++;
+        }
+        Json result;
+        result["uri"] = pathToUri(location->path);
+        result["range"] = range(*target, location->position,
+                                {location->position.line, location->position.column + length});
+        return result;
+    }
+
+    // One edit, over the lines that differ
+    Json format(const Json& params, bool ranged) {
+        pulse::driver::Document& formatting = document(params);
+        std::string text = formatting.text();
+        pulse::driver::LineRanges lines;
+        if (ranged) {
+            Position start = toPosition(formatting, params["range"]["start"]);
+            Position end = toPosition(formatting, params["range"]["end"]);
+            // A selection ending at the start of a line does not take it in
+            uint32_t last = end.column == 0 && end.line > start.line ? end.line - 1 : end.line;
+            lines.emplace_back(start.line + 1, last + 1);
+        }
+
+        std::string formatted;
+        try {
+            pulse::driver::TokenFormatter formatter;
+            formatted = formatter.format(pulse::lexer::SourceBuffer::fromString(text, formatting.getPath()),
+                                         ranged ? &lines : nullptr);
+        } catch (const pulse::lexer::LexError& e) {
+            throw RequestError{REQUEST_FAILED, "line " + std::to_string(e.line) + ": " + e.message};
+        } catch (const std::exception& e) {
+            throw RequestError{REQUEST_FAILED, e.what()};
+        }
+
+        Json edits = Json::Array();
+        if (formatted == text) return edits;
+        size_t prefix = 0;
+        size_t limit = std::min(text.size(), formatted.size());
+        while (prefix < limit && text[prefix] == formatted[prefix]) prefix++;
+        while (prefix > 0 && text[prefix - 1] != '\n') prefix--;
+        size_t suffix = 0;
+        while (suffix < limit - prefix && text[text.size() - 1 - suffix] == formatted[formatted.size() - 1 - suffix]) {
+            suffix++;
+        }
+        while (suffix > 0 && text[text.size() - suffix - 1] != '\n') suffix--;
+
+        Json edit;
+        edit["range"] = range(formatting, formatting.positionOf(prefix), formatting.positionOf(text.size() - suffix));
+        edit["newText"] = formatted.substr(prefix, formatted.size() - suffix - prefix);
+        edits.push(std::move(edit));
+        return edits;
+    }
+
+    Json documentSymbols(const Json& params) {
+        pulse::driver::Document& listed = document(params);
+        Json symbols = Json::Array();
+        std::string uri = params["textDocument"]["uri"].asString();
+        for (const Symbol& symbol : listed.symbols()) {
+            if (symbol.local) continue;
+            Json item;
+            item["name"] = symbol.name;
+            item["kind"] = symbolKind(symbol.kind, !symbol.container.empty());
+            item["location"]["uri"] = uri;
+            item["location"]["range"] =
+                range(listed, symbol.position,
+                      {symbol.position.line, symbol.position.column + static_cast<uint32_t>(symbol.name.size())});
+            if (!symbol.container.empty()) item["containerName"] = symbol.container;
+            symbols.push(std::move(item));
+        }
+        return symbols;
+    }
+
+    // Build API: {"files": [...]} -> {"diagnostics": [{"file", "line", "column", "message"}], ...}
+    Json check(const Json& params) {
+        std::vector<std::string> paths;
+        for (const Json& file : params["files"].items()) {
+            paths.push_back(file.asString());
+        }
+        size_t reparsed = 0;
+        std::vector<pulse::driver::Diagnostic> diagnostics = workspace.check(paths, jobs, reparsed);
+        lastDetail = ", " + std::to_string(paths.size()) + " file(s), " + std::to_string(reparsed) +
+                     " chunk(s) parsed again";
+
+        Json result;
+        result["diagnostics"] = Json::Array();
+        for (const auto& diagnostic : diagnostics) {
+            Json item;
+            item["file"] = diagnostic.file;
+            item["line"] = diagnostic.line;
+            item["column"] = diagnostic.column;
+            item["message"] = diagnostic.message;
+            result["diagnostics"].push(std::move(item));
+        }
+        result["files"] = paths.size();
+        result["reparsed"] = reparsed;
+        return result;
+    }
+};
+
+#ifndef _WIN32
+// Listen on path, replacing a socket no daemon answers on any more
+int listenOn(const std::string& path) {
+    try {
+        RpcChannel::connect(path);
+        throw std::runtime_error("a daemon is already listening on " + path);
+    } catch (const std::runtime_error& e) {
+        if (std::string(e.what()).rfind("a daemon", 0) == 0) throw;
+    }
+    std::error_code error;
+    fs::remove(path, error);
+    if (fs::path(path).has_parent_path()) {
+        fs::create_directories(fs::path(path).parent_path(), error);
+    }
+
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("socket path too long: " + path);
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 16) != 0) {
+        throw std::runtime_error("cannot listen on " + path + ": " + std::strerror(errno));
+    }
+    // Only this user's tools may talk to it
+    ::chmod(path.c_str(), 0600);
+    return fd;
+}
+
+void acceptLoop(int fd, Server& server) {
+    while (true) {
+        int client = ::accept(fd, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "pulsed: accept: " << std::strerror(errno) << std::endl;
+            return;
+        }
+        std::thread([client, &server] {
+            RpcChannel channel(client, client, true);
+            server.serve(channel, false);
+        }).detach();
+    }
+}
+#endif
+
+void showHelp() {
+    std::cout << "Pulse Language Server (pulsed)" << std::endl;
+    std::cout << "Usage: pulsed [options]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --stdio           Serve an editor on stdin/stdout (the default without a socket)" << std::endl;
+    std::cout << "  --socket <path>   Also listen on a Unix socket, for pulbuild and other tools" << std::endl;
+    std::cout << "  --project <dir>   Listen on the socket of a project: build/pulsed.sock," << std::endl;
+    std::cout << "                    or $PULSE_DAEMON_SOCKET" << std::endl;
+    std::cout << "  -j, --jobs <n>    Threads for checking files on disk (default: all cores)" << std::endl;
+    std::cout << "  -v, --verbose     Log each request and its time to stderr" << std::endl;
+    std::cout << "  -h, --help        Show this help message" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Files stay lexed and parsed in memory, one chunk per top-level statement;" << std::endl;
+    std::cout << "a change parses again only the chunks it touches. Editors get diagnostics," << std::endl;
+    std::cout << "go-to-definition, document symbols and formatting over the Language Server" << std::endl;
+    std::cout << "Protocol. On the socket, pulse/check {\"files\": [...]} returns the" << std::endl;
+    std::cout << "diagnostics of files as on disk; pulbuild asks it before building." << std::endl;
+    std::cout << std::endl;
+    std::cout << "Examples:" << std::endl;
+    std::cout << "  pulsed                        # Language server for an editor" << std::endl;
+    std::cout << "  pulsed --project . &          # Daemon for pulbuild in this project" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    bool stdio = false;
+    bool verbose = false;
+    size_t jobs = 0;
+    std::string socketPath;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            showHelp();
+            return 0;
+        } else if (arg == "--stdio") {
+            stdio = true;
+        } else if (arg == "-v" || arg == "--verbose") {
+            verbose = true;
+        } else if ((arg == "--socket" || arg == "--project") && i + 1 < argc) {
+            socketPath = arg == "--socket" ? argv[++i] : pulse::driver::daemonSocketPath(argv[++i]);
+        } else if ((arg == "-j" || arg == "--jobs") && i + 1 < argc) {
+            jobs = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            showHelp();
+            return 1;
+        }
+    }
+    if (socketPath.empty()) stdio = true;
+
+    Server server(verbose, jobs);
+    try {
+        if (!socketPath.empty()) {
+#ifdef _WIN32
+            throw std::runtime_error("--socket is not supported on this platform");
+#else
+            int fd = listenOn(socketPath);
+            listeningSocket = socketPath;
+            std::atexit(removeSocket);
+            std::signal(SIGINT, onSignal);
+            std::signal(SIGTERM, onSignal);
+            if (verbose) std::cerr << "pulsed: listening on " << socketPath << std::endl;
+            if (!stdio) {
+                acceptLoop(fd, server);
+                return 1;
+            }
+            std::thread(acceptLoop, fd, std::ref(server)).detach();
+#endif
+        }
+
+        RpcChannel channel(0, 1);
+        server.serve(channel, true);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    // The editor went away without `exit`
+    removeSocket();
+    return server.wasShutDown() ? 0 : 1;
+}
@@ -0,0 +1,15 @@
+# Runs one program through `pulse run` (JIT) and `pulse run --interpret`
+# (VM) and fails unless both print the same and exit the same way.
+#   cmake -DPULSE=<pulse> -DPROGRAM=<file.pul> -P parity.cmake
+
+execute_process(COMMAND ${PULSE} run ${PROGRAM}
+                OUTPUT_VARIABLE jit_output ERROR_VARIABLE jit_errors RESULT_VARIABLE jit_status)
+execute_process(COMMAND ${PULSE} run --interpret ${PROGRAM}
+                OUTPUT_VARIABLE vm_output ERROR_VARIABLE vm_errors RESULT_VARIABLE vm_status)
+
+if(NOT jit_output STREQUAL vm_output)
+    message(FATAL_ERROR "output differs\n--- JIT\n${jit_output}${jit_errors}--- VM\n${vm_output}${vm_errors}")
+endif()
+if(NOT jit_status STREQUAL vm_status)
+    message(FATAL_ERROR "JIT exited with ${jit_status}, VM with ${vm_status}\n--- JIT\n${jit_errors}--- VM\n${vm_errors}")
+endif()